@@ -28,9 +28,12 @@ package com.vmware.jvix;
 
 import java.nio.ByteBuffer;
 import java.util.List;
+import java.util.Map;
 import java.util.logging.Level;
 import java.util.logging.Logger;
 
+import com.vmware.safekeeping.common.GuestOsUtils;
+
 /*
  * jDiskLibImpl implements the jDiskLib interface. This allows us to hide all
  * implementation details for the vixDiskLib JNI from users of the interface.
@@ -44,6 +47,8 @@ public class JDisk extends jDiskLibImpl {
 
 	private final NativeLibraryVersion vddkVersion;
 
+	private Boolean extendedLibrary;
+
 	/**
 	 * @param nativeVersion
 	 */
@@ -77,6 +82,39 @@ public class JDisk extends jDiskLibImpl {
 		return returnlong;
 	}
 
+	@Override
+	public long attachDaemon(final String socketPath, final int slots, final int slotSize) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("String, int, int - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = AttachDaemonJNI(socketPath, slots, slotSize);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("String, int, int - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
+	@Override
+	public long buildCatalog(final DiskHandle diskHandle, final int partition, final long cacheSize,
+			final byte[][] catalog, final long[] stats) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("DiskHandle, int, long, byte[][], long[] - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = CatalogBuildJNI(getDiskHandle(diskHandle), partition, cacheSize, catalog, stats);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("DiskHandle, int, long, byte[][], long[] - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
 	@Override
 	public long checkRepair(final Connection connHandle, final String path, final boolean repair) {
 		if (logger.isLoggable(Level.CONFIG)) {
@@ -220,6 +258,41 @@ public class JDisk extends jDiskLibImpl {
 		return result;
 	}
 
+	@Override
+	public long copyDisk(final DiskHandle src, final DiskHandle dst, final long startSector, final long endSector,
+			final int chunkSectors, final int depth, final boolean allocatedOnly, final Progress progress,
+			final long[] stats) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("DiskHandle, DiskHandle, long, long, int, int, boolean, Progress, long[] - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = CopyJNI(getDiskHandle(src), getDiskHandle(dst), startSector, endSector, chunkSectors, depth,
+					allocatedOnly, progress, stats);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("DiskHandle, DiskHandle, long, long, int, int, boolean, Progress, long[] - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
+	@Override
+	public int crc32cMap(final byte[] buf, final int offset, final int length, final int[] map) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("byte[], int, int, int[] - start"); //$NON-NLS-1$
+		}
+
+		int returnint = jDiskLibConst.CRC32C_MAP_FAILED;
+		if (isExtendedLibrary()) {
+			returnint = Crc32cMapJNI(buf, offset, length, map);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("byte[], int, int, int[] - end"); //$NON-NLS-1$
+		}
+		return returnint;
+	}
+
 	@Override
 	public long create(final Connection connHandle, final String path, final CreateParams createParams,
 			final Progress progress) {
@@ -261,6 +334,20 @@ public class JDisk extends jDiskLibImpl {
 		return returnlong;
 	}
 
+	@Override
+	public void detachDaemon() {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("<no args> - start"); //$NON-NLS-1$
+		}
+
+		if (isExtendedLibrary()) {
+			DetachDaemonJNI();
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("<no args> - end"); //$NON-NLS-1$
+		}
+	}
+
 	@Override
 	public long disconnect(final Connection connHandle) {
 		if (logger.isLoggable(Level.CONFIG)) {
@@ -303,6 +390,22 @@ public class JDisk extends jDiskLibImpl {
 		return returnlong;
 	}
 
+	@Override
+	public int estimateEntropy(final byte[] buf, final int offset, final int length, final int sampleSize) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("byte[], int, int, int - start"); //$NON-NLS-1$
+		}
+
+		int returnint = jDiskLibConst.ENTROPY_NOT_AVAILABLE;
+		if (isExtendedLibrary()) {
+			returnint = EstimateEntropyJNI(buf, offset, length, sampleSize);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("byte[], int, int, int - end"); //$NON-NLS-1$
+		}
+		return returnint;
+	}
+
 	@Override
 	public void exit() {
 		if (logger.isLoggable(Level.CONFIG)) {
@@ -355,6 +458,38 @@ public class JDisk extends jDiskLibImpl {
 		}
 	}
 
+	@Override
+	public long getAsyncQueueStats(final DiskHandle diskHandle, final long[] stats) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("DiskHandle, long[] - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = GetAsyncQueueStatsJNI(getDiskHandle(diskHandle), stats);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("DiskHandle, long[] - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
+	@Override
+	public long getConnectionCacheStats(final long[] stats) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long[] - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = GetConnectionCacheStatsJNI(stats);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long[] - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
 	@Override
 	public long getConnectParams(final Connection connHandle, final ConnectParams connectParams) {
 		if (logger.isLoggable(Level.CONFIG)) {
@@ -368,6 +503,22 @@ public class JDisk extends jDiskLibImpl {
 		return returnlong;
 	}
 
+	@Override
+	public long getDaemonStats(final long[] stats) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long[] - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = GetDaemonStatsJNI(stats);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long[] - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
 	@Override
 	public long getConnHandle(final Connection connHandle) {
 		if (logger.isLoggable(Level.CONFIG)) {
@@ -467,6 +618,22 @@ public class JDisk extends jDiskLibImpl {
 		return returnString;
 	}
 
+	@Override
+	public int getVddkCapabilities() {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("<no args> - start"); //$NON-NLS-1$
+		}
+
+		int returnint = 0;
+		if (isExtendedLibrary()) {
+			returnint = GetVddkCapabilitiesJNI();
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("<no args> - end"); //$NON-NLS-1$
+		}
+		return returnint;
+	}
+
 	@Override
 	public long grow(final Connection connHandle, final String path, final long capacityInSectors,
 			final boolean updateGeometry, final Progress progress) {
@@ -481,6 +648,86 @@ public class JDisk extends jDiskLibImpl {
 		return returnlong;
 	}
 
+	@Override
+	public void guestFsClose(final long handle) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long - start"); //$NON-NLS-1$
+		}
+
+		if (isExtendedLibrary()) {
+			GuestFsCloseJNI(handle);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long - end"); //$NON-NLS-1$
+		}
+	}
+
+	@Override
+	public long guestFsList(final long handle, final long inode, final List<GuestFsEntry> entries) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long, long, List<GuestFsEntry> - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = GuestFsListJNI(handle, inode, entries);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long, long, List<GuestFsEntry> - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
+	@Override
+	public long guestFsLookup(final long handle, final String path, final GuestFsEntry entry) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long, String, GuestFsEntry - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = GuestFsLookupJNI(handle, path, entry);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long, String, GuestFsEntry - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
+	@Override
+	public long guestFsOpen(final String[] paths, final long[] extents, final int[] params, final byte[] key,
+			final long capacity, final int partition, final long cacheSize, final long[] handle) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("String[], long[], int[], byte[], long, int, long, long[] - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = GuestFsOpenJNI(paths, extents, params, key, capacity, partition, cacheSize, handle);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("String[], long[], int[], byte[], long, int, long, long[] - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
+	@Override
+	public long guestFsRead(final long handle, final long inode, final long offset, final byte[] buf,
+			final int length) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long, long, long, byte[], int - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = -1;
+		if (isExtendedLibrary()) {
+			returnlong = GuestFsReadJNI(handle, inode, offset, buf, length);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long, long, long, byte[], int - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
 	@Override
 	public long init(final int majorVersion, final int minorVersion, final JVixLogger jvixLogger, final String libDir) {
 		if (logger.isLoggable(Level.CONFIG)) {
@@ -548,6 +795,28 @@ public class JDisk extends jDiskLibImpl {
 		return returnlong;
 	}
 
+	/**
+	 * The extensions to the VixDiskLib API (adaptive async queue, ...) are built
+	 * in the Linux library, which loads the VixDiskLib of any VDDK at run time.
+	 * A library built before does not export them and is only extended for VDDK
+	 * 7.0
+	 */
+	@Override
+	public boolean isExtendedLibrary() {
+		if (this.extendedLibrary == null) {
+			boolean extended = GuestOsUtils.isUnix();
+			if (extended && (this.vddkVersion != NativeLibraryVersion.VDDK70)) {
+				try {
+					GetVddkCapabilitiesJNI();
+				} catch (final UnsatisfiedLinkError e) {
+					extended = false;
+				}
+			}
+			this.extendedLibrary = extended;
+		}
+		return this.extendedLibrary;
+	}
+
 	@Override
 	public String listTransportModes() {
 		if (logger.isLoggable(Level.CONFIG)) {
@@ -561,6 +830,88 @@ public class JDisk extends jDiskLibImpl {
 		return returnString;
 	}
 
+	@Override
+	public int miGzDecode(final byte[] src, final int srcLength, final byte[] dst, final int threads) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("byte[], int, byte[], int - start"); //$NON-NLS-1$
+		}
+
+		int returnint = jDiskLibConst.MIGZ_DECODE_FAILED;
+		if (isExtendedLibrary()) {
+			returnint = MiGzDecodeJNI(src, srcLength, dst, threads);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("byte[], int, byte[], int - end"); //$NON-NLS-1$
+		}
+		return returnint;
+	}
+
+	@Override
+	public long multiBufferHash(final int algorithm, final byte[] buf, final int offset, final int length,
+			final byte[] digest) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("int, byte[], int, int, byte[] - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = MultiBufferHashJNI(algorithm, buf, offset, length, digest);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("int, byte[], int, int, byte[] - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
+	@Override
+	public long nbdGetStats(final long handle, final long[] stats) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long, long[] - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = NbdGetStatsJNI(handle, stats);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long, long[] - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
+	@Override
+	public long nbdStart(final String[] paths, final long[] extents, final int[] params, final byte[] key,
+			final long capacity, final long cacheSize, final String name, final String address, final int port,
+			final long readahead, final long overlayLimit, final long[] handle) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("String[], long[], int[], byte[], long, long, String, String, int, long, long, long[] - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = NbdStartJNI(paths, extents, params, key, capacity, cacheSize, name, address, port,
+					readahead, overlayLimit, handle);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("String[], long[], int[], byte[], long, long, String, String, int, long, long, long[] - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
+	@Override
+	public void nbdStop(final long handle) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long - start"); //$NON-NLS-1$
+		}
+
+		if (isExtendedLibrary()) {
+			NbdStopJNI(handle);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long - end"); //$NON-NLS-1$
+		}
+	}
+
 	@Override
 	public long open(final Connection connHandle, final String path, final int flags, final DiskHandle handle) {
 		if (logger.isLoggable(Level.CONFIG)) {
@@ -588,16 +939,19 @@ public class JDisk extends jDiskLibImpl {
 	}
 
 	@Override
-	public void perturbEnable(final String fName, final int enable) {
+	public long perturbEnable(final String fName, final int enable) {
 		if (logger.isLoggable(Level.CONFIG)) {
 			logger.config("String, int - start"); //$NON-NLS-1$
 		}
 
-		PerturbEnableJNI(fName, enable);
-
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = PerturbEnableJNI(fName, enable);
+		}
 		if (logger.isLoggable(Level.CONFIG)) {
 			logger.config("String, int - end"); //$NON-NLS-1$
 		}
+		return returnlong;
 	}
 
 	@Override
@@ -613,6 +967,85 @@ public class JDisk extends jDiskLibImpl {
 		return returnlong;
 	}
 
+	@Override
+	public long probeTransportModes(final ConnectParams connectParams, final String snapshotRef,
+			final String transportModes, final String diskPath, final String cacheKey, final int probeSectors,
+			final int cacheSeconds, final String[] result) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("ConnectParams, String, String, String, String, int, int, String[] - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = ProbeTransportJNI(connectParams, snapshotRef, transportModes, diskPath, cacheKey,
+					probeSectors, cacheSeconds, result);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("ConnectParams, String, String, String, String, int, int, String[] - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
+	@Override
+	public void progressCancel(final long handle) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long - start"); //$NON-NLS-1$
+		}
+
+		if (isExtendedLibrary()) {
+			ProgressCancelJNI(handle);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long - end"); //$NON-NLS-1$
+		}
+	}
+
+	@Override
+	public void progressClose(final long handle) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long - start"); //$NON-NLS-1$
+		}
+
+		if (isExtendedLibrary()) {
+			ProgressCloseJNI(handle);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long - end"); //$NON-NLS-1$
+		}
+	}
+
+	@Override
+	public long progressGetStats(final long handle, final long[] stats) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long, long[] - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = ProgressGetStatsJNI(handle, stats);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long, long[] - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
+	@Override
+	public long progressOpen(final int intervalMs, final long[] handle) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("int, long[] - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = ProgressOpenJNI(intervalMs, handle);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("int, long[] - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
 	@Override
 	public long queryAllocatedBlocks(final DiskHandle diskHandle, final long startSector, final long numSectors,
 			final long chunkSize, final List<Block> blockList) {
@@ -668,6 +1101,31 @@ public class JDisk extends jDiskLibImpl {
 		return returnlong;
 	}
 
+	@Override
+	public long readAllMetadata(final DiskHandle diskHandle, final Map<String, String> metadata) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("DiskHandle, Map<String, String> - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_OK;
+		if (isExtendedLibrary()) {
+			returnlong = ReadAllMetadataJNI(getDiskHandle(diskHandle), metadata);
+		} else {
+			for (final String key : GetMetadataKeysJNI(getDiskHandle(diskHandle))) {
+				final StringBuffer value = new StringBuffer();
+				returnlong = ReadMetadataJNI(getDiskHandle(diskHandle), key, value);
+				if (returnlong != jDiskLibConst.VIX_OK) {
+					break;
+				}
+				metadata.put(key, value.toString());
+			}
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("DiskHandle, Map<String, String> - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
 	@Override
 	public long readAsync(final DiskHandle diskHandle, final long startSector, final ByteBuffer buffer,
 			final int sectorCount, final AsyncIOListener callbackObj) {
@@ -695,6 +1153,22 @@ public class JDisk extends jDiskLibImpl {
 		return returnlong;
 	}
 
+	@Override
+	public long registerIoJob(final long jobId, final int ioClass, final long deadlineMillis) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long, int, long - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = RegisterIoJobJNI(jobId, ioClass, deadlineMillis);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long, int, long - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
 	@Override
 	public long rename(final String src, final String dst) {
 		if (logger.isLoggable(Level.CONFIG)) {
@@ -708,6 +1182,125 @@ public class JDisk extends jDiskLibImpl {
 		return returnlong;
 	}
 
+	@Override
+	public long scheduledRead(final long jobId, final DiskHandle diskHandle, final long startSector,
+			final long numSectors, final byte[] buffer) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long, DiskHandle, long, long, byte[] - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = ScheduledReadJNI(jobId, getDiskHandle(diskHandle), startSector, numSectors, buffer);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long, DiskHandle, long, long, byte[] - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
+	@Override
+	public long scheduledReadAsync(final long jobId, final DiskHandle diskHandle, final long startSector,
+			final ByteBuffer buffer, final int sectorCount, final AsyncIOListener callbackObj) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long, DiskHandle, long, ByteBuffer, int, AsyncIOListener - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = ScheduledAsyncJNI(jobId, getDiskHandle(diskHandle), false, startSector, buffer, sectorCount,
+					callbackObj);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long, DiskHandle, long, ByteBuffer, int, AsyncIOListener - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
+	@Override
+	public long scheduledWrite(final long jobId, final DiskHandle diskHandle, final long startSector,
+			final long numSectors, final byte[] buffer) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long, DiskHandle, long, long, byte[] - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = ScheduledWriteJNI(jobId, getDiskHandle(diskHandle), startSector, numSectors, buffer);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long, DiskHandle, long, long, byte[] - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
+	@Override
+	public long scheduledWriteAsync(final long jobId, final DiskHandle diskHandle, final long startSector,
+			final ByteBuffer buffer, final int sectorCount, final AsyncIOListener callbackObj) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long, DiskHandle, long, ByteBuffer, int, AsyncIOListener - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = ScheduledAsyncJNI(jobId, getDiskHandle(diskHandle), true, startSector, buffer, sectorCount,
+					callbackObj);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long, DiskHandle, long, ByteBuffer, int, AsyncIOListener - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
+	@Override
+	public long scrub(final String[] paths, final int[] blocks, final byte[] digests, final byte[] key,
+			final int threads, final boolean shallow, final int[] status, final long[] stats) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("String[], int[], byte[], byte[], int, boolean, int[], long[] - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = ScrubJNI(paths, blocks, digests, key, threads, shallow, status, stats);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("String[], int[], byte[], byte[], int, boolean, int[], long[] - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
+	@Override
+	public long setAsyncQueueBounds(final DiskHandle diskHandle, final int minDepth, final int maxDepth) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("DiskHandle, int, int - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = SetAsyncQueueBoundsJNI(getDiskHandle(diskHandle), minDepth, maxDepth);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("DiskHandle, int, int - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
+	@Override
+	public long setConnectionCache(final int idleSeconds, final int maxAgeSeconds, final int maxIdleHandles) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("int, int, int - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = SetConnectionCacheJNI(idleSeconds, maxAgeSeconds, maxIdleHandles);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("int, int, int - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
 	@Override
 	public long setInjectedFault(final FaultInjectionType id, final int enabled, final int faultErr) {
 		if (logger.isLoggable(Level.CONFIG)) {
@@ -721,6 +1314,55 @@ public class JDisk extends jDiskLibImpl {
 		return returnlong;
 	}
 
+	@Override
+	public long setIoScheduler(final int policy, final int maxInFlight, final int[] weights) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("int, int, int[] - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = SetIoSchedulerJNI(policy, maxInFlight, weights);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("int, int, int[] - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
+	@Override
+	public long setThrottleLimit(final int scope, final String name, final DiskHandle diskHandle,
+			final long bytesPerSec, final long burstBytes) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("int, String, DiskHandle, long, long - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = SetThrottleLimitJNI(scope, name, getDiskHandle(diskHandle), bytesPerSec, burstBytes);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("int, String, DiskHandle, long, long - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
+	@Override
+	public long setThrottleTags(final DiskHandle diskHandle, final String host, final String datastore) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("DiskHandle, String, String - start"); //$NON-NLS-1$
+		}
+
+		long returnlong = jDiskLibConst.VIX_E_NOT_SUPPORTED;
+		if (isExtendedLibrary()) {
+			returnlong = SetThrottleTagsJNI(getDiskHandle(diskHandle), host, datastore);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("DiskHandle, String, String - end"); //$NON-NLS-1$
+		}
+		return returnlong;
+	}
+
 	@Override
 	public long shrink(final DiskHandle diskHandle, final Progress progress) {
 		if (logger.isLoggable(Level.CONFIG)) {
@@ -773,6 +1415,20 @@ public class JDisk extends jDiskLibImpl {
 		return returnlong;
 	}
 
+	@Override
+	public void unregisterIoJob(final long jobId) {
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long - start"); //$NON-NLS-1$
+		}
+
+		if (isExtendedLibrary()) {
+			UnregisterIoJobJNI(jobId);
+		}
+		if (logger.isLoggable(Level.CONFIG)) {
+			logger.config("long - end"); //$NON-NLS-1$
+		}
+	}
+
 	@Override
 	public long wait(final DiskHandle diskHandle) {
 		if (logger.isLoggable(Level.CONFIG)) {
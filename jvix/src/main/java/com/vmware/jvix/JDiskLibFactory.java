@@ -63,6 +63,8 @@ public final class JDiskLibFactory {
 
 	private static boolean debug;
 
+	private static boolean mountLibraryLoaded;
+
 	private static final int MAJOR_VERSION_7 = 7;
 	private static final int MAJOR_VERSION_6 = 6;
 	private static final int MINOR_VERSION_7 = 7;
@@ -189,6 +191,25 @@ public final class JDiskLibFactory {
 		return debug;
 	}
 
+	/**
+	 * Load the vixMntapi bindings. On Linux they are a library of their own,
+	 * libjMntApi.so, next to libjDiskLib.so: libvixMntapi and its dependencies
+	 * are then only loaded by the jobs mounting a disk
+	 *
+	 * @throws UnsatisfiedLinkError if the library cannot be loaded
+	 */
+	static synchronized void loadMountLibrary() {
+		if (!JDiskLibFactory.mountLibraryLoaded && GuestOsUtils.isUnix()) {
+			if (JDiskLibFactory.libDir == null) {
+				throw new UnsatisfiedLinkError("libjMntApi.so: jDiskLib not loaded");
+			}
+			final Path mountLib = FileSystems.getDefault().getPath(JDiskLibFactory.libDir, "libjMntApi.so");
+			JDiskLibFactory.logger.log(Level.INFO, () -> "Loading ".concat(mountLib.toString()));
+			System.load(mountLib.toString());
+		}
+		JDiskLibFactory.mountLibraryLoaded = true;
+	}
+
 	/**
 	 * When packaged into JAR extracts DLLs, places these into
 	 *
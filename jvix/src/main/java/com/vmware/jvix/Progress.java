@@ -32,6 +32,20 @@ package com.vmware.jvix;
  * issued the call to be aborted.
  */
 public class Progress {
+	/*
+	 * Native progress channel of the operations given this object, 0 for none.
+	 * See jDiskLib.progressOpen.
+	 */
+	private long channel;
+
+	public long getChannel() {
+		return this.channel;
+	}
+
+	public void setChannel(final long channel) {
+		this.channel = channel;
+	}
+
 	public boolean Update(final int percentDone) {
 		System.out.print("Progress: ");
 		System.out.print(percentDone);
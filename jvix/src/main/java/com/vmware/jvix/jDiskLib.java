@@ -11,6 +11,7 @@ package com.vmware.jvix;
 
 import java.nio.ByteBuffer;
 import java.util.List;
+import java.util.Map;
 
 /*
  * Interface into vixDiskLib for Java programmers
@@ -386,6 +387,20 @@ public interface jDiskLib {
         public int sectors;
     }
 
+    /*
+     * Entry of a guest filesystem read from archived blocks
+     */
+    public static class GuestFsEntry {
+        public String name;
+        public long inode;
+        public int type;
+        public int mode;
+        public int uid;
+        public int gid;
+        public long size;
+        public long mtime;
+    }
+
     /*
      * VixDiskLib's DiskInfo structure
      */
@@ -409,6 +424,23 @@ public interface jDiskLib {
 
     long attach(DiskHandle parent, DiskHandle child);
 
+    /*
+     * Hand the read-only connections made afterwards to the jdiskd daemon
+     * listening at socketPath, the data moving through slots shared memory
+     * slots of slotSize bytes (0 for the defaults).
+     */
+    long attachDaemon(String socketPath, int slots, int slotSize);
+
+    /*
+     * Build the file catalog of the ext2/3/4 filesystem of an open disk,
+     * reading only its metadata through a cache of cacheSize bytes (0 for the
+     * default). partition -1 selects the first supported filesystem. On VIX_OK
+     * catalog[0] holds the catalog and stats is indexed by CATALOG_STAT_*.
+     * Returns VIX_E_NOT_SUPPORTED if the library does not support it or if
+     * there is no supported filesystem.
+     */
+    long buildCatalog(DiskHandle diskHandle, int partition, long cacheSize, byte[][] catalog, long[] stats);
+
     long checkRepair(Connection connHandle, String path, boolean repair);
 
     /*
@@ -429,12 +461,33 @@ public interface jDiskLib {
     long connectEx(ConnectParams connectParams, boolean readOnly, String snapshotRef, String transportModes,
             Connection connHandle);
 
+    /*
+     * Copy the sectors [startSector, endSector) of src to the same sectors of
+     * dst, endSector 0 meaning the capacity of src, with up to depth reads and
+     * writes of chunkSectors sectors in flight (0 for the defaults). With
+     * allocatedOnly only the allocated extents of src are copied. stats is
+     * indexed by COPY_STAT_*; after a failure or a cancel from progress,
+     * stats[COPY_STAT_RESUME_SECTOR] is the sector to restart the copy from.
+     * Returns VIX_E_NOT_SUPPORTED if the library does not support it.
+     */
+    long copyDisk(DiskHandle src, DiskHandle dst, long startSector, long endSector, int chunkSectors, int depth,
+            boolean allocatedOnly, Progress progress, long[] stats);
+
+    /*
+     * CRC32C of each CRC32C_CHUNK_SIZE chunk of length bytes of buf. Returns the
+     * number of entries written to map, CRC32C_MAP_FAILED if the library does not
+     * support it.
+     */
+    int crc32cMap(byte[] buf, int offset, int length, int[] map);
+
     long create(Connection connHandle, String path, CreateParams createParams, Progress progress);
 
     long createChild(DiskHandle diskHandle, String childPath, int diskType, Progress progress);
 
     long defragment(DiskHandle diskHandle, Progress progress);
 
+    void detachDaemon();
+
     long disconnect(Connection connHandle);
 
     long endAccess(ConnectParams connectParams, String identity);
@@ -444,6 +497,13 @@ public interface jDiskLib {
      */
     long errorCode(long err);
 
+    /*
+     * Order-0 entropy of length bytes of buf, estimated from at most sampleSize
+     * bytes (0 for the default), in thousandths of a bit per byte. -1 if the
+     * library does not support it.
+     */
+    int estimateEntropy(byte[] buf, int offset, int length, int sampleSize);
+
     void exit();
 
     boolean failed(long err);
@@ -452,8 +512,20 @@ public interface jDiskLib {
 
     void freeBuffer(ByteBuffer buffer);
 
+    long getAsyncQueueStats(DiskHandle diskHandle, long[] stats);
+
+    /*
+     * Statistics of the connection cache, indexed by CONNCACHE_STAT_*.
+     */
+    long getConnectionCacheStats(long[] stats);
+
     long getConnectParams(Connection connHandle, ConnectParams connectParams);
 
+    /*
+     * Statistics of the jdiskd client and daemon, indexed by DAEMON_STAT_*.
+     */
+    long getDaemonStats(long[] stats);
+
     long getConnHandle(final Connection connHandle);
 
     long getDiskHandle(final DiskHandle diskHandle);
@@ -466,8 +538,49 @@ public interface jDiskLib {
 
     String getTransportMode(DiskHandle diskHandle);
 
+    /*
+     * VDDK_CAP_* mask of what the VixDiskLib loaded provides natively, the rest
+     * being emulated by the library. 0 if the library does not tell.
+     */
+    int getVddkCapabilities();
+
     long grow(Connection connHandle, String path, long capacityInSectors, boolean updateGeometry, Progress progress);
 
+    void guestFsClose(long handle);
+
+    /*
+     * List the directory inode of a guest filesystem, "." and ".." excluded.
+     */
+    long guestFsList(long handle, long inode, List<GuestFsEntry> entries);
+
+    /*
+     * Resolve an absolute path of a guest filesystem, without following
+     * symbolic links. Returns VIX_E_FILE_NOT_FOUND or VIX_E_NOT_A_DIRECTORY if
+     * the path does not resolve.
+     */
+    long guestFsLookup(long handle, String path, GuestFsEntry entry);
+
+    /*
+     * Open the ext2/3/4 filesystem of a disk generation straight from its
+     * archived blocks. Extent i covers extents[6i..6i+5] (GUESTFS_EXTENT_*, in
+     * bytes) of the disk and is stored in paths[i] with params[2i..2i+1]
+     * (GUESTFS_* flags, cipher offset); the bytes not covered read as zeros.
+     * key is the raw AES key or null. partition -1 selects the first supported
+     * filesystem. Up to cacheSize bytes of decoded blocks are cached (0 for the
+     * default). The handle in handle[0] must be released with guestFsClose.
+     * Returns VIX_E_NOT_SUPPORTED if the library does not support it or if
+     * there is no supported filesystem.
+     */
+    long guestFsOpen(String[] paths, long[] extents, int[] params, byte[] key, long capacity, int partition,
+            long cacheSize, long[] handle);
+
+    /*
+     * Read up to length bytes of a file at offset into buf; for a symbolic link
+     * the data is its target. Returns the bytes read, 0 at the end of the file,
+     * -1 on error.
+     */
+    long guestFsRead(long handle, long inode, long offset, byte[] buf, int length);
+
     long init(int majorVersion, int minorVersion, JVixLogger jvixLogger, String libDir);
 
     long init(JVixLogger jvixLogger);
@@ -478,14 +591,94 @@ public interface jDiskLib {
 
     long isAttachPossible(DiskHandle parent, DiskHandle child);
 
+    boolean isExtendedLibrary();
+
     String listTransportModes();
 
+    /*
+     * Decode the first srcLength bytes of src, a MiGz stream, into dst with up to
+     * threads native threads. Returns the decoded size, MIGZ_DECODE_FAILED if
+     * the stream is corrupt, does not fit or the library does not support it.
+     */
+    int miGzDecode(byte[] src, int srcLength, byte[] dst, int threads);
+
+    /*
+     * SHA-1 (HASH_SHA1) or MD5 (HASH_MD5) of length bytes of buf, computed in the
+     * lanes of the native multi-buffer engine together with the blocks of other
+     * threads. Returns VIX_E_NOT_SUPPORTED if the library or the CPU does not
+     * support it.
+     */
+    long multiBufferHash(int algorithm, byte[] buf, int offset, int length, byte[] digest);
+
+    /*
+     * Statistics of an NBD server, indexed by NBD_STAT_*.
+     */
+    long nbdGetStats(long handle, long[] stats);
+
+    /*
+     * Serve a disk generation over NBD (fixed newstyle) straight from its
+     * archived blocks, described as for guestFsOpen, under the export name.
+     * address is the path of a unix socket, or null to listen on 127.0.0.1 at
+     * port (0 for any free port). Sequential reads are followed by a readahead
+     * of readahead bytes (0 for the default, -1 for none). Writes go to a
+     * memory overlay of up to overlayLimit bytes, discarded by nbdStop; 0
+     * exports read-only. handle[0] is the server, handle[1] the TCP port.
+     * Returns VIX_E_NOT_SUPPORTED if the library does not support it.
+     */
+    long nbdStart(String[] paths, long[] extents, int[] params, byte[] key, long capacity, long cacheSize,
+            String name, String address, int port, long readahead, long overlayLimit, long[] handle);
+
+    void nbdStop(long handle);
+
     long open(Connection connHandle, String path, int flags, DiskHandle handle);
 
-    void perturbEnable(String fName, int enable);
+    /*
+     * Returns VIX_E_NOT_SUPPORTED if the VixDiskLib loaded does not export
+     * Perturb_Enable.
+     */
+    long perturbEnable(String fName, int enable);
 
     long prepareForAccess(ConnectParams connectParams, String identity);
 
+    /*
+     * Read a few chunks of the disk diskPath through each mode of
+     * transportModes (null for all), each on a connection of its own, and
+     * order the modes that work by the rate measured. result[0] receives the
+     * modes to connect with, fastest first, and result[1] the rate or error
+     * of each mode. The result is kept cacheSeconds for the same cacheKey,
+     * datastore and modes. Returns VIX_E_NOT_SUPPORTED if the library does
+     * not support it.
+     */
+    long probeTransportModes(ConnectParams connectParams, String snapshotRef, String transportModes, String diskPath,
+            String cacheKey, int probeSectors, int cacheSeconds, String[] result);
+
+    /*
+     * Make the create, clone, grow, shrink and defragment operations of the
+     * progress channel abort at their next progress tick, without waiting for
+     * a call to Progress.Update.
+     */
+    void progressCancel(long handle);
+
+    /*
+     * Free a progress channel once the operations using it returned.
+     */
+    void progressClose(long handle);
+
+    /*
+     * State of a progress channel, indexed by PROGRESS_STAT_*. Cheap enough to
+     * be polled by a monitoring thread.
+     */
+    long progressGetStats(long handle, long[] stats);
+
+    /*
+     * Create a progress channel: an operation given a Progress whose channel
+     * is set to handle[0] publishes its percentage there and calls
+     * Progress.Update at most once every intervalMs (0 for a second), and at
+     * its end. Returns VIX_E_NOT_SUPPORTED if the library does not support
+     * it.
+     */
+    long progressOpen(int intervalMs, long[] handle);
+
     long queryAllocatedBlocks(DiskHandle diskHandle, long startSector, long numSectors, long chunkSize,
             List<Block> blockList);
 
@@ -496,15 +689,81 @@ public interface jDiskLib {
 
     long read(DiskHandle diskHandle, long startSector, long numSectors, ByteBuffer buffer);
 
+    /*
+     * Put every metadata key of the disk with its value in metadata. The
+     * extended library reads them in one native pass and caches them until
+     * the handle is closed or its metadata written.
+     */
+    long readAllMetadata(DiskHandle diskHandle, Map<String, String> metadata);
+
     long readAsync(DiskHandle diskHandle, long startSector, ByteBuffer buffer, int sectorCount,
             AsyncIOListener callbackObj);
 
     long readMetadata(DiskHandle diskHandle, String key, StringBuffer val);
 
+    /*
+     * Declare a job of the I/O scheduler: ioClass is one of
+     * jDiskLibConst.IO_CLASS_*, deadlineMillis is relative to now (0 for
+     * none).
+     */
+    long registerIoJob(long jobId, int ioClass, long deadlineMillis);
+
     long rename(String src, String dst);
 
+    long scheduledRead(long jobId, DiskHandle diskHandle, long startSector, long numSectors, byte[] buffer);
+
+    long scheduledReadAsync(long jobId, DiskHandle diskHandle, long startSector, ByteBuffer buffer, int sectorCount,
+            AsyncIOListener callbackObj);
+
+    long scheduledWrite(long jobId, DiskHandle diskHandle, long startSector, long numSectors, byte[] buffer);
+
+    long scheduledWriteAsync(long jobId, DiskHandle diskHandle, long startSector, ByteBuffer buffer, int sectorCount,
+            AsyncIOListener callbackObj);
+
+    /*
+     * Verify the data files of paths.length blocks of a file target. Block i is
+     * described by blocks[3i..3i+2] (SCRUB_* flags, cipher offset, plain size)
+     * and by digests[SCRUB_DIGESTS_SIZE * i...] (MD5 of the stored data then
+     * SHA-1 of the plain block); key is the raw AES key or null. On VIX_OK
+     * status[i] is a SCRUB_STATUS_* value and stats is indexed by SCRUB_STAT_*.
+     * Returns VIX_E_NOT_SUPPORTED if the library or the CPU does not support it.
+     */
+    long scrub(String[] paths, int[] blocks, byte[] digests, byte[] key, int threads, boolean shallow, int[] status,
+            long[] stats);
+
+    /*
+     * Bounds of the adaptive async read queue depth. A null diskHandle sets
+     * the defaults for the disks opened afterwards. Only readAsync goes
+     * through the queue: the dump and restore paths read synchronously.
+     */
+    long setAsyncQueueBounds(DiskHandle diskHandle, int minDepth, int maxDepth);
+
+    /*
+     * Share the connections with the same parameters and keep them
+     * idleSeconds once released (0 disables the cache), up to maxAgeSeconds
+     * old (0 for no limit). Up to maxIdleHandles read-only disk handles are
+     * kept open for the next open of the same disk on the same connection.
+     */
+    long setConnectionCache(int idleSeconds, int maxAgeSeconds, int maxIdleHandles);
+
     long setInjectedFault(FaultInjectionType id, int enabled, int faultError);
 
+    /*
+     * I/O scheduler policy (jDiskLibConst.IO_POLICY_*), maximum number of
+     * requests dispatched at once and weights per class (null for defaults).
+     */
+    long setIoScheduler(int policy, int maxInFlight, int[] weights);
+
+    /*
+     * Bandwidth limit of a throttling bucket, applied to running I/O. A null
+     * name (host and datastore scopes) or diskHandle (disk scope) sets the
+     * default of the scope. bytesPerSec 0 removes the limit, burstBytes 0
+     * selects the default burst.
+     */
+    long setThrottleLimit(int scope, String name, DiskHandle diskHandle, long bytesPerSec, long burstBytes);
+
+    long setThrottleTags(DiskHandle diskHandle, String host, String datastore);
+
     long shrink(DiskHandle diskHandle, Progress progress);
 
     long spaceNeededForClone(DiskHandle diskHandle, int diskType, long[] spaceNeeded);
@@ -513,6 +772,8 @@ public interface jDiskLib {
 
     long unlink(Connection connHandle, String path);
 
+    void unregisterIoJob(long jobId);
+
     long wait(DiskHandle diskHandle);
 
     @Deprecated
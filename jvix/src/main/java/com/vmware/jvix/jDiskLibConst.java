@@ -340,4 +340,180 @@ public interface jDiskLibConst {
 	 */
 	int SECTOR_SIZE = 512;
 
+	/*
+	 * Adaptive async queue depth (Linux VDDK 7.0 only)
+	 */
+	int ASYNC_QUEUE_DEFAULT_MIN_DEPTH = 1;
+	int ASYNC_QUEUE_DEFAULT_MAX_DEPTH = 32;
+
+	// Layout of the array filled by getAsyncQueueStats
+	int ASYNC_QUEUE_STAT_WINDOW = 0;
+	int ASYNC_QUEUE_STAT_IN_FLIGHT = 1;
+	int ASYNC_QUEUE_STAT_LATENCY_US = 2;
+	int ASYNC_QUEUE_STAT_MIN_LATENCY_US = 3;
+	int ASYNC_QUEUE_STAT_BYTES_PER_SEC = 4;
+	int ASYNC_QUEUE_STAT_COMPLETED = 5;
+	int ASYNC_QUEUE_STAT_ERRORS = 6;
+	int ASYNC_QUEUE_STAT_COUNT = 7;
+
+	/*
+	 * Bandwidth throttling scopes (Linux VDDK 7.0 only)
+	 */
+	int THROTTLE_SCOPE_GLOBAL = 0;
+	int THROTTLE_SCOPE_HOST = 1;
+	int THROTTLE_SCOPE_DATASTORE = 2;
+	int THROTTLE_SCOPE_DISK = 3;
+
+	/*
+	 * I/O scheduler classes and policies (Linux VDDK 7.0 only)
+	 */
+	int IO_CLASS_INTERACTIVE = 0;
+	int IO_CLASS_NORMAL = 1;
+	int IO_CLASS_BACKGROUND = 2;
+	int IO_CLASS_COUNT = 3;
+
+	int IO_POLICY_WEIGHTED = 0;
+	int IO_POLICY_STRICT = 1;
+	int IO_SCHEDULER_DEFAULT_MAX_IN_FLIGHT = 16;
+
+	/*
+	 * Entropy estimator (Linux VDDK 7.0 only)
+	 */
+	int ENTROPY_NOT_AVAILABLE = -1;
+	int ENTROPY_MAX = 8000;
+
+	/*
+	 * MiGz decoder (Linux VDDK 7.0 only)
+	 */
+	int MIGZ_DECODE_FAILED = -1;
+
+	/*
+	 * CRC32C map (Linux VDDK 7.0 only)
+	 */
+	int CRC32C_CHUNK_SIZE = 4096;
+	int CRC32C_MAP_FAILED = -1;
+
+	/*
+	 * Multi-buffer hash (Linux VDDK 7.0 only)
+	 */
+	int HASH_SHA1 = 0;
+	int HASH_MD5 = 1;
+
+	/*
+	 * Scrub engine (Linux VDDK 7.0 only)
+	 */
+	int SCRUB_CIPHER = 0x1;
+	int SCRUB_COMPRESS = 0x2;
+	int SCRUB_SHA1 = 0x4;
+	int SCRUB_DIGESTS_SIZE = 36;
+	int SCRUB_STATUS_OK = 0;
+	int SCRUB_STATUS_MISSING = 1;
+	int SCRUB_STATUS_READ_ERROR = 2;
+	int SCRUB_STATUS_MD5_MISMATCH = 3;
+	int SCRUB_STATUS_DECODE_ERROR = 4;
+	int SCRUB_STATUS_SHA1_MISMATCH = 5;
+	int SCRUB_STAT_BLOCKS = 0;
+	int SCRUB_STAT_BAD_BLOCKS = 1;
+	int SCRUB_STAT_BYTES_READ = 2;
+	int SCRUB_STAT_BYTES_VERIFIED = 3;
+	int SCRUB_STAT_ELAPSED_US = 4;
+	int SCRUB_STATS_SIZE = 5;
+
+	/*
+	 * Disk to disk copy engine (Linux VDDK 7.0 only)
+	 */
+	int COPY_STAT_BYTES = 0;
+	int COPY_STAT_EXTENTS = 1;
+	int COPY_STAT_RESUME_SECTOR = 2;
+	int COPY_STAT_ELAPSED_US = 3;
+	int COPY_STATS_SIZE = 4;
+
+	/*
+	 * Guest filesystem reader over archived blocks (Linux VDDK 7.0 only)
+	 */
+	int GUESTFS_CIPHER = 0x1;
+	int GUESTFS_COMPRESS = 0x2;
+	int GUESTFS_EXTENT_OFFSET = 0;
+	int GUESTFS_EXTENT_LENGTH = 1;
+	int GUESTFS_EXTENT_FILE_OFFSET = 2;
+	int GUESTFS_EXTENT_STORED_LENGTH = 3;
+	int GUESTFS_EXTENT_PLAIN_SIZE = 4;
+	int GUESTFS_EXTENT_STREAM_OFFSET = 5;
+	int GUESTFS_EXTENT_SIZE = 6;
+	int GUESTFS_PARAMS_SIZE = 2;
+	int GUESTFS_ROOT_INODE = 2;
+	int GUESTFS_TYPE_UNKNOWN = 0;
+	int GUESTFS_TYPE_FILE = 1;
+	int GUESTFS_TYPE_DIRECTORY = 2;
+	int GUESTFS_TYPE_CHAR_DEVICE = 3;
+	int GUESTFS_TYPE_BLOCK_DEVICE = 4;
+	int GUESTFS_TYPE_FIFO = 5;
+	int GUESTFS_TYPE_SOCKET = 6;
+	int GUESTFS_TYPE_SYMLINK = 7;
+
+	/*
+	 * Backup-time file catalog (Linux VDDK 7.0 only)
+	 */
+	int CATALOG_STAT_RECORDS = 0;
+	int CATALOG_STAT_BYTES_READ = 1;
+	int CATALOG_STAT_ELAPSED_US = 2;
+	int CATALOG_STATS_SIZE = 3;
+
+	/*
+	 * NBD server over archived blocks (Linux VDDK 7.0 only)
+	 */
+	int NBD_STAT_CONNECTIONS = 0;
+	int NBD_STAT_READS = 1;
+	int NBD_STAT_BYTES_READ = 2;
+	int NBD_STAT_WRITES = 3;
+	int NBD_STAT_BYTES_WRITTEN = 4;
+	int NBD_STAT_OVERLAY_BYTES = 5;
+	int NBD_STAT_PREFETCHES = 6;
+	int NBD_STATS_SIZE = 7;
+
+	/*
+	 * Connection and disk handle cache (Linux VDDK 7.0 only)
+	 */
+	int CONNCACHE_STAT_CONNECTS = 0;
+	int CONNCACHE_STAT_CONNECT_HITS = 1;
+	int CONNCACHE_STAT_OPENS = 2;
+	int CONNCACHE_STAT_OPEN_HITS = 3;
+	int CONNCACHE_STAT_EXPIRED = 4;
+	int CONNCACHE_STAT_INVALIDATED = 5;
+	int CONNCACHE_STAT_CONNECTIONS = 6;
+	int CONNCACHE_STAT_IDLE_HANDLES = 7;
+	int CONNCACHE_STATS_SIZE = 8;
+
+	/*
+	 * jdiskd daemon (Linux VDDK 7.0 only)
+	 */
+	int DAEMON_STAT_REQUESTS = 0;
+	int DAEMON_STAT_READS = 1;
+	int DAEMON_STAT_BYTES_READ = 2;
+	int DAEMON_STAT_SLOT_WAITS = 3;
+	int DAEMON_STAT_CLIENTS = 4;
+	int DAEMON_STAT_CONNECTS = 5;
+	int DAEMON_STAT_CONNECT_HITS = 6;
+	int DAEMON_STAT_OPEN_DISKS = 7;
+	int DAEMON_STATS_SIZE = 8;
+
+	/*
+	 * VixDiskLib loaded at run time (Linux only)
+	 */
+	int VDDK_CAP_QUERY_ALLOCATED = 0x01;
+	int VDDK_CAP_ASYNC_IO = 0x02;
+	int VDDK_CAP_CONNECT_PARAMS = 0x04;
+	int VDDK_CAP_SECTOR_SIZE = 0x08;
+	int VDDK_CAP_FAULT_INJECTION = 0x10;
+
+	/*
+	 * Native progress channel (Linux only)
+	 */
+	int PROGRESS_STAT_PERCENT = 0;
+	int PROGRESS_STAT_TICKS = 1;
+	int PROGRESS_STAT_UPCALLS = 2;
+	int PROGRESS_STAT_CANCELLED = 3;
+	int PROGRESS_STAT_ACTIVE = 4;
+	int PROGRESS_STATS_SIZE = 5;
+
 }
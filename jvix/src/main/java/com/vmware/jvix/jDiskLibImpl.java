@@ -13,6 +13,7 @@ package com.vmware.jvix;
 
 import java.nio.ByteBuffer;
 import java.util.List;
+import java.util.Map;
 
 /*
  * jDiskLibImpl implements the jDiskLib interface. This allows us to hide all
@@ -38,6 +39,11 @@ abstract class jDiskLibImpl implements jDiskLib, jDiskLibConst {
 
 	protected native long BufferWriteJNI(long diskHandle, long startSector, long numSectors, ByteBuffer buffer);
 
+	protected native long AttachDaemonJNI(String socketPath, int slots, int slotSize);
+
+	protected native long CatalogBuildJNI(long diskHandle, int partition, long cacheSize, byte[][] catalog,
+			long[] stats);
+
 	protected native long CheckRepairJNI(long conn, String path, boolean repair);
 
 	protected native long CleanupJNI(ConnectParams connection, int[] numCleaned, int[] numRemaining);
@@ -52,22 +58,37 @@ abstract class jDiskLibImpl implements jDiskLib, jDiskLibConst {
 
 	protected native long ConnectJNI(ConnectParams connection, long[] connHandle);
 
+	protected native long CopyJNI(long srcHandle, long dstHandle, long startSector, long endSector, int chunkSectors,
+			int depth, boolean allocatedOnly, Progress progress, long[] stats);
+
 	protected native long CreateChildJNI(long diskHandle, String childPath, int diskType, Progress progress);
 
+	protected native int Crc32cMapJNI(byte[] buf, int offset, int length, int[] map);
+
 	protected native long CreateJNI(long connHandle, String path, CreateParams createParams, Progress progress);
 
 	protected native long DefragmentJNI(long diskHandle, Progress progress);
 
+	protected native void DetachDaemonJNI();
+
 	protected native long DisconnectJNI(long connHandle);
 
 	protected native long EndAccessJNI(ConnectParams connection, String identity);
 
+	protected native int EstimateEntropyJNI(byte[] buf, int offset, int length, int sampleSize);
+
 	protected native void ExitJNI();
 
 	protected native long FlushJNI(long diskHandle);
 
 	protected native void FreeBufferJNI(ByteBuffer buffer);
 
+	protected native long GetAsyncQueueStatsJNI(long diskHandle, long[] stats);
+
+	protected native long GetConnectionCacheStatsJNI(long[] stats);
+
+	protected native long GetDaemonStatsJNI(long[] stats);
+
 	protected native long GetConnectParamsJNI(long connHandle, ConnectParams connection);
 
 	protected native String GetErrorTextJNI(long error, String locale);
@@ -78,9 +99,22 @@ abstract class jDiskLibImpl implements jDiskLib, jDiskLibConst {
 
 	protected native String GetTransportModeJNI(long diskHandle);
 
+	protected native int GetVddkCapabilitiesJNI();
+
 	protected native long GrowJNI(long connHandle, String path, long capacityInSectors, boolean updateGeometry,
 			Progress progress);
 
+	protected native void GuestFsCloseJNI(long handle);
+
+	protected native long GuestFsListJNI(long handle, long inode, List<GuestFsEntry> entries);
+
+	protected native long GuestFsLookupJNI(long handle, String path, GuestFsEntry entry);
+
+	protected native long GuestFsOpenJNI(String[] paths, long[] extents, int[] params, byte[] key, long capacity,
+			int partition, long cacheSize, long[] handle);
+
+	protected native long GuestFsReadJNI(long handle, long inode, long offset, byte[] buf, int length);
+
 	protected native long InitExJNI(int majorVersion, int minorVersion, JVixLogger logger, String libDir,
 			String configFile);
 
@@ -90,15 +124,39 @@ abstract class jDiskLibImpl implements jDiskLib, jDiskLibConst {
 
 	protected native String ListTransportModesJNI();
 
+	protected native int MiGzDecodeJNI(byte[] src, int srcLength, byte[] dst, int threads);
+
+	protected native long MultiBufferHashJNI(int algorithm, byte[] buf, int offset, int length, byte[] digest);
+
+	protected native long NbdGetStatsJNI(long handle, long[] stats);
+
+	protected native long NbdStartJNI(String[] paths, long[] extents, int[] params, byte[] key, long capacity,
+			long cacheSize, String name, String address, int port, long readahead, long overlayLimit, long[] handle);
+
+	protected native void NbdStopJNI(long handle);
+
 	protected native long OpenJNI(long connHandle, String path, int flags, long[] diskHandle);
 
-	protected native void PerturbEnableJNI(String fName, int enable);
+	protected native long PerturbEnableJNI(String fName, int enable);
 
 	protected native long PrepareForAccessJNI(ConnectParams connection, String identity);
 
+	protected native long ProbeTransportJNI(ConnectParams connection, String snapshotRef, String transportModes,
+			String diskPath, String cacheKey, int probeSectors, int cacheSeconds, String[] result);
+
+	protected native void ProgressCancelJNI(long handle);
+
+	protected native void ProgressCloseJNI(long handle);
+
+	protected native long ProgressGetStatsJNI(long handle, long[] stats);
+
+	protected native long ProgressOpenJNI(int intervalMs, long[] handle);
+
 	protected native long QueryAllocatedBlocksJNI(long diskHandle, long startSector, long numSectors, long chunkSize,
 			List<Block> blockList);
 
+	protected native long ReadAllMetadataJNI(long diskHandle, Map<String, String> metadata);
+
 	protected native long ReadAsyncJNI(long diskHandle, long startSector, ByteBuffer buffer, int sectorCount,
 			Object callbackObj);
 
@@ -106,16 +164,43 @@ abstract class jDiskLibImpl implements jDiskLib, jDiskLibConst {
 
 	protected native long ReadMetadataJNI(long diskHandle, String key, StringBuffer val);
 
+	protected native long RegisterIoJobJNI(long jobId, int ioClass, long deadlineMillis);
+
 	protected native long RenameJNI(String src, String dst);
 
+	protected native long ScheduledAsyncJNI(long jobId, long diskHandle, boolean write, long startSector,
+			ByteBuffer buffer, int sectorCount, AsyncIOListener callbackObj);
+
+	protected native long ScheduledReadJNI(long jobId, long diskHandle, long startSector, long numSectors,
+			byte[] buffer);
+
+	protected native long ScheduledWriteJNI(long jobId, long diskHandle, long startSector, long numSectors,
+			byte[] buffer);
+
+	protected native long ScrubJNI(String[] paths, int[] blocks, byte[] digests, byte[] key, int threads,
+			boolean shallow, int[] status, long[] stats);
+
+	protected native long SetAsyncQueueBoundsJNI(long diskHandle, int minDepth, int maxDepth);
+
 	protected native long SetInjectedFaultJNI(int id, int enabled, int faultError);
 
+	protected native long SetConnectionCacheJNI(int idleSeconds, int maxAgeSeconds, int maxIdleHandles);
+
+	protected native long SetIoSchedulerJNI(int policy, int maxInFlight, int[] weights);
+
+	protected native long SetThrottleLimitJNI(int scope, String name, long diskHandle, long bytesPerSec,
+			long burstBytes);
+
+	protected native long SetThrottleTagsJNI(long diskHandle, String host, String datastore);
+
 	protected native long ShrinkJNI(long diskHandle, Progress progress);
 
 	protected native long SpaceNeededForCloneJNI(long diskHandle, int diskType, long[] spaceNeeded);
 
 	protected native long UnlinkJNI(long connHandle, String path);
 
+	protected native void UnregisterIoJobJNI(long jobId);
+
 	protected native long WaitJNI(long diskHandle);
 
 	protected native long WriteAsyncJNI(long diskHandle, long startSector, ByteBuffer buffer, int sectorCount,
@@ -36,6 +36,10 @@ import com.vmware.jvix.jDiskLib.DiskHandle;
 
 class jMntApiImpl implements jMntApi {
 
+	static {
+		JDiskLibFactory.loadMountLibrary();
+	}
+
 	/*
 	 *
 	 * accessor functions for VixMntApi functionality.
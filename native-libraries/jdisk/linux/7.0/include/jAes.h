@@ -0,0 +1,41 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jAes.h
+ *
+ *    AES-128 ECB decryption with AES-NI, the mode used for encrypted
+ *    blocks of the archive.
+ */
+
+#ifndef _JAES_H_
+#define _JAES_H_
+
+#include <stddef.h>
+#include "vixDiskLib.h"
+
+#define JAES_KEY_SIZE 16
+#define JAES_BLOCK_SIZE 16
+
+typedef struct JAesKey {
+   uint8 rounds[11][JAES_BLOCK_SIZE];   /* Decryption round keys */
+} JAesKey;
+
+/*
+ * TRUE if the CPU has the AES instructions.
+ */
+Bool JAes_IsSupported(void);
+
+/*
+ * Expand a 128-bit key into its decryption schedule. FALSE if the CPU is
+ * not supported.
+ */
+Bool JAes_SetDecryptKey(JAesKey *key, const uint8 *raw);
+
+/*
+ * Decrypt "length" bytes in place, a multiple of JAES_BLOCK_SIZE.
+ */
+void JAes_DecryptEcb(const JAesKey *key, uint8 *buf, size_t length);
+
+#endif // _JAES_H_
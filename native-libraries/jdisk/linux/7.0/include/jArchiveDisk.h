@@ -0,0 +1,74 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jArchiveDisk.h
+ *
+ *    Read-only block device over the archived blocks of a disk generation.
+ */
+
+#ifndef _JARCHIVEDISK_H_
+#define _JARCHIVEDISK_H_
+
+#include <stddef.h>
+#include "vixDiskLib.h"
+
+/*
+ * Flags of an extent.
+ */
+#define JARCHIVE_CIPHER   0x1   /* Stored AES-128 ECB encrypted */
+#define JARCHIVE_COMPRESS 0x2   /* Stored as a MiGz stream */
+
+#define JARCHIVE_DEFAULT_CACHE_SIZE (64 * 1024 * 1024)
+
+typedef struct JArchiveExtent {
+   int64 offset;           /* First byte of the extent on the disk */
+   int64 length;           /* Bytes of the extent */
+   const char *path;       /* Data file or packfile of the archived block */
+   int64 fileOffset;       /* Offset of the stored block in the file */
+   int64 storedLength;     /* Stored size, 0 for the whole file */
+   int flags;              /* JARCHIVE_* */
+   int cipherOffset;       /* Padding added by encryption */
+   int64 plainSize;        /* Size of the archived block once decoded */
+   int64 streamOffset;     /* Offset of the extent in the decoded block */
+} JArchiveExtent;
+
+typedef struct JArchiveDisk JArchiveDisk;
+
+/*
+ * Open a disk of "capacity" bytes made of "count" extents sorted by offset
+ * and not overlapping; the bytes not covered by an extent read as zeros.
+ * The extents and their paths are copied. "key" is the raw AES key (16
+ * bytes), NULL if no extent is encrypted. Up to "cacheSize" bytes of
+ * decoded blocks are kept, least recently used first out.
+ *
+ * Returns NULL if out of memory, or if a key is given and the CPU does
+ * not support AES.
+ */
+JArchiveDisk *JArchiveDisk_Open(const JArchiveExtent *extents, int count,
+                                const uint8 *key, int64 capacity,
+                                size_t cacheSize);
+
+int64 JArchiveDisk_GetCapacity(const JArchiveDisk *disk);
+
+/*
+ * Read "length" bytes at "offset", fetching and decoding the archived
+ * blocks needed. Safe to call from several threads: a block is decoded
+ * without holding the lock of the cache, once, the other readers of the
+ * block waiting for it. Returns FALSE if a block cannot be read or
+ * decoded, or if the range is past the capacity.
+ */
+Bool JArchiveDisk_Read(JArchiveDisk *disk, int64 offset, size_t length,
+                       uint8 *buf);
+
+/*
+ * Load into the cache the archived blocks under "length" bytes at "offset",
+ * for a read expected soon, skipping the blocks already cached or being
+ * decoded. Returns FALSE if a block cannot be read or decoded.
+ */
+Bool JArchiveDisk_Prefetch(JArchiveDisk *disk, int64 offset, int64 length);
+
+void JArchiveDisk_Close(JArchiveDisk *disk);
+
+#endif // _JARCHIVEDISK_H_
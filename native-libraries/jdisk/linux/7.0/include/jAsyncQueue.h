@@ -0,0 +1,64 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jAsyncQueue.h
+ *
+ *    Adaptive queue-depth controller for VixDiskLib async I/O.
+ */
+
+#ifndef _JASYNCQUEUE_H_
+#define _JASYNCQUEUE_H_
+
+#include "vixDiskLib.h"
+
+/*
+ * Default bounds of the in-flight window. They can be changed at runtime
+ * for all disk handles (JAsyncQueue_SetDefaultBounds) or for a single
+ * disk handle (JAsyncQueue_SetBounds).
+ */
+#define JASYNCQUEUE_DEFAULT_MIN_DEPTH 1
+#define JASYNCQUEUE_DEFAULT_MAX_DEPTH 32
+
+/*
+ * Layout of the statistics array returned by JAsyncQueue_GetStats.
+ */
+typedef enum {
+   JAsyncQueueStatWindow = 0,       /* Current in-flight window */
+   JAsyncQueueStatInFlight = 1,     /* Requests currently in flight */
+   JAsyncQueueStatLatencyUs = 2,    /* Smoothed completion latency */
+   JAsyncQueueStatMinLatencyUs = 3, /* Baseline (minimum) latency */
+   JAsyncQueueStatBytesPerSec = 4,  /* Throughput of the last interval */
+   JAsyncQueueStatCompleted = 5,    /* Completed requests */
+   JAsyncQueueStatErrors = 6,       /* Failed requests */
+   JAsyncQueueStatCount = 7,
+} JAsyncQueueStat;
+
+typedef struct JAsyncQueueRequest JAsyncQueueRequest;
+
+/*
+ * Reserve a slot in the in-flight window of "diskHandle". Blocks while the
+ * window is full. The returned request must be handed to the async call
+ * together with JAsyncQueue_CompletionCB, or released with
+ * JAsyncQueue_Abort if the call could not be issued.
+ */
+JAsyncQueueRequest *JAsyncQueue_Begin(VixDiskLibHandle diskHandle,
+                                      uint32 sectorCount,
+                                      VixDiskLibCompletionCB userCB,
+                                      void *userData);
+void JAsyncQueue_CompletionCB(void *cbData, VixError result);
+void JAsyncQueue_Abort(JAsyncQueueRequest *request);
+
+void JAsyncQueue_SetDefaultBounds(uint32 minDepth, uint32 maxDepth);
+Bool JAsyncQueue_SetBounds(VixDiskLibHandle diskHandle, uint32 minDepth,
+                           uint32 maxDepth);
+Bool JAsyncQueue_GetStats(VixDiskLibHandle diskHandle,
+                          int64 stats[JAsyncQueueStatCount]);
+
+/*
+ * Forget all the state kept for a disk handle. Call before closing it.
+ */
+void JAsyncQueue_Release(VixDiskLibHandle diskHandle);
+
+#endif // _JASYNCQUEUE_H_
@@ -0,0 +1,68 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jCatalog.h
+ *
+ *    Catalog of the files of a guest filesystem, built at backup time.
+ */
+
+#ifndef _JCATALOG_H_
+#define _JCATALOG_H_
+
+#include <stddef.h>
+#include "vixDiskLib.h"
+#include "jGuestFs.h"
+
+/*
+ * Layout of a catalog, integers little endian:
+ *
+ *    header     magic, version, records, restarts            4 x uint32
+ *    records    one per file, directory or link, sorted by path
+ *    restarts   offset from the start of the catalog of every
+ *               JCATALOG_RESTART_INTERVAL-th record           uint32 each
+ *
+ * A record is a sequence of unsigned LEB128 varints:
+ *
+ *    shared           bytes of the path shared with the previous record,
+ *                     0 at a restart
+ *    suffix length    followed by the bytes of the rest of the path
+ *    type, mode       JGuestFsType and permission bits
+ *    size
+ *    mtime            zigzag encoded, seconds since the epoch
+ *    extents          count, then for each: bytes of the file since the
+ *                     end of the previous extent, zigzag distance on the
+ *                     disk from the end of the previous extent, length
+ */
+#define JCATALOG_MAGIC 0x54414b53            /* "SKAT" */
+#define JCATALOG_VERSION 1
+#define JCATALOG_HEADER_SIZE 16
+#define JCATALOG_RESTART_INTERVAL 16
+
+typedef enum {
+   JCatalogStatRecords = 0,
+   JCatalogStatBytesRead = 1,   /* Bytes read from the disk */
+   JCatalogStatElapsedUs = 2,
+   JCatalogStatCount = 3,
+} JCatalogStat;
+
+/*
+ * Build the catalog of an open filesystem. Returns VIX_OK with a malloc'ed
+ * catalog, VIX_E_DISK_INVAL if the filesystem cannot be read or holds more
+ * than 64M entries, VIX_E_CANCELLED if the walk runs for more than 30
+ * minutes, or VIX_E_OUT_OF_MEMORY. A directory reached twice is walked once.
+ */
+VixError JCatalog_Build(JGuestFs *fs, uint8 **catalog, size_t *size);
+
+/*
+ * Build the catalog of the ext2/3/4 filesystem of partition "partition"
+ * (-1 for the first supported one) of an open disk. Only the metadata is
+ * read, through a cache of "cacheSize" bytes (0 for the default), and the
+ * reads are throttled by the JThrottle limits of the disk.
+ */
+VixError JCatalog_BuildFromDisk(VixDiskLibHandle disk, int partition,
+                                size_t cacheSize, uint8 **catalog,
+                                size_t *size, int64 stats[JCatalogStatCount]);
+
+#endif // _JCATALOG_H_
@@ -0,0 +1,85 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jConnCache.h
+ *
+ *    Shared cache of VixDiskLib connections and read-only disk handles.
+ */
+
+#ifndef _JCONNCACHE_H_
+#define _JCONNCACHE_H_
+
+#include "vixDiskLib.h"
+
+#define JCONNCACHE_DEFAULT_MAX_IDLE_HANDLES 32
+
+typedef enum {
+   JConnCacheStatConnects = 0,      /* Connect calls */
+   JConnCacheStatConnectHits = 1,   /* ... served by a cached connection */
+   JConnCacheStatOpens = 2,         /* Read-only open calls */
+   JConnCacheStatOpenHits = 3,      /* ... served by an idle handle */
+   JConnCacheStatExpired = 4,       /* Connections and handles expired */
+   JConnCacheStatInvalidated = 5,   /* Connections dropped after an error */
+   JConnCacheStatConnections = 6,   /* Connections currently cached */
+   JConnCacheStatIdleHandles = 7,   /* Handles currently idle */
+   JConnCacheStatCount = 8,
+} JConnCacheStat;
+
+/*
+ * Enable the cache: a connection no longer referenced is kept "idleSeconds"
+ * for a later connect with the same parameters, and is not reused once
+ * "maxAgeSeconds" old (0 for no limit), as its session ticket may have
+ * expired. Up to "maxIdleHandles" read-only disk handles closed by their
+ * user are kept open for a later open of the same disk on the same
+ * connection, as long as the connection is referenced. "idleSeconds" 0
+ * disables the cache, closing what is idle; the calls then go straight to
+ * VixDiskLib.
+ */
+void JConnCache_Configure(uint32 idleSeconds, uint32 maxAgeSeconds,
+                          uint32 maxIdleHandles);
+
+/*
+ * VixDiskLib_ConnectEx through the cache. The connection is shared by all
+ * the callers with the same server, port, user, credentials, spec,
+ * snapshot, transport modes and read-only flag, and must be released with
+ * JConnCache_Disconnect.
+ */
+VixError JConnCache_Connect(const VixDiskLibConnectParams *params,
+                            Bool readOnly, const char *ssMoref,
+                            const char *modes, VixDiskLibConnection *conn);
+
+VixError JConnCache_Disconnect(VixDiskLibConnection conn);
+
+/*
+ * VixDiskLib_Open through the cache. A read-only open of a disk closed
+ * earlier on the same connection gets the idle handle back, once a
+ * GetInfo proves it still works; "reused" tells which. A handle is never
+ * given to two users at once.
+ */
+VixError JConnCache_Open(VixDiskLibConnection conn, const char *path,
+                         uint32 flags, VixDiskLibHandle *disk, Bool *reused);
+
+/*
+ * VixDiskLib_Close through the cache, or keep the handle idle. The
+ * JAsyncQueue, JThrottle and JMetadata state of a handle is released when
+ * the handle is really closed.
+ */
+VixError JConnCache_Close(VixDiskLibHandle disk);
+
+/*
+ * Report the error of a call made on a connection: a network or session
+ * error stops the connection from being reused.
+ */
+void JConnCache_Check(VixDiskLibConnection conn, VixError err);
+
+/*
+ * Close every idle handle and connection and disable the cache. Call
+ * before VixDiskLib_Exit.
+ */
+void JConnCache_Shutdown(void);
+
+void JConnCache_GetStats(int64 stats[JConnCacheStatCount]);
+
+#endif // _JCONNCACHE_H_
@@ -0,0 +1,51 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jCopy.h
+ *
+ *    Pipelined copy between two open disks.
+ */
+
+#ifndef _JCOPY_H_
+#define _JCOPY_H_
+
+#include "vixDiskLib.h"
+
+#define JCOPY_DEFAULT_CHUNK_SECTORS 2048   /* 1MB */
+#define JCOPY_DEFAULT_DEPTH 8
+#define JCOPY_MAX_DEPTH 64
+
+/*
+ * Statistics of a copy.
+ */
+typedef enum {
+   JCopyStatBytes = 0,          /* Bytes written to the destination */
+   JCopyStatExtents = 1,        /* Extents fully copied */
+   JCopyStatResumeSector = 2,   /* Sector to restart an interrupted copy at */
+   JCopyStatElapsedUs = 3,
+   JCopyStatCount = 4,
+} JCopyStat;
+
+/*
+ * Copy the sectors [startSector, endSector) of "src" to the same sectors of
+ * "dst", "endSector" 0 meaning the capacity of "src". Up to "depth" buffers
+ * of "chunkSectors" sectors each are in flight, a buffer being written as
+ * soon as its read completes and refilled as soon as its write completes.
+ * If "allocatedOnly", only the extents reported allocated on "src" are
+ * copied. Both disks are throttled by their JThrottle limits.
+ *
+ * "progress", if not NULL, is called from the calling thread each time the
+ * percentage of sectors written changes; returning FALSE cancels the copy.
+ * On failure or cancel, stats[JCopyStatResumeSector] is the first sector
+ * not known to be copied, from which the copy can be restarted.
+ */
+VixError JCopy_Run(VixDiskLibHandle src, VixDiskLibHandle dst,
+                   VixDiskLibSectorType startSector,
+                   VixDiskLibSectorType endSector,
+                   uint32 chunkSectors, uint32 depth, Bool allocatedOnly,
+                   VixDiskLibProgressFunc progress, void *progressData,
+                   int64 stats[JCopyStatCount]);
+
+#endif // _JCOPY_H_
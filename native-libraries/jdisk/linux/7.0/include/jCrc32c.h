@@ -0,0 +1,37 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jCrc32c.h
+ *
+ *    CRC32C (Castagnoli) of data blocks, one checksum per chunk.
+ */
+
+#ifndef _JCRC32C_H_
+#define _JCRC32C_H_
+
+#include <stddef.h>
+#include "vixDiskLib.h"
+
+/*
+ * Size covered by one entry of a CRC map.
+ */
+#define JCRC32C_CHUNK_SIZE 4096
+
+/*
+ * CRC32C of "length" bytes, continuing from "crc" (0 to start).
+ */
+uint32 JCrc32c_Update(uint32 crc, const uint8 *buf, size_t length);
+
+/*
+ * Fill "map" with the CRC32C of each JCRC32C_CHUNK_SIZE chunk of "buf", the
+ * last one possibly shorter. "map" must hold JCrc32c_MapSize(length)
+ * entries.
+ */
+void JCrc32c_Map(const uint8 *buf, size_t length, uint32 *map);
+
+#define JCrc32c_MapSize(length) \
+   (((length) + JCRC32C_CHUNK_SIZE - 1) / JCRC32C_CHUNK_SIZE)
+
+#endif // _JCRC32C_H_
@@ -46,9 +46,46 @@ JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_IsAttachPossibleJNI(
 JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_AttachJNI (JNIEnv *env, jobject, jlong, jlong);
 JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_SpaceNeededForCloneJNI (JNIEnv *env, jobject, jlong, jint, jlongArray);
 JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_CheckRepairJNI (JNIEnv *env, jobject, jlong, jstring, jboolean);
-JNIEXPORT void JNICALL Java_com_vmware_jvix_jDiskLibImpl_PerturbEnableJNI (JNIEnv *env, jobject, jstring, jint);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_PerturbEnableJNI (JNIEnv *env, jobject, jstring, jint);
 JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_SetInjectedFaultJNI(JNIEnv *env, jobject, jint, jint, jint);
 JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_GetConnectParamsJNI(JNIEnv *env, jobject, jlong, jobject);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_SetAsyncQueueBoundsJNI(JNIEnv *env, jobject, jlong, jint, jint);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_GetAsyncQueueStatsJNI(JNIEnv *env, jobject, jlong, jlongArray);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_SetThrottleLimitJNI(JNIEnv *env, jobject, jint, jstring, jlong, jlong, jlong);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_SetThrottleTagsJNI(JNIEnv *env, jobject, jlong, jstring, jstring);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_SetIoSchedulerJNI(JNIEnv *env, jobject, jint, jint, jintArray);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_RegisterIoJobJNI(JNIEnv *env, jobject, jlong, jint, jlong);
+JNIEXPORT void JNICALL Java_com_vmware_jvix_jDiskLibImpl_UnregisterIoJobJNI(JNIEnv *env, jobject, jlong);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_ScheduledReadJNI(JNIEnv *env, jobject, jlong, jlong, jlong, jlong, jbyteArray);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_ScheduledWriteJNI(JNIEnv *env, jobject, jlong, jlong, jlong, jlong, jbyteArray);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_ScheduledAsyncJNI(JNIEnv *env, jobject, jlong, jlong, jboolean, jlong, jobject, jint, jobject);
+JNIEXPORT jint JNICALL Java_com_vmware_jvix_jDiskLibImpl_EstimateEntropyJNI(JNIEnv *env, jobject, jbyteArray, jint, jint, jint);
+JNIEXPORT jint JNICALL Java_com_vmware_jvix_jDiskLibImpl_MiGzDecodeJNI(JNIEnv *env, jobject, jbyteArray, jint, jbyteArray, jint);
+JNIEXPORT jint JNICALL Java_com_vmware_jvix_jDiskLibImpl_Crc32cMapJNI(JNIEnv *env, jobject, jbyteArray, jint, jint, jintArray);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_MultiBufferHashJNI(JNIEnv *env, jobject, jint, jbyteArray, jint, jint, jbyteArray);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_ScrubJNI(JNIEnv *env, jobject, jobjectArray, jintArray, jbyteArray, jbyteArray, jint, jboolean, jintArray, jlongArray);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_CopyJNI(JNIEnv *env, jobject, jlong, jlong, jlong, jlong, jint, jint, jboolean, jobject, jlongArray);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_GuestFsOpenJNI(JNIEnv *env, jobject, jobjectArray, jlongArray, jintArray, jbyteArray, jlong, jint, jlong, jlongArray);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_GuestFsLookupJNI(JNIEnv *env, jobject, jlong, jstring, jobject);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_GuestFsListJNI(JNIEnv *env, jobject, jlong, jlong, jobject);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_GuestFsReadJNI(JNIEnv *env, jobject, jlong, jlong, jlong, jbyteArray, jint);
+JNIEXPORT void JNICALL Java_com_vmware_jvix_jDiskLibImpl_GuestFsCloseJNI(JNIEnv *env, jobject, jlong);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_CatalogBuildJNI(JNIEnv *env, jobject, jlong, jint, jlong, jobjectArray, jlongArray);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_NbdStartJNI(JNIEnv *env, jobject, jobjectArray, jlongArray, jintArray, jbyteArray, jlong, jlong, jstring, jstring, jint, jlong, jlong, jlongArray);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_NbdGetStatsJNI(JNIEnv *env, jobject, jlong, jlongArray);
+JNIEXPORT void JNICALL Java_com_vmware_jvix_jDiskLibImpl_NbdStopJNI(JNIEnv *env, jobject, jlong);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_SetConnectionCacheJNI(JNIEnv *env, jobject, jint, jint, jint);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_GetConnectionCacheStatsJNI(JNIEnv *env, jobject, jlongArray);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_AttachDaemonJNI(JNIEnv *env, jobject, jstring, jint, jint);
+JNIEXPORT void JNICALL Java_com_vmware_jvix_jDiskLibImpl_DetachDaemonJNI(JNIEnv *env, jobject);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_GetDaemonStatsJNI(JNIEnv *env, jobject, jlongArray);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_ReadAllMetadataJNI(JNIEnv *env, jobject, jlong, jobject);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_ProbeTransportJNI(JNIEnv *env, jobject, jobject, jstring, jstring, jstring, jstring, jint, jint, jobjectArray);
+JNIEXPORT jint JNICALL Java_com_vmware_jvix_jDiskLibImpl_GetVddkCapabilitiesJNI(JNIEnv *env, jobject);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_ProgressOpenJNI(JNIEnv *env, jobject, jint, jlongArray);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jDiskLibImpl_ProgressGetStatsJNI(JNIEnv *env, jobject, jlong, jlongArray);
+JNIEXPORT void JNICALL Java_com_vmware_jvix_jDiskLibImpl_ProgressCancelJNI(JNIEnv *env, jobject, jlong);
+JNIEXPORT void JNICALL Java_com_vmware_jvix_jDiskLibImpl_ProgressCloseJNI(JNIEnv *env, jobject, jlong);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,207 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jDiskd.h
+ *
+ *    Out of process VDDK worker: protocol and client.
+ *
+ *    jdiskd keeps VixDiskLib initialised and its connections warm, and
+ *    serves the processes attached to its unix socket. Each command is one
+ *    SOCK_SEQPACKET message; disk data never goes through the socket but
+ *    through a shared memory region of fixed size slots, set up by the
+ *    client at attach time and passed to the daemon with SCM_RIGHTS. The
+ *    region is a memfd sealed against shrinking and growing, the daemon
+ *    refuses any other.
+ */
+
+#ifndef _JDISKD_H_
+#define _JDISKD_H_
+
+#include "vixDiskLib.h"
+
+#define JDISKD_MAGIC 0x444b534a     /* "JSKD" */
+#define JDISKD_VERSION 2            /* 2: sealed region */
+#define JDISKD_MAX_PAYLOAD 65536
+#define JDISKD_MAX_SLOTS 256
+#define JDISKD_DEFAULT_SLOTS 16
+#define JDISKD_DEFAULT_SLOT_SIZE (4 * 1024 * 1024)
+#define JDISKD_DEFAULT_SOCKET "/run/safekeeping/jdiskd.sock"
+
+typedef enum {
+   JDiskdOpHello = 1,               /* args: magic, version, slots, size */
+   JDiskdOpConnect = 2,             /* args: readOnly; payload: params */
+   JDiskdOpDisconnect = 3,
+   JDiskdOpOpen = 4,                /* args: flags; payload: path */
+   JDiskdOpClose = 5,
+   JDiskdOpGetInfo = 6,             /* reply payload: info */
+   JDiskdOpGetTransportMode = 7,    /* reply payload: mode */
+   JDiskdOpQueryBlocks = 8,         /* args: start, count, chunk, slot */
+   JDiskdOpRead = 9,                /* args: start, count, slot */
+   JDiskdOpGetMetadataKeys = 10,    /* reply payload: keys */
+   JDiskdOpReadMetadata = 11,       /* payload: key; reply payload: value */
+   JDiskdOpGetStats = 12,           /* reply payload: daemon statistics */
+   JDiskdOpReadAllMetadata = 13,    /* reply payload: packed metadata */
+} JDiskdOp;
+
+/*
+ * Command, followed by "length" bytes of payload in the same message.
+ * "handle" is a connection or disk handle of the daemon, as returned by
+ * Connect and Open.
+ */
+typedef struct {
+   uint32 op;
+   uint32 id;
+   uint64 handle;
+   int64 args[4];
+   uint32 length;
+   uint32 pad;
+} JDiskdRequest;
+
+/*
+ * Reply to the command "id", followed by "length" bytes of payload. A
+ * QueryBlocks reply tells in values[0] the number of blocks written to the
+ * slot and in values[1] the sector where a truncated query stopped, 0 if
+ * complete.
+ */
+typedef struct {
+   uint32 id;
+   uint32 length;
+   uint64 error;
+   int64 values[2];
+} JDiskdReply;
+
+/*
+ * GetInfo reply, followed by the parent file name hint and the uuid as
+ * strings.
+ */
+typedef struct {
+   uint32 biosGeo[3];               /* Cylinders, heads, sectors */
+   uint32 physGeo[3];
+   uint64 capacity;
+   uint32 adapterType;
+   int32 numLinks;
+   uint32 logicalSectorSize;
+   uint32 physicalSectorSize;
+} JDiskdInfo;
+
+/*
+ * Statistics: the client ones, then those of the daemon.
+ */
+typedef enum {
+   JDiskdStatRequests = 0,          /* Commands sent */
+   JDiskdStatReads = 1,             /* Read commands */
+   JDiskdStatBytesRead = 2,
+   JDiskdStatSlotWaits = 3,         /* Reads that waited for a free slot */
+   JDiskdStatClients = 4,           /* Daemon: clients attached */
+   JDiskdStatConnects = 5,          /* Daemon: connect commands */
+   JDiskdStatConnectHits = 6,       /* ... served by a warm connection */
+   JDiskdStatOpenDisks = 7,         /* Daemon: disks open */
+   JDiskdStatCount = 8,
+} JDiskdStat;
+
+/*
+ * Payload encoding: a string is a presence byte followed, if 1, by the
+ * bytes and a NUL. Decoding returns FALSE past the end of the payload.
+ */
+Bool JDiskd_PutString(char *buf, uint32 size, uint32 *pos, const char *s);
+Bool JDiskd_GetString(const char *buf, uint32 size, uint32 *pos,
+                      const char **s);
+
+/*
+ * Send and receive one message, with an optional file descriptor (-1 for
+ * none). Receive expects a payload of up to JDISKD_MAX_PAYLOAD bytes and
+ * returns the bytes received, header included, 0 at the end of the stream
+ * or -1 on error.
+ */
+Bool JDiskd_Send(int sock, const void *header, size_t headerSize,
+                 const void *payload, uint32 length, int fd);
+int JDiskd_Receive(int sock, void *header, size_t headerSize, char *payload,
+                   int *fd);
+
+/*
+ * Attach this process to the daemon listening at "socketPath", with a
+ * shared region of "slots" slots of "slotSize" bytes (0 for the defaults).
+ * Once attached, the Connect, Open and read calls below go to the daemon;
+ * the handles they return are only understood by these calls. Returns
+ * VIX_OK, VIX_E_INVALID_ARG, VIX_E_HOST_SERVER_NOT_FOUND if nothing
+ * listens, VIX_E_NOT_SUPPORTED on a version mismatch, VIX_E_FAIL or
+ * VIX_E_OUT_OF_MEMORY.
+ */
+VixError JDiskd_Attach(const char *socketPath, uint32 slots, uint32 slotSize);
+
+/*
+ * Detach from the daemon. The daemon closes the disks and connections
+ * left open by this process.
+ */
+void JDiskd_Detach(void);
+
+Bool JDiskd_IsAttached(void);
+
+/*
+ * Whether a connection or disk handle was returned by this client.
+ */
+Bool JDiskd_IsRemote(const void *handle);
+
+VixError JDiskd_Connect(const VixDiskLibConnectParams *params, Bool readOnly,
+                        const char *ssMoref, const char *modes,
+                        VixDiskLibConnection *conn);
+VixError JDiskd_Disconnect(VixDiskLibConnection conn);
+VixError JDiskd_Open(VixDiskLibConnection conn, const char *path,
+                     uint32 flags, VixDiskLibHandle *disk);
+
+/*
+ * Close a disk, once its reads in flight are done.
+ */
+VixError JDiskd_Close(VixDiskLibHandle disk);
+
+/*
+ * Same contracts as their VixDiskLib counterparts. The info and the block
+ * list are freed with JDiskd_FreeInfo and free(), the mode with free().
+ */
+VixError JDiskd_GetInfo(VixDiskLibHandle disk, VixDiskLibInfo **info);
+void JDiskd_FreeInfo(VixDiskLibInfo *info);
+char *JDiskd_GetTransportMode(VixDiskLibHandle disk);
+VixError JDiskd_QueryAllocatedBlocks(VixDiskLibHandle disk,
+                                     VixDiskLibSectorType startSector,
+                                     VixDiskLibSectorType numSectors,
+                                     VixDiskLibSectorType chunkSize,
+                                     VixDiskLibBlockList **blockList);
+VixError JDiskd_GetMetadataKeys(VixDiskLibHandle disk, char *keys,
+                                size_t bufLen, size_t *required);
+VixError JDiskd_ReadMetadata(VixDiskLibHandle disk, const char *key,
+                             char *buf, size_t bufLen, size_t *required);
+
+/*
+ * JMetadata_ReadAll in the daemon, with the contract of GetMetadataKeys.
+ * VIX_E_BUFFER_TOOSMALL without a required size if the metadata does not
+ * fit in a message.
+ */
+VixError JDiskd_ReadAllMetadata(VixDiskLibHandle disk, char *buf,
+                                size_t bufLen, size_t *required);
+VixError JDiskd_Read(VixDiskLibHandle disk, VixDiskLibSectorType startSector,
+                     VixDiskLibSectorType numSectors, uint8 *buf);
+
+/*
+ * Queue a read and return VIX_ASYNC; "callback" is called from the
+ * receiver thread of the client once the data is in "buf". A read larger
+ * than a slot is split over several slots, and the call blocks while no
+ * slot is free.
+ */
+VixError JDiskd_ReadAsync(VixDiskLibHandle disk,
+                          VixDiskLibSectorType startSector,
+                          VixDiskLibSectorType numSectors, uint8 *buf,
+                          VixDiskLibCompletionCB callback, void *cbData);
+
+/*
+ * Wait for the reads in flight of a disk.
+ */
+VixError JDiskd_Wait(VixDiskLibHandle disk);
+
+/*
+ * Client statistics, and the daemon ones if attached.
+ */
+void JDiskd_GetStats(int64 stats[JDiskdStatCount]);
+
+#endif // _JDISKD_H_
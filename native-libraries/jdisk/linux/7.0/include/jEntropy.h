@@ -0,0 +1,36 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jEntropy.h
+ *
+ *    Sampled byte-entropy estimator, used to predict whether a block is
+ *    worth compressing.
+ */
+
+#ifndef _JENTROPY_H_
+#define _JENTROPY_H_
+
+#include <stddef.h>
+#include "vixDiskLib.h"
+
+/*
+ * Bytes are sampled in runs of this size, so that short repeated patterns
+ * are still seen as such.
+ */
+#define JENTROPY_RUN_SIZE 64
+
+/*
+ * Sample size used when none is given.
+ */
+#define JENTROPY_DEFAULT_SAMPLE_SIZE 16384
+
+/*
+ * Estimate the order-0 entropy of "buf", in thousandths of a bit per byte
+ * (0 to 8000). At most "sampleSize" bytes, spread over the whole buffer,
+ * are looked at; 0 selects the default sample size.
+ */
+int JEntropy_Estimate(const uint8 *buf, size_t length, size_t sampleSize);
+
+#endif // _JENTROPY_H_
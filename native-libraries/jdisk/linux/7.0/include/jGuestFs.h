@@ -0,0 +1,112 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jGuestFs.h
+ *
+ *    Read-only reader of a guest filesystem on an archived disk.
+ */
+
+#ifndef _JGUESTFS_H_
+#define _JGUESTFS_H_
+
+#include <stddef.h>
+#include "vixDiskLib.h"
+
+#define JGUESTFS_NAME_MAX 255
+#define JGUESTFS_ROOT_INODE 2
+
+/*
+ * Type of an entry, as in the ext2 directory entries.
+ */
+typedef enum {
+   JGuestFsUnknown = 0,
+   JGuestFsFile = 1,
+   JGuestFsDirectory = 2,
+   JGuestFsCharDevice = 3,
+   JGuestFsBlockDevice = 4,
+   JGuestFsFifo = 5,
+   JGuestFsSocket = 6,
+   JGuestFsSymlink = 7,
+} JGuestFsType;
+
+typedef struct JGuestFsEntry {
+   char name[JGUESTFS_NAME_MAX + 1];
+   uint32 inode;
+   JGuestFsType type;
+   uint32 mode;                 /* Permission bits and type, as in stat */
+   uint32 uid;
+   uint32 gid;
+   int64 size;
+   int64 mtime;                 /* Seconds since the epoch */
+} JGuestFsEntry;
+
+typedef struct JGuestFs JGuestFs;
+
+/*
+ * Read "length" bytes at byte "offset" of the disk under the filesystem;
+ * returns FALSE on error.
+ */
+typedef Bool (*JGuestFsReadFunc)(void *disk, int64 offset, size_t length,
+                                 uint8 *buf);
+
+/*
+ * Called for each entry of a directory; returning FALSE stops the listing.
+ */
+typedef Bool (*JGuestFsListFunc)(void *data, const JGuestFsEntry *entry);
+
+/*
+ * Open the ext2/3/4 filesystem of partition "partition" of "disk", read
+ * through "read", in the order of the MBR (logical partitions after the
+ * primary ones) or of the GPT. -1 selects the first partition holding a
+ * supported filesystem, or the whole disk if it is not partitioned. The
+ * disk stays owned by the caller and must outlive the filesystem.
+ *
+ * Returns VIX_OK, VIX_E_NOT_SUPPORTED if there is no such filesystem or
+ * it uses unsupported features, VIX_E_DISK_INVALIDPARTITIONTABLE if the
+ * partition does not exist, VIX_E_DISK_INVAL if the disk cannot be read,
+ * or VIX_E_OUT_OF_MEMORY.
+ */
+VixError JGuestFs_Open(JGuestFsReadFunc read, void *disk, int partition,
+                       JGuestFs **fs);
+
+/*
+ * Resolve an absolute path, without following symbolic links.
+ * Returns VIX_OK, VIX_E_FILE_NOT_FOUND, VIX_E_NOT_A_DIRECTORY if a
+ * component other than the last is not a directory, or VIX_E_DISK_INVAL.
+ */
+VixError JGuestFs_Lookup(JGuestFs *fs, const char *path, JGuestFsEntry *entry);
+
+/*
+ * List a directory, "." and ".." excluded.
+ */
+VixError JGuestFs_List(JGuestFs *fs, uint32 inode, JGuestFsListFunc func,
+                       void *data);
+
+/*
+ * Read up to "length" bytes of a file at "offset"; for a symbolic link the
+ * data is its target. Returns the bytes read, 0 at the end of the file, -1
+ * on error.
+ */
+int64 JGuestFs_Read(JGuestFs *fs, uint32 inode, int64 offset, uint8 *buf,
+                    size_t length);
+
+/*
+ * Called for each run of a file stored contiguously, in file order:
+ * "length" bytes at "fileOffset" of the file are at "diskOffset" of the
+ * disk. Returning FALSE stops the mapping.
+ */
+typedef Bool (*JGuestFsMapFunc)(void *data, int64 fileOffset,
+                                int64 diskOffset, int64 length);
+
+/*
+ * Report where the data of a file is on the disk. Holes, uninitialized
+ * extents and data stored in the inode itself are not reported.
+ */
+VixError JGuestFs_Map(JGuestFs *fs, uint32 inode, JGuestFsMapFunc func,
+                      void *data);
+
+void JGuestFs_Close(JGuestFs *fs);
+
+#endif // _JGUESTFS_H_
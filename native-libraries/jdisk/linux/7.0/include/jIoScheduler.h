@@ -0,0 +1,81 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jIoScheduler.h
+ *
+ *    Priority-aware I/O scheduler shared by all the disk handles of the
+ *    process.
+ */
+
+#ifndef _JIOSCHEDULER_H_
+#define _JIOSCHEDULER_H_
+
+#include "vixDiskLib.h"
+
+/*
+ * Priority classes. Lower values are served first by the strict policy and
+ * get the larger share by default with the weighted policy.
+ */
+typedef enum {
+   JIoClassInteractive = 0,   /* e.g. a restore somebody is waiting for */
+   JIoClassNormal = 1,
+   JIoClassBackground = 2,    /* e.g. the nightly backup */
+   JIoClassCount = 3,
+} JIoClass;
+
+typedef enum {
+   JIoPolicyWeighted = 0,     /* Weighted-fair share between classes */
+   JIoPolicyStrict = 1,       /* Strict priority between classes */
+} JIoPolicy;
+
+#define JIOSCHED_DEFAULT_MAX_IN_FLIGHT 16
+#define JIOSCHED_DEFAULT_WEIGHT_INTERACTIVE 16
+#define JIOSCHED_DEFAULT_WEIGHT_NORMAL 4
+#define JIOSCHED_DEFAULT_WEIGHT_BACKGROUND 1
+
+/*
+ * Change policy, maximum number of requests issued to VixDiskLib at
+ * the same time and the class weights. weights may be NULL.
+ */
+void JIoSched_Configure(JIoPolicy policy, uint32 maxInFlight,
+                        const uint32 weights[JIoClassCount]);
+
+/*
+ * Declare a job. Requests of a job are queued in its class, ordered by
+ * deadline (milliseconds from now, 0 for none). A job past its deadline
+ * is served before any class. Requests of unknown jobs are queued as
+ * JIoClassNormal without deadline.
+ */
+Bool JIoSched_RegisterJob(int64 jobId, JIoClass ioClass, uint64 deadlineMs);
+void JIoSched_UnregisterJob(int64 jobId);
+
+/*
+ * Wait for a slot, then issue an async read or write from the calling
+ * thread, the only one the scheduler lets touch diskHandle. While waiting,
+ * the requests in flight on diskHandle are pumped with VixDiskLib_Wait.
+ * The completion callback is called from the VixDiskLib completion
+ * context, as for VixDiskLib_ReadAsync.
+ *
+ * Results: VIX_ASYNC, or an error if the request could not be issued, in
+ * which case the callback is not called.
+ */
+VixError JIoSched_Submit(int64 jobId, VixDiskLibHandle diskHandle,
+                         Bool write, VixDiskLibSectorType startSector,
+                         uint32 numSectors, uint8 *buf,
+                         VixDiskLibCompletionCB callback, void *cbData);
+
+/*
+ * Same as JIoSched_Submit, then wait for the completion.
+ */
+VixError JIoSched_Transfer(int64 jobId, VixDiskLibHandle diskHandle,
+                           Bool write, VixDiskLibSectorType startSector,
+                           uint32 numSectors, uint8 *buf);
+
+/*
+ * Fail the requests still waiting for a slot with VIX_E_CANCELLED.
+ */
+void JIoSched_Shutdown(void);
+
+#endif // _JIOSCHEDULER_H_
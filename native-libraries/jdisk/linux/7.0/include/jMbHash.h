@@ -0,0 +1,56 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jMbHash.h
+ *
+ *    Multi-buffer SHA-1 and MD5: the digests of concurrent callers are
+ *    computed together, one buffer per SIMD lane.
+ */
+
+#ifndef _JMBHASH_H_
+#define _JMBHASH_H_
+
+#include <stddef.h>
+#include "vixDiskLib.h"
+
+typedef enum {
+   JMbHashSha1 = 0,
+   JMbHashMd5 = 1,
+   JMbHashCount = 2,
+} JMbHashAlgorithm;
+
+#define JMBHASH_SHA1_SIZE 20
+#define JMBHASH_MD5_SIZE 16
+
+/*
+ * Number of buffers hashed at once.
+ */
+#define JMBHASH_LANES 8
+
+/*
+ * How long a caller waits for other buffers to fill the lanes before
+ * hashing what has been submitted.
+ */
+#define JMBHASH_GATHER_US 200
+
+/*
+ * Buffers smaller than this are hashed at once, without waiting.
+ */
+#define JMBHASH_MIN_GATHER_SIZE (64 * 1024)
+
+/*
+ * TRUE if the CPU can run the engine (AVX2).
+ */
+Bool JMbHash_IsSupported(void);
+
+/*
+ * Compute the digest of "buf", batched with the buffers submitted by other
+ * threads. Blocks the caller until the digest is ready. FALSE if the CPU
+ * is not supported.
+ */
+Bool JMbHash_Digest(JMbHashAlgorithm algorithm, const uint8 *buf,
+                    size_t length, uint8 *digest);
+
+#endif // _JMBHASH_H_
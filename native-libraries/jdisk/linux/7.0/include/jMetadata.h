@@ -0,0 +1,31 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jMetadata.h
+ *
+ *    Bulk read of the metadata of a disk, cached per disk handle.
+ */
+
+#ifndef _JMETADATA_H_
+#define _JMETADATA_H_
+
+#include "vixDiskLib.h"
+
+/*
+ * Read every metadata key of a disk with its value, packed as "key\0value\0"
+ * pairs in "*packed" (freed with free()), "*size" bytes long. The metadata
+ * is read once per disk handle and served from the cache afterwards;
+ * "cached" (optional) tells which.
+ */
+VixError JMetadata_ReadAll(VixDiskLibHandle disk, char **packed,
+                           size_t *size, Bool *cached);
+
+/*
+ * Forget the metadata cached for a disk handle. Call after writing its
+ * metadata and before closing it.
+ */
+void JMetadata_Release(VixDiskLibHandle disk);
+
+#endif // _JMETADATA_H_
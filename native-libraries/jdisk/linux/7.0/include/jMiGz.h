@@ -0,0 +1,33 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jMiGz.h
+ *
+ *    Multi-threaded decoder of MiGz streams.
+ */
+
+#ifndef _JMIGZ_H_
+#define _JMIGZ_H_
+
+#include <stddef.h>
+#include "vixDiskLib.h"
+
+/*
+ * Upper bound of the decoding threads of one stream.
+ */
+#define JMIGZ_MAX_THREADS 32
+
+/*
+ * Decode the gzip members of "src" into "dst", using up to "threads"
+ * threads. MiGz members record their compressed size and are decoded in
+ * parallel; a stream of plain gzip members is decoded sequentially.
+ *
+ * Returns the decoded size, or -1 if the stream is corrupt or does not fit
+ * in "dstLength" bytes.
+ */
+int64 JMiGz_Decode(const uint8 *src, size_t srcLength, uint8 *dst,
+                   size_t dstLength, int threads);
+
+#endif // _JMIGZ_H_
@@ -0,0 +1,31 @@
+/* DO NOT EDIT THIS FILE - it is machine generated */
+
+#ifndef __com_vmware_jvix_jMntApiImpl__
+#define __com_vmware_jvix_jMntApiImpl__
+
+#include <jni.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jMntApiImpl_InitJNI (JNIEnv *env, jobject, jint, jint, jobject, jstring, jstring);
+JNIEXPORT void JNICALL Java_com_vmware_jvix_jMntApiImpl_ExitJNI (JNIEnv *env, jobject);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jMntApiImpl_OpenDisksJNI (JNIEnv *env, jobject, jlong, jobjectArray, jint, jlongArray);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jMntApiImpl_OpenDiskSetJNI (JNIEnv *env, jobject, jlongArray, jint, jlongArray);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jMntApiImpl_CloseDiskSetJNI (JNIEnv *env, jobject, jlong);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jMntApiImpl_GetVolumeHandlesJNI (JNIEnv *env, jobject, jlong, jobject);
+JNIEXPORT void JNICALL Java_com_vmware_jvix_jMntApiImpl_FreeVolumeHandlesJNI (JNIEnv *env, jobject, jlong);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jMntApiImpl_GetOsInfoJNI (JNIEnv *env, jobject, jlong, jobject);
+JNIEXPORT void JNICALL Java_com_vmware_jvix_jMntApiImpl_FreeOsInfoJNI (JNIEnv *env, jobject, jlong);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jMntApiImpl_MountVolumeJNI (JNIEnv *env, jobject, jlong, jboolean);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jMntApiImpl_DismountVolumeJNI (JNIEnv *env, jobject, jlong, jboolean);
+JNIEXPORT jlong JNICALL Java_com_vmware_jvix_jMntApiImpl_GetVolumeInfoJNI (JNIEnv *env, jobject, jlong, jobject);
+JNIEXPORT void JNICALL Java_com_vmware_jvix_jMntApiImpl_FreeVolumeInfoJNI (JNIEnv *env, jobject, jlong);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __com_vmware_jvix_jMntApiImpl__ */
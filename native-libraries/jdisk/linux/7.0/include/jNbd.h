@@ -0,0 +1,72 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jNbd.h
+ *
+ *    NBD server exposing an archived disk generation as a block device.
+ */
+
+#ifndef _JNBD_H_
+#define _JNBD_H_
+
+#include "vixDiskLib.h"
+#include "jArchiveDisk.h"
+
+#define JNBD_DEFAULT_READAHEAD (8 * 1024 * 1024)
+#define JNBD_MAX_REQUEST (32 * 1024 * 1024)
+#define JNBD_PAGE_SIZE 4096
+#define JNBD_MAX_CLIENTS 16
+
+/*
+ * Statistics of a server.
+ */
+typedef enum {
+   JNbdStatConnections = 0,     /* Clients connected since the start */
+   JNbdStatReads = 1,
+   JNbdStatBytesRead = 2,
+   JNbdStatWrites = 3,
+   JNbdStatBytesWritten = 4,
+   JNbdStatOverlayBytes = 5,    /* Memory held by the written pages */
+   JNbdStatPrefetches = 6,      /* Readahead requests issued */
+   JNbdStatCount = 7,
+} JNbdStat;
+
+typedef struct JNbdServer JNbdServer;
+
+/*
+ * Serve "disk" with the fixed newstyle NBD handshake under the export name
+ * "name". "address" is the path of a unix socket to create, or NULL to
+ * listen on 127.0.0.1 at "port" (0 for any free port).
+ *
+ * Reads of a disk region are served from the archived blocks, and a read
+ * continuing the previous one of a client queues a readahead of
+ * "readahead" bytes (0 for the default, -1 for none) past it. Writes go to
+ * a sparse overlay of JNBD_PAGE_SIZE pages kept in memory, never to the
+ * archive; the overlay is lost when the server stops. Up to "overlayLimit"
+ * bytes of pages are written, 0 exporting the disk read-only.
+ *
+ * The server takes ownership of "disk". Returns VIX_OK, VIX_E_INVALID_ARG,
+ * VIX_E_FILE_ALREADY_EXISTS if the address is in use, VIX_E_FAIL if the
+ * socket cannot be created, or VIX_E_OUT_OF_MEMORY; on error the disk is
+ * closed.
+ */
+VixError JNbd_Start(JArchiveDisk *disk, const char *name, const char *address,
+                    int port, int64 readahead, int64 overlayLimit,
+                    JNbdServer **server);
+
+/*
+ * Port the server listens on, 0 for a unix socket.
+ */
+int JNbd_GetPort(const JNbdServer *server);
+
+void JNbd_GetStats(JNbdServer *server, int64 stats[JNbdStatCount]);
+
+/*
+ * Disconnect the clients, stop the server and close the disk. The unix
+ * socket, if any, is removed.
+ */
+void JNbd_Stop(JNbdServer *server);
+
+#endif // _JNBD_H_
@@ -0,0 +1,91 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jProgress.h
+ *
+ *    Progress of the long VixDiskLib operations (Create, Clone, Grow,
+ *    Shrink, Defragment), with coalesced upcalls into Java.
+ */
+
+#ifndef _JPROGRESS_H_
+#define _JPROGRESS_H_
+
+#include <jni.h>
+#include "vixDiskLib.h"
+
+#define JPROGRESS_DEFAULT_INTERVAL_MS 1000
+
+/*
+ * Statistics of a channel.
+ */
+typedef enum {
+   JProgressStatPercent = 0,    /* Last percentage VixDiskLib reported */
+   JProgressStatTicks = 1,      /* Progress callbacks of VixDiskLib */
+   JProgressStatUpcalls = 2,    /* Of them, the ones forwarded to Java */
+   JProgressStatCancelled = 3,  /* 1 once cancelled */
+   JProgressStatActive = 4,     /* Operations running on the channel */
+   JProgressStatCount = 5,
+} JProgressStat;
+
+/*
+ * A channel holds the progress of the operations given it, written by the
+ * VixDiskLib callback and readable from any thread without a lock, and a
+ * cancel flag the callback checks at each tick.
+ */
+typedef struct JProgress JProgress;
+
+/*
+ * State of one operation. Lives on the stack of the JNI function running
+ * it: the VixDiskLib callback runs on that thread.
+ */
+typedef struct JProgressCall {
+   struct JUtilsLogger *logger;
+   jobject progress;            /* Java Progress, NULL for none */
+   JProgress *channel;          /* NULL for none */
+   uint32 intervalMs;           /* Minimum time between two upcalls */
+   uint64 lastUpcallUs;
+   int percent;                 /* Last one VixDiskLib reported */
+   int lastUpcallPercent;       /* Last one given to Java, -1 for none */
+   Bool cancelled;
+} JProgressCall;
+
+/*
+ * Create a channel forwarding at most one progress update every
+ * "intervalMs" milliseconds (0 for JPROGRESS_DEFAULT_INTERVAL_MS) to the
+ * Java Progress of the operations. NULL if out of memory.
+ */
+JProgress *JProgress_Open(uint32 intervalMs);
+
+/*
+ * Make the operations of the channel abort at their next progress tick.
+ */
+void JProgress_Cancel(JProgress *channel);
+
+void JProgress_GetStats(JProgress *channel,
+                        int64 stats[JProgressStatCount]);
+
+/*
+ * Free a channel. No operation may be running on it.
+ */
+void JProgress_Close(JProgress *channel);
+
+/*
+ * Prepare "call" for an operation reporting to the Java Progress
+ * "progress" (may be NULL), through the channel set in its "channel" field
+ * if any. JProgress_Func and "call" are then the VixDiskLib progress
+ * callback and its data, and JProgress_End is called once the operation
+ * returned.
+ */
+void JProgress_Begin(JProgressCall *call, struct JUtilsLogger *logger,
+                     JNIEnv *env, jobject progress);
+
+Bool JProgress_Func(void *progressData, int percentCompleted);
+
+/*
+ * Give Java the last percentage if it was coalesced away.
+ */
+void JProgress_End(JProgressCall *call);
+
+#endif // _JPROGRESS_H_
@@ -0,0 +1,66 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jScrub.h
+ *
+ *    Verification of the blocks stored on a file target.
+ */
+
+#ifndef _JSCRUB_H_
+#define _JSCRUB_H_
+
+#include <stddef.h>
+#include "vixDiskLib.h"
+#include "jMbHash.h"
+
+/*
+ * Flags of a block.
+ */
+#define JSCRUB_CIPHER   0x1   /* Stored AES-128 ECB encrypted */
+#define JSCRUB_COMPRESS 0x2   /* Stored as a MiGz stream */
+#define JSCRUB_SHA1     0x4   /* sha1 holds the SHA-1 of the plain block */
+
+#define JSCRUB_MAX_THREADS 64
+
+typedef enum {
+   JScrubOk = 0,
+   JScrubMissing = 1,
+   JScrubReadError = 2,
+   JScrubMd5Mismatch = 3,
+   JScrubDecodeError = 4,
+   JScrubSha1Mismatch = 5,
+} JScrubStatus;
+
+typedef struct JScrubBlock {
+   const char *path;                   /* IN: data file of the block */
+   int flags;                          /* IN: JSCRUB_* */
+   int cipherOffset;                   /* IN: padding added by encryption */
+   size_t size;                        /* IN: size of the plain block */
+   uint8 md5[JMBHASH_MD5_SIZE];        /* IN: MD5 of the stored data */
+   uint8 sha1[JMBHASH_SHA1_SIZE];      /* IN: SHA-1 of the plain block */
+   JScrubStatus status;                /* OUT */
+} JScrubBlock;
+
+typedef struct JScrubStats {
+   int64 blocks;
+   int64 badBlocks;
+   int64 bytesRead;        /* Stored bytes */
+   int64 bytesVerified;    /* Plain bytes hashed in deep mode */
+   int64 elapsedUs;
+} JScrubStats;
+
+/*
+ * Verify "count" blocks with "threads" threads. Every block has the MD5 of
+ * its stored data checked; unless "shallow", a block is also decrypted
+ * with "key" (16 bytes, NULL if none), decompressed and its SHA-1 checked
+ * when it has one. Encrypted blocks without a key are checked shallow.
+ *
+ * Returns FALSE, without touching the blocks, if the CPU lacks the
+ * instructions of the hash engine or, with a key, of AES.
+ */
+Bool JScrub_Run(JScrubBlock *blocks, int count, const uint8 *key,
+                int threads, Bool shallow, JScrubStats *stats);
+
+#endif // _JSCRUB_H_
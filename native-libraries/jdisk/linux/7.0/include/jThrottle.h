@@ -0,0 +1,62 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jThrottle.h
+ *
+ *    Hierarchical token-bucket bandwidth throttling for VixDiskLib I/O.
+ */
+
+#ifndef _JTHROTTLE_H_
+#define _JTHROTTLE_H_
+
+#include "vixDiskLib.h"
+
+/*
+ * A request is charged against one bucket of every scope: the global
+ * bucket, the bucket of the ESX host and of the datastore the disk was
+ * tagged with, and the bucket of the disk handle itself.
+ */
+typedef enum {
+   JThrottleScopeGlobal = 0,
+   JThrottleScopeHost = 1,
+   JThrottleScopeDatastore = 2,
+   JThrottleScopeDisk = 3,
+   JThrottleScopeCount = 4,
+} JThrottleScope;
+
+/*
+ * Burst allowed when none is given, in milliseconds of the rate.
+ */
+#define JTHROTTLE_DEFAULT_BURST_MS 250
+
+/*
+ * Set the rate (bytes per second, 0 for unlimited) and burst (bytes, 0 for
+ * the default) of a bucket. For the host and datastore scopes a NULL name,
+ * and for the disk scope a NULL handle, changes the default limit of the
+ * scope, which applies to every bucket that has no limit of its own.
+ */
+Bool JThrottle_SetLimit(JThrottleScope scope, const char *name,
+                        VixDiskLibHandle diskHandle, uint64 bytesPerSec,
+                        uint64 burstBytes);
+
+/*
+ * Attach a disk handle to its host and datastore buckets. NULL leaves the
+ * current tag unchanged.
+ */
+Bool JThrottle_SetDiskTags(VixDiskLibHandle diskHandle, const char *host,
+                           const char *datastore);
+
+/*
+ * Charge "bytes" of I/O on "diskHandle", sleeping as long as needed to
+ * keep every bucket within its rate.
+ */
+void JThrottle_Consume(VixDiskLibHandle diskHandle, uint64 bytes);
+
+/*
+ * Forget a disk handle. Call before closing it.
+ */
+void JThrottle_Release(VixDiskLibHandle diskHandle);
+
+#endif // _JTHROTTLE_H_
@@ -0,0 +1,44 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jTransportProbe.h
+ *
+ *    Transport mode selection by timed reads through each mode.
+ */
+
+#ifndef _JTRANSPORTPROBE_H_
+#define _JTRANSPORTPROBE_H_
+
+#include "vixDiskLib.h"
+
+#define JTRANSPORTPROBE_DEFAULT_SECTORS (64 * 2048)      /* 64MB */
+
+/*
+ * Probe the transport modes "modes" (a VixDiskLib modes string, NULL for
+ * every mode VixDiskLib_ListTransportModes reports) on the disk "diskPath"
+ * of the snapshot "ssMoref" (NULL for the disk of a vStorageObject
+ * connection): each mode gets its own read-only connection, opens the disk
+ * and reads "probeSectors" sectors spread over it. A mode VixDiskLib
+ * silently replaced by another one counts as failed.
+ *
+ * On VIX_OK "*ordered" is the modes string to connect with, the working
+ * modes fastest first, and "*report" tells the rate or the error of each
+ * mode; both are freed with free(). The result is kept "cacheSeconds" for
+ * the same "cacheKey", datastore of the disk and modes, and "*cached"
+ * tells whether it came from there. Returns the error of the first mode
+ * if none works.
+ */
+VixError JTransportProbe_Run(const VixDiskLibConnectParams *params,
+                             const char *ssMoref, const char *modes,
+                             const char *diskPath, const char *cacheKey,
+                             uint32 probeSectors, uint32 cacheSeconds,
+                             char **ordered, char **report, Bool *cached);
+
+/*
+ * Forget every result kept.
+ */
+void JTransportProbe_Flush(void);
+
+#endif // _JTRANSPORTPROBE_H_
@@ -70,6 +70,20 @@ jUtilsAsyncCallback *jUtils_CreateAsyncCallback(JNIEnv *env,
  */
 void jUtils_ReleaseAsyncCallback(jUtilsAsyncCallback *callbackInfo);
 
+/*
+ * Sector aligned scratch buffers of the calling thread. The I/O slot is used
+ * by the synchronous byte[] read and write paths, the input slot holds the
+ * source of a transformation whose output goes to the I/O slot.
+ */
+typedef enum {
+   JUtilsStagingSlotIo = 0,
+   JUtilsStagingSlotInput = 1,
+   JUtilsStagingSlotCount = 2,
+} JUtilsStagingSlot;
+
+uint8 *JUtils_GetStagingSlot(JUtilsStagingSlot slot, size_t size);
+uint8 *JUtils_GetStagingBuffer(size_t size);
+
 
 /*
  *
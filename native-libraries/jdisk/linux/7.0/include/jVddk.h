@@ -0,0 +1,52 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jVddk.h
+ *
+ *    Runtime loading of the installed VixDiskLib.
+ */
+
+#ifndef _JVDDK_H_
+#define _JVDDK_H_
+
+#include "vixDiskLib.h"
+
+/*
+ * What the VixDiskLib loaded provides natively. The VixDiskLib_* functions
+ * missing from an older VixDiskLib are emulated: the allocated blocks by
+ * reading the chunks and keeping the ones not zero, the asynchronous I/O
+ * by synchronous I/O completed before returning.
+ */
+#define JVDDK_CAP_QUERY_ALLOCATED   0x01   /* 6.7: QueryAllocatedBlocks */
+#define JVDDK_CAP_ASYNC_IO          0x02   /* ReadAsync, WriteAsync, Wait */
+#define JVDDK_CAP_CONNECT_PARAMS    0x04   /* 6.7: vStorageObject specs */
+#define JVDDK_CAP_SECTOR_SIZE       0x08   /* 7.0: sector sizes of GetInfo */
+#define JVDDK_CAP_FAULT_INJECTION   0x10   /* SetInjectedFault */
+
+/*
+ * Load libvixDiskLib.so from "libDir"/lib64, or from the library search
+ * path if not there, and resolve its functions. "major" and "minor" are
+ * the version of the VDDK installed. Loading again is a no-op. The
+ * VixDiskLib_* functions fail with VIX_E_FAIL until loaded.
+ */
+VixError JVddk_Load(const char *libDir, uint32 major, uint32 minor);
+
+/*
+ * Why the last JVddk_Load failed, NULL if it did not.
+ */
+const char *JVddk_LoadError(void);
+
+/*
+ * JVDDK_CAP_* mask of the VixDiskLib loaded, 0 if none.
+ */
+uint32 JVddk_Capabilities(void);
+
+/*
+ * Perturb_Enable of the VixDiskLib loaded: VIX_E_NOT_SUPPORTED if it does
+ * not export it.
+ */
+VixError JVddk_PerturbEnable(const char *fName, int enable);
+
+#endif // _JVDDK_H_
@@ -0,0 +1,228 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jAes.c
+ *
+ *    AES-128 ECB decryption with AES-NI.
+ *
+ *    ECB blocks are independent, so four of them are decrypted together to
+ *    hide the latency of the aesdec instruction.
+ */
+
+#include <string.h>
+#include <pthread.h>
+#include "jAes.h"
+
+#if defined(__x86_64__)
+#include <wmmintrin.h>
+#define JAES_HW 1
+#endif
+
+static Bool gSupported = FALSE;
+static pthread_once_t gInitOnce = PTHREAD_ONCE_INIT;
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JAesInit --
+ *
+ *      Check for AES-NI.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JAesInit(void)
+{
+#ifdef JAES_HW
+   __builtin_cpu_init();
+   gSupported = __builtin_cpu_supports("aes") ? TRUE : FALSE;
+#endif
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JAes_IsSupported --
+ *
+ *      See jAes.h.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+Bool
+JAes_IsSupported(void)
+{
+   pthread_once(&gInitOnce, JAesInit);
+   return gSupported;
+}
+
+
+#ifdef JAES_HW
+
+#define AESNI __attribute__((target("aes,sse2")))
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JAesExpandStep --
+ *
+ *      One step of the AES-128 key expansion, "assist" being the result of
+ *      aeskeygenassist on the previous round key.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static AESNI __m128i
+JAesExpandStep(__m128i key,      // IN
+               __m128i assist)   // IN
+{
+   assist = _mm_shuffle_epi32(assist, 0xff);
+   key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+   key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+   key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+   return _mm_xor_si128(key, assist);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JAesSetDecryptKeyHw --
+ *
+ *      Expand the encryption schedule and turn it into the schedule of the
+ *      equivalent inverse cipher.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static AESNI void
+JAesSetDecryptKeyHw(JAesKey *key,        // OUT
+                    const uint8 *raw)    // IN
+{
+   __m128i ek[11];
+   int i;
+
+   ek[0] = _mm_loadu_si128((const __m128i *)raw);
+   /* aeskeygenassist takes the round constant as an immediate */
+   ek[1] = JAesExpandStep(ek[0], _mm_aeskeygenassist_si128(ek[0], 0x01));
+   ek[2] = JAesExpandStep(ek[1], _mm_aeskeygenassist_si128(ek[1], 0x02));
+   ek[3] = JAesExpandStep(ek[2], _mm_aeskeygenassist_si128(ek[2], 0x04));
+   ek[4] = JAesExpandStep(ek[3], _mm_aeskeygenassist_si128(ek[3], 0x08));
+   ek[5] = JAesExpandStep(ek[4], _mm_aeskeygenassist_si128(ek[4], 0x10));
+   ek[6] = JAesExpandStep(ek[5], _mm_aeskeygenassist_si128(ek[5], 0x20));
+   ek[7] = JAesExpandStep(ek[6], _mm_aeskeygenassist_si128(ek[6], 0x40));
+   ek[8] = JAesExpandStep(ek[7], _mm_aeskeygenassist_si128(ek[7], 0x80));
+   ek[9] = JAesExpandStep(ek[8], _mm_aeskeygenassist_si128(ek[8], 0x1b));
+   ek[10] = JAesExpandStep(ek[9], _mm_aeskeygenassist_si128(ek[9], 0x36));
+
+   _mm_storeu_si128((__m128i *)key->rounds[0], ek[10]);
+   for (i = 1; i < 10; i++) {
+      _mm_storeu_si128((__m128i *)key->rounds[i], _mm_aesimc_si128(ek[10 - i]));
+   }
+   _mm_storeu_si128((__m128i *)key->rounds[10], ek[0]);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JAesDecryptEcbHw --
+ *
+ *      See JAes_DecryptEcb.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static AESNI void
+JAesDecryptEcbHw(const JAesKey *key,   // IN
+                 uint8 *buf,           // IN/OUT
+                 size_t length)        // IN
+{
+   __m128i rk[11];
+   size_t blocks = length / JAES_BLOCK_SIZE;
+   size_t b = 0;
+   int i;
+
+   for (i = 0; i < 11; i++) {
+      rk[i] = _mm_loadu_si128((const __m128i *)key->rounds[i]);
+   }
+   for (; b + 4 <= blocks; b += 4) {
+      __m128i *p = (__m128i *)(buf + b * JAES_BLOCK_SIZE);
+      __m128i s0 = _mm_xor_si128(_mm_loadu_si128(p), rk[0]);
+      __m128i s1 = _mm_xor_si128(_mm_loadu_si128(p + 1), rk[0]);
+      __m128i s2 = _mm_xor_si128(_mm_loadu_si128(p + 2), rk[0]);
+      __m128i s3 = _mm_xor_si128(_mm_loadu_si128(p + 3), rk[0]);
+
+      for (i = 1; i < 10; i++) {
+         s0 = _mm_aesdec_si128(s0, rk[i]);
+         s1 = _mm_aesdec_si128(s1, rk[i]);
+         s2 = _mm_aesdec_si128(s2, rk[i]);
+         s3 = _mm_aesdec_si128(s3, rk[i]);
+      }
+      _mm_storeu_si128(p, _mm_aesdeclast_si128(s0, rk[10]));
+      _mm_storeu_si128(p + 1, _mm_aesdeclast_si128(s1, rk[10]));
+      _mm_storeu_si128(p + 2, _mm_aesdeclast_si128(s2, rk[10]));
+      _mm_storeu_si128(p + 3, _mm_aesdeclast_si128(s3, rk[10]));
+   }
+   for (; b < blocks; b++) {
+      __m128i *p = (__m128i *)(buf + b * JAES_BLOCK_SIZE);
+      __m128i s = _mm_xor_si128(_mm_loadu_si128(p), rk[0]);
+
+      for (i = 1; i < 10; i++) {
+         s = _mm_aesdec_si128(s, rk[i]);
+      }
+      _mm_storeu_si128(p, _mm_aesdeclast_si128(s, rk[10]));
+   }
+}
+#endif // JAES_HW
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JAes_SetDecryptKey --
+ *
+ *      See jAes.h.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+Bool
+JAes_SetDecryptKey(JAesKey *key,        // OUT
+                   const uint8 *raw)    // IN
+{
+   if (!JAes_IsSupported()) {
+      return FALSE;
+   }
+#ifdef JAES_HW
+   JAesSetDecryptKeyHw(key, raw);
+#endif
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JAes_DecryptEcb --
+ *
+ *      See jAes.h. The key must come from a successful JAes_SetDecryptKey.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JAes_DecryptEcb(const JAesKey *key,    // IN
+                uint8 *buf,            // IN/OUT
+                size_t length)         // IN
+{
+#ifdef JAES_HW
+   JAesDecryptEcbHw(key, buf, length);
+#endif
+}
@@ -0,0 +1,597 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jArchiveDisk.c
+ *
+ *    Read-only block device over the archived blocks of a disk generation.
+ *
+ *    The disk is described by the consolidated extents of the generation,
+ *    each one a slice of an archived block stored in its own data file or
+ *    in a packfile. A read fetches the blocks under the range, decrypts and
+ *    decompresses them, and keeps the decoded blocks in an LRU cache: a
+ *    filesystem reader touches the same metadata blocks over and over, and
+ *    a file is usually read sequentially from a few large blocks.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "jArchiveDisk.h"
+#include "jAes.h"
+#include "jMiGz.h"
+
+
+typedef struct JArchiveBlock {
+   int extent;
+   uint8 *data;
+   size_t size;
+   struct JArchiveBlock *prev;      /* More recently used */
+   struct JArchiveBlock *next;      /* Less recently used */
+} JArchiveBlock;
+
+struct JArchiveDisk {
+   pthread_mutex_t lock;
+   pthread_cond_t loaded;           /* Signaled when a block is decoded */
+   JArchiveExtent *extents;
+   int count;
+   int64 capacity;
+   JAesKey key;
+   Bool hasKey;
+   JArchiveBlock **blocks;          /* Cached block of each extent, or NULL */
+   Bool *loading;                   /* Block of each extent being decoded */
+   JArchiveBlock *head;             /* Most recently used */
+   JArchiveBlock *tail;
+   size_t cacheSize;
+   size_t cached;                   /* Bytes of the cached blocks */
+};
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JArchiveDiskFind --
+ *
+ *      Find the last extent starting at or before "offset".
+ *
+ * Results:
+ *      Index of the extent, -1 if there is none.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static int
+JArchiveDiskFind(const JArchiveDisk *disk,   // IN
+                 int64 offset)               // IN
+{
+   int lo = 0;
+   int hi = disk->count - 1;
+   int found = -1;
+
+   while (lo <= hi) {
+      int mid = lo + (hi - lo) / 2;
+
+      if (disk->extents[mid].offset <= offset) {
+         found = mid;
+         lo = mid + 1;
+      } else {
+         hi = mid - 1;
+      }
+   }
+   return found;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JArchiveDiskFetch --
+ *
+ *      Read the stored data of an archived block.
+ *
+ * Results:
+ *      A malloc'ed buffer and its size, NULL on error.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static uint8 *
+JArchiveDiskFetch(const JArchiveExtent *extent,    // IN
+                  size_t *length)                  // OUT
+{
+   struct stat st;
+   uint8 *data;
+   size_t size;
+   size_t done = 0;
+   int fd;
+
+   fd = open(extent->path, O_RDONLY);
+   if (fd < 0) {
+      return NULL;
+   }
+   if (extent->storedLength > 0) {
+      size = (size_t)extent->storedLength;
+   } else if (fstat(fd, &st) == 0) {
+      size = (size_t)st.st_size;
+   } else {
+      close(fd);
+      return NULL;
+   }
+   data = malloc(size > 0 ? size : 1);
+   while (data != NULL && done < size) {
+      ssize_t n = pread(fd, data + done, size - done,
+                        extent->fileOffset + done);
+
+      if (n <= 0) {
+         free(data);
+         data = NULL;
+         break;
+      }
+      done += n;
+   }
+   close(fd);
+   *length = size;
+   return data;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JArchiveDiskDecode --
+ *
+ *      Fetch and decode the archived block of an extent.
+ *
+ * Results:
+ *      A new cache entry, NULL on error.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static JArchiveBlock *
+JArchiveDiskDecode(const JArchiveDisk *disk,  // IN
+                   int index)                 // IN
+{
+   const JArchiveExtent *extent = &disk->extents[index];
+   JArchiveBlock *block;
+   uint8 *data;
+   size_t length;
+
+   data = JArchiveDiskFetch(extent, &length);
+   if (data == NULL) {
+      return NULL;
+   }
+   if (extent->flags & JARCHIVE_CIPHER) {
+      if (!disk->hasKey || length % JAES_BLOCK_SIZE != 0 ||
+          extent->cipherOffset < 0 || (size_t)extent->cipherOffset > length) {
+         free(data);
+         return NULL;
+      }
+      JAes_DecryptEcb(&disk->key, data, length);
+      length -= extent->cipherOffset;
+   }
+   if (extent->flags & JARCHIVE_COMPRESS) {
+      uint8 *plain = malloc(extent->plainSize > 0 ? extent->plainSize : 1);
+
+      if (plain == NULL ||
+          JMiGz_Decode(data, length, plain, extent->plainSize, 1) !=
+             extent->plainSize) {
+         free(plain);
+         free(data);
+         return NULL;
+      }
+      free(data);
+      data = plain;
+      length = extent->plainSize;
+   }
+   if ((int64)length < extent->streamOffset + extent->length) {
+      free(data);
+      return NULL;
+   }
+
+   block = calloc(1, sizeof *block);
+   if (block == NULL) {
+      free(data);
+      return NULL;
+   }
+   block->extent = index;
+   block->data = data;
+   block->size = length;
+   return block;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JArchiveDiskUnlink --
+ *
+ *      Remove a block from the LRU list.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JArchiveDiskUnlink(JArchiveDisk *disk,       // IN/OUT
+                   JArchiveBlock *block)     // IN
+{
+   if (block->prev != NULL) {
+      block->prev->next = block->next;
+   } else {
+      disk->head = block->next;
+   }
+   if (block->next != NULL) {
+      block->next->prev = block->prev;
+   } else {
+      disk->tail = block->prev;
+   }
+   block->prev = NULL;
+   block->next = NULL;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JArchiveDiskInsert --
+ *
+ *      Make a block the most recently used one. Must be called with the
+ *      lock held.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      May evict the least recently used blocks.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JArchiveDiskInsert(JArchiveDisk *disk,       // IN/OUT
+                   JArchiveBlock *block)     // IN
+{
+   block->next = disk->head;
+   if (disk->head != NULL) {
+      disk->head->prev = block;
+   } else {
+      disk->tail = block;
+   }
+   disk->head = block;
+
+   while (disk->cached > disk->cacheSize && disk->tail != block) {
+      JArchiveBlock *old = disk->tail;
+
+      JArchiveDiskUnlink(disk, old);
+      disk->blocks[old->extent] = NULL;
+      disk->cached -= old->size;
+      free(old->data);
+      free(old);
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JArchiveDiskFill --
+ *
+ *      Decode the block of an extent and cache it. Must be called with the
+ *      lock held, the block neither cached nor being decoded. The lock is
+ *      released while the block is decoded: the extents never change once
+ *      open, and the other readers of the extent wait for the block.
+ *
+ * Results:
+ *      The block, NULL on error.
+ *
+ * Side effects:
+ *      May evict the least recently used blocks.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static JArchiveBlock *
+JArchiveDiskFill(JArchiveDisk *disk,  // IN/OUT
+                 int index)           // IN
+{
+   JArchiveBlock *block;
+
+   disk->loading[index] = TRUE;
+   pthread_mutex_unlock(&disk->lock);
+   block = JArchiveDiskDecode(disk, index);
+   pthread_mutex_lock(&disk->lock);
+   disk->loading[index] = FALSE;
+   pthread_cond_broadcast(&disk->loaded);
+   if (block != NULL) {
+      disk->blocks[index] = block;
+      disk->cached += block->size;
+      JArchiveDiskInsert(disk, block);
+   }
+   return block;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JArchiveDiskLoad --
+ *
+ *      Get the decoded block of an extent, from the cache or from the
+ *      target. Must be called with the lock held, which is released while
+ *      the block is decoded.
+ *
+ * Results:
+ *      The block, NULL on error. It stays cached until the lock is
+ *      released.
+ *
+ * Side effects:
+ *      May evict the least recently used blocks.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static JArchiveBlock *
+JArchiveDiskLoad(JArchiveDisk *disk,  // IN/OUT
+                 int index)           // IN
+{
+   for (;;) {
+      JArchiveBlock *block = disk->blocks[index];
+
+      if (block != NULL) {
+         JArchiveDiskUnlink(disk, block);
+         JArchiveDiskInsert(disk, block);
+         return block;
+      }
+      if (!disk->loading[index]) {
+         return JArchiveDiskFill(disk, index);
+      }
+      pthread_cond_wait(&disk->loaded, &disk->lock);
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JArchiveDisk_Open --
+ *
+ *      Open a disk over archived blocks. See jArchiveDisk.h.
+ *
+ * Results:
+ *      The disk, NULL on error.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JArchiveDisk *
+JArchiveDisk_Open(const JArchiveExtent *extents,   // IN
+                  int count,                       // IN
+                  const uint8 *key,                // IN: optional
+                  int64 capacity,                  // IN
+                  size_t cacheSize)                // IN
+{
+   JArchiveDisk *disk;
+   int i;
+
+   disk = calloc(1, sizeof *disk);
+   if (disk == NULL) {
+      return NULL;
+   }
+   pthread_mutex_init(&disk->lock, NULL);
+   pthread_cond_init(&disk->loaded, NULL);
+   if (key != NULL) {
+      if (!JAes_SetDecryptKey(&disk->key, key)) {
+         JArchiveDisk_Close(disk);
+         return NULL;
+      }
+      disk->hasKey = TRUE;
+   }
+   disk->extents = calloc(count > 0 ? count : 1, sizeof *disk->extents);
+   disk->blocks = calloc(count > 0 ? count : 1, sizeof *disk->blocks);
+   disk->loading = calloc(count > 0 ? count : 1, sizeof *disk->loading);
+   if (disk->extents == NULL || disk->blocks == NULL ||
+       disk->loading == NULL) {
+      JArchiveDisk_Close(disk);
+      return NULL;
+   }
+   for (i = 0; i < count; i++) {
+      disk->extents[i] = extents[i];
+      disk->extents[i].path = strdup(extents[i].path);
+      if (disk->extents[i].path == NULL) {
+         disk->count = i;
+         JArchiveDisk_Close(disk);
+         return NULL;
+      }
+   }
+   disk->count = count;
+   disk->capacity = capacity;
+   disk->cacheSize = cacheSize > 0 ? cacheSize : JARCHIVE_DEFAULT_CACHE_SIZE;
+   return disk;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JArchiveDisk_GetCapacity --
+ *
+ *      Size of the disk in bytes.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+int64
+JArchiveDisk_GetCapacity(const JArchiveDisk *disk) // IN
+{
+   return disk->capacity;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JArchiveDisk_Read --
+ *
+ *      Read a range of the disk. See jArchiveDisk.h.
+ *
+ * Results:
+ *      FALSE on error.
+ *
+ * Side effects:
+ *      Fills the block cache.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+Bool
+JArchiveDisk_Read(JArchiveDisk *disk,  // IN
+                  int64 offset,        // IN
+                  size_t length,       // IN
+                  uint8 *buf)          // OUT
+{
+   Bool ok = TRUE;
+
+   if (offset < 0 || offset > disk->capacity ||
+       (int64)length > disk->capacity - offset) {
+      return FALSE;
+   }
+   pthread_mutex_lock(&disk->lock);
+   while (length > 0) {
+      int i = JArchiveDiskFind(disk, offset);
+      const JArchiveExtent *extent = i >= 0 ? &disk->extents[i] : NULL;
+      size_t n;
+
+      if (extent == NULL || offset >= extent->offset + extent->length) {
+         int64 next = i + 1 < disk->count ? disk->extents[i + 1].offset
+                                          : disk->capacity;
+
+         n = next - offset < (int64)length ? (size_t)(next - offset) : length;
+         memset(buf, 0, n);
+      } else {
+         JArchiveBlock *block = JArchiveDiskLoad(disk, i);
+         int64 end = extent->offset + extent->length;
+
+         if (block == NULL) {
+            ok = FALSE;
+            break;
+         }
+         n = end - offset < (int64)length ? (size_t)(end - offset) : length;
+         memcpy(buf, block->data + extent->streamOffset +
+                (offset - extent->offset), n);
+      }
+      buf += n;
+      offset += n;
+      length -= n;
+   }
+   pthread_mutex_unlock(&disk->lock);
+   return ok;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JArchiveDisk_Prefetch --
+ *
+ *      Load the blocks under a range into the cache. See jArchiveDisk.h.
+ *
+ * Results:
+ *      FALSE on error.
+ *
+ * Side effects:
+ *      Fills the block cache.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+Bool
+JArchiveDisk_Prefetch(JArchiveDisk *disk,  // IN
+                      int64 offset,        // IN
+                      int64 length)        // IN
+{
+   int64 end;
+   int i;
+
+   if (offset < 0 || length <= 0 || offset >= disk->capacity) {
+      return TRUE;
+   }
+   end = length < disk->capacity - offset ? offset + length : disk->capacity;
+   i = JArchiveDiskFind(disk, offset);
+   if (i < 0 || offset >= disk->extents[i].offset + disk->extents[i].length) {
+      i++;
+   }
+   for (; i < disk->count && disk->extents[i].offset < end; i++) {
+      Bool ok = TRUE;
+
+      /* A block cached or being decoded by a reader is left alone */
+      pthread_mutex_lock(&disk->lock);
+      if (disk->blocks[i] == NULL && !disk->loading[i]) {
+         ok = JArchiveDiskFill(disk, i) != NULL;
+      }
+      pthread_mutex_unlock(&disk->lock);
+      if (!ok) {
+         return FALSE;
+      }
+   }
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JArchiveDisk_Close --
+ *
+ *      Release a disk and its cache.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JArchiveDisk_Close(JArchiveDisk *disk) // IN
+{
+   int i;
+
+   if (disk == NULL) {
+      return;
+   }
+   while (disk->head != NULL) {
+      JArchiveBlock *block = disk->head;
+
+      disk->head = block->next;
+      free(block->data);
+      free(block);
+   }
+   for (i = 0; i < disk->count; i++) {
+      free((char *)disk->extents[i].path);
+   }
+   pthread_cond_destroy(&disk->loaded);
+   pthread_mutex_destroy(&disk->lock);
+   memset(&disk->key, 0, sizeof disk->key);
+   free(disk->extents);
+   free(disk->blocks);
+   free(disk->loading);
+   free(disk);
+}
@@ -0,0 +1,635 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jAsyncQueue.c
+ *
+ *    Adaptive queue-depth controller for VixDiskLib async I/O.
+ *
+ *    Every disk handle gets an in-flight window. Completions feed a
+ *    smoothed latency and a throughput estimate:
+ *
+ *    - while the smoothed latency stays close to the baseline (minimum)
+ *      latency the window grows by one request per window of completions
+ *      (additive increase);
+ *    - when the latency climbs above the baseline by more than
+ *      LATENCY_TOLERANCE, or a request fails, the window shrinks by
+ *      DECREASE_FACTOR at most once per round trip (multiplicative
+ *      decrease);
+ *    - at the end of every throughput interval a window that grew without
+ *      improving throughput is pulled back, since the extra depth only
+ *      queues up on the ESXi side.
+ *
+ *    This lets every transport (NBD, NBDSSL, HotAdd, SAN) settle near its
+ *    own best concurrency inside [minDepth, maxDepth].
+ *
+ *    Some transports only deliver completions from VixDiskLib_Wait. Until
+ *    a completion arrives outside of it, a full window is pumped with
+ *    VixDiskLib_Wait right away rather than waited on.
+ *
+ *    A queue is referenced by the table, by every lookup in progress and
+ *    by every request in flight, and freed by the last of them.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "vixDiskLib.h"
+#include "jAsyncQueue.h"
+
+#define LATENCY_TOLERANCE 2.0      /* Congestion when latency > 2x baseline */
+#define DECREASE_FACTOR 0.7        /* Multiplicative decrease */
+#define LATENCY_EWMA_SHIFT 3       /* Smoothing weight 1/8 */
+#define BASELINE_SAMPLES 4096      /* Completions before re-probing baseline */
+#define THROUGHPUT_INTERVAL_US 1000000
+#define THROUGHPUT_MIN_GAIN 1.02   /* Growth must buy at least 2% */
+#define WAIT_SLOT_TIMEOUT_US 100000
+
+
+struct JAsyncQueue {
+   VixDiskLibHandle diskHandle;
+   pthread_mutex_t lock;
+   pthread_cond_t slotFree;
+   uint32 minDepth;
+   uint32 maxDepth;
+   uint32 inFlight;
+   double window;
+   double latencyUs;           /* EWMA of completion latency */
+   double minLatencyUs;        /* Baseline latency */
+   uint64 baselineAge;         /* Completions since baseline was set */
+   uint64 lastDecreaseUs;
+   uint64 intervalStartUs;
+   uint64 intervalBytes;
+   double intervalWindow;      /* Window at the start of the interval */
+   int64 bytesPerSec;
+   uint64 completed;
+   uint64 errors;
+   uint32 refs;                /* Table, lookups and requests in flight */
+   Bool pumping;               /* A thread is in VixDiskLib_Wait */
+   Bool completesAlone;        /* Completions arrive outside of Wait */
+   struct JAsyncQueue *next;
+};
+
+struct JAsyncQueueRequest {
+   struct JAsyncQueue *queue;
+   uint64 startUs;
+   uint64 bytes;
+   VixDiskLibCompletionCB userCB;
+   void *userData;
+};
+
+static pthread_mutex_t gTableLock = PTHREAD_MUTEX_INITIALIZER;
+static struct JAsyncQueue *gQueues = NULL;
+static uint32 gDefaultMinDepth = JASYNCQUEUE_DEFAULT_MIN_DEPTH;
+static uint32 gDefaultMaxDepth = JASYNCQUEUE_DEFAULT_MAX_DEPTH;
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JAsyncQueueNowUs --
+ *
+ *      Read the monotonic clock.
+ *
+ * Results:
+ *      Current time in microseconds.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static uint64
+JAsyncQueueNowUs(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JAsyncQueueClamp --
+ *
+ *      Keep the window of a queue within its bounds. Must be called with
+ *      the queue lock held.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      May change queue->window.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JAsyncQueueClamp(struct JAsyncQueue *queue) // IN/OUT
+{
+   if (queue->window < queue->minDepth) {
+      queue->window = queue->minDepth;
+   }
+   if (queue->window > queue->maxDepth) {
+      queue->window = queue->maxDepth;
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JAsyncQueueLookup --
+ *
+ *      Find the queue of a disk handle, optionally creating it.
+ *
+ * Results:
+ *      The queue or NULL. The caller owns a reference to the queue, given
+ *      back with JAsyncQueuePut.
+ *
+ * Side effects:
+ *      May allocate a new queue.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static struct JAsyncQueue *
+JAsyncQueueLookup(VixDiskLibHandle diskHandle, // IN
+                  Bool create)                 // IN
+{
+   struct JAsyncQueue *queue;
+
+   pthread_mutex_lock(&gTableLock);
+   for (queue = gQueues; queue != NULL; queue = queue->next) {
+      if (queue->diskHandle == diskHandle) {
+         break;
+      }
+   }
+   if (queue == NULL && create) {
+      queue = calloc(1, sizeof *queue);
+      if (queue != NULL) {
+         queue->diskHandle = diskHandle;
+         pthread_mutex_init(&queue->lock, NULL);
+         pthread_cond_init(&queue->slotFree, NULL);
+         queue->minDepth = gDefaultMinDepth;
+         queue->maxDepth = gDefaultMaxDepth;
+         queue->window = gDefaultMinDepth;
+         queue->intervalStartUs = JAsyncQueueNowUs();
+         queue->intervalWindow = queue->window;
+         queue->refs = 1;
+         queue->next = gQueues;
+         gQueues = queue;
+      }
+   }
+   if (queue != NULL) {
+      __sync_fetch_and_add(&queue->refs, 1);
+   }
+   pthread_mutex_unlock(&gTableLock);
+   return queue;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JAsyncQueuePut --
+ *
+ *      Give back a reference to a queue.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Frees the queue with its last reference, once it is no longer in
+ *      the table.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JAsyncQueuePut(struct JAsyncQueue *queue) // IN
+{
+   if (__sync_sub_and_fetch(&queue->refs, 1) == 0) {
+      pthread_cond_destroy(&queue->slotFree);
+      pthread_mutex_destroy(&queue->lock);
+      free(queue);
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JAsyncQueueUpdate --
+ *
+ *      Feed one completion to the controller. Must be called with the
+ *      queue lock held.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Updates latency, throughput and window of the queue.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JAsyncQueueUpdate(struct JAsyncQueue *queue, // IN/OUT
+                  uint64 latencyUs,          // IN
+                  uint64 bytes,              // IN
+                  VixError result,           // IN
+                  uint64 nowUs)              // IN
+{
+   Bool congested;
+
+   if (queue->latencyUs == 0) {
+      queue->latencyUs = latencyUs;
+   } else {
+      queue->latencyUs += ((double)latencyUs - queue->latencyUs) /
+                          (1 << LATENCY_EWMA_SHIFT);
+   }
+
+   /*
+    * The baseline only goes down on its own. Re-probe it from the smoothed
+    * latency now and then, so that a path that got permanently slower
+    * (e.g. vMotion of the VM) does not look congested forever.
+    */
+   if (queue->minLatencyUs == 0 || latencyUs < queue->minLatencyUs) {
+      queue->minLatencyUs = latencyUs;
+      queue->baselineAge = 0;
+   } else if (++queue->baselineAge > BASELINE_SAMPLES) {
+      queue->minLatencyUs = queue->latencyUs;
+      queue->baselineAge = 0;
+   }
+
+   congested = result != VIX_OK ||
+               queue->latencyUs > queue->minLatencyUs * LATENCY_TOLERANCE;
+   if (congested) {
+      if (nowUs - queue->lastDecreaseUs > (uint64)queue->latencyUs) {
+         queue->window *= DECREASE_FACTOR;
+         queue->lastDecreaseUs = nowUs;
+      }
+   } else {
+      queue->window += 1.0 / queue->window;
+   }
+
+   queue->intervalBytes += bytes;
+   if (nowUs - queue->intervalStartUs >= THROUGHPUT_INTERVAL_US) {
+      int64 bytesPerSec = (int64)(queue->intervalBytes * 1000000 /
+                                  (nowUs - queue->intervalStartUs));
+
+      if (queue->window >= queue->intervalWindow + 1 &&
+          bytesPerSec < queue->bytesPerSec * THROUGHPUT_MIN_GAIN) {
+         queue->window = queue->intervalWindow;
+      }
+      queue->bytesPerSec = bytesPerSec;
+      queue->intervalBytes = 0;
+      queue->intervalStartUs = nowUs;
+      queue->intervalWindow = queue->window;
+   }
+   JAsyncQueueClamp(queue);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JAsyncQueue_Begin --
+ *
+ *      Reserve a slot in the in-flight window of a disk handle, waiting
+ *      for one to become available.
+ *
+ *      A full window is pumped with VixDiskLib_Wait at once, unless the
+ *      transport delivered completions on its own; then only if none
+ *      arrives while waiting.
+ *
+ * Results:
+ *      A request to pass as cbData to JAsyncQueue_CompletionCB, or NULL
+ *      if out of memory.
+ *
+ * Side effects:
+ *      May block.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JAsyncQueueRequest *
+JAsyncQueue_Begin(VixDiskLibHandle diskHandle,    // IN
+                  uint32 sectorCount,             // IN
+                  VixDiskLibCompletionCB userCB,  // IN
+                  void *userData)                 // IN
+{
+   struct JAsyncQueue *queue;
+   JAsyncQueueRequest *request;
+
+   request = malloc(sizeof *request);
+   if (request == NULL) {
+      return NULL;
+   }
+   queue = JAsyncQueueLookup(diskHandle, TRUE);
+   if (queue == NULL) {
+      free(request);
+      return NULL;
+   }
+
+   pthread_mutex_lock(&queue->lock);
+   while (queue->inFlight >= (uint32)queue->window) {
+      uint64 completed = queue->completed;
+      struct timespec deadline;
+      int rc = ETIMEDOUT;
+
+      if (queue->completesAlone || queue->pumping) {
+         clock_gettime(CLOCK_REALTIME, &deadline);
+         deadline.tv_nsec += WAIT_SLOT_TIMEOUT_US * 1000;
+         if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+         }
+         rc = pthread_cond_timedwait(&queue->slotFree, &queue->lock,
+                                     &deadline);
+      }
+      if (rc == ETIMEDOUT && !queue->pumping &&
+          queue->completed == completed &&
+          queue->inFlight >= (uint32)queue->window) {
+         queue->pumping = TRUE;
+         pthread_mutex_unlock(&queue->lock);
+         VixDiskLib_Wait(diskHandle);
+         pthread_mutex_lock(&queue->lock);
+         queue->pumping = FALSE;
+         pthread_cond_broadcast(&queue->slotFree);
+      }
+   }
+   /* The reference of the lookup goes with the request */
+   queue->inFlight++;
+   pthread_mutex_unlock(&queue->lock);
+
+   request->queue = queue;
+   request->startUs = JAsyncQueueNowUs();
+   request->bytes = (uint64)sectorCount * VIXDISKLIB_SECTOR_SIZE;
+   request->userCB = userCB;
+   request->userData = userData;
+   return request;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JAsyncQueueEnd --
+ *
+ *      Give back the slot of a request.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Wakes up waiters, may free a released queue.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JAsyncQueueEnd(JAsyncQueueRequest *request, // IN
+               Bool completed,              // IN
+               VixError result)             // IN
+{
+   struct JAsyncQueue *queue = request->queue;
+
+   pthread_mutex_lock(&queue->lock);
+   queue->inFlight--;
+   if (completed) {
+      uint64 nowUs = JAsyncQueueNowUs();
+
+      if (!queue->pumping) {
+         queue->completesAlone = TRUE;
+      }
+      queue->completed++;
+      if (result != VIX_OK) {
+         queue->errors++;
+      }
+      JAsyncQueueUpdate(queue, nowUs - request->startUs, request->bytes,
+                        result, nowUs);
+   }
+   pthread_cond_broadcast(&queue->slotFree);
+   pthread_mutex_unlock(&queue->lock);
+   JAsyncQueuePut(queue);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JAsyncQueue_CompletionCB --
+ *
+ *      VixDiskLibCompletionCB wrapper: update the controller and forward
+ *      to the callback given to JAsyncQueue_Begin.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Frees the request.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JAsyncQueue_CompletionCB(void *cbData,    // IN
+                         VixError result) // IN
+{
+   JAsyncQueueRequest *request = cbData;
+   VixDiskLibCompletionCB userCB = request->userCB;
+   void *userData = request->userData;
+
+   JAsyncQueueEnd(request, TRUE, result);
+   free(request);
+   if (userCB != NULL) {
+      userCB(userData, result);
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JAsyncQueue_Abort --
+ *
+ *      Give back the slot of a request that was never issued.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Frees the request. The user callback is not called.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JAsyncQueue_Abort(JAsyncQueueRequest *request) // IN
+{
+   JAsyncQueueEnd(request, FALSE, VIX_OK);
+   free(request);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JAsyncQueue_SetDefaultBounds --
+ *
+ *      Set the window bounds used for disk handles opened from now on.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JAsyncQueue_SetDefaultBounds(uint32 minDepth, // IN
+                             uint32 maxDepth) // IN
+{
+   if (minDepth == 0) {
+      minDepth = 1;
+   }
+   if (maxDepth < minDepth) {
+      maxDepth = minDepth;
+   }
+   pthread_mutex_lock(&gTableLock);
+   gDefaultMinDepth = minDepth;
+   gDefaultMaxDepth = maxDepth;
+   pthread_mutex_unlock(&gTableLock);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JAsyncQueue_SetBounds --
+ *
+ *      Set the window bounds of one disk handle.
+ *
+ * Results:
+ *      TRUE on success, FALSE if out of memory.
+ *
+ * Side effects:
+ *      The current window is clamped to the new bounds.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+Bool
+JAsyncQueue_SetBounds(VixDiskLibHandle diskHandle, // IN
+                      uint32 minDepth,             // IN
+                      uint32 maxDepth)             // IN
+{
+   struct JAsyncQueue *queue = JAsyncQueueLookup(diskHandle, TRUE);
+
+   if (queue == NULL) {
+      return FALSE;
+   }
+   if (minDepth == 0) {
+      minDepth = 1;
+   }
+   if (maxDepth < minDepth) {
+      maxDepth = minDepth;
+   }
+   pthread_mutex_lock(&queue->lock);
+   queue->minDepth = minDepth;
+   queue->maxDepth = maxDepth;
+   JAsyncQueueClamp(queue);
+   pthread_cond_broadcast(&queue->slotFree);
+   pthread_mutex_unlock(&queue->lock);
+   JAsyncQueuePut(queue);
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JAsyncQueue_GetStats --
+ *
+ *      Snapshot the controller state of a disk handle.
+ *
+ * Results:
+ *      TRUE if the handle has issued async I/O, FALSE otherwise.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+Bool
+JAsyncQueue_GetStats(VixDiskLibHandle diskHandle,        // IN
+                     int64 stats[JAsyncQueueStatCount])  // OUT
+{
+   struct JAsyncQueue *queue = JAsyncQueueLookup(diskHandle, FALSE);
+
+   memset(stats, 0, JAsyncQueueStatCount * sizeof stats[0]);
+   if (queue == NULL) {
+      return FALSE;
+   }
+   pthread_mutex_lock(&queue->lock);
+   stats[JAsyncQueueStatWindow] = (int64)queue->window;
+   stats[JAsyncQueueStatInFlight] = queue->inFlight;
+   stats[JAsyncQueueStatLatencyUs] = (int64)queue->latencyUs;
+   stats[JAsyncQueueStatMinLatencyUs] = (int64)queue->minLatencyUs;
+   stats[JAsyncQueueStatBytesPerSec] = queue->bytesPerSec;
+   stats[JAsyncQueueStatCompleted] = queue->completed;
+   stats[JAsyncQueueStatErrors] = queue->errors;
+   pthread_mutex_unlock(&queue->lock);
+   JAsyncQueuePut(queue);
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JAsyncQueue_Release --
+ *
+ *      Drop the state of a disk handle. If requests are still in flight,
+ *      or another thread is using the queue, the last of them frees it.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Frees memory.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JAsyncQueue_Release(VixDiskLibHandle diskHandle) // IN
+{
+   struct JAsyncQueue **link;
+   struct JAsyncQueue *queue = NULL;
+
+   pthread_mutex_lock(&gTableLock);
+   for (link = &gQueues; *link != NULL; link = &(*link)->next) {
+      if ((*link)->diskHandle == diskHandle) {
+         queue = *link;
+         *link = queue->next;
+         break;
+      }
+   }
+   pthread_mutex_unlock(&gTableLock);
+   if (queue != NULL) {
+      /* The reference of the table */
+      JAsyncQueuePut(queue);
+   }
+}
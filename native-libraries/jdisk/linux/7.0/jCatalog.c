@@ -0,0 +1,743 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jCatalog.c
+ *
+ *    Catalog of the files of a guest filesystem, built at backup time.
+ *
+ *    The filesystem is walked from the root directory by directory, each
+ *    entry becoming a record with its path, size, mtime and the extents of
+ *    its data on the disk. The records are then sorted by path and written
+ *    front coded, each path keeping only what differs from the previous
+ *    one, with a restart every JCATALOG_RESTART_INTERVAL records: a reader
+ *    binary searches the restarts and decodes a handful of records to find
+ *    a path, without touching the disk.
+ *
+ *    When built from a disk being backed up, only the metadata blocks are
+ *    read (superblock, group descriptors, inode tables, directories and
+ *    extent tree nodes), in chunks kept in a direct mapped cache.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "jCatalog.h"
+#include "jThrottle.h"
+#include "jDiskd.h"
+
+#define JCATALOG_PATH_MAX 4096
+
+#define JCATALOG_CHUNK_SECTORS 128                   /* 64KB */
+#define JCATALOG_CHUNK_SIZE (JCATALOG_CHUNK_SECTORS * VIXDISKLIB_SECTOR_SIZE)
+#define JCATALOG_DEFAULT_CACHE_SIZE (16 * 1024 * 1024)
+
+/*
+ * A corrupt filesystem must not hold the backup: past these limits the
+ * catalog of the disk is given up.
+ */
+#define JCATALOG_MAX_RECORDS (64 * 1024 * 1024)
+#define JCATALOG_MAX_ELAPSED_US (30 * 60 * (int64)1000000)
+#define JCATALOG_CLOCK_INTERVAL 4096                 /* Records */
+
+
+typedef struct JCatalogRecord {
+   char *path;
+   uint32 type;
+   uint32 mode;
+   int64 size;
+   int64 mtime;
+   size_t firstExtent;
+   size_t extents;
+} JCatalogRecord;
+
+typedef struct JCatalogExtent {
+   int64 fileOffset;
+   int64 diskOffset;
+   int64 length;
+} JCatalogExtent;
+
+typedef struct JCatalogDir {
+   char *path;
+   uint32 inode;
+} JCatalogDir;
+
+typedef struct JCatalogBuilder {
+   JGuestFs *fs;
+   const char *parent;              /* Path of the directory being listed */
+   JCatalogRecord *records;
+   size_t recordCount;
+   size_t recordCapacity;
+   JCatalogExtent *extents;
+   size_t extentCount;
+   size_t extentCapacity;
+   JCatalogDir *dirs;               /* Directories left to list */
+   size_t dirCount;
+   size_t dirCapacity;
+   uint32 *visited;                 /* Open addressing set of directories */
+   size_t visitedCount;
+   size_t visitedCapacity;          /* Power of 2 */
+   int64 deadline;                  /* JCatalogNowUs */
+   VixError err;
+} JCatalogBuilder;
+
+typedef struct JCatalogBuf {
+   uint8 *data;
+   size_t size;
+   size_t capacity;
+   Bool failed;
+} JCatalogBuf;
+
+/*
+ * JGuestFsReadFunc over a VixDiskLib disk.
+ */
+typedef struct JCatalogDisk {
+   VixDiskLibHandle handle;
+   Bool remote;                     /* A disk of jdiskd */
+   int64 capacity;                  /* Bytes */
+   uint8 *cache;
+   int64 *chunks;                   /* Chunk held by each slot, -1 if none */
+   size_t slots;
+   int64 bytesRead;
+} JCatalogDisk;
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCatalogNowUs --
+ *
+ *      Monotonic time in microseconds.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static int64
+JCatalogNowUs(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (int64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCatalogGrow --
+ *
+ *      Make room for one more element in a growable array.
+ *
+ * Results:
+ *      FALSE if out of memory.
+ *
+ * Side effects:
+ *      May move the array.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JCatalogGrow(void **array,          // IN/OUT
+             size_t *capacity,      // IN/OUT
+             size_t count,          // IN
+             size_t elementSize)    // IN
+{
+   size_t newCapacity;
+   void *grown;
+
+   if (count < *capacity) {
+      return TRUE;
+   }
+   newCapacity = *capacity > 0 ? *capacity * 2 : 256;
+   grown = realloc(*array, newCapacity * elementSize);
+   if (grown == NULL) {
+      return FALSE;
+   }
+   *array = grown;
+   *capacity = newCapacity;
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCatalogVisit --
+ *
+ *      Add a directory to the set of the directories already queued.
+ *
+ * Results:
+ *      FALSE if it is already in the set, a loop of a corrupt filesystem,
+ *      or if out of memory.
+ *
+ * Side effects:
+ *      May grow the set.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JCatalogVisit(JCatalogBuilder *builder,   // IN/OUT
+              uint32 inode)               // IN
+{
+   size_t mask;
+   size_t i;
+
+   if (2 * (builder->visitedCount + 1) > builder->visitedCapacity) {
+      size_t capacity = builder->visitedCapacity > 0 ?
+                        builder->visitedCapacity * 2 : 1024;
+      uint32 *visited = calloc(capacity, sizeof *visited);
+
+      if (visited == NULL) {
+         builder->err = VIX_E_OUT_OF_MEMORY;
+         return FALSE;
+      }
+      for (i = 0; i < builder->visitedCapacity; i++) {
+         uint32 old = builder->visited[i];
+
+         if (old != 0) {
+            size_t j = (old * 2654435761u) & (capacity - 1);
+
+            while (visited[j] != 0) {
+               j = (j + 1) & (capacity - 1);
+            }
+            visited[j] = old;
+         }
+      }
+      free(builder->visited);
+      builder->visited = visited;
+      builder->visitedCapacity = capacity;
+   }
+   /* Inode 0 does not exist, it marks the free slots */
+   mask = builder->visitedCapacity - 1;
+   for (i = (inode * 2654435761u) & mask; builder->visited[i] != 0;
+        i = (i + 1) & mask) {
+      if (builder->visited[i] == inode) {
+         return FALSE;
+      }
+   }
+   builder->visited[i] = inode;
+   builder->visitedCount++;
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCatalogMapCB --
+ *
+ *      JGuestFsMapFunc adding an extent to the last record.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JCatalogMapCB(void *data,           // IN: JCatalogBuilder
+              int64 fileOffset,     // IN
+              int64 diskOffset,     // IN
+              int64 length)         // IN
+{
+   JCatalogBuilder *builder = data;
+   JCatalogExtent *extent;
+
+   if (!JCatalogGrow((void **)&builder->extents, &builder->extentCapacity,
+                     builder->extentCount, sizeof *builder->extents)) {
+      builder->err = VIX_E_OUT_OF_MEMORY;
+      return FALSE;
+   }
+   extent = &builder->extents[builder->extentCount++];
+   extent->fileOffset = fileOffset;
+   extent->diskOffset = diskOffset;
+   extent->length = length;
+   builder->records[builder->recordCount - 1].extents++;
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCatalogListCB --
+ *
+ *      JGuestFsListFunc adding a record for an entry of the directory being
+ *      listed, and queueing the subdirectories.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JCatalogListCB(void *data,                   // IN: JCatalogBuilder
+               const JGuestFsEntry *entry)   // IN
+{
+   JCatalogBuilder *builder = data;
+   size_t parentLength = strlen(builder->parent);
+   size_t nameLength = strlen(entry->name);
+   JCatalogRecord *record;
+   char *path;
+
+   if (parentLength + 1 + nameLength >= JCATALOG_PATH_MAX) {
+      /* Only a corrupt filesystem nests that deep */
+      return TRUE;
+   }
+   if (builder->recordCount >= JCATALOG_MAX_RECORDS) {
+      builder->err = VIX_E_DISK_INVAL;
+      return FALSE;
+   }
+   if (builder->recordCount % JCATALOG_CLOCK_INTERVAL == 0 &&
+       JCatalogNowUs() > builder->deadline) {
+      builder->err = VIX_E_CANCELLED;
+      return FALSE;
+   }
+   path = malloc(parentLength + 1 + nameLength + 1);
+   if (path == NULL ||
+       !JCatalogGrow((void **)&builder->records, &builder->recordCapacity,
+                     builder->recordCount, sizeof *builder->records)) {
+      free(path);
+      builder->err = VIX_E_OUT_OF_MEMORY;
+      return FALSE;
+   }
+   memcpy(path, builder->parent, parentLength);
+   path[parentLength] = '/';
+   memcpy(path + parentLength + 1, entry->name, nameLength + 1);
+
+   record = &builder->records[builder->recordCount++];
+   record->path = path;
+   record->type = entry->type;
+   record->mode = entry->mode;
+   record->size = entry->size;
+   record->mtime = entry->mtime;
+   record->firstExtent = builder->extentCount;
+   record->extents = 0;
+
+   if (entry->type == JGuestFsDirectory) {
+      if (!JCatalogVisit(builder, entry->inode)) {
+         /* Listed once already: recorded, not walked again */
+         return builder->err == VIX_OK;
+      }
+      if (!JCatalogGrow((void **)&builder->dirs, &builder->dirCapacity,
+                        builder->dirCount, sizeof *builder->dirs)) {
+         builder->err = VIX_E_OUT_OF_MEMORY;
+         return FALSE;
+      }
+      builder->dirs[builder->dirCount].path = path;
+      builder->dirs[builder->dirCount].inode = entry->inode;
+      builder->dirCount++;
+   } else if (entry->type == JGuestFsFile) {
+      VixError err = JGuestFs_Map(builder->fs, entry->inode, &JCatalogMapCB,
+                                  builder);
+
+      if (err != VIX_OK) {
+         builder->err = err;
+      }
+      if (builder->err != VIX_OK) {
+         return FALSE;
+      }
+   }
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCatalogCompare --
+ *
+ *      qsort comparator of records by path.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static int
+JCatalogCompare(const void *a,   // IN
+                const void *b)   // IN
+{
+   return strcmp(((const JCatalogRecord *)a)->path,
+                 ((const JCatalogRecord *)b)->path);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCatalogPut --
+ *
+ *      Append bytes to the catalog being written.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JCatalogPut(JCatalogBuf *buf,      // IN/OUT
+            const void *data,      // IN
+            size_t length)         // IN
+{
+   if (buf->failed) {
+      return;
+   }
+   if (buf->size + length > buf->capacity) {
+      size_t capacity = buf->capacity > 0 ? buf->capacity : 64 * 1024;
+      uint8 *grown;
+
+      while (capacity < buf->size + length) {
+         capacity *= 2;
+      }
+      grown = realloc(buf->data, capacity);
+      if (grown == NULL) {
+         buf->failed = TRUE;
+         return;
+      }
+      buf->data = grown;
+      buf->capacity = capacity;
+   }
+   memcpy(buf->data + buf->size, data, length);
+   buf->size += length;
+}
+
+
+static void
+JCatalogPut32(JCatalogBuf *buf,    // IN/OUT
+              uint32 value)        // IN
+{
+   uint8 raw[4];
+
+   raw[0] = value;
+   raw[1] = value >> 8;
+   raw[2] = value >> 16;
+   raw[3] = value >> 24;
+   JCatalogPut(buf, raw, sizeof raw);
+}
+
+
+static void
+JCatalogPutVarint(JCatalogBuf *buf,    // IN/OUT
+                  uint64 value)        // IN
+{
+   uint8 raw[10];
+   size_t n = 0;
+
+   while (value >= 0x80) {
+      raw[n++] = (uint8)(value | 0x80);
+      value >>= 7;
+   }
+   raw[n++] = (uint8)value;
+   JCatalogPut(buf, raw, n);
+}
+
+
+static void
+JCatalogPutSigned(JCatalogBuf *buf,    // IN/OUT
+                  int64 value)         // IN
+{
+   JCatalogPutVarint(buf, ((uint64)value << 1) ^ (uint64)(value >> 63));
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCatalogEncode --
+ *
+ *      Write the sorted records. See jCatalog.h for the layout.
+ *
+ * Results:
+ *      FALSE if out of memory.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JCatalogEncode(const JCatalogBuilder *builder,   // IN
+               JCatalogBuf *buf)                 // OUT
+{
+   size_t restarts = (builder->recordCount + JCATALOG_RESTART_INTERVAL - 1) /
+                     JCATALOG_RESTART_INTERVAL;
+   uint32 *offsets;
+   const char *previous = "";
+   size_t i;
+
+   offsets = malloc((restarts > 0 ? restarts : 1) * sizeof *offsets);
+   if (offsets == NULL) {
+      return FALSE;
+   }
+   JCatalogPut32(buf, JCATALOG_MAGIC);
+   JCatalogPut32(buf, JCATALOG_VERSION);
+   JCatalogPut32(buf, (uint32)builder->recordCount);
+   JCatalogPut32(buf, (uint32)restarts);
+
+   for (i = 0; i < builder->recordCount; i++) {
+      const JCatalogRecord *record = &builder->records[i];
+      size_t length = strlen(record->path);
+      size_t shared = 0;
+      int64 fileEnd = 0;
+      int64 diskEnd = 0;
+      size_t j;
+
+      if (i % JCATALOG_RESTART_INTERVAL == 0) {
+         offsets[i / JCATALOG_RESTART_INTERVAL] = (uint32)buf->size;
+      } else {
+         while (previous[shared] != '\0' &&
+                previous[shared] == record->path[shared]) {
+            shared++;
+         }
+      }
+      JCatalogPutVarint(buf, shared);
+      JCatalogPutVarint(buf, length - shared);
+      JCatalogPut(buf, record->path + shared, length - shared);
+      JCatalogPutVarint(buf, record->type);
+      JCatalogPutVarint(buf, record->mode);
+      JCatalogPutVarint(buf, (uint64)record->size);
+      JCatalogPutSigned(buf, record->mtime);
+      JCatalogPutVarint(buf, record->extents);
+      for (j = 0; j < record->extents; j++) {
+         const JCatalogExtent *extent =
+            &builder->extents[record->firstExtent + j];
+
+         JCatalogPutVarint(buf, (uint64)(extent->fileOffset - fileEnd));
+         JCatalogPutSigned(buf, extent->diskOffset - diskEnd);
+         JCatalogPutVarint(buf, (uint64)extent->length);
+         fileEnd = extent->fileOffset + extent->length;
+         diskEnd = extent->diskOffset + extent->length;
+      }
+      previous = record->path;
+   }
+   for (i = 0; i < restarts; i++) {
+      JCatalogPut32(buf, offsets[i]);
+   }
+   free(offsets);
+   return !buf->failed;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCatalog_Build --
+ *
+ *      Build the catalog of a filesystem. See jCatalog.h.
+ *
+ * Results:
+ *      VixError.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JCatalog_Build(JGuestFs *fs,          // IN
+               uint8 **catalog,       // OUT
+               size_t *size)          // OUT
+{
+   JCatalogBuilder builder;
+   JCatalogBuf buf;
+   size_t i;
+
+   *catalog = NULL;
+   *size = 0;
+   memset(&builder, 0, sizeof builder);
+   memset(&buf, 0, sizeof buf);
+   builder.fs = fs;
+   builder.deadline = JCatalogNowUs() + JCATALOG_MAX_ELAPSED_US;
+
+   builder.parent = "";
+   if (JCatalogVisit(&builder, JGUESTFS_ROOT_INODE)) {
+      builder.err = JGuestFs_List(fs, JGUESTFS_ROOT_INODE, &JCatalogListCB,
+                                  &builder);
+   }
+   while (builder.err == VIX_OK && builder.dirCount > 0) {
+      JCatalogDir dir = builder.dirs[--builder.dirCount];
+      VixError err;
+
+      builder.parent = dir.path;
+      err = JGuestFs_List(fs, dir.inode, &JCatalogListCB, &builder);
+      if (builder.err == VIX_OK) {
+         builder.err = err;
+      }
+   }
+
+   if (builder.err == VIX_OK) {
+      qsort(builder.records, builder.recordCount, sizeof *builder.records,
+            &JCatalogCompare);
+      if (JCatalogEncode(&builder, &buf)) {
+         *catalog = buf.data;
+         *size = buf.size;
+         buf.data = NULL;
+      } else {
+         builder.err = VIX_E_OUT_OF_MEMORY;
+      }
+   }
+
+   free(buf.data);
+   for (i = 0; i < builder.recordCount; i++) {
+      free(builder.records[i].path);
+   }
+   free(builder.records);
+   free(builder.extents);
+   free(builder.dirs);
+   free(builder.visited);
+   return builder.err;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCatalogDiskRead --
+ *
+ *      JGuestFsReadFunc over a VixDiskLib disk, through the chunk cache.
+ *
+ * Results:
+ *      FALSE if the range is past the capacity or cannot be read.
+ *
+ * Side effects:
+ *      Fills the cache.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JCatalogDiskRead(void *data,       // IN: JCatalogDisk
+                 int64 offset,     // IN
+                 size_t length,    // IN
+                 uint8 *buf)       // OUT
+{
+   JCatalogDisk *disk = data;
+
+   if (offset < 0 || offset > disk->capacity ||
+       (int64)length > disk->capacity - offset) {
+      return FALSE;
+   }
+   while (length > 0) {
+      int64 chunk = offset / JCATALOG_CHUNK_SIZE;
+      size_t slot = (size_t)(chunk % disk->slots);
+      uint8 *cached = disk->cache + slot * JCATALOG_CHUNK_SIZE;
+      size_t within = (size_t)(offset % JCATALOG_CHUNK_SIZE);
+      size_t n = JCATALOG_CHUNK_SIZE - within;
+
+      if (n > length) {
+         n = length;
+      }
+      if (disk->chunks[slot] != chunk) {
+         VixDiskLibSectorType start = chunk * JCATALOG_CHUNK_SECTORS;
+         VixDiskLibSectorType count = disk->capacity / VIXDISKLIB_SECTOR_SIZE -
+                                      start;
+
+         if (count > JCATALOG_CHUNK_SECTORS) {
+            count = JCATALOG_CHUNK_SECTORS;
+         }
+         JThrottle_Consume(disk->handle, count * VIXDISKLIB_SECTOR_SIZE);
+         if ((disk->remote ?
+              JDiskd_Read(disk->handle, start, count, cached) :
+              VixDiskLib_Read(disk->handle, start, count, cached)) != VIX_OK) {
+            disk->chunks[slot] = -1;
+            return FALSE;
+         }
+         disk->chunks[slot] = chunk;
+         disk->bytesRead += count * VIXDISKLIB_SECTOR_SIZE;
+      }
+      memcpy(buf, cached + within, n);
+      buf += n;
+      offset += n;
+      length -= n;
+   }
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCatalog_BuildFromDisk --
+ *
+ *      Build the catalog of the filesystem of an open disk. See
+ *      jCatalog.h.
+ *
+ * Results:
+ *      VixError.
+ *
+ * Side effects:
+ *      Reads the metadata of the filesystem from the disk.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JCatalog_BuildFromDisk(VixDiskLibHandle handle,            // IN
+                       int partition,                      // IN
+                       size_t cacheSize,                   // IN
+                       uint8 **catalog,                    // OUT
+                       size_t *size,                       // OUT
+                       int64 stats[JCatalogStatCount])     // OUT
+{
+   int64 start = JCatalogNowUs();
+   VixDiskLibInfo *info = NULL;
+   JCatalogDisk disk;
+   JGuestFs *fs = NULL;
+   VixError err;
+   size_t i;
+
+   *catalog = NULL;
+   *size = 0;
+   memset(stats, 0, JCatalogStatCount * sizeof stats[0]);
+   if (handle == NULL) {
+      return VIX_E_INVALID_ARG;
+   }
+   memset(&disk, 0, sizeof disk);
+   disk.remote = JDiskd_IsRemote(handle);
+   err = disk.remote ? JDiskd_GetInfo(handle, &info) :
+                       VixDiskLib_GetInfo(handle, &info);
+   if (err != VIX_OK) {
+      return err;
+   }
+   disk.handle = handle;
+   disk.capacity = (int64)info->capacity * VIXDISKLIB_SECTOR_SIZE;
+   if (disk.remote) {
+      JDiskd_FreeInfo(info);
+   } else {
+      VixDiskLib_FreeInfo(info);
+   }
+
+   if (cacheSize == 0) {
+      cacheSize = JCATALOG_DEFAULT_CACHE_SIZE;
+   }
+   disk.slots = cacheSize / JCATALOG_CHUNK_SIZE;
+   if (disk.slots == 0) {
+      disk.slots = 1;
+   }
+   disk.cache = malloc(disk.slots * JCATALOG_CHUNK_SIZE);
+   disk.chunks = malloc(disk.slots * sizeof *disk.chunks);
+   if (disk.cache == NULL || disk.chunks == NULL) {
+      free(disk.cache);
+      free(disk.chunks);
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   for (i = 0; i < disk.slots; i++) {
+      disk.chunks[i] = -1;
+   }
+
+   err = JGuestFs_Open(&JCatalogDiskRead, &disk, partition, &fs);
+   if (err == VIX_OK) {
+      err = JCatalog_Build(fs, catalog, size);
+      JGuestFs_Close(fs);
+   }
+   if (err == VIX_OK && *size >= JCATALOG_HEADER_SIZE) {
+      const uint8 *records = *catalog + 8;
+
+      stats[JCatalogStatRecords] = records[0] | (records[1] << 8) |
+                                   (records[2] << 16) |
+                                   ((int64)records[3] << 24);
+   }
+   stats[JCatalogStatBytesRead] = disk.bytesRead;
+   stats[JCatalogStatElapsedUs] = JCatalogNowUs() - start;
+   free(disk.cache);
+   free(disk.chunks);
+   return err;
+}
@@ -0,0 +1,825 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jConnCache.c
+ *
+ *    Shared cache of VixDiskLib connections and read-only disk handles.
+ *
+ *    A connect to vCenter exchanges a ticket for every call, which costs
+ *    more than the transfer of a small disk on NBDSSL. Connections are
+ *    reference counted by their parameters, so all the disks of a VM
+ *    snapshot share one, and a connection no longer used is kept a while
+ *    for the next job on the same snapshot. Read-only handles closed by
+ *    their user stay open, idle, for the next open of the same disk, as
+ *    long as their connection is referenced: a handle left open would keep
+ *    a hot-added disk attached to the proxy and block the snapshot removal.
+ *
+ *    VixDiskLib is never called with the lock held.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "jConnCache.h"
+#include "jAsyncQueue.h"
+#include "jThrottle.h"
+#include "jMetadata.h"
+
+typedef struct JConn {
+   VixDiskLibConnection conn;
+   char *key;
+   int refs;
+   Bool valid;                      /* Can be given to a new user */
+   time_t created;
+   time_t idleSince;                /* When refs dropped to 0 */
+   struct JConn *next;
+} JConn;
+
+typedef struct JConnHandle {
+   VixDiskLibHandle disk;
+   VixDiskLibConnection conn;
+   char *path;
+   uint32 flags;
+   Bool idle;
+   time_t idleSince;
+   struct JConnHandle *next;
+} JConnHandle;
+
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gReaperCond = PTHREAD_COND_INITIALIZER;
+static pthread_t gReaper;
+static Bool gReaperRunning;
+static uint32 gIdleSeconds;
+static uint32 gMaxAgeSeconds;
+static uint32 gMaxIdleHandles = JCONNCACHE_DEFAULT_MAX_IDLE_HANDLES;
+static JConn *gConns;
+static JConnHandle *gHandles;       /* Read-only handles of cached conns */
+static int64 gStats[JConnCacheStatCount];
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JConnCacheHash --
+ *
+ *      FNV-1a hash of a secret, so that the key tells apart two sets of
+ *      credentials without holding them.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static uint64
+JConnCacheHash(uint64 hash,        // IN
+               const char *s)      // IN: optional
+{
+   if (s == NULL) {
+      return hash;
+   }
+   for (; *s != '\0'; s++) {
+      hash = (hash ^ (uint8)*s) * 0x100000001b3ULL;
+   }
+   return (hash ^ 0xff) * 0x100000001b3ULL;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JConnCacheKey --
+ *
+ *      Build the key of a connection from its parameters.
+ *
+ * Results:
+ *      A malloc'ed string, NULL if out of memory.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static char *
+JConnCacheKey(const VixDiskLibConnectParams *params,  // IN
+              Bool readOnly,                          // IN
+              const char *ssMoref,                    // IN: optional
+              const char *modes)                      // IN: optional
+{
+   const char *user = NULL;
+   uint64 secret = 0xcbf29ce484222325ULL;
+   const char *spec[3] = { NULL, NULL, NULL };
+   char *key;
+   int n;
+
+   if (params->credType == VIXDISKLIB_CRED_UID) {
+      user = params->creds.uid.userName;
+      secret = JConnCacheHash(secret, params->creds.uid.password);
+   } else if (params->credType == VIXDISKLIB_CRED_SESSIONID) {
+      user = params->creds.sessionId.userName;
+      secret = JConnCacheHash(secret, params->creds.sessionId.cookie);
+      secret = JConnCacheHash(secret, params->creds.sessionId.key);
+   }
+   if (params->specType == VIXDISKLIB_SPEC_VSTORAGE_OBJECT) {
+      spec[0] = params->spec.vStorageObjSpec.id;
+      spec[1] = params->spec.vStorageObjSpec.datastoreMoRef;
+      spec[2] = params->spec.vStorageObjSpec.ssId;
+   } else {
+      spec[0] = params->vmxSpec;
+   }
+
+#define S(s) ((s) != NULL ? (s) : "")
+   n = snprintf(NULL, 0, "%s:%u|%s|%d|%016llx|%d|%s|%s|%s|%s|%s|%d",
+                S(params->serverName), params->port, S(user),
+                (int)params->credType, (unsigned long long)secret,
+                (int)params->specType, S(spec[0]), S(spec[1]), S(spec[2]),
+                S(ssMoref), S(modes), readOnly ? 1 : 0);
+   key = malloc(n + 1);
+   if (key != NULL) {
+      snprintf(key, n + 1, "%s:%u|%s|%d|%016llx|%d|%s|%s|%s|%s|%s|%d",
+               S(params->serverName), params->port, S(user),
+               (int)params->credType, (unsigned long long)secret,
+               (int)params->specType, S(spec[0]), S(spec[1]), S(spec[2]),
+               S(ssMoref), S(modes), readOnly ? 1 : 0);
+   }
+#undef S
+   return key;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JConnCacheFind --
+ *
+ *      Find the entry of a connection. Must be called with the lock held.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static JConn *
+JConnCacheFind(VixDiskLibConnection conn)   // IN
+{
+   JConn *entry = gConns;
+
+   while (entry != NULL && entry->conn != conn) {
+      entry = entry->next;
+   }
+   return entry;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JConnCacheUnlinkHandle --
+ *
+ *      Remove a handle from the list. Must be called with the lock held.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JConnCacheUnlinkHandle(JConnHandle *handle)   // IN
+{
+   JConnHandle **link = &gHandles;
+
+   while (*link != NULL && *link != handle) {
+      link = &(*link)->next;
+   }
+   if (*link != NULL) {
+      *link = handle->next;
+   }
+   handle->next = NULL;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JConnCacheCloseDisk --
+ *
+ *      Really close a disk handle, with its per-handle state.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static VixError
+JConnCacheCloseDisk(VixDiskLibHandle disk)   // IN
+{
+   JAsyncQueue_Release(disk);
+   JThrottle_Release(disk);
+   JMetadata_Release(disk);
+   return VixDiskLib_Close(disk);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JConnCacheCloseAll --
+ *
+ *      Close a list of handles, then disconnect a list of connections,
+ *      both taken out of the cache.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Frees the entries.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JConnCacheCloseAll(JConnHandle *handles,  // IN
+                   JConn *conns)          // IN
+{
+   while (handles != NULL) {
+      JConnHandle *next = handles->next;
+
+      JConnCacheCloseDisk(handles->disk);
+      free(handles->path);
+      free(handles);
+      handles = next;
+   }
+   while (conns != NULL) {
+      JConn *next = conns->next;
+
+      VixDiskLib_Disconnect(conns->conn);
+      free(conns->key);
+      free(conns);
+      conns = next;
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JConnCacheTakeHandles --
+ *
+ *      Take out of the cache the idle handles of "conn" (or of any
+ *      connection if NULL) idle since before "before". Must be called with
+ *      the lock held.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      The entries are prepended to "handles", to be closed with
+ *      JConnCacheCloseAll once the lock is released.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JConnCacheTakeHandles(VixDiskLibConnection conn,   // IN: optional
+                      time_t before,               // IN
+                      JConnHandle **handles)       // IN/OUT
+{
+   JConnHandle **link = &gHandles;
+
+   while (*link != NULL) {
+      JConnHandle *handle = *link;
+
+      if (handle->idle && handle->idleSince < before &&
+          (conn == NULL || handle->conn == conn)) {
+         *link = handle->next;
+         handle->next = *handles;
+         *handles = handle;
+         gStats[JConnCacheStatExpired]++;
+      } else {
+         link = &handle->next;
+      }
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JConnCacheTakeConns --
+ *
+ *      Take out of the cache the connections no longer referenced that are
+ *      idle since before "before" or cannot be reused. Must be called with
+ *      the lock held.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      The entries are prepended to "conns", to be disconnected with
+ *      JConnCacheCloseAll once the lock is released.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JConnCacheTakeConns(time_t before,   // IN
+                    JConn **conns)   // IN/OUT
+{
+   time_t now = time(NULL);
+   JConn **link = &gConns;
+
+   while (*link != NULL) {
+      JConn *entry = *link;
+
+      if (gMaxAgeSeconds > 0 && now - entry->created >= gMaxAgeSeconds) {
+         entry->valid = FALSE;
+      }
+      if (entry->refs == 0 && (entry->idleSince < before || !entry->valid)) {
+         *link = entry->next;
+         entry->next = *conns;
+         *conns = entry;
+         gStats[JConnCacheStatExpired]++;
+      } else {
+         link = &entry->next;
+      }
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JConnCacheReaper --
+ *
+ *      Thread closing the idle handles and connections once expired.
+ *
+ * Results:
+ *      NULL.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void *
+JConnCacheReaper(void *data)   // IN
+{
+   pthread_mutex_lock(&gLock);
+   while (gIdleSeconds > 0) {
+      struct timespec deadline;
+      JConnHandle *handles = NULL;
+      JConn *conns = NULL;
+
+      clock_gettime(CLOCK_REALTIME, &deadline);
+      deadline.tv_sec += 1;
+      pthread_cond_timedwait(&gReaperCond, &gLock, &deadline);
+      if (gIdleSeconds == 0) {
+         break;
+      }
+      JConnCacheTakeHandles(NULL, time(NULL) - gIdleSeconds + 1, &handles);
+      JConnCacheTakeConns(time(NULL) - gIdleSeconds + 1, &conns);
+      if (handles != NULL || conns != NULL) {
+         pthread_mutex_unlock(&gLock);
+         JConnCacheCloseAll(handles, conns);
+         pthread_mutex_lock(&gLock);
+      }
+   }
+   pthread_mutex_unlock(&gLock);
+   return NULL;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JConnCache_Configure --
+ *
+ *      Enable, tune or disable the cache. See jConnCache.h.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Starts or stops the reaper thread.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JConnCache_Configure(uint32 idleSeconds,     // IN
+                     uint32 maxAgeSeconds,   // IN
+                     uint32 maxIdleHandles)  // IN
+{
+   JConnHandle *handles = NULL;
+   JConn *conns = NULL;
+   Bool join = FALSE;
+
+   pthread_mutex_lock(&gLock);
+   gIdleSeconds = idleSeconds;
+   gMaxAgeSeconds = maxAgeSeconds;
+   gMaxIdleHandles = maxIdleHandles;
+   if (idleSeconds == 0) {
+      JConnCacheTakeHandles(NULL, (time_t)1 << 62, &handles);
+      JConnCacheTakeConns((time_t)1 << 62, &conns);
+      if (gReaperRunning) {
+         gReaperRunning = FALSE;
+         join = TRUE;
+         pthread_cond_signal(&gReaperCond);
+      }
+   } else if (!gReaperRunning) {
+      gReaperRunning = pthread_create(&gReaper, NULL, JConnCacheReaper,
+                                      NULL) == 0;
+      if (!gReaperRunning) {
+         gIdleSeconds = 0;    /* Nothing would expire: stay disabled */
+      }
+   }
+   pthread_mutex_unlock(&gLock);
+   if (join) {
+      pthread_join(gReaper, NULL);
+   }
+   JConnCacheCloseAll(handles, conns);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JConnCache_Connect --
+ *
+ *      Get a shared connection. See jConnCache.h.
+ *
+ * Results:
+ *      VIX_OK or the error of VixDiskLib_ConnectEx.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JConnCache_Connect(const VixDiskLibConnectParams *params,   // IN
+                   Bool readOnly,                           // IN
+                   const char *ssMoref,                     // IN: optional
+                   const char *modes,                       // IN: optional
+                   VixDiskLibConnection *conn)              // OUT
+{
+   JConn *entry;
+   char *key;
+   time_t now = time(NULL);
+   VixError result;
+
+   pthread_mutex_lock(&gLock);
+   gStats[JConnCacheStatConnects]++;
+   if (gIdleSeconds == 0) {
+      pthread_mutex_unlock(&gLock);
+      return VixDiskLib_ConnectEx(params, readOnly, ssMoref, modes, conn);
+   }
+   pthread_mutex_unlock(&gLock);
+
+   key = JConnCacheKey(params, readOnly, ssMoref, modes);
+   if (key == NULL) {
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   pthread_mutex_lock(&gLock);
+   for (entry = gConns; entry != NULL; entry = entry->next) {
+      if (gMaxAgeSeconds > 0 && now - entry->created >= gMaxAgeSeconds) {
+         entry->valid = FALSE;
+      }
+      if (entry->valid && strcmp(entry->key, key) == 0) {
+         entry->refs++;
+         gStats[JConnCacheStatConnectHits]++;
+         *conn = entry->conn;
+         pthread_mutex_unlock(&gLock);
+         free(key);
+         return VIX_OK;
+      }
+   }
+   pthread_mutex_unlock(&gLock);
+
+   result = VixDiskLib_ConnectEx(params, readOnly, ssMoref, modes, conn);
+   if (result != VIX_OK) {
+      free(key);
+      return result;
+   }
+   entry = calloc(1, sizeof *entry);
+   if (entry == NULL) {
+      free(key);
+      return VIX_OK;          /* Served uncached */
+   }
+   entry->conn = *conn;
+   entry->key = key;
+   entry->refs = 1;
+   entry->valid = TRUE;
+   entry->created = now;
+   pthread_mutex_lock(&gLock);
+   entry->next = gConns;
+   gConns = entry;
+   pthread_mutex_unlock(&gLock);
+   return VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JConnCache_Disconnect --
+ *
+ *      Release a connection. The last user closes its idle handles, and
+ *      disconnects it unless it can be reused.
+ *
+ * Results:
+ *      VIX_OK or the error of VixDiskLib_Disconnect.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JConnCache_Disconnect(VixDiskLibConnection conn)   // IN
+{
+   JConnHandle *handles = NULL;
+   JConn *conns = NULL;
+   JConn *entry;
+
+   pthread_mutex_lock(&gLock);
+   entry = JConnCacheFind(conn);
+   if (entry == NULL) {
+      pthread_mutex_unlock(&gLock);
+      return VixDiskLib_Disconnect(conn);
+   }
+   if (entry->refs > 0) {
+      entry->refs--;
+   }
+   if (entry->refs == 0) {
+      entry->idleSince = time(NULL);
+      JConnCacheTakeHandles(conn, (time_t)1 << 62, &handles);
+      if (gIdleSeconds == 0) {
+         entry->valid = FALSE;
+      }
+      JConnCacheTakeConns(entry->idleSince - gIdleSeconds, &conns);
+   }
+   pthread_mutex_unlock(&gLock);
+   JConnCacheCloseAll(handles, conns);
+   return VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JConnCache_Open --
+ *
+ *      Open a disk, reusing an idle handle. See jConnCache.h.
+ *
+ * Results:
+ *      VIX_OK or the error of VixDiskLib_Open.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JConnCache_Open(VixDiskLibConnection conn,   // IN
+                const char *path,            // IN: optional
+                uint32 flags,                // IN
+                VixDiskLibHandle *disk,      // OUT
+                Bool *reused)                // OUT
+{
+   JConnHandle *handle = NULL;
+   VixError result;
+   Bool cached;
+
+   *reused = FALSE;
+   if ((flags & VIXDISKLIB_FLAG_OPEN_READ_ONLY) == 0) {
+      result = VixDiskLib_Open(conn, path, flags, disk);
+      JConnCache_Check(conn, result);
+      return result;
+   }
+
+   pthread_mutex_lock(&gLock);
+   gStats[JConnCacheStatOpens]++;
+   cached = JConnCacheFind(conn) != NULL;
+   for (handle = gHandles; cached && handle != NULL; handle = handle->next) {
+      if (handle->idle && handle->conn == conn && handle->flags == flags &&
+          strcmp(handle->path, path != NULL ? path : "") == 0) {
+         handle->idle = FALSE;
+         break;
+      }
+   }
+   pthread_mutex_unlock(&gLock);
+
+   if (handle != NULL) {
+      VixDiskLibInfo *info = NULL;
+
+      /*
+       * Health check: the host may have dropped the session meanwhile.
+       */
+      if (VixDiskLib_GetInfo(handle->disk, &info) == VIX_OK) {
+         VixDiskLib_FreeInfo(info);
+         pthread_mutex_lock(&gLock);
+         gStats[JConnCacheStatOpenHits]++;
+         pthread_mutex_unlock(&gLock);
+         *disk = handle->disk;
+         *reused = TRUE;
+         return VIX_OK;
+      }
+      pthread_mutex_lock(&gLock);
+      JConnCacheUnlinkHandle(handle);
+      gStats[JConnCacheStatExpired]++;
+      pthread_mutex_unlock(&gLock);
+      JConnCacheCloseAll(handle, NULL);
+   }
+
+   result = VixDiskLib_Open(conn, path, flags, disk);
+   JConnCache_Check(conn, result);
+   if (result != VIX_OK || !cached) {
+      return result;
+   }
+   handle = calloc(1, sizeof *handle);
+   if (handle != NULL) {
+      handle->path = strdup(path != NULL ? path : "");
+   }
+   if (handle == NULL || handle->path == NULL) {
+      free(handle);
+      return VIX_OK;          /* Served uncached */
+   }
+   handle->disk = *disk;
+   handle->conn = conn;
+   handle->flags = flags;
+   pthread_mutex_lock(&gLock);
+   handle->next = gHandles;
+   gHandles = handle;
+   pthread_mutex_unlock(&gLock);
+   return VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JConnCache_Close --
+ *
+ *      Close a disk or keep it idle. See jConnCache.h.
+ *
+ * Results:
+ *      VIX_OK or the error of VixDiskLib_Close.
+ *
+ * Side effects:
+ *      May close the handle idle for the longest time.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JConnCache_Close(VixDiskLibHandle disk)   // IN
+{
+   JConnHandle *handle;
+   JConnHandle *oldest = NULL;
+   JConn *entry;
+   uint32 idle = 0;
+
+   pthread_mutex_lock(&gLock);
+   for (handle = gHandles; handle != NULL; handle = handle->next) {
+      if (handle->disk == disk) {
+         break;
+      }
+   }
+   if (handle == NULL) {
+      pthread_mutex_unlock(&gLock);
+      return JConnCacheCloseDisk(disk);
+   }
+   entry = JConnCacheFind(handle->conn);
+   if (gIdleSeconds == 0 || gMaxIdleHandles == 0 || entry == NULL ||
+       !entry->valid || entry->refs == 0) {
+      JConnCacheUnlinkHandle(handle);
+      pthread_mutex_unlock(&gLock);
+      JConnCacheCloseAll(handle, NULL);
+      return VIX_OK;
+   }
+   handle->idle = TRUE;
+   handle->idleSince = time(NULL);
+
+   for (handle = gHandles; handle != NULL; handle = handle->next) {
+      if (handle->idle) {
+         idle++;
+         if (oldest == NULL || handle->idleSince <= oldest->idleSince) {
+            oldest = handle;
+         }
+      }
+   }
+   if (idle > gMaxIdleHandles) {
+      JConnCacheUnlinkHandle(oldest);
+      gStats[JConnCacheStatExpired]++;
+   } else {
+      oldest = NULL;
+   }
+   pthread_mutex_unlock(&gLock);
+   JConnCacheCloseAll(oldest, NULL);
+   return VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JConnCache_Check --
+ *
+ *      Stop reusing a connection after a network or session error. See
+ *      jConnCache.h.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JConnCache_Check(VixDiskLibConnection conn,   // IN
+                 VixError err)                // IN
+{
+   JConn *entry;
+
+   switch (VIX_ERROR_CODE(err)) {
+   case VIX_E_HOST_NOT_CONNECTED:
+   case VIX_E_VM_HOST_DISCONNECTED:
+   case VIX_E_HOST_CONNECTION_LOST:
+   case VIX_E_HOST_USER_PERMISSIONS:
+   case VIX_E_HOST_NETBLKDEV_HANDSHAKE:
+   case VIX_E_HOST_SOCKET_CREATION_ERROR:
+   case VIX_E_HOST_SERVER_NOT_FOUND:
+   case VIX_E_HOST_NETWORK_CONN_REFUSED:
+   case VIX_E_HOST_TCP_SOCKET_ERROR:
+   case VIX_E_HOST_TCP_CONN_LOST:
+   case VIX_E_HOST_SERVER_SHUTDOWN:
+   case VIX_E_DISK_INVALID_CONNECTION:
+   case VIX_E_CANNOT_CONNECT_TO_HOST:
+   case VIX_E_NET_HTTP_COULDNT_CONNECT:
+   case VIX_E_NET_HTTP_SSL_CONNECT_ERROR:
+   case VIX_E_NET_HTTP_SSL_SECURITY:
+      break;
+   default:
+      return;
+   }
+   pthread_mutex_lock(&gLock);
+   entry = JConnCacheFind(conn);
+   if (entry != NULL && entry->valid) {
+      entry->valid = FALSE;
+      gStats[JConnCacheStatInvalidated]++;
+   }
+   pthread_mutex_unlock(&gLock);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JConnCache_Shutdown --
+ *
+ *      Close everything idle and disable the cache.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JConnCache_Shutdown(void)
+{
+   JConnCache_Configure(0, 0, 0);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JConnCache_GetStats --
+ *
+ *      Copy the statistics of the cache.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JConnCache_GetStats(int64 stats[JConnCacheStatCount])   // OUT
+{
+   JConnHandle *handle;
+   JConn *entry;
+
+   pthread_mutex_lock(&gLock);
+   memcpy(stats, gStats, sizeof gStats);
+   stats[JConnCacheStatConnections] = 0;
+   stats[JConnCacheStatIdleHandles] = 0;
+   for (entry = gConns; entry != NULL; entry = entry->next) {
+      stats[JConnCacheStatConnections]++;
+   }
+   for (handle = gHandles; handle != NULL; handle = handle->next) {
+      if (handle->idle) {
+         stats[JConnCacheStatIdleHandles]++;
+      }
+   }
+   pthread_mutex_unlock(&gLock);
+}
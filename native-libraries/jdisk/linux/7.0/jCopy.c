@@ -0,0 +1,530 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jCopy.c
+ *
+ *    Pipelined copy between two open disks.
+ *
+ *    The range to copy is first turned into a list of extents, from the
+ *    allocated blocks of the source when only those are wanted. The extents
+ *    are then cut into requests of at most one buffer and pushed through a
+ *    ring of buffers: a free buffer is filled by VixDiskLib_ReadAsync on the
+ *    source, handed to VixDiskLib_WriteAsync on the destination as soon as
+ *    the read completes, and freed when the write completes. Reads of later
+ *    requests thus overlap the writes of earlier ones and both transports
+ *    stay busy, with no copy through the JVM.
+ *
+ *    The completion callbacks only mark their buffer; all I/O is issued and
+ *    all accounting done by the calling thread, which also runs the
+ *    progress callback.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "jCopy.h"
+#include "jThrottle.h"
+
+/*
+ * Time to wait for a completion before pumping VixDiskLib_Wait.
+ */
+#define WAIT_PUMP_TIMEOUT_US 100000
+
+#define BUFFER_ALIGNMENT 4096
+
+
+typedef struct JCopyExtent {
+   VixDiskLibSectorType start;
+   VixDiskLibSectorType length;
+   VixDiskLibSectorType pending;    /* Sectors not written yet */
+} JCopyExtent;
+
+typedef enum {
+   JCopySlotFree,
+   JCopySlotReading,
+   JCopySlotWriting,
+} JCopySlotState;
+
+struct JCopyJob;
+
+typedef struct JCopySlot {
+   struct JCopyJob *job;
+   uint8 *buf;
+   JCopySlotState state;
+   VixDiskLibSectorType start;
+   uint32 count;
+   int extent;
+   Bool completed;                  /* Protected by job->lock */
+   VixError result;                 /* Protected by job->lock */
+} JCopySlot;
+
+typedef struct JCopyJob {
+   pthread_mutex_t lock;
+   pthread_cond_t done;
+   int ready;                       /* Completed slots not reaped yet */
+   JCopyExtent *extents;
+   int extentCount;
+   int extentCapacity;
+} JCopyJob;
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCopyNowUs --
+ *
+ *      Monotonic time in microseconds.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static int64
+JCopyNowUs(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (int64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCopyAddExtent --
+ *
+ *      Append the range [start, end) to the extents of the job, merging it
+ *      with the last extent if they are adjacent.
+ *
+ * Results:
+ *      FALSE if out of memory.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JCopyAddExtent(JCopyJob *job,                  // IN/OUT
+               VixDiskLibSectorType start,     // IN
+               VixDiskLibSectorType end)       // IN
+{
+   JCopyExtent *last;
+
+   if (start >= end) {
+      return TRUE;
+   }
+   last = job->extentCount > 0 ? &job->extents[job->extentCount - 1] : NULL;
+   if (last != NULL && last->start + last->length >= start) {
+      if (end > last->start + last->length) {
+         last->length = end - last->start;
+         last->pending = last->length;
+      }
+      return TRUE;
+   }
+   if (job->extentCount == job->extentCapacity) {
+      int capacity = job->extentCapacity == 0 ? 64 : job->extentCapacity * 2;
+      JCopyExtent *extents = realloc(job->extents, capacity * sizeof *extents);
+
+      if (extents == NULL) {
+         return FALSE;
+      }
+      job->extents = extents;
+      job->extentCapacity = capacity;
+   }
+   last = &job->extents[job->extentCount++];
+   last->start = start;
+   last->length = end - start;
+   last->pending = last->length;
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCopyListExtents --
+ *
+ *      Build the extents to copy. Allocated blocks are queried by windows
+ *      of VIXDISKLIB_MAX_CHUNK_NUMBER chunks; a window that cannot be
+ *      queried is copied whole. The partial chunk at the end of the range
+ *      cannot be queried and is always copied.
+ *
+ * Results:
+ *      VIX_OK or VIX_E_OUT_OF_MEMORY.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static VixError
+JCopyListExtents(JCopyJob *job,                  // IN/OUT
+                 VixDiskLibHandle src,           // IN
+                 VixDiskLibSectorType start,     // IN
+                 VixDiskLibSectorType end,       // IN
+                 Bool allocatedOnly)             // IN
+{
+   const VixDiskLibSectorType chunk = VIXDISKLIB_MIN_CHUNK_SIZE;
+   const VixDiskLibSectorType window = chunk * VIXDISKLIB_MAX_CHUNK_NUMBER;
+   VixDiskLibSectorType fullEnd = end - end % chunk;
+   VixDiskLibSectorType pos = start - start % chunk;
+
+   if (!allocatedOnly) {
+      return JCopyAddExtent(job, start, end) ? VIX_OK : VIX_E_OUT_OF_MEMORY;
+   }
+
+   while (pos < fullEnd) {
+      VixDiskLibSectorType length = fullEnd - pos < window ? fullEnd - pos
+                                                           : window;
+      VixDiskLibBlockList *blockList = NULL;
+      Bool ok = TRUE;
+
+      if (VixDiskLib_QueryAllocatedBlocks(src, pos, length, chunk,
+                                          &blockList) == VIX_OK) {
+         uint32 i;
+
+         for (i = 0; ok && i < blockList->numBlocks; i++) {
+            VixDiskLibSectorType s = blockList->blocks[i].offset;
+            VixDiskLibSectorType e = s + blockList->blocks[i].length;
+
+            ok = JCopyAddExtent(job, s > start ? s : start, e < end ? e : end);
+         }
+         VixDiskLib_FreeBlockList(blockList);
+      } else {
+         ok = JCopyAddExtent(job, pos > start ? pos : start, pos + length);
+      }
+      if (!ok) {
+         return VIX_E_OUT_OF_MEMORY;
+      }
+      pos += length;
+   }
+   if (!JCopyAddExtent(job, fullEnd > start ? fullEnd : start, end)) {
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   return VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCopyCompletionCB --
+ *
+ *      Completion callback of the reads and writes of a slot.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Wakes up the copying thread.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JCopyCompletionCB(void *cbData,     // IN: JCopySlot
+                  VixError result)  // IN
+{
+   JCopySlot *slot = cbData;
+   JCopyJob *job = slot->job;
+
+   pthread_mutex_lock(&job->lock);
+   slot->completed = TRUE;
+   slot->result = result;
+   job->ready++;
+   pthread_cond_signal(&job->done);
+   pthread_mutex_unlock(&job->lock);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCopyIssue --
+ *
+ *      Start the read or the write of a slot, according to its state.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      JCopyCompletionCB is called, possibly right away on error.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JCopyIssue(JCopySlot *slot,         // IN
+           VixDiskLibHandle src,    // IN
+           VixDiskLibHandle dst)    // IN
+{
+   uint64 bytes = (uint64)slot->count * VIXDISKLIB_SECTOR_SIZE;
+   VixError result;
+
+   if (slot->state == JCopySlotWriting) {
+      JThrottle_Consume(dst, bytes);
+      result = VixDiskLib_WriteAsync(dst, slot->start, slot->count, slot->buf,
+                                     JCopyCompletionCB, slot);
+   } else {
+      JThrottle_Consume(src, bytes);
+      result = VixDiskLib_ReadAsync(src, slot->start, slot->count, slot->buf,
+                                    JCopyCompletionCB, slot);
+   }
+   if (result != VIX_OK && result != VIX_ASYNC) {
+      JCopyCompletionCB(slot, result);
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCopyWait --
+ *
+ *      Wait until at least one slot has completed. If none completes for a
+ *      while, the outstanding requests of both disks are pumped with
+ *      VixDiskLib_Wait, since some transports only deliver completions from
+ *      there.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Blocks.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JCopyWait(JCopyJob *job,            // IN/OUT
+          VixDiskLibHandle src,     // IN
+          VixDiskLibHandle dst)     // IN
+{
+   pthread_mutex_lock(&job->lock);
+   while (job->ready == 0) {
+      struct timespec deadline;
+
+      clock_gettime(CLOCK_REALTIME, &deadline);
+      deadline.tv_nsec += WAIT_PUMP_TIMEOUT_US * 1000;
+      if (deadline.tv_nsec >= 1000000000) {
+         deadline.tv_sec++;
+         deadline.tv_nsec -= 1000000000;
+      }
+      if (pthread_cond_timedwait(&job->done, &job->lock, &deadline) ==
+             ETIMEDOUT && job->ready == 0) {
+         pthread_mutex_unlock(&job->lock);
+         VixDiskLib_Wait(src);
+         VixDiskLib_Wait(dst);
+         pthread_mutex_lock(&job->lock);
+      }
+   }
+   pthread_mutex_unlock(&job->lock);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCopy_Run --
+ *
+ *      Copy a range of sectors between two disks. See jCopy.h.
+ *
+ * Results:
+ *      VIX_OK, VIX_E_CANCELLED, or the first error of the copy.
+ *
+ * Side effects:
+ *      Writes to "dst".
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JCopy_Run(VixDiskLibHandle src,                 // IN
+          VixDiskLibHandle dst,                 // IN
+          VixDiskLibSectorType startSector,     // IN
+          VixDiskLibSectorType endSector,       // IN
+          uint32 chunkSectors,                  // IN
+          uint32 depth,                         // IN
+          Bool allocatedOnly,                   // IN
+          VixDiskLibProgressFunc progress,      // IN: optional
+          void *progressData,                   // IN
+          int64 stats[JCopyStatCount])          // OUT
+{
+   JCopySlot slots[JCOPY_MAX_DEPTH];
+   JCopyJob job;
+   VixError err;
+   VixDiskLibSectorType total = 0;
+   VixDiskLibSectorType written = 0;
+   VixDiskLibSectorType resume;
+   VixDiskLibSectorType offset = 0;   /* Next sector to read in the extent */
+   int64 start = JCopyNowUs();
+   int64 extentsDone = 0;
+   int extent = 0;
+   int percent = 0;
+   int busy = 0;
+   uint32 i;
+
+   memset(stats, 0, JCopyStatCount * sizeof stats[0]);
+   stats[JCopyStatResumeSector] = startSector;
+   if (src == NULL || dst == NULL) {
+      return VIX_E_INVALID_ARG;
+   }
+   if (endSector == 0) {
+      VixDiskLibInfo *info = NULL;
+
+      err = VixDiskLib_GetInfo(src, &info);
+      if (err != VIX_OK) {
+         return err;
+      }
+      endSector = info->capacity;
+      VixDiskLib_FreeInfo(info);
+   }
+   if (startSector > endSector) {
+      return VIX_E_INVALID_ARG;
+   }
+   if (chunkSectors == 0) {
+      chunkSectors = JCOPY_DEFAULT_CHUNK_SECTORS;
+   }
+   if (depth == 0) {
+      depth = JCOPY_DEFAULT_DEPTH;
+   }
+   if (depth > JCOPY_MAX_DEPTH) {
+      depth = JCOPY_MAX_DEPTH;
+   }
+
+   memset(&job, 0, sizeof job);
+   err = JCopyListExtents(&job, src, startSector, endSector, allocatedOnly);
+   for (i = 0; i < depth; i++) {
+      memset(&slots[i], 0, sizeof slots[i]);
+      slots[i].job = &job;
+      if (err == VIX_OK &&
+          posix_memalign((void **)&slots[i].buf, BUFFER_ALIGNMENT,
+                         (size_t)chunkSectors * VIXDISKLIB_SECTOR_SIZE) != 0) {
+         slots[i].buf = NULL;
+         err = VIX_E_OUT_OF_MEMORY;
+      }
+   }
+   if (err != VIX_OK) {
+      goto exit;
+   }
+   for (extent = 0; extent < job.extentCount; extent++) {
+      total += job.extents[extent].length;
+   }
+   extent = 0;
+   pthread_mutex_init(&job.lock, NULL);
+   pthread_cond_init(&job.done, NULL);
+   resume = endSector;
+
+   for (;;) {
+      /*
+       * Refill the free slots with the next reads.
+       */
+      for (i = 0; i < depth && err == VIX_OK && extent < job.extentCount; i++) {
+         JCopySlot *slot = &slots[i];
+         JCopyExtent *e = &job.extents[extent];
+         VixDiskLibSectorType left = e->length - offset;
+
+         if (slot->state != JCopySlotFree) {
+            continue;
+         }
+         slot->state = JCopySlotReading;
+         slot->start = e->start + offset;
+         slot->count = left < chunkSectors ? (uint32)left : chunkSectors;
+         slot->extent = extent;
+         offset += slot->count;
+         if (offset == e->length) {
+            extent++;
+            offset = 0;
+         }
+         busy++;
+         JCopyIssue(slot, src, dst);
+      }
+      if (busy == 0) {
+         break;
+      }
+
+      /*
+       * Reap the completed slots: finished reads are written, finished
+       * writes free their slot.
+       */
+      JCopyWait(&job, src, dst);
+      for (i = 0; i < depth; i++) {
+         JCopySlot *slot = &slots[i];
+         VixError result;
+
+         pthread_mutex_lock(&job.lock);
+         if (!slot->completed) {
+            pthread_mutex_unlock(&job.lock);
+            continue;
+         }
+         slot->completed = FALSE;
+         result = slot->result;
+         job.ready--;
+         pthread_mutex_unlock(&job.lock);
+
+         if (result == VIX_OK && err == VIX_OK &&
+             slot->state == JCopySlotReading) {
+            slot->state = JCopySlotWriting;
+            JCopyIssue(slot, src, dst);
+            continue;
+         }
+         busy--;
+         if (result != VIX_OK || slot->state == JCopySlotReading) {
+            /*
+             * Failed, or read after the copy was stopped.
+             */
+            if (err == VIX_OK) {
+               err = result;
+            }
+            if (slot->start < resume) {
+               resume = slot->start;
+            }
+            slot->state = JCopySlotFree;
+            continue;
+         }
+         slot->state = JCopySlotFree;
+         written += slot->count;
+         job.extents[slot->extent].pending -= slot->count;
+         if (job.extents[slot->extent].pending == 0) {
+            extentsDone++;
+         }
+         if (progress != NULL && (int)(written * 100 / total) != percent) {
+            percent = (int)(written * 100 / total);
+            if (!progress(progressData, percent) && err == VIX_OK) {
+               err = VIX_E_CANCELLED;
+            }
+         }
+      }
+   }
+
+   pthread_cond_destroy(&job.done);
+   pthread_mutex_destroy(&job.lock);
+   if (err == VIX_OK) {
+      err = VixDiskLib_Flush(dst);
+      if (err != VIX_OK) {
+         resume = startSector;
+      }
+   }
+   if (err != VIX_OK && extent < job.extentCount &&
+       job.extents[extent].start + offset < resume) {
+      resume = job.extents[extent].start + offset;
+   }
+   stats[JCopyStatBytes] = (int64)written * VIXDISKLIB_SECTOR_SIZE;
+   stats[JCopyStatExtents] = extentsDone;
+   stats[JCopyStatResumeSector] = err == VIX_OK ? endSector : resume;
+
+exit:
+   for (i = 0; i < depth; i++) {
+      free(slots[i].buf);
+   }
+   free(job.extents);
+   stats[JCopyStatElapsedUs] = JCopyNowUs() - start;
+   return err;
+}
@@ -0,0 +1,276 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jCrc32c.c
+ *
+ *    CRC32C (Castagnoli) of data blocks.
+ *
+ *    On x86 CPUs with SSE4.2 the crc32 instruction is used. It has a
+ *    latency of three cycles and a throughput of one per cycle, so a map
+ *    is computed three chunks at a time, each chunk being an independent
+ *    dependency chain. Other CPUs use a slicing-by-8 table.
+ */
+
+#include <string.h>
+#include <pthread.h>
+#include "jCrc32c.h"
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#define JCRC32C_HW 1
+#endif
+
+#define CRC32C_POLY 0x82f63b78
+
+static uint32 gTable[8][256];
+static Bool gHardware = FALSE;
+static pthread_once_t gInitOnce = PTHREAD_ONCE_INIT;
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCrc32cInit --
+ *
+ *      Build the slicing tables and check for the crc32 instruction.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JCrc32cInit(void)
+{
+   uint32 i;
+   int k;
+
+   for (i = 0; i < 256; i++) {
+      uint32 crc = i;
+
+      for (k = 0; k < 8; k++) {
+         crc = (crc >> 1) ^ (CRC32C_POLY & (0 - (crc & 1)));
+      }
+      gTable[0][i] = crc;
+   }
+   for (i = 0; i < 256; i++) {
+      for (k = 1; k < 8; k++) {
+         gTable[k][i] = (gTable[k - 1][i] >> 8) ^
+                        gTable[0][gTable[k - 1][i] & 0xff];
+      }
+   }
+#ifdef JCRC32C_HW
+   __builtin_cpu_init();
+   gHardware = __builtin_cpu_supports("sse4.2") ? TRUE : FALSE;
+#endif
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCrc32cSoft --
+ *
+ *      Slicing-by-8 CRC32C, on the inverted CRC.
+ *
+ * Results:
+ *      Updated CRC.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static uint32
+JCrc32cSoft(uint32 crc,          // IN
+            const uint8 *buf,    // IN
+            size_t length)       // IN
+{
+   while (length >= 8) {
+      uint32 lo;
+      uint32 hi;
+
+      memcpy(&lo, buf, 4);
+      memcpy(&hi, buf + 4, 4);
+      lo ^= crc;
+      crc = gTable[7][lo & 0xff] ^ gTable[6][(lo >> 8) & 0xff] ^
+            gTable[5][(lo >> 16) & 0xff] ^ gTable[4][lo >> 24] ^
+            gTable[3][hi & 0xff] ^ gTable[2][(hi >> 8) & 0xff] ^
+            gTable[1][(hi >> 16) & 0xff] ^ gTable[0][hi >> 24];
+      buf += 8;
+      length -= 8;
+   }
+   while (length-- > 0) {
+      crc = (crc >> 8) ^ gTable[0][(crc ^ *buf++) & 0xff];
+   }
+   return crc;
+}
+
+
+#ifdef JCRC32C_HW
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCrc32cHw --
+ *
+ *      CRC32C with the SSE4.2 crc32 instruction, on the inverted CRC.
+ *
+ * Results:
+ *      Updated CRC.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+__attribute__((target("sse4.2"))) static uint32
+JCrc32cHw(uint32 crc,            // IN
+          const uint8 *buf,      // IN
+          size_t length)         // IN
+{
+   uint64 crc64 = crc;
+
+   while (length >= 8) {
+      uint64 word;
+
+      memcpy(&word, buf, 8);
+      crc64 = _mm_crc32_u64(crc64, word);
+      buf += 8;
+      length -= 8;
+   }
+   crc = (uint32)crc64;
+   while (length-- > 0) {
+      crc = _mm_crc32_u8(crc, *buf++);
+   }
+   return crc;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCrc32cHw3 --
+ *
+ *      CRC32C of three consecutive chunks, interleaved to keep the crc32
+ *      unit busy.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+__attribute__((target("sse4.2"))) static void
+JCrc32cHw3(const uint8 *buf,     // IN: three chunks
+           uint32 *map)          // OUT: three entries
+{
+   const uint8 *b0 = buf;
+   const uint8 *b1 = buf + JCRC32C_CHUNK_SIZE;
+   const uint8 *b2 = buf + 2 * JCRC32C_CHUNK_SIZE;
+   uint64 c0 = 0xffffffff;
+   uint64 c1 = 0xffffffff;
+   uint64 c2 = 0xffffffff;
+   size_t i;
+
+   for (i = 0; i < JCRC32C_CHUNK_SIZE; i += 8) {
+      uint64 w0;
+      uint64 w1;
+      uint64 w2;
+
+      memcpy(&w0, b0 + i, 8);
+      memcpy(&w1, b1 + i, 8);
+      memcpy(&w2, b2 + i, 8);
+      c0 = _mm_crc32_u64(c0, w0);
+      c1 = _mm_crc32_u64(c1, w1);
+      c2 = _mm_crc32_u64(c2, w2);
+   }
+   map[0] = ~(uint32)c0;
+   map[1] = ~(uint32)c1;
+   map[2] = ~(uint32)c2;
+}
+#endif
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCrc32c_Update --
+ *
+ *      CRC32C of a buffer. See jCrc32c.h.
+ *
+ * Results:
+ *      Updated CRC.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+uint32
+JCrc32c_Update(uint32 crc,         // IN
+               const uint8 *buf,   // IN
+               size_t length)      // IN
+{
+   pthread_once(&gInitOnce, JCrc32cInit);
+   crc = ~crc;
+#ifdef JCRC32C_HW
+   if (gHardware) {
+      return ~JCrc32cHw(crc, buf, length);
+   }
+#endif
+   return ~JCrc32cSoft(crc, buf, length);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JCrc32c_Map --
+ *
+ *      CRC32C of each chunk of a buffer. See jCrc32c.h.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JCrc32c_Map(const uint8 *buf,      // IN
+            size_t length,         // IN
+            uint32 *map)           // OUT
+{
+   pthread_once(&gInitOnce, JCrc32cInit);
+#ifdef JCRC32C_HW
+   if (gHardware) {
+      while (length >= 3 * JCRC32C_CHUNK_SIZE) {
+         JCrc32cHw3(buf, map);
+         buf += 3 * JCRC32C_CHUNK_SIZE;
+         length -= 3 * JCRC32C_CHUNK_SIZE;
+         map += 3;
+      }
+   }
+#endif
+   while (length > 0) {
+      size_t chunk = length < JCRC32C_CHUNK_SIZE ? length : JCRC32C_CHUNK_SIZE;
+
+      *map++ = JCrc32c_Update(0, buf, chunk);
+      buf += chunk;
+      length -= chunk;
+   }
+}
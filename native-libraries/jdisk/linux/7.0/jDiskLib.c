@@ -14,6 +14,26 @@
 #include "jDiskLibImpl.h"
 #include "vixDiskLib.h"
 #include "jUtils.h"
+#include "jAsyncQueue.h"
+#include "jThrottle.h"
+#include "jIoScheduler.h"
+#include "jEntropy.h"
+#include "jMiGz.h"
+#include "jCrc32c.h"
+#include "jMbHash.h"
+#include "jAes.h"
+#include "jScrub.h"
+#include "jCopy.h"
+#include "jArchiveDisk.h"
+#include "jGuestFs.h"
+#include "jCatalog.h"
+#include "jNbd.h"
+#include "jConnCache.h"
+#include "jDiskd.h"
+#include "jMetadata.h"
+#include "jTransportProbe.h"
+#include "jVddk.h"
+#include "jProgress.h"
 #include "vddkFaultInjection.h"
 
 #ifdef _WIN32
@@ -27,16 +47,13 @@
 static JUtilsLogger *gLogger = NULL;
 DECLARE_LOG_FUNCS(gLogger)
 
-#ifndef _WIN32
-extern void Perturb_Enable(const char *fName, int enable);
-#else
-void
-Perturb_Enable(const char *fName, int enable)
-{
-   /* This is a dummy function for Windows. This will be implemented */
-   /* for real later */
-}
-#endif
+/*
+ * Handles of the jdiskd daemon only support the calls forwarded to it.
+ */
+#define JDISKD_UNSUPPORTED(handle) \
+   if (JDiskd_IsRemote((const void *)(size_t)(handle))) { \
+      return VIX_E_NOT_SUPPORTED; \
+   }
 
 /*
  *
@@ -327,6 +344,41 @@ JNIGetCreateParams(JNIEnv *env,                     // IN: Java Environment
 }
 
 
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNITagDatastore --
+ *
+ *      Attach a newly opened disk to the throttling bucket of the datastore
+ *      found in its "[datastore] folder/disk.vmdk" path.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JNITagDatastore(VixDiskLibHandle diskHandle, // IN
+                const char *path)            // IN
+{
+   const char *end;
+   char *datastore;
+
+   if (path == NULL || path[0] != '[' || (end = strchr(path, ']')) == NULL) {
+      return;
+   }
+   datastore = strndup(path + 1, end - path - 1);
+   if (datastore != NULL) {
+      JThrottle_SetDiskTags(diskHandle, NULL, datastore);
+      free(datastore);
+   }
+}
+
+
 /*
  *
  * JNI Interface implementation
@@ -360,8 +412,13 @@ Java_com_vmware_jvix_jDiskLibImpl_InitJNI(JNIEnv *env,
 
    cLibDir = GETSTRING(libDir);
 
-   result = VixDiskLib_Init(major, minor, &JUtils_LogFunc, &JUtils_WarnFunc,
-                            &JUtils_PanicFunc, cLibDir);
+   result = JVddk_Load(cLibDir, major, minor);
+   if (result != VIX_OK) {
+      JUtils_Log("Cannot load VixDiskLib: %s\n", JVddk_LoadError());
+   } else {
+      result = VixDiskLib_Init(major, minor, &JUtils_LogFunc,
+                               &JUtils_WarnFunc, &JUtils_PanicFunc, cLibDir);
+   }
 
    FREESTRING(cLibDir, libDir);
    return result;
@@ -397,8 +454,14 @@ Java_com_vmware_jvix_jDiskLibImpl_InitExJNI(JNIEnv *env,
    cLibDir = GETSTRING(libDir);
    cConfigFile = GETSTRING(configFile);
 
-   result = VixDiskLib_InitEx(major, minor, &JUtils_LogFunc, &JUtils_WarnFunc,
-                            &JUtils_PanicFunc, cLibDir, cConfigFile);
+   result = JVddk_Load(cLibDir, major, minor);
+   if (result != VIX_OK) {
+      JUtils_Log("Cannot load VixDiskLib: %s\n", JVddk_LoadError());
+   } else {
+      result = VixDiskLib_InitEx(major, minor, &JUtils_LogFunc,
+                                 &JUtils_WarnFunc, &JUtils_PanicFunc, cLibDir,
+                                 cConfigFile);
+   }
 
    FREESTRING(cLibDir, libDir);
    FREESTRING(cConfigFile, configFile);
@@ -421,6 +484,10 @@ JNIEXPORT void JNICALL
 Java_com_vmware_jvix_jDiskLibImpl_ExitJNI(JNIEnv *env,
                                           jobject obj)
 {
+   JDiskd_Detach();
+   JTransportProbe_Flush();
+   JConnCache_Shutdown();
+   JIoSched_Shutdown();
    VixDiskLib_Exit();
    JUtils_ExitLogging(gLogger);
 }
@@ -556,7 +623,11 @@ Java_com_vmware_jvix_jDiskLibImpl_ConnectExJNI(JNIEnv *env,
       // user wants to pass NULL, go for it
       result = VixDiskLib_ConnectEx(params, ro, cssMoref, cmodes, NULL);
    } else {
-      result = VixDiskLib_ConnectEx(params, ro, cssMoref, cmodes, &conn);
+      if (ro && JDiskd_IsAttached()) {
+         result = JDiskd_Connect(params, ro, cssMoref, cmodes, &conn);
+      } else {
+         result = JConnCache_Connect(params, ro, cssMoref, cmodes, &conn);
+      }
       assert(sizeof(jout) >= sizeof(conn));
       jout = (jlong)(size_t)conn;
       (*env)->SetLongArrayRegion(env, handle, 0, 1, &jout);
@@ -586,7 +657,11 @@ Java_com_vmware_jvix_jDiskLibImpl_DisconnectJNI(JNIEnv *env,
                                                 jlong handle)
 {
    VixDiskLibConnection conn = (VixDiskLibConnection)(size_t)handle;
-   return VixDiskLib_Disconnect(conn);
+
+   if (JDiskd_IsRemote(conn)) {
+      return JDiskd_Disconnect(conn);
+   }
+   return JConnCache_Disconnect(conn);
 }
 
 
@@ -678,14 +753,21 @@ Java_com_vmware_jvix_jDiskLibImpl_QueryAllocatedBlocksJNI(JNIEnv *env,
    uint32 i;
    VixDiskLibBlockList *blockList = NULL;
    VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
+   Bool remote = JDiskd_IsRemote(cDiskHandle);
    jclass blockClass = (*env)->FindClass(env, "com/vmware/jvix/jDiskLib$Block");
    jmethodID blockInit = (*env)->GetMethodID(env, blockClass, "<init>", "()V");
    jclass listClass = (*env)->FindClass(env, "java/util/List");
    jmethodID listClassAdd = (*env)->GetMethodID(env, listClass, "add",
                                                 "(Ljava/lang/Object;)Z");
 
-   result = VixDiskLib_QueryAllocatedBlocks(cDiskHandle, startSector,
-                                            numSectors, chunkSize, &blockList);
+   if (remote) {
+      result = JDiskd_QueryAllocatedBlocks(cDiskHandle, startSector,
+                                           numSectors, chunkSize, &blockList);
+   } else {
+      result = VixDiskLib_QueryAllocatedBlocks(cDiskHandle, startSector,
+                                               numSectors, chunkSize,
+                                               &blockList);
+   }
    if (result == VIX_OK) {
       for (i = 0; i < blockList->numBlocks; i++) {
          jobject newBlock = (*env)->NewObject(env, blockClass, blockInit);
@@ -698,7 +780,11 @@ Java_com_vmware_jvix_jDiskLibImpl_QueryAllocatedBlocksJNI(JNIEnv *env,
       }
    }
 
-   VixDiskLib_FreeBlockList(blockList);
+   if (remote) {
+      free(blockList);
+   } else {
+      VixDiskLib_FreeBlockList(blockList);
+   }
    return result;
 }
 
@@ -726,17 +812,29 @@ Java_com_vmware_jvix_jDiskLibImpl_OpenJNI(JNIEnv *env,
    const char *cPath;
    VixError result;
    VixDiskLibHandle cDiskHandle = NULL;
+   Bool reused;
    jlong jout;
 
    cPath = GETSTRING(path);
 
    if (diskHandle == NULL) {
       // User wants to pass NULL, for great justice. Let them.
-      result = VixDiskLib_Open(conn, cPath, flags, (VixDiskLibHandle*) NULL);
+      result = JDiskd_IsRemote(conn) ? VIX_E_NOT_SUPPORTED :
+               VixDiskLib_Open(conn, cPath, flags, (VixDiskLibHandle*) NULL);
+   } else if (JDiskd_IsRemote(conn)) {
+      result = JDiskd_Open(conn, cPath, flags, &cDiskHandle);
+      jout = (jlong)(size_t)cDiskHandle;
+      (*env)->SetLongArrayRegion(env, diskHandle, 0, 1, &jout);
+      if (result == VIX_OK) {
+         JNITagDatastore(cDiskHandle, cPath);
+      }
    } else {
-      result = VixDiskLib_Open(conn, cPath, flags, &cDiskHandle);
+      result = JConnCache_Open(conn, cPath, flags, &cDiskHandle, &reused);
       jout = (jlong)(size_t)cDiskHandle;
       (*env)->SetLongArrayRegion(env, diskHandle, 0, 1, &jout);
+      if (result == VIX_OK && !reused) {
+         JNITagDatastore(cDiskHandle, cPath);
+      }
    }
 
    FREESTRING(cPath, path);
@@ -761,7 +859,14 @@ Java_com_vmware_jvix_jDiskLibImpl_CloseJNI(JNIEnv *env,
                                            jlong diskHandle)
 {
    VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
-   return VixDiskLib_Close(cDiskHandle);
+
+   if (JDiskd_IsRemote(cDiskHandle)) {
+      JAsyncQueue_Release(cDiskHandle);
+      JThrottle_Release(cDiskHandle);
+      JMetadata_Release(cDiskHandle);
+      return JDiskd_Close(cDiskHandle);
+   }
+   return JConnCache_Close(cDiskHandle);
 }
 
 
@@ -786,6 +891,7 @@ Java_com_vmware_jvix_jDiskLibImpl_UnlinkJNI(JNIEnv *env,
    const char *cPath;
    VixError result;
 
+   JDISKD_UNSUPPORTED(connHandle);
    cPath = GETSTRING(path);
    result = VixDiskLib_Unlink(conn, cPath);
    FREESTRING(cPath, path);
@@ -815,12 +921,16 @@ Java_com_vmware_jvix_jDiskLibImpl_CreateJNI(JNIEnv *env,
    VixDiskLibConnection conn = (VixDiskLibConnection)(size_t)connHandle;
    const char *cPath;
    VixDiskLibCreateParams cParams;
+   JProgressCall call;
    VixError result;
 
+   JDISKD_UNSUPPORTED(connHandle);
    cPath = GETSTRING(path);
    JNIGetCreateParams(env, createParams, &cParams);
 
-   result = VixDiskLib_Create(conn, cPath, &cParams, &JUtils_ProgressFunc, progress);
+   JProgress_Begin(&call, gLogger, env, progress);
+   result = VixDiskLib_Create(conn, cPath, &cParams, &JProgress_Func, &call);
+   JProgress_End(&call);
 
    FREESTRING(cPath, path);
    return result;
@@ -848,12 +958,16 @@ Java_com_vmware_jvix_jDiskLibImpl_CreateChildJNI(JNIEnv *env,
 {
    VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
    const char *cChildPath;
+   JProgressCall call;
    VixError result;
 
+   JDISKD_UNSUPPORTED(diskHandle);
    cChildPath =  GETSTRING(childPath);
 
+   JProgress_Begin(&call, gLogger, env, progress);
    result = VixDiskLib_CreateChild(cDiskHandle, cChildPath, diskType,
-				   &JUtils_ProgressFunc, progress);
+				   &JProgress_Func, &call);
+   JProgress_End(&call);
 
    FREESTRING(cChildPath, childPath);
    return result;
@@ -887,14 +1001,19 @@ Java_com_vmware_jvix_jDiskLibImpl_CloneJNI(JNIEnv *env,
    const char *cDstPath;
    const char *cSrcPath;
    VixDiskLibCreateParams cParams;
+   JProgressCall call;
    VixError result;
 
+   JDISKD_UNSUPPORTED(dstConn);
+   JDISKD_UNSUPPORTED(srcConn);
    cDstPath = GETSTRING(dstPath);
    cSrcPath = GETSTRING(srcPath);
 
    JNIGetCreateParams(env, createParams, &cParams);
+   JProgress_Begin(&call, gLogger, env, progress);
    result = VixDiskLib_Clone(cDstConn, cDstPath, cSrcConn, cSrcPath, &cParams,
-			     &JUtils_ProgressFunc, progress, overwrite);
+			     &JProgress_Func, &call, overwrite);
+   JProgress_End(&call);
 
    FREESTRING(cDstPath, dstPath);
    FREESTRING(cSrcPath, srcPath);
@@ -925,12 +1044,16 @@ Java_com_vmware_jvix_jDiskLibImpl_GrowJNI(JNIEnv *env,
 {
    VixDiskLibConnection conn = (VixDiskLibConnection)(size_t)connHandle;
    const char *cPath;
+   JProgressCall call;
    VixError result;
 
+   JDISKD_UNSUPPORTED(connHandle);
    cPath = GETSTRING(path);
 
+   JProgress_Begin(&call, gLogger, env, progress);
    result = VixDiskLib_Grow(conn, cPath, capacityInSectors, updateGeometry,
-			    &JUtils_ProgressFunc, progress);
+			    &JProgress_Func, &call);
+   JProgress_End(&call);
 
    FREESTRING(cPath, path);
    return result;
@@ -955,8 +1078,14 @@ Java_com_vmware_jvix_jDiskLibImpl_ShrinkJNI(JNIEnv *env,
                                             jobject progress)
 {
    VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
+   JProgressCall call;
+   VixError result;
 
-   return VixDiskLib_Shrink(cDiskHandle, &JUtils_ProgressFunc, progress);
+   JDISKD_UNSUPPORTED(diskHandle);
+   JProgress_Begin(&call, gLogger, env, progress);
+   result = VixDiskLib_Shrink(cDiskHandle, &JProgress_Func, &call);
+   JProgress_End(&call);
+   return result;
 }
 
 
@@ -978,8 +1107,14 @@ Java_com_vmware_jvix_jDiskLibImpl_DefragmentJNI(JNIEnv *env,
                                                 jobject progress)
 {
    VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
+   JProgressCall call;
+   VixError result;
 
-   return VixDiskLib_Defragment(cDiskHandle, &JUtils_ProgressFunc, progress);
+   JDISKD_UNSUPPORTED(diskHandle);
+   JProgress_Begin(&call, gLogger, env, progress);
+   result = VixDiskLib_Defragment(cDiskHandle, &JProgress_Func, &call);
+   JProgress_End(&call);
+   return result;
 }
 
 
@@ -1003,6 +1138,8 @@ Java_com_vmware_jvix_jDiskLibImpl_IsAttachPossibleJNI(JNIEnv *env,
    VixDiskLibHandle cParent = (VixDiskLibHandle)(size_t)parent;
    VixDiskLibHandle cChild = (VixDiskLibHandle)(size_t)child;
 
+   JDISKD_UNSUPPORTED(parent);
+   JDISKD_UNSUPPORTED(child);
    return VixDiskLib_IsAttachPossible(cParent, cChild);
 }
 
@@ -1027,10 +1164,47 @@ Java_com_vmware_jvix_jDiskLibImpl_AttachJNI(JNIEnv *env,
    VixDiskLibHandle cParent = (VixDiskLibHandle)(size_t)parent;
    VixDiskLibHandle cChild = (VixDiskLibHandle)(size_t)child;
 
+   JDISKD_UNSUPPORTED(parent);
+   JDISKD_UNSUPPORTED(child);
    return VixDiskLib_Attach(cParent, cChild);
 }
 
 
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskLibStage --
+ *
+ *      Check that a Java array can hold "numSectors" sectors and get the
+ *      staging buffer of the calling thread for them.
+ *
+ * Results:
+ *      VIX_OK, VIX_E_INVALID_ARG if the array is too small or
+ *      VIX_E_OUT_OF_MEMORY.
+ *
+ * Side effects:
+ *      See JUtils_GetStagingBuffer.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static VixError
+JDiskLibStage(JNIEnv *env,        // IN: Java Environment
+              jbyteArray buf,     // IN: Java buffer
+              jlong numSectors,   // IN: Sectors to transfer
+              uint8 **staging)    // OUT: Staging buffer
+{
+   jlong size = numSectors * VIXDISKLIB_SECTOR_SIZE;
+
+   if (buf == NULL || numSectors < 0 ||
+       size > (*env)->GetArrayLength(env, buf)) {
+      return VIX_E_INVALID_ARG;
+   }
+   *staging = JUtils_GetStagingBuffer((size_t)size);
+   return *staging != NULL ? VIX_OK : VIX_E_OUT_OF_MEMORY;
+}
+
+
 /*
  *-----------------------------------------------------------------------------
  *
@@ -1051,14 +1225,26 @@ Java_com_vmware_jvix_jDiskLibImpl_ReadJNI(JNIEnv *env,
                                           jbyteArray buf)
 {
    VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
-   jbyte *jBuf;
+   uint8 *staging;
    VixError result;
 
-   jBuf = (*env)->GetByteArrayElements(env, buf, NULL);
+   result = JDiskLibStage(env, buf, numSectors, &staging);
+   if (result != VIX_OK) {
+      return result;
+   }
+   JThrottle_Consume(cDiskHandle, numSectors * VIXDISKLIB_SECTOR_SIZE);
 
-   result = VixDiskLib_Read(cDiskHandle, startSector,
-                            numSectors, (uint8*)jBuf);
-   (*env)->ReleaseByteArrayElements(env, buf, jBuf, 0);
+   if (JDiskd_IsRemote(cDiskHandle)) {
+      result = JDiskd_Read(cDiskHandle, startSector, numSectors, staging);
+   } else {
+      result = VixDiskLib_Read(cDiskHandle, startSector,
+                               numSectors, staging);
+   }
+   if (result == VIX_OK) {
+      (*env)->SetByteArrayRegion(env, buf, 0,
+                                 (jsize)(numSectors * VIXDISKLIB_SECTOR_SIZE),
+                                 (jbyte*)staging);
+   }
    return result;
 }
 
@@ -1090,6 +1276,11 @@ Java_com_vmware_jvix_jDiskLibImpl_BufferReadJNI(JNIEnv *env,
       data = (*env)->GetDirectBufferAddress(env, jBuf);
    }
 
+   JThrottle_Consume(cDiskHandle, numSectors * VIXDISKLIB_SECTOR_SIZE);
+   if (JDiskd_IsRemote(cDiskHandle)) {
+      return JDiskd_Read(cDiskHandle, startSector, numSectors,
+                         (uint8*)data);
+   }
    result = VixDiskLib_Read(cDiskHandle, startSector,
                             numSectors, (uint8*)data);
    return result;
@@ -1119,6 +1310,7 @@ Java_com_vmware_jvix_jDiskLibImpl_ReadAsyncJNI(JNIEnv *env,
    VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
    jUtilsAsyncCallback *asyncCallback = NULL;
    VixDiskLibCompletionCB completionCB = NULL;
+   JAsyncQueueRequest *request;
    void *data = NULL;
    VixError result;
 
@@ -1131,124 +1323,198 @@ Java_com_vmware_jvix_jDiskLibImpl_ReadAsyncJNI(JNIEnv *env,
       data = (*env)->GetDirectBufferAddress(env, buffer);
    }
 
+   JThrottle_Consume(cDiskHandle, (uint64)sectorCount * VIXDISKLIB_SECTOR_SIZE);
+
+   /*
+    * jdiskd keeps its own window: the slots of the shared region.
+    */
+   if (JDiskd_IsRemote(cDiskHandle)) {
+      return JDiskd_ReadAsync(cDiskHandle, startSector, sectorCount,
+                              (uint8*)data, completionCB, asyncCallback);
+   }
+
+   /*
+    * Route the request through the adaptive queue-depth controller. It
+    * blocks here while the in-flight window of the disk is full.
+    */
+   request = JAsyncQueue_Begin(cDiskHandle, sectorCount, completionCB,
+                               asyncCallback);
+   if (request == NULL) {
+      if (asyncCallback != NULL) {
+         jUtils_ReleaseAsyncCallback(asyncCallback);
+      }
+      return VIX_E_OUT_OF_MEMORY;
+   }
+
    result = VixDiskLib_ReadAsync(cDiskHandle,
                                  startSector,
                                  sectorCount,
                                  (uint8*)data,
-                                 completionCB,
-                                 (void*)asyncCallback);
+                                 JAsyncQueue_CompletionCB,
+                                 (void*)request);
+   if (result != VIX_OK && result != VIX_ASYNC) {
+      JAsyncQueue_Abort(request);
+   }
 
    return result;
 }
 
+
 /*
  *-----------------------------------------------------------------------------
  *
- * WriteJNI --
+ * SetAsyncQueueBoundsJNI --
  *
- *      JNI implementation for VixDiskLib_Write. See VixDiskLib docs
- *      for details.
+ *      Set the bounds of the adaptive async queue depth of a disk handle,
+ *      or the defaults for disks opened later if diskHandle is 0.
+ *
+ * Results:
+ *      VIX_OK or VIX_E_OUT_OF_MEMORY.
+ *
+ * Side effects:
+ *      None.
  *
  *-----------------------------------------------------------------------------
  */
 
 JNIEXPORT jlong JNICALL
-Java_com_vmware_jvix_jDiskLibImpl_WriteJNI(JNIEnv *env,
-                                           jobject obj,
-                                           jlong diskHandle,
-                                           jlong startSector,
-                                           jlong numSectors,
-                                           jbyteArray buf)
+Java_com_vmware_jvix_jDiskLibImpl_SetAsyncQueueBoundsJNI(JNIEnv *env,
+                                                         jobject obj,
+                                                         jlong diskHandle,
+                                                         jint minDepth,
+                                                         jint maxDepth)
 {
    VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
-   jbyte *jBuf;
-   VixError result;
-
-   jBuf = (*env)->GetByteArrayElements(env, buf, NULL);
-
-   result = VixDiskLib_Write(cDiskHandle, startSector,
-                             numSectors, (uint8*)jBuf);
 
-   (*env)->ReleaseByteArrayElements(env, buf, jBuf, JNI_ABORT);
-   return result;
+   if (minDepth < 0 || maxDepth < 0) {
+      return VIX_E_INVALID_ARG;
+   }
+   if (cDiskHandle == NULL) {
+      JAsyncQueue_SetDefaultBounds(minDepth, maxDepth);
+      return VIX_OK;
+   }
+   return JAsyncQueue_SetBounds(cDiskHandle, minDepth, maxDepth) ?
+          VIX_OK : VIX_E_OUT_OF_MEMORY;
 }
 
 
 /*
  *-----------------------------------------------------------------------------
  *
- * BufferWriteJNI --
+ * GetAsyncQueueStatsJNI --
  *
- *      JNI implementation for VixDiskLib_Write. See VixDiskLib docs
- *      for details.
+ *      Copy the adaptive async queue statistics of a disk handle into
+ *      a long[] laid out as JAsyncQueueStat.
+ *
+ * Results:
+ *      VIX_OK, VIX_E_INVALID_ARG if the array is too short.
+ *
+ * Side effects:
+ *      None.
  *
  *-----------------------------------------------------------------------------
  */
 
 JNIEXPORT jlong JNICALL
-Java_com_vmware_jvix_jDiskLibImpl_BufferWriteJNI(JNIEnv *env,
-                                                 jobject obj,
-                                                 jlong diskHandle,
-                                                 jlong startSector,
-                                                 jlong numSectors,
-                                                 jobject jBuf)
+Java_com_vmware_jvix_jDiskLibImpl_GetAsyncQueueStatsJNI(JNIEnv *env,
+                                                        jobject obj,
+                                                        jlong diskHandle,
+                                                        jlongArray stats)
 {
    VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
-   jbyte *data = NULL;
-   VixError result;
+   int64 cStats[JAsyncQueueStatCount];
+   jlong jStats[JAsyncQueueStatCount];
+   int i;
 
-   if (jBuf) {
-      data = (*env)->GetDirectBufferAddress(env, jBuf);
+   if (stats == NULL ||
+       (*env)->GetArrayLength(env, stats) < JAsyncQueueStatCount) {
+      return VIX_E_INVALID_ARG;
    }
-
-   result = VixDiskLib_Write(cDiskHandle, startSector,
-                             numSectors, (uint8*)data);
-
-   return result;
+   JAsyncQueue_GetStats(cDiskHandle, cStats);
+   for (i = 0; i < JAsyncQueueStatCount; i++) {
+      jStats[i] = cStats[i];
+   }
+   (*env)->SetLongArrayRegion(env, stats, 0, JAsyncQueueStatCount, jStats);
+   return VIX_OK;
 }
 
+
 /*
  *-----------------------------------------------------------------------------
  *
- * WriteAsyncJNI --
+ * SetThrottleLimitJNI --
  *
- *      JNI implementation for VixDiskLib_WriteAsync. See VixDiskLib docs
- *      for details.
+ *      Set a bandwidth limit. See JThrottle_SetLimit for the meaning of
+ *      scope, name and diskHandle. Takes effect on running I/O.
+ *
+ * Results:
+ *      VIX_OK, VIX_E_INVALID_ARG or VIX_E_OUT_OF_MEMORY.
+ *
+ * Side effects:
+ *      None.
  *
  *-----------------------------------------------------------------------------
  */
 
 JNIEXPORT jlong JNICALL
-Java_com_vmware_jvix_jDiskLibImpl_WriteAsyncJNI(JNIEnv *env,
-                                                jobject obj,
-                                                jlong diskHandle,
-                                                jlong startSector,
-                                                jobject buffer,
-                                                jint sectorCount,
-                                                jobject callbackObj)
+Java_com_vmware_jvix_jDiskLibImpl_SetThrottleLimitJNI(JNIEnv *env,
+                                                      jobject obj,
+                                                      jint scope,
+                                                      jstring name,
+                                                      jlong diskHandle,
+                                                      jlong bytesPerSec,
+                                                      jlong burstBytes)
 {
    VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
-   jUtilsAsyncCallback *asyncCallback = NULL;
-   VixDiskLibCompletionCB completionCB = NULL;
-   void *data = NULL;
+   const char *cName;
    VixError result;
 
-   if (callbackObj) {
-      asyncCallback = jUtils_CreateAsyncCallback(env, callbackObj);
-      completionCB = (VixDiskLibCompletionCB)jUtilsCompletionCB;
+   if (scope < JThrottleScopeGlobal || scope >= JThrottleScopeCount ||
+       bytesPerSec < 0 || burstBytes < 0) {
+      return VIX_E_INVALID_ARG;
    }
+   cName = GETSTRING(name);
+   result = JThrottle_SetLimit(scope, cName, cDiskHandle, bytesPerSec,
+                               burstBytes) ? VIX_OK : VIX_E_OUT_OF_MEMORY;
+   FREESTRING(cName, name);
+   return result;
+}
 
-   if (buffer) {
-      data = (*env)->GetDirectBufferAddress(env, buffer);
-   }
 
-   result = VixDiskLib_WriteAsync(cDiskHandle,
-                                  startSector,
-                                  sectorCount,
-                                  (uint8*)data,
-                                  completionCB,
-                                  (void*)asyncCallback);
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * SetThrottleTagsJNI --
+ *
+ *      Attach a disk handle to the throttling buckets of its ESX host and
+ *      datastore.
+ *
+ * Results:
+ *      VIX_OK or VIX_E_OUT_OF_MEMORY.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_SetThrottleTagsJNI(JNIEnv *env,
+                                                     jobject obj,
+                                                     jlong diskHandle,
+                                                     jstring host,
+                                                     jstring datastore)
+{
+   VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
+   const char *cHost, *cDatastore;
+   VixError result;
 
+   cHost = GETSTRING(host);
+   cDatastore = GETSTRING(datastore);
+   result = JThrottle_SetDiskTags(cDiskHandle, cHost, cDatastore) ?
+            VIX_OK : VIX_E_OUT_OF_MEMORY;
+   FREESTRING(cHost, host);
+   FREESTRING(cDatastore, datastore);
    return result;
 }
 
@@ -1256,111 +1522,146 @@ Java_com_vmware_jvix_jDiskLibImpl_WriteAsyncJNI(JNIEnv *env,
 /*
  *-----------------------------------------------------------------------------
  *
- * WaitJNI --
+ * SetIoSchedulerJNI --
  *
- *      JNI implementation for VixDiskLib_Flush. See VixDiskLib docs
- *      for details.
+ *      Configure the I/O scheduler: policy (JIoPolicy), maximum number of
+ *      requests dispatched at once and per class weights (may be null).
+ *
+ * Results:
+ *      VIX_OK or VIX_E_INVALID_ARG.
+ *
+ * Side effects:
+ *      None.
  *
  *-----------------------------------------------------------------------------
  */
 
 JNIEXPORT jlong JNICALL
-Java_com_vmware_jvix_jDiskLibImpl_WaitJNI(JNIEnv *env,
-                                           jobject obj,
-                                           jlong diskHandle)
+Java_com_vmware_jvix_jDiskLibImpl_SetIoSchedulerJNI(JNIEnv *env,
+                                                    jobject obj,
+                                                    jint policy,
+                                                    jint maxInFlight,
+                                                    jintArray weights)
 {
-   VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
-   return VixDiskLib_Wait(cDiskHandle);
+   uint32 cWeights[JIoClassCount];
+   jint jWeights[JIoClassCount];
+   int i;
+
+   if ((policy != JIoPolicyWeighted && policy != JIoPolicyStrict) ||
+       maxInFlight <= 0) {
+      return VIX_E_INVALID_ARG;
+   }
+   if (weights != NULL) {
+      if ((*env)->GetArrayLength(env, weights) < JIoClassCount) {
+         return VIX_E_INVALID_ARG;
+      }
+      (*env)->GetIntArrayRegion(env, weights, 0, JIoClassCount, jWeights);
+      for (i = 0; i < JIoClassCount; i++) {
+         cWeights[i] = jWeights[i] > 0 ? jWeights[i] : 1;
+      }
+   }
+   JIoSched_Configure(policy, maxInFlight, weights != NULL ? cWeights : NULL);
+   return VIX_OK;
 }
 
+
 /*
  *-----------------------------------------------------------------------------
  *
- * FlushJNI --
+ * RegisterIoJobJNI --
  *
- *      JNI implementation for VixDiskLib_Flush. See VixDiskLib docs
- *      for details.
+ *      Declare the priority class and deadline (milliseconds from now,
+ *      0 for none) of a job using the I/O scheduler.
+ *
+ * Results:
+ *      VIX_OK or VIX_E_OUT_OF_MEMORY.
+ *
+ * Side effects:
+ *      None.
  *
  *-----------------------------------------------------------------------------
  */
 
 JNIEXPORT jlong JNICALL
-Java_com_vmware_jvix_jDiskLibImpl_FlushJNI(JNIEnv *env,
-                                           jobject obj,
-                                           jlong diskHandle)
+Java_com_vmware_jvix_jDiskLibImpl_RegisterIoJobJNI(JNIEnv *env,
+                                                   jobject obj,
+                                                   jlong jobId,
+                                                   jint ioClass,
+                                                   jlong deadlineMs)
 {
-   VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
-   return VixDiskLib_Flush(cDiskHandle);
+   return JIoSched_RegisterJob(jobId, ioClass,
+                               deadlineMs > 0 ? deadlineMs : 0) ?
+          VIX_OK : VIX_E_OUT_OF_MEMORY;
 }
 
 
 /*
  *-----------------------------------------------------------------------------
  *
- * GetMetadataKeysJNI --
+ * UnregisterIoJobJNI --
  *
- *      JNI implementation for VixDiskLib_GetMetadataKeys. See VixDiskLib docs
- *      for details.
+ *      Forget a job of the I/O scheduler.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None.
  *
  *-----------------------------------------------------------------------------
  */
 
-JNIEXPORT jobjectArray JNICALL
-Java_com_vmware_jvix_jDiskLibImpl_GetMetadataKeysJNI(JNIEnv *env,
+JNIEXPORT void JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_UnregisterIoJobJNI(JNIEnv *env,
                                                      jobject obj,
-                                                     jlong diskHandle)
+                                                     jlong jobId)
 {
-   VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
-   size_t required;
-   VixError err;
-   jobjectArray result = NULL;
-   char *keys, *hlp;
-   int i;
-   jclass strClass;
-
-   strClass =  (*env)->FindClass(env, "java/lang/String");
-
-   err = VixDiskLib_GetMetadataKeys(cDiskHandle, NULL, 0, &required);
-   if (err != VIX_E_BUFFER_TOOSMALL) {
-      JUtils_Log("GetMetaDataKeys: Not finding any keys!\n");
-      result = (*env)->NewObjectArray(env, 0, strClass, 0);
-      goto out;
-   }
+   JIoSched_UnregisterJob(jobId);
+}
 
-   keys = malloc(required);
-   assert(keys != NULL);
-   err = VixDiskLib_GetMetadataKeys(cDiskHandle, keys, required, NULL);
-   if (err != VIX_OK) {
-      JUtils_Log("GetMetaDataKeys: Cannot fetch keys!\n");
-      result = (*env)->NewObjectArray(env, 0, strClass, 0);
-      goto out;
-   }
 
-   /* Count metadata keys */
-   hlp = keys;
-   i = 0;
-   while (hlp[0] != '\0') {
-      i += 1;
-      hlp += strlen(hlp) + 1;
-   }
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * ScheduledReadJNI --
+ *
+ *      VixDiskLib_Read through the I/O scheduler, on behalf of a job.
+ *
+ * Results:
+ *      VixError of the read.
+ *
+ * Side effects:
+ *      Blocks until the read is complete.
+ *
+ *-----------------------------------------------------------------------------
+ */
 
-   /* Create object array large enough to hold all strings */
-   result = (*env)->NewObjectArray(env, i, strClass, 0);
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_ScheduledReadJNI(JNIEnv *env,
+                                                   jobject obj,
+                                                   jlong jobId,
+                                                   jlong diskHandle,
+                                                   jlong startSector,
+                                                   jlong numSectors,
+                                                   jbyteArray buf)
+{
+   VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
+   uint8 *staging;
+   VixError result;
 
-   /* Fill object array. */
-   hlp = keys;
-   i = 0;
-   while (hlp[0] != '\0') {
-      jstring str;
-      str = (*env)->NewStringUTF(env, hlp);
-      (*env)->SetObjectArrayElement(env, result, i, str);
-      i += 1;
-      hlp += strlen(hlp) + 1;
+   result = JDiskLibStage(env, buf, numSectors, &staging);
+   if (result != VIX_OK) {
+      return result;
    }
-   free(keys);
+   JThrottle_Consume(cDiskHandle, numSectors * VIXDISKLIB_SECTOR_SIZE);
 
- out:
-   (*env)->DeleteLocalRef(env, strClass);
+   result = JIoSched_Transfer(jobId, cDiskHandle, FALSE, startSector,
+                              numSectors, staging);
+   if (result == VIX_OK) {
+      (*env)->SetByteArrayRegion(env, buf, 0,
+                                 (jsize)(numSectors * VIXDISKLIB_SECTOR_SIZE),
+                                 (jbyte*)staging);
+   }
    return result;
 }
 
@@ -1368,129 +1669,220 @@ Java_com_vmware_jvix_jDiskLibImpl_GetMetadataKeysJNI(JNIEnv *env,
 /*
  *-----------------------------------------------------------------------------
  *
- *  ReadMetadataJNI --
+ * ScheduledWriteJNI --
  *
- *      JNI implementation for VixDiskLib_ReadMetadata. See VixDiskLib docs
- *      for details.
+ *      VixDiskLib_Write through the I/O scheduler, on behalf of a job.
+ *
+ * Results:
+ *      VixError of the write.
+ *
+ * Side effects:
+ *      Blocks until the write is complete.
  *
  *-----------------------------------------------------------------------------
  */
 
 JNIEXPORT jlong JNICALL
-Java_com_vmware_jvix_jDiskLibImpl_ReadMetadataJNI(JNIEnv *env,
-                                                  jobject obj,
-                                                  jlong diskHandle,
-                                                  jstring key,
-                                                  jobject valOut)
+Java_com_vmware_jvix_jDiskLibImpl_ScheduledWriteJNI(JNIEnv *env,
+                                                    jobject obj,
+                                                    jlong jobId,
+                                                    jlong diskHandle,
+                                                    jlong startSector,
+                                                    jlong numSectors,
+                                                    jbyteArray buf)
 {
    VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
-   const char *cKey;
-   size_t required;
-   VixError err;
-   char *val = NULL;
-   jstring result;
-   jclass cls;
-   jmethodID appendMid;
+   uint8 *staging;
+   VixError result;
 
-   cKey = GETSTRING(key);
-   err = VixDiskLib_ReadMetadata(cDiskHandle, cKey, NULL, 0, &required);
-   if (err != VIX_E_BUFFER_TOOSMALL) {
-      JUtils_Log("ReadMetadataEx: Cannot get meta for key %s, err (%d).\n",
-                 cKey, err);
-      goto out;
+   JDISKD_UNSUPPORTED(diskHandle);
+   result = JDiskLibStage(env, buf, numSectors, &staging);
+   if (result != VIX_OK) {
+      return result;
    }
+   (*env)->GetByteArrayRegion(env, buf, 0,
+                              (jsize)(numSectors * VIXDISKLIB_SECTOR_SIZE),
+                              (jbyte*)staging);
+   JThrottle_Consume(cDiskHandle, numSectors * VIXDISKLIB_SECTOR_SIZE);
 
-   val = malloc(required);
-   assert(val != NULL);
+   return JIoSched_Transfer(jobId, cDiskHandle, TRUE, startSector,
+                            numSectors, staging);
+}
 
-   err = VixDiskLib_ReadMetadata(cDiskHandle, cKey, val, required, NULL);
-   if (err != VIX_OK) {
-      JUtils_Log("ReadMetadataEx: Cannot get meta for key %s, err (%d).\n",
-                 cKey, err);
-      goto out;
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * ScheduledAsyncJNI --
+ *
+ *      Async read or write of a direct ByteBuffer through the I/O
+ *      scheduler. callbackObj (AsyncIOListener) is notified on completion.
+ *
+ * Results:
+ *      VIX_ASYNC or an error if the request could not be queued.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_ScheduledAsyncJNI(JNIEnv *env,
+                                                    jobject obj,
+                                                    jlong jobId,
+                                                    jlong diskHandle,
+                                                    jboolean write,
+                                                    jlong startSector,
+                                                    jobject buffer,
+                                                    jint sectorCount,
+                                                    jobject callbackObj)
+{
+   VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
+   jUtilsAsyncCallback *asyncCallback = NULL;
+   VixDiskLibCompletionCB completionCB = NULL;
+   void *data = NULL;
+   VixError result;
+
+   if (write && JDiskd_IsRemote(cDiskHandle)) {
+      return VIX_E_NOT_SUPPORTED;
+   }
+   if (callbackObj) {
+      asyncCallback = jUtils_CreateAsyncCallback(env, callbackObj);
+      completionCB = (VixDiskLibCompletionCB)jUtilsCompletionCB;
    }
 
-   result = (*env)->NewStringUTF(env, val);
-   cls = (*env)->GetObjectClass(env, valOut);
-   appendMid = (*env)->GetMethodID(env, cls, "append",
-                     "(Ljava/lang/String;)Ljava/lang/StringBuffer;");
-   if (appendMid) {
-      (*env)->CallObjectMethod(env, valOut, appendMid, result);
+   if (buffer) {
+      data = (*env)->GetDirectBufferAddress(env, buffer);
    }
 
- out:
-   FREESTRING(cKey, key);
-   free(val);
-   return err;
+   JThrottle_Consume(cDiskHandle, (uint64)sectorCount * VIXDISKLIB_SECTOR_SIZE);
+   result = JIoSched_Submit(jobId, cDiskHandle, write, startSector,
+                            sectorCount, (uint8*)data, completionCB,
+                            (void*)asyncCallback);
+   if (result != VIX_ASYNC && asyncCallback != NULL) {
+      jUtils_ReleaseAsyncCallback(asyncCallback);
+   }
+   return result;
 }
 
-
 /*
  *-----------------------------------------------------------------------------
  *
- *  WriteMetadataJNI --
+ * WriteJNI --
  *
- *      JNI implementation for VixDiskLib_WriteMetadata. See VixDiskLib docs
+ *      JNI implementation for VixDiskLib_Write. See VixDiskLib docs
  *      for details.
  *
  *-----------------------------------------------------------------------------
  */
 
 JNIEXPORT jlong JNICALL
-Java_com_vmware_jvix_jDiskLibImpl_WriteMetadataJNI(JNIEnv *env,
-                                                   jobject obj,
-                                                   jlong diskHandle,
-                                                   jstring key,
-                                                   jstring val)
+Java_com_vmware_jvix_jDiskLibImpl_WriteJNI(JNIEnv *env,
+                                           jobject obj,
+                                           jlong diskHandle,
+                                           jlong startSector,
+                                           jlong numSectors,
+                                           jbyteArray buf)
 {
    VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
-   const char *cKey;
-   const char *cVal;
+   uint8 *staging;
    VixError result;
 
-   cKey = GETSTRING(key);
-   cVal = GETSTRING(val);
+   JDISKD_UNSUPPORTED(diskHandle);
+   result = JDiskLibStage(env, buf, numSectors, &staging);
+   if (result != VIX_OK) {
+      return result;
+   }
+   (*env)->GetByteArrayRegion(env, buf, 0,
+                              (jsize)(numSectors * VIXDISKLIB_SECTOR_SIZE),
+                              (jbyte*)staging);
+   JThrottle_Consume(cDiskHandle, numSectors * VIXDISKLIB_SECTOR_SIZE);
 
-   result = VixDiskLib_WriteMetadata(cDiskHandle, cKey, cVal);
+   return VixDiskLib_Write(cDiskHandle, startSector,
+                           numSectors, staging);
+}
 
-   FREESTRING(cKey, key);
-   FREESTRING(cVal, val);
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * BufferWriteJNI --
+ *
+ *      JNI implementation for VixDiskLib_Write. See VixDiskLib docs
+ *      for details.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_BufferWriteJNI(JNIEnv *env,
+                                                 jobject obj,
+                                                 jlong diskHandle,
+                                                 jlong startSector,
+                                                 jlong numSectors,
+                                                 jobject jBuf)
+{
+   VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
+   jbyte *data = NULL;
+   VixError result;
+
+   JDISKD_UNSUPPORTED(diskHandle);
+   if (jBuf) {
+      data = (*env)->GetDirectBufferAddress(env, jBuf);
+   }
+
+   JThrottle_Consume(cDiskHandle, numSectors * VIXDISKLIB_SECTOR_SIZE);
+   result = VixDiskLib_Write(cDiskHandle, startSector,
+                             numSectors, (uint8*)data);
 
    return result;
 }
 
-
 /*
  *-----------------------------------------------------------------------------
  *
- *  GetInfoJNI --
+ * WriteAsyncJNI --
  *
- *      JNI implementation for VixDiskLib_GetInfo. See VixDiskLib docs
+ *      JNI implementation for VixDiskLib_WriteAsync. See VixDiskLib docs
  *      for details.
  *
  *-----------------------------------------------------------------------------
  */
 
 JNIEXPORT jlong JNICALL
-Java_com_vmware_jvix_jDiskLibImpl_GetInfoJNI(JNIEnv *env,
-                                             jobject obj,
-                                             jlong diskHandle,
-                                             jobject dli)
+Java_com_vmware_jvix_jDiskLibImpl_WriteAsyncJNI(JNIEnv *env,
+                                                jobject obj,
+                                                jlong diskHandle,
+                                                jlong startSector,
+                                                jobject buffer,
+                                                jint sectorCount,
+                                                jobject callbackObj)
 {
-   VixDiskLibInfo *info = NULL;
    VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
+   jUtilsAsyncCallback *asyncCallback = NULL;
+   VixDiskLibCompletionCB completionCB = NULL;
+   void *data = NULL;
    VixError result;
 
-   if (dli == NULL) {
-      result = VixDiskLib_GetInfo(cDiskHandle, NULL);
-   } else {
-      result = VixDiskLib_GetInfo(cDiskHandle, &info);
+   JDISKD_UNSUPPORTED(diskHandle);
+   if (callbackObj) {
+      asyncCallback = jUtils_CreateAsyncCallback(env, callbackObj);
+      completionCB = (VixDiskLibCompletionCB)jUtilsCompletionCB;
    }
 
-   if (info != NULL) {
-      JNISetDiskLibInfo(info, env, dli);
-      VixDiskLib_FreeInfo(info);
+   if (buffer) {
+      data = (*env)->GetDirectBufferAddress(env, buffer);
    }
+
+   JThrottle_Consume(cDiskHandle, (uint64)sectorCount * VIXDISKLIB_SECTOR_SIZE);
+   result = VixDiskLib_WriteAsync(cDiskHandle,
+                                  startSector,
+                                  sectorCount,
+                                  (uint8*)data,
+                                  completionCB,
+                                  (void*)asyncCallback);
+
    return result;
 }
 
@@ -1498,311 +1890,2112 @@ Java_com_vmware_jvix_jDiskLibImpl_GetInfoJNI(JNIEnv *env,
 /*
  *-----------------------------------------------------------------------------
  *
- *  GetTransportModeJNI --
+ * WaitJNI --
  *
- *      JNI implementation for VixDiskLib_GetTransportMode. See
- *      VixDiskLib docs for details.
+ *      JNI implementation for VixDiskLib_Flush. See VixDiskLib docs
+ *      for details.
  *
  *-----------------------------------------------------------------------------
  */
 
-JNIEXPORT jstring JNICALL
-Java_com_vmware_jvix_jDiskLibImpl_GetTransportModeJNI(JNIEnv *env,
-                                                      jobject obj,
-                                                      jlong diskHandle)
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_WaitJNI(JNIEnv *env,
+                                           jobject obj,
+                                           jlong diskHandle)
 {
    VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
-   const char *mode;
 
-   mode = VixDiskLib_GetTransportMode(cDiskHandle);
-   return (*env)->NewStringUTF(env, mode);
+   if (JDiskd_IsRemote(cDiskHandle)) {
+      return JDiskd_Wait(cDiskHandle);
+   }
+   return VixDiskLib_Wait(cDiskHandle);
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * FlushJNI --
+ *
+ *      JNI implementation for VixDiskLib_Flush. See VixDiskLib docs
+ *      for details.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_FlushJNI(JNIEnv *env,
+                                           jobject obj,
+                                           jlong diskHandle)
+{
+   VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
+
+   JDISKD_UNSUPPORTED(diskHandle);
+   return VixDiskLib_Flush(cDiskHandle);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * GetMetadataKeysJNI --
+ *
+ *      JNI implementation for VixDiskLib_GetMetadataKeys. See VixDiskLib docs
+ *      for details.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jobjectArray JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_GetMetadataKeysJNI(JNIEnv *env,
+                                                     jobject obj,
+                                                     jlong diskHandle)
+{
+   VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
+   size_t required;
+   VixError err;
+   jobjectArray result = NULL;
+   char *keys, *hlp;
+   int i;
+   jclass strClass;
+   Bool remote = JDiskd_IsRemote(cDiskHandle);
+
+   strClass =  (*env)->FindClass(env, "java/lang/String");
+
+   err = remote ?
+         JDiskd_GetMetadataKeys(cDiskHandle, NULL, 0, &required) :
+         VixDiskLib_GetMetadataKeys(cDiskHandle, NULL, 0, &required);
+   if (err != VIX_E_BUFFER_TOOSMALL) {
+      JUtils_Log("GetMetaDataKeys: Not finding any keys!\n");
+      result = (*env)->NewObjectArray(env, 0, strClass, 0);
+      goto out;
+   }
+
+   keys = malloc(required);
+   assert(keys != NULL);
+   err = remote ?
+         JDiskd_GetMetadataKeys(cDiskHandle, keys, required, NULL) :
+         VixDiskLib_GetMetadataKeys(cDiskHandle, keys, required, NULL);
+   if (err != VIX_OK) {
+      JUtils_Log("GetMetaDataKeys: Cannot fetch keys!\n");
+      result = (*env)->NewObjectArray(env, 0, strClass, 0);
+      goto out;
+   }
+
+   /* Count metadata keys */
+   hlp = keys;
+   i = 0;
+   while (hlp[0] != '\0') {
+      i += 1;
+      hlp += strlen(hlp) + 1;
+   }
+
+   /* Create object array large enough to hold all strings */
+   result = (*env)->NewObjectArray(env, i, strClass, 0);
+
+   /* Fill object array. */
+   hlp = keys;
+   i = 0;
+   while (hlp[0] != '\0') {
+      jstring str;
+      str = (*env)->NewStringUTF(env, hlp);
+      (*env)->SetObjectArrayElement(env, result, i, str);
+      i += 1;
+      hlp += strlen(hlp) + 1;
+   }
+   free(keys);
+
+ out:
+   (*env)->DeleteLocalRef(env, strClass);
+   return result;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ *  ReadMetadataJNI --
+ *
+ *      JNI implementation for VixDiskLib_ReadMetadata. See VixDiskLib docs
+ *      for details.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_ReadMetadataJNI(JNIEnv *env,
+                                                  jobject obj,
+                                                  jlong diskHandle,
+                                                  jstring key,
+                                                  jobject valOut)
+{
+   VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
+   const char *cKey;
+   size_t required;
+   VixError err;
+   char *val = NULL;
+   jstring result;
+   jclass cls;
+   jmethodID appendMid;
+   Bool remote = JDiskd_IsRemote(cDiskHandle);
+
+   cKey = GETSTRING(key);
+   err = remote ?
+         JDiskd_ReadMetadata(cDiskHandle, cKey, NULL, 0, &required) :
+         VixDiskLib_ReadMetadata(cDiskHandle, cKey, NULL, 0, &required);
+   if (err != VIX_E_BUFFER_TOOSMALL) {
+      JUtils_Log("ReadMetadataEx: Cannot get meta for key %s, err (%d).\n",
+                 cKey, err);
+      goto out;
+   }
+
+   val = malloc(required);
+   assert(val != NULL);
+
+   err = remote ?
+         JDiskd_ReadMetadata(cDiskHandle, cKey, val, required, NULL) :
+         VixDiskLib_ReadMetadata(cDiskHandle, cKey, val, required, NULL);
+   if (err != VIX_OK) {
+      JUtils_Log("ReadMetadataEx: Cannot get meta for key %s, err (%d).\n",
+                 cKey, err);
+      goto out;
+   }
+
+   result = (*env)->NewStringUTF(env, val);
+   cls = (*env)->GetObjectClass(env, valOut);
+   appendMid = (*env)->GetMethodID(env, cls, "append",
+                     "(Ljava/lang/String;)Ljava/lang/StringBuffer;");
+   if (appendMid) {
+      (*env)->CallObjectMethod(env, valOut, appendMid, result);
+   }
+
+ out:
+   FREESTRING(cKey, key);
+   free(val);
+   return err;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ *  WriteMetadataJNI --
+ *
+ *      JNI implementation for VixDiskLib_WriteMetadata. See VixDiskLib docs
+ *      for details.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_WriteMetadataJNI(JNIEnv *env,
+                                                   jobject obj,
+                                                   jlong diskHandle,
+                                                   jstring key,
+                                                   jstring val)
+{
+   VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
+   const char *cKey;
+   const char *cVal;
+   VixError result;
+
+   JDISKD_UNSUPPORTED(diskHandle);
+   cKey = GETSTRING(key);
+   cVal = GETSTRING(val);
+
+   result = VixDiskLib_WriteMetadata(cDiskHandle, cKey, cVal);
+   JMetadata_Release(cDiskHandle);
+
+   FREESTRING(cKey, key);
+   FREESTRING(cVal, val);
+
+   return result;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ *  GetInfoJNI --
+ *
+ *      JNI implementation for VixDiskLib_GetInfo. See VixDiskLib docs
+ *      for details.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_GetInfoJNI(JNIEnv *env,
+                                             jobject obj,
+                                             jlong diskHandle,
+                                             jobject dli)
+{
+   VixDiskLibInfo *info = NULL;
+   VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
+   VixError result;
+
+   if (JDiskd_IsRemote(cDiskHandle)) {
+      result = JDiskd_GetInfo(cDiskHandle, &info);
+      if (info != NULL) {
+         if (dli != NULL) {
+            JNISetDiskLibInfo(info, env, dli);
+         }
+         JDiskd_FreeInfo(info);
+      }
+      return result;
+   } else if (dli == NULL) {
+      result = VixDiskLib_GetInfo(cDiskHandle, NULL);
+   } else {
+      result = VixDiskLib_GetInfo(cDiskHandle, &info);
+   }
+
+   if (info != NULL) {
+      JNISetDiskLibInfo(info, env, dli);
+      VixDiskLib_FreeInfo(info);
+   }
+   return result;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ *  GetTransportModeJNI --
+ *
+ *      JNI implementation for VixDiskLib_GetTransportMode. See
+ *      VixDiskLib docs for details.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jstring JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_GetTransportModeJNI(JNIEnv *env,
+                                                      jobject obj,
+                                                      jlong diskHandle)
+{
+   VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
+   const char *mode;
+   char *remoteMode;
+   jstring result;
+
+   if (JDiskd_IsRemote(cDiskHandle)) {
+      remoteMode = JDiskd_GetTransportMode(cDiskHandle);
+      result = (*env)->NewStringUTF(env, remoteMode != NULL ? remoteMode : "");
+      free(remoteMode);
+      return result;
+   }
+   mode = VixDiskLib_GetTransportMode(cDiskHandle);
+   return (*env)->NewStringUTF(env, mode);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ *  GetErrorTextJNI --
+ *
+ *      JNI implementation for VixDiskLib_GetErrorText. See VixDiskLib
+ *      docs for details.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jstring JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_GetErrorTextJNI(JNIEnv *env,
+                                                  jobject obj,
+                                                  jlong error,
+                                                  jstring locale)
+{
+   char *errTxt;
+   const char *cLocale;
+   jstring result;
+
+   cLocale =  GETSTRING(locale);
+
+   errTxt = VixDiskLib_GetErrorText(error, cLocale);
+   if (errTxt != NULL) {
+      result = (*env)->NewStringUTF(env, errTxt);
+      VixDiskLib_FreeErrorText(errTxt);
+   } else {
+      result = (*env)->NewStringUTF(env, "");
+   }
+
+   FREESTRING(cLocale, locale);
+   return result;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ *  RenameJNI --
+ *
+ *      JNI implementation for VixDiskLib_Rename. See VixDiskLib docs
+ *      for details.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_RenameJNI(JNIEnv *env,
+                                            jobject obj,
+                                            jstring src,
+                                            jstring dst)
+{
+   const char *cSrc;
+   const char *cDst;
+   VixError result;
+
+   cSrc = GETSTRING(src);
+   cDst = GETSTRING(dst);
+
+   result = VixDiskLib_Rename(cSrc, cDst);
+
+   FREESTRING(cSrc, src);
+   FREESTRING(cDst, dst);
+   return result;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ *  SpaceNeededForCloneJNI --
+ *
+ *      JNI implementation for VixDiskLib_SpaceNeedeForClone. See
+ *      VixDiskLib docs for details.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_SpaceNeededForCloneJNI(JNIEnv *env,
+                                                         jobject obj,
+                                                         jlong diskHandle,
+                                                         jint diskType,
+                                                         jlongArray needed)
+{
+    VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
+    uint64 spaceNeeded;
+    jlong jout = 0;
+    VixError result;
+
+    JDISKD_UNSUPPORTED(diskHandle);
+    if (needed == NULL) {
+       result = VixDiskLib_SpaceNeededForClone(cDiskHandle, diskType, NULL);
+    } else {
+       result = VixDiskLib_SpaceNeededForClone(cDiskHandle, diskType, &spaceNeeded);
+       if (result == VIX_OK) {
+          jout = (jlong)spaceNeeded;
+       }
+
+      (*env)->SetLongArrayRegion(env, needed, 0, 1, &jout);
+    }
+    return result;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ *  CheckRepairJNI --
+ *
+ *      JNI implementation for VixDiskLib_CheckRepair. See
+ *      VixDiskLib docs for details.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_CheckRepairJNI(JNIEnv *env,
+                                                 jobject obj,
+                                                 jlong connHandle,
+                                                 jstring path,
+                                                 jboolean repair)
+{
+   VixDiskLibConnection conn = (VixDiskLibConnection)(size_t)connHandle;
+   const char *cPath;
+   VixError result;
+
+   JDISKD_UNSUPPORTED(connHandle);
+   cPath = GETSTRING(path);
+   result = VixDiskLib_CheckRepair(conn, cPath, repair);
+   FREESTRING(cPath, path);
+   return result;
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * Perturb_Enable --
+ *
+ *     JNI implementation for Fault Injection control of
+ *     PerturbEnable.  The arguments are:
+ *
+ *     fName - Pointer to the name of the function to be replaced.
+ *     enable - zero = disable, 1 = enable.
+ *
+ *     VIX_E_NOT_SUPPORTED if the VixDiskLib loaded does not export
+ *     Perturb_Enable.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_PerturbEnableJNI(JNIEnv *env,
+                                                    jobject obj,
+                                                    jstring fName,
+                                                    jint enable)
+{
+   int enableIt = (int) enable;
+   const char *funcName = GETSTRING(fName);
+   VixError result;
+
+   result = JVddk_PerturbEnable(funcName, enableIt);
+   FREESTRING(funcName, fName);
+   return result;
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * VixDiskLib_SetInjectedFault --
+ *
+ *     JNI implementation for control of injected faults.  The args are:
+ *
+ *     faultID    - One of the members of enum diskLibFaultInjection.
+ *     enabled    - Zero is disable, one is enable.
+ *     faultError - The error value to be returned from the fault point.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_SetInjectedFaultJNI(JNIEnv *env,
+                                                       jobject obj,
+                                                       jint faultID,
+                                                       jint enabled,
+                                                       jint faultError)
+{
+   int faultIDLocal = (int) faultID;
+   int enabledLocal = (int) enabled;
+   int faultErrorLocal = (int) faultError;
+
+   return VixDiskLib_SetInjectedFault(faultIDLocal, enabledLocal,
+                                      faultErrorLocal);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * AllocateBufferJNI --
+ *
+ *      JNI implementation for allcating memeory with aligned address
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jobject JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_AllocateBufferJNI(JNIEnv *env,
+                                                    jobject obj,
+                                                    jint size,
+                                                    jint alignment)
+{
+   jbyte *buf = NULL;
+   jobject ret = NULL;
+   int err;
+
+#ifdef _WIN32
+   buf = _aligned_malloc(size, alignment);
+   _get_errno(&err);
+#else
+   err = posix_memalign((void**) &buf, alignment, size);
+#endif
+
+   if (buf != NULL) {
+      ret = (*env)->NewDirectByteBuffer(env, (void*) buf, (jlong)size);
+   } else {
+      JUtils_Log("AllocateBufferJNI: error no %d!\n", err);
+   }
+   return ret;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * FreeBufferJNI --
+ *
+ *      JNI implementation for freeing memory allocated before.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT void JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_FreeBufferJNI(JNIEnv *env,
+                                                jobject obj,
+                                                jobject jbuf)
+{
+   jbyte *data = NULL;
+   if (jbuf) {
+      data = (*env)->GetDirectBufferAddress(env, jbuf);
+#ifdef _WIN32
+      _aligned_free(data);
+#else
+      free(data);
+#endif
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * GetConnectParamsJNI --
+ *
+ *      JNI implementation for VixDiskLib_GetConnectParams.
+ *      See VixDiskLib docs for details.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_GetConnectParamsJNI(JNIEnv *env,
+                                                      jobject obj,
+                                                      jlong connHandle,
+                                                      jobject cp)
+{
+   VixDiskLibConnectParams *params = NULL;
+   VixDiskLibConnection conn = (VixDiskLibConnection)(size_t)connHandle;
+   VixError result;
+
+   if (cp == NULL) {
+      result = VixDiskLib_GetConnectParams(conn, NULL);
+   } else {
+      result = VixDiskLib_GetConnectParams(conn, &params);
+   }
+
+   if (params != NULL) {
+      JNISetConnectParams(params, env, cp);
+      VixDiskLib_FreeConnectParams(params);
+   }
+   return result;
+}
+
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * EstimateEntropyJNI --
+ *
+ *      Estimate the entropy of "length" bytes of buf starting at "offset"
+ *      from a sample of at most "sampleSize" bytes (0 for the default).
+ *      The array is pinned, not copied.
+ *
+ * Results:
+ *      Entropy in thousandths of a bit per byte, -1 on invalid arguments.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jint JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_EstimateEntropyJNI(JNIEnv *env,
+                                                     jobject obj,
+                                                     jbyteArray buf,
+                                                     jint offset,
+                                                     jint length,
+                                                     jint sampleSize)
+{
+   uint8 *data;
+   int result;
+
+   if (buf == NULL || offset < 0 || length < 0 || sampleSize < 0 ||
+       (jlong)offset + length > (*env)->GetArrayLength(env, buf)) {
+      return -1;
+   }
+   data = (*env)->GetPrimitiveArrayCritical(env, buf, NULL);
+   if (data == NULL) {
+      return -1;
+   }
+   result = JEntropy_Estimate(data + offset, (size_t)length,
+                              (size_t)sampleSize);
+   (*env)->ReleasePrimitiveArrayCritical(env, buf, data, JNI_ABORT);
+   return result;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * MiGzDecodeJNI --
+ *
+ *      Decode the first "srcLength" bytes of src, a MiGz stream, into dst
+ *      with up to "threads" threads. The stream is decoded into the aligned
+ *      staging buffer of the calling thread and copied once into dst.
+ *
+ * Results:
+ *      Decoded size, -1 on invalid arguments or corrupt stream.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jint JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_MiGzDecodeJNI(JNIEnv *env,
+                                                jobject obj,
+                                                jbyteArray src,
+                                                jint srcLength,
+                                                jbyteArray dst,
+                                                jint threads)
+{
+   uint8 *input;
+   uint8 *output;
+   jsize dstLength;
+   int64 result;
+
+   if (src == NULL || dst == NULL || srcLength < 0 ||
+       srcLength > (*env)->GetArrayLength(env, src)) {
+      return -1;
+   }
+   dstLength = (*env)->GetArrayLength(env, dst);
+   input = JUtils_GetStagingSlot(JUtilsStagingSlotInput, (size_t)srcLength);
+   output = JUtils_GetStagingSlot(JUtilsStagingSlotIo, (size_t)dstLength);
+   if (input == NULL || output == NULL) {
+      return -1;
+   }
+   (*env)->GetByteArrayRegion(env, src, 0, srcLength, (jbyte *)input);
+   result = JMiGz_Decode(input, (size_t)srcLength, output, (size_t)dstLength,
+                         threads);
+   if (result > 0) {
+      (*env)->SetByteArrayRegion(env, dst, 0, (jsize)result, (jbyte *)output);
+   }
+   return (jint)result;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * Crc32cMapJNI --
+ *
+ *      Fill map with the CRC32C of each JCRC32C_CHUNK_SIZE chunk of
+ *      "length" bytes of buf starting at "offset". Both arrays are pinned,
+ *      not copied.
+ *
+ * Results:
+ *      Number of entries, -1 on invalid arguments.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jint JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_Crc32cMapJNI(JNIEnv *env,
+                                               jobject obj,
+                                               jbyteArray buf,
+                                               jint offset,
+                                               jint length,
+                                               jintArray map)
+{
+   jint entries;
+   uint8 *data;
+   uint32 *cMap;
+
+   if (buf == NULL || map == NULL || offset < 0 || length < 0 ||
+       (jlong)offset + length > (*env)->GetArrayLength(env, buf)) {
+      return -1;
+   }
+   entries = (jint)JCrc32c_MapSize((size_t)length);
+   if ((*env)->GetArrayLength(env, map) < entries) {
+      return -1;
+   }
+   data = (*env)->GetPrimitiveArrayCritical(env, buf, NULL);
+   if (data == NULL) {
+      return -1;
+   }
+   cMap = (*env)->GetPrimitiveArrayCritical(env, map, NULL);
+   if (cMap == NULL) {
+      (*env)->ReleasePrimitiveArrayCritical(env, buf, data, JNI_ABORT);
+      return -1;
+   }
+   JCrc32c_Map(data + offset, (size_t)length, cMap);
+   (*env)->ReleasePrimitiveArrayCritical(env, map, cMap, 0);
+   (*env)->ReleasePrimitiveArrayCritical(env, buf, data, JNI_ABORT);
+   return entries;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * MultiBufferHashJNI --
+ *
+ *      Compute the SHA-1 or MD5 of "length" bytes of buf starting at
+ *      "offset" with the multi-buffer engine. The call may wait for the
+ *      blocks of other threads, so the data is copied to the staging buffer
+ *      of the calling thread rather than pinned.
+ *
+ * Results:
+ *      VIX_OK, VIX_E_NOT_SUPPORTED without AVX2, VIX_E_INVALID_ARG.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_MultiBufferHashJNI(JNIEnv *env,
+                                                     jobject obj,
+                                                     jint algorithm,
+                                                     jbyteArray buf,
+                                                     jint offset,
+                                                     jint length,
+                                                     jbyteArray digest)
+{
+   uint8 result[JMBHASH_SHA1_SIZE];
+   jsize digestSize;
+   uint8 *input;
+
+   if (algorithm < 0 || algorithm >= JMbHashCount) {
+      return VIX_E_INVALID_ARG;
+   }
+   digestSize = algorithm == JMbHashSha1 ? JMBHASH_SHA1_SIZE
+                                         : JMBHASH_MD5_SIZE;
+   if (buf == NULL || digest == NULL || offset < 0 || length < 0 ||
+       (jlong)offset + length > (*env)->GetArrayLength(env, buf) ||
+       (*env)->GetArrayLength(env, digest) < digestSize) {
+      return VIX_E_INVALID_ARG;
+   }
+   if (!JMbHash_IsSupported()) {
+      return VIX_E_NOT_SUPPORTED;
+   }
+   input = JUtils_GetStagingSlot(JUtilsStagingSlotInput, (size_t)length);
+   if (input == NULL) {
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   (*env)->GetByteArrayRegion(env, buf, offset, length, (jbyte *)input);
+   if (!JMbHash_Digest((JMbHashAlgorithm)algorithm, input, (size_t)length,
+                       result)) {
+      return VIX_E_NOT_SUPPORTED;
+   }
+   (*env)->SetByteArrayRegion(env, digest, 0, digestSize, (jbyte *)result);
+   return VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * ScrubJNI --
+ *
+ *      Verify the data files of a set of blocks with "threads" threads.
+ *      Block i is described by paths[i], by blocks[3i..3i+2] (JSCRUB_*
+ *      flags, cipher offset, plain size) and by digests[36i..36i+35] (MD5
+ *      of the stored data then SHA-1 of the plain block). key is the raw
+ *      AES key, or null.
+ *
+ * Results:
+ *      VIX_OK with status[i] a JScrubStatus and stats {blocks, bad blocks,
+ *      bytes read, bytes verified, elapsed us}, VIX_E_NOT_SUPPORTED if the
+ *      CPU is not supported, VIX_E_INVALID_ARG, VIX_E_OUT_OF_MEMORY.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_ScrubJNI(JNIEnv *env,
+                                           jobject obj,
+                                           jobjectArray paths,
+                                           jintArray blocks,
+                                           jbyteArray digests,
+                                           jbyteArray key,
+                                           jint threads,
+                                           jboolean shallow,
+                                           jintArray status,
+                                           jlongArray stats)
+{
+   const jsize digestsSize = JMBHASH_MD5_SIZE + JMBHASH_SHA1_SIZE;
+   uint8 cKey[JAES_KEY_SIZE];
+   JScrubBlock *cBlocks;
+   JScrubStats cStats;
+   jlong jStats[5];
+   jint *params;
+   jbyte *cDigests;
+   jsize count;
+   jsize i;
+   VixError result = VIX_OK;
+
+   if (paths == NULL || blocks == NULL || digests == NULL || status == NULL ||
+       stats == NULL) {
+      return VIX_E_INVALID_ARG;
+   }
+   count = (*env)->GetArrayLength(env, paths);
+   if ((*env)->GetArrayLength(env, blocks) < 3 * count ||
+       (*env)->GetArrayLength(env, digests) < digestsSize * count ||
+       (*env)->GetArrayLength(env, status) < count ||
+       (*env)->GetArrayLength(env, stats) < 5 ||
+       (key != NULL && (*env)->GetArrayLength(env, key) != JAES_KEY_SIZE)) {
+      return VIX_E_INVALID_ARG;
+   }
+   cBlocks = calloc(count > 0 ? count : 1, sizeof *cBlocks);
+   if (cBlocks == NULL) {
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   params = (*env)->GetIntArrayElements(env, blocks, NULL);
+   cDigests = (*env)->GetByteArrayElements(env, digests, NULL);
+   for (i = 0; i < count && params != NULL && cDigests != NULL; i++) {
+      jstring path = (*env)->GetObjectArrayElement(env, paths, i);
+      const char *cPath = GETSTRING(path);
+
+      cBlocks[i].path = strdup(cPath != NULL ? cPath : "");
+      FREESTRING(cPath, path);
+      (*env)->DeleteLocalRef(env, path);
+      if (cBlocks[i].path == NULL) {
+         result = VIX_E_OUT_OF_MEMORY;
+         break;
+      }
+      cBlocks[i].flags = params[3 * i];
+      cBlocks[i].cipherOffset = params[3 * i + 1];
+      cBlocks[i].size = (size_t)params[3 * i + 2];
+      memcpy(cBlocks[i].md5, cDigests + digestsSize * i, JMBHASH_MD5_SIZE);
+      memcpy(cBlocks[i].sha1, cDigests + digestsSize * i + JMBHASH_MD5_SIZE,
+             JMBHASH_SHA1_SIZE);
+   }
+   if (params == NULL || cDigests == NULL) {
+      result = VIX_E_OUT_OF_MEMORY;
+   }
+   if (params != NULL) {
+      (*env)->ReleaseIntArrayElements(env, blocks, params, JNI_ABORT);
+   }
+   if (cDigests != NULL) {
+      (*env)->ReleaseByteArrayElements(env, digests, cDigests, JNI_ABORT);
+   }
+   if (key != NULL) {
+      (*env)->GetByteArrayRegion(env, key, 0, JAES_KEY_SIZE, (jbyte *)cKey);
+   }
+
+   if (result == VIX_OK) {
+      if (!JScrub_Run(cBlocks, (int)count, key != NULL ? cKey : NULL, threads,
+                      shallow ? TRUE : FALSE, &cStats)) {
+         result = VIX_E_NOT_SUPPORTED;
+      } else {
+         for (i = 0; i < count; i++) {
+            jint s = cBlocks[i].status;
+
+            (*env)->SetIntArrayRegion(env, status, i, 1, &s);
+         }
+         jStats[0] = cStats.blocks;
+         jStats[1] = cStats.badBlocks;
+         jStats[2] = cStats.bytesRead;
+         jStats[3] = cStats.bytesVerified;
+         jStats[4] = cStats.elapsedUs;
+         (*env)->SetLongArrayRegion(env, stats, 0, 5, jStats);
+      }
+   }
+
+   memset(cKey, 0, sizeof cKey);
+   for (i = 0; i < count; i++) {
+      free((char *)cBlocks[i].path);
+   }
+   free(cBlocks);
+   return result;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * CopyJNI --
+ *
+ *      Copy the sectors [startSector, endSector) of an open disk to another
+ *      open disk, keeping up to "depth" reads and writes of "chunkSectors"
+ *      sectors in flight. endSector 0 means the capacity of the source.
+ *      If allocatedOnly, only the allocated extents of the source are
+ *      copied. progress may be null.
+ *
+ * Results:
+ *      VIX_OK, VIX_E_CANCELLED or the first error of the copy, with stats
+ *      {bytes, extents, resume sector, elapsed us}.
+ *
+ * Side effects:
+ *      Writes to the destination disk.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_CopyJNI(JNIEnv *env,
+                                          jobject obj,
+                                          jlong srcHandle,
+                                          jlong dstHandle,
+                                          jlong startSector,
+                                          jlong endSector,
+                                          jint chunkSectors,
+                                          jint depth,
+                                          jboolean allocatedOnly,
+                                          jobject progress,
+                                          jlongArray stats)
+{
+   VixDiskLibHandle cSrcHandle = (VixDiskLibHandle)(size_t)srcHandle;
+   VixDiskLibHandle cDstHandle = (VixDiskLibHandle)(size_t)dstHandle;
+   int64 cStats[JCopyStatCount];
+   jlong jStats[JCopyStatCount];
+   JProgressCall call;
+   VixError result;
+   int i;
+
+   if (stats == NULL || startSector < 0 || endSector < 0 ||
+       chunkSectors < 0 || depth < 0 ||
+       (*env)->GetArrayLength(env, stats) < JCopyStatCount) {
+      return VIX_E_INVALID_ARG;
+   }
+   JDISKD_UNSUPPORTED(srcHandle);
+   JDISKD_UNSUPPORTED(dstHandle);
+   JProgress_Begin(&call, gLogger, env, progress);
+   result = JCopy_Run(cSrcHandle, cDstHandle, startSector, endSector,
+                      chunkSectors, depth, allocatedOnly ? TRUE : FALSE,
+                      progress != NULL ? &JProgress_Func : NULL,
+                      &call, cStats);
+   JProgress_End(&call);
+   for (i = 0; i < JCopyStatCount; i++) {
+      jStats[i] = cStats[i];
+   }
+   (*env)->SetLongArrayRegion(env, stats, 0, JCopyStatCount, jStats);
+   return result;
+}
+
+
+/*
+ * A guest filesystem open by GuestFsOpenJNI, with the archived disk under
+ * it.
+ */
+typedef struct JNIGuestFs {
+   JArchiveDisk *disk;
+   JGuestFs *fs;
+} JNIGuestFs;
+
+/*
+ * State of GuestFsListJNI, passed to JNIGuestFsListEntry.
+ */
+typedef struct JNIGuestFsList {
+   JNIEnv *env;
+   jobject list;
+   jclass entryClass;
+   jmethodID entryInit;
+   jmethodID listAdd;
+} JNIGuestFsList;
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNIArchiveDiskRead --
+ *
+ *      JGuestFsReadFunc over a JArchiveDisk.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JNIArchiveDiskRead(void *disk,     // IN
+                   int64 offset,   // IN
+                   size_t length,  // IN
+                   uint8 *buf)     // OUT
+{
+   return JArchiveDisk_Read(disk, offset, length, buf);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNISetGuestFsEntry --
+ *
+ *      Copy a guest filesystem entry into a jDiskLib.GuestFsEntry.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JNISetGuestFsEntry(JNIEnv *env,                  // IN
+                   jobject obj,                  // IN/OUT
+                   const JGuestFsEntry *entry)   // IN
+{
+   JUtils_SetStringField(env, obj, "name", entry->name);
+   JUtils_SetLongField(env, obj, "inode", entry->inode);
+   JUtils_SetIntField(env, obj, "type", entry->type);
+   JUtils_SetIntField(env, obj, "mode", entry->mode);
+   JUtils_SetIntField(env, obj, "uid", entry->uid);
+   JUtils_SetIntField(env, obj, "gid", entry->gid);
+   JUtils_SetLongField(env, obj, "size", entry->size);
+   JUtils_SetLongField(env, obj, "mtime", entry->mtime);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNIGuestFsListEntry --
+ *
+ *      JGuestFsListFunc of GuestFsListJNI: add a jDiskLib.GuestFsEntry to
+ *      the Java list.
+ *
+ * Results:
+ *      FALSE if the entry cannot be allocated, to stop the listing.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JNIGuestFsListEntry(void *data,                  // IN
+                    const JGuestFsEntry *entry)  // IN
+{
+   JNIGuestFsList *state = data;
+   JNIEnv *env = state->env;
+   jobject obj = (*env)->NewObject(env, state->entryClass, state->entryInit);
+
+   if (obj == NULL) {
+      return FALSE;
+   }
+   JNISetGuestFsEntry(env, obj, entry);
+   (*env)->CallBooleanMethod(env, state->list, state->listAdd, obj);
+   (*env)->DeleteLocalRef(env, obj);
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNIArchiveDiskOpen --
+ *
+ *      Open a JArchiveDisk over the archived blocks of a disk generation.
+ *      For each extent, extents holds {offset, length, fileOffset,
+ *      storedLength, plainSize, streamOffset} in bytes and params holds
+ *      {flags, cipherOffset}; paths[i] is the data file or packfile of the
+ *      extent. key is the raw AES key, null if no block is encrypted.
+ *
+ * Results:
+ *      VIX_OK with the disk in "disk", VIX_E_INVALID_ARG or
+ *      VIX_E_OUT_OF_MEMORY.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static VixError
+JNIArchiveDiskOpen(JNIEnv *env,              // IN
+                   jobjectArray paths,       // IN
+                   jlongArray extents,       // IN
+                   jintArray params,         // IN
+                   jbyteArray key,           // IN: optional
+                   jlong capacity,           // IN
+                   jlong cacheSize,          // IN
+                   JArchiveDisk **disk)      // OUT
+{
+   uint8 cKey[JAES_KEY_SIZE];
+   JArchiveExtent *cExtents;
+   jlong *offsets;
+   jint *flags;
+   jsize count;
+   jsize i;
+   VixError result = VIX_OK;
+
+   *disk = NULL;
+   if (paths == NULL || extents == NULL || params == NULL ||
+       capacity < 0 || cacheSize < 0) {
+      return VIX_E_INVALID_ARG;
+   }
+   count = (*env)->GetArrayLength(env, paths);
+   if ((*env)->GetArrayLength(env, extents) < 6 * count ||
+       (*env)->GetArrayLength(env, params) < 2 * count ||
+       (key != NULL && (*env)->GetArrayLength(env, key) != JAES_KEY_SIZE)) {
+      return VIX_E_INVALID_ARG;
+   }
+   cExtents = calloc(count > 0 ? count : 1, sizeof *cExtents);
+   if (cExtents == NULL) {
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   offsets = (*env)->GetLongArrayElements(env, extents, NULL);
+   flags = (*env)->GetIntArrayElements(env, params, NULL);
+   for (i = 0; i < count && offsets != NULL && flags != NULL; i++) {
+      jstring path = (*env)->GetObjectArrayElement(env, paths, i);
+      const char *cPath = GETSTRING(path);
+
+      cExtents[i].path = strdup(cPath != NULL ? cPath : "");
+      FREESTRING(cPath, path);
+      (*env)->DeleteLocalRef(env, path);
+      if (cExtents[i].path == NULL) {
+         result = VIX_E_OUT_OF_MEMORY;
+         break;
+      }
+      cExtents[i].offset = offsets[6 * i];
+      cExtents[i].length = offsets[6 * i + 1];
+      cExtents[i].fileOffset = offsets[6 * i + 2];
+      cExtents[i].storedLength = offsets[6 * i + 3];
+      cExtents[i].plainSize = offsets[6 * i + 4];
+      cExtents[i].streamOffset = offsets[6 * i + 5];
+      cExtents[i].flags = flags[2 * i];
+      cExtents[i].cipherOffset = flags[2 * i + 1];
+   }
+   if (offsets == NULL || flags == NULL) {
+      result = VIX_E_OUT_OF_MEMORY;
+   }
+   if (offsets != NULL) {
+      (*env)->ReleaseLongArrayElements(env, extents, offsets, JNI_ABORT);
+   }
+   if (flags != NULL) {
+      (*env)->ReleaseIntArrayElements(env, params, flags, JNI_ABORT);
+   }
+   if (key != NULL) {
+      (*env)->GetByteArrayRegion(env, key, 0, JAES_KEY_SIZE, (jbyte *)cKey);
+   }
+
+   if (result == VIX_OK) {
+      *disk = JArchiveDisk_Open(cExtents, (int)count,
+                                key != NULL ? cKey : NULL,
+                                capacity, (size_t)cacheSize);
+      if (*disk == NULL) {
+         result = VIX_E_OUT_OF_MEMORY;
+      }
+   }
+
+   memset(cKey, 0, sizeof cKey);
+   for (i = 0; i < count; i++) {
+      free((char *)cExtents[i].path);
+   }
+   free(cExtents);
+   return result;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * GuestFsOpenJNI --
+ *
+ *      Open the guest filesystem of a disk generation straight from its
+ *      archived blocks, described as for JNIArchiveDiskOpen. partition -1
+ *      selects the first supported filesystem.
+ *
+ * Results:
+ *      VIX_OK with the filesystem handle in handle[0], or the error of
+ *      JGuestFs_Open.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_GuestFsOpenJNI(JNIEnv *env,
+                                                 jobject obj,
+                                                 jobjectArray paths,
+                                                 jlongArray extents,
+                                                 jintArray params,
+                                                 jbyteArray key,
+                                                 jlong capacity,
+                                                 jint partition,
+                                                 jlong cacheSize,
+                                                 jlongArray handle)
+{
+   JNIGuestFs *guestFs;
+   jlong jout = 0;
+   VixError result;
+
+   if (handle == NULL || (*env)->GetArrayLength(env, handle) < 1) {
+      return VIX_E_INVALID_ARG;
+   }
+   guestFs = calloc(1, sizeof *guestFs);
+   if (guestFs == NULL) {
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   result = JNIArchiveDiskOpen(env, paths, extents, params, key, capacity,
+                               cacheSize, &guestFs->disk);
+   if (result == VIX_OK) {
+      result = JGuestFs_Open(&JNIArchiveDiskRead, guestFs->disk,
+                             partition, &guestFs->fs);
+   }
+   if (result != VIX_OK) {
+      JArchiveDisk_Close(guestFs->disk);
+      free(guestFs);
+   } else {
+      jout = (jlong)(size_t)guestFs;
+   }
+   (*env)->SetLongArrayRegion(env, handle, 0, 1, &jout);
+   return result;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * GuestFsLookupJNI --
+ *
+ *      Resolve an absolute path of a guest filesystem into a
+ *      jDiskLib.GuestFsEntry, without following symbolic links.
+ *
+ * Results:
+ *      VIX_OK, VIX_E_FILE_NOT_FOUND, VIX_E_NOT_A_DIRECTORY or
+ *      VIX_E_DISK_INVAL.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_GuestFsLookupJNI(JNIEnv *env,
+                                                   jobject obj,
+                                                   jlong handle,
+                                                   jstring path,
+                                                   jobject entry)
+{
+   JNIGuestFs *guestFs = (JNIGuestFs *)(size_t)handle;
+   JGuestFsEntry cEntry;
+   const char *cPath;
+   VixError result;
+
+   if (guestFs == NULL || path == NULL || entry == NULL) {
+      return VIX_E_INVALID_ARG;
+   }
+   cPath = GETSTRING(path);
+   if (cPath == NULL) {
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   result = JGuestFs_Lookup(guestFs->fs, cPath, &cEntry);
+   FREESTRING(cPath, path);
+   if (result == VIX_OK) {
+      JNISetGuestFsEntry(env, entry, &cEntry);
+   }
+   return result;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * GuestFsListJNI --
+ *
+ *      List a directory of a guest filesystem into a
+ *      List<jDiskLib.GuestFsEntry>, "." and ".." excluded.
+ *
+ * Results:
+ *      VIX_OK, VIX_E_NOT_A_DIRECTORY or VIX_E_DISK_INVAL.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_GuestFsListJNI(JNIEnv *env,
+                                                 jobject obj,
+                                                 jlong handle,
+                                                 jlong inode,
+                                                 jobject entries)
+{
+   JNIGuestFs *guestFs = (JNIGuestFs *)(size_t)handle;
+   JNIGuestFsList state;
+   jclass listClass;
+
+   if (guestFs == NULL || entries == NULL || inode <= 0 ||
+       inode > 0xffffffffLL) {
+      return VIX_E_INVALID_ARG;
+   }
+   state.env = env;
+   state.list = entries;
+   state.entryClass =
+      (*env)->FindClass(env, "com/vmware/jvix/jDiskLib$GuestFsEntry");
+   state.entryInit = (*env)->GetMethodID(env, state.entryClass, "<init>",
+                                         "()V");
+   listClass = (*env)->FindClass(env, "java/util/List");
+   state.listAdd = (*env)->GetMethodID(env, listClass, "add",
+                                       "(Ljava/lang/Object;)Z");
+   return JGuestFs_List(guestFs->fs, (uint32)inode, &JNIGuestFsListEntry,
+                        &state);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * GuestFsReadJNI --
+ *
+ *      Read up to "length" bytes of a file of a guest filesystem at
+ *      "offset" into buf; for a symbolic link the data is its target.
+ *
+ * Results:
+ *      The bytes read, 0 at the end of the file, -1 on error.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_GuestFsReadJNI(JNIEnv *env,
+                                                 jobject obj,
+                                                 jlong handle,
+                                                 jlong inode,
+                                                 jlong offset,
+                                                 jbyteArray buf,
+                                                 jint length)
+{
+   JNIGuestFs *guestFs = (JNIGuestFs *)(size_t)handle;
+   uint8 *cBuf;
+   int64 result;
+
+   if (guestFs == NULL || buf == NULL || inode <= 0 ||
+       inode > 0xffffffffLL || offset < 0 || length < 0 ||
+       (*env)->GetArrayLength(env, buf) < length) {
+      return -1;
+   }
+   cBuf = JUtils_GetStagingSlot(JUtilsStagingSlotIo, length);
+   if (cBuf == NULL) {
+      return -1;
+   }
+   result = JGuestFs_Read(guestFs->fs, (uint32)inode, offset, cBuf, length);
+   if (result > 0) {
+      (*env)->SetByteArrayRegion(env, buf, 0, (jsize)result, (jbyte *)cBuf);
+   }
+   return result;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * GuestFsCloseJNI --
+ *
+ *      Close a guest filesystem and its archived disk.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Releases the block cache.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT void JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_GuestFsCloseJNI(JNIEnv *env,
+                                                  jobject obj,
+                                                  jlong handle)
+{
+   JNIGuestFs *guestFs = (JNIGuestFs *)(size_t)handle;
+
+   if (guestFs != NULL) {
+      JGuestFs_Close(guestFs->fs);
+      JArchiveDisk_Close(guestFs->disk);
+      free(guestFs);
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * CatalogBuildJNI --
+ *
+ *      Build the catalog of the files of the ext2/3/4 filesystem of an open
+ *      disk, reading only its metadata. partition -1 selects the first
+ *      supported filesystem; cacheSize 0 means the default cache.
+ *
+ * Results:
+ *      VIX_OK with the catalog in catalog[0] and stats {records, bytes
+ *      read, elapsed us}, VIX_E_NOT_SUPPORTED if there is no supported
+ *      filesystem, or the error reading the disk.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_CatalogBuildJNI(JNIEnv *env,
+                                                  jobject obj,
+                                                  jlong diskHandle,
+                                                  jint partition,
+                                                  jlong cacheSize,
+                                                  jobjectArray catalog,
+                                                  jlongArray stats)
+{
+   VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
+   int64 cStats[JCatalogStatCount];
+   jlong jStats[JCatalogStatCount];
+   uint8 *cCatalog;
+   size_t size;
+   VixError result;
+   int i;
+
+   if (catalog == NULL || stats == NULL || cacheSize < 0 ||
+       (*env)->GetArrayLength(env, catalog) < 1 ||
+       (*env)->GetArrayLength(env, stats) < JCatalogStatCount) {
+      return VIX_E_INVALID_ARG;
+   }
+   result = JCatalog_BuildFromDisk(cDiskHandle, partition, (size_t)cacheSize,
+                                   &cCatalog, &size, cStats);
+   if (result == VIX_OK) {
+      jbyteArray array = (*env)->NewByteArray(env, (jsize)size);
+
+      if (array == NULL) {
+         result = VIX_E_OUT_OF_MEMORY;
+      } else {
+         (*env)->SetByteArrayRegion(env, array, 0, (jsize)size,
+                                    (jbyte *)cCatalog);
+         (*env)->SetObjectArrayElement(env, catalog, 0, array);
+         (*env)->DeleteLocalRef(env, array);
+      }
+      free(cCatalog);
+   }
+   for (i = 0; i < JCatalogStatCount; i++) {
+      jStats[i] = cStats[i];
+   }
+   (*env)->SetLongArrayRegion(env, stats, 0, JCatalogStatCount, jStats);
+   return result;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * NbdStartJNI --
+ *
+ *      Serve a disk generation over NBD, straight from its archived blocks
+ *      described as for JNIArchiveDiskOpen. address is the path of a unix
+ *      socket, or null to listen on 127.0.0.1 at port (0 for any free
+ *      port). See JNbd_Start for readahead and overlayLimit.
+ *
+ * Results:
+ *      VIX_OK with the server handle in handle[0] and the TCP port in
+ *      handle[1], or the error of JNbd_Start.
+ *
+ * Side effects:
+ *      Starts the server threads.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_NbdStartJNI(JNIEnv *env,
+                                              jobject obj,
+                                              jobjectArray paths,
+                                              jlongArray extents,
+                                              jintArray params,
+                                              jbyteArray key,
+                                              jlong capacity,
+                                              jlong cacheSize,
+                                              jstring name,
+                                              jstring address,
+                                              jint port,
+                                              jlong readahead,
+                                              jlong overlayLimit,
+                                              jlongArray handle)
+{
+   JArchiveDisk *disk;
+   JNbdServer *server = NULL;
+   const char *cName;
+   const char *cAddress;
+   jlong jout[2] = { 0, 0 };
+   VixError result;
+
+   if (name == NULL || handle == NULL ||
+       (*env)->GetArrayLength(env, handle) < 2) {
+      return VIX_E_INVALID_ARG;
+   }
+   result = JNIArchiveDiskOpen(env, paths, extents, params, key, capacity,
+                               cacheSize, &disk);
+   if (result == VIX_OK) {
+      cName = GETSTRING(name);
+      cAddress = address != NULL ? GETSTRING(address) : NULL;
+      result = JNbd_Start(disk, cName, cAddress, port, readahead,
+                          overlayLimit, &server);
+      FREESTRING(cName, name);
+      if (address != NULL) {
+         FREESTRING(cAddress, address);
+      }
+   }
+   if (result == VIX_OK) {
+      jout[0] = (jlong)(size_t)server;
+      jout[1] = JNbd_GetPort(server);
+   }
+   (*env)->SetLongArrayRegion(env, handle, 0, 2, jout);
+   return result;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * NbdGetStatsJNI --
+ *
+ *      Get the statistics of an NBD server: {connections, reads, bytes
+ *      read, writes, bytes written, overlay bytes, prefetches}.
+ *
+ * Results:
+ *      VIX_OK or VIX_E_INVALID_ARG.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_NbdGetStatsJNI(JNIEnv *env,
+                                                 jobject obj,
+                                                 jlong handle,
+                                                 jlongArray stats)
+{
+   JNbdServer *server = (JNbdServer *)(size_t)handle;
+   int64 cStats[JNbdStatCount];
+   jlong jStats[JNbdStatCount];
+   int i;
+
+   if (server == NULL || stats == NULL ||
+       (*env)->GetArrayLength(env, stats) < JNbdStatCount) {
+      return VIX_E_INVALID_ARG;
+   }
+   JNbd_GetStats(server, cStats);
+   for (i = 0; i < JNbdStatCount; i++) {
+      jStats[i] = cStats[i];
+   }
+   (*env)->SetLongArrayRegion(env, stats, 0, JNbdStatCount, jStats);
+   return VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * NbdStopJNI --
+ *
+ *      Stop an NBD server and close its archived disk.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Disconnects the clients; the writes they made are discarded.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT void JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_NbdStopJNI(JNIEnv *env,
+                                             jobject obj,
+                                             jlong handle)
+{
+   JNbd_Stop((JNbdServer *)(size_t)handle);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * SetConnectionCacheJNI --
+ *
+ *      Configure the cache of connections and read-only disk handles: idle
+ *      time of a connection (0 disables the cache), maximum age of a
+ *      connection reused (0 for no limit) and number of idle disk handles.
+ *
+ * Results:
+ *      VIX_OK or VIX_E_INVALID_ARG.
+ *
+ * Side effects:
+ *      Disabling the cache closes what is idle.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_SetConnectionCacheJNI(JNIEnv *env,
+                                                        jobject obj,
+                                                        jint idleSeconds,
+                                                        jint maxAgeSeconds,
+                                                        jint maxIdleHandles)
+{
+   if (idleSeconds < 0 || maxAgeSeconds < 0 || maxIdleHandles < 0) {
+      return VIX_E_INVALID_ARG;
+   }
+   JConnCache_Configure(idleSeconds, maxAgeSeconds, maxIdleHandles);
+   return VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * GetConnectionCacheStatsJNI --
+ *
+ *      Get the statistics of the connection cache: {connects, connect hits,
+ *      opens, open hits, expired, invalidated, connections, idle handles}.
+ *
+ * Results:
+ *      VIX_OK or VIX_E_INVALID_ARG.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_GetConnectionCacheStatsJNI(JNIEnv *env,
+                                                             jobject obj,
+                                                             jlongArray stats)
+{
+   int64 cStats[JConnCacheStatCount];
+   jlong jStats[JConnCacheStatCount];
+   int i;
+
+   if (stats == NULL ||
+       (*env)->GetArrayLength(env, stats) < JConnCacheStatCount) {
+      return VIX_E_INVALID_ARG;
+   }
+   JConnCache_GetStats(cStats);
+   for (i = 0; i < JConnCacheStatCount; i++) {
+      jStats[i] = cStats[i];
+   }
+   (*env)->SetLongArrayRegion(env, stats, 0, JConnCacheStatCount, jStats);
+   return VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * AttachDaemonJNI --
+ *
+ *      Attach to the jdiskd daemon listening at socketPath, with a shared
+ *      region of "slots" slots of "slotSize" bytes (0 for the defaults).
+ *      The read-only connections made afterwards are served by the daemon.
+ *
+ * Results:
+ *      VIX_OK, VIX_E_INVALID_ARG, VIX_E_HOST_SERVER_NOT_FOUND if the daemon
+ *      does not run, VIX_E_NOT_SUPPORTED if its version differs.
+ *
+ * Side effects:
+ *      Starts the receiver thread of the client.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_AttachDaemonJNI(JNIEnv *env,
+                                                  jobject obj,
+                                                  jstring socketPath,
+                                                  jint slots,
+                                                  jint slotSize)
+{
+   const char *cSocketPath;
+   VixError result;
+
+   if (socketPath == NULL || slots < 0 || slotSize < 0) {
+      return VIX_E_INVALID_ARG;
+   }
+   cSocketPath = GETSTRING(socketPath);
+   result = JDiskd_Attach(cSocketPath, slots, slotSize);
+   FREESTRING(cSocketPath, socketPath);
+   return result;
 }
 
 
 /*
  *-----------------------------------------------------------------------------
  *
- *  GetErrorTextJNI --
+ * DetachDaemonJNI --
  *
- *      JNI implementation for VixDiskLib_GetErrorText. See VixDiskLib
- *      docs for details.
+ *      Detach from the jdiskd daemon.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      The disks and connections still open in the daemon are closed.
  *
  *-----------------------------------------------------------------------------
  */
 
-JNIEXPORT jstring JNICALL
-Java_com_vmware_jvix_jDiskLibImpl_GetErrorTextJNI(JNIEnv *env,
-                                                  jobject obj,
-                                                  jlong error,
-                                                  jstring locale)
+JNIEXPORT void JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_DetachDaemonJNI(JNIEnv *env,
+                                                  jobject obj)
 {
-   char *errTxt;
-   const char *cLocale;
-   jstring result;
-
-   cLocale =  GETSTRING(locale);
-
-   errTxt = VixDiskLib_GetErrorText(error, cLocale);
-   if (errTxt != NULL) {
-      result = (*env)->NewStringUTF(env, errTxt);
-      VixDiskLib_FreeErrorText(errTxt);
-   } else {
-      result = (*env)->NewStringUTF(env, "");
-   }
-
-   FREESTRING(cLocale, locale);
-   return result;
+   JDiskd_Detach();
 }
 
 
 /*
  *-----------------------------------------------------------------------------
  *
- *  RenameJNI --
+ * GetDaemonStatsJNI --
  *
- *      JNI implementation for VixDiskLib_Rename. See VixDiskLib docs
- *      for details.
+ *      Get the statistics of the jdiskd client and daemon: {requests, reads,
+ *      bytes read, slot waits, clients, connects, connect hits, open disks}.
+ *
+ * Results:
+ *      VIX_OK or VIX_E_INVALID_ARG.
+ *
+ * Side effects:
+ *      Asks the daemon for its statistics if attached.
  *
  *-----------------------------------------------------------------------------
  */
 
 JNIEXPORT jlong JNICALL
-Java_com_vmware_jvix_jDiskLibImpl_RenameJNI(JNIEnv *env,
-                                            jobject obj,
-                                            jstring src,
-                                            jstring dst)
+Java_com_vmware_jvix_jDiskLibImpl_GetDaemonStatsJNI(JNIEnv *env,
+                                                    jobject obj,
+                                                    jlongArray stats)
 {
-   const char *cSrc;
-   const char *cDst;
-   VixError result;
-
-   cSrc = GETSTRING(src);
-   cDst = GETSTRING(dst);
-
-   result = VixDiskLib_Rename(cSrc, cDst);
+   int64 cStats[JDiskdStatCount];
+   jlong jStats[JDiskdStatCount];
+   int i;
 
-   FREESTRING(cSrc, src);
-   FREESTRING(cDst, dst);
-   return result;
+   if (stats == NULL ||
+       (*env)->GetArrayLength(env, stats) < JDiskdStatCount) {
+      return VIX_E_INVALID_ARG;
+   }
+   JDiskd_GetStats(cStats);
+   for (i = 0; i < JDiskdStatCount; i++) {
+      jStats[i] = cStats[i];
+   }
+   (*env)->SetLongArrayRegion(env, stats, 0, JDiskdStatCount, jStats);
+   return VIX_OK;
 }
 
 
 /*
  *-----------------------------------------------------------------------------
  *
- *  SpaceNeededForCloneJNI --
+ * ReadAllMetadataJNI --
  *
- *      JNI implementation for VixDiskLib_SpaceNeedeForClone. See
- *      VixDiskLib docs for details.
+ *      Put every metadata key of a disk with its value in a
+ *      java.util.Map<String, String>, in one native pass.
+ *
+ * Results:
+ *      VixError of the metadata read.
+ *
+ * Side effects:
+ *      The metadata is cached until the handle is closed or its metadata
+ *      written.
  *
  *-----------------------------------------------------------------------------
  */
 
 JNIEXPORT jlong JNICALL
-Java_com_vmware_jvix_jDiskLibImpl_SpaceNeededForCloneJNI(JNIEnv *env,
-                                                         jobject obj,
-                                                         jlong diskHandle,
-                                                         jint diskType,
-                                                         jlongArray needed)
+Java_com_vmware_jvix_jDiskLibImpl_ReadAllMetadataJNI(JNIEnv *env,
+                                                     jobject obj,
+                                                     jlong diskHandle,
+                                                     jobject metadata)
 {
-    VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
-    uint64 spaceNeeded;
-    jlong jout = 0;
-    VixError result;
+   VixDiskLibHandle cDiskHandle = (VixDiskLibHandle)(size_t)diskHandle;
+   jclass mapClass;
+   jmethodID putMid;
+   char *packed;
+   size_t size, pos;
+   VixError result;
 
-    if (needed == NULL) {
-       result = VixDiskLib_SpaceNeededForClone(cDiskHandle, diskType, NULL);
-    } else {
-       result = VixDiskLib_SpaceNeededForClone(cDiskHandle, diskType, &spaceNeeded);
-       if (result == VIX_OK) {
-          jout = (jlong)spaceNeeded;
-       }
+   if (metadata == NULL) {
+      return VIX_E_INVALID_ARG;
+   }
+   mapClass = (*env)->FindClass(env, "java/util/Map");
+   putMid = (*env)->GetMethodID(env, mapClass, "put",
+               "(Ljava/lang/Object;Ljava/lang/Object;)Ljava/lang/Object;");
+   (*env)->DeleteLocalRef(env, mapClass);
+   if (putMid == NULL) {
+      return VIX_E_FAIL;
+   }
 
-      (*env)->SetLongArrayRegion(env, needed, 0, 1, &jout);
-    }
-    return result;
+   result = JMetadata_ReadAll(cDiskHandle, &packed, &size, NULL);
+   if (result != VIX_OK) {
+      return result;
+   }
+   for (pos = 0; pos < size; ) {
+      const char *key = packed + pos;
+      const char *val = key + strlen(key) + 1;
+      jstring jKey = (*env)->NewStringUTF(env, key);
+      jstring jVal = (*env)->NewStringUTF(env, val);
+      jobject previous;
+
+      pos = val + strlen(val) + 1 - packed;
+      if (jKey == NULL || jVal == NULL) {
+         result = VIX_E_OUT_OF_MEMORY;
+         break;
+      }
+      previous = (*env)->CallObjectMethod(env, metadata, putMid, jKey, jVal);
+      if (previous != NULL) {
+         (*env)->DeleteLocalRef(env, previous);
+      }
+      (*env)->DeleteLocalRef(env, jKey);
+      (*env)->DeleteLocalRef(env, jVal);
+   }
+   free(packed);
+   return result;
 }
 
 
 /*
  *-----------------------------------------------------------------------------
  *
- *  CheckRepairJNI --
+ * ProbeTransportJNI --
  *
- *      JNI implementation for VixDiskLib_CheckRepair. See
- *      VixDiskLib docs for details.
+ *      Time reads of a disk through each transport mode and order the
+ *      modes that work, fastest first.
+ *
+ * Results:
+ *      VixError of the probe. On VIX_OK, result[0] holds the modes string
+ *      to connect with and result[1] the rate or error of each mode.
+ *
+ * Side effects:
+ *      Connects and opens the disk once per mode, unless a probe of the
+ *      same key, datastore and modes is younger than cacheSeconds.
  *
  *-----------------------------------------------------------------------------
  */
 
 JNIEXPORT jlong JNICALL
-Java_com_vmware_jvix_jDiskLibImpl_CheckRepairJNI(JNIEnv *env,
-                                                 jobject obj,
-                                                 jlong connHandle,
-                                                 jstring path,
-                                                 jboolean repair)
+Java_com_vmware_jvix_jDiskLibImpl_ProbeTransportJNI(JNIEnv *env,
+                                                    jobject obj,
+                                                    jobject connection,
+                                                    jstring ssMoref,
+                                                    jstring modes,
+                                                    jstring diskPath,
+                                                    jstring cacheKey,
+                                                    jint probeSectors,
+                                                    jint cacheSeconds,
+                                                    jobjectArray result)
 {
-   VixDiskLibConnection conn = (VixDiskLibConnection)(size_t)connHandle;
-   const char *cPath;
-   VixError result;
+   VixDiskLibConnectParams *params;
+   const char *cssMoref, *cmodes, *cPath, *cKey;
+   char *ordered = NULL, *report = NULL;
+   Bool cached;
+   VixError err;
 
-   cPath = GETSTRING(path);
-   result = VixDiskLib_CheckRepair(conn, cPath, repair);
-   FREESTRING(cPath, path);
-   return result;
+   if (result == NULL || (*env)->GetArrayLength(env, result) < 2) {
+      return VIX_E_INVALID_ARG;
+   }
+   cssMoref = GETSTRING(ssMoref);
+   cmodes = GETSTRING(modes);
+   cPath = GETSTRING(diskPath);
+   cKey = GETSTRING(cacheKey);
+   params = JNIGetConnectParams(env, connection);
+
+   err = JTransportProbe_Run(params, cssMoref, cmodes, cPath, cKey,
+                             probeSectors > 0 ? probeSectors : 0,
+                             cacheSeconds > 0 ? cacheSeconds : 0,
+                             &ordered, &report, &cached);
+   if (err == VIX_OK) {
+      jstring jOrdered = (*env)->NewStringUTF(env, ordered);
+      jstring jReport;
+
+      if (cached) {
+         char *tagged = malloc(strlen(report) + sizeof " (cached)");
+
+         if (tagged != NULL) {
+            sprintf(tagged, "%s (cached)", report);
+            free(report);
+            report = tagged;
+         }
+      }
+      jReport = (*env)->NewStringUTF(env, report);
+      (*env)->SetObjectArrayElement(env, result, 0, jOrdered);
+      (*env)->SetObjectArrayElement(env, result, 1, jReport);
+   }
+
+   free(ordered);
+   free(report);
+   JNIFreeConnectParams(params);
+   FREESTRING(cssMoref, ssMoref);
+   FREESTRING(cmodes, modes);
+   FREESTRING(cPath, diskPath);
+   FREESTRING(cKey, cacheKey);
+   return err;
 }
 
+
 /*
  *-----------------------------------------------------------------------------
  *
- * Perturb_Enable --
+ * GetVddkCapabilitiesJNI --
  *
- *     JNI implementation for Fault Injection control of
- *     PerturbEnable.  The arguments are:
+ *      What the VixDiskLib loaded by InitJNI/InitExJNI provides natively,
+ *      as a mask of JVDDK_CAP_*. The functions it lacks are emulated.
  *
- *     fName - Pointer to the name of the function to be replaced.
- *     enable - zero = disable, 1 = enable.
+ * Results:
+ *      The mask, 0 before the library is loaded.
+ *
+ * Side effects:
+ *      None.
  *
  *-----------------------------------------------------------------------------
  */
 
-JNIEXPORT void JNICALL
-Java_com_vmware_jvix_jDiskLibImpl_PerturbEnableJNI(JNIEnv *env,
-                                                    jobject obj,
-                                                    jstring fName,
-                                                    jint enable)
+JNIEXPORT jint JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_GetVddkCapabilitiesJNI(JNIEnv *env,
+                                                         jobject obj)
 {
-   int enableIt = (int) enable;
-   const char *funcName = GETSTRING(fName);
-
-   Perturb_Enable(funcName, enableIt);
-   FREESTRING(funcName, fName);
+   return (jint)JVddk_Capabilities();
 }
 
+
 /*
  *-----------------------------------------------------------------------------
  *
- * VixDiskLib_SetInjectedFault --
+ * ProgressOpenJNI --
  *
- *     JNI implementation for control of injected faults.  The args are:
+ *      Create a progress channel forwarding at most one update every
+ *      intervalMs (0 for the default) to the Java Progress of the
+ *      operations given it, in its "channel" field.
  *
- *     faultID    - One of the members of enum diskLibFaultInjection.
- *     enabled    - Zero is disable, one is enable.
- *     faultError - The error value to be returned from the fault point.
+ * Results:
+ *      VIX_OK and the channel in handle[0], or VIX_E_INVALID_ARG,
+ *      VIX_E_OUT_OF_MEMORY.
+ *
+ * Side effects:
+ *      None.
  *
  *-----------------------------------------------------------------------------
  */
 
 JNIEXPORT jlong JNICALL
-Java_com_vmware_jvix_jDiskLibImpl_SetInjectedFaultJNI(JNIEnv *env,
-                                                       jobject obj,
-                                                       jint faultID,
-                                                       jint enabled,
-                                                       jint faultError)
+Java_com_vmware_jvix_jDiskLibImpl_ProgressOpenJNI(JNIEnv *env,
+                                                  jobject obj,
+                                                  jint intervalMs,
+                                                  jlongArray handle)
 {
-   int faultIDLocal = (int) faultID;
-   int enabledLocal = (int) enabled;
-   int faultErrorLocal = (int) faultError;
+   JProgress *channel;
+   jlong jout;
 
-   return VixDiskLib_SetInjectedFault(faultIDLocal, enabledLocal,
-                                      faultErrorLocal);
+   if (intervalMs < 0 || handle == NULL ||
+       (*env)->GetArrayLength(env, handle) < 1) {
+      return VIX_E_INVALID_ARG;
+   }
+   channel = JProgress_Open(intervalMs);
+   if (channel == NULL) {
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   jout = (jlong)(size_t)channel;
+   (*env)->SetLongArrayRegion(env, handle, 0, 1, &jout);
+   return VIX_OK;
 }
 
 
 /*
  *-----------------------------------------------------------------------------
  *
- * AllocateBufferJNI --
+ * ProgressGetStatsJNI --
  *
- *      JNI implementation for allcating memeory with aligned address
+ *      Get the state of a progress channel: {percent, ticks, upcalls,
+ *      cancelled, active operations}.
+ *
+ * Results:
+ *      VIX_OK or VIX_E_INVALID_ARG.
+ *
+ * Side effects:
+ *      None.
  *
  *-----------------------------------------------------------------------------
  */
 
-JNIEXPORT jobject JNICALL
-Java_com_vmware_jvix_jDiskLibImpl_AllocateBufferJNI(JNIEnv *env,
-                                                    jobject obj,
-                                                    jint size,
-                                                    jint alignment)
+JNIEXPORT jlong JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_ProgressGetStatsJNI(JNIEnv *env,
+                                                      jobject obj,
+                                                      jlong handle,
+                                                      jlongArray stats)
 {
-   jbyte *buf = NULL;
-   jobject ret = NULL;
-   int err;
-
-#ifdef _WIN32
-   buf = _aligned_malloc(size, alignment);
-   _get_errno(&err);
-#else
-   err = posix_memalign((void**) &buf, alignment, size);
-#endif
+   JProgress *channel = (JProgress *)(size_t)handle;
+   int64 cStats[JProgressStatCount];
+   jlong jStats[JProgressStatCount];
+   int i;
 
-   if (buf != NULL) {
-      ret = (*env)->NewDirectByteBuffer(env, (void*) buf, (jlong)size);
-   } else {
-      JUtils_Log("AllocateBufferJNI: error no %d!\n", err);
+   if (channel == NULL || stats == NULL ||
+       (*env)->GetArrayLength(env, stats) < JProgressStatCount) {
+      return VIX_E_INVALID_ARG;
    }
-   return ret;
+   JProgress_GetStats(channel, cStats);
+   for (i = 0; i < JProgressStatCount; i++) {
+      jStats[i] = cStats[i];
+   }
+   (*env)->SetLongArrayRegion(env, stats, 0, JProgressStatCount, jStats);
+   return VIX_OK;
 }
 
 
 /*
  *-----------------------------------------------------------------------------
  *
- * FreeBufferJNI --
+ * ProgressCancelJNI --
  *
- *      JNI implementation for freeing memory allocated before.
+ *      Cancel the operations of a progress channel.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      They abort at their next progress tick.
  *
  *-----------------------------------------------------------------------------
  */
 
 JNIEXPORT void JNICALL
-Java_com_vmware_jvix_jDiskLibImpl_FreeBufferJNI(JNIEnv *env,
-                                                jobject obj,
-                                                jobject jbuf)
+Java_com_vmware_jvix_jDiskLibImpl_ProgressCancelJNI(JNIEnv *env,
+                                                    jobject obj,
+                                                    jlong handle)
 {
-   jbyte *data = NULL;
-   if (jbuf) {
-      data = (*env)->GetDirectBufferAddress(env, jbuf);
-#ifdef _WIN32
-      _aligned_free(data);
-#else
-      free(data);
-#endif
-   }
+   JProgress_Cancel((JProgress *)(size_t)handle);
 }
 
 
 /*
  *-----------------------------------------------------------------------------
  *
- * GetConnectParamsJNI --
+ * ProgressCloseJNI --
  *
- *      JNI implementation for VixDiskLib_GetConnectParams.
- *      See VixDiskLib docs for details.
+ *      Free a progress channel once its operations returned.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None.
  *
  *-----------------------------------------------------------------------------
  */
 
-JNIEXPORT jlong JNICALL
-Java_com_vmware_jvix_jDiskLibImpl_GetConnectParamsJNI(JNIEnv *env,
-                                                      jobject obj,
-                                                      jlong connHandle,
-                                                      jobject cp)
+JNIEXPORT void JNICALL
+Java_com_vmware_jvix_jDiskLibImpl_ProgressCloseJNI(JNIEnv *env,
+                                                   jobject obj,
+                                                   jlong handle)
 {
-   VixDiskLibConnectParams *params = NULL;
-   VixDiskLibConnection conn = (VixDiskLibConnection)(size_t)connHandle;
-   VixError result;
-
-   if (cp == NULL) {
-      result = VixDiskLib_GetConnectParams(conn, NULL);
-   } else {
-      result = VixDiskLib_GetConnectParams(conn, &params);
-   }
-
-   if (params != NULL) {
-      JNISetConnectParams(params, env, cp);
-      VixDiskLib_FreeConnectParams(params);
-   }
-   return result;
+   JProgress_Close((JProgress *)(size_t)handle);
 }
-
@@ -0,0 +1,1645 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jDiskd.c
+ *
+ *    Protocol of the jdiskd worker and client side, linked in jDiskLib.
+ *
+ *    The client holds one socket to the daemon and one receiver thread.
+ *    Every command in flight is a JDiskdCall matched by id to its reply;
+ *    commands of several threads go out interleaved, so the reads of all
+ *    the disks of the process pipeline on the same socket. The shared
+ *    region is cut in slots: a read takes a slot, the daemon has VixDiskLib
+ *    read into it, and the receiver copies it to the buffer of the caller
+ *    before freeing the slot.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "jDiskd.h"
+
+typedef struct JDiskdObject {
+   uint64 remote;                   /* Handle in the daemon */
+   Bool disk;
+   int inflight;                    /* Reads not completed (disks) */
+   struct JDiskdObject *next;
+} JDiskdObject;
+
+/*
+ * A read of the caller, maybe split over several slots.
+ */
+typedef struct JDiskdRead {
+   JDiskdObject *disk;
+   int remaining;                   /* Slots not completed */
+   VixError result;
+   VixDiskLibCompletionCB callback; /* NULL for a synchronous read */
+   void *cbData;
+   Bool done;
+} JDiskdRead;
+
+typedef struct JDiskdCall {
+   uint32 id;
+   Bool done;
+   JDiskdReply reply;
+   char *payload;                   /* JDISKD_MAX_PAYLOAD bytes, optional */
+   JDiskdRead *read;                /* Set for a slot of a read */
+   uint32 slot;
+   uint8 *dest;
+   uint64 bytes;
+   struct JDiskdCall *next;
+} JDiskdCall;
+
+static struct {
+   pthread_mutex_t lock;
+   pthread_cond_t cond;             /* Calls done, slots and reads freed */
+   pthread_mutex_t sendLock;
+   Bool attached;
+   Bool broken;                     /* The daemon went away */
+   int sock;
+   pthread_t receiver;
+   uint8 *region;
+   uint32 slots;
+   uint32 slotSize;
+   uint32 freeSlots[JDISKD_MAX_SLOTS];
+   uint32 freeCount;
+   uint32 nextId;
+   JDiskdCall *calls;
+   JDiskdObject *objects;
+   int64 stats[JDiskdStatCount];
+} gClient = {
+   .lock = PTHREAD_MUTEX_INITIALIZER,
+   .cond = PTHREAD_COND_INITIALIZER,
+   .sendLock = PTHREAD_MUTEX_INITIALIZER,
+   .sock = -1,
+};
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskd_PutString --
+ *
+ *      Append a string to a payload.
+ *
+ * Results:
+ *      FALSE if it does not fit.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+Bool
+JDiskd_PutString(char *buf,           // OUT
+                 uint32 size,         // IN
+                 uint32 *pos,         // IN/OUT
+                 const char *s)       // IN: optional
+{
+   size_t length = s != NULL ? strlen(s) + 1 : 0;
+
+   if (*pos + 1 + length > size) {
+      return FALSE;
+   }
+   buf[(*pos)++] = s != NULL;
+   memcpy(buf + *pos, s, length);
+   *pos += length;
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskd_GetString --
+ *
+ *      Decode a string of a payload. The string points into the payload.
+ *
+ * Results:
+ *      FALSE if the payload is malformed.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+Bool
+JDiskd_GetString(const char *buf,     // IN
+                 uint32 size,         // IN
+                 uint32 *pos,         // IN/OUT
+                 const char **s)      // OUT
+{
+   const char *end;
+
+   if (*pos >= size) {
+      return FALSE;
+   }
+   if (buf[(*pos)++] == 0) {
+      *s = NULL;
+      return TRUE;
+   }
+   end = memchr(buf + *pos, '\0', size - *pos);
+   if (end == NULL) {
+      return FALSE;
+   }
+   *s = buf + *pos;
+   *pos = end - buf + 1;
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskd_Send --
+ *
+ *      Send one message. The caller serializes the senders of a socket.
+ *
+ * Results:
+ *      FALSE on error.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+Bool
+JDiskd_Send(int sock,                 // IN
+            const void *header,       // IN
+            size_t headerSize,        // IN
+            const void *payload,      // IN: optional
+            uint32 length,            // IN
+            int fd)                   // IN: -1 for none
+{
+   struct iovec iov[2];
+   struct msghdr msg;
+   char control[CMSG_SPACE(sizeof(int))];
+   ssize_t n;
+
+   memset(&msg, 0, sizeof msg);
+   iov[0].iov_base = (void *)header;
+   iov[0].iov_len = headerSize;
+   iov[1].iov_base = (void *)payload;
+   iov[1].iov_len = length;
+   msg.msg_iov = iov;
+   msg.msg_iovlen = length > 0 ? 2 : 1;
+   if (fd >= 0) {
+      struct cmsghdr *cmsg;
+
+      memset(control, 0, sizeof control);
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof control;
+      cmsg = CMSG_FIRSTHDR(&msg);
+      cmsg->cmsg_level = SOL_SOCKET;
+      cmsg->cmsg_type = SCM_RIGHTS;
+      cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+      memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+   }
+   do {
+      n = sendmsg(sock, &msg, MSG_NOSIGNAL);
+   } while (n < 0 && errno == EINTR);
+   return n == (ssize_t)(headerSize + length);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskd_Receive --
+ *
+ *      Receive one message.
+ *
+ * Results:
+ *      Bytes received, header included, 0 at the end of the stream, -1 on
+ *      error.
+ *
+ * Side effects:
+ *      A descriptor received while "fd" is NULL is closed.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+int
+JDiskd_Receive(int sock,              // IN
+               void *header,          // OUT
+               size_t headerSize,     // IN
+               char *payload,         // OUT: JDISKD_MAX_PAYLOAD bytes
+               int *fd)               // OUT: optional
+{
+   struct iovec iov[2];
+   struct msghdr msg;
+   struct cmsghdr *cmsg;
+   char control[CMSG_SPACE(sizeof(int))];
+   ssize_t n;
+
+   if (fd != NULL) {
+      *fd = -1;
+   }
+   memset(&msg, 0, sizeof msg);
+   iov[0].iov_base = header;
+   iov[0].iov_len = headerSize;
+   iov[1].iov_base = payload;
+   iov[1].iov_len = JDISKD_MAX_PAYLOAD;
+   msg.msg_iov = iov;
+   msg.msg_iovlen = 2;
+   msg.msg_control = control;
+   msg.msg_controllen = sizeof control;
+   do {
+      n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+   } while (n < 0 && errno == EINTR);
+   if (n < 0 || (msg.msg_flags & MSG_TRUNC) != 0) {
+      return -1;
+   }
+   for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+        cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+         int received;
+
+         memcpy(&received, CMSG_DATA(cmsg), sizeof(int));
+         if (fd != NULL && *fd < 0) {
+            *fd = received;
+         } else {
+            close(received);
+         }
+      }
+   }
+   return (int)n;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdFind --
+ *
+ *      Find a handle returned by this client. Must be called with the lock
+ *      held.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static JDiskdObject *
+JDiskdFind(const void *handle,   // IN
+           Bool disk)            // IN
+{
+   JDiskdObject *object;
+
+   for (object = gClient.objects; object != NULL; object = object->next) {
+      if (object == handle && object->disk == disk) {
+         return object;
+      }
+   }
+   return NULL;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdUnlinkCall --
+ *
+ *      Remove a call from the calls in flight. Must be called with the lock
+ *      held.
+ *
+ * Results:
+ *      FALSE if the call was not in flight.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JDiskdUnlinkCall(JDiskdCall *call)   // IN
+{
+   JDiskdCall **link = &gClient.calls;
+
+   while (*link != NULL && *link != call) {
+      link = &(*link)->next;
+   }
+   if (*link == NULL) {
+      return FALSE;
+   }
+   *link = call->next;
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdReadComplete --
+ *
+ *      Account for "chunks" slots of a read. Once they all are, a
+ *      synchronous read wakes up its caller and an asynchronous one calls
+ *      the callback of the caller.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Frees an asynchronous read once complete.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JDiskdReadComplete(JDiskdRead *read,   // IN
+                   int chunks,         // IN
+                   VixError err)       // IN
+{
+   VixDiskLibCompletionCB callback = read->callback;
+   Bool complete;
+
+   pthread_mutex_lock(&gClient.lock);
+   if (err != VIX_OK && read->result == VIX_OK) {
+      read->result = err;
+   }
+   read->remaining -= chunks;
+   complete = read->remaining == 0;
+   if (complete && callback == NULL) {
+      read->disk->inflight--;
+      read->done = TRUE;            /* The caller frees the read */
+      pthread_cond_broadcast(&gClient.cond);
+   }
+   pthread_mutex_unlock(&gClient.lock);
+
+   if (complete && callback != NULL) {
+      callback(read->cbData, read->result);
+      pthread_mutex_lock(&gClient.lock);
+      read->disk->inflight--;
+      pthread_cond_broadcast(&gClient.cond);
+      pthread_mutex_unlock(&gClient.lock);
+      free(read);
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdReadDone --
+ *
+ *      Complete the slot of a read, taken out of the calls in flight.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Frees the call and its slot.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JDiskdReadDone(JDiskdCall *call,     // IN
+               VixError err)         // IN
+{
+   JDiskdRead *read = call->read;
+
+   if (err == VIX_OK) {
+      memcpy(call->dest, gClient.region + (uint64)call->slot *
+             gClient.slotSize, call->bytes);
+   }
+   pthread_mutex_lock(&gClient.lock);
+   gClient.freeSlots[gClient.freeCount++] = call->slot;
+   pthread_cond_broadcast(&gClient.cond);
+   pthread_mutex_unlock(&gClient.lock);
+   free(call);
+   JDiskdReadComplete(read, 1, err);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdReceiver --
+ *
+ *      Receiver thread: match the replies to the calls in flight. When the
+ *      daemon goes away every call in flight fails.
+ *
+ * Results:
+ *      NULL.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void *
+JDiskdReceiver(void *data)   // IN
+{
+   char *payload = malloc(JDISKD_MAX_PAYLOAD);
+
+   while (payload != NULL) {
+      JDiskdReply reply;
+      JDiskdCall *call;
+      int n = JDiskd_Receive(gClient.sock, &reply, sizeof reply, payload,
+                             NULL);
+
+      if (n < (int)sizeof reply ||
+          reply.length != (uint32)(n - sizeof reply)) {
+         break;
+      }
+      pthread_mutex_lock(&gClient.lock);
+      for (call = gClient.calls; call != NULL; call = call->next) {
+         if (call->id == reply.id) {
+            break;
+         }
+      }
+      if (call != NULL) {
+         JDiskdUnlinkCall(call);
+         if (call->read == NULL) {
+            /*
+             * The caller owns the call and may return as soon as the lock
+             * is released.
+             */
+            call->reply = reply;
+            if (call->payload != NULL) {
+               memcpy(call->payload, payload, reply.length);
+            }
+            call->done = TRUE;
+            pthread_cond_broadcast(&gClient.cond);
+            call = NULL;
+         }
+      }
+      pthread_mutex_unlock(&gClient.lock);
+      if (call != NULL) {
+         JDiskdReadDone(call, reply.error);
+      }
+   }
+   free(payload);
+
+   pthread_mutex_lock(&gClient.lock);
+   gClient.broken = TRUE;
+   while (gClient.calls != NULL) {
+      JDiskdCall *call = gClient.calls;
+
+      gClient.calls = call->next;
+      if (call->read != NULL) {
+         pthread_mutex_unlock(&gClient.lock);
+         JDiskdReadDone(call, VIX_E_HOST_CONNECTION_LOST);
+         pthread_mutex_lock(&gClient.lock);
+      } else {
+         call->reply.error = VIX_E_HOST_CONNECTION_LOST;
+         call->reply.length = 0;
+         call->done = TRUE;
+      }
+   }
+   pthread_cond_broadcast(&gClient.cond);
+   pthread_mutex_unlock(&gClient.lock);
+   return NULL;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdSend --
+ *
+ *      Put a call in flight and send its command.
+ *
+ * Results:
+ *      VIX_OK, or VIX_E_HOST_CONNECTION_LOST with the call not in flight.
+ *
+ * Side effects:
+ *      Sets the id of the command.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static VixError
+JDiskdSend(JDiskdCall *call,          // IN/OUT
+           JDiskdRequest *request,    // IN/OUT
+           const char *payload)       // IN: optional
+{
+   Bool sent;
+
+   pthread_mutex_lock(&gClient.lock);
+   if (!gClient.attached || gClient.broken) {
+      pthread_mutex_unlock(&gClient.lock);
+      return VIX_E_HOST_CONNECTION_LOST;
+   }
+   call->id = request->id = ++gClient.nextId;
+   call->done = FALSE;
+   call->next = gClient.calls;
+   gClient.calls = call;
+   gClient.stats[JDiskdStatRequests]++;
+   pthread_mutex_unlock(&gClient.lock);
+
+   pthread_mutex_lock(&gClient.sendLock);
+   sent = JDiskd_Send(gClient.sock, request, sizeof *request, payload,
+                      request->length, -1);
+   pthread_mutex_unlock(&gClient.sendLock);
+   if (!sent) {
+      pthread_mutex_lock(&gClient.lock);
+      sent = !JDiskdUnlinkCall(call);     /* Failed by the receiver */
+      pthread_mutex_unlock(&gClient.lock);
+      if (!sent) {
+         return VIX_E_HOST_CONNECTION_LOST;
+      }
+   }
+   return VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdCallSync --
+ *
+ *      Send a command and wait for its reply.
+ *
+ * Results:
+ *      The error of the reply; the reply and its payload are returned in
+ *      "reply" and "replyPayload".
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static VixError
+JDiskdCallSync(uint32 op,                  // IN
+               uint64 handle,              // IN
+               const int64 args[4],        // IN: optional
+               const char *payload,        // IN: optional
+               uint32 length,              // IN
+               JDiskdReply *reply,         // OUT
+               char *replyPayload)         // OUT: optional
+{
+   JDiskdRequest request;
+   JDiskdCall call;
+   VixError err;
+
+   memset(&request, 0, sizeof request);
+   memset(&call, 0, sizeof call);
+   request.op = op;
+   request.handle = handle;
+   if (args != NULL) {
+      memcpy(request.args, args, sizeof request.args);
+   }
+   request.length = length;
+   call.payload = replyPayload;
+
+   err = JDiskdSend(&call, &request, payload);
+   if (err != VIX_OK) {
+      return err;
+   }
+   pthread_mutex_lock(&gClient.lock);
+   while (!call.done) {
+      pthread_cond_wait(&gClient.cond, &gClient.lock);
+   }
+   pthread_mutex_unlock(&gClient.lock);
+   *reply = call.reply;
+   return call.reply.error;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskd_Attach --
+ *
+ *      Connect to the daemon and share the slots with it. See jDiskd.h.
+ *
+ * Results:
+ *      VixError.
+ *
+ * Side effects:
+ *      Starts the receiver thread.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JDiskd_Attach(const char *socketPath,   // IN
+              uint32 slots,             // IN
+              uint32 slotSize)          // IN
+{
+   struct sockaddr_un addr;
+   JDiskdRequest request;
+   JDiskdReply reply;
+   uint64 regionSize;
+   uint8 *region = MAP_FAILED;
+   int sock = -1;
+   int fd = -1;
+   uint32 i;
+   VixError err = VIX_E_FAIL;
+
+   slots = slots > 0 ? slots : JDISKD_DEFAULT_SLOTS;
+   slotSize = slotSize > 0 ? slotSize : JDISKD_DEFAULT_SLOT_SIZE;
+   if (socketPath == NULL || strlen(socketPath) >= sizeof addr.sun_path ||
+       slots > JDISKD_MAX_SLOTS || slotSize % VIXDISKLIB_SECTOR_SIZE != 0) {
+      return VIX_E_INVALID_ARG;
+   }
+   pthread_mutex_lock(&gClient.lock);
+   if (gClient.attached) {
+      pthread_mutex_unlock(&gClient.lock);
+      return VIX_E_INVALID_ARG;
+   }
+   pthread_mutex_unlock(&gClient.lock);
+
+   regionSize = (uint64)slots * slotSize;
+   /*
+    * The size is sealed: the daemon maps the region and must never be
+    * left with pages past the end of the file.
+    */
+   fd = memfd_create("jdiskd", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+   if (fd < 0 || ftruncate(fd, regionSize) != 0 ||
+       fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW) != 0) {
+      goto out;
+   }
+   region = mmap(NULL, regionSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   if (region == MAP_FAILED) {
+      err = VIX_E_OUT_OF_MEMORY;
+      goto out;
+   }
+
+   sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+   if (sock < 0) {
+      goto out;
+   }
+   memset(&addr, 0, sizeof addr);
+   addr.sun_family = AF_UNIX;
+   strcpy(addr.sun_path, socketPath);
+   if (connect(sock, (struct sockaddr *)&addr, sizeof addr) != 0) {
+      err = VIX_E_HOST_SERVER_NOT_FOUND;
+      goto out;
+   }
+
+   /*
+    * The handshake runs before the receiver thread starts.
+    */
+   memset(&request, 0, sizeof request);
+   request.op = JDiskdOpHello;
+   request.args[0] = JDISKD_MAGIC;
+   request.args[1] = JDISKD_VERSION;
+   request.args[2] = slots;
+   request.args[3] = slotSize;
+   if (!JDiskd_Send(sock, &request, sizeof request, NULL, 0, fd)) {
+      goto out;
+   }
+   {
+      char *buf = malloc(JDISKD_MAX_PAYLOAD);
+      int n = buf != NULL ? JDiskd_Receive(sock, &reply, sizeof reply, buf,
+                                           NULL) : -1;
+
+      free(buf);
+      if (n < (int)sizeof reply) {
+         goto out;
+      }
+   }
+   if (reply.error != VIX_OK) {
+      err = reply.error;
+      goto out;
+   }
+
+   pthread_mutex_lock(&gClient.lock);
+   gClient.sock = sock;
+   gClient.region = region;
+   gClient.slots = slots;
+   gClient.slotSize = slotSize;
+   for (i = 0; i < slots; i++) {
+      gClient.freeSlots[i] = slots - 1 - i;
+   }
+   gClient.freeCount = slots;
+   gClient.broken = FALSE;
+   gClient.attached = TRUE;
+   if (pthread_create(&gClient.receiver, NULL, JDiskdReceiver, NULL) != 0) {
+      gClient.attached = FALSE;
+      pthread_mutex_unlock(&gClient.lock);
+      goto out;
+   }
+   pthread_mutex_unlock(&gClient.lock);
+   close(fd);
+   return VIX_OK;
+
+out:
+   if (sock >= 0) {
+      close(sock);
+   }
+   if (region != MAP_FAILED) {
+      munmap(region, regionSize);
+   }
+   if (fd >= 0) {
+      close(fd);
+   }
+   return err;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskd_Detach --
+ *
+ *      Disconnect from the daemon. See jDiskd.h.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      The handles of the client become invalid.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JDiskd_Detach(void)
+{
+   pthread_mutex_lock(&gClient.lock);
+   if (!gClient.attached) {
+      pthread_mutex_unlock(&gClient.lock);
+      return;
+   }
+   pthread_mutex_unlock(&gClient.lock);
+
+   shutdown(gClient.sock, SHUT_RDWR);
+   pthread_join(gClient.receiver, NULL);
+
+   pthread_mutex_lock(&gClient.lock);
+   while (gClient.objects != NULL) {
+      JDiskdObject *next = gClient.objects->next;
+
+      free(gClient.objects);
+      gClient.objects = next;
+   }
+   close(gClient.sock);
+   gClient.sock = -1;
+   munmap(gClient.region, (uint64)gClient.slots * gClient.slotSize);
+   gClient.region = NULL;
+   gClient.attached = FALSE;
+   pthread_mutex_unlock(&gClient.lock);
+}
+
+
+Bool
+JDiskd_IsAttached(void)
+{
+   Bool attached;
+
+   pthread_mutex_lock(&gClient.lock);
+   attached = gClient.attached;
+   pthread_mutex_unlock(&gClient.lock);
+   return attached;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskd_IsRemote --
+ *
+ *      Whether a connection or disk handle belongs to the client.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+Bool
+JDiskd_IsRemote(const void *handle)   // IN
+{
+   Bool remote;
+
+   if (handle == NULL) {
+      return FALSE;
+   }
+   pthread_mutex_lock(&gClient.lock);
+   remote = JDiskdFind(handle, FALSE) != NULL ||
+            JDiskdFind(handle, TRUE) != NULL;
+   pthread_mutex_unlock(&gClient.lock);
+   return remote;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdNewObject --
+ *
+ *      Register a handle of the daemon.
+ *
+ * Results:
+ *      The local handle, NULL if out of memory.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static JDiskdObject *
+JDiskdNewObject(uint64 remote,   // IN
+                Bool disk)       // IN
+{
+   JDiskdObject *object = calloc(1, sizeof *object);
+
+   if (object != NULL) {
+      object->remote = remote;
+      object->disk = disk;
+      pthread_mutex_lock(&gClient.lock);
+      object->next = gClient.objects;
+      gClient.objects = object;
+      pthread_mutex_unlock(&gClient.lock);
+   }
+   return object;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdFreeObject --
+ *
+ *      Unregister and free a handle.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JDiskdFreeObject(JDiskdObject *object)   // IN
+{
+   JDiskdObject **link;
+
+   pthread_mutex_lock(&gClient.lock);
+   for (link = &gClient.objects; *link != NULL; link = &(*link)->next) {
+      if (*link == object) {
+         *link = object->next;
+         break;
+      }
+   }
+   pthread_mutex_unlock(&gClient.lock);
+   free(object);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdRemote --
+ *
+ *      Daemon handle of a local handle.
+ *
+ * Results:
+ *      FALSE if the handle is not one of the client.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JDiskdRemote(const void *handle,   // IN
+             Bool disk,            // IN
+             uint64 *remote)       // OUT
+{
+   JDiskdObject *object;
+
+   pthread_mutex_lock(&gClient.lock);
+   object = JDiskdFind(handle, disk);
+   if (object != NULL) {
+      *remote = object->remote;
+   }
+   pthread_mutex_unlock(&gClient.lock);
+   return object != NULL;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskd_Connect --
+ *
+ *      VixDiskLib_ConnectEx in the daemon.
+ *
+ * Results:
+ *      VixError.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JDiskd_Connect(const VixDiskLibConnectParams *params,   // IN
+               Bool readOnly,                           // IN
+               const char *ssMoref,                     // IN: optional
+               const char *modes,                       // IN: optional
+               VixDiskLibConnection *conn)              // OUT
+{
+   const char *user = NULL;
+   const char *secret = NULL;
+   const char *key = NULL;
+   const char *spec[3] = { NULL, NULL, NULL };
+   char *payload;
+   uint32 length = 0;
+   int64 args[4];
+   JDiskdReply reply;
+   JDiskdObject *object;
+   Bool fits;
+   VixError err;
+
+   if (params->credType == VIXDISKLIB_CRED_UID) {
+      user = params->creds.uid.userName;
+      secret = params->creds.uid.password;
+   } else if (params->credType == VIXDISKLIB_CRED_SESSIONID) {
+      user = params->creds.sessionId.userName;
+      secret = params->creds.sessionId.cookie;
+      key = params->creds.sessionId.key;
+   }
+   if (params->specType == VIXDISKLIB_SPEC_VSTORAGE_OBJECT) {
+      spec[0] = params->spec.vStorageObjSpec.id;
+      spec[1] = params->spec.vStorageObjSpec.datastoreMoRef;
+      spec[2] = params->spec.vStorageObjSpec.ssId;
+   } else {
+      spec[0] = params->vmxSpec;
+   }
+
+   payload = malloc(JDISKD_MAX_PAYLOAD);
+   if (payload == NULL) {
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   fits = JDiskd_PutString(payload, JDISKD_MAX_PAYLOAD, &length,
+                           params->serverName) &&
+          JDiskd_PutString(payload, JDISKD_MAX_PAYLOAD, &length,
+                           params->thumbPrint) &&
+          JDiskd_PutString(payload, JDISKD_MAX_PAYLOAD, &length, user) &&
+          JDiskd_PutString(payload, JDISKD_MAX_PAYLOAD, &length, secret) &&
+          JDiskd_PutString(payload, JDISKD_MAX_PAYLOAD, &length, key) &&
+          JDiskd_PutString(payload, JDISKD_MAX_PAYLOAD, &length, spec[0]) &&
+          JDiskd_PutString(payload, JDISKD_MAX_PAYLOAD, &length, spec[1]) &&
+          JDiskd_PutString(payload, JDISKD_MAX_PAYLOAD, &length, spec[2]) &&
+          JDiskd_PutString(payload, JDISKD_MAX_PAYLOAD, &length, ssMoref) &&
+          JDiskd_PutString(payload, JDISKD_MAX_PAYLOAD, &length, modes);
+   if (!fits) {
+      free(payload);
+      return VIX_E_INVALID_ARG;
+   }
+   args[0] = readOnly;
+   args[1] = params->credType;
+   args[2] = params->specType;
+   args[3] = params->port | ((int64)params->nfcHostPort << 32);
+   err = JDiskdCallSync(JDiskdOpConnect, 0, args, payload, length, &reply,
+                        NULL);
+   memset(payload, 0, length);      /* Do not leave the secrets around */
+   free(payload);
+   if (err != VIX_OK) {
+      return err;
+   }
+   object = JDiskdNewObject(reply.values[0], FALSE);
+   if (object == NULL) {
+      JDiskdCallSync(JDiskdOpDisconnect, reply.values[0], NULL, NULL, 0,
+                     &reply, NULL);
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   *conn = (VixDiskLibConnection)object;
+   return VIX_OK;
+}
+
+
+VixError
+JDiskd_Disconnect(VixDiskLibConnection conn)   // IN
+{
+   JDiskdReply reply;
+   uint64 remote;
+   VixError err;
+
+   if (!JDiskdRemote(conn, FALSE, &remote)) {
+      return VIX_E_INVALID_ARG;
+   }
+   err = JDiskdCallSync(JDiskdOpDisconnect, remote, NULL, NULL, 0, &reply,
+                        NULL);
+   JDiskdFreeObject((JDiskdObject *)conn);
+   return err;
+}
+
+
+VixError
+JDiskd_Open(VixDiskLibConnection conn,   // IN
+            const char *path,            // IN
+            uint32 flags,                // IN
+            VixDiskLibHandle *disk)      // OUT
+{
+   char payload[4096];
+   uint32 length = 0;
+   int64 args[4] = { flags, 0, 0, 0 };
+   JDiskdReply reply;
+   JDiskdObject *object;
+   uint64 remote;
+   VixError err;
+
+   if (!JDiskdRemote(conn, FALSE, &remote)) {
+      return VIX_E_INVALID_ARG;
+   }
+   if (!JDiskd_PutString(payload, sizeof payload, &length, path)) {
+      return VIX_E_INVALID_ARG;
+   }
+   err = JDiskdCallSync(JDiskdOpOpen, remote, args, payload, length, &reply,
+                        NULL);
+   if (err != VIX_OK) {
+      return err;
+   }
+   object = JDiskdNewObject(reply.values[0], TRUE);
+   if (object == NULL) {
+      JDiskdCallSync(JDiskdOpClose, reply.values[0], NULL, NULL, 0, &reply,
+                     NULL);
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   *disk = (VixDiskLibHandle)object;
+   return VIX_OK;
+}
+
+
+VixError
+JDiskd_Close(VixDiskLibHandle disk)   // IN
+{
+   JDiskdReply reply;
+   uint64 remote;
+   VixError err;
+
+   if (!JDiskdRemote(disk, TRUE, &remote)) {
+      return VIX_E_INVALID_ARG;
+   }
+   JDiskd_Wait(disk);
+   err = JDiskdCallSync(JDiskdOpClose, remote, NULL, NULL, 0, &reply, NULL);
+   JDiskdFreeObject((JDiskdObject *)disk);
+   return err;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskd_GetInfo --
+ *
+ *      VixDiskLib_GetInfo in the daemon.
+ *
+ * Results:
+ *      VixError.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JDiskd_GetInfo(VixDiskLibHandle disk,    // IN
+               VixDiskLibInfo **info)    // OUT
+{
+   JDiskdReply reply;
+   JDiskdInfo remoteInfo;
+   const char *parent;
+   const char *uuid;
+   char *payload;
+   uint32 pos = sizeof remoteInfo;
+   uint64 remote;
+   VixError err;
+
+   if (!JDiskdRemote(disk, TRUE, &remote)) {
+      return VIX_E_INVALID_ARG;
+   }
+   payload = malloc(JDISKD_MAX_PAYLOAD);
+   if (payload == NULL) {
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   err = JDiskdCallSync(JDiskdOpGetInfo, remote, NULL, NULL, 0, &reply,
+                        payload);
+   if (err == VIX_OK && info != NULL) {
+      if (reply.length < sizeof remoteInfo ||
+          !JDiskd_GetString(payload, reply.length, &pos, &parent) ||
+          !JDiskd_GetString(payload, reply.length, &pos, &uuid)) {
+         err = VIX_E_FAIL;
+      } else if ((*info = calloc(1, sizeof **info)) == NULL) {
+         err = VIX_E_OUT_OF_MEMORY;
+      } else {
+         memcpy(&remoteInfo, payload, sizeof remoteInfo);
+         (*info)->biosGeo.cylinders = remoteInfo.biosGeo[0];
+         (*info)->biosGeo.heads = remoteInfo.biosGeo[1];
+         (*info)->biosGeo.sectors = remoteInfo.biosGeo[2];
+         (*info)->physGeo.cylinders = remoteInfo.physGeo[0];
+         (*info)->physGeo.heads = remoteInfo.physGeo[1];
+         (*info)->physGeo.sectors = remoteInfo.physGeo[2];
+         (*info)->capacity = remoteInfo.capacity;
+         (*info)->adapterType = remoteInfo.adapterType;
+         (*info)->numLinks = remoteInfo.numLinks;
+         (*info)->logicalSectorSize = remoteInfo.logicalSectorSize;
+         (*info)->physicalSectorSize = remoteInfo.physicalSectorSize;
+         (*info)->parentFileNameHint = parent != NULL ? strdup(parent) : NULL;
+         (*info)->uuid = uuid != NULL ? strdup(uuid) : NULL;
+      }
+   }
+   free(payload);
+   return err;
+}
+
+
+void
+JDiskd_FreeInfo(VixDiskLibInfo *info)   // IN
+{
+   if (info != NULL) {
+      free(info->parentFileNameHint);
+      free(info->uuid);
+      free(info);
+   }
+}
+
+
+char *
+JDiskd_GetTransportMode(VixDiskLibHandle disk)   // IN
+{
+   JDiskdReply reply;
+   const char *mode = NULL;
+   char *payload;
+   char *result = NULL;
+   uint32 pos = 0;
+   uint64 remote;
+
+   if (!JDiskdRemote(disk, TRUE, &remote)) {
+      return NULL;
+   }
+   payload = malloc(JDISKD_MAX_PAYLOAD);
+   if (payload != NULL &&
+       JDiskdCallSync(JDiskdOpGetTransportMode, remote, NULL, NULL, 0, &reply,
+                      payload) == VIX_OK &&
+       JDiskd_GetString(payload, reply.length, &pos, &mode) && mode != NULL) {
+      result = strdup(mode);
+   }
+   free(payload);
+   return result;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdTakeSlot --
+ *
+ *      Take a free slot, waiting for one. Must be called with the lock
+ *      held.
+ *
+ * Results:
+ *      FALSE if the daemon went away.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JDiskdTakeSlot(uint32 *slot)   // OUT
+{
+   if (gClient.freeCount == 0) {
+      gClient.stats[JDiskdStatSlotWaits]++;
+   }
+   while (gClient.freeCount == 0 && !gClient.broken) {
+      pthread_cond_wait(&gClient.cond, &gClient.lock);
+   }
+   if (gClient.broken) {
+      return FALSE;
+   }
+   *slot = gClient.freeSlots[--gClient.freeCount];
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskd_QueryAllocatedBlocks --
+ *
+ *      VixDiskLib_QueryAllocatedBlocks in the daemon. The daemon returns
+ *      the blocks through a slot; a list too long for a slot is fetched
+ *      in several commands.
+ *
+ * Results:
+ *      VixError.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JDiskd_QueryAllocatedBlocks(VixDiskLibHandle disk,              // IN
+                            VixDiskLibSectorType startSector,   // IN
+                            VixDiskLibSectorType numSectors,    // IN
+                            VixDiskLibSectorType chunkSize,     // IN
+                            VixDiskLibBlockList **blockList)    // OUT
+{
+   VixDiskLibSectorType end = startSector + numSectors;
+   VixDiskLibBlockList *list;
+   uint32 capacity = 64;
+   uint32 slot;
+   uint64 remote;
+   VixError err = VIX_OK;
+
+   if (!JDiskdRemote(disk, TRUE, &remote)) {
+      return VIX_E_INVALID_ARG;
+   }
+   list = malloc(sizeof *list + capacity * sizeof list->blocks[0]);
+   if (list == NULL) {
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   list->numBlocks = 0;
+
+   pthread_mutex_lock(&gClient.lock);
+   if (!JDiskdTakeSlot(&slot)) {
+      pthread_mutex_unlock(&gClient.lock);
+      free(list);
+      return VIX_E_HOST_CONNECTION_LOST;
+   }
+   pthread_mutex_unlock(&gClient.lock);
+
+   while (err == VIX_OK && startSector < end) {
+      int64 args[4] = { startSector, end - startSector, chunkSize, slot };
+      const uint64 *blocks;
+      JDiskdReply reply;
+      uint32 count;
+      uint32 i;
+
+      err = JDiskdCallSync(JDiskdOpQueryBlocks, remote, args, NULL, 0, &reply,
+                           NULL);
+      if (err != VIX_OK) {
+         break;
+      }
+      count = (uint32)reply.values[0];
+      if ((uint64)count * 16 > gClient.slotSize) {
+         err = VIX_E_FAIL;
+         break;
+      }
+      if (list->numBlocks + count > capacity) {
+         VixDiskLibBlockList *grown;
+
+         while (list->numBlocks + count > capacity) {
+            capacity *= 2;
+         }
+         grown = realloc(list, sizeof *list +
+                         capacity * sizeof list->blocks[0]);
+         if (grown == NULL) {
+            err = VIX_E_OUT_OF_MEMORY;
+            break;
+         }
+         list = grown;
+      }
+      blocks = (const uint64 *)(gClient.region +
+                                (uint64)slot * gClient.slotSize);
+      for (i = 0; i < count; i++) {
+         list->blocks[list->numBlocks].offset = blocks[2 * i];
+         list->blocks[list->numBlocks].length = blocks[2 * i + 1];
+         list->numBlocks++;
+      }
+      if (reply.values[1] == 0 || (uint64)reply.values[1] <= startSector) {
+         break;
+      }
+      startSector = reply.values[1];
+   }
+
+   pthread_mutex_lock(&gClient.lock);
+   gClient.freeSlots[gClient.freeCount++] = slot;
+   pthread_cond_broadcast(&gClient.cond);
+   pthread_mutex_unlock(&gClient.lock);
+   if (err != VIX_OK) {
+      free(list);
+      return err;
+   }
+   *blockList = list;
+   return VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdCopyOut --
+ *
+ *      Copy a NUL terminated reply to a buffer with the VixDiskLib metadata
+ *      contract: VIX_E_BUFFER_TOOSMALL and the size required when it does
+ *      not fit.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static VixError
+JDiskdCopyOut(const char *payload,  // IN
+              uint32 length,        // IN
+              char *buf,            // OUT: optional
+              size_t bufLen,        // IN
+              size_t *required)     // OUT: optional
+{
+   if (required != NULL) {
+      *required = length;
+   }
+   if (buf == NULL || bufLen < length) {
+      return VIX_E_BUFFER_TOOSMALL;
+   }
+   memcpy(buf, payload, length);
+   return VIX_OK;
+}
+
+
+VixError
+JDiskd_GetMetadataKeys(VixDiskLibHandle disk,   // IN
+                       char *keys,              // OUT: optional
+                       size_t bufLen,           // IN
+                       size_t *required)        // OUT: optional
+{
+   JDiskdReply reply;
+   char *payload;
+   uint64 remote;
+   VixError err;
+
+   if (!JDiskdRemote(disk, TRUE, &remote)) {
+      return VIX_E_INVALID_ARG;
+   }
+   payload = malloc(JDISKD_MAX_PAYLOAD);
+   if (payload == NULL) {
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   err = JDiskdCallSync(JDiskdOpGetMetadataKeys, remote, NULL, NULL, 0,
+                        &reply, payload);
+   if (err == VIX_OK) {
+      err = JDiskdCopyOut(payload, reply.length, keys, bufLen, required);
+   }
+   free(payload);
+   return err;
+}
+
+
+VixError
+JDiskd_ReadAllMetadata(VixDiskLibHandle disk,   // IN
+                       char *buf,               // OUT: optional
+                       size_t bufLen,           // IN
+                       size_t *required)        // OUT: optional
+{
+   JDiskdReply reply;
+   char *payload;
+   uint64 remote;
+   VixError err;
+
+   if (!JDiskdRemote(disk, TRUE, &remote)) {
+      return VIX_E_INVALID_ARG;
+   }
+   payload = malloc(JDISKD_MAX_PAYLOAD);
+   if (payload == NULL) {
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   err = JDiskdCallSync(JDiskdOpReadAllMetadata, remote, NULL, NULL, 0,
+                        &reply, payload);
+   if (err == VIX_OK) {
+      err = JDiskdCopyOut(payload, reply.length, buf, bufLen, required);
+   }
+   free(payload);
+   return err;
+}
+
+
+VixError
+JDiskd_ReadMetadata(VixDiskLibHandle disk,   // IN
+                    const char *key,         // IN
+                    char *buf,               // OUT: optional
+                    size_t bufLen,           // IN
+                    size_t *required)        // OUT: optional
+{
+   JDiskdReply reply;
+   char *payload;
+   uint32 length = 0;
+   uint64 remote;
+   VixError err;
+
+   if (!JDiskdRemote(disk, TRUE, &remote)) {
+      return VIX_E_INVALID_ARG;
+   }
+   payload = malloc(JDISKD_MAX_PAYLOAD);
+   if (payload == NULL) {
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   if (!JDiskd_PutString(payload, JDISKD_MAX_PAYLOAD, &length, key)) {
+      free(payload);
+      return VIX_E_INVALID_ARG;
+   }
+   err = JDiskdCallSync(JDiskdOpReadMetadata, remote, NULL, payload, length,
+                        &reply, payload);
+   if (err == VIX_OK) {
+      err = JDiskdCopyOut(payload, reply.length, buf, bufLen, required);
+   }
+   free(payload);
+   return err;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdStartRead --
+ *
+ *      Send the commands of a read, one per slot.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      The read completes through JDiskdReadComplete, even when its
+ *      commands cannot be sent.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JDiskdStartRead(JDiskdObject *disk,                // IN
+                VixDiskLibSectorType startSector,  // IN
+                VixDiskLibSectorType numSectors,   // IN
+                uint8 *buf,                        // OUT
+                JDiskdRead *read)                  // IN/OUT
+{
+   uint64 slotSectors = gClient.slotSize / VIXDISKLIB_SECTOR_SIZE;
+   VixDiskLibSectorType done = 0;
+
+   read->disk = disk;
+   read->remaining = (numSectors + slotSectors - 1) / slotSectors;
+   read->result = VIX_OK;
+
+   pthread_mutex_lock(&gClient.lock);
+   disk->inflight++;
+   gClient.stats[JDiskdStatReads]++;
+   gClient.stats[JDiskdStatBytesRead] += numSectors * VIXDISKLIB_SECTOR_SIZE;
+   pthread_mutex_unlock(&gClient.lock);
+
+   while (done < numSectors) {
+      VixDiskLibSectorType count = numSectors - done;
+      JDiskdRequest request;
+      JDiskdCall *call = calloc(1, sizeof *call);
+      Bool slotted = FALSE;
+
+      if (count > slotSectors) {
+         count = slotSectors;
+      }
+      if (call != NULL) {
+         pthread_mutex_lock(&gClient.lock);
+         slotted = JDiskdTakeSlot(&call->slot);
+         pthread_mutex_unlock(&gClient.lock);
+      }
+      if (!slotted) {
+         free(call);
+         JDiskdReadComplete(read, (numSectors - done + slotSectors - 1) /
+                            slotSectors, call != NULL ?
+                            VIX_E_HOST_CONNECTION_LOST : VIX_E_OUT_OF_MEMORY);
+         return;
+      }
+      call->read = read;
+      call->dest = buf + done * VIXDISKLIB_SECTOR_SIZE;
+      call->bytes = count * VIXDISKLIB_SECTOR_SIZE;
+
+      memset(&request, 0, sizeof request);
+      request.op = JDiskdOpRead;
+      request.handle = disk->remote;
+      request.args[0] = startSector + done;
+      request.args[1] = count;
+      request.args[2] = call->slot;
+      done += count;
+      if (JDiskdSend(call, &request, NULL) != VIX_OK) {
+         JDiskdReadDone(call, VIX_E_HOST_CONNECTION_LOST);
+      }
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskd_Read --
+ *
+ *      VixDiskLib_Read in the daemon.
+ *
+ * Results:
+ *      VixError.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JDiskd_Read(VixDiskLibHandle disk,              // IN
+            VixDiskLibSectorType startSector,   // IN
+            VixDiskLibSectorType numSectors,    // IN
+            uint8 *buf)                         // OUT
+{
+   JDiskdRead read;
+
+   pthread_mutex_lock(&gClient.lock);
+   if (JDiskdFind(disk, TRUE) == NULL || numSectors == 0 || buf == NULL) {
+      pthread_mutex_unlock(&gClient.lock);
+      return VIX_E_INVALID_ARG;
+   }
+   pthread_mutex_unlock(&gClient.lock);
+
+   memset(&read, 0, sizeof read);
+   JDiskdStartRead((JDiskdObject *)disk, startSector, numSectors, buf, &read);
+   pthread_mutex_lock(&gClient.lock);
+   while (!read.done) {
+      pthread_cond_wait(&gClient.cond, &gClient.lock);
+   }
+   pthread_mutex_unlock(&gClient.lock);
+   return read.result;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskd_ReadAsync --
+ *
+ *      VixDiskLib_ReadAsync in the daemon. See jDiskd.h.
+ *
+ * Results:
+ *      VIX_ASYNC, or an error with the callback not called.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JDiskd_ReadAsync(VixDiskLibHandle disk,              // IN
+                 VixDiskLibSectorType startSector,   // IN
+                 VixDiskLibSectorType numSectors,    // IN
+                 uint8 *buf,                         // OUT
+                 VixDiskLibCompletionCB callback,    // IN
+                 void *cbData)                       // IN
+{
+   JDiskdRead *read;
+
+   pthread_mutex_lock(&gClient.lock);
+   if (JDiskdFind(disk, TRUE) == NULL || numSectors == 0 || buf == NULL ||
+       callback == NULL) {
+      pthread_mutex_unlock(&gClient.lock);
+      return VIX_E_INVALID_ARG;
+   }
+   pthread_mutex_unlock(&gClient.lock);
+
+   read = calloc(1, sizeof *read);
+   if (read == NULL) {
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   read->callback = callback;
+   read->cbData = cbData;
+   JDiskdStartRead((JDiskdObject *)disk, startSector, numSectors, buf, read);
+   return VIX_ASYNC;
+}
+
+
+VixError
+JDiskd_Wait(VixDiskLibHandle disk)   // IN
+{
+   JDiskdObject *object;
+
+   pthread_mutex_lock(&gClient.lock);
+   object = JDiskdFind(disk, TRUE);
+   while (object != NULL && object->inflight > 0) {
+      pthread_cond_wait(&gClient.cond, &gClient.lock);
+   }
+   pthread_mutex_unlock(&gClient.lock);
+   return object != NULL ? VIX_OK : VIX_E_INVALID_ARG;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskd_GetStats --
+ *
+ *      Statistics of the client, and of the daemon if attached.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JDiskd_GetStats(int64 stats[JDiskdStatCount])   // OUT
+{
+   JDiskdReply reply;
+   char *payload = malloc(JDISKD_MAX_PAYLOAD);
+
+   pthread_mutex_lock(&gClient.lock);
+   memcpy(stats, gClient.stats, sizeof gClient.stats);
+   pthread_mutex_unlock(&gClient.lock);
+   if (payload != NULL &&
+       JDiskdCallSync(JDiskdOpGetStats, 0, NULL, NULL, 0, &reply,
+                      payload) == VIX_OK &&
+       reply.length >= (JDiskdStatCount - JDiskdStatClients) *
+                       sizeof(int64)) {
+      memcpy(stats + JDiskdStatClients, payload,
+             (JDiskdStatCount - JDiskdStatClients) * sizeof(int64));
+   }
+   free(payload);
+}
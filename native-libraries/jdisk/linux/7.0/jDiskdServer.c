@@ -0,0 +1,1064 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jDiskdServer.c
+ *
+ *    jdiskd: persistent VDDK worker.
+ *
+ *    The daemon initialises VixDiskLib once and serves the processes
+ *    attached to its unix socket, one thread per client. Connections go
+ *    through the connection cache, so the jobs of every client on the same
+ *    snapshot share warm connections, and reads are issued with
+ *    VixDiskLib_ReadAsync straight into the shared slots of the client. A
+ *    client that goes away has its disks closed and its connections
+ *    released; a VDDK crash only takes the daemon down, and the clients see
+ *    their calls fail with VIX_E_HOST_CONNECTION_LOST.
+ *
+ *    Usage: jdiskd [-s socket] [-l libDir] [-c configFile] [-v major.minor]
+ *                  [-i idleSeconds] [-a maxAgeSeconds] [-h idleHandles]
+ *                  [-m mode]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "jDiskd.h"
+#include "jConnCache.h"
+#include "jMetadata.h"
+#include "jVddk.h"
+
+/*
+ * Time to wait for a completion before pumping VixDiskLib_Wait, since some
+ * transports only deliver completions from there.
+ */
+#define WAIT_PUMP_TIMEOUT_MS 100
+
+#define LGPFX "jdiskd: "
+
+typedef struct JDiskdHandle {
+   uint64 handle;                   /* VixDiskLibConnection or Handle */
+   Bool disk;
+   int inflight;                    /* Reads in flight (disks) */
+   struct JDiskdHandle *next;
+} JDiskdHandle;
+
+typedef struct JDiskdClient {
+   int sock;
+   uint8 *region;
+   uint64 regionSize;
+   uint32 slots;
+   uint32 slotSize;
+   pthread_mutex_t lock;            /* Sends and the reads in flight */
+   pthread_cond_t cond;
+   int inflight;
+   JDiskdHandle *handles;           /* Only touched by the client thread */
+   pthread_t thread;
+   Bool finished;
+   struct JDiskdClient *next;
+} JDiskdClient;
+
+typedef struct JDiskdPendingRead {
+   JDiskdClient *client;
+   JDiskdHandle *disk;
+   uint32 id;
+} JDiskdPendingRead;
+
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static JDiskdClient *gClients;
+static int64 gClientCount;
+static int64 gOpenDisks;
+static volatile sig_atomic_t gStop;
+
+
+static void
+JDiskdLog(const char *fmt,   // IN
+          va_list args)      // IN
+{
+   fputs(LGPFX, stderr);
+   vfprintf(stderr, fmt, args);
+}
+
+
+static void
+JDiskdPanic(const char *fmt,   // IN
+            va_list args)      // IN
+{
+   JDiskdLog(fmt, args);
+   abort();
+}
+
+
+static void
+JDiskdStop(int sig)   // IN
+{
+   gStop = 1;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdSendReply --
+ *
+ *      Send the reply of a command.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None. A client that went away notices on its next receive.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JDiskdSendReply(JDiskdClient *client,    // IN
+                uint32 id,               // IN
+                VixError err,            // IN
+                int64 value0,            // IN
+                int64 value1,            // IN
+                const char *payload,     // IN: optional
+                uint32 length)           // IN
+{
+   JDiskdReply reply;
+
+   memset(&reply, 0, sizeof reply);
+   reply.id = id;
+   reply.error = err;
+   reply.values[0] = value0;
+   reply.values[1] = value1;
+   reply.length = payload != NULL ? length : 0;
+   pthread_mutex_lock(&client->lock);
+   JDiskd_Send(client->sock, &reply, sizeof reply, payload, reply.length, -1);
+   pthread_mutex_unlock(&client->lock);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdFind --
+ *
+ *      Find a handle given to a client.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static JDiskdHandle *
+JDiskdFind(JDiskdClient *client,   // IN
+           uint64 handle,          // IN
+           Bool disk)              // IN
+{
+   JDiskdHandle *entry;
+
+   for (entry = client->handles; entry != NULL; entry = entry->next) {
+      if (entry->handle == handle && entry->disk == disk) {
+         return entry;
+      }
+   }
+   return NULL;
+}
+
+
+static Bool
+JDiskdAdd(JDiskdClient *client,    // IN
+          uint64 handle,           // IN
+          Bool disk)               // IN
+{
+   JDiskdHandle *entry = calloc(1, sizeof *entry);
+
+   if (entry == NULL) {
+      return FALSE;
+   }
+   entry->handle = handle;
+   entry->disk = disk;
+   entry->next = client->handles;
+   client->handles = entry;
+   return TRUE;
+}
+
+
+static void
+JDiskdRemove(JDiskdClient *client,   // IN
+             JDiskdHandle *entry)    // IN
+{
+   JDiskdHandle **link = &client->handles;
+
+   while (*link != NULL && *link != entry) {
+      link = &(*link)->next;
+   }
+   if (*link != NULL) {
+      *link = entry->next;
+   }
+   free(entry);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdReadDone --
+ *
+ *      Completion of a read: reply to the client.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Frees the pending read.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JDiskdReadDone(void *cbData,     // IN
+               VixError err)     // IN
+{
+   JDiskdPendingRead *pending = cbData;
+   JDiskdClient *client = pending->client;
+   JDiskdReply reply;
+
+   memset(&reply, 0, sizeof reply);
+   reply.id = pending->id;
+   reply.error = err;
+   pthread_mutex_lock(&client->lock);
+   JDiskd_Send(client->sock, &reply, sizeof reply, NULL, 0, -1);
+   pending->disk->inflight--;
+   client->inflight--;
+   pthread_cond_broadcast(&client->cond);
+   pthread_mutex_unlock(&client->lock);
+   free(pending);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdPump --
+ *
+ *      Pump the completions of the disks with reads in flight, or only of
+ *      "only" if set; with "drain", until none is left in flight.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Blocks while VixDiskLib_Wait runs.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JDiskdPump(JDiskdClient *client,   // IN
+           JDiskdHandle *only,     // IN: optional
+           Bool drain)             // IN: wait until none is in flight
+{
+   JDiskdHandle *entry;
+
+   for (;;) {
+      Bool busy = FALSE;
+
+      pthread_mutex_lock(&client->lock);
+      for (entry = client->handles; entry != NULL; entry = entry->next) {
+         if (entry->disk && entry->inflight > 0 &&
+             (only == NULL || entry == only)) {
+            busy = TRUE;
+         }
+      }
+      pthread_mutex_unlock(&client->lock);
+      if (!busy) {
+         return;
+      }
+      for (entry = client->handles; entry != NULL; entry = entry->next) {
+         if (entry->disk && (only == NULL || entry == only)) {
+            VixDiskLib_Wait((VixDiskLibHandle)(size_t)entry->handle);
+         }
+      }
+      if (!drain) {
+         return;
+      }
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdConnect --
+ *
+ *      Connect command: rebuild the connect parameters from the payload.
+ *
+ * Results:
+ *      VixError.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static VixError
+JDiskdConnect(JDiskdClient *client,            // IN
+              const JDiskdRequest *request,    // IN
+              const char *payload,             // IN
+              VixDiskLibConnection *conn)      // OUT
+{
+   const char *field[10];
+   VixDiskLibConnectParams *params;
+   uint32 pos = 0;
+   VixError err;
+   int i;
+
+   for (i = 0; i < 10; i++) {
+      if (!JDiskd_GetString(payload, request->length, &pos, &field[i])) {
+         return VIX_E_INVALID_ARG;
+      }
+   }
+   params = VixDiskLib_AllocateConnectParams();
+   if (params == NULL) {
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   params->serverName = (char *)field[0];
+   params->thumbPrint = (char *)field[1];
+   params->credType = request->args[1];
+   if (params->credType == VIXDISKLIB_CRED_UID) {
+      params->creds.uid.userName = (char *)field[2];
+      params->creds.uid.password = (char *)field[3];
+   } else if (params->credType == VIXDISKLIB_CRED_SESSIONID) {
+      params->creds.sessionId.userName = (char *)field[2];
+      params->creds.sessionId.cookie = (char *)field[3];
+      params->creds.sessionId.key = (char *)field[4];
+   }
+   params->specType = request->args[2];
+   if (params->specType == VIXDISKLIB_SPEC_VSTORAGE_OBJECT) {
+      params->spec.vStorageObjSpec.id = (char *)field[5];
+      params->spec.vStorageObjSpec.datastoreMoRef = (char *)field[6];
+      params->spec.vStorageObjSpec.ssId = (char *)field[7];
+   } else {
+      params->vmxSpec = (char *)field[5];
+   }
+   params->port = (uint32)request->args[3];
+   params->nfcHostPort = (uint32)(request->args[3] >> 32);
+
+   err = JConnCache_Connect(params, request->args[0] != 0, field[8],
+                            field[9], conn);
+   if (err == VIX_OK && !JDiskdAdd(client, (uint64)(size_t)*conn, FALSE)) {
+      JConnCache_Disconnect(*conn);
+      err = VIX_E_OUT_OF_MEMORY;
+   }
+
+   /*
+    * The strings belong to the payload.
+    */
+   memset(params, 0, sizeof *params);
+   VixDiskLib_FreeConnectParams(params);
+   return err;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdGetInfo --
+ *
+ *      GetInfo command.
+ *
+ * Results:
+ *      VixError; the length of the reply payload in "length".
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static VixError
+JDiskdGetInfo(VixDiskLibHandle disk,   // IN
+              char *reply,             // OUT
+              uint32 *length)          // OUT
+{
+   VixDiskLibInfo *info = NULL;
+   JDiskdInfo remoteInfo;
+   VixError err;
+
+   err = VixDiskLib_GetInfo(disk, &info);
+   if (err != VIX_OK) {
+      return err;
+   }
+   memset(&remoteInfo, 0, sizeof remoteInfo);
+   remoteInfo.biosGeo[0] = info->biosGeo.cylinders;
+   remoteInfo.biosGeo[1] = info->biosGeo.heads;
+   remoteInfo.biosGeo[2] = info->biosGeo.sectors;
+   remoteInfo.physGeo[0] = info->physGeo.cylinders;
+   remoteInfo.physGeo[1] = info->physGeo.heads;
+   remoteInfo.physGeo[2] = info->physGeo.sectors;
+   remoteInfo.capacity = info->capacity;
+   remoteInfo.adapterType = info->adapterType;
+   remoteInfo.numLinks = info->numLinks;
+   remoteInfo.logicalSectorSize = info->logicalSectorSize;
+   remoteInfo.physicalSectorSize = info->physicalSectorSize;
+   memcpy(reply, &remoteInfo, sizeof remoteInfo);
+   *length = sizeof remoteInfo;
+   if (!JDiskd_PutString(reply, JDISKD_MAX_PAYLOAD, length,
+                         info->parentFileNameHint) ||
+       !JDiskd_PutString(reply, JDISKD_MAX_PAYLOAD, length, info->uuid)) {
+      err = VIX_E_BUFFER_TOOSMALL;
+   }
+   VixDiskLib_FreeInfo(info);
+   return err;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdQueryBlocks --
+ *
+ *      QueryBlocks command: write as many blocks as fit in the slot, and
+ *      where to resume if they do not all fit.
+ *
+ * Results:
+ *      VixError.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static VixError
+JDiskdQueryBlocks(JDiskdClient *client,           // IN
+                  VixDiskLibHandle disk,          // IN
+                  const JDiskdRequest *request,   // IN
+                  int64 *count,                   // OUT
+                  int64 *resume)                  // OUT
+{
+   VixDiskLibBlockList *list = NULL;
+   uint64 *out;
+   uint32 max = client->slotSize / 16;
+   uint32 i;
+   VixError err;
+
+   if (request->args[3] < 0 || request->args[3] >= client->slots) {
+      return VIX_E_INVALID_ARG;
+   }
+   err = VixDiskLib_QueryAllocatedBlocks(disk, request->args[0],
+                                         request->args[1], request->args[2],
+                                         &list);
+   if (err != VIX_OK) {
+      return err;
+   }
+   out = (uint64 *)(client->region +
+                    (uint64)request->args[3] * client->slotSize);
+   *count = list->numBlocks < max ? list->numBlocks : max;
+   for (i = 0; i < *count; i++) {
+      out[2 * i] = list->blocks[i].offset;
+      out[2 * i + 1] = list->blocks[i].length;
+   }
+   *resume = list->numBlocks > max ? (int64)list->blocks[max].offset : 0;
+   VixDiskLib_FreeBlockList(list);
+   return VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdRead --
+ *
+ *      Read command: read into the slot, the reply is sent on completion.
+ *
+ * Results:
+ *      VIX_ASYNC, or an error to reply with.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static VixError
+JDiskdRead(JDiskdClient *client,           // IN
+           JDiskdHandle *disk,             // IN
+           const JDiskdRequest *request)   // IN
+{
+   JDiskdPendingRead *pending;
+   VixError err;
+
+   if (request->args[2] < 0 || request->args[2] >= client->slots ||
+       request->args[1] <= 0 ||
+       request->args[1] > client->slotSize / VIXDISKLIB_SECTOR_SIZE) {
+      return VIX_E_INVALID_ARG;
+   }
+   pending = malloc(sizeof *pending);
+   if (pending == NULL) {
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   pending->client = client;
+   pending->disk = disk;
+   pending->id = request->id;
+   pthread_mutex_lock(&client->lock);
+   disk->inflight++;
+   client->inflight++;
+   pthread_mutex_unlock(&client->lock);
+
+   err = VixDiskLib_ReadAsync((VixDiskLibHandle)(size_t)disk->handle,
+                              request->args[0], request->args[1],
+                              client->region + (uint64)request->args[2] *
+                                 client->slotSize,
+                              JDiskdReadDone, pending);
+   if (err != VIX_OK && err != VIX_ASYNC) {
+      JDiskdReadDone(pending, err);
+   }
+   return VIX_ASYNC;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdMetadata --
+ *
+ *      GetMetadataKeys and ReadMetadata commands.
+ *
+ * Results:
+ *      VixError; the length of the reply payload in "length".
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static VixError
+JDiskdMetadata(VixDiskLibHandle disk,           // IN
+               const JDiskdRequest *request,    // IN
+               const char *payload,             // IN
+               char *reply,                     // OUT
+               uint32 *length)                  // OUT
+{
+   const char *key = NULL;
+   size_t required = 0;
+   uint32 pos = 0;
+   VixError err;
+
+   if (request->op == JDiskdOpReadMetadata) {
+      if (!JDiskd_GetString(payload, request->length, &pos, &key) ||
+          key == NULL) {
+         return VIX_E_INVALID_ARG;
+      }
+      err = VixDiskLib_ReadMetadata(disk, key, NULL, 0, &required);
+   } else {
+      err = VixDiskLib_GetMetadataKeys(disk, NULL, 0, &required);
+   }
+   if (err != VIX_E_BUFFER_TOOSMALL && err != VIX_OK) {
+      return err;
+   }
+   if (required > JDISKD_MAX_PAYLOAD) {
+      return VIX_E_BUFFER_TOOSMALL;
+   }
+   if (key != NULL) {
+      err = VixDiskLib_ReadMetadata(disk, key, reply, required, NULL);
+   } else {
+      err = VixDiskLib_GetMetadataKeys(disk, reply, required, NULL);
+   }
+   *length = required;
+   return err;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdDispatch --
+ *
+ *      Run a command and reply to it, except for reads that reply on
+ *      completion.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JDiskdDispatch(JDiskdClient *client,           // IN
+               const JDiskdRequest *request,   // IN
+               const char *payload,            // IN
+               char *reply)                    // OUT: scratch
+{
+   JDiskdHandle *entry = NULL;
+   VixDiskLibHandle disk = NULL;
+   int64 values[2] = { 0, 0 };
+   uint32 length = 0;
+   VixError err = VIX_OK;
+
+   switch (request->op) {
+   case JDiskdOpDisconnect:
+   case JDiskdOpOpen:
+      entry = JDiskdFind(client, request->handle, FALSE);
+      if (entry == NULL) {
+         err = VIX_E_INVALID_ARG;
+      }
+      break;
+   case JDiskdOpConnect:
+   case JDiskdOpGetStats:
+      break;
+   default:
+      entry = JDiskdFind(client, request->handle, TRUE);
+      if (entry == NULL) {
+         err = VIX_E_INVALID_ARG;
+      } else {
+         disk = (VixDiskLibHandle)(size_t)entry->handle;
+      }
+      break;
+   }
+
+   if (err == VIX_OK) {
+      switch (request->op) {
+      case JDiskdOpConnect: {
+         VixDiskLibConnection conn = NULL;
+
+         err = JDiskdConnect(client, request, payload, &conn);
+         values[0] = (int64)(size_t)conn;
+         break;
+      }
+      case JDiskdOpDisconnect:
+         err = JConnCache_Disconnect((VixDiskLibConnection)(size_t)
+                                     entry->handle);
+         JDiskdRemove(client, entry);
+         break;
+      case JDiskdOpOpen: {
+         const char *path = NULL;
+         uint32 pos = 0;
+         Bool reused;
+
+         if (!JDiskd_GetString(payload, request->length, &pos, &path)) {
+            err = VIX_E_INVALID_ARG;
+            break;
+         }
+         err = JConnCache_Open((VixDiskLibConnection)(size_t)entry->handle,
+                               path, (uint32)request->args[0], &disk,
+                               &reused);
+         if (err == VIX_OK && !JDiskdAdd(client, (uint64)(size_t)disk,
+                                         TRUE)) {
+            JConnCache_Close(disk);
+            err = VIX_E_OUT_OF_MEMORY;
+         }
+         if (err == VIX_OK) {
+            values[0] = (int64)(size_t)disk;
+            pthread_mutex_lock(&gLock);
+            gOpenDisks++;
+            pthread_mutex_unlock(&gLock);
+         }
+         break;
+      }
+      case JDiskdOpClose:
+         JDiskdPump(client, entry, TRUE);
+         err = JConnCache_Close(disk);
+         JDiskdRemove(client, entry);
+         pthread_mutex_lock(&gLock);
+         gOpenDisks--;
+         pthread_mutex_unlock(&gLock);
+         break;
+      case JDiskdOpGetInfo:
+         err = JDiskdGetInfo(disk, reply, &length);
+         break;
+      case JDiskdOpGetTransportMode:
+         if (!JDiskd_PutString(reply, JDISKD_MAX_PAYLOAD, &length,
+                               VixDiskLib_GetTransportMode(disk))) {
+            err = VIX_E_BUFFER_TOOSMALL;
+         }
+         break;
+      case JDiskdOpQueryBlocks:
+         err = JDiskdQueryBlocks(client, disk, request, &values[0],
+                                 &values[1]);
+         break;
+      case JDiskdOpRead:
+         err = JDiskdRead(client, entry, request);
+         break;
+      case JDiskdOpGetMetadataKeys:
+      case JDiskdOpReadMetadata:
+         err = JDiskdMetadata(disk, request, payload, reply, &length);
+         break;
+      case JDiskdOpReadAllMetadata: {
+         char *packed;
+         size_t size;
+
+         err = JMetadata_ReadAll(disk, &packed, &size, NULL);
+         if (err == VIX_OK) {
+            if (size > JDISKD_MAX_PAYLOAD) {
+               err = VIX_E_BUFFER_TOOSMALL;
+            } else {
+               memcpy(reply, packed, size);
+               length = size;
+            }
+            free(packed);
+         }
+         break;
+      }
+      case JDiskdOpGetStats: {
+         int64 cache[JConnCacheStatCount];
+         int64 stats[JDiskdStatCount - JDiskdStatClients];
+
+         JConnCache_GetStats(cache);
+         pthread_mutex_lock(&gLock);
+         stats[0] = gClientCount;
+         stats[3] = gOpenDisks;
+         pthread_mutex_unlock(&gLock);
+         stats[1] = cache[JConnCacheStatConnects];
+         stats[2] = cache[JConnCacheStatConnectHits];
+         memcpy(reply, stats, sizeof stats);
+         length = sizeof stats;
+         break;
+      }
+      default:
+         err = VIX_E_NOT_SUPPORTED;
+         break;
+      }
+   }
+   if (err != VIX_ASYNC) {
+      JDiskdSendReply(client, request->id, err, values[0], values[1],
+                      err == VIX_OK ? reply : NULL, length);
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdHello --
+ *
+ *      First command of a client: check the version and map the slots.
+ *
+ * Results:
+ *      TRUE if the client can go on.
+ *
+ * Side effects:
+ *      Replies to the client.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JDiskdHello(JDiskdClient *client,   // IN/OUT
+            char *payload)          // IN: scratch
+{
+   JDiskdRequest request;
+   VixError err = VIX_OK;
+   int fd = -1;
+   int n;
+
+   n = JDiskd_Receive(client->sock, &request, sizeof request, payload, &fd);
+   if (n < (int)sizeof request || request.op != JDiskdOpHello ||
+       request.args[0] != JDISKD_MAGIC) {
+      err = VIX_E_INVALID_ARG;
+   } else if (request.args[1] != JDISKD_VERSION) {
+      err = VIX_E_NOT_SUPPORTED;
+   } else if (fd < 0 || request.args[2] <= 0 ||
+              request.args[2] > JDISKD_MAX_SLOTS || request.args[3] <= 0 ||
+              request.args[3] % VIXDISKLIB_SECTOR_SIZE != 0) {
+      err = VIX_E_INVALID_ARG;
+   } else {
+      /* An unsealed region could be shrunk under the mapping: SIGBUS */
+      int seals = fcntl(fd, F_GET_SEALS);
+      struct stat st;
+
+      client->slots = request.args[2];
+      client->slotSize = request.args[3];
+      client->regionSize = (uint64)client->slots * client->slotSize;
+      if (seals < 0 || !(seals & F_SEAL_SHRINK) || fstat(fd, &st) != 0 ||
+          (uint64)st.st_size < client->regionSize) {
+         err = VIX_E_INVALID_ARG;
+      } else {
+         client->region = mmap(NULL, client->regionSize,
+                               PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+         if (client->region == MAP_FAILED) {
+            client->region = NULL;
+            err = VIX_E_OUT_OF_MEMORY;
+         }
+      }
+   }
+   if (fd >= 0) {
+      close(fd);
+   }
+   JDiskdSendReply(client, n >= (int)sizeof request ? request.id : 0, err, 0,
+                   0, NULL, 0);
+   return err == VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdServe --
+ *
+ *      Client thread: run the commands until the client goes away, then
+ *      release what it left open.
+ *
+ * Results:
+ *      NULL.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void *
+JDiskdServe(void *data)   // IN
+{
+   JDiskdClient *client = data;
+   char *payload = malloc(JDISKD_MAX_PAYLOAD);
+   char *reply = malloc(JDISKD_MAX_PAYLOAD);
+
+   if (payload != NULL && reply != NULL && JDiskdHello(client, payload)) {
+      while (!gStop) {
+         struct pollfd pfd = { client->sock, POLLIN, 0 };
+         JDiskdRequest request;
+         int inflight;
+         int n;
+
+         pthread_mutex_lock(&client->lock);
+         inflight = client->inflight;
+         pthread_mutex_unlock(&client->lock);
+         n = poll(&pfd, 1, inflight > 0 ? WAIT_PUMP_TIMEOUT_MS : 1000);
+         if (n == 0) {
+            if (inflight > 0) {
+               JDiskdPump(client, NULL, FALSE);
+            }
+            continue;
+         }
+         if (n < 0 && errno == EINTR) {
+            continue;
+         }
+         n = JDiskd_Receive(client->sock, &request, sizeof request, payload,
+                            NULL);
+         if (n < (int)sizeof request ||
+             request.length != (uint32)(n - sizeof request)) {
+            break;
+         }
+         JDiskdDispatch(client, &request, payload, reply);
+      }
+   }
+
+   JDiskdPump(client, NULL, TRUE);
+   while (client->handles != NULL) {
+      JDiskdHandle *entry = client->handles;
+
+      /*
+       * Disks were opened after their connection, so they come first.
+       */
+      if (entry->disk) {
+         JConnCache_Close((VixDiskLibHandle)(size_t)entry->handle);
+         pthread_mutex_lock(&gLock);
+         gOpenDisks--;
+         pthread_mutex_unlock(&gLock);
+      } else {
+         JConnCache_Disconnect((VixDiskLibConnection)(size_t)entry->handle);
+      }
+      JDiskdRemove(client, entry);
+   }
+   if (client->region != NULL) {
+      munmap(client->region, client->regionSize);
+   }
+   free(payload);
+   free(reply);
+   pthread_mutex_lock(&gLock);
+   client->finished = TRUE;
+   gClientCount--;
+   pthread_mutex_unlock(&gLock);
+   return NULL;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JDiskdReap --
+ *
+ *      Join the client threads that finished, or all of them.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JDiskdReap(Bool all)   // IN
+{
+   JDiskdClient **link = &gClients;
+
+   while (*link != NULL) {
+      JDiskdClient *client = *link;
+      Bool finished;
+
+      pthread_mutex_lock(&gLock);
+      finished = client->finished;
+      pthread_mutex_unlock(&gLock);
+      if (all && !finished) {
+         shutdown(client->sock, SHUT_RDWR);
+      }
+      if (all || finished) {
+         pthread_join(client->thread, NULL);
+         *link = client->next;
+         close(client->sock);
+         pthread_mutex_destroy(&client->lock);
+         pthread_cond_destroy(&client->cond);
+         free(client);
+      } else {
+         link = &client->next;
+      }
+   }
+}
+
+
+static void
+JDiskdUsage(void)
+{
+   fprintf(stderr, "usage: jdiskd [-s socket] [-l libDir] [-c configFile] "
+           "[-v major.minor]\n"
+           "              [-i idleSeconds] [-a maxAgeSeconds] "
+           "[-h idleHandles] [-m mode]\n");
+   exit(2);
+}
+
+
+int
+main(int argc,      // IN
+     char **argv)   // IN
+{
+   const char *socketPath = JDISKD_DEFAULT_SOCKET;
+   const char *libDir = NULL;
+   const char *configFile = NULL;
+   unsigned major = 7;
+   unsigned minor = 0;
+   uint32 idleSeconds = 300;
+   uint32 maxAgeSeconds = 1800;
+   uint32 idleHandles = JCONNCACHE_DEFAULT_MAX_IDLE_HANDLES;
+   mode_t mode = 0660;
+   struct sockaddr_un addr;
+   struct sigaction sa;
+   VixError err;
+   int listener;
+   int opt;
+
+   while ((opt = getopt(argc, argv, "s:l:c:v:i:a:h:m:")) != -1) {
+      switch (opt) {
+      case 's':
+         socketPath = optarg;
+         break;
+      case 'l':
+         libDir = optarg;
+         break;
+      case 'c':
+         configFile = optarg;
+         break;
+      case 'v':
+         if (sscanf(optarg, "%u.%u", &major, &minor) != 2) {
+            JDiskdUsage();
+         }
+         break;
+      case 'i':
+         idleSeconds = strtoul(optarg, NULL, 10);
+         break;
+      case 'a':
+         maxAgeSeconds = strtoul(optarg, NULL, 10);
+         break;
+      case 'h':
+         idleHandles = strtoul(optarg, NULL, 10);
+         break;
+      case 'm':
+         mode = strtoul(optarg, NULL, 8);
+         break;
+      default:
+         JDiskdUsage();
+      }
+   }
+   if (strlen(socketPath) >= sizeof addr.sun_path) {
+      JDiskdUsage();
+   }
+
+   memset(&sa, 0, sizeof sa);
+   sa.sa_handler = JDiskdStop;
+   sigaction(SIGTERM, &sa, NULL);
+   sigaction(SIGINT, &sa, NULL);
+   signal(SIGPIPE, SIG_IGN);
+
+   err = JVddk_Load(libDir, major, minor);
+   if (err != VIX_OK) {
+      fprintf(stderr, LGPFX "Cannot load VixDiskLib: %s\n", JVddk_LoadError());
+      return 1;
+   }
+   err = VixDiskLib_InitEx(major, minor, JDiskdLog, JDiskdLog, JDiskdPanic,
+                           libDir, configFile);
+   if (err != VIX_OK) {
+      fprintf(stderr, LGPFX "VixDiskLib_InitEx failed: %s\n",
+              VixDiskLib_GetErrorText(err, NULL));
+      return 1;
+   }
+   JConnCache_Configure(idleSeconds, maxAgeSeconds, idleHandles);
+
+   listener = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+   memset(&addr, 0, sizeof addr);
+   addr.sun_family = AF_UNIX;
+   strcpy(addr.sun_path, socketPath);
+   unlink(socketPath);
+   if (listener < 0 ||
+       bind(listener, (struct sockaddr *)&addr, sizeof addr) != 0 ||
+       chmod(socketPath, mode) != 0 || listen(listener, 16) != 0) {
+      fprintf(stderr, LGPFX "cannot listen on %s: %s\n", socketPath,
+              strerror(errno));
+      JConnCache_Shutdown();
+      VixDiskLib_Exit();
+      return 1;
+   }
+   fprintf(stderr, LGPFX "listening on %s\n", socketPath);
+
+   while (!gStop) {
+      struct pollfd pfd = { listener, POLLIN, 0 };
+      JDiskdClient *client;
+      int sock;
+
+      JDiskdReap(FALSE);
+      if (poll(&pfd, 1, 1000) <= 0) {
+         continue;
+      }
+      sock = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+      if (sock < 0) {
+         continue;
+      }
+      client = calloc(1, sizeof *client);
+      if (client == NULL) {
+         close(sock);
+         continue;
+      }
+      client->sock = sock;
+      pthread_mutex_init(&client->lock, NULL);
+      pthread_cond_init(&client->cond, NULL);
+      pthread_mutex_lock(&gLock);
+      gClientCount++;
+      pthread_mutex_unlock(&gLock);
+      if (pthread_create(&client->thread, NULL, JDiskdServe, client) != 0) {
+         pthread_mutex_lock(&gLock);
+         gClientCount--;
+         pthread_mutex_unlock(&gLock);
+         close(sock);
+         free(client);
+         continue;
+      }
+      client->next = gClients;
+      gClients = client;
+   }
+
+   fprintf(stderr, LGPFX "stopping\n");
+   close(listener);
+   unlink(socketPath);
+   JDiskdReap(TRUE);
+   JConnCache_Shutdown();
+   VixDiskLib_Exit();
+   return 0;
+}
@@ -0,0 +1,134 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jEntropy.c
+ *
+ *    Sampled byte-entropy estimator.
+ *
+ *    Compressed or encrypted data has an order-0 entropy close to 8 bits
+ *    per byte, and deflate cannot gain anything on it. A histogram of a few
+ *    kilobytes spread over the block is enough to tell such data apart, at
+ *    a small fraction of the cost of compressing it.
+ *
+ *    The histogram is kept in four interleaved tables so that consecutive
+ *    bytes with the same value do not serialize on the same counter; the
+ *    tables are summed once at the end.
+ */
+
+#include <string.h>
+#include <math.h>
+#include "jEntropy.h"
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JEntropyCount --
+ *
+ *      Add "length" bytes to the histogram.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JEntropyCount(const uint8 *buf,          // IN
+              size_t length,             // IN
+              uint32 counts[4][256])     // IN/OUT
+{
+   size_t i = 0;
+
+   for (; i + 8 <= length; i += 8) {
+      uint64 word;
+
+      memcpy(&word, buf + i, sizeof word);
+      counts[0][(uint8)word]++;
+      counts[1][(uint8)(word >> 8)]++;
+      counts[2][(uint8)(word >> 16)]++;
+      counts[3][(uint8)(word >> 24)]++;
+      counts[0][(uint8)(word >> 32)]++;
+      counts[1][(uint8)(word >> 40)]++;
+      counts[2][(uint8)(word >> 48)]++;
+      counts[3][(uint8)(word >> 56)]++;
+   }
+   for (; i < length; i++) {
+      counts[0][buf[i]]++;
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JEntropy_Estimate --
+ *
+ *      Estimate the entropy of a buffer from a sample of its bytes. The
+ *      sample is made of runs of JENTROPY_RUN_SIZE bytes evenly spread over
+ *      the buffer, the whole buffer is used if it is not larger than the
+ *      sample.
+ *
+ * Results:
+ *      Entropy in thousandths of a bit per byte, 0 for an empty buffer.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+int
+JEntropy_Estimate(const uint8 *buf,      // IN
+                  size_t length,         // IN
+                  size_t sampleSize)     // IN
+{
+   uint32 counts[4][256];
+   size_t sampled = 0;
+   double sum = 0;
+   double entropy;
+   int i;
+
+   if (buf == NULL || length == 0) {
+      return 0;
+   }
+   if (sampleSize == 0) {
+      sampleSize = JENTROPY_DEFAULT_SAMPLE_SIZE;
+   }
+   if (sampleSize < JENTROPY_RUN_SIZE) {
+      sampleSize = JENTROPY_RUN_SIZE;
+   }
+
+   memset(counts, 0, sizeof counts);
+   if (length <= sampleSize) {
+      JEntropyCount(buf, length, counts);
+      sampled = length;
+   } else {
+      size_t runs = sampleSize / JENTROPY_RUN_SIZE;
+      size_t stride = (length - JENTROPY_RUN_SIZE) / (runs > 1 ? runs - 1 : 1);
+      size_t r;
+
+      for (r = 0; r < runs; r++) {
+         JEntropyCount(buf + r * stride, JENTROPY_RUN_SIZE, counts);
+      }
+      sampled = runs * JENTROPY_RUN_SIZE;
+   }
+
+   for (i = 0; i < 256; i++) {
+      uint32 c = counts[0][i] + counts[1][i] + counts[2][i] + counts[3][i];
+
+      if (c != 0) {
+         sum += c * log2((double)c);
+      }
+   }
+   entropy = log2((double)sampled) - sum / sampled;
+   if (entropy < 0) {
+      entropy = 0;
+   }
+   return (int)(entropy * 1000 + 0.5);
+}
@@ -0,0 +1,1323 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jGuestFs.c
+ *
+ *    Read-only reader of the ext2/3/4 filesystems of an archived disk, for
+ *    file-level restore without restoring the disk.
+ *
+ *    The partition table (MBR with its logical partitions, or GPT) is read
+ *    to locate the filesystem. Files are mapped through their extent tree,
+ *    or through the block map of ext2/3 inodes, and directories are parsed
+ *    linearly, which also covers hashed directories since their index
+ *    blocks are hidden in empty entries. Inline data is read from the
+ *    inode. The journal is not replayed: the disk is read as archived,
+ *    like a crash-consistent snapshot.
+ *
+ *    Every read goes through the block cache of the archived disk, so only
+ *    the archived blocks holding the metadata walked and the files read
+ *    are ever fetched and decoded.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "jGuestFs.h"
+
+#define MAX_PARTITIONS 128
+
+#define MBR_SIGNATURE_OFFSET 510
+#define MBR_TABLE_OFFSET 446
+#define MBR_TYPE_GPT 0xee
+#define GPT_SIGNATURE "EFI PART"
+
+#define EXT_SUPERBLOCK_OFFSET 1024
+#define EXT_SUPERBLOCK_SIZE 1024
+#define EXT_MAGIC 0xef53
+#define EXT_GOOD_OLD_INODE_SIZE 128
+#define EXT_MIN_DESC_SIZE 32
+#define EXT_MIN_DESC_SIZE_64BIT 64
+#define EXT_N_BLOCKS_SIZE 60
+#define EXT_NDIR_BLOCKS 12
+#define EXT_MAX_EXTENT_DEPTH 5
+
+#define EXT_INCOMPAT_FILETYPE 0x0002
+#define EXT_INCOMPAT_RECOVER 0x0004
+#define EXT_INCOMPAT_EXTENTS 0x0040
+#define EXT_INCOMPAT_64BIT 0x0080
+#define EXT_INCOMPAT_MMP 0x0100
+#define EXT_INCOMPAT_FLEX_BG 0x0200
+#define EXT_INCOMPAT_EA_INODE 0x0400
+#define EXT_INCOMPAT_CSUM_SEED 0x2000
+#define EXT_INCOMPAT_LARGEDIR 0x4000
+#define EXT_INCOMPAT_INLINE_DATA 0x8000
+
+/*
+ * Meta block groups, journal devices and encryption are not supported.
+ */
+#define EXT_INCOMPAT_SUPPORTED                                          \
+   (EXT_INCOMPAT_FILETYPE | EXT_INCOMPAT_RECOVER | EXT_INCOMPAT_EXTENTS | \
+    EXT_INCOMPAT_64BIT | EXT_INCOMPAT_MMP | EXT_INCOMPAT_FLEX_BG |        \
+    EXT_INCOMPAT_EA_INODE | EXT_INCOMPAT_CSUM_SEED |                      \
+    EXT_INCOMPAT_LARGEDIR | EXT_INCOMPAT_INLINE_DATA)
+
+#define EXT_HUGE_FILE_FL 0x00040000
+#define EXT_EXTENTS_FL 0x00080000
+#define EXT_INLINE_DATA_FL 0x10000000
+
+#define EXT_EXTENT_MAGIC 0xf30a
+#define EXT_EXTENT_HEADER_SIZE 12
+#define EXT_EXTENT_ENTRY_SIZE 12
+#define EXT_EXTENT_MAX_LENGTH 32768
+
+#define EXT_DIRENT_HEADER_SIZE 8
+
+/*
+ * A directory is never walked past this size: a 3 level htree of 4 KB
+ * blocks holds a few hundred million entries well below it.
+ */
+#define EXT_MAX_DIR_SIZE ((int64)1 << 32)
+
+#define EXT_XATTR_MAGIC 0xea020000
+#define EXT_XATTR_ENTRY_SIZE 16
+#define EXT_XATTR_INDEX_SYSTEM 7
+
+#define S_IFMT_MASK 0xf000
+#define S_IFREG_BITS 0x8000
+#define S_IFDIR_BITS 0x4000
+#define S_IFLNK_BITS 0xa000
+
+
+struct JGuestFs {
+   JGuestFsReadFunc read;
+   void *disk;
+   int64 base;                /* Offset of the filesystem on the disk */
+   uint32 blockSize;
+   uint32 inodeSize;
+   uint32 inodesCount;
+   uint32 inodesPerGroup;
+   uint32 groupCount;
+   uint32 incompat;
+   uint64 *inodeTables;       /* First block of the inode table of a group */
+};
+
+typedef struct JGuestFsInode {
+   uint32 number;
+   uint32 mode;
+   uint32 uid;
+   uint32 gid;
+   uint32 flags;
+   int64 size;
+   int64 allocated;           /* Bytes of the blocks of the inode, i_blocks */
+   int64 mtime;
+   uint8 block[EXT_N_BLOCKS_SIZE];
+} JGuestFsInode;
+
+/*
+ * Called for each directory entry, before its inode is read.
+ */
+typedef Bool (*JGuestFsDirentFunc)(void *data, const char *name,
+                                   size_t nameLength, uint32 inode);
+
+typedef struct JGuestFsFindData {
+   const char *name;
+   size_t nameLength;
+   uint32 inode;
+} JGuestFsFindData;
+
+typedef struct JGuestFsListData {
+   JGuestFs *fs;
+   JGuestFsListFunc func;
+   void *data;
+   Bool failed;
+} JGuestFsListData;
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JGuestFsGet16 / JGuestFsGet32 / JGuestFsGet64 --
+ *
+ *      Read a little endian integer.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static uint32
+JGuestFsGet16(const uint8 *p) // IN
+{
+   return p[0] | ((uint32)p[1] << 8);
+}
+
+static uint32
+JGuestFsGet32(const uint8 *p) // IN
+{
+   return p[0] | ((uint32)p[1] << 8) | ((uint32)p[2] << 16) |
+          ((uint32)p[3] << 24);
+}
+
+static uint64
+JGuestFsGet64(const uint8 *p) // IN
+{
+   return JGuestFsGet32(p) | ((uint64)JGuestFsGet32(p + 4) << 32);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JGuestFsListPartitions --
+ *
+ *      Read the partition table of the disk.
+ *
+ * Results:
+ *      Number of partitions found and their byte offsets, -1 if the disk
+ *      has no partition table, -2 if it cannot be read.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static int
+JGuestFsListPartitions(JGuestFsReadFunc read,   // IN
+                       void *disk,              // IN
+                       int64 *starts)           // OUT: MAX_PARTITIONS
+{
+   uint8 sector[VIXDISKLIB_SECTOR_SIZE];
+   int64 extended = 0;
+   int count = 0;
+   int i;
+
+   if (!read(disk, 0, sizeof sector, sector)) {
+      return -2;
+   }
+   if (sector[MBR_SIGNATURE_OFFSET] != 0x55 ||
+       sector[MBR_SIGNATURE_OFFSET + 1] != 0xaa) {
+      return -1;
+   }
+   for (i = 0; i < 4; i++) {
+      const uint8 *entry = sector + MBR_TABLE_OFFSET + 16 * i;
+      uint8 type = entry[4];
+      uint32 lba = JGuestFsGet32(entry + 8);
+
+      if (type == MBR_TYPE_GPT) {
+         uint8 header[VIXDISKLIB_SECTOR_SIZE];
+         uint8 gpt[128];
+         uint64 table;
+         uint32 entries;
+         uint32 entrySize;
+         uint32 j;
+
+         if (!read(disk, VIXDISKLIB_SECTOR_SIZE, sizeof header, header)) {
+            return -2;
+         }
+         if (memcmp(header, GPT_SIGNATURE, 8) != 0) {
+            return -1;
+         }
+         table = JGuestFsGet64(header + 72);
+         entries = JGuestFsGet32(header + 80);
+         entrySize = JGuestFsGet32(header + 84);
+         if (entrySize < 48 || entrySize > sizeof gpt) {
+            entrySize = sizeof gpt;
+         }
+         for (j = 0; j < entries && count < MAX_PARTITIONS; j++) {
+            static const uint8 unused[16];
+
+            if (!read(disk, table * VIXDISKLIB_SECTOR_SIZE +
+                      (int64)j * entrySize, 48, gpt)) {
+               break;
+            }
+            if (memcmp(gpt, unused, sizeof unused) != 0) {
+               starts[count++] = (int64)JGuestFsGet64(gpt + 32) *
+                                 VIXDISKLIB_SECTOR_SIZE;
+            }
+         }
+         return count;
+      }
+      if (type == 0x05 || type == 0x0f || type == 0x85) {
+         extended = lba;
+      } else if (type != 0 && lba != 0) {
+         starts[count++] = (int64)lba * VIXDISKLIB_SECTOR_SIZE;
+      }
+   }
+
+   /*
+    * Logical partitions, chained by their extended boot records.
+    */
+   if (extended != 0) {
+      int64 ebr = extended;
+
+      for (i = 0; i < MAX_PARTITIONS && count < MAX_PARTITIONS; i++) {
+         const uint8 *first = sector + MBR_TABLE_OFFSET;
+         const uint8 *next = first + 16;
+
+         if (!read(disk, ebr * VIXDISKLIB_SECTOR_SIZE, sizeof sector,
+                   sector) ||
+             sector[MBR_SIGNATURE_OFFSET] != 0x55 ||
+             sector[MBR_SIGNATURE_OFFSET + 1] != 0xaa) {
+            break;
+         }
+         if (first[4] != 0) {
+            starts[count++] = (ebr + JGuestFsGet32(first + 8)) *
+                              VIXDISKLIB_SECTOR_SIZE;
+         }
+         if (next[4] != 0x05 && next[4] != 0x0f && next[4] != 0x85) {
+            break;
+         }
+         ebr = extended + JGuestFsGet32(next + 8);
+      }
+   }
+   return count;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JGuestFsReadDisk --
+ *
+ *      Read bytes of the filesystem.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JGuestFsReadDisk(const JGuestFs *fs,  // IN
+                 uint64 offset,       // IN
+                 size_t length,       // IN
+                 void *buf)           // OUT
+{
+   return fs->read(fs->disk, fs->base + (int64)offset, length, buf);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JGuestFsMount --
+ *
+ *      Read the superblock and the group descriptors of the filesystem at
+ *      fs->base.
+ *
+ * Results:
+ *      VIX_OK, VIX_E_NOT_SUPPORTED, VIX_E_DISK_INVAL or VIX_E_OUT_OF_MEMORY.
+ *
+ * Side effects:
+ *      Fills fs.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static VixError
+JGuestFsMount(JGuestFs *fs) // IN/OUT
+{
+   uint8 sb[EXT_SUPERBLOCK_SIZE];
+   uint8 *descs;
+   uint32 logBlockSize;
+   uint32 firstDataBlock;
+   uint32 descSize = EXT_MIN_DESC_SIZE;
+   uint32 g;
+
+   if (!JGuestFsReadDisk(fs, EXT_SUPERBLOCK_OFFSET, sizeof sb, sb)) {
+      return VIX_E_DISK_INVAL;
+   }
+   if (JGuestFsGet16(sb + 56) != EXT_MAGIC) {
+      return VIX_E_NOT_SUPPORTED;
+   }
+   fs->inodesCount = JGuestFsGet32(sb);
+   firstDataBlock = JGuestFsGet32(sb + 20);
+   logBlockSize = JGuestFsGet32(sb + 24);
+   fs->inodesPerGroup = JGuestFsGet32(sb + 40);
+   fs->inodeSize = JGuestFsGet32(sb + 76) == 0 ? EXT_GOOD_OLD_INODE_SIZE
+                                                : JGuestFsGet16(sb + 88);
+   fs->incompat = JGuestFsGet32(sb + 96);
+   if (fs->incompat & EXT_INCOMPAT_64BIT) {
+      descSize = JGuestFsGet16(sb + 254);
+      if (descSize < EXT_MIN_DESC_SIZE_64BIT) {
+         descSize = EXT_MIN_DESC_SIZE_64BIT;
+      }
+   }
+   if ((fs->incompat & ~EXT_INCOMPAT_SUPPORTED) != 0 || logBlockSize > 6 ||
+       fs->inodesPerGroup == 0 || fs->inodeSize < EXT_GOOD_OLD_INODE_SIZE) {
+      return VIX_E_NOT_SUPPORTED;
+   }
+   fs->blockSize = 1024 << logBlockSize;
+   if (fs->inodeSize > fs->blockSize) {
+      return VIX_E_NOT_SUPPORTED;
+   }
+   fs->groupCount = (fs->inodesCount + fs->inodesPerGroup - 1) /
+                    fs->inodesPerGroup;
+
+   descs = malloc((size_t)fs->groupCount * descSize + 1);
+   fs->inodeTables = calloc(fs->groupCount + 1, sizeof *fs->inodeTables);
+   if (descs == NULL || fs->inodeTables == NULL) {
+      free(descs);
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   if (!JGuestFsReadDisk(fs, (uint64)(firstDataBlock + 1) * fs->blockSize,
+                         (size_t)fs->groupCount * descSize, descs)) {
+      free(descs);
+      return VIX_E_DISK_INVAL;
+   }
+   for (g = 0; g < fs->groupCount; g++) {
+      const uint8 *desc = descs + (size_t)g * descSize;
+
+      fs->inodeTables[g] = JGuestFsGet32(desc + 8);
+      if (descSize >= EXT_MIN_DESC_SIZE_64BIT) {
+         fs->inodeTables[g] |= (uint64)JGuestFsGet32(desc + 0x28) << 32;
+      }
+   }
+   free(descs);
+   return VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JGuestFsReadInode --
+ *
+ *      Read an inode.
+ *
+ * Results:
+ *      FALSE if the inode number is invalid or the inode cannot be read.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JGuestFsReadInode(const JGuestFs *fs,       // IN
+                  uint32 number,            // IN
+                  JGuestFsInode *inode)     // OUT
+{
+   uint8 raw[EXT_GOOD_OLD_INODE_SIZE];
+   uint32 group;
+   uint32 index;
+   uint64 size;
+   uint64 blocks;
+
+   if (number == 0 || number > fs->inodesCount) {
+      return FALSE;
+   }
+   group = (number - 1) / fs->inodesPerGroup;
+   index = (number - 1) % fs->inodesPerGroup;
+   if (!JGuestFsReadDisk(fs, fs->inodeTables[group] * fs->blockSize +
+                         (uint64)index * fs->inodeSize, sizeof raw, raw)) {
+      return FALSE;
+   }
+   inode->number = number;
+   inode->mode = JGuestFsGet16(raw);
+   inode->uid = JGuestFsGet16(raw + 2) | (JGuestFsGet16(raw + 120) << 16);
+   inode->gid = JGuestFsGet16(raw + 24) | (JGuestFsGet16(raw + 122) << 16);
+   inode->mtime = JGuestFsGet32(raw + 16);
+   inode->flags = JGuestFsGet32(raw + 32);
+   memcpy(inode->block, raw + 40, EXT_N_BLOCKS_SIZE);
+
+   size = JGuestFsGet32(raw + 4) | ((uint64)JGuestFsGet32(raw + 108) << 32);
+   /* 48 bits of 512 byte sectors, or of blocks for a huge file */
+   blocks = JGuestFsGet32(raw + 28) | ((uint64)JGuestFsGet16(raw + 116) << 32);
+   blocks *= (inode->flags & EXT_HUGE_FILE_FL) ? fs->blockSize : 512;
+   if (size > (uint64)MAX_INT64) {
+      return FALSE;
+   }
+   inode->size = (int64)size;
+   inode->allocated = (int64)blocks;
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JGuestFsMapExtent --
+ *
+ *      Map a logical block of an inode through its extent tree.
+ *
+ * Results:
+ *      FALSE on a corrupt tree. Otherwise the physical block, 0 for a hole
+ *      or an uninitialized extent, and the number of blocks mapped the
+ *      same way from there.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JGuestFsMapExtent(const JGuestFs *fs,          // IN
+                  const JGuestFsInode *inode,  // IN
+                  uint64 lblock,               // IN
+                  uint64 *pblock,              // OUT
+                  uint64 *count)               // OUT
+{
+   const uint8 *node = inode->block;
+   size_t nodeSize = EXT_N_BLOCKS_SIZE;
+   uint8 *buf = NULL;
+   Bool ok = FALSE;
+   int level;
+
+   *pblock = 0;
+   *count = UINT32_MAX;
+   for (level = 0; level <= EXT_MAX_EXTENT_DEPTH; level++) {
+      uint32 entries = JGuestFsGet16(node + 2);
+      uint32 depth = JGuestFsGet16(node + 6);
+      const uint8 *e = node + EXT_EXTENT_HEADER_SIZE;
+      const uint8 *found = NULL;
+      uint32 i;
+
+      if (JGuestFsGet16(node) != EXT_EXTENT_MAGIC ||
+          EXT_EXTENT_HEADER_SIZE + entries * EXT_EXTENT_ENTRY_SIZE > nodeSize) {
+         break;
+      }
+      if (depth == 0) {
+         for (i = 0; i < entries; i++, e += EXT_EXTENT_ENTRY_SIZE) {
+            uint32 first = JGuestFsGet32(e);
+            uint32 length = JGuestFsGet16(e + 4);
+            Bool uninit = length > EXT_EXTENT_MAX_LENGTH;
+
+            if (uninit) {
+               length -= EXT_EXTENT_MAX_LENGTH;
+            }
+            if (lblock < first) {
+               *count = first - lblock;
+               break;
+            }
+            if (lblock < (uint64)first + length) {
+               if (!uninit) {
+                  *pblock = (((uint64)JGuestFsGet16(e + 6) << 32) |
+                             JGuestFsGet32(e + 8)) + (lblock - first);
+               }
+               *count = (uint64)first + length - lblock;
+               break;
+            }
+         }
+         ok = TRUE;
+         break;
+      }
+
+      for (i = 0; i < entries; i++, e += EXT_EXTENT_ENTRY_SIZE) {
+         if (JGuestFsGet32(e) > lblock) {
+            break;
+         }
+         found = e;
+      }
+      if (found == NULL) {
+         /* Hole before the first index */
+         if (entries > 0) {
+            *count = JGuestFsGet32(node + EXT_EXTENT_HEADER_SIZE) - lblock;
+         }
+         ok = TRUE;
+         break;
+      }
+      if (buf == NULL) {
+         buf = malloc(fs->blockSize);
+         if (buf == NULL) {
+            break;
+         }
+      }
+      if (!JGuestFsReadDisk(fs, (JGuestFsGet32(found + 4) |
+                                 ((uint64)JGuestFsGet16(found + 8) << 32)) *
+                                fs->blockSize, fs->blockSize, buf)) {
+         break;
+      }
+      node = buf;
+      nodeSize = fs->blockSize;
+   }
+   free(buf);
+   return ok;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JGuestFsMapIndirect --
+ *
+ *      Map a logical block of an inode through its ext2/3 block map.
+ *
+ * Results:
+ *      FALSE if an indirect block cannot be read. Otherwise the physical
+ *      block, 0 for a hole, and a count of 1.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JGuestFsMapIndirect(const JGuestFs *fs,          // IN
+                    const JGuestFsInode *inode,  // IN
+                    uint64 lblock,               // IN
+                    uint64 *pblock,              // OUT
+                    uint64 *count)               // OUT
+{
+   uint64 perBlock = fs->blockSize / 4;
+   uint64 span = 1;
+   uint32 ptr;
+   int levels;
+
+   *count = 1;
+   if (lblock < EXT_NDIR_BLOCKS) {
+      *pblock = JGuestFsGet32(inode->block + 4 * lblock);
+      return TRUE;
+   }
+   lblock -= EXT_NDIR_BLOCKS;
+   for (levels = 1; levels <= 3; levels++) {
+      span *= perBlock;
+      if (lblock < span) {
+         break;
+      }
+      lblock -= span;
+   }
+   if (levels > 3) {
+      return FALSE;
+   }
+   ptr = JGuestFsGet32(inode->block + 4 * (EXT_NDIR_BLOCKS + levels - 1));
+   while (levels-- > 0 && ptr != 0) {
+      uint8 raw[4];
+
+      span /= perBlock;
+      if (!JGuestFsReadDisk(fs, (uint64)ptr * fs->blockSize +
+                            (lblock / span) * 4, sizeof raw, raw)) {
+         return FALSE;
+      }
+      ptr = JGuestFsGet32(raw);
+      lblock %= span;
+   }
+   *pblock = ptr;
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JGuestFsReadInlineTail --
+ *
+ *      Read the part of the inline data of an inode that does not fit in
+ *      i_block, kept in its "system.data" extended attribute in the inode.
+ *
+ * Results:
+ *      FALSE if the inode cannot be read or is out of memory. Otherwise a
+ *      malloc'ed buffer, NULL if there is no such attribute, and its size.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JGuestFsReadInlineTail(const JGuestFs *fs,          // IN
+                       const JGuestFsInode *inode,  // IN
+                       uint8 **tail,                // OUT
+                       size_t *length)              // OUT
+{
+   uint32 group = (inode->number - 1) / fs->inodesPerGroup;
+   uint32 index = (inode->number - 1) % fs->inodesPerGroup;
+   size_t start;
+   size_t pos;
+   uint8 *raw;
+
+   *tail = NULL;
+   *length = 0;
+   if (fs->inodeSize <= EXT_GOOD_OLD_INODE_SIZE + 2) {
+      return TRUE;
+   }
+   raw = malloc(fs->inodeSize);
+   if (raw == NULL ||
+       !JGuestFsReadDisk(fs, fs->inodeTables[group] * fs->blockSize +
+                         (uint64)index * fs->inodeSize, fs->inodeSize, raw)) {
+      free(raw);
+      return FALSE;
+   }
+   start = EXT_GOOD_OLD_INODE_SIZE +
+           JGuestFsGet16(raw + EXT_GOOD_OLD_INODE_SIZE);
+   if (start + 4 > fs->inodeSize ||
+       JGuestFsGet32(raw + start) != EXT_XATTR_MAGIC) {
+      free(raw);
+      return TRUE;
+   }
+   start += 4;
+   for (pos = start; pos + EXT_XATTR_ENTRY_SIZE <= fs->inodeSize &&
+                     JGuestFsGet32(raw + pos) != 0;
+        pos += (EXT_XATTR_ENTRY_SIZE + raw[pos] + 3) & ~3) {
+      const uint8 *e = raw + pos;
+      size_t valueOffset = start + JGuestFsGet16(e + 2);
+      size_t valueSize = JGuestFsGet32(e + 8);
+
+      if (e[1] == EXT_XATTR_INDEX_SYSTEM && e[0] == 4 &&
+          pos + EXT_XATTR_ENTRY_SIZE + 4 <= fs->inodeSize &&
+          memcmp(e + EXT_XATTR_ENTRY_SIZE, "data", 4) == 0 &&
+          JGuestFsGet32(e + 4) == 0 && valueOffset <= fs->inodeSize &&
+          valueSize <= fs->inodeSize - valueOffset) {
+         *tail = malloc(valueSize > 0 ? valueSize : 1);
+         if (*tail == NULL) {
+            free(raw);
+            return FALSE;
+         }
+         memcpy(*tail, raw + valueOffset, valueSize);
+         *length = valueSize;
+         break;
+      }
+   }
+   free(raw);
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JGuestFsReadData --
+ *
+ *      Read the data of an inode.
+ *
+ * Results:
+ *      Bytes read, 0 at the end of the file, -1 on error.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static int64
+JGuestFsReadData(const JGuestFs *fs,          // IN
+                 const JGuestFsInode *inode,  // IN
+                 int64 offset,                // IN
+                 uint8 *buf,                  // OUT
+                 size_t length)               // IN
+{
+   Bool fastSymlink = (inode->mode & S_IFMT_MASK) == S_IFLNK_BITS &&
+                      inode->size < EXT_N_BLOCKS_SIZE &&
+                      !(inode->flags & EXT_EXTENTS_FL);
+   size_t done = 0;
+
+   if (offset < 0) {
+      return -1;
+   }
+   if (offset >= inode->size) {
+      return 0;
+   }
+   if ((int64)length > inode->size - offset) {
+      length = (size_t)(inode->size - offset);
+   }
+   if (fastSymlink || (inode->flags & EXT_INLINE_DATA_FL)) {
+      uint8 *tail = NULL;
+      size_t tailLength = 0;
+
+      while (done < length && offset < EXT_N_BLOCKS_SIZE) {
+         buf[done++] = inode->block[offset++];
+      }
+      if (done < length) {
+         if (fastSymlink ||
+             !JGuestFsReadInlineTail(fs, inode, &tail, &tailLength) ||
+             offset - EXT_N_BLOCKS_SIZE + (int64)(length - done) >
+                (int64)tailLength) {
+            free(tail);
+            return -1;
+         }
+         memcpy(buf + done, tail + offset - EXT_N_BLOCKS_SIZE, length - done);
+         free(tail);
+      }
+      return length;
+   }
+
+   while (done < length) {
+      uint64 lblock = (uint64)offset / fs->blockSize;
+      size_t within = (size_t)((uint64)offset % fs->blockSize);
+      uint64 maxBlocks = (length - done + within) / fs->blockSize + 1;
+      uint64 pblock;
+      uint64 count;
+      size_t n;
+      Bool ok;
+
+      if (inode->flags & EXT_EXTENTS_FL) {
+         ok = JGuestFsMapExtent(fs, inode, lblock, &pblock, &count);
+      } else {
+         ok = JGuestFsMapIndirect(fs, inode, lblock, &pblock, &count);
+      }
+      if (!ok) {
+         return -1;
+      }
+      if (count > maxBlocks) {
+         count = maxBlocks;
+      }
+      n = (size_t)(count * fs->blockSize - within);
+      if (n > length - done) {
+         n = length - done;
+      }
+      if (pblock == 0) {
+         memset(buf + done, 0, n);
+      } else if (!JGuestFsReadDisk(fs, pblock * fs->blockSize + within, n,
+                                   buf + done)) {
+         return -1;
+      }
+      done += n;
+      offset += n;
+   }
+   return done;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JGuestFsParseDirents --
+ *
+ *      Call "func" for each entry of a buffer of directory entries.
+ *
+ * Results:
+ *      FALSE if "func" stopped the walk.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JGuestFsParseDirents(const JGuestFs *fs,       // IN
+                     const uint8 *buf,         // IN
+                     size_t length,            // IN
+                     JGuestFsDirentFunc func,  // IN
+                     void *data)               // IN
+{
+   Bool fileType = (fs->incompat & EXT_INCOMPAT_FILETYPE) != 0;
+   size_t pos = 0;
+
+   while (pos + EXT_DIRENT_HEADER_SIZE <= length) {
+      const uint8 *d = buf + pos;
+      uint32 inode = JGuestFsGet32(d);
+      size_t recLength = JGuestFsGet16(d + 4);
+      size_t nameLength = fileType ? d[6] : JGuestFsGet16(d + 6);
+
+      if (recLength < EXT_DIRENT_HEADER_SIZE || recLength > length - pos) {
+         break;
+      }
+      if (inode != 0 && nameLength > 0 &&
+          nameLength <= recLength - EXT_DIRENT_HEADER_SIZE &&
+          !func(data, (const char *)d + EXT_DIRENT_HEADER_SIZE, nameLength,
+                inode)) {
+         return FALSE;
+      }
+      pos += recLength;
+   }
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JGuestFsWalk --
+ *
+ *      Call "func" for each entry of a directory, "." and ".." included.
+ *
+ * Results:
+ *      VIX_OK, VIX_E_NOT_A_DIRECTORY, VIX_E_DISK_INVAL or
+ *      VIX_E_OUT_OF_MEMORY.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static VixError
+JGuestFsWalk(JGuestFs *fs,              // IN
+             uint32 number,             // IN
+             JGuestFsDirentFunc func,   // IN
+             void *data)                // IN
+{
+   JGuestFsInode dir;
+   VixError err = VIX_OK;
+   uint8 *buf;
+   int64 offset;
+   int64 end;
+
+   if (!JGuestFsReadInode(fs, number, &dir)) {
+      return VIX_E_DISK_INVAL;
+   }
+   if ((dir.mode & S_IFMT_MASK) != S_IFDIR_BITS) {
+      return VIX_E_NOT_A_DIRECTORY;
+   }
+   if (dir.flags & EXT_INLINE_DATA_FL) {
+      size_t length;
+
+      if (!JGuestFsReadInlineTail(fs, &dir, &buf, &length)) {
+         return VIX_E_DISK_INVAL;
+      }
+      /* Parent inode, then the entries */
+      if (func(data, "..", 2, JGuestFsGet32(dir.block)) &&
+          JGuestFsParseDirents(fs, dir.block + 4, EXT_N_BLOCKS_SIZE - 4, func,
+                               data) && buf != NULL) {
+         JGuestFsParseDirents(fs, buf, length, func, data);
+      }
+      free(buf);
+      return VIX_OK;
+   }
+
+   /*
+    * A corrupt size must not make the walk loop over the whole address
+    * space: the blocks of a directory are all allocated.
+    */
+   end = dir.size < dir.allocated ? dir.size : dir.allocated;
+   if (end > EXT_MAX_DIR_SIZE) {
+      end = EXT_MAX_DIR_SIZE;
+   }
+   buf = malloc(fs->blockSize);
+   if (buf == NULL) {
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   for (offset = 0; offset < end; offset += fs->blockSize) {
+      uint64 lblock = (uint64)offset / fs->blockSize;
+      uint64 pblock;
+      uint64 count;
+      Bool ok;
+
+      if (dir.flags & EXT_EXTENTS_FL) {
+         ok = JGuestFsMapExtent(fs, &dir, lblock, &pblock, &count);
+      } else {
+         ok = JGuestFsMapIndirect(fs, &dir, lblock, &pblock, &count);
+      }
+      if (!ok) {
+         err = VIX_E_DISK_INVAL;
+         break;
+      }
+      /* An unmapped block ends the directory */
+      if (pblock == 0 ||
+          !JGuestFsReadDisk(fs, pblock * fs->blockSize, fs->blockSize, buf) ||
+          !JGuestFsParseDirents(fs, buf, fs->blockSize, func, data)) {
+         break;
+      }
+   }
+   free(buf);
+   return err;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JGuestFsStat --
+ *
+ *      Fill an entry from its inode.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JGuestFsStat(const JGuestFsInode *inode,  // IN
+             JGuestFsEntry *entry)        // OUT
+{
+   static const JGuestFsType types[16] = {
+      [0x1] = JGuestFsFifo,
+      [0x2] = JGuestFsCharDevice,
+      [0x4] = JGuestFsDirectory,
+      [0x6] = JGuestFsBlockDevice,
+      [0x8] = JGuestFsFile,
+      [0xa] = JGuestFsSymlink,
+      [0xc] = JGuestFsSocket,
+   };
+
+   entry->inode = inode->number;
+   entry->type = types[(inode->mode & S_IFMT_MASK) >> 12];
+   entry->mode = inode->mode;
+   entry->uid = inode->uid;
+   entry->gid = inode->gid;
+   entry->size = inode->size;
+   entry->mtime = inode->mtime;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JGuestFsFindCB --
+ *
+ *      Directory walk callback looking for an entry by name.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JGuestFsFindCB(void *data,           // IN: JGuestFsFindData
+               const char *name,     // IN
+               size_t nameLength,    // IN
+               uint32 inode)         // IN
+{
+   JGuestFsFindData *find = data;
+
+   if (nameLength == find->nameLength &&
+       memcmp(name, find->name, nameLength) == 0) {
+      find->inode = inode;
+      return FALSE;
+   }
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JGuestFsListCB --
+ *
+ *      Directory walk callback reading the inode of each entry for
+ *      JGuestFs_List.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JGuestFsListCB(void *data,           // IN: JGuestFsListData
+               const char *name,     // IN
+               size_t nameLength,    // IN
+               uint32 number)        // IN
+{
+   JGuestFsListData *list = data;
+   JGuestFsInode inode;
+   JGuestFsEntry entry;
+
+   if ((nameLength == 1 && name[0] == '.') ||
+       (nameLength == 2 && name[0] == '.' && name[1] == '.')) {
+      return TRUE;
+   }
+   if (!JGuestFsReadInode(list->fs, number, &inode)) {
+      list->failed = TRUE;
+      return FALSE;
+   }
+   memset(&entry, 0, sizeof entry);
+   memcpy(entry.name, name, nameLength);
+   JGuestFsStat(&inode, &entry);
+   return list->func(list->data, &entry);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JGuestFs_Open --
+ *
+ *      Open the filesystem of a partition. See jGuestFs.h.
+ *
+ * Results:
+ *      VixError.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JGuestFs_Open(JGuestFsReadFunc read,  // IN
+              void *disk,            // IN
+              int partition,         // IN
+              JGuestFs **result)     // OUT
+{
+   int64 starts[MAX_PARTITIONS];
+   VixError err = VIX_E_NOT_SUPPORTED;
+   JGuestFs *fs;
+   int count;
+   int i;
+
+   *result = NULL;
+   count = JGuestFsListPartitions(read, disk, starts);
+   if (count == -2) {
+      return VIX_E_DISK_INVAL;
+   }
+   if (count == -1) {
+      /* Not partitioned */
+      starts[0] = 0;
+      count = 1;
+   }
+   if (partition >= count) {
+      return VIX_E_DISK_INVALIDPARTITIONTABLE;
+   }
+
+   for (i = partition >= 0 ? partition : 0; i < count; i++) {
+      fs = calloc(1, sizeof *fs);
+      if (fs == NULL) {
+         return VIX_E_OUT_OF_MEMORY;
+      }
+      fs->read = read;
+      fs->disk = disk;
+      fs->base = starts[i];
+      err = JGuestFsMount(fs);
+      if (err == VIX_OK) {
+         *result = fs;
+         return VIX_OK;
+      }
+      JGuestFs_Close(fs);
+      if (partition >= 0 || err == VIX_E_OUT_OF_MEMORY) {
+         break;
+      }
+   }
+   return err;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JGuestFs_Lookup --
+ *
+ *      Resolve a path. See jGuestFs.h.
+ *
+ * Results:
+ *      VixError.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JGuestFs_Lookup(JGuestFs *fs,            // IN
+                const char *path,        // IN
+                JGuestFsEntry *entry)    // OUT
+{
+   JGuestFsInode inode;
+   const char *p = path;
+   const char *last = "/";
+   size_t lastLength = 1;
+
+   if (!JGuestFsReadInode(fs, JGUESTFS_ROOT_INODE, &inode)) {
+      return VIX_E_DISK_INVAL;
+   }
+   while (*p != '\0') {
+      JGuestFsFindData find;
+      VixError err;
+      size_t n;
+
+      while (*p == '/') {
+         p++;
+      }
+      n = strcspn(p, "/");
+      if (n == 0) {
+         break;
+      }
+      if (n > JGUESTFS_NAME_MAX) {
+         return VIX_E_FILE_NOT_FOUND;
+      }
+      find.name = p;
+      find.nameLength = n;
+      find.inode = 0;
+      err = JGuestFsWalk(fs, inode.number, JGuestFsFindCB, &find);
+      if (err != VIX_OK) {
+         return err;
+      }
+      if (find.inode == 0) {
+         return VIX_E_FILE_NOT_FOUND;
+      }
+      if (!JGuestFsReadInode(fs, find.inode, &inode)) {
+         return VIX_E_DISK_INVAL;
+      }
+      last = p;
+      lastLength = n;
+      p += n;
+   }
+
+   memset(entry, 0, sizeof *entry);
+   memcpy(entry->name, last, lastLength);
+   JGuestFsStat(&inode, entry);
+   return VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JGuestFs_List --
+ *
+ *      List a directory. See jGuestFs.h.
+ *
+ * Results:
+ *      VixError.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JGuestFs_List(JGuestFs *fs,             // IN
+              uint32 inode,             // IN
+              JGuestFsListFunc func,    // IN
+              void *data)               // IN
+{
+   JGuestFsListData list = { fs, func, data, FALSE };
+   VixError err;
+
+   err = JGuestFsWalk(fs, inode, JGuestFsListCB, &list);
+   if (err == VIX_OK && list.failed) {
+      err = VIX_E_DISK_INVAL;
+   }
+   return err;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JGuestFs_Read --
+ *
+ *      Read a file. See jGuestFs.h.
+ *
+ * Results:
+ *      Bytes read, 0 at the end of the file, -1 on error.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+int64
+JGuestFs_Read(JGuestFs *fs,      // IN
+              uint32 number,     // IN
+              int64 offset,      // IN
+              uint8 *buf,        // OUT
+              size_t length)     // IN
+{
+   JGuestFsInode inode;
+
+   if (!JGuestFsReadInode(fs, number, &inode)) {
+      return -1;
+   }
+   return JGuestFsReadData(fs, &inode, offset, buf, length);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JGuestFs_Map --
+ *
+ *      Report where the data of a file is on the disk. See jGuestFs.h.
+ *
+ * Results:
+ *      VIX_OK, or VIX_E_DISK_INVAL if the inode or its block map cannot
+ *      be read.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JGuestFs_Map(JGuestFs *fs,             // IN
+             uint32 number,            // IN
+             JGuestFsMapFunc func,     // IN
+             void *data)               // IN
+{
+   JGuestFsInode inode;
+   uint64 blocks;
+   uint64 lblock = 0;
+   uint64 runFile = 0;
+   uint64 runDisk = 0;
+   uint64 runBlocks = 0;
+
+   if (!JGuestFsReadInode(fs, number, &inode)) {
+      return VIX_E_DISK_INVAL;
+   }
+   if ((inode.flags & EXT_INLINE_DATA_FL) ||
+       ((inode.mode & S_IFMT_MASK) == S_IFLNK_BITS &&
+        inode.size < EXT_N_BLOCKS_SIZE && !(inode.flags & EXT_EXTENTS_FL))) {
+      return VIX_OK;
+   }
+
+   blocks = ((uint64)inode.size + fs->blockSize - 1) / fs->blockSize;
+   while (lblock < blocks) {
+      uint64 pblock;
+      uint64 count;
+      Bool ok;
+
+      if (inode.flags & EXT_EXTENTS_FL) {
+         ok = JGuestFsMapExtent(fs, &inode, lblock, &pblock, &count);
+      } else {
+         ok = JGuestFsMapIndirect(fs, &inode, lblock, &pblock, &count);
+      }
+      if (!ok) {
+         return VIX_E_DISK_INVAL;
+      }
+      if (count > blocks - lblock) {
+         count = blocks - lblock;
+      }
+
+      /*
+       * Runs contiguous on both sides are merged, the indirect block map
+       * being read one block at a time.
+       */
+      if (runBlocks > 0 &&
+          (pblock == 0 || pblock != runDisk + runBlocks)) {
+         int64 length = (int64)(runBlocks * fs->blockSize);
+
+         if ((int64)(runFile * fs->blockSize) + length > inode.size) {
+            length = inode.size - (int64)(runFile * fs->blockSize);
+         }
+         if (!func(data, (int64)(runFile * fs->blockSize),
+                   fs->base + (int64)(runDisk * fs->blockSize), length)) {
+            return VIX_OK;
+         }
+         runBlocks = 0;
+      }
+      if (pblock != 0) {
+         if (runBlocks == 0) {
+            runFile = lblock;
+            runDisk = pblock;
+         }
+         runBlocks += count;
+      }
+      lblock += count;
+   }
+   if (runBlocks > 0) {
+      int64 length = (int64)(runBlocks * fs->blockSize);
+
+      if ((int64)(runFile * fs->blockSize) + length > inode.size) {
+         length = inode.size - (int64)(runFile * fs->blockSize);
+      }
+      func(data, (int64)(runFile * fs->blockSize),
+           fs->base + (int64)(runDisk * fs->blockSize), length);
+   }
+   return VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JGuestFs_Close --
+ *
+ *      Release a filesystem. The disk is left open.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JGuestFs_Close(JGuestFs *fs) // IN
+{
+   if (fs != NULL) {
+      free(fs->inodeTables);
+      free(fs);
+   }
+}
@@ -0,0 +1,745 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jIoScheduler.c
+ *
+ *    Priority-aware I/O scheduler shared by all the disk handles of the
+ *    process.
+ *
+ *    Requests of every backup and restore job wait per priority class,
+ *    ordered by job deadline then arrival, for one of the maxInFlight
+ *    slots, so a restore never waits behind a deep queue of backup reads:
+ *
+ *    - strict policy: the highest non-empty class is always served first;
+ *    - weighted policy: start-time fair queuing on bytes, each class
+ *      getting a share proportional to its weight;
+ *    - a request whose job is past its deadline preempts both policies.
+ *
+ *    The scheduler only grants slots: the thread that submitted a request
+ *    issues VixDiskLib_ReadAsync/WriteAsync itself once granted, and is the
+ *    only one to call VixDiskLib_Wait on its disk handle. While waiting for
+ *    a slot, a caller with requests in flight on its handle pumps it, since
+ *    some transports only deliver completions from there and its own
+ *    requests may be the ones holding the slots. Reads of jdiskd disks go
+ *    to the daemon.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "vixDiskLib.h"
+#include "jIoScheduler.h"
+#include "jDiskd.h"
+
+#define NO_DEADLINE ((uint64)-1)
+
+
+typedef struct JIoJob {
+   int64 id;
+   JIoClass ioClass;
+   uint64 deadlineUs;
+   struct JIoJob *next;
+} JIoJob;
+
+/*
+ * A disk handle with requests queued or in flight.
+ */
+typedef struct JIoDisk {
+   VixDiskLibHandle handle;
+   uint32 refs;                 /* Requests queued or in flight */
+   uint32 inFlight;
+   struct JIoDisk *next;
+} JIoDisk;
+
+typedef struct JIoRequest {
+   JIoClass ioClass;
+   uint64 deadlineUs;
+   uint32 numSectors;
+   JIoDisk *disk;
+   Bool granted;
+   VixDiskLibCompletionCB callback;
+   void *cbData;
+   struct JIoRequest *next;
+} JIoRequest;
+
+/*
+ * State of a synchronous JIoSched_Transfer call.
+ */
+typedef struct JIoWaiter {
+   Bool done;
+   VixError result;
+} JIoWaiter;
+
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gGrant = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t gDone = PTHREAD_COND_INITIALIZER;
+static Bool gStopping = FALSE;
+
+static JIoPolicy gPolicy = JIoPolicyWeighted;
+static uint32 gMaxInFlight = JIOSCHED_DEFAULT_MAX_IN_FLIGHT;
+static uint32 gWeights[JIoClassCount] = {
+   JIOSCHED_DEFAULT_WEIGHT_INTERACTIVE,
+   JIOSCHED_DEFAULT_WEIGHT_NORMAL,
+   JIOSCHED_DEFAULT_WEIGHT_BACKGROUND,
+};
+
+static JIoJob *gJobs = NULL;
+static JIoDisk *gDisks = NULL;
+static JIoRequest *gQueues[JIoClassCount];
+static double gClassTime[JIoClassCount];  /* Virtual start time per class */
+static double gVirtualTime = 0;
+static uint32 gInFlight = 0;
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JIoSchedNowUs --
+ *
+ *      Read the monotonic clock.
+ *
+ * Results:
+ *      Current time in microseconds.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static uint64
+JIoSchedNowUs(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JIoSchedEnqueue --
+ *
+ *      Insert a request in its class queue, ordered by deadline then
+ *      arrival. Must be called with gLock held.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JIoSchedEnqueue(JIoRequest *req) // IN
+{
+   JIoRequest **link = &gQueues[req->ioClass];
+
+   /*
+    * A class that was idle must not bank the share it did not use.
+    */
+   if (*link == NULL && gClassTime[req->ioClass] < gVirtualTime) {
+      gClassTime[req->ioClass] = gVirtualTime;
+   }
+   while (*link != NULL && (*link)->deadlineUs <= req->deadlineUs) {
+      link = &(*link)->next;
+   }
+   req->next = *link;
+   *link = req;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JIoSchedPick --
+ *
+ *      Take the next request to grant a slot out of the queues. Must be
+ *      called with gLock held.
+ *
+ * Results:
+ *      The request or NULL if all queues are empty.
+ *
+ * Side effects:
+ *      Advances the virtual time of the chosen class.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static JIoRequest *
+JIoSchedPick(void)
+{
+   uint64 nowUs = JIoSchedNowUs();
+   int chosen = -1;
+   int i;
+   JIoRequest *req;
+
+   /*
+    * Overdue jobs first, earliest deadline wins.
+    */
+   for (i = 0; i < JIoClassCount; i++) {
+      req = gQueues[i];
+      if (req != NULL && req->deadlineUs <= nowUs &&
+          (chosen < 0 || req->deadlineUs < gQueues[chosen]->deadlineUs)) {
+         chosen = i;
+      }
+   }
+
+   for (i = 0; chosen < 0 && i < JIoClassCount; i++) {
+      if (gQueues[i] == NULL) {
+         continue;
+      }
+      if (gPolicy == JIoPolicyStrict) {
+         chosen = i;
+      } else {
+         int j;
+
+         chosen = i;
+         for (j = i + 1; j < JIoClassCount; j++) {
+            if (gQueues[j] != NULL && gClassTime[j] < gClassTime[chosen]) {
+               chosen = j;
+            }
+         }
+      }
+   }
+   if (chosen < 0) {
+      return NULL;
+   }
+
+   req = gQueues[chosen];
+   gQueues[chosen] = req->next;
+   gVirtualTime = gClassTime[chosen];
+   gClassTime[chosen] += (double)req->numSectors / gWeights[chosen];
+   return req;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JIoSchedGrant --
+ *
+ *      Grant the free slots to the queued requests. Must be called with
+ *      gLock held.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Wakes up the callers of the granted requests.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JIoSchedGrant(void)
+{
+   Bool granted = FALSE;
+
+   while (gInFlight < gMaxInFlight) {
+      JIoRequest *req = JIoSchedPick();
+
+      if (req == NULL) {
+         break;
+      }
+      req->granted = TRUE;
+      req->disk->inFlight++;
+      gInFlight++;
+      granted = TRUE;
+   }
+   if (granted) {
+      pthread_cond_broadcast(&gGrant);
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JIoSchedGetDisk --
+ *
+ *      Find or add the entry of a disk handle and take a reference on it.
+ *      Must be called with gLock held.
+ *
+ * Results:
+ *      The entry, NULL if out of memory.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static JIoDisk *
+JIoSchedGetDisk(VixDiskLibHandle diskHandle) // IN
+{
+   JIoDisk *disk;
+
+   for (disk = gDisks; disk != NULL && disk->handle != diskHandle;
+        disk = disk->next) {
+   }
+   if (disk == NULL) {
+      disk = calloc(1, sizeof *disk);
+      if (disk == NULL) {
+         return NULL;
+      }
+      disk->handle = diskHandle;
+      disk->next = gDisks;
+      gDisks = disk;
+   }
+   disk->refs++;
+   return disk;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JIoSchedPutDisk --
+ *
+ *      Drop a reference on a disk entry. Must be called with gLock held.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Frees the entry with its last reference.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JIoSchedPutDisk(JIoDisk *disk) // IN
+{
+   JIoDisk **link;
+
+   if (--disk->refs > 0) {
+      return;
+   }
+   for (link = &gDisks; *link != disk; link = &(*link)->next) {
+   }
+   *link = disk->next;
+   free(disk);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JIoSchedRelease --
+ *
+ *      Give back the slot of a granted request.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Frees the request, grants the slot to the next one.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JIoSchedRelease(JIoRequest *req) // IN
+{
+   pthread_mutex_lock(&gLock);
+   gInFlight--;
+   req->disk->inFlight--;
+   JIoSchedPutDisk(req->disk);
+   JIoSchedGrant();
+   pthread_mutex_unlock(&gLock);
+   free(req);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JIoSchedCompletionCB --
+ *
+ *      VixDiskLibCompletionCB of the granted requests.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Releases the slot, calls the user callback.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JIoSchedCompletionCB(void *cbData,    // IN
+                     VixError result) // IN
+{
+   JIoRequest *req = cbData;
+   VixDiskLibCompletionCB callback = req->callback;
+   void *userData = req->cbData;
+
+   JIoSchedRelease(req);
+   if (callback != NULL) {
+      callback(userData, result);
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JIoSchedWaiterCB --
+ *
+ *      Completion callback of the synchronous requests.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Wakes up JIoSched_Transfer.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JIoSchedWaiterCB(void *cbData,    // IN
+                 VixError result) // IN
+{
+   JIoWaiter *waiter = cbData;
+
+   pthread_mutex_lock(&gLock);
+   waiter->result = result;
+   waiter->done = TRUE;
+   pthread_cond_broadcast(&gDone);
+   pthread_mutex_unlock(&gLock);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JIoSchedPump --
+ *
+ *      Wait for the async requests of a disk handle to complete.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Calls the completion callbacks of the handle.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JIoSchedPump(VixDiskLibHandle diskHandle) // IN
+{
+   if (JDiskd_IsRemote(diskHandle)) {
+      JDiskd_Wait(diskHandle);
+   } else {
+      VixDiskLib_Wait(diskHandle);
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JIoSched_Configure --
+ *
+ *      Change scheduling policy, dispatch depth and class weights.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Applies to the requests not granted yet.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JIoSched_Configure(JIoPolicy policy,                    // IN
+                   uint32 maxInFlight,                  // IN
+                   const uint32 weights[JIoClassCount]) // IN
+{
+   int i;
+
+   pthread_mutex_lock(&gLock);
+   gPolicy = policy;
+   gMaxInFlight = maxInFlight > 0 ? maxInFlight : 1;
+   for (i = 0; weights != NULL && i < JIoClassCount; i++) {
+      gWeights[i] = weights[i] > 0 ? weights[i] : 1;
+   }
+   JIoSchedGrant();
+   pthread_mutex_unlock(&gLock);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JIoSched_RegisterJob --
+ *
+ *      Declare or update a job.
+ *
+ * Results:
+ *      TRUE on success, FALSE if out of memory.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+Bool
+JIoSched_RegisterJob(int64 jobId,       // IN
+                     JIoClass ioClass,  // IN
+                     uint64 deadlineMs) // IN
+{
+   JIoJob *job;
+
+   if (ioClass < JIoClassInteractive || ioClass >= JIoClassCount) {
+      ioClass = JIoClassNormal;
+   }
+   pthread_mutex_lock(&gLock);
+   for (job = gJobs; job != NULL && job->id != jobId; job = job->next) {
+   }
+   if (job == NULL) {
+      job = malloc(sizeof *job);
+      if (job == NULL) {
+         pthread_mutex_unlock(&gLock);
+         return FALSE;
+      }
+      job->id = jobId;
+      job->next = gJobs;
+      gJobs = job;
+   }
+   job->ioClass = ioClass;
+   job->deadlineUs = deadlineMs > 0 ? JIoSchedNowUs() + deadlineMs * 1000 :
+                                      NO_DEADLINE;
+   pthread_mutex_unlock(&gLock);
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JIoSched_UnregisterJob --
+ *
+ *      Forget a job. Its queued requests keep their class and deadline.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Frees memory.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JIoSched_UnregisterJob(int64 jobId) // IN
+{
+   JIoJob **link;
+
+   pthread_mutex_lock(&gLock);
+   for (link = &gJobs; *link != NULL; link = &(*link)->next) {
+      if ((*link)->id == jobId) {
+         JIoJob *job = *link;
+
+         *link = job->next;
+         free(job);
+         break;
+      }
+   }
+   pthread_mutex_unlock(&gLock);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JIoSched_Submit --
+ *
+ *      Wait for a slot, then issue an async read or write from the calling
+ *      thread.
+ *
+ * Results:
+ *      VIX_ASYNC on success, VIX_E_OUT_OF_MEMORY, VIX_E_CANCELLED or the
+ *      error of VixDiskLib_ReadAsync/WriteAsync.
+ *
+ * Side effects:
+ *      Blocks until granted. May call VixDiskLib_Wait on diskHandle. The
+ *      callback is called once the request completes, only if VIX_ASYNC
+ *      is returned.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JIoSched_Submit(int64 jobId,                       // IN
+                VixDiskLibHandle diskHandle,       // IN
+                Bool write,                        // IN
+                VixDiskLibSectorType startSector,  // IN
+                uint32 numSectors,                 // IN
+                uint8 *buf,                        // IN/OUT
+                VixDiskLibCompletionCB callback,   // IN
+                void *cbData)                      // IN
+{
+   JIoRequest *req;
+   JIoJob *job;
+   VixError result;
+
+   req = calloc(1, sizeof *req);
+   if (req == NULL) {
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   req->numSectors = numSectors;
+   req->callback = callback;
+   req->cbData = cbData;
+
+   pthread_mutex_lock(&gLock);
+   if (gStopping) {
+      pthread_mutex_unlock(&gLock);
+      free(req);
+      return VIX_E_CANCELLED;
+   }
+   req->disk = JIoSchedGetDisk(diskHandle);
+   if (req->disk == NULL) {
+      pthread_mutex_unlock(&gLock);
+      free(req);
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   for (job = gJobs; job != NULL && job->id != jobId; job = job->next) {
+   }
+   req->ioClass = job != NULL ? job->ioClass : JIoClassNormal;
+   req->deadlineUs = job != NULL ? job->deadlineUs : NO_DEADLINE;
+   JIoSchedEnqueue(req);
+   JIoSchedGrant();
+
+   while (!req->granted && !gStopping) {
+      if (req->disk->inFlight > 0) {
+         pthread_mutex_unlock(&gLock);
+         JIoSchedPump(diskHandle);
+         pthread_mutex_lock(&gLock);
+      } else {
+         pthread_cond_wait(&gGrant, &gLock);
+      }
+   }
+   if (!req->granted) {
+      JIoRequest **link = &gQueues[req->ioClass];
+
+      while (*link != req) {
+         link = &(*link)->next;
+      }
+      *link = req->next;
+      JIoSchedPutDisk(req->disk);
+      pthread_cond_broadcast(&gGrant);
+      pthread_mutex_unlock(&gLock);
+      free(req);
+      return VIX_E_CANCELLED;
+   }
+   pthread_mutex_unlock(&gLock);
+
+   if (JDiskd_IsRemote(diskHandle)) {
+      result = write ? VIX_E_NOT_SUPPORTED :
+               JDiskd_ReadAsync(diskHandle, startSector, numSectors, buf,
+                                JIoSchedCompletionCB, req);
+   } else if (write) {
+      result = VixDiskLib_WriteAsync(diskHandle, startSector, numSectors, buf,
+                                     JIoSchedCompletionCB, req);
+   } else {
+      result = VixDiskLib_ReadAsync(diskHandle, startSector, numSectors, buf,
+                                    JIoSchedCompletionCB, req);
+   }
+   if (result != VIX_OK && result != VIX_ASYNC) {
+      JIoSchedRelease(req);
+      return result;
+   }
+   return VIX_ASYNC;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JIoSched_Transfer --
+ *
+ *      Read or write once granted a slot, and wait for it to complete.
+ *
+ * Results:
+ *      VixError of the I/O.
+ *
+ * Side effects:
+ *      Blocks. Calls VixDiskLib_Wait on diskHandle.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JIoSched_Transfer(int64 jobId,                      // IN
+                  VixDiskLibHandle diskHandle,      // IN
+                  Bool write,                       // IN
+                  VixDiskLibSectorType startSector, // IN
+                  uint32 numSectors,                // IN
+                  uint8 *buf)                       // IN/OUT
+{
+   JIoWaiter waiter = { FALSE, VIX_OK };
+   VixError result;
+
+   result = JIoSched_Submit(jobId, diskHandle, write, startSector, numSectors,
+                            buf, JIoSchedWaiterCB, &waiter);
+   if (result != VIX_ASYNC) {
+      return result;
+   }
+
+   JIoSchedPump(diskHandle);
+   pthread_mutex_lock(&gLock);
+   while (!waiter.done) {
+      pthread_cond_wait(&gDone, &gLock);
+   }
+   pthread_mutex_unlock(&gLock);
+   return waiter.result;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JIoSched_Shutdown --
+ *
+ *      Fail the requests still waiting for a slot.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Waits for their callers to give up. Requests already granted run
+ *      to completion.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JIoSched_Shutdown(void)
+{
+   int i;
+
+   pthread_mutex_lock(&gLock);
+   gStopping = TRUE;
+   pthread_cond_broadcast(&gGrant);
+   for (i = 0; i < JIoClassCount; i++) {
+      while (gQueues[i] != NULL) {
+         pthread_cond_wait(&gGrant, &gLock);
+      }
+   }
+   gStopping = FALSE;
+   pthread_mutex_unlock(&gLock);
+}
@@ -0,0 +1,566 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jMbHash.c
+ *
+ *    Multi-buffer SHA-1 and MD5.
+ *
+ *    SHA-1 and MD5 are sequential within a buffer, but the 32-bit
+ *    operations of eight independent buffers fit in the lanes of one AVX2
+ *    register. Dump threads hash one block each at about the same time, so
+ *    their requests are queued and the first caller that sees eight of
+ *    them, or that has waited JMBHASH_GATHER_US, hashes the whole batch
+ *    while the others wait for their digest.
+ *
+ *    The buffers of a batch are processed in lockstep, 64 bytes per lane at
+ *    a time. The padding of each buffer is built in a small tail of its
+ *    own; a lane whose buffer is done hashes a zero block and its state is
+ *    taken out right after its last block.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "jMbHash.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define JMBHASH_AVX2 1
+#endif
+
+#define HASH_BLOCK_SIZE 64
+
+typedef struct JMbHashJob {
+   const uint8 *buf;
+   size_t length;
+   uint8 *digest;
+   Bool done;
+   struct JMbHashJob *next;
+} JMbHashJob;
+
+typedef struct JMbHashQueue {
+   JMbHashJob *head;
+   JMbHashJob *tail;
+   int pending;
+} JMbHashQueue;
+
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gDone = PTHREAD_COND_INITIALIZER;
+static JMbHashQueue gQueues[JMbHashCount];
+
+static Bool gSupported = FALSE;
+static pthread_once_t gInitOnce = PTHREAD_ONCE_INIT;
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JMbHashInit --
+ *
+ *      Check for AVX2.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JMbHashInit(void)
+{
+#ifdef JMBHASH_AVX2
+   __builtin_cpu_init();
+   gSupported = __builtin_cpu_supports("avx2") ? TRUE : FALSE;
+#endif
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JMbHash_IsSupported --
+ *
+ *      See jMbHash.h.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+Bool
+JMbHash_IsSupported(void)
+{
+   pthread_once(&gInitOnce, JMbHashInit);
+   return gSupported;
+}
+
+
+#ifdef JMBHASH_AVX2
+
+#define AVX2 __attribute__((target("avx2")))
+
+#define ROL(x, n) \
+   _mm256_or_si256(_mm256_slli_epi32((x), (n)), _mm256_srli_epi32((x), 32 - (n)))
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JMbHashTranspose --
+ *
+ *      Transpose an 8x8 matrix of 32-bit words.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static AVX2 void
+JMbHashTranspose(__m256i r[8]) // IN/OUT
+{
+   __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+   __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+   __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+   __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+   __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+   __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+   __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+   __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+   __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+   __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+   __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+   __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+   __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+   __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+   __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+   __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+   r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+   r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+   r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+   r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+   r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+   r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+   r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+   r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JMbHashLoad --
+ *
+ *      Load the 16 words of the current block of each lane, word i of lane
+ *      j in element j of w[i].
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static AVX2 void
+JMbHashLoad(const uint8 *blocks[JMBHASH_LANES], // IN
+            Bool bigEndian,                     // IN
+            __m256i w[16])                      // OUT
+{
+   const __m256i bswap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9,
+                                          8, 15, 14, 13, 12, 3, 2, 1, 0, 7,
+                                          6, 5, 4, 11, 10, 9, 8, 15, 14, 13,
+                                          12);
+   int half;
+   int j;
+
+   for (half = 0; half < 2; half++) {
+      __m256i *r = w + 8 * half;
+
+      for (j = 0; j < JMBHASH_LANES; j++) {
+         r[j] = _mm256_loadu_si256((const __m256i *)(blocks[j] + 32 * half));
+      }
+      JMbHashTranspose(r);
+      if (bigEndian) {
+         for (j = 0; j < 8; j++) {
+            r[j] = _mm256_shuffle_epi8(r[j], bswap);
+         }
+      }
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JMbHashSha1Block --
+ *
+ *      SHA-1 compression of one block in each lane.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Updates the state.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static AVX2 void
+JMbHashSha1Block(__m256i state[5],                     // IN/OUT
+                 const uint8 *blocks[JMBHASH_LANES])   // IN
+{
+   __m256i w[16];
+   __m256i a = state[0];
+   __m256i b = state[1];
+   __m256i c = state[2];
+   __m256i d = state[3];
+   __m256i e = state[4];
+   int t;
+
+   JMbHashLoad(blocks, TRUE, w);
+   for (t = 0; t < 80; t++) {
+      __m256i f;
+      __m256i k;
+      __m256i temp;
+
+      if (t >= 16) {
+         w[t & 15] = ROL(_mm256_xor_si256(
+                            _mm256_xor_si256(w[(t - 3) & 15], w[(t - 8) & 15]),
+                            _mm256_xor_si256(w[(t - 14) & 15], w[t & 15])), 1);
+      }
+      if (t < 20) {
+         f = _mm256_or_si256(_mm256_and_si256(b, c), _mm256_andnot_si256(b, d));
+         k = _mm256_set1_epi32(0x5a827999);
+      } else if (t < 40) {
+         f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+         k = _mm256_set1_epi32(0x6ed9eba1);
+      } else if (t < 60) {
+         f = _mm256_or_si256(_mm256_and_si256(b, c),
+                             _mm256_and_si256(d, _mm256_or_si256(b, c)));
+         k = _mm256_set1_epi32((int)0x8f1bbcdc);
+      } else {
+         f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+         k = _mm256_set1_epi32((int)0xca62c1d6);
+      }
+      temp = _mm256_add_epi32(_mm256_add_epi32(ROL(a, 5), f),
+                              _mm256_add_epi32(_mm256_add_epi32(e, k),
+                                               w[t & 15]));
+      e = d;
+      d = c;
+      c = ROL(b, 30);
+      b = a;
+      a = temp;
+   }
+   state[0] = _mm256_add_epi32(state[0], a);
+   state[1] = _mm256_add_epi32(state[1], b);
+   state[2] = _mm256_add_epi32(state[2], c);
+   state[3] = _mm256_add_epi32(state[3], d);
+   state[4] = _mm256_add_epi32(state[4], e);
+}
+
+
+static const uint32 gMd5K[64] = {
+   0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a,
+   0xa8304613, 0xfd469501, 0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+   0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821, 0xf61e2562, 0xc040b340,
+   0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+   0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8,
+   0x676f02d9, 0x8d2a4c8a, 0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+   0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70, 0x289b7ec6, 0xeaa127fa,
+   0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+   0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92,
+   0xffeff47d, 0x85845dd1, 0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+   0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+static const int gMd5S[16] = {
+   7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21,
+};
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JMbHashMd5Block --
+ *
+ *      MD5 compression of one block in each lane.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Updates the state.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static AVX2 void
+JMbHashMd5Block(__m256i state[4],                      // IN/OUT
+                const uint8 *blocks[JMBHASH_LANES])    // IN
+{
+   const __m256i ones = _mm256_set1_epi32(-1);
+   __m256i w[16];
+   __m256i a = state[0];
+   __m256i b = state[1];
+   __m256i c = state[2];
+   __m256i d = state[3];
+   int i;
+
+   JMbHashLoad(blocks, FALSE, w);
+   for (i = 0; i < 64; i++) {
+      __m256i f;
+      __m256i x;
+      int g;
+      int s = gMd5S[(i / 16) * 4 + (i & 3)];
+
+      if (i < 16) {
+         f = _mm256_or_si256(_mm256_and_si256(b, c), _mm256_andnot_si256(b, d));
+         g = i;
+      } else if (i < 32) {
+         f = _mm256_or_si256(_mm256_and_si256(d, b), _mm256_andnot_si256(d, c));
+         g = (5 * i + 1) & 15;
+      } else if (i < 48) {
+         f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+         g = (3 * i + 5) & 15;
+      } else {
+         f = _mm256_xor_si256(c, _mm256_or_si256(b, _mm256_xor_si256(d, ones)));
+         g = (7 * i) & 15;
+      }
+      x = _mm256_add_epi32(_mm256_add_epi32(a, f),
+                           _mm256_add_epi32(w[g],
+                                            _mm256_set1_epi32((int)gMd5K[i])));
+      x = _mm256_or_si256(_mm256_sll_epi32(x, _mm_cvtsi32_si128(s)),
+                          _mm256_srl_epi32(x, _mm_cvtsi32_si128(32 - s)));
+      a = d;
+      d = c;
+      c = b;
+      b = _mm256_add_epi32(b, x);
+   }
+   state[0] = _mm256_add_epi32(state[0], a);
+   state[1] = _mm256_add_epi32(state[1], b);
+   state[2] = _mm256_add_epi32(state[2], c);
+   state[3] = _mm256_add_epi32(state[3], d);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JMbHashRun --
+ *
+ *      Hash up to JMBHASH_LANES buffers together.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Fills the digest of each job.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static AVX2 void
+JMbHashRun(JMbHashAlgorithm algorithm, // IN
+           JMbHashJob **jobs,          // IN/OUT
+           int count)                  // IN
+{
+   static const uint8 zero[HASH_BLOCK_SIZE];
+   static const uint32 sha1Init[5] = {
+      0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0,
+   };
+   static const uint32 md5Init[4] = {
+      0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476,
+   };
+   Bool sha1 = algorithm == JMbHashSha1;
+   int words = sha1 ? 5 : 4;
+   uint8 tails[JMBHASH_LANES][2 * HASH_BLOCK_SIZE];
+   size_t full[JMBHASH_LANES];
+   size_t total[JMBHASH_LANES];
+   size_t maxTotal = 0;
+   const uint8 *blocks[JMBHASH_LANES];
+   __m256i state[5];
+   size_t k;
+   int j;
+   int i;
+
+   for (i = 0; i < words; i++) {
+      state[i] = _mm256_set1_epi32((int)(sha1 ? sha1Init[i] : md5Init[i]));
+   }
+   memset(tails, 0, sizeof tails);
+   for (j = 0; j < JMBHASH_LANES; j++) {
+      size_t rest;
+      uint64 bits;
+      size_t tailSize;
+
+      if (j >= count) {
+         full[j] = total[j] = 0;
+         continue;
+      }
+      full[j] = jobs[j]->length / HASH_BLOCK_SIZE;
+      rest = jobs[j]->length % HASH_BLOCK_SIZE;
+      memcpy(tails[j], jobs[j]->buf + full[j] * HASH_BLOCK_SIZE, rest);
+      tails[j][rest] = 0x80;
+      tailSize = rest + 9 <= HASH_BLOCK_SIZE ? HASH_BLOCK_SIZE
+                                             : 2 * HASH_BLOCK_SIZE;
+      bits = (uint64)jobs[j]->length * 8;
+      for (i = 0; i < 8; i++) {
+         /* SHA-1 stores the length big endian, MD5 little endian */
+         tails[j][tailSize - 1 - i] =
+            (uint8)(sha1 ? bits >> (8 * i) : bits >> (8 * (7 - i)));
+      }
+      total[j] = full[j] + tailSize / HASH_BLOCK_SIZE;
+      if (total[j] > maxTotal) {
+         maxTotal = total[j];
+      }
+   }
+
+   for (k = 0; k < maxTotal; k++) {
+      for (j = 0; j < JMBHASH_LANES; j++) {
+         if (k < full[j]) {
+            blocks[j] = jobs[j]->buf + k * HASH_BLOCK_SIZE;
+         } else if (k < total[j]) {
+            blocks[j] = tails[j] + (k - full[j]) * HASH_BLOCK_SIZE;
+         } else {
+            blocks[j] = zero;
+         }
+      }
+      if (sha1) {
+         JMbHashSha1Block(state, blocks);
+      } else {
+         JMbHashMd5Block(state, blocks);
+      }
+      for (j = 0; j < count; j++) {
+         uint32 lanes[JMBHASH_LANES];
+
+         if (total[j] != k + 1) {
+            continue;
+         }
+         for (i = 0; i < words; i++) {
+            uint32 v;
+
+            _mm256_storeu_si256((__m256i *)lanes, state[i]);
+            v = lanes[j];
+            if (sha1) {
+               jobs[j]->digest[4 * i] = (uint8)(v >> 24);
+               jobs[j]->digest[4 * i + 1] = (uint8)(v >> 16);
+               jobs[j]->digest[4 * i + 2] = (uint8)(v >> 8);
+               jobs[j]->digest[4 * i + 3] = (uint8)v;
+            } else {
+               memcpy(jobs[j]->digest + 4 * i, &v, 4);
+            }
+         }
+      }
+   }
+}
+#endif // JMBHASH_AVX2
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JMbHashDeadline --
+ *
+ *      Absolute time JMBHASH_GATHER_US from now, for pthread_cond_timedwait.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JMbHashDeadline(struct timespec *ts) // OUT
+{
+   clock_gettime(CLOCK_REALTIME, ts);
+   ts->tv_nsec += JMBHASH_GATHER_US * 1000L;
+   if (ts->tv_nsec >= 1000000000L) {
+      ts->tv_sec++;
+      ts->tv_nsec -= 1000000000L;
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JMbHash_Digest --
+ *
+ *      Queue a buffer and wait for its digest. The caller hashes a batch
+ *      itself when the lanes are full or its gather time is over, so no
+ *      thread of its own is needed. See jMbHash.h.
+ *
+ * Results:
+ *      TRUE if the digest was computed, FALSE if the CPU lacks AVX2.
+ *
+ * Side effects:
+ *      May hash the buffers of other threads.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+Bool
+JMbHash_Digest(JMbHashAlgorithm algorithm,  // IN
+               const uint8 *buf,            // IN
+               size_t length,               // IN
+               uint8 *digest)               // OUT
+{
+#ifdef JMBHASH_AVX2
+   JMbHashQueue *queue;
+   JMbHashJob job;
+   JMbHashJob *batch[JMBHASH_LANES];
+   struct timespec deadline;
+   Bool expired = FALSE;
+
+   if (!JMbHash_IsSupported() || algorithm < 0 || algorithm >= JMbHashCount) {
+      return FALSE;
+   }
+   job.buf = buf;
+   job.length = length;
+   job.digest = digest;
+   job.done = FALSE;
+   job.next = NULL;
+   if (length < JMBHASH_MIN_GATHER_SIZE) {
+      batch[0] = &job;
+      JMbHashRun(algorithm, batch, 1);
+      return TRUE;
+   }
+
+   queue = &gQueues[algorithm];
+   JMbHashDeadline(&deadline);
+   pthread_mutex_lock(&gLock);
+   if (queue->tail != NULL) {
+      queue->tail->next = &job;
+   } else {
+      queue->head = &job;
+   }
+   queue->tail = &job;
+   queue->pending++;
+
+   while (!job.done) {
+      if (queue->pending >= JMBHASH_LANES || (expired && queue->pending > 0)) {
+         int count = 0;
+         int i;
+
+         while (count < JMBHASH_LANES && queue->head != NULL) {
+            batch[count++] = queue->head;
+            queue->head = queue->head->next;
+         }
+         if (queue->head == NULL) {
+            queue->tail = NULL;
+         }
+         queue->pending -= count;
+         pthread_mutex_unlock(&gLock);
+         JMbHashRun(algorithm, batch, count);
+         pthread_mutex_lock(&gLock);
+         for (i = 0; i < count; i++) {
+            batch[i]->done = TRUE;
+         }
+         pthread_cond_broadcast(&gDone);
+      } else if (!expired) {
+         expired = pthread_cond_timedwait(&gDone, &gLock, &deadline) != 0;
+      } else {
+         /* Our job is being hashed by another thread */
+         pthread_cond_wait(&gDone, &gLock);
+      }
+   }
+   pthread_mutex_unlock(&gLock);
+   return TRUE;
+#else
+   return FALSE;
+#endif
+}
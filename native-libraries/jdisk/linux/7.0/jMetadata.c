@@ -0,0 +1,391 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jMetadata.c
+ *
+ *    Bulk read of the metadata of a disk, cached per disk handle.
+ *
+ *    Reading the metadata key by key costs two VixDiskLib calls per key,
+ *    one to size the buffer and one to read, each a round trip over NBD.
+ *    Here the keys and values are read into buffers sized from the start
+ *    for the usual metadata, grown only when VixDiskLib asks for more, and
+ *    the result is kept until the handle is closed or its metadata written.
+ *    A disk of jdiskd is read in a single command to the daemon, which
+ *    keeps its own cache.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "jMetadata.h"
+#include "jDiskd.h"
+
+#define JMETADATA_KEYS_SIZE 1024
+#define JMETADATA_VALUE_SIZE 256
+
+typedef VixError (*JMetadataKeysFunc)(VixDiskLibHandle disk, char *keys,
+                                      size_t bufLen, size_t *required);
+typedef VixError (*JMetadataValueFunc)(VixDiskLibHandle disk, const char *key,
+                                       char *buf, size_t bufLen,
+                                       size_t *required);
+
+typedef struct JMetadataEntry {
+   VixDiskLibHandle disk;
+   char *packed;
+   size_t size;
+   struct JMetadataEntry *next;
+} JMetadataEntry;
+
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static JMetadataEntry *gEntries = NULL;
+static uint64 gGeneration = 0;      /* Bumped by every release */
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JMetadataGet --
+ *
+ *      Read the keys ("key" NULL) or the value of a key into "*buf", growing
+ *      it once if VixDiskLib reports it too small.
+ *
+ * Results:
+ *      VixError. On VIX_OK, "*buf" holds "*length" bytes followed by a NUL.
+ *
+ * Side effects:
+ *      May reallocate "*buf".
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static VixError
+JMetadataGet(VixDiskLibHandle disk,          // IN
+             JMetadataKeysFunc keysFunc,     // IN
+             JMetadataValueFunc valueFunc,   // IN
+             const char *key,                // IN: NULL for the keys
+             char **buf,                     // IN/OUT
+             size_t *bufSize,                // IN/OUT: usable bytes
+             size_t *length)                 // OUT
+{
+   size_t required;
+   VixError err;
+   char *grown;
+   int tries;
+
+   for (tries = 0; tries < 2; tries++) {
+      required = 0;
+      err = key == NULL ? keysFunc(disk, *buf, *bufSize, &required) :
+                          valueFunc(disk, key, *buf, *bufSize, &required);
+      if (err == VIX_OK) {
+         /* The buffers have one byte more than they tell VixDiskLib */
+         (*buf)[*bufSize] = '\0';
+         *length = required > 0 && required <= *bufSize ? required : *bufSize;
+         return VIX_OK;
+      }
+      if (err != VIX_E_BUFFER_TOOSMALL || required <= *bufSize) {
+         return err;
+      }
+      grown = realloc(*buf, required + 1);
+      if (grown == NULL) {
+         return VIX_E_OUT_OF_MEMORY;
+      }
+      *buf = grown;
+      *bufSize = required;
+   }
+   return err;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JMetadataAppend --
+ *
+ *      Append a string and its NUL to a packed result.
+ *
+ * Results:
+ *      FALSE if out of memory.
+ *
+ * Side effects:
+ *      May reallocate the result.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JMetadataAppend(char **packed,       // IN/OUT
+                size_t *size,        // IN/OUT
+                size_t *capacity,    // IN/OUT
+                const char *s,       // IN
+                size_t length)       // IN: without the NUL
+{
+   char *grown;
+
+   if (*size + length + 1 > *capacity) {
+      size_t newCapacity = (*capacity + length + 1) * 2;
+
+      grown = realloc(*packed, newCapacity);
+      if (grown == NULL) {
+         return FALSE;
+      }
+      *packed = grown;
+      *capacity = newCapacity;
+   }
+   memcpy(*packed + *size, s, length);
+   (*packed)[*size + length] = '\0';
+   *size += length + 1;
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JMetadataFetch --
+ *
+ *      Read the keys of a disk, then the value of each key.
+ *
+ * Results:
+ *      VixError. On VIX_OK, the packed metadata.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static VixError
+JMetadataFetch(VixDiskLibHandle disk,          // IN
+               JMetadataKeysFunc keysFunc,     // IN
+               JMetadataValueFunc valueFunc,   // IN
+               char **packed,                  // OUT
+               size_t *size)                   // OUT
+{
+   size_t keysSize = JMETADATA_KEYS_SIZE;
+   size_t valueSize = JMETADATA_VALUE_SIZE;
+   char *keys = malloc(keysSize + 1);
+   char *value = malloc(valueSize + 1);
+   size_t keysLength, valueLength, capacity = 0, pos;
+   VixError err;
+
+   *packed = NULL;
+   *size = 0;
+   if (keys == NULL || value == NULL) {
+      err = VIX_E_OUT_OF_MEMORY;
+      goto out;
+   }
+   err = JMetadataGet(disk, keysFunc, valueFunc, NULL, &keys, &keysSize,
+                      &keysLength);
+   for (pos = 0; err == VIX_OK && pos < keysLength && keys[pos] != '\0';
+        pos += strlen(keys + pos) + 1) {
+      const char *key = keys + pos;
+
+      err = JMetadataGet(disk, keysFunc, valueFunc, key, &value, &valueSize,
+                         &valueLength);
+      if (err == VIX_OK &&
+          (!JMetadataAppend(packed, size, &capacity, key, strlen(key)) ||
+           !JMetadataAppend(packed, size, &capacity, value,
+                            strnlen(value, valueLength)))) {
+         err = VIX_E_OUT_OF_MEMORY;
+      }
+   }
+
+out:
+   if (err != VIX_OK) {
+      free(*packed);
+      *packed = NULL;
+      *size = 0;
+   }
+   free(keys);
+   free(value);
+   return err;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JMetadataFetchRemote --
+ *
+ *      Read the metadata of a disk of jdiskd, in one command unless it does
+ *      not fit in a message.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static VixError
+JMetadataFetchRemote(VixDiskLibHandle disk,   // IN
+                     char **packed,           // OUT
+                     size_t *size)            // OUT
+{
+   size_t bufSize = JMETADATA_KEYS_SIZE;
+   char *buf = malloc(bufSize + 1);
+   VixError err;
+
+   if (buf == NULL) {
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   err = JMetadataGet(disk, JDiskd_ReadAllMetadata, NULL, NULL, &buf,
+                      &bufSize, size);
+   if (err == VIX_OK) {
+      *packed = buf;
+      return VIX_OK;
+   }
+   free(buf);
+   if (err != VIX_E_BUFFER_TOOSMALL) {
+      return err;
+   }
+   return JMetadataFetch(disk, JDiskd_GetMetadataKeys, JDiskd_ReadMetadata,
+                         packed, size);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JMetadataCopy --
+ *
+ *      Copy a packed result for the caller.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static VixError
+JMetadataCopy(const char *src,   // IN
+              size_t size,       // IN
+              char **packed)     // OUT
+{
+   *packed = malloc(size > 0 ? size : 1);
+   if (*packed == NULL) {
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   memcpy(*packed, src, size);
+   return VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JMetadata_ReadAll --
+ *
+ *      Read all the metadata of a disk, from the cache if possible.
+ *
+ * Results:
+ *      VixError of the VixDiskLib calls.
+ *
+ * Side effects:
+ *      Caches the result. A release racing with the read keeps the result
+ *      out of the cache, as it may predate a metadata write.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JMetadata_ReadAll(VixDiskLibHandle disk,   // IN
+                  char **packed,           // OUT
+                  size_t *size,            // OUT
+                  Bool *cached)            // OUT: optional
+{
+   JMetadataEntry *entry;
+   uint64 generation;
+   VixError err;
+
+   *packed = NULL;
+   *size = 0;
+   if (cached != NULL) {
+      *cached = FALSE;
+   }
+   if (disk == NULL) {
+      return VIX_E_INVALID_ARG;
+   }
+
+   pthread_mutex_lock(&gLock);
+   for (entry = gEntries; entry != NULL; entry = entry->next) {
+      if (entry->disk == disk) {
+         err = JMetadataCopy(entry->packed, entry->size, packed);
+         if (err == VIX_OK) {
+            *size = entry->size;
+            if (cached != NULL) {
+               *cached = TRUE;
+            }
+         }
+         pthread_mutex_unlock(&gLock);
+         return err;
+      }
+   }
+   generation = gGeneration;
+   pthread_mutex_unlock(&gLock);
+
+   if (JDiskd_IsRemote(disk)) {
+      err = JMetadataFetchRemote(disk, packed, size);
+   } else {
+      err = JMetadataFetch(disk, VixDiskLib_GetMetadataKeys,
+                           VixDiskLib_ReadMetadata, packed, size);
+   }
+   if (err != VIX_OK) {
+      return err;
+   }
+
+   entry = calloc(1, sizeof *entry);
+   if (entry == NULL || JMetadataCopy(*packed, *size, &entry->packed) !=
+                        VIX_OK) {
+      free(entry);
+      return VIX_OK;
+   }
+   entry->disk = disk;
+   entry->size = *size;
+   pthread_mutex_lock(&gLock);
+   if (generation == gGeneration) {
+      entry->next = gEntries;
+      gEntries = entry;
+      entry = NULL;
+   }
+   pthread_mutex_unlock(&gLock);
+   if (entry != NULL) {
+      free(entry->packed);
+      free(entry);
+   }
+   return VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JMetadata_Release --
+ *
+ *      Drop the cached metadata of a disk handle.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Frees memory.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JMetadata_Release(VixDiskLibHandle disk)   // IN
+{
+   JMetadataEntry **link;
+   JMetadataEntry *entry = NULL;
+
+   pthread_mutex_lock(&gLock);
+   gGeneration++;
+   for (link = &gEntries; *link != NULL; link = &(*link)->next) {
+      if ((*link)->disk == disk) {
+         entry = *link;
+         *link = entry->next;
+         break;
+      }
+   }
+   pthread_mutex_unlock(&gLock);
+   if (entry != NULL) {
+      free(entry->packed);
+      free(entry);
+   }
+}
@@ -0,0 +1,353 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jMiGz.c
+ *
+ *    Multi-threaded decoder of MiGz streams.
+ *
+ *    MiGz writes a block as a sequence of independent gzip members and
+ *    records the compressed size of each member in an "MZ" extra field of
+ *    its header. The trailer of a member gives its decompressed size, so
+ *    the whole stream can be laid out in the output before anything is
+ *    inflated, and the members are then inflated in parallel straight to
+ *    their place. Each member is checked against the CRC32 of its trailer.
+ *
+ *    Inflate and CRC32 come from the zlib the library is linked with; an
+ *    optimized zlib (zlib-ng in compat mode, Intel or Cloudflare zlib)
+ *    speeds up both without any change here.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <zlib.h>
+#include "jMiGz.h"
+
+#define GZIP_HEADER_SIZE 10
+#define GZIP_TRAILER_SIZE 8
+
+#define GZIP_FHCRC 0x02
+#define GZIP_FEXTRA 0x04
+#define GZIP_FNAME 0x08
+#define GZIP_FCOMMENT 0x10
+
+/*
+ * Below this decoded size a stream is not worth a second thread.
+ */
+#define PARALLEL_MIN_SIZE (256 * 1024)
+
+
+typedef struct JMiGzMember {
+   const uint8 *src;    /* Raw deflate data */
+   size_t srcLength;
+   uint8 *dst;
+   uint32 dstLength;
+   uint32 crc;
+} JMiGzMember;
+
+typedef struct JMiGzJob {
+   JMiGzMember *members;
+   int count;
+   volatile int next;   /* Next member to inflate */
+   volatile int failed;
+} JMiGzJob;
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JMiGzGet16 / JMiGzGet32 --
+ *
+ *      Read a little endian integer.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static uint32
+JMiGzGet16(const uint8 *p) // IN
+{
+   return p[0] | ((uint32)p[1] << 8);
+}
+
+static uint32
+JMiGzGet32(const uint8 *p) // IN
+{
+   return p[0] | ((uint32)p[1] << 8) | ((uint32)p[2] << 16) |
+          ((uint32)p[3] << 24);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JMiGzParseMember --
+ *
+ *      Parse the gzip member at "pos" and locate its deflate data from the
+ *      MiGz extra field.
+ *
+ * Results:
+ *      Offset of the next member, or 0 if the member is not a valid MiGz
+ *      member.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static size_t
+JMiGzParseMember(const uint8 *src,          // IN
+                 size_t length,             // IN
+                 size_t pos,                // IN
+                 JMiGzMember *member)       // OUT
+{
+   size_t p = pos + GZIP_HEADER_SIZE;
+   Bool found = FALSE;
+   uint8 flags;
+
+   if (length - pos < GZIP_HEADER_SIZE || src[pos] != 0x1f ||
+       src[pos + 1] != 0x8b || src[pos + 2] != Z_DEFLATED) {
+      return 0;
+   }
+   flags = src[pos + 3];
+   if (flags & GZIP_FEXTRA) {
+      size_t xlen;
+      size_t end;
+
+      if (length - p < 2) {
+         return 0;
+      }
+      xlen = JMiGzGet16(src + p);
+      p += 2;
+      if (length - p < xlen) {
+         return 0;
+      }
+      end = p + xlen;
+      while (end - p >= 4) {
+         size_t slen = JMiGzGet16(src + p + 2);
+
+         if (end - p - 4 < slen) {
+            return 0;
+         }
+         if (src[p] == 'M' && src[p + 1] == 'Z' && slen == 4) {
+            member->srcLength = JMiGzGet32(src + p + 4);
+            found = TRUE;
+         }
+         p += 4 + slen;
+      }
+      p = end;
+   }
+   if (flags & GZIP_FNAME) {
+      while (p < length && src[p] != 0) {
+         p++;
+      }
+      p++;
+   }
+   if (flags & GZIP_FCOMMENT) {
+      while (p < length && src[p] != 0) {
+         p++;
+      }
+      p++;
+   }
+   if (flags & GZIP_FHCRC) {
+      p += 2;
+   }
+   if (!found || p > length ||
+       length - p < member->srcLength + GZIP_TRAILER_SIZE) {
+      return 0;
+   }
+   member->src = src + p;
+   p += member->srcLength;
+   member->crc = JMiGzGet32(src + p);
+   member->dstLength = JMiGzGet32(src + p + 4);
+   return p + GZIP_TRAILER_SIZE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JMiGzWorker --
+ *
+ *      Inflate members of the job until none is left or one has failed.
+ *
+ * Results:
+ *      NULL.
+ *
+ * Side effects:
+ *      Fills the output of the members, sets job->failed on error.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void *
+JMiGzWorker(void *data) // IN: JMiGzJob
+{
+   JMiGzJob *job = data;
+   z_stream strm;
+   int i;
+
+   memset(&strm, 0, sizeof strm);
+   if (inflateInit2(&strm, -MAX_WBITS) != Z_OK) {
+      job->failed = 1;
+      return NULL;
+   }
+   while (!job->failed &&
+          (i = __sync_fetch_and_add(&job->next, 1)) < job->count) {
+      JMiGzMember *member = &job->members[i];
+
+      strm.next_in = (Bytef *)member->src;
+      strm.avail_in = (uInt)member->srcLength;
+      strm.next_out = member->dst;
+      strm.avail_out = member->dstLength;
+      if (inflate(&strm, Z_FINISH) != Z_STREAM_END ||
+          strm.total_out != member->dstLength ||
+          crc32(0, member->dst, member->dstLength) != member->crc) {
+         job->failed = 1;
+      }
+      inflateReset(&strm);
+   }
+   inflateEnd(&strm);
+   return NULL;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JMiGzDecodeSequential --
+ *
+ *      Decode a stream of plain gzip members with a single zlib stream.
+ *
+ * Results:
+ *      Decoded size, or -1 on error.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static int64
+JMiGzDecodeSequential(const uint8 *src,     // IN
+                      size_t srcLength,     // IN
+                      uint8 *dst,           // OUT
+                      size_t dstLength)     // IN
+{
+   z_stream strm;
+   int64 result = -1;
+   int ret;
+
+   memset(&strm, 0, sizeof strm);
+   if (inflateInit2(&strm, 16 + MAX_WBITS) != Z_OK) {
+      return -1;
+   }
+   strm.next_in = (Bytef *)src;
+   strm.avail_in = (uInt)srcLength;
+   strm.next_out = dst;
+   strm.avail_out = (uInt)dstLength;
+   for (;;) {
+      ret = inflate(&strm, Z_FINISH);
+      if (ret != Z_STREAM_END) {
+         break;
+      }
+      if (strm.avail_in == 0) {
+         result = dstLength - strm.avail_out;
+         break;
+      }
+      /* Next member */
+      inflateReset(&strm);
+   }
+   inflateEnd(&strm);
+   return result;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JMiGz_Decode --
+ *
+ *      Decode a MiGz stream. See jMiGz.h.
+ *
+ * Results:
+ *      Decoded size, or -1 on error.
+ *
+ * Side effects:
+ *      May start up to "threads" - 1 threads for the duration of the call.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+int64
+JMiGz_Decode(const uint8 *src,      // IN
+             size_t srcLength,      // IN
+             uint8 *dst,            // OUT
+             size_t dstLength,      // IN
+             int threads)           // IN
+{
+   pthread_t tids[JMIGZ_MAX_THREADS];
+   JMiGzJob job;
+   int capacity = 0;
+   int started = 0;
+   size_t total = 0;
+   size_t pos = 0;
+   int i;
+
+   if (src == NULL || dst == NULL || srcLength < GZIP_HEADER_SIZE) {
+      return -1;
+   }
+   memset(&job, 0, sizeof job);
+   while (pos < srcLength) {
+      JMiGzMember member;
+      size_t next = JMiGzParseMember(src, srcLength, pos, &member);
+
+      if (next == 0) {
+         free(job.members);
+         return JMiGzDecodeSequential(src, srcLength, dst, dstLength);
+      }
+      if (dstLength - total < member.dstLength) {
+         free(job.members);
+         return -1;
+      }
+      if (job.count == capacity) {
+         JMiGzMember *members;
+
+         capacity = capacity == 0 ? 64 : capacity * 2;
+         members = realloc(job.members, capacity * sizeof *members);
+         if (members == NULL) {
+            free(job.members);
+            return -1;
+         }
+         job.members = members;
+      }
+      member.dst = dst + total;
+      total += member.dstLength;
+      job.members[job.count++] = member;
+      pos = next;
+   }
+
+   if (threads > JMIGZ_MAX_THREADS) {
+      threads = JMIGZ_MAX_THREADS;
+   }
+   if (threads > job.count) {
+      threads = job.count;
+   }
+   if (total < PARALLEL_MIN_SIZE) {
+      threads = 1;
+   }
+   for (i = 1; i < threads; i++) {
+      if (pthread_create(&tids[started], NULL, JMiGzWorker, &job) != 0) {
+         break;
+      }
+      started++;
+   }
+   JMiGzWorker(&job);
+   for (i = 0; i < started; i++) {
+      pthread_join(tids[i], NULL);
+   }
+   free(job.members);
+   return job.failed ? -1 : (int64)total;
+}
@@ -223,6 +223,7 @@ Java_com_vmware_jvix_jMntApiImpl_OpenDisksJNI(JNIEnv *env,
    for(i = 0; i < bufSize; i++) {
       free(cDiskNames[i]);
    }
+   free(cDiskNames);
 
    return result;
 }
@@ -283,6 +284,7 @@ Java_com_vmware_jvix_jMntApiImpl_OpenDiskSetJNI(JNIEnv *env,
    if (diskHandles != NULL) {
       (*env)->ReleaseLongArrayElements(env, diskHandles, jBuf, JNI_ABORT);
    }
+   free(cDiskHandles);
 
    return result;
 }
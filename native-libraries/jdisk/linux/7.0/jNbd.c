@@ -0,0 +1,1446 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jNbd.c
+ *
+ *    NBD server exposing an archived disk generation as a block device, so
+ *    that a VM or a host can use a generation as soon as it is chosen,
+ *    before or instead of a full restore.
+ *
+ *    Only the fixed newstyle handshake is implemented, with the simple
+ *    replies: a client thread reads a request, serves it and replies before
+ *    reading the next one. Reads come from the block cache of the
+ *    JArchiveDisk, filled ahead of sequential readers by a prefetch thread.
+ *    Writes land in a sparse overlay of pages shared by all the clients,
+ *    which is why several connections to the same export are coherent.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <endian.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "jNbd.h"
+
+/*
+ * Protocol constants, from the NBD protocol specification.
+ */
+#define NBD_MAGIC                0x4e42444d41474943ULL   /* "NBDMAGIC" */
+#define NBD_IHAVEOPT             0x49484156454f5054ULL   /* "IHAVEOPT" */
+#define NBD_REP_MAGIC            0x0003e889045565a9ULL
+#define NBD_REQUEST_MAGIC        0x25609513
+#define NBD_SIMPLE_REPLY_MAGIC   0x67446698
+
+#define NBD_FLAG_FIXED_NEWSTYLE  (1 << 0)
+#define NBD_FLAG_NO_ZEROES       (1 << 1)
+#define NBD_FLAG_C_MASK          (NBD_FLAG_FIXED_NEWSTYLE | NBD_FLAG_NO_ZEROES)
+
+#define NBD_FLAG_HAS_FLAGS         (1 << 0)
+#define NBD_FLAG_READ_ONLY         (1 << 1)
+#define NBD_FLAG_SEND_FLUSH        (1 << 2)
+#define NBD_FLAG_SEND_FUA          (1 << 3)
+#define NBD_FLAG_SEND_TRIM         (1 << 5)
+#define NBD_FLAG_SEND_WRITE_ZEROES (1 << 6)
+#define NBD_FLAG_CAN_MULTI_CONN    (1 << 8)
+
+#define NBD_OPT_EXPORT_NAME      1
+#define NBD_OPT_ABORT            2
+#define NBD_OPT_LIST             3
+#define NBD_OPT_INFO             6
+#define NBD_OPT_GO               7
+
+#define NBD_REP_ACK              1
+#define NBD_REP_SERVER           2
+#define NBD_REP_INFO             3
+#define NBD_REP_ERR_UNSUP        0x80000001
+#define NBD_REP_ERR_INVALID      0x80000003
+#define NBD_REP_ERR_UNKNOWN      0x80000006
+
+#define NBD_INFO_EXPORT          0
+#define NBD_INFO_NAME            1
+#define NBD_INFO_BLOCK_SIZE      3
+
+#define NBD_CMD_READ             0
+#define NBD_CMD_WRITE            1
+#define NBD_CMD_DISC             2
+#define NBD_CMD_FLUSH            3
+#define NBD_CMD_TRIM             4
+#define NBD_CMD_WRITE_ZEROES     6
+
+#define NBD_EPERM                1
+#define NBD_EIO                  5
+#define NBD_ENOMEM               12
+#define NBD_EINVAL               22
+#define NBD_ENOSPC               28
+
+#define JNBD_MAX_OPTION          4096
+#define JNBD_PREFETCH_QUEUE      16
+
+typedef struct JNbdPage {
+   int64 index;                     /* Offset / JNBD_PAGE_SIZE */
+   struct JNbdPage *next;           /* Next page of the bucket */
+   uint8 data[JNBD_PAGE_SIZE];
+} JNbdPage;
+
+typedef struct JNbdClient {
+   JNbdServer *server;
+   int fd;
+   pthread_t thread;
+   Bool done;                       /* The thread can be joined */
+   int64 lastEnd;                   /* End of the previous read */
+   int64 prefetchEnd;               /* End of the readahead queued */
+   uint8 *buf;
+   size_t bufSize;
+   struct JNbdClient *next;
+} JNbdClient;
+
+struct JNbdServer {
+   JArchiveDisk *disk;
+   int64 capacity;
+   char *name;
+   char *path;                      /* Unix socket, NULL for TCP */
+   int port;
+   int listenFd;
+   int stopPipe[2];
+   int64 readahead;
+   int64 overlayLimit;
+   pthread_t acceptThread;
+   pthread_t prefetchThread;
+
+   pthread_mutex_t lock;            /* Clients, prefetch queue and stats */
+   pthread_cond_t prefetchCond;
+   Bool stopping;
+   JNbdClient *clients;
+   int clientCount;
+   int64 prefetchOffset[JNBD_PREFETCH_QUEUE];
+   int64 prefetchLength[JNBD_PREFETCH_QUEUE];
+   int prefetchHead;
+   int prefetchCount;
+   int64 stats[JNbdStatCount];
+
+   pthread_rwlock_t overlayLock;
+   JNbdPage **buckets;
+   size_t bucketMask;
+   int64 pageCount;
+};
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbdRecv --
+ *
+ *      Read exactly "length" bytes from a socket.
+ *
+ * Results:
+ *      FALSE on error or end of stream.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JNbdRecv(int fd,           // IN
+         void *buf,        // OUT
+         size_t length)    // IN
+{
+   uint8 *p = buf;
+
+   while (length > 0) {
+      ssize_t n = recv(fd, p, length, 0);
+
+      if (n < 0 && errno == EINTR) {
+         continue;
+      }
+      if (n <= 0) {
+         return FALSE;
+      }
+      p += n;
+      length -= n;
+   }
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbdSend --
+ *
+ *      Write exactly "length" bytes to a socket, without raising SIGPIPE
+ *      in the JVM if the client is gone.
+ *
+ * Results:
+ *      FALSE on error.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JNbdSend(int fd,           // IN
+         const void *buf,  // IN
+         size_t length)    // IN
+{
+   const uint8 *p = buf;
+
+   while (length > 0) {
+      ssize_t n = send(fd, p, length, MSG_NOSIGNAL);
+
+      if (n < 0 && errno == EINTR) {
+         continue;
+      }
+      if (n <= 0) {
+         return FALSE;
+      }
+      p += n;
+      length -= n;
+   }
+   return TRUE;
+}
+
+
+static void
+JNbdPut16(uint8 *p, uint16 v)  // OUT, IN
+{
+   v = htobe16(v);
+   memcpy(p, &v, sizeof v);
+}
+
+
+static void
+JNbdPut32(uint8 *p, uint32 v)  // OUT, IN
+{
+   v = htobe32(v);
+   memcpy(p, &v, sizeof v);
+}
+
+
+static void
+JNbdPut64(uint8 *p, uint64 v)  // OUT, IN
+{
+   v = htobe64(v);
+   memcpy(p, &v, sizeof v);
+}
+
+
+static uint16
+JNbdGet16(const uint8 *p)      // IN
+{
+   uint16 v;
+
+   memcpy(&v, p, sizeof v);
+   return be16toh(v);
+}
+
+
+static uint32
+JNbdGet32(const uint8 *p)      // IN
+{
+   uint32 v;
+
+   memcpy(&v, p, sizeof v);
+   return be32toh(v);
+}
+
+
+static uint64
+JNbdGet64(const uint8 *p)      // IN
+{
+   uint64 v;
+
+   memcpy(&v, p, sizeof v);
+   return be64toh(v);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbdStatAdd --
+ *
+ *      Update a statistic of the server.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JNbdStatAdd(JNbdServer *server,   // IN/OUT
+            JNbdStat stat,        // IN
+            int64 value)          // IN
+{
+   pthread_mutex_lock(&server->lock);
+   server->stats[stat] += value;
+   pthread_mutex_unlock(&server->lock);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbdFindPage --
+ *
+ *      Find a page of the overlay. Must be called with the overlay lock
+ *      held.
+ *
+ * Results:
+ *      The page, NULL if it was never written.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static JNbdPage *
+JNbdFindPage(const JNbdServer *server,  // IN
+             int64 index)               // IN
+{
+   JNbdPage *page = server->buckets[(uint64)index & server->bucketMask];
+
+   while (page != NULL && page->index != index) {
+      page = page->next;
+   }
+   return page;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbdRead --
+ *
+ *      Read a range of the exported disk: the archived blocks, with the
+ *      pages of the overlay on top.
+ *
+ * Results:
+ *      0 or an NBD error.
+ *
+ * Side effects:
+ *      Fills the block cache.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static uint32
+JNbdRead(JNbdServer *server,  // IN
+         int64 offset,        // IN
+         uint32 length,       // IN
+         uint8 *buf)          // OUT
+{
+   int64 index;
+   int64 last;
+
+   if (!JArchiveDisk_Read(server->disk, offset, length, buf)) {
+      return NBD_EIO;
+   }
+   pthread_rwlock_rdlock(&server->overlayLock);
+   if (server->pageCount > 0) {
+      last = (offset + length - 1) / JNBD_PAGE_SIZE;
+      for (index = offset / JNBD_PAGE_SIZE; index <= last; index++) {
+         const JNbdPage *page = JNbdFindPage(server, index);
+         int64 start = index * JNBD_PAGE_SIZE;
+         int64 from;
+         int64 to;
+
+         if (page == NULL) {
+            continue;
+         }
+         from = start > offset ? start : offset;
+         to = start + JNBD_PAGE_SIZE < offset + length ?
+              start + JNBD_PAGE_SIZE : offset + length;
+         memcpy(buf + (from - offset), page->data + (from - start), to - from);
+      }
+   }
+   pthread_rwlock_unlock(&server->overlayLock);
+   return 0;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbdWrite --
+ *
+ *      Write a range of the exported disk into the overlay. A page partly
+ *      written is first filled from the archived blocks. "buf" NULL writes
+ *      zeros.
+ *
+ * Results:
+ *      0 or an NBD error.
+ *
+ * Side effects:
+ *      Adds pages to the overlay.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static uint32
+JNbdWrite(JNbdServer *server,  // IN/OUT
+          int64 offset,        // IN
+          int64 length,        // IN
+          const uint8 *buf)    // IN: optional
+{
+   uint32 error = 0;
+   int64 added = 0;
+   int64 index;
+   int64 last = (offset + length - 1) / JNBD_PAGE_SIZE;
+
+   pthread_rwlock_wrlock(&server->overlayLock);
+   for (index = offset / JNBD_PAGE_SIZE; index <= last; index++) {
+      JNbdPage *page = JNbdFindPage(server, index);
+      int64 start = index * JNBD_PAGE_SIZE;
+      int64 from = start > offset ? start : offset;
+      int64 to = start + JNBD_PAGE_SIZE < offset + length ?
+                 start + JNBD_PAGE_SIZE : offset + length;
+
+      if (page == NULL) {
+         JNbdPage **bucket = &server->buckets[(uint64)index &
+                                              server->bucketMask];
+         int64 valid;
+
+         if ((server->pageCount + 1) * JNBD_PAGE_SIZE > server->overlayLimit) {
+            error = NBD_ENOSPC;
+            break;
+         }
+         page = malloc(sizeof *page);
+         if (page == NULL) {
+            error = NBD_ENOMEM;
+            break;
+         }
+         valid = server->capacity - start < JNBD_PAGE_SIZE ?
+                 server->capacity - start : JNBD_PAGE_SIZE;
+         memset(page->data + valid, 0, JNBD_PAGE_SIZE - valid);
+         if ((from > start || to < start + valid) &&
+             !JArchiveDisk_Read(server->disk, start, valid, page->data)) {
+            free(page);
+            error = NBD_EIO;
+            break;
+         }
+         page->index = index;
+         page->next = *bucket;
+         *bucket = page;
+         server->pageCount++;
+         added++;
+      }
+      if (buf != NULL) {
+         memcpy(page->data + (from - start), buf + (from - offset), to - from);
+      } else {
+         memset(page->data + (from - start), 0, to - from);
+      }
+   }
+   pthread_rwlock_unlock(&server->overlayLock);
+   if (added > 0) {
+      JNbdStatAdd(server, JNbdStatOverlayBytes, added * sizeof(JNbdPage));
+   }
+   return error;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbdQueuePrefetch --
+ *
+ *      Queue a readahead past a read continuing the previous one of the
+ *      client. A full queue drops its oldest request: the readers that
+ *      queued it have moved on.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Wakes up the prefetch thread.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JNbdQueuePrefetch(JNbdClient *client,  // IN/OUT
+                  int64 offset,        // IN
+                  int64 length)        // IN
+{
+   JNbdServer *server = client->server;
+   int64 end = offset + length;
+   int64 start;
+   int slot;
+
+   if (server->readahead <= 0 || offset != client->lastEnd) {
+      client->lastEnd = end;
+      client->prefetchEnd = end;
+      return;
+   }
+   client->lastEnd = end;
+
+   /*
+    * Refill once half of the window is consumed, not on every read.
+    */
+   if (client->prefetchEnd - end > server->readahead / 2 ||
+       end >= server->capacity) {
+      return;
+   }
+   start = client->prefetchEnd > end ? client->prefetchEnd : end;
+   client->prefetchEnd = end + server->readahead;
+
+   pthread_mutex_lock(&server->lock);
+   if (server->prefetchCount == JNBD_PREFETCH_QUEUE) {
+      server->prefetchHead = (server->prefetchHead + 1) % JNBD_PREFETCH_QUEUE;
+      server->prefetchCount--;
+   }
+   slot = (server->prefetchHead + server->prefetchCount) % JNBD_PREFETCH_QUEUE;
+   server->prefetchOffset[slot] = start;
+   server->prefetchLength[slot] = client->prefetchEnd - start;
+   server->prefetchCount++;
+   server->stats[JNbdStatPrefetches]++;
+   pthread_cond_signal(&server->prefetchCond);
+   pthread_mutex_unlock(&server->lock);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbdPrefetcher --
+ *
+ *      Thread loading the queued readahead into the block cache.
+ *
+ * Results:
+ *      NULL.
+ *
+ * Side effects:
+ *      Fills the block cache.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void *
+JNbdPrefetcher(void *data)   // IN
+{
+   JNbdServer *server = data;
+
+   pthread_mutex_lock(&server->lock);
+   for (;;) {
+      int64 offset;
+      int64 length;
+
+      while (!server->stopping && server->prefetchCount == 0) {
+         pthread_cond_wait(&server->prefetchCond, &server->lock);
+      }
+      if (server->stopping) {
+         break;
+      }
+      offset = server->prefetchOffset[server->prefetchHead];
+      length = server->prefetchLength[server->prefetchHead];
+      server->prefetchHead = (server->prefetchHead + 1) % JNBD_PREFETCH_QUEUE;
+      server->prefetchCount--;
+      pthread_mutex_unlock(&server->lock);
+
+      /*
+       * A block that cannot be read now fails again, and is reported,
+       * when a client reads it.
+       */
+      JArchiveDisk_Prefetch(server->disk, offset, length);
+      pthread_mutex_lock(&server->lock);
+   }
+   pthread_mutex_unlock(&server->lock);
+   return NULL;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbdOptionReply --
+ *
+ *      Send a reply to an option of the handshake.
+ *
+ * Results:
+ *      FALSE on error.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JNbdOptionReply(int fd,              // IN
+                uint32 option,       // IN
+                uint32 type,         // IN
+                const uint8 *data,   // IN: optional
+                uint32 length)       // IN
+{
+   uint8 header[20];
+
+   JNbdPut64(header, NBD_REP_MAGIC);
+   JNbdPut32(header + 8, option);
+   JNbdPut32(header + 12, type);
+   JNbdPut32(header + 16, length);
+   return JNbdSend(fd, header, sizeof header) &&
+          (length == 0 || JNbdSend(fd, data, length));
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbdFlags --
+ *
+ *      Transmission flags of the export.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static uint16
+JNbdFlags(const JNbdServer *server)  // IN
+{
+   uint16 flags = NBD_FLAG_HAS_FLAGS | NBD_FLAG_SEND_FLUSH |
+                  NBD_FLAG_SEND_FUA | NBD_FLAG_CAN_MULTI_CONN;
+
+   if (server->overlayLimit <= 0) {
+      flags |= NBD_FLAG_READ_ONLY;
+   } else {
+      flags |= NBD_FLAG_SEND_TRIM | NBD_FLAG_SEND_WRITE_ZEROES;
+   }
+   return flags;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbdInfo --
+ *
+ *      Reply to NBD_OPT_INFO or NBD_OPT_GO: the export and the requested
+ *      information, then an ack.
+ *
+ * Results:
+ *      FALSE on error. "acked" tells whether the export was accepted.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JNbdInfo(JNbdClient *client,   // IN
+         uint32 option,        // IN
+         const uint8 *data,    // IN
+         uint32 length,        // IN
+         Bool *acked)          // OUT
+{
+   JNbdServer *server = client->server;
+   uint8 info[12 + JNBD_MAX_OPTION];
+   uint32 nameLength;
+   uint16 requests;
+   uint16 i;
+
+   *acked = FALSE;
+   if (length < 6) {
+      return JNbdOptionReply(client->fd, option, NBD_REP_ERR_INVALID,
+                             NULL, 0);
+   }
+   nameLength = JNbdGet32(data);
+   if (nameLength > length - 6) {
+      return JNbdOptionReply(client->fd, option, NBD_REP_ERR_INVALID,
+                             NULL, 0);
+   }
+   requests = JNbdGet16(data + 4 + nameLength);
+   if (6 + nameLength + 2 * (uint32)requests != length) {
+      return JNbdOptionReply(client->fd, option, NBD_REP_ERR_INVALID,
+                             NULL, 0);
+   }
+
+   /*
+    * The empty name is the default export.
+    */
+   if (nameLength != 0 && (nameLength != strlen(server->name) ||
+                           memcmp(data + 4, server->name, nameLength) != 0)) {
+      return JNbdOptionReply(client->fd, option, NBD_REP_ERR_UNKNOWN,
+                             NULL, 0);
+   }
+
+   JNbdPut16(info, NBD_INFO_EXPORT);
+   JNbdPut64(info + 2, server->capacity);
+   JNbdPut16(info + 10, JNbdFlags(server));
+   if (!JNbdOptionReply(client->fd, option, NBD_REP_INFO, info, 12)) {
+      return FALSE;
+   }
+   for (i = 0; i < requests; i++) {
+      uint16 type = JNbdGet16(data + 6 + nameLength + 2 * i);
+
+      if (type == NBD_INFO_NAME) {
+         size_t n = strlen(server->name);
+
+         JNbdPut16(info, NBD_INFO_NAME);
+         memcpy(info + 2, server->name, n);
+         if (!JNbdOptionReply(client->fd, option, NBD_REP_INFO, info,
+                              2 + n)) {
+            return FALSE;
+         }
+      } else if (type == NBD_INFO_BLOCK_SIZE) {
+         JNbdPut16(info, NBD_INFO_BLOCK_SIZE);
+         JNbdPut32(info + 2, 512);
+         JNbdPut32(info + 6, JNBD_PAGE_SIZE);
+         JNbdPut32(info + 10, JNBD_MAX_REQUEST);
+         if (!JNbdOptionReply(client->fd, option, NBD_REP_INFO, info, 14)) {
+            return FALSE;
+         }
+      }
+   }
+   *acked = TRUE;
+   return JNbdOptionReply(client->fd, option, NBD_REP_ACK, NULL, 0);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbdNegotiate --
+ *
+ *      Fixed newstyle handshake with a client.
+ *
+ * Results:
+ *      TRUE to start the transmission, FALSE to close the connection.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JNbdNegotiate(JNbdClient *client)   // IN
+{
+   JNbdServer *server = client->server;
+   uint8 data[JNBD_MAX_OPTION];
+   uint8 header[18];
+   uint32 clientFlags;
+
+   JNbdPut64(header, NBD_MAGIC);
+   JNbdPut64(header + 8, NBD_IHAVEOPT);
+   JNbdPut16(header + 16, NBD_FLAG_FIXED_NEWSTYLE | NBD_FLAG_NO_ZEROES);
+   if (!JNbdSend(client->fd, header, 18) ||
+       !JNbdRecv(client->fd, header, 4)) {
+      return FALSE;
+   }
+   clientFlags = JNbdGet32(header);
+   if ((clientFlags & ~NBD_FLAG_C_MASK) != 0 ||
+       (clientFlags & NBD_FLAG_FIXED_NEWSTYLE) == 0) {
+      return FALSE;
+   }
+
+   for (;;) {
+      uint32 option;
+      uint32 length;
+
+      if (!JNbdRecv(client->fd, header, 16) ||
+          JNbdGet64(header) != NBD_IHAVEOPT) {
+         return FALSE;
+      }
+      option = JNbdGet32(header + 8);
+      length = JNbdGet32(header + 12);
+      if (length > sizeof data || !JNbdRecv(client->fd, data, length)) {
+         return FALSE;
+      }
+
+      switch (option) {
+      case NBD_OPT_EXPORT_NAME: {
+         uint8 reply[10 + 124];
+         size_t n = 10;
+
+         if (length != 0 && (length != strlen(server->name) ||
+                             memcmp(data, server->name, length) != 0)) {
+            return FALSE;
+         }
+         JNbdPut64(reply, server->capacity);
+         JNbdPut16(reply + 8, JNbdFlags(server));
+         if ((clientFlags & NBD_FLAG_NO_ZEROES) == 0) {
+            memset(reply + 10, 0, 124);
+            n += 124;
+         }
+         return JNbdSend(client->fd, reply, n);
+      }
+      case NBD_OPT_ABORT:
+         JNbdOptionReply(client->fd, option, NBD_REP_ACK, NULL, 0);
+         return FALSE;
+      case NBD_OPT_LIST: {
+         size_t n = strlen(server->name);
+
+         if (length != 0) {
+            if (!JNbdOptionReply(client->fd, option, NBD_REP_ERR_INVALID,
+                                 NULL, 0)) {
+               return FALSE;
+            }
+            break;
+         }
+         JNbdPut32(data, n);
+         memcpy(data + 4, server->name, n);
+         if (!JNbdOptionReply(client->fd, option, NBD_REP_SERVER, data,
+                              4 + n) ||
+             !JNbdOptionReply(client->fd, option, NBD_REP_ACK, NULL, 0)) {
+            return FALSE;
+         }
+         break;
+      }
+      case NBD_OPT_INFO:
+      case NBD_OPT_GO: {
+         Bool acked;
+
+         if (!JNbdInfo(client, option, data, length, &acked)) {
+            return FALSE;
+         }
+
+         /*
+          * An error reply leaves the client in the option phase.
+          */
+         if (option == NBD_OPT_GO && acked) {
+            return TRUE;
+         }
+         break;
+      }
+      default:
+         if (!JNbdOptionReply(client->fd, option, NBD_REP_ERR_UNSUP,
+                              NULL, 0)) {
+            return FALSE;
+         }
+         break;
+      }
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbdReply --
+ *
+ *      Send a simple reply, followed by "length" bytes of data.
+ *
+ * Results:
+ *      FALSE on error.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JNbdReply(int fd,               // IN
+          const uint8 *handle,  // IN: 8 bytes
+          uint32 error,         // IN
+          const uint8 *data,    // IN: optional
+          uint32 length)        // IN
+{
+   uint8 reply[16];
+
+   JNbdPut32(reply, NBD_SIMPLE_REPLY_MAGIC);
+   JNbdPut32(reply + 4, error);
+   memcpy(reply + 8, handle, 8);
+   return JNbdSend(fd, reply, sizeof reply) &&
+          (length == 0 || JNbdSend(fd, data, length));
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbdTransmit --
+ *
+ *      Serve the requests of a client until it disconnects.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Reads fill the block cache, writes fill the overlay.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JNbdTransmit(JNbdClient *client)  // IN/OUT
+{
+   JNbdServer *server = client->server;
+   Bool readOnly = server->overlayLimit <= 0;
+   uint8 request[28];
+
+   while (JNbdRecv(client->fd, request, sizeof request)) {
+      uint16 type = JNbdGet16(request + 6);
+      const uint8 *handle = request + 8;
+      uint64 offset = JNbdGet64(request + 16);
+      uint32 length = JNbdGet32(request + 24);
+      Bool inRange = offset <= (uint64)server->capacity &&
+                     length <= (uint64)server->capacity - offset;
+      uint32 error = 0;
+
+      if (JNbdGet32(request) != NBD_REQUEST_MAGIC) {
+         break;
+      }
+      if (type == NBD_CMD_DISC) {
+         break;
+      }
+
+      if ((type == NBD_CMD_READ || type == NBD_CMD_WRITE) &&
+          length > client->bufSize) {
+         uint8 *buf;
+
+         if (length > JNBD_MAX_REQUEST) {
+            if (type == NBD_CMD_WRITE) {
+               break;         /* The payload cannot be skipped */
+            }
+            if (!JNbdReply(client->fd, handle, NBD_EINVAL, NULL, 0)) {
+               break;
+            }
+            continue;
+         }
+         buf = realloc(client->buf, length);
+         if (buf == NULL) {
+            break;
+         }
+         client->buf = buf;
+         client->bufSize = length;
+      }
+
+      switch (type) {
+      case NBD_CMD_READ:
+         if (!inRange || length == 0) {
+            error = NBD_EINVAL;
+         } else {
+            error = JNbdRead(server, offset, length, client->buf);
+         }
+         if (!JNbdReply(client->fd, handle, error, client->buf,
+                        error == 0 ? length : 0)) {
+            return;
+         }
+         if (error == 0) {
+            pthread_mutex_lock(&server->lock);
+            server->stats[JNbdStatReads]++;
+            server->stats[JNbdStatBytesRead] += length;
+            pthread_mutex_unlock(&server->lock);
+            JNbdQueuePrefetch(client, offset, length);
+         }
+         continue;
+      case NBD_CMD_WRITE:
+         if (!JNbdRecv(client->fd, client->buf, length)) {
+            return;
+         }
+         if (readOnly) {
+            error = NBD_EPERM;
+         } else if (!inRange) {
+            error = NBD_ENOSPC;
+         } else if (length > 0) {
+            error = JNbdWrite(server, offset, length, client->buf);
+         }
+         if (error == 0) {
+            pthread_mutex_lock(&server->lock);
+            server->stats[JNbdStatWrites]++;
+            server->stats[JNbdStatBytesWritten] += length;
+            pthread_mutex_unlock(&server->lock);
+         }
+         break;
+      case NBD_CMD_WRITE_ZEROES:
+         if (readOnly) {
+            error = NBD_EPERM;
+         } else if (!inRange) {
+            error = NBD_ENOSPC;
+         } else if (length > 0) {
+            error = JNbdWrite(server, offset, length, NULL);
+         }
+         break;
+      case NBD_CMD_FLUSH:
+         /* The overlay is in memory: nothing to flush. */
+         break;
+      case NBD_CMD_TRIM:
+         /* Advisory; the pages are kept, reads stay consistent. */
+         error = readOnly ? NBD_EPERM : (inRange ? 0 : NBD_EINVAL);
+         break;
+      default:
+         error = NBD_EINVAL;
+         break;
+      }
+      if (!JNbdReply(client->fd, handle, error, NULL, 0)) {
+         return;
+      }
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbdClientThread --
+ *
+ *      Thread of a connected client.
+ *
+ * Results:
+ *      NULL.
+ *
+ * Side effects:
+ *      Marks the client done, to be joined by the accept thread.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void *
+JNbdClientThread(void *data)   // IN
+{
+   JNbdClient *client = data;
+   JNbdServer *server = client->server;
+
+   if (JNbdNegotiate(client)) {
+      JNbdTransmit(client);
+   }
+   shutdown(client->fd, SHUT_RDWR);
+   free(client->buf);
+   client->buf = NULL;
+   pthread_mutex_lock(&server->lock);
+   client->done = TRUE;
+   pthread_mutex_unlock(&server->lock);
+   return NULL;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbdReap --
+ *
+ *      Join the threads of the disconnected clients, or of all of them.
+ *      Must be called with the lock held.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Releases the lock while joining.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JNbdReap(JNbdServer *server,  // IN/OUT
+         Bool all)            // IN
+{
+   JNbdClient **link = &server->clients;
+
+   while (*link != NULL) {
+      JNbdClient *client = *link;
+
+      if (!all && !client->done) {
+         link = &client->next;
+         continue;
+      }
+      *link = client->next;
+      server->clientCount--;
+      pthread_mutex_unlock(&server->lock);
+      shutdown(client->fd, SHUT_RDWR);
+      pthread_join(client->thread, NULL);
+      close(client->fd);
+      free(client);
+      pthread_mutex_lock(&server->lock);
+      link = &server->clients;
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbdAcceptor --
+ *
+ *      Thread accepting the clients until the server stops.
+ *
+ * Results:
+ *      NULL.
+ *
+ * Side effects:
+ *      Starts a thread per client.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void *
+JNbdAcceptor(void *data)   // IN
+{
+   JNbdServer *server = data;
+   struct pollfd fds[2];
+
+   fds[0].fd = server->listenFd;
+   fds[0].events = POLLIN;
+   fds[1].fd = server->stopPipe[0];
+   fds[1].events = POLLIN;
+   for (;;) {
+      JNbdClient *client;
+      int fd;
+      int one = 1;
+
+      pthread_mutex_lock(&server->lock);
+      JNbdReap(server, FALSE);
+      pthread_mutex_unlock(&server->lock);
+
+      if (poll(fds, 2, 1000) < 0 && errno != EINTR) {
+         break;
+      }
+      if (fds[1].revents != 0) {
+         break;
+      }
+      if ((fds[0].revents & POLLIN) == 0) {
+         continue;
+      }
+      fd = accept(server->listenFd, NULL, NULL);
+      if (fd < 0) {
+         continue;
+      }
+      if (server->path == NULL) {
+         setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+      }
+
+      client = calloc(1, sizeof *client);
+      pthread_mutex_lock(&server->lock);
+      if (client == NULL || server->clientCount >= JNBD_MAX_CLIENTS) {
+         pthread_mutex_unlock(&server->lock);
+         free(client);
+         close(fd);
+         continue;
+      }
+      client->server = server;
+      client->fd = fd;
+      client->lastEnd = -1;
+      if (pthread_create(&client->thread, NULL, JNbdClientThread,
+                         client) != 0) {
+         pthread_mutex_unlock(&server->lock);
+         free(client);
+         close(fd);
+         continue;
+      }
+      client->next = server->clients;
+      server->clients = client;
+      server->clientCount++;
+      server->stats[JNbdStatConnections]++;
+      pthread_mutex_unlock(&server->lock);
+   }
+   return NULL;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbdListen --
+ *
+ *      Create the listening socket of a server.
+ *
+ * Results:
+ *      VIX_OK, VIX_E_INVALID_ARG, VIX_E_FILE_ALREADY_EXISTS or VIX_E_FAIL.
+ *
+ * Side effects:
+ *      Creates the unix socket, if any.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static VixError
+JNbdListen(JNbdServer *server,    // IN/OUT
+           const char *address,   // IN: optional
+           int port)              // IN
+{
+   int fd;
+
+   if (address != NULL) {
+      struct sockaddr_un sun;
+
+      memset(&sun, 0, sizeof sun);
+      sun.sun_family = AF_UNIX;
+      if (strlen(address) >= sizeof sun.sun_path) {
+         return VIX_E_INVALID_ARG;
+      }
+      strcpy(sun.sun_path, address);
+      fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      if (fd < 0) {
+         return VIX_E_FAIL;
+      }
+      if (bind(fd, (struct sockaddr *)&sun, sizeof sun) != 0) {
+         VixError err = errno == EADDRINUSE ? VIX_E_FILE_ALREADY_EXISTS
+                                            : VIX_E_FAIL;
+         close(fd);
+         return err;
+      }
+
+      /*
+       * The export is the content of a backup: owner only.
+       */
+      chmod(address, S_IRUSR | S_IWUSR);
+      server->path = strdup(address);
+      if (server->path == NULL) {
+         unlink(address);
+         close(fd);
+         return VIX_E_OUT_OF_MEMORY;
+      }
+   } else {
+      struct sockaddr_in sin;
+      socklen_t len = sizeof sin;
+      int one = 1;
+
+      if (port < 0 || port > 65535) {
+         return VIX_E_INVALID_ARG;
+      }
+      memset(&sin, 0, sizeof sin);
+      sin.sin_family = AF_INET;
+      sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      sin.sin_port = htons(port);
+      fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      if (fd < 0) {
+         return VIX_E_FAIL;
+      }
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+      if (bind(fd, (struct sockaddr *)&sin, sizeof sin) != 0) {
+         VixError err = errno == EADDRINUSE ? VIX_E_FILE_ALREADY_EXISTS
+                                            : VIX_E_FAIL;
+         close(fd);
+         return err;
+      }
+      if (getsockname(fd, (struct sockaddr *)&sin, &len) == 0) {
+         server->port = ntohs(sin.sin_port);
+      }
+   }
+   if (listen(fd, JNBD_MAX_CLIENTS) != 0) {
+      close(fd);
+      if (server->path != NULL) {
+         unlink(server->path);
+      }
+      return VIX_E_FAIL;
+   }
+   server->listenFd = fd;
+   return VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbdFree --
+ *
+ *      Release a server whose threads are stopped.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JNbdFree(JNbdServer *server)   // IN
+{
+   size_t i;
+
+   if (server->listenFd >= 0) {
+      close(server->listenFd);
+   }
+   if (server->path != NULL) {
+      unlink(server->path);
+      free(server->path);
+   }
+   if (server->stopPipe[0] >= 0) {
+      close(server->stopPipe[0]);
+      close(server->stopPipe[1]);
+   }
+   if (server->buckets != NULL) {
+      for (i = 0; i <= server->bucketMask; i++) {
+         while (server->buckets[i] != NULL) {
+            JNbdPage *page = server->buckets[i];
+
+            server->buckets[i] = page->next;
+            free(page);
+         }
+      }
+      free(server->buckets);
+   }
+   pthread_rwlock_destroy(&server->overlayLock);
+   pthread_cond_destroy(&server->prefetchCond);
+   pthread_mutex_destroy(&server->lock);
+   JArchiveDisk_Close(server->disk);
+   free(server->name);
+   free(server);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbd_Start --
+ *
+ *      Start serving an archived disk. See jNbd.h.
+ *
+ * Results:
+ *      VIX_OK with the server in "server", or an error.
+ *
+ * Side effects:
+ *      Starts the accept and prefetch threads.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JNbd_Start(JArchiveDisk *disk,        // IN
+           const char *name,          // IN
+           const char *address,       // IN: optional
+           int port,                  // IN
+           int64 readahead,           // IN
+           int64 overlayLimit,        // IN
+           JNbdServer **server)       // OUT
+{
+   JNbdServer *s;
+   size_t buckets = 1024;
+   VixError err;
+
+   *server = NULL;
+   if (name == NULL || strlen(name) > JNBD_MAX_OPTION - 16) {
+      JArchiveDisk_Close(disk);
+      return VIX_E_INVALID_ARG;
+   }
+   s = calloc(1, sizeof *s);
+   if (s == NULL) {
+      JArchiveDisk_Close(disk);
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   s->disk = disk;
+   s->capacity = JArchiveDisk_GetCapacity(disk);
+   s->listenFd = -1;
+   s->stopPipe[0] = -1;
+   s->stopPipe[1] = -1;
+   s->readahead = readahead == 0 ? JNBD_DEFAULT_READAHEAD : readahead;
+   s->overlayLimit = overlayLimit;
+   pthread_mutex_init(&s->lock, NULL);
+   pthread_cond_init(&s->prefetchCond, NULL);
+   pthread_rwlock_init(&s->overlayLock, NULL);
+
+   /*
+    * About four pages per bucket once the overlay is full.
+    */
+   while (overlayLimit > 0 &&
+          (int64)buckets * 4 * JNBD_PAGE_SIZE < overlayLimit &&
+          buckets < ((size_t)1 << 24)) {
+      buckets <<= 1;
+   }
+   s->buckets = calloc(buckets, sizeof *s->buckets);
+   s->bucketMask = buckets - 1;
+   s->name = strdup(name);
+   if (s->buckets == NULL || s->name == NULL) {
+      JNbdFree(s);
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   if (pipe(s->stopPipe) != 0) {
+      s->stopPipe[0] = -1;
+      JNbdFree(s);
+      return VIX_E_FAIL;
+   }
+   err = JNbdListen(s, address, port);
+   if (err != VIX_OK) {
+      JNbdFree(s);
+      return err;
+   }
+   if (pthread_create(&s->prefetchThread, NULL, JNbdPrefetcher, s) != 0) {
+      JNbdFree(s);
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   if (pthread_create(&s->acceptThread, NULL, JNbdAcceptor, s) != 0) {
+      pthread_mutex_lock(&s->lock);
+      s->stopping = TRUE;
+      pthread_cond_signal(&s->prefetchCond);
+      pthread_mutex_unlock(&s->lock);
+      pthread_join(s->prefetchThread, NULL);
+      JNbdFree(s);
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   *server = s;
+   return VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbd_GetPort --
+ *
+ *      Port of a TCP server.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+int
+JNbd_GetPort(const JNbdServer *server)   // IN
+{
+   return server->port;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbd_GetStats --
+ *
+ *      Copy the statistics of a server.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JNbd_GetStats(JNbdServer *server,             // IN
+              int64 stats[JNbdStatCount])     // OUT
+{
+   pthread_mutex_lock(&server->lock);
+   memcpy(stats, server->stats, sizeof server->stats);
+   pthread_mutex_unlock(&server->lock);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JNbd_Stop --
+ *
+ *      Stop a server. See jNbd.h.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Disconnects the clients; the overlay is discarded.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JNbd_Stop(JNbdServer *server)   // IN
+{
+   char c = 0;
+
+   if (server == NULL) {
+      return;
+   }
+   while (write(server->stopPipe[1], &c, 1) < 0 && errno == EINTR) {
+   }
+   pthread_join(server->acceptThread, NULL);
+
+   pthread_mutex_lock(&server->lock);
+   JNbdReap(server, TRUE);
+   server->stopping = TRUE;
+   pthread_cond_signal(&server->prefetchCond);
+   pthread_mutex_unlock(&server->lock);
+   pthread_join(server->prefetchThread, NULL);
+   JNbdFree(server);
+}
@@ -0,0 +1,314 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jProgress.c
+ *
+ *    Progress of the long VixDiskLib operations.
+ *
+ *    VixDiskLib calls the progress callback at every percent, and each
+ *    call into Java costs a JNI upcall: over the hours a large disk takes
+ *    to clone or defragment this adds up to little, but a monitoring
+ *    thread has no other way to know where the operation is than being
+ *    called. Here the callback only stores the percentage in the channel,
+ *    where any thread reads it without a lock, and calls Java at most once
+ *    per interval. Cancelling through the channel is a flag the callback
+ *    checks at each tick, so it does not need an upcall to be seen.
+ */
+
+#include <stdlib.h>
+#include <time.h>
+#include "jProgress.h"
+#include "jUtils.h"
+
+struct JProgress {
+   int32 percent;
+   int64 ticks;
+   int64 upcalls;
+   int32 cancelled;
+   int32 active;
+   uint32 intervalMs;
+};
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JProgressNowUs --
+ *
+ *      Read the monotonic clock.
+ *
+ * Results:
+ *      Current time in microseconds.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static uint64
+JProgressNowUs(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JProgress_Open --
+ *
+ *      Create a channel.
+ *
+ * Results:
+ *      The channel, NULL if out of memory.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+JProgress *
+JProgress_Open(uint32 intervalMs)   // IN: 0 for the default
+{
+   JProgress *channel = calloc(1, sizeof *channel);
+
+   if (channel != NULL) {
+      channel->intervalMs = intervalMs > 0 ? intervalMs :
+                                             JPROGRESS_DEFAULT_INTERVAL_MS;
+   }
+   return channel;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JProgress_Cancel --
+ *
+ *      Raise the cancel flag of a channel.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      The operations of the channel abort at their next tick.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JProgress_Cancel(JProgress *channel)   // IN
+{
+   if (channel != NULL) {
+      __sync_lock_test_and_set(&channel->cancelled, 1);
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JProgress_GetStats --
+ *
+ *      Read the statistics of a channel.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JProgress_GetStats(JProgress *channel,                 // IN
+                   int64 stats[JProgressStatCount])    // OUT
+{
+   stats[JProgressStatPercent] = __sync_fetch_and_add(&channel->percent, 0);
+   stats[JProgressStatTicks] = __sync_fetch_and_add(&channel->ticks, 0);
+   stats[JProgressStatUpcalls] = __sync_fetch_and_add(&channel->upcalls, 0);
+   stats[JProgressStatCancelled] = __sync_fetch_and_add(&channel->cancelled,
+                                                        0);
+   stats[JProgressStatActive] = __sync_fetch_and_add(&channel->active, 0);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JProgress_Close --
+ *
+ *      Free a channel.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JProgress_Close(JProgress *channel)   // IN
+{
+   free(channel);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JProgress_Begin --
+ *
+ *      Prepare the progress of an operation.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Counts the operation as active on its channel.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JProgress_Begin(JProgressCall *call,              // OUT
+                struct JUtilsLogger *logger,      // IN
+                JNIEnv *env,                      // IN
+                jobject progress)                 // IN: may be NULL
+{
+   call->logger = logger;
+   call->progress = progress;
+   call->channel = progress == NULL ? NULL :
+                   (JProgress *)(size_t)JUtils_GetLongField(env, progress,
+                                                            "channel");
+   call->intervalMs = call->channel != NULL ? call->channel->intervalMs :
+                                              JPROGRESS_DEFAULT_INTERVAL_MS;
+   call->lastUpcallUs = 0;
+   call->percent = -1;
+   call->lastUpcallPercent = -1;
+   call->cancelled = FALSE;
+   if (call->channel != NULL) {
+      __sync_lock_test_and_set(&call->channel->percent, 0);
+      __sync_fetch_and_add(&call->channel->active, 1);
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JProgressUpcall --
+ *
+ *      Give a percentage to the Java Progress.
+ *
+ * Results:
+ *      FALSE if Java asks to abort.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JProgressUpcall(JProgressCall *call,   // IN/OUT
+                int percent)           // IN
+{
+   call->lastUpcallUs = JProgressNowUs();
+   call->lastUpcallPercent = percent;
+   if (call->channel != NULL) {
+      __sync_fetch_and_add(&call->channel->upcalls, 1);
+   }
+   return JUtils_LogProgress(call->logger, call->progress, percent);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JProgress_Func --
+ *
+ *      VixDiskLib progress callback: publish the percentage in the channel
+ *      and call Java if the interval has elapsed since the last upcall, or
+ *      the operation completes.
+ *
+ * Results:
+ *      FALSE to abort the operation, when cancelled through the channel or
+ *      by Java.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+Bool
+JProgress_Func(void *progressData,      // IN: JProgressCall
+               int percentCompleted)    // IN
+{
+   JProgressCall *call = progressData;
+
+   call->percent = percentCompleted;
+   if (call->channel != NULL) {
+      __sync_lock_test_and_set(&call->channel->percent, percentCompleted);
+      __sync_fetch_and_add(&call->channel->ticks, 1);
+      if (__sync_fetch_and_add(&call->channel->cancelled, 0)) {
+         call->cancelled = TRUE;
+      }
+   }
+   if (call->cancelled) {
+      return FALSE;
+   }
+   if (call->progress == NULL ||
+       percentCompleted == call->lastUpcallPercent ||
+       (percentCompleted < 100 &&
+        JProgressNowUs() - call->lastUpcallUs <
+        (uint64)call->intervalMs * 1000)) {
+      return TRUE;
+   }
+   if (!JProgressUpcall(call, percentCompleted)) {
+      call->cancelled = TRUE;
+      JProgress_Cancel(call->channel);
+      return FALSE;
+   }
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JProgress_End --
+ *
+ *      Finish the progress of an operation.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Calls Java with the last percentage if it has not seen it.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JProgress_End(JProgressCall *call)   // IN/OUT
+{
+   if (call->progress != NULL && !call->cancelled && call->percent >= 0 &&
+       call->percent != call->lastUpcallPercent) {
+      JProgressUpcall(call, call->percent);
+   }
+   if (call->channel != NULL) {
+      __sync_fetch_and_sub(&call->channel->active, 1);
+   }
+}
@@ -0,0 +1,385 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jScrub.c
+ *
+ *    Verification of the blocks stored on a file target.
+ *
+ *    The blocks are handed out to the worker threads in order. A worker
+ *    taking a block asks the kernel to read ahead the data files of the
+ *    blocks a few steps further, so the disks stay busy while the workers
+ *    hash. The MD5 of every stored file is checked; in deep mode the block
+ *    is then decrypted in place, decoded and its SHA-1 checked against the
+ *    digest it is stored under. The digests of the workers are computed by
+ *    the multi-buffer engine, which batches them across threads.
+ *
+ *    Files are dropped from the page cache once read, so that scrubbing a
+ *    whole repository does not evict the working set of the host.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "jScrub.h"
+#include "jAes.h"
+#include "jMiGz.h"
+
+/*
+ * Files read ahead per worker thread.
+ */
+#define JSCRUB_READAHEAD_PER_THREAD 2
+
+
+typedef struct JScrubJob {
+   JScrubBlock *blocks;
+   int count;
+   const JAesKey *key;        /* NULL if none */
+   Bool shallow;
+   int window;                /* Files read ahead */
+   volatile int next;         /* Next block to verify */
+   volatile int prefetched;   /* Next block to read ahead */
+   volatile int64 badBlocks;
+   volatile int64 bytesRead;
+   volatile int64 bytesVerified;
+} JScrubJob;
+
+typedef struct JScrubBuffer {
+   uint8 *data;
+   size_t capacity;
+} JScrubBuffer;
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JScrubNowUs --
+ *
+ *      Monotonic time in microseconds.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static int64
+JScrubNowUs(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (int64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JScrubReserve --
+ *
+ *      Grow a worker buffer to at least "size" bytes.
+ *
+ * Results:
+ *      FALSE if out of memory.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JScrubReserve(JScrubBuffer *buffer,    // IN/OUT
+              size_t size)             // IN
+{
+   uint8 *data;
+
+   if (size <= buffer->capacity) {
+      return TRUE;
+   }
+   data = realloc(buffer->data, size);
+   if (data == NULL) {
+      return FALSE;
+   }
+   buffer->data = data;
+   buffer->capacity = size;
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JScrubPrefetch --
+ *
+ *      Start reading ahead the files of the blocks up to "limit".
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Fills the page cache.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JScrubPrefetch(JScrubJob *job,   // IN/OUT
+               int limit)        // IN
+{
+   int i;
+
+   if (limit > job->count) {
+      limit = job->count;
+   }
+   while (job->prefetched < limit &&
+          (i = __sync_fetch_and_add(&job->prefetched, 1)) < limit) {
+      int fd = open(job->blocks[i].path, O_RDONLY);
+
+      if (fd >= 0) {
+         posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+         close(fd);
+      }
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JScrubRead --
+ *
+ *      Read the data file of a block.
+ *
+ * Results:
+ *      JScrubOk and the size of the file, JScrubMissing or JScrubReadError.
+ *
+ * Side effects:
+ *      Drops the file from the page cache.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static JScrubStatus
+JScrubRead(const char *path,        // IN
+           JScrubBuffer *buffer,    // IN/OUT
+           size_t *length)          // OUT
+{
+   JScrubStatus status = JScrubOk;
+   struct stat st;
+   size_t done = 0;
+   int fd;
+
+   fd = open(path, O_RDONLY);
+   if (fd < 0) {
+      return JScrubMissing;
+   }
+   if (fstat(fd, &st) != 0 ||
+       !JScrubReserve(buffer, st.st_size > 0 ? (size_t)st.st_size : 1)) {
+      close(fd);
+      return JScrubReadError;
+   }
+   while (done < (size_t)st.st_size) {
+      ssize_t n = pread(fd, buffer->data + done, st.st_size - done, done);
+
+      if (n <= 0) {
+         status = JScrubReadError;
+         break;
+      }
+      done += n;
+   }
+   posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+   close(fd);
+   *length = done;
+   return status;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JScrubVerify --
+ *
+ *      Verify one block.
+ *
+ * Results:
+ *      Status of the block.
+ *
+ * Side effects:
+ *      Updates the byte counters of the job.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static JScrubStatus
+JScrubVerify(JScrubJob *job,             // IN/OUT
+             const JScrubBlock *block,   // IN
+             JScrubBuffer *stored,       // IN/OUT
+             JScrubBuffer *decoded)      // IN/OUT
+{
+   uint8 digest[JMBHASH_SHA1_SIZE];
+   const uint8 *plain;
+   size_t length;
+   JScrubStatus status;
+
+   status = JScrubRead(block->path, stored, &length);
+   if (status != JScrubOk) {
+      return status;
+   }
+   __sync_fetch_and_add(&job->bytesRead, (int64)length);
+   if (!JMbHash_Digest(JMbHashMd5, stored->data, length, digest) ||
+       memcmp(digest, block->md5, JMBHASH_MD5_SIZE) != 0) {
+      return JScrubMd5Mismatch;
+   }
+   if (job->shallow || !(block->flags & JSCRUB_SHA1) ||
+       ((block->flags & JSCRUB_CIPHER) && job->key == NULL)) {
+      return JScrubOk;
+   }
+
+   if (block->flags & JSCRUB_CIPHER) {
+      if (length % JAES_BLOCK_SIZE != 0 || block->cipherOffset < 0 ||
+          (size_t)block->cipherOffset > length) {
+         return JScrubDecodeError;
+      }
+      JAes_DecryptEcb(job->key, stored->data, length);
+      length -= block->cipherOffset;
+   }
+   plain = stored->data;
+   if (block->flags & JSCRUB_COMPRESS) {
+      if (!JScrubReserve(decoded, block->size > 0 ? block->size : 1) ||
+          JMiGz_Decode(stored->data, length, decoded->data, block->size, 1) !=
+             (int64)block->size) {
+         return JScrubDecodeError;
+      }
+      plain = decoded->data;
+      length = block->size;
+   }
+   if (length != block->size) {
+      return JScrubDecodeError;
+   }
+   __sync_fetch_and_add(&job->bytesVerified, (int64)length);
+   if (!JMbHash_Digest(JMbHashSha1, plain, length, digest) ||
+       memcmp(digest, block->sha1, JMBHASH_SHA1_SIZE) != 0) {
+      return JScrubSha1Mismatch;
+   }
+   return JScrubOk;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JScrubWorker --
+ *
+ *      Verify blocks of the job until none is left.
+ *
+ * Results:
+ *      NULL.
+ *
+ * Side effects:
+ *      Sets the status of the blocks.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void *
+JScrubWorker(void *data) // IN: JScrubJob
+{
+   JScrubJob *job = data;
+   JScrubBuffer stored = { NULL, 0 };
+   JScrubBuffer decoded = { NULL, 0 };
+   int i;
+
+   while ((i = __sync_fetch_and_add(&job->next, 1)) < job->count) {
+      JScrubBlock *block = &job->blocks[i];
+
+      JScrubPrefetch(job, i + 1 + job->window);
+      block->status = JScrubVerify(job, block, &stored, &decoded);
+      if (block->status != JScrubOk) {
+         __sync_fetch_and_add(&job->badBlocks, 1);
+      }
+   }
+   free(stored.data);
+   free(decoded.data);
+   return NULL;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JScrub_Run --
+ *
+ *      Verify a set of blocks. See jScrub.h.
+ *
+ * Results:
+ *      FALSE if the CPU is not supported.
+ *
+ * Side effects:
+ *      Starts up to "threads" - 1 threads for the duration of the call.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+Bool
+JScrub_Run(JScrubBlock *blocks,    // IN/OUT
+           int count,              // IN
+           const uint8 *key,       // IN: optional
+           int threads,            // IN
+           Bool shallow,           // IN
+           JScrubStats *stats)     // OUT
+{
+   pthread_t tids[JSCRUB_MAX_THREADS];
+   JAesKey aesKey;
+   JScrubJob job;
+   int64 start = JScrubNowUs();
+   int started = 0;
+   int i;
+
+   if (!JMbHash_IsSupported()) {
+      return FALSE;
+   }
+   memset(&job, 0, sizeof job);
+   if (key != NULL && !shallow) {
+      if (!JAes_SetDecryptKey(&aesKey, key)) {
+         return FALSE;
+      }
+      job.key = &aesKey;
+   }
+   job.blocks = blocks;
+   job.count = count;
+   job.shallow = shallow;
+
+   if (threads < 1) {
+      threads = 1;
+   }
+   if (threads > JSCRUB_MAX_THREADS) {
+      threads = JSCRUB_MAX_THREADS;
+   }
+   if (threads > count) {
+      threads = count > 0 ? count : 1;
+   }
+   job.window = threads * JSCRUB_READAHEAD_PER_THREAD;
+   JScrubPrefetch(&job, job.window);
+   for (i = 1; i < threads; i++) {
+      if (pthread_create(&tids[started], NULL, JScrubWorker, &job) != 0) {
+         break;
+      }
+      started++;
+   }
+   JScrubWorker(&job);
+   for (i = 0; i < started; i++) {
+      pthread_join(tids[i], NULL);
+   }
+   memset(&aesKey, 0, sizeof aesKey);
+
+   stats->blocks = count;
+   stats->badBlocks = job.badBlocks;
+   stats->bytesRead = job.bytesRead;
+   stats->bytesVerified = job.bytesVerified;
+   stats->elapsedUs = JScrubNowUs() - start;
+   return TRUE;
+}
@@ -0,0 +1,427 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jThrottle.c
+ *
+ *    Hierarchical token-bucket bandwidth throttling for VixDiskLib I/O.
+ *
+ *    Buckets may go into debt: a request is charged to all of its buckets
+ *    at once and the caller then sleeps until the most indebted bucket is
+ *    back to zero. Large requests are therefore never starved by a small
+ *    burst size, and concurrent callers are served in arrival order.
+ *
+ *    Limits can be changed at any time. Sleepers are woken up in slices
+ *    and give up their remaining wait as soon as the limits change, so
+ *    lifting a limit takes effect immediately on running jobs.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "vixDiskLib.h"
+#include "jThrottle.h"
+
+#ifdef _WIN32
+#define strdup _strdup
+#endif
+
+#define SLEEP_SLICE_US 100000
+
+
+typedef struct JThrottleBucket {
+   JThrottleScope scope;
+   char *name;                   /* Host or datastore name */
+   VixDiskLibHandle diskHandle;  /* Disk scope only */
+   Bool ownLimit;                /* Limit not inherited from the scope */
+   double rate;                  /* Bytes per second, 0 if unlimited */
+   double burst;
+   double tokens;
+   uint64 lastUs;
+   struct JThrottleBucket *host;       /* Disk scope only */
+   struct JThrottleBucket *datastore;  /* Disk scope only */
+   struct JThrottleBucket *next;
+} JThrottleBucket;
+
+typedef struct JThrottleLimit {
+   uint64 rate;
+   uint64 burst;
+} JThrottleLimit;
+
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static JThrottleBucket gGlobal = { JThrottleScopeGlobal };
+static JThrottleBucket *gBuckets[JThrottleScopeCount];
+static JThrottleLimit gDefaults[JThrottleScopeCount];
+
+/*
+ * Number of limited buckets and scope defaults. The I/O path skips the
+ * lock entirely while it is 0.
+ */
+static volatile int gLimited = 0;
+
+/*
+ * Bumped on every limit change, to cut short pending sleeps.
+ */
+static volatile unsigned int gGeneration = 0;
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JThrottleNowUs --
+ *
+ *      Read the monotonic clock.
+ *
+ * Results:
+ *      Current time in microseconds.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static uint64
+JThrottleNowUs(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JThrottleApply --
+ *
+ *      Set the rate of a bucket. Must be called with gLock held.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Resets the bucket to a full burst.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JThrottleApply(JThrottleBucket *bucket, // IN/OUT
+               uint64 rate,             // IN
+               uint64 burst)            // IN
+{
+   if (bucket->rate > 0) {
+      gLimited--;
+   }
+   bucket->rate = rate;
+   bucket->burst = burst > 0 ? burst :
+                   (double)rate * JTHROTTLE_DEFAULT_BURST_MS / 1000;
+   bucket->tokens = bucket->burst;
+   bucket->lastUs = JThrottleNowUs();
+   if (bucket->rate > 0) {
+      gLimited++;
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JThrottleLookup --
+ *
+ *      Find or create a bucket by name (host, datastore) or by disk
+ *      handle (disk). Must be called with gLock held.
+ *
+ * Results:
+ *      The bucket, or NULL if out of memory.
+ *
+ * Side effects:
+ *      New buckets start with the default limit of their scope.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static JThrottleBucket *
+JThrottleLookup(JThrottleScope scope,        // IN
+                const char *name,            // IN
+                VixDiskLibHandle diskHandle) // IN
+{
+   JThrottleBucket *bucket;
+
+   if (scope == JThrottleScopeGlobal) {
+      return &gGlobal;
+   }
+   for (bucket = gBuckets[scope]; bucket != NULL; bucket = bucket->next) {
+      if (scope == JThrottleScopeDisk ? bucket->diskHandle == diskHandle :
+                                        strcmp(bucket->name, name) == 0) {
+         return bucket;
+      }
+   }
+
+   bucket = calloc(1, sizeof *bucket);
+   if (bucket == NULL) {
+      return NULL;
+   }
+   bucket->scope = scope;
+   bucket->diskHandle = diskHandle;
+   if (name != NULL) {
+      bucket->name = strdup(name);
+      if (bucket->name == NULL) {
+         free(bucket);
+         return NULL;
+      }
+   }
+   JThrottleApply(bucket, gDefaults[scope].rate, gDefaults[scope].burst);
+   bucket->next = gBuckets[scope];
+   gBuckets[scope] = bucket;
+   return bucket;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JThrottleCharge --
+ *
+ *      Refill a bucket and take "bytes" out of it. Must be called with
+ *      gLock held.
+ *
+ * Results:
+ *      Microseconds until the bucket is out of debt.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static uint64
+JThrottleCharge(JThrottleBucket *bucket, // IN/OUT
+                uint64 bytes,            // IN
+                uint64 nowUs)            // IN
+{
+   if (bucket == NULL || bucket->rate <= 0) {
+      return 0;
+   }
+   bucket->tokens += bucket->rate * (nowUs - bucket->lastUs) / 1000000;
+   if (bucket->tokens > bucket->burst) {
+      bucket->tokens = bucket->burst;
+   }
+   bucket->lastUs = nowUs;
+   bucket->tokens -= bytes;
+   if (bucket->tokens >= 0) {
+      return 0;
+   }
+   return (uint64)(-bucket->tokens * 1000000 / bucket->rate);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JThrottle_SetLimit --
+ *
+ *      Set the limit of a bucket or the default of a scope.
+ *
+ * Results:
+ *      TRUE on success, FALSE on invalid scope or out of memory.
+ *
+ * Side effects:
+ *      Pending sleeps are cut short.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+Bool
+JThrottle_SetLimit(JThrottleScope scope,        // IN
+                   const char *name,            // IN
+                   VixDiskLibHandle diskHandle, // IN
+                   uint64 bytesPerSec,          // IN
+                   uint64 burstBytes)           // IN
+{
+   JThrottleBucket *bucket;
+   Bool isDefault;
+   Bool ok = TRUE;
+
+   if (scope < JThrottleScopeGlobal || scope >= JThrottleScopeCount) {
+      return FALSE;
+   }
+   isDefault = (scope == JThrottleScopeHost && name == NULL) ||
+               (scope == JThrottleScopeDatastore && name == NULL) ||
+               (scope == JThrottleScopeDisk && diskHandle == NULL);
+
+   pthread_mutex_lock(&gLock);
+   if (scope == JThrottleScopeGlobal) {
+      JThrottleApply(&gGlobal, bytesPerSec, burstBytes);
+   } else if (isDefault) {
+      if (gDefaults[scope].rate > 0) {
+         gLimited--;
+      }
+      gDefaults[scope].rate = bytesPerSec;
+      gDefaults[scope].burst = burstBytes;
+      if (gDefaults[scope].rate > 0) {
+         gLimited++;
+      }
+      for (bucket = gBuckets[scope]; bucket != NULL; bucket = bucket->next) {
+         if (!bucket->ownLimit) {
+            JThrottleApply(bucket, bytesPerSec, burstBytes);
+         }
+      }
+   } else {
+      bucket = JThrottleLookup(scope, name, diskHandle);
+      if (bucket != NULL) {
+         JThrottleApply(bucket, bytesPerSec, burstBytes);
+         bucket->ownLimit = TRUE;
+      } else {
+         ok = FALSE;
+      }
+   }
+   gGeneration++;
+   pthread_mutex_unlock(&gLock);
+   return ok;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JThrottle_SetDiskTags --
+ *
+ *      Attach a disk handle to its host and datastore buckets.
+ *
+ * Results:
+ *      TRUE on success, FALSE if out of memory.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+Bool
+JThrottle_SetDiskTags(VixDiskLibHandle diskHandle, // IN
+                      const char *host,            // IN
+                      const char *datastore)       // IN
+{
+   JThrottleBucket *disk;
+   Bool ok = FALSE;
+
+   pthread_mutex_lock(&gLock);
+   disk = JThrottleLookup(JThrottleScopeDisk, NULL, diskHandle);
+   if (disk != NULL) {
+      ok = TRUE;
+      if (host != NULL && *host != '\0') {
+         disk->host = JThrottleLookup(JThrottleScopeHost, host, NULL);
+         ok = disk->host != NULL;
+      }
+      if (datastore != NULL && *datastore != '\0') {
+         disk->datastore = JThrottleLookup(JThrottleScopeDatastore,
+                                           datastore, NULL);
+         ok = ok && disk->datastore != NULL;
+      }
+   }
+   pthread_mutex_unlock(&gLock);
+   return ok;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JThrottle_Consume --
+ *
+ *      Charge I/O to the global, host, datastore and disk buckets of a
+ *      disk handle and wait until all of them are back within their rate.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      May sleep.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JThrottle_Consume(VixDiskLibHandle diskHandle, // IN
+                  uint64 bytes)                // IN
+{
+   JThrottleBucket *disk;
+   uint64 nowUs;
+   uint64 waitUs = 0;
+   uint64 bucketWaitUs;
+   unsigned int generation;
+
+   if (gLimited == 0) {
+      return;
+   }
+
+   pthread_mutex_lock(&gLock);
+   nowUs = JThrottleNowUs();
+   disk = JThrottleLookup(JThrottleScopeDisk, NULL, diskHandle);
+   waitUs = JThrottleCharge(&gGlobal, bytes, nowUs);
+   if (disk != NULL) {
+      bucketWaitUs = JThrottleCharge(disk->host, bytes, nowUs);
+      waitUs = bucketWaitUs > waitUs ? bucketWaitUs : waitUs;
+      bucketWaitUs = JThrottleCharge(disk->datastore, bytes, nowUs);
+      waitUs = bucketWaitUs > waitUs ? bucketWaitUs : waitUs;
+      bucketWaitUs = JThrottleCharge(disk, bytes, nowUs);
+      waitUs = bucketWaitUs > waitUs ? bucketWaitUs : waitUs;
+   }
+   generation = gGeneration;
+   pthread_mutex_unlock(&gLock);
+
+   while (waitUs > 0 && generation == gGeneration) {
+      uint64 sliceUs = waitUs < SLEEP_SLICE_US ? waitUs : SLEEP_SLICE_US;
+      struct timespec ts;
+
+      ts.tv_sec = sliceUs / 1000000;
+      ts.tv_nsec = (sliceUs % 1000000) * 1000;
+      nanosleep(&ts, NULL);
+      waitUs -= sliceUs;
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JThrottle_Release --
+ *
+ *      Drop the bucket of a disk handle. Host and datastore buckets are
+ *      kept, with their limits, for the disks opened later.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Frees memory.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JThrottle_Release(VixDiskLibHandle diskHandle) // IN
+{
+   JThrottleBucket **link;
+
+   pthread_mutex_lock(&gLock);
+   for (link = &gBuckets[JThrottleScopeDisk]; *link != NULL;
+        link = &(*link)->next) {
+      if ((*link)->diskHandle == diskHandle) {
+         JThrottleBucket *bucket = *link;
+
+         *link = bucket->next;
+         if (bucket->rate > 0) {
+            gLimited--;
+         }
+         free(bucket);
+         break;
+      }
+   }
+   pthread_mutex_unlock(&gLock);
+}
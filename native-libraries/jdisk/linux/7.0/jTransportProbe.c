@@ -0,0 +1,528 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jTransportProbe.c
+ *
+ *    Transport mode selection by timed reads through each mode.
+ *
+ *    VixDiskLib takes the first mode of the list that connects, and falls
+ *    back to the next one without telling: a backup asking for
+ *    "hotadd:nbdssl" may well run over NBD, and a mode that works is not
+ *    always the fastest one. Each mode is given a connection of its own,
+ *    opens the disk and reads a few chunks spread over it; the modes that
+ *    worked are then ordered by the rate measured. Opening a disk through
+ *    HotAdd or SAN takes seconds, so the result is kept per host,
+ *    datastore and modes for a while.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "jTransportProbe.h"
+
+#define JTRANSPORTPROBE_CHUNK_SECTORS 2048         /* 1MB per read */
+#define JTRANSPORTPROBE_MAX_MODES 8
+#define JTRANSPORTPROBE_REPORT_SIZE 1024
+
+typedef struct {
+   const char *mode;
+   VixError err;
+   char actual[32];                 /* Mode VixDiskLib used instead */
+   double bytesPerSec;
+   int64 openUs;
+} JTransportProbeResult;
+
+typedef struct JTransportProbeEntry {
+   char *key;
+   char *ordered;
+   char *report;
+   int64 expiresUs;
+   struct JTransportProbeEntry *next;
+} JTransportProbeEntry;
+
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static JTransportProbeEntry *gEntries = NULL;
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JTransportProbeNowUs --
+ *
+ *      Monotonic time in microseconds.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static int64
+JTransportProbeNowUs(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (int64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JTransportProbeFreeEntry --
+ *
+ *      Free a cache entry.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JTransportProbeFreeEntry(JTransportProbeEntry *entry)   // IN
+{
+   free(entry->key);
+   free(entry->ordered);
+   free(entry->report);
+   free(entry);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JTransportProbeKey --
+ *
+ *      Build the cache key of a probe: the key of the caller, the
+ *      datastore found in the "[datastore] folder/disk.vmdk" path of the
+ *      disk and the modes.
+ *
+ * Results:
+ *      The key, NULL if out of memory.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static char *
+JTransportProbeKey(const char *cacheKey,   // IN
+                   const char *diskPath,   // IN
+                   const char *modes)      // IN
+{
+   const char *end = NULL;
+   int datastoreLength = 0;
+   size_t size;
+   char *key;
+
+   if (diskPath != NULL && diskPath[0] == '[' &&
+       (end = strchr(diskPath, ']')) != NULL) {
+      datastoreLength = (int)(end - diskPath - 1);
+   }
+   size = strlen(cacheKey) + datastoreLength + strlen(modes) + 3;
+   key = malloc(size);
+   if (key != NULL) {
+      snprintf(key, size, "%s|%.*s|%s", cacheKey, datastoreLength,
+               diskPath != NULL ? diskPath + 1 : "", modes);
+   }
+   return key;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JTransportProbeLookup --
+ *
+ *      Find a result still valid, dropping the expired ones.
+ *
+ * Results:
+ *      TRUE and copies of the result if found.
+ *
+ * Side effects:
+ *      Frees the expired entries.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JTransportProbeLookup(const char *key,   // IN
+                      char **ordered,    // OUT
+                      char **report)     // OUT
+{
+   JTransportProbeEntry **link = &gEntries;
+   int64 now = JTransportProbeNowUs();
+   Bool found = FALSE;
+
+   pthread_mutex_lock(&gLock);
+   while (*link != NULL) {
+      JTransportProbeEntry *entry = *link;
+
+      if (entry->expiresUs <= now) {
+         *link = entry->next;
+         JTransportProbeFreeEntry(entry);
+         continue;
+      }
+      if (!found && strcmp(entry->key, key) == 0) {
+         *ordered = strdup(entry->ordered);
+         *report = strdup(entry->report);
+         found = *ordered != NULL && *report != NULL;
+         if (!found) {
+            free(*ordered);
+            free(*report);
+         }
+      }
+      link = &entry->next;
+   }
+   pthread_mutex_unlock(&gLock);
+   return found;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JTransportProbeStore --
+ *
+ *      Keep a result "cacheSeconds", replacing the one of the same key.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Takes "key" over.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JTransportProbeStore(char *key,             // IN
+                     const char *ordered,   // IN
+                     const char *report,    // IN
+                     uint32 cacheSeconds)   // IN
+{
+   JTransportProbeEntry **link;
+   JTransportProbeEntry *entry = calloc(1, sizeof *entry);
+
+   if (entry == NULL || (entry->ordered = strdup(ordered)) == NULL ||
+       (entry->report = strdup(report)) == NULL) {
+      if (entry != NULL) {
+         free(entry->ordered);
+         free(entry);
+      }
+      free(key);
+      return;
+   }
+   entry->key = key;
+   entry->expiresUs = JTransportProbeNowUs() +
+                      (int64)cacheSeconds * 1000000;
+
+   pthread_mutex_lock(&gLock);
+   for (link = &gEntries; *link != NULL; link = &(*link)->next) {
+      if (strcmp((*link)->key, key) == 0) {
+         JTransportProbeEntry *old = *link;
+
+         *link = old->next;
+         JTransportProbeFreeEntry(old);
+         break;
+      }
+   }
+   entry->next = gEntries;
+   gEntries = entry;
+   pthread_mutex_unlock(&gLock);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JTransportProbeMode --
+ *
+ *      Connect through one mode, open the disk and time the reads of
+ *      "probeSectors" sectors, in chunks spread over the disk so that no
+ *      cache on the way serves them all.
+ *
+ * Results:
+ *      The rate, or the error, in "result".
+ *
+ * Side effects:
+ *      Connects to the host.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JTransportProbeMode(const VixDiskLibConnectParams *params,   // IN
+                    const char *ssMoref,                     // IN
+                    const char *diskPath,                    // IN
+                    uint32 probeSectors,                     // IN
+                    JTransportProbeResult *result)           // IN/OUT
+{
+   VixDiskLibConnection conn = NULL;
+   VixDiskLibHandle disk = NULL;
+   VixDiskLibInfo *info = NULL;
+   VixDiskLibSectorType capacity, stride;
+   uint8 *buf = NULL;
+   const char *actual;
+   uint32 chunks, i;
+   uint64 bytes = 0;
+   int64 start;
+   VixError err;
+
+   err = VixDiskLib_ConnectEx(params, TRUE, ssMoref, result->mode, &conn);
+   if (err != VIX_OK) {
+      goto out;
+   }
+   start = JTransportProbeNowUs();
+   err = VixDiskLib_Open(conn, diskPath, VIXDISKLIB_FLAG_OPEN_READ_ONLY,
+                         &disk);
+   result->openUs = JTransportProbeNowUs() - start;
+   if (err != VIX_OK) {
+      goto out;
+   }
+   actual = VixDiskLib_GetTransportMode(disk);
+   if (actual == NULL || strcmp(actual, result->mode) != 0) {
+      snprintf(result->actual, sizeof result->actual, "%s",
+               actual != NULL ? actual : "?");
+      err = VIX_E_NOT_SUPPORTED;
+      goto out;
+   }
+   err = VixDiskLib_GetInfo(disk, &info);
+   if (err != VIX_OK) {
+      goto out;
+   }
+   capacity = info->capacity;
+   VixDiskLib_FreeInfo(info);
+   buf = malloc(JTRANSPORTPROBE_CHUNK_SECTORS * VIXDISKLIB_SECTOR_SIZE);
+   if (buf == NULL) {
+      err = VIX_E_OUT_OF_MEMORY;
+      goto out;
+   }
+
+   chunks = probeSectors / JTRANSPORTPROBE_CHUNK_SECTORS;
+   if (chunks == 0) {
+      chunks = 1;
+   }
+   stride = capacity / chunks;
+   stride -= stride % JTRANSPORTPROBE_CHUNK_SECTORS;
+   start = JTransportProbeNowUs();
+   for (i = 0; i < chunks && err == VIX_OK; i++) {
+      VixDiskLibSectorType sector = i * stride;
+      VixDiskLibSectorType count = JTRANSPORTPROBE_CHUNK_SECTORS;
+
+      if (sector >= capacity) {
+         break;
+      }
+      if (count > capacity - sector) {
+         count = capacity - sector;
+      }
+      err = VixDiskLib_Read(disk, sector, count, buf);
+      bytes += count * VIXDISKLIB_SECTOR_SIZE;
+   }
+   if (err == VIX_OK) {
+      int64 elapsed = JTransportProbeNowUs() - start;
+
+      result->bytesPerSec = bytes * 1000000.0 / (elapsed > 0 ? elapsed : 1);
+   }
+
+out:
+   result->err = err;
+   free(buf);
+   if (disk != NULL) {
+      VixDiskLib_Close(disk);
+   }
+   if (conn != NULL) {
+      VixDiskLib_Disconnect(conn);
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JTransportProbeAppend --
+ *
+ *      printf to the end of a report, truncating it if full.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JTransportProbeAppend(char *report,         // IN/OUT
+                      const char *format,   // IN
+                      ...)
+{
+   size_t length = strlen(report);
+   va_list args;
+
+   va_start(args, format);
+   vsnprintf(report + length, JTRANSPORTPROBE_REPORT_SIZE - length, format,
+             args);
+   va_end(args);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JTransportProbe_Run --
+ *
+ *      Probe the transport modes of a disk, or take the result of an
+ *      earlier probe.
+ *
+ * Results:
+ *      VIX_OK, VIX_E_INVALID_ARG, VIX_E_OUT_OF_MEMORY, or the error of the
+ *      first mode if none works.
+ *
+ * Side effects:
+ *      Opens the disk once per mode not cached.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JTransportProbe_Run(const VixDiskLibConnectParams *params,   // IN
+                    const char *ssMoref,                     // IN
+                    const char *modes,                       // IN
+                    const char *diskPath,                    // IN
+                    const char *cacheKey,                    // IN
+                    uint32 probeSectors,                     // IN
+                    uint32 cacheSeconds,                     // IN
+                    char **ordered,                          // OUT
+                    char **report,                           // OUT
+                    Bool *cached)                            // OUT
+{
+   JTransportProbeResult results[JTRANSPORTPROBE_MAX_MODES];
+   int order[JTRANSPORTPROBE_MAX_MODES];
+   int count = 0, working = 0, i, j;
+   char *copy, *mode, *save = NULL, *key;
+   VixError err = VIX_OK;
+
+   *ordered = NULL;
+   *report = NULL;
+   *cached = FALSE;
+   if (params == NULL) {
+      return VIX_E_INVALID_ARG;
+   }
+   if (modes == NULL || modes[0] == '\0') {
+      modes = VixDiskLib_ListTransportModes();
+   }
+   if (modes == NULL || modes[0] == '\0') {
+      return VIX_E_NOT_SUPPORTED;
+   }
+   if (probeSectors == 0) {
+      probeSectors = JTRANSPORTPROBE_DEFAULT_SECTORS;
+   }
+
+   key = JTransportProbeKey(cacheKey != NULL ? cacheKey : "", diskPath,
+                            modes);
+   if (key == NULL) {
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   if (cacheSeconds > 0 && JTransportProbeLookup(key, ordered, report)) {
+      free(key);
+      *cached = TRUE;
+      return VIX_OK;
+   }
+
+   copy = strdup(modes);
+   *ordered = malloc(strlen(modes) + 1);
+   *report = calloc(1, JTRANSPORTPROBE_REPORT_SIZE);
+   if (copy == NULL || *ordered == NULL || *report == NULL) {
+      err = VIX_E_OUT_OF_MEMORY;
+      goto out;
+   }
+
+   for (mode = strtok_r(copy, ":", &save);
+        mode != NULL && count < JTRANSPORTPROBE_MAX_MODES;
+        mode = strtok_r(NULL, ":", &save)) {
+      JTransportProbeResult *result = &results[count++];
+
+      memset(result, 0, sizeof *result);
+      result->mode = mode;
+      JTransportProbeMode(params, ssMoref, diskPath, probeSectors, result);
+      if (result->err == VIX_OK) {
+         /* Insertion sort, fastest first */
+         for (j = working; j > 0 &&
+              results[order[j - 1]].bytesPerSec < result->bytesPerSec; j--) {
+            order[j] = order[j - 1];
+         }
+         order[j] = count - 1;
+         working++;
+      }
+   }
+
+   (*ordered)[0] = '\0';
+   for (i = 0; i < working; i++) {
+      if (i > 0) {
+         strcat(*ordered, ":");
+      }
+      strcat(*ordered, results[order[i]].mode);
+   }
+   for (i = 0; i < count; i++) {
+      const JTransportProbeResult *result = &results[i];
+
+      JTransportProbeAppend(*report, "%s%s ", i > 0 ? ", " : "",
+                            result->mode);
+      if (result->err == VIX_OK) {
+         JTransportProbeAppend(*report, "%.1f MB/s (open %.1f s)",
+                               result->bytesPerSec / (1024 * 1024),
+                               result->openUs / 1000000.0);
+      } else if (result->actual[0] != '\0') {
+         JTransportProbeAppend(*report, "fell back to %s", result->actual);
+      } else {
+         JTransportProbeAppend(*report, "failed (%llu)",
+                               (unsigned long long)result->err);
+      }
+   }
+
+   if (working == 0) {
+      err = count > 0 ? results[0].err : VIX_E_NOT_SUPPORTED;
+   } else if (cacheSeconds > 0) {
+      JTransportProbeStore(key, *ordered, *report, cacheSeconds);
+      key = NULL;
+   }
+
+out:
+   free(key);
+   free(copy);
+   if (err != VIX_OK) {
+      free(*ordered);
+      free(*report);
+      *ordered = NULL;
+      *report = NULL;
+   }
+   return err;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JTransportProbe_Flush --
+ *
+ *      Drop every cached result.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Frees memory.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+JTransportProbe_Flush(void)
+{
+   JTransportProbeEntry *entry;
+
+   pthread_mutex_lock(&gLock);
+   while ((entry = gEntries) != NULL) {
+      gEntries = entry->next;
+      JTransportProbeFreeEntry(entry);
+   }
+   pthread_mutex_unlock(&gLock);
+}
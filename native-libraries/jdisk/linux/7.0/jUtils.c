@@ -8,9 +8,11 @@
  *    Some helper functions for implementing JNI bindings.
  */
 
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <stdio.h>
+#include <pthread.h>
 #include "jni.h"
 #include "vixDiskLib.h"
 #include "jUtils.h"
@@ -63,6 +65,18 @@ struct jUtilsAsyncCallback {
 static jmethodID gAsyncCallbackId = NULL; /* ID for the callback method */
 
 
+/*
+ * Per-thread staging buffer for the synchronous byte[] I/O paths.
+ */
+typedef struct JUtilsStaging {
+   uint8 *buf[JUtilsStagingSlotCount];
+   size_t size[JUtilsStagingSlotCount];
+} JUtilsStaging;
+
+static pthread_key_t gStagingKey;
+static pthread_once_t gStagingOnce = PTHREAD_ONCE_INIT;
+
+
 /*
  *
  * Primitives for reading/writing Java data types from C
@@ -835,3 +849,142 @@ JUtils_ExitLogging(JUtilsLogger *jLogger) // IN: Logging context for module
 
    free(jLogger);
 }
+
+
+/*
+ *
+ * Staging buffers for copying byte[] data to and from VixDiskLib
+ *
+ */
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JUtilsStagingFree --
+ *
+ *      Thread exit destructor of the staging buffer.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Frees memory.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JUtilsStagingFree(void *data) // IN: JUtilsStaging of the exiting thread
+{
+   JUtilsStaging *staging = data;
+   int slot;
+
+   for (slot = 0; slot < JUtilsStagingSlotCount; slot++) {
+      free(staging->buf[slot]);
+   }
+   free(staging);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JUtilsStagingInit --
+ *
+ *      Create the thread-local key of the staging buffers.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JUtilsStagingInit(void)
+{
+   pthread_key_create(&gStagingKey, JUtilsStagingFree);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JUtils_GetStagingSlot --
+ *
+ *      Return a sector aligned buffer of at least "size" bytes owned by
+ *      the calling thread. The buffer of a slot is reused by the next call
+ *      on the same thread, and only grows, so the steady state of a dump or
+ *      restore thread allocates nothing.
+ *
+ * Results:
+ *      The buffer, or NULL if out of memory.
+ *
+ * Side effects:
+ *      May allocate memory, freed when the thread exits.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+uint8 *
+JUtils_GetStagingSlot(JUtilsStagingSlot slot, // IN: Buffer of the thread
+                      size_t size)            // IN: Number of bytes needed
+{
+   JUtilsStaging *staging;
+   void *buf = NULL;
+
+   if (slot < 0 || slot >= JUtilsStagingSlotCount) {
+      return NULL;
+   }
+   if (size == 0) {
+      size = VIXDISKLIB_SECTOR_SIZE;
+   }
+   pthread_once(&gStagingOnce, JUtilsStagingInit);
+   staging = pthread_getspecific(gStagingKey);
+   if (staging == NULL) {
+      staging = calloc(1, sizeof *staging);
+      if (staging == NULL) {
+         return NULL;
+      }
+      pthread_setspecific(gStagingKey, staging);
+   }
+   if (staging->size[slot] < size) {
+      if (posix_memalign(&buf, VIXDISKLIB_SECTOR_SIZE, size) != 0) {
+         return NULL;
+      }
+      free(staging->buf[slot]);
+      staging->buf[slot] = buf;
+      staging->size[slot] = size;
+   }
+   return staging->buf[slot];
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JUtils_GetStagingBuffer --
+ *
+ *      Return the I/O staging buffer of the calling thread.
+ *
+ *      Copying exactly the transferred bytes through this buffer with
+ *      Get/SetByteArrayRegion replaces GetByteArrayElements, which copies
+ *      the whole Java array in and, for reads, back out again.
+ *
+ * Results:
+ *      The buffer, or NULL if out of memory.
+ *
+ * Side effects:
+ *      May allocate memory, freed when the thread exits.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+uint8 *
+JUtils_GetStagingBuffer(size_t size) // IN: Number of bytes needed
+{
+   return JUtils_GetStagingSlot(JUtilsStagingSlotIo, size);
+}
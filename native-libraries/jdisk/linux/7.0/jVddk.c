@@ -0,0 +1,1176 @@
+/* **************************************************************************
+ * Copyright 2021 VMware, Inc.  All rights reserved. -- VMware Confidential
+ * **************************************************************************/
+
+/*
+ *  jVddk.c
+ *
+ *    Runtime loading of the installed VixDiskLib.
+ *
+ *    libjDiskLib is no longer linked against one VixDiskLib: the one of the
+ *    VDDK installed is opened by InitJNI/InitExJNI and its functions
+ *    resolved into a table, so that one build runs on VDDK 6.5 to 7.0. The
+ *    VixDiskLib_* functions the rest of the library calls are defined here
+ *    and go through the table. What an older VixDiskLib lacks is emulated:
+ *
+ *    - QueryAllocatedBlocks (6.7) reads the chunks and reports the ones not
+ *      all zero, which keeps a copy thin even if it saves no read;
+ *    - AllocateConnectParams (6.7) allocates the 7.0 structure, which
+ *      extends the older one;
+ *    - GetInfo copies the older structure into the 7.0 one, which adds the
+ *      sector sizes;
+ *    - GetConnectParams copies the older structure into the 7.0 one, with
+ *      a VMX spec before 6.7;
+ *    - ReadAsync/WriteAsync complete synchronously.
+ *
+ *    The structures of vixDiskLib.h 7.0 only append fields to the older
+ *    ones, so an older VixDiskLib reads the part it knows of a structure
+ *    the caller passes in. A structure an older VixDiskLib returns is
+ *    shorter than the 7.0 one and is copied into it before the caller
+ *    reads it, as GetInfo and GetConnectParams do.
+ */
+
+#include <dlfcn.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "jVddk.h"
+/* VixDiskLib_IsFaultEnabled is defined by jDiskLib.c */
+#define VDDK_FAULT_IS_EXTERN
+#include "vddkFaultInjection.h"
+
+#define JVDDK_LIBRARY "libvixDiskLib.so"
+
+/*
+ * VixDiskLib functions, without their prefix: the ones every supported
+ * VixDiskLib exports, and the ones emulated when missing.
+ */
+#define JVDDK_REQUIRED(F)                                                  \
+   F(InitEx) F(Init) F(Exit) F(ListTransportModes) F(Cleanup) F(Connect)   \
+   F(PrepareForAccess) F(ConnectEx) F(Disconnect) F(EndAccess) F(Create)   \
+   F(CreateChild) F(Open) F(GetInfo) F(FreeInfo) F(GetTransportMode)       \
+   F(Close) F(Read) F(Write) F(Flush) F(ReadMetadata) F(WriteMetadata)     \
+   F(GetMetadataKeys) F(Unlink) F(Grow) F(Shrink) F(Defragment) F(Rename)  \
+   F(Clone) F(GetErrorText) F(FreeErrorText) F(IsAttachPossible)           \
+   F(Attach) F(SpaceNeededForClone) F(CheckRepair) F(GetConnectParams)     \
+   F(FreeConnectParams)
+#define JVDDK_OPTIONAL(F)                                                  \
+   F(QueryAllocatedBlocks) F(FreeBlockList) F(ReadAsync) F(WriteAsync)     \
+   F(Wait) F(AllocateConnectParams) F(SetInjectedFault)
+
+#define JVDDK_FIELD(name) __typeof__(VixDiskLib_##name) *name;
+
+typedef struct {
+   JVDDK_REQUIRED(JVDDK_FIELD)
+   JVDDK_OPTIONAL(JVDDK_FIELD)
+   void (*PerturbEnable)(const char *fName, int enable);   /* Optional */
+} JVddkFuncs;
+
+/*
+ * Connect params allocated here: by AllocateConnectParams for a VixDiskLib
+ * before 6.7, or by GetConnectParams for one before 7.0.
+ */
+typedef struct JVddkParams {
+   VixDiskLibConnectParams *params;
+   Bool copied;                        /* The strings are ours to free */
+   struct JVddkParams *next;
+} JVddkParams;
+
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static void *gLibrary = NULL;
+static JVddkFuncs gFuncs;
+static uint32 gCapabilities = 0;
+static Bool gLoaded = FALSE;
+static char gLoadError[512];
+static JVddkParams *gParams = NULL;
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JVddkOpen --
+ *
+ *      dlopen the VixDiskLib of "libDir"/lib64, else the one of the library
+ *      search path, trying the name with the major version first.
+ *
+ * Results:
+ *      The library handle, NULL with gLoadError set on failure.
+ *
+ * Side effects:
+ *      Loads the library and its dependencies.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void *
+JVddkOpen(const char *libDir,   // IN: optional
+          uint32 major)         // IN
+{
+   char versioned[64];
+   char path[4096];
+   void *library = NULL;
+
+   snprintf(versioned, sizeof versioned, JVDDK_LIBRARY ".%u", major);
+   if (libDir != NULL && libDir[0] != '\0') {
+      snprintf(path, sizeof path, "%s/lib64/%s", libDir, versioned);
+      library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+      if (library == NULL) {
+         snprintf(path, sizeof path, "%s/lib64/" JVDDK_LIBRARY, libDir);
+         library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+      }
+   }
+   if (library == NULL) {
+      library = dlopen(versioned, RTLD_NOW | RTLD_LOCAL);
+   }
+   if (library == NULL) {
+      library = dlopen(JVDDK_LIBRARY, RTLD_NOW | RTLD_LOCAL);
+   }
+   if (library == NULL) {
+      const char *why = dlerror();
+
+      snprintf(gLoadError, sizeof gLoadError, "%s",
+               why != NULL ? why : "cannot open " JVDDK_LIBRARY);
+   }
+   return library;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JVddk_Load --
+ *
+ *      Load the VixDiskLib and fill the function table.
+ *
+ * Results:
+ *      VIX_OK, VIX_E_FILE_NOT_FOUND if the library cannot be opened,
+ *      VIX_E_NOT_SUPPORTED if it lacks a required function.
+ *
+ * Side effects:
+ *      The VixDiskLib_* functions start calling the library.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JVddk_Load(const char *libDir,   // IN: optional
+           uint32 major,         // IN
+           uint32 minor)         // IN
+{
+   JVddkFuncs funcs;
+   void *library;
+   VixError err = VIX_OK;
+
+   pthread_mutex_lock(&gLock);
+   if (gLoaded) {
+      pthread_mutex_unlock(&gLock);
+      return VIX_OK;
+   }
+   gLoadError[0] = '\0';
+   library = JVddkOpen(libDir, major);
+   if (library == NULL) {
+      pthread_mutex_unlock(&gLock);
+      return VIX_E_FILE_NOT_FOUND;
+   }
+
+   memset(&funcs, 0, sizeof funcs);
+#define JVDDK_RESOLVE_REQUIRED(name)                                       \
+   funcs.name = dlsym(library, "VixDiskLib_" #name);                       \
+   if (funcs.name == NULL && err == VIX_OK) {                              \
+      snprintf(gLoadError, sizeof gLoadError, "VixDiskLib_" #name          \
+               " missing from " JVDDK_LIBRARY);                            \
+      err = VIX_E_NOT_SUPPORTED;                                           \
+   }
+#define JVDDK_RESOLVE_OPTIONAL(name)                                       \
+   funcs.name = dlsym(library, "VixDiskLib_" #name);
+   JVDDK_REQUIRED(JVDDK_RESOLVE_REQUIRED)
+   JVDDK_OPTIONAL(JVDDK_RESOLVE_OPTIONAL)
+#undef JVDDK_RESOLVE_REQUIRED
+#undef JVDDK_RESOLVE_OPTIONAL
+   funcs.PerturbEnable = dlsym(library, "Perturb_Enable");
+
+   if (err != VIX_OK) {
+      dlclose(library);
+      pthread_mutex_unlock(&gLock);
+      return err;
+   }
+
+   /* The list comes with its own free function */
+   if (funcs.FreeBlockList == NULL) {
+      funcs.QueryAllocatedBlocks = NULL;
+   }
+   gCapabilities = 0;
+   if (funcs.QueryAllocatedBlocks != NULL) {
+      gCapabilities |= JVDDK_CAP_QUERY_ALLOCATED;
+   }
+   if (funcs.ReadAsync != NULL && funcs.WriteAsync != NULL &&
+       funcs.Wait != NULL) {
+      gCapabilities |= JVDDK_CAP_ASYNC_IO;
+   } else {
+      funcs.ReadAsync = NULL;
+      funcs.WriteAsync = NULL;
+      funcs.Wait = NULL;
+   }
+   if (funcs.AllocateConnectParams != NULL) {
+      gCapabilities |= JVDDK_CAP_CONNECT_PARAMS;
+   }
+   if (major >= 7) {
+      gCapabilities |= JVDDK_CAP_SECTOR_SIZE;
+   }
+   if (funcs.SetInjectedFault != NULL) {
+      gCapabilities |= JVDDK_CAP_FAULT_INJECTION;
+   }
+   gFuncs = funcs;
+   gLibrary = library;
+   gLoaded = TRUE;
+   pthread_mutex_unlock(&gLock);
+   return VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JVddk_LoadError --
+ *
+ *      Why the last load failed.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+const char *
+JVddk_LoadError(void)
+{
+   return gLoadError[0] != '\0' ? gLoadError : NULL;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JVddk_Capabilities --
+ *
+ *      JVDDK_CAP_* mask of the VixDiskLib loaded.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+uint32
+JVddk_Capabilities(void)
+{
+   return gLoaded ? gCapabilities : 0;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JVddk_PerturbEnable --
+ *
+ *      Perturb_Enable of the VixDiskLib loaded, when it exports it.
+ *
+ * Results:
+ *      VIX_OK, VIX_E_NOT_SUPPORTED if the library is not loaded or does not
+ *      have it.
+ *
+ * Side effects:
+ *      Enables or disables the perturbation of a VixDiskLib function.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+JVddk_PerturbEnable(const char *fName,   // IN
+                    int enable)          // IN
+{
+   if (!gLoaded || gFuncs.PerturbEnable == NULL || fName == NULL) {
+      return VIX_E_NOT_SUPPORTED;
+   }
+   gFuncs.PerturbEnable(fName, enable);
+   return VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JVddkIsZero --
+ *
+ *      Whether a buffer holds only zeroes.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JVddkIsZero(const uint8 *buf,   // IN
+            size_t length)      // IN
+{
+   const uint64 *words = (const uint64 *)buf;
+   size_t i;
+
+   for (i = 0; i < length / sizeof *words; i++) {
+      if (words[i] != 0) {
+         return FALSE;
+      }
+   }
+   for (i = length - length % sizeof *words; i < length; i++) {
+      if (buf[i] != 0) {
+         return FALSE;
+      }
+   }
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JVddkScanAllocatedBlocks --
+ *
+ *      QueryAllocatedBlocks of a VixDiskLib without it: read the range
+ *      chunk by chunk and report the chunks not all zero, merged.
+ *
+ * Results:
+ *      VixError of the reads. On VIX_OK, "*blockList" is freed with free().
+ *
+ * Side effects:
+ *      Reads the whole range.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static VixError
+JVddkScanAllocatedBlocks(VixDiskLibHandle diskHandle,        // IN
+                         VixDiskLibSectorType startSector,   // IN
+                         VixDiskLibSectorType numSectors,    // IN
+                         VixDiskLibSectorType chunkSize,     // IN
+                         VixDiskLibBlockList **blockList)    // OUT
+{
+   VixDiskLibSectorType end = startSector + numSectors;
+   VixDiskLibSectorType pos;
+   VixDiskLibBlockList *list;
+   uint32 capacity = 16;
+   uint8 *buf;
+   VixError err = VIX_OK;
+
+   *blockList = NULL;
+   if (chunkSize == 0 || chunkSize > VIXDISKLIB_MAX_CHUNK_SIZE) {
+      return VIX_E_INVALID_ARG;
+   }
+   buf = malloc(chunkSize * VIXDISKLIB_SECTOR_SIZE);
+   list = malloc(offsetof(VixDiskLibBlockList, blocks) +
+                 capacity * sizeof list->blocks[0]);
+   if (buf == NULL || list == NULL) {
+      free(buf);
+      free(list);
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   list->numBlocks = 0;
+
+   for (pos = startSector; pos < end && err == VIX_OK; pos += chunkSize) {
+      VixDiskLibSectorType count = end - pos < chunkSize ? end - pos
+                                                         : chunkSize;
+      VixDiskLibBlock *last = list->numBlocks > 0 ?
+                              &list->blocks[list->numBlocks - 1] : NULL;
+
+      err = gFuncs.Read(diskHandle, pos, count, buf);
+      if (err != VIX_OK ||
+          JVddkIsZero(buf, count * VIXDISKLIB_SECTOR_SIZE)) {
+         continue;
+      }
+      if (last != NULL && last->offset + last->length == pos) {
+         last->length += count;
+         continue;
+      }
+      if (list->numBlocks == capacity) {
+         VixDiskLibBlockList *grown;
+
+         capacity *= 2;
+         grown = realloc(list, offsetof(VixDiskLibBlockList, blocks) +
+                               capacity * sizeof list->blocks[0]);
+         if (grown == NULL) {
+            err = VIX_E_OUT_OF_MEMORY;
+            continue;
+         }
+         list = grown;
+      }
+      list->blocks[list->numBlocks].offset = pos;
+      list->blocks[list->numBlocks].length = count;
+      list->numBlocks++;
+   }
+
+   free(buf);
+   if (err != VIX_OK) {
+      free(list);
+      return err;
+   }
+   *blockList = list;
+   return VIX_OK;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * VixDiskLib_* --
+ *
+ *      The VixDiskLib functions, through the table. A function emulated
+ *      here when the library lacks it tells so in its body.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+VixError
+VixDiskLib_InitEx(uint32 majorVersion,
+                  uint32 minorVersion,
+                  VixDiskLibGenericLogFunc *log,
+                  VixDiskLibGenericLogFunc *warn,
+                  VixDiskLibGenericLogFunc *panic,
+                  const char *libDir,
+                  const char *configFile)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   return gFuncs.InitEx(majorVersion, minorVersion, log, warn, panic, libDir,
+                        configFile);
+}
+
+
+VixError
+VixDiskLib_Init(uint32 majorVersion,
+                uint32 minorVersion,
+                VixDiskLibGenericLogFunc *log,
+                VixDiskLibGenericLogFunc *warn,
+                VixDiskLibGenericLogFunc *panic,
+                const char *libDir)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   return gFuncs.Init(majorVersion, minorVersion, log, warn, panic, libDir);
+}
+
+
+void
+VixDiskLib_Exit(void)
+{
+   if (gLoaded) {
+      gFuncs.Exit();
+   }
+}
+
+
+const char *
+VixDiskLib_ListTransportModes(void)
+{
+   return gLoaded ? gFuncs.ListTransportModes() : NULL;
+}
+
+
+VixError
+VixDiskLib_Cleanup(const VixDiskLibConnectParams *connectParams,
+                   uint32 *numCleanedUp,
+                   uint32 *numRemaining)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   return gFuncs.Cleanup(connectParams, numCleanedUp, numRemaining);
+}
+
+
+VixError
+VixDiskLib_Connect(const VixDiskLibConnectParams *connectParams,
+                   VixDiskLibConnection *connection)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   return gFuncs.Connect(connectParams, connection);
+}
+
+
+VixError
+VixDiskLib_PrepareForAccess(const VixDiskLibConnectParams *connectParams,
+                            const char *identity)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   return gFuncs.PrepareForAccess(connectParams, identity);
+}
+
+
+VixError
+VixDiskLib_ConnectEx(const VixDiskLibConnectParams *connectParams,
+                     Bool readOnly,
+                     const char *snapshotRef,
+                     const char *transportModes,
+                     VixDiskLibConnection *connection)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   return gFuncs.ConnectEx(connectParams, readOnly, snapshotRef,
+                           transportModes, connection);
+}
+
+
+VixError
+VixDiskLib_Disconnect(VixDiskLibConnection connection)
+{
+   return gLoaded ? gFuncs.Disconnect(connection) : VIX_E_FAIL;
+}
+
+
+VixError
+VixDiskLib_EndAccess(const VixDiskLibConnectParams *connectParams,
+                     const char *identity)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   return gFuncs.EndAccess(connectParams, identity);
+}
+
+
+VixError
+VixDiskLib_Create(const VixDiskLibConnection connection,
+                  const char *path,
+                  const VixDiskLibCreateParams *createParams,
+                  VixDiskLibProgressFunc progressFunc,
+                  void *progressCallbackData)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   return gFuncs.Create(connection, path, createParams, progressFunc,
+                        progressCallbackData);
+}
+
+
+VixError
+VixDiskLib_CreateChild(VixDiskLibHandle diskHandle,
+                       const char *childPath,
+                       VixDiskLibDiskType diskType,
+                       VixDiskLibProgressFunc progressFunc,
+                       void *progressCallbackData)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   return gFuncs.CreateChild(diskHandle, childPath, diskType, progressFunc,
+                             progressCallbackData);
+}
+
+
+VixError
+VixDiskLib_Open(const VixDiskLibConnection connection,
+                const char *path,
+                uint32 flags,
+                VixDiskLibHandle *diskHandle)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   return gFuncs.Open(connection, path, flags, diskHandle);
+}
+
+
+VixError
+VixDiskLib_QueryAllocatedBlocks(VixDiskLibHandle diskHandle,
+                                VixDiskLibSectorType startSector,
+                                VixDiskLibSectorType numSectors,
+                                VixDiskLibSectorType chunkSize,
+                                VixDiskLibBlockList **blockList)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   if (gFuncs.QueryAllocatedBlocks == NULL) {
+      return JVddkScanAllocatedBlocks(diskHandle, startSector, numSectors,
+                                      chunkSize, blockList);
+   }
+   return gFuncs.QueryAllocatedBlocks(diskHandle, startSector, numSectors,
+                                      chunkSize, blockList);
+}
+
+
+VixError
+VixDiskLib_FreeBlockList(VixDiskLibBlockList *blockList)
+{
+   if (!gLoaded || gFuncs.FreeBlockList == NULL) {
+      free(blockList);                /* From JVddkScanAllocatedBlocks */
+      return VIX_OK;
+   }
+   return gFuncs.FreeBlockList(blockList);
+}
+
+
+VixError
+VixDiskLib_GetInfo(VixDiskLibHandle diskHandle,
+                   VixDiskLibInfo **info)
+{
+   VixDiskLibInfo *older;
+   VixError err;
+
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   if ((gCapabilities & JVDDK_CAP_SECTOR_SIZE) != 0) {
+      return gFuncs.GetInfo(diskHandle, info);
+   }
+
+   /* Copy the part the library filled into the 7.0 structure */
+   err = gFuncs.GetInfo(diskHandle, &older);
+   if (err != VIX_OK) {
+      return err;
+   }
+   *info = calloc(1, sizeof **info);
+   if (*info == NULL) {
+      gFuncs.FreeInfo(older);
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   memcpy(*info, older, offsetof(VixDiskLibInfo, logicalSectorSize));
+   (*info)->parentFileNameHint = older->parentFileNameHint != NULL ?
+                                 strdup(older->parentFileNameHint) : NULL;
+   (*info)->uuid = older->uuid != NULL ? strdup(older->uuid) : NULL;
+   (*info)->logicalSectorSize = VIXDISKLIB_SECTOR_SIZE;
+   (*info)->physicalSectorSize = VIXDISKLIB_SECTOR_SIZE;
+   gFuncs.FreeInfo(older);
+   return VIX_OK;
+}
+
+
+void
+VixDiskLib_FreeInfo(VixDiskLibInfo *info)
+{
+   if (!gLoaded) {
+      return;
+   }
+   if ((gCapabilities & JVDDK_CAP_SECTOR_SIZE) != 0) {
+      gFuncs.FreeInfo(info);
+   } else if (info != NULL) {
+      free(info->parentFileNameHint);
+      free(info->uuid);
+      free(info);
+   }
+}
+
+
+const char *
+VixDiskLib_GetTransportMode(VixDiskLibHandle diskHandle)
+{
+   return gLoaded ? gFuncs.GetTransportMode(diskHandle) : NULL;
+}
+
+
+VixError
+VixDiskLib_Close(VixDiskLibHandle diskHandle)
+{
+   return gLoaded ? gFuncs.Close(diskHandle) : VIX_E_FAIL;
+}
+
+
+VixError
+VixDiskLib_Read(VixDiskLibHandle diskHandle,
+                VixDiskLibSectorType startSector,
+                VixDiskLibSectorType numSectors,
+                uint8 *readBuffer)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   return gFuncs.Read(diskHandle, startSector, numSectors, readBuffer);
+}
+
+
+VixError
+VixDiskLib_ReadAsync(VixDiskLibHandle diskHandle,
+                     VixDiskLibSectorType startSector,
+                     VixDiskLibSectorType numSectors,
+                     uint8 *readBuffer,
+                     VixDiskLibCompletionCB callback,
+                     void *cbData)
+{
+   VixError err;
+
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   if (gFuncs.ReadAsync != NULL) {
+      return gFuncs.ReadAsync(diskHandle, startSector, numSectors,
+                              readBuffer, callback, cbData);
+   }
+   err = gFuncs.Read(diskHandle, startSector, numSectors, readBuffer);
+   callback(cbData, err);
+   return VIX_ASYNC;
+}
+
+
+VixError
+VixDiskLib_Write(VixDiskLibHandle diskHandle,
+                 VixDiskLibSectorType startSector,
+                 VixDiskLibSectorType numSectors,
+                 const uint8 *writeBuffer)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   return gFuncs.Write(diskHandle, startSector, numSectors, writeBuffer);
+}
+
+
+VixError
+VixDiskLib_WriteAsync(VixDiskLibHandle diskHandle,
+                      VixDiskLibSectorType startSector,
+                      VixDiskLibSectorType numSectors,
+                      const uint8 *writeBuffer,
+                      VixDiskLibCompletionCB callback,
+                      void *cbData)
+{
+   VixError err;
+
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   if (gFuncs.WriteAsync != NULL) {
+      return gFuncs.WriteAsync(diskHandle, startSector, numSectors,
+                               writeBuffer, callback, cbData);
+   }
+   err = gFuncs.Write(diskHandle, startSector, numSectors, writeBuffer);
+   callback(cbData, err);
+   return VIX_ASYNC;
+}
+
+
+VixError
+VixDiskLib_Flush(VixDiskLibHandle diskHandle)
+{
+   return gLoaded ? gFuncs.Flush(diskHandle) : VIX_E_FAIL;
+}
+
+
+VixError
+VixDiskLib_Wait(VixDiskLibHandle diskHandle)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   /* The emulated asynchronous I/O is complete on return */
+   return gFuncs.Wait != NULL ? gFuncs.Wait(diskHandle) : VIX_OK;
+}
+
+
+VixError
+VixDiskLib_ReadMetadata(VixDiskLibHandle diskHandle,
+                        const char *key,
+                        char *buf,
+                        size_t bufLen,
+                        size_t *requiredLen)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   return gFuncs.ReadMetadata(diskHandle, key, buf, bufLen, requiredLen);
+}
+
+
+VixError
+VixDiskLib_WriteMetadata(VixDiskLibHandle diskHandle,
+                         const char *key,
+                         const char *val)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   return gFuncs.WriteMetadata(diskHandle, key, val);
+}
+
+
+VixError
+VixDiskLib_GetMetadataKeys(VixDiskLibHandle diskHandle,
+                           char *keys,
+                           size_t maxLen,
+                           size_t *requiredLen)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   return gFuncs.GetMetadataKeys(diskHandle, keys, maxLen, requiredLen);
+}
+
+
+VixError
+VixDiskLib_Unlink(VixDiskLibConnection connection,
+                  const char *path)
+{
+   return gLoaded ? gFuncs.Unlink(connection, path) : VIX_E_FAIL;
+}
+
+
+VixError
+VixDiskLib_Grow(VixDiskLibConnection connection,
+                const char *path,
+                VixDiskLibSectorType capacity,
+                Bool updateGeometry,
+                VixDiskLibProgressFunc progressFunc,
+                void *progressCallbackData)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   return gFuncs.Grow(connection, path, capacity, updateGeometry,
+                      progressFunc, progressCallbackData);
+}
+
+
+VixError
+VixDiskLib_Shrink(VixDiskLibHandle diskHandle,
+                  VixDiskLibProgressFunc progressFunc,
+                  void *progressCallbackData)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   return gFuncs.Shrink(diskHandle, progressFunc, progressCallbackData);
+}
+
+
+VixError
+VixDiskLib_Defragment(VixDiskLibHandle diskHandle,
+                      VixDiskLibProgressFunc progressFunc,
+                      void *progressCallbackData)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   return gFuncs.Defragment(diskHandle, progressFunc, progressCallbackData);
+}
+
+
+VixError
+VixDiskLib_Rename(const char *srcFileName,
+                  const char *dstFileName)
+{
+   return gLoaded ? gFuncs.Rename(srcFileName, dstFileName) : VIX_E_FAIL;
+}
+
+
+VixError
+VixDiskLib_Clone(const VixDiskLibConnection dstConnection,
+                 const char *dstPath,
+                 const VixDiskLibConnection srcConnection,
+                 const char *srcPath,
+                 const VixDiskLibCreateParams *vixCreateParams,
+                 VixDiskLibProgressFunc progressFunc,
+                 void *progressCallbackData,
+                 Bool overWrite)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   return gFuncs.Clone(dstConnection, dstPath, srcConnection, srcPath,
+                       vixCreateParams, progressFunc, progressCallbackData,
+                       overWrite);
+}
+
+
+char *
+VixDiskLib_GetErrorText(VixError err,
+                        const char *locale)
+{
+   return gLoaded ? gFuncs.GetErrorText(err, locale) : NULL;
+}
+
+
+void
+VixDiskLib_FreeErrorText(char *errMsg)
+{
+   if (gLoaded) {
+      gFuncs.FreeErrorText(errMsg);
+   }
+}
+
+
+VixError
+VixDiskLib_IsAttachPossible(VixDiskLibHandle parent,
+                            VixDiskLibHandle child)
+{
+   return gLoaded ? gFuncs.IsAttachPossible(parent, child) : VIX_E_FAIL;
+}
+
+
+VixError
+VixDiskLib_Attach(VixDiskLibHandle parent,
+                  VixDiskLibHandle child)
+{
+   return gLoaded ? gFuncs.Attach(parent, child) : VIX_E_FAIL;
+}
+
+
+VixError
+VixDiskLib_SpaceNeededForClone(VixDiskLibHandle diskHandle,
+                               VixDiskLibDiskType cloneDiskType,
+                               uint64 *spaceNeeded)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   return gFuncs.SpaceNeededForClone(diskHandle, cloneDiskType,
+                                     spaceNeeded);
+}
+
+
+VixError
+VixDiskLib_CheckRepair(const VixDiskLibConnection connection,
+                       const char *filename,
+                       Bool repair)
+{
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   return gFuncs.CheckRepair(connection, filename, repair);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JVddkStrdup --
+ *
+ *      strdup that accepts NULL.
+ *
+ * Results:
+ *      The copy, NULL if "str" is NULL or on allocation failure.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static char *
+JVddkStrdup(const char *str)   // IN: optional
+{
+   return str != NULL ? strdup(str) : NULL;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JVddkAddParams --
+ *
+ *      Remember connect params allocated here, so that FreeConnectParams
+ *      frees them rather than the VixDiskLib.
+ *
+ * Results:
+ *      FALSE on allocation failure.
+ *
+ * Side effects:
+ *      Adds an entry to gParams.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+JVddkAddParams(VixDiskLibConnectParams *params,   // IN
+               Bool copied)                       // IN
+{
+   JVddkParams *entry = malloc(sizeof *entry);
+
+   if (entry == NULL) {
+      return FALSE;
+   }
+   entry->params = params;
+   entry->copied = copied;
+   pthread_mutex_lock(&gLock);
+   entry->next = gParams;
+   gParams = entry;
+   pthread_mutex_unlock(&gLock);
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * JVddkFreeCopiedParams --
+ *
+ *      Free connect params copied by GetConnectParams and their strings.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+JVddkFreeCopiedParams(VixDiskLibConnectParams *params)   // IN
+{
+   free(params->vmxSpec);
+   free(params->serverName);
+   free(params->thumbPrint);
+   if (params->credType == VIXDISKLIB_CRED_UID) {
+      free(params->creds.uid.userName);
+      free(params->creds.uid.password);
+   } else if (params->credType == VIXDISKLIB_CRED_SESSIONID) {
+      free(params->creds.sessionId.cookie);
+      free(params->creds.sessionId.userName);
+      free(params->creds.sessionId.key);
+   }
+   if (params->specType == VIXDISKLIB_SPEC_VSTORAGE_OBJECT) {
+      free(params->spec.vStorageObjSpec.id);
+      free(params->spec.vStorageObjSpec.datastoreMoRef);
+      free(params->spec.vStorageObjSpec.ssId);
+   }
+   free(params);
+}
+
+
+VixError
+VixDiskLib_GetConnectParams(const VixDiskLibConnection connection,
+                            VixDiskLibConnectParams **connectParams)
+{
+   VixDiskLibConnectParams *older;
+   VixDiskLibConnectParams *params;
+   VixError err;
+
+   if (!gLoaded) {
+      return VIX_E_FAIL;
+   }
+   if ((gCapabilities & JVDDK_CAP_SECTOR_SIZE) != 0 || connectParams == NULL) {
+      return gFuncs.GetConnectParams(connection, connectParams);
+   }
+
+   /*
+    * The structure of an older library is shorter: copy the fields it
+    * filled into the 7.0 one. The internal ones (privateUse, ticketId,
+    * vimApiVer, state) are left out, as they would outlive the original.
+    */
+   err = gFuncs.GetConnectParams(connection, &older);
+   if (err != VIX_OK) {
+      return err;
+   }
+   params = calloc(1, sizeof *params);
+   if (params == NULL) {
+      gFuncs.FreeConnectParams(older);
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   params->vmxSpec = JVddkStrdup(older->vmxSpec);
+   params->serverName = JVddkStrdup(older->serverName);
+   params->thumbPrint = JVddkStrdup(older->thumbPrint);
+   params->credType = older->credType;
+   if (older->credType == VIXDISKLIB_CRED_UID) {
+      params->creds.uid.userName = JVddkStrdup(older->creds.uid.userName);
+      params->creds.uid.password = JVddkStrdup(older->creds.uid.password);
+   } else if (older->credType == VIXDISKLIB_CRED_SESSIONID) {
+      params->creds.sessionId.cookie =
+         JVddkStrdup(older->creds.sessionId.cookie);
+      params->creds.sessionId.userName =
+         JVddkStrdup(older->creds.sessionId.userName);
+      params->creds.sessionId.key = JVddkStrdup(older->creds.sessionId.key);
+   }
+   params->port = older->port;
+   params->nfcHostPort = older->nfcHostPort;
+
+   /* The spec fields appeared with the vStorageObjects of 6.7 */
+   params->specType = VIXDISKLIB_SPEC_VMX;
+   if ((gCapabilities & JVDDK_CAP_CONNECT_PARAMS) != 0 &&
+       older->specType == VIXDISKLIB_SPEC_VSTORAGE_OBJECT) {
+      params->specType = VIXDISKLIB_SPEC_VSTORAGE_OBJECT;
+      params->spec.vStorageObjSpec.id =
+         JVddkStrdup(older->spec.vStorageObjSpec.id);
+      params->spec.vStorageObjSpec.datastoreMoRef =
+         JVddkStrdup(older->spec.vStorageObjSpec.datastoreMoRef);
+      params->spec.vStorageObjSpec.ssId =
+         JVddkStrdup(older->spec.vStorageObjSpec.ssId);
+   }
+   gFuncs.FreeConnectParams(older);
+
+   if (!JVddkAddParams(params, TRUE)) {
+      JVddkFreeCopiedParams(params);
+      return VIX_E_OUT_OF_MEMORY;
+   }
+   *connectParams = params;
+   return VIX_OK;
+}
+
+
+VixDiskLibConnectParams *
+VixDiskLib_AllocateConnectParams(void)
+{
+   VixDiskLibConnectParams *params;
+
+   if (!gLoaded) {
+      return NULL;
+   }
+   if (gFuncs.AllocateConnectParams != NULL) {
+      return gFuncs.AllocateConnectParams();
+   }
+
+   /* Before 6.7 the caller allocates them; remember which to free here */
+   params = calloc(1, sizeof *params);
+   if (params == NULL) {
+      return NULL;
+   }
+   if (!JVddkAddParams(params, FALSE)) {
+      free(params);
+      return NULL;
+   }
+   return params;
+}
+
+
+void
+VixDiskLib_FreeConnectParams(VixDiskLibConnectParams *connectParams)
+{
+   JVddkParams **link;
+   JVddkParams *entry = NULL;
+
+   if (!gLoaded || connectParams == NULL) {
+      return;
+   }
+   if (gFuncs.AllocateConnectParams == NULL ||
+       (gCapabilities & JVDDK_CAP_SECTOR_SIZE) == 0) {
+      pthread_mutex_lock(&gLock);
+      for (link = &gParams; *link != NULL; link = &(*link)->next) {
+         if ((*link)->params == connectParams) {
+            entry = *link;
+            *link = entry->next;
+            break;
+         }
+      }
+      pthread_mutex_unlock(&gLock);
+      if (entry != NULL) {
+         if (entry->copied) {
+            JVddkFreeCopiedParams(entry->params);
+         } else {
+            /* The caller freed the strings it set */
+            free(entry->params);
+         }
+         free(entry);
+         return;
+      }
+   }
+   gFuncs.FreeConnectParams(connectParams);
+}
+
+
+Bool
+VixDiskLib_SetInjectedFault(int id,
+                            Bool enabled,
+                            int faultErr)
+{
+   if (!gLoaded || gFuncs.SetInjectedFault == NULL) {
+      return FALSE;
+   }
+   return gFuncs.SetInjectedFault(id, enabled, faultErr);
+}
@@ -27,20 +27,24 @@
 
 build(){
     VERSION=$MAJOR.$MINOR 
+    # One libjDiskLib for every VDDK: it loads libvixDiskLib at run time
+    SOURCE=7.0
     VDDK_DIRECTORY="./vddk"
     TAR_FILE=VMware-vix-disklib-$VERSION.$PATCH-$BUILD.x86_64.tar.gz
     JVIX_RESOURCES_DIRECTORY="../../../../../../jvix/src/main/resources" 
     echo "Checking $VDDK_DIRECTORY/$TAR_FILE file"
     if [ -f "$VDDK_DIRECTORY/$TAR_FILE" ]; then
-        tar -zxvf  "$VDDK_DIRECTORY/$TAR_FILE" vmware-vix-disklib-distrib/lib64   
+        tar -zxvf  "$VDDK_DIRECTORY/$TAR_FILE" vmware-vix-disklib-distrib/lib64 vmware-vix-disklib-distrib/include
         if [ -d  vmware-vix-disklib-distrib/lib64 ]; then
-            if [ -d "$VERSION/lib" ]; then
-                rm -rf "$VERSION/lib"
+            if [ -d "$SOURCE/lib" ]; then
+                rm -rf "$SOURCE/lib"
             fi 
-            mkdir -v -p $VERSION/lib 
-            mv vmware-vix-disklib-distrib/lib64 $VERSION/lib/
+            mkdir -v -p $SOURCE/lib 
+            mv vmware-vix-disklib-distrib/lib64 $SOURCE/lib/
+            # vixMntapi.h for libjMntApi
+            mv vmware-vix-disklib-distrib/include $SOURCE/lib/
             rmdir vmware-vix-disklib-distrib
-            pushd $VERSION
+            pushd $SOURCE
             make -f makefile
             cd lib/lib64
             tar -cvf $BUILD.tar -C $PWD .
@@ -50,8 +54,8 @@ build(){
             cd ../..
             make clean
             popd
-            echo "Clean Lib Directory $VERSION/lib/"
-            rm -rvf $VERSION/lib/
+            echo "Clean Lib Directory $SOURCE/lib/"
+            rm -rvf $SOURCE/lib/
              
         else
             echo " vmware-vix-disklib-distrib/lib64 doesn't exist"
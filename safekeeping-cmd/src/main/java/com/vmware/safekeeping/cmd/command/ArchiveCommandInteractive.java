@@ -47,6 +47,7 @@ import com.vmware.safekeeping.cmd.report.StatusInteractive;
 import com.vmware.safekeeping.cmd.support.ParsingException;
 import com.vmware.safekeeping.cmd.support.VmbkParser;
 import com.vmware.safekeeping.common.FirstClassObjectFilterType;
+import com.vmware.jvix.jDiskLibConst;
 import com.vmware.safekeeping.common.Utility;
 import com.vmware.safekeeping.core.command.AbstractArchiveCommand;
 import com.vmware.safekeeping.core.command.options.CoreArchiveOptions;
@@ -54,6 +55,8 @@ import com.vmware.safekeeping.core.command.results.ICoreResultAction;
 import com.vmware.safekeeping.core.command.results.archive.AbstractCoreResultActionArchiveStatus;
 import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveCheckGenerationWithDependencies;
 import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveCheckGenerationsList;
+import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveExport;
+import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveExtract;
 import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveItem;
 import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveItemsList;
 import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveIvdStatus;
@@ -61,6 +64,8 @@ import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchi
 import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveRemoveProfile;
 import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveRemoveProfilesList;
 import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveRemovedGenerationsList;
+import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveSearch;
+import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveSearchList;
 import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveShow;
 import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveShowList;
 import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveStatusList;
@@ -73,6 +78,7 @@ import com.vmware.safekeeping.core.control.Vmbk;
 import com.vmware.safekeeping.core.control.info.InfoData;
 import com.vmware.safekeeping.core.control.target.ITarget;
 import com.vmware.safekeeping.core.exception.CoreResultActionException;
+import com.vmware.safekeeping.core.profile.FileCatalog;
 import com.vmware.safekeeping.core.profile.GlobalFcoProfileCatalog;
 import com.vmware.safekeeping.core.soap.ConnectionManager;
 import com.vmware.safekeeping.core.type.ManagedFcoEntityInfo;
@@ -110,6 +116,15 @@ public class ArchiveCommandInteractive extends AbstractArchiveCommand implements
 
     private static final String OPTION_NEWER_THAN = "newerThan";
 
+    private static final String OPTION_EXTRACT = "extract";
+    private static final String OPTION_OUTPUT = "output";
+    private static final String OPTION_DISK = "disk";
+    private static final String OPTION_PARTITION = "partition";
+    private static final String OPTION_SEARCH = "search";
+    private static final String OPTION_EXPORT = "export";
+    private static final String OPTION_PORT = "port";
+    private static final String OPTION_SOCKET = "socket";
+
     private static final String COMMAND_DESCRIPTION = "Archive management.";
 
     public static final String ARCHIVE = "archive";
@@ -164,6 +179,12 @@ public class ArchiveCommandInteractive extends AbstractArchiveCommand implements
                     }
                 } else if (getOptions().isStatus()) {
                     result = actionStatusInteractive(connetionManager);
+                } else if (getOptions().getExtract() != null) {
+                    result = actionExtractInteractive(connetionManager);
+                } else if (getOptions().isExport()) {
+                    result = actionExportInteractive(connetionManager);
+                } else if (getOptions().getSearch() != null) {
+                    result = actionSearchInteractive(connetionManager);
                 } else if (getOptions().getShow() != ArchiveObjects.NONE) {
                     result = actionShowInteractive(connetionManager);
                 } else {
@@ -211,6 +232,76 @@ public class ArchiveCommandInteractive extends AbstractArchiveCommand implements
         return result;
     }
 
+    private OperationStateList actionExportInteractive(final ConnectionManager connetionManager)
+            throws CoreResultActionException {
+        final OperationStateList result = new OperationStateList();
+        final ITarget target = connetionManager.getRepositoryTarget();
+        try {
+            final List<ManagedFcoEntityInfo> entities = getTargetFcoEntitiesFromRepository(
+                    new GlobalFcoProfileCatalog(target));
+            if (entities.size() != 1) {
+                result.add(OperationState.FAILED,
+                        IoFunction.showWarning(this.logger, "A disk is exported from one entity at a time"));
+            } else {
+                final CoreResultActionArchiveExport resultAction = actionExport(target,
+                        new CoreResultActionArchiveExport(entities.get(0), target));
+                switch (result.add(resultAction)) {
+                case SUCCESS:
+                    IoFunction.showInfo(this.logger, "Export %s stopped", resultAction.getUri());
+                    break;
+                case ABORTED:
+                    IoFunction.showWarning(this.logger, Vmbk.OPERATION_ABORTED_BY_USER);
+                    break;
+                default:
+                    IoFunction.showWarning(this.logger, "%s generation %s disk %d cannot be exported: %s",
+                            resultAction.getFcoEntityInfo().getName(), resultAction.getGenerationId(),
+                            resultAction.getDiskId(), resultAction.getReason());
+                    break;
+                }
+            }
+        } catch (final IOException e) {
+            Utility.logWarning(this.logger, e);
+            result.add(OperationState.FAILED, IoFunction.showWarning(this.logger, e));
+        }
+        return result;
+    }
+
+    private OperationStateList actionExtractInteractive(final ConnectionManager connetionManager)
+            throws CoreResultActionException {
+        final OperationStateList result = new OperationStateList();
+        final ITarget target = connetionManager.getRepositoryTarget();
+        try {
+            final List<ManagedFcoEntityInfo> entities = getTargetFcoEntitiesFromRepository(
+                    new GlobalFcoProfileCatalog(target));
+            if (entities.size() != 1) {
+                result.add(OperationState.FAILED,
+                        IoFunction.showWarning(this.logger, "A file is extracted from one entity at a time"));
+            } else {
+                final CoreResultActionArchiveExtract resultAction = actionExtract(target,
+                        new CoreResultActionArchiveExtract(entities.get(0), target));
+                switch (result.add(resultAction)) {
+                case SUCCESS:
+                    IoFunction.showInfo(this.logger, "%s generation %d disk %d: %s extracted to %s (%d bytes)",
+                            resultAction.getFcoEntityInfo().getName(), resultAction.getGenerationId(),
+                            resultAction.getDiskId(), resultAction.getPath(), resultAction.getOutput(),
+                            resultAction.getSize());
+                    break;
+                case ABORTED:
+                    IoFunction.showWarning(this.logger, Vmbk.OPERATION_ABORTED_BY_USER);
+                    break;
+                default:
+                    IoFunction.showWarning(this.logger, "%s cannot be extracted: %s", resultAction.getPath(),
+                            resultAction.getReason());
+                    break;
+                }
+            }
+        } catch (final IOException e) {
+            Utility.logWarning(this.logger, e);
+            result.add(OperationState.FAILED, IoFunction.showWarning(this.logger, e));
+        }
+        return result;
+    }
+
     private OperationStateList actionListInteractive(final ConnectionManager connetionManager)
             throws CoreResultActionException {
         final OperationStateList result = new OperationStateList();
@@ -323,6 +414,57 @@ public class ArchiveCommandInteractive extends AbstractArchiveCommand implements
         return result;
     }
 
+    private OperationStateList actionSearchInteractive(final ConnectionManager connetionManager)
+            throws CoreResultActionException {
+        final OperationStateList result = new OperationStateList();
+        final CoreResultActionArchiveSearchList resultActionList = actionSearchInteractive(
+                connetionManager.getRepositoryTarget(),
+                new CoreResultActionArchiveSearchList(connetionManager.getRepositoryTarget()));
+        if (!resultActionList.getItems().isEmpty()) {
+            opLoop: for (final CoreResultActionArchiveSearch resultAction : resultActionList.getItems()) {
+                switch (result.add(resultAction)) {
+                case ABORTED:
+                    IoFunction.showWarning(this.logger, Vmbk.OPERATION_ABORTED_BY_USER);
+                    break opLoop;
+
+                case FAILED:
+                    break;
+                case SKIPPED:
+                    break;
+                case SUCCESS:
+                    if (resultAction.getMatches().isEmpty() && (resultAction.getListedGenerationId() == null)) {
+                        IoFunction.showInfo(this.logger, "%s disk %d: %s not found",
+                                resultAction.getFcoEntityInfo().getName(), resultAction.getDiskId(),
+                                resultAction.getPath());
+                        break;
+                    }
+                    IoFunction.showInfo(this.logger, "%s disk %d: %s",
+                            resultAction.getFcoEntityInfo().getName(), resultAction.getDiskId(),
+                            resultAction.getPath());
+                    for (final Entry<Integer, FileCatalog.Entry> match : resultAction.getMatches().entrySet()) {
+                        IoFunction.println(String.format("\tgeneration %d: %s", match.getKey(), match.getValue()));
+                    }
+                    if (resultAction.getListedGenerationId() != null) {
+                        IoFunction.println(String.format("\tcontent in generation %d:",
+                                resultAction.getListedGenerationId()));
+                        for (final FileCatalog.Entry entry : resultAction.getContent()) {
+                            IoFunction.println("\t\t" + entry.toString());
+                        }
+                    }
+                    break;
+                default:
+                    break;
+                }
+            }
+            final StatisticResult total = ICoreResultAction.getResultStatistic(resultActionList.getItems());
+            IoFunction.printTotal(new EntityType[] { EntityType.VirtualMachine, EntityType.VirtualApp,
+                    EntityType.ImprovedVirtualDisk }, total);
+        } else {
+            result.add(OperationState.FAILED, IoFunction.showNoValidTargerMessage(this.logger));
+        }
+        return result;
+    }
+
     private OperationStateList actionShowInteractive(final ConnectionManager connetionManager)
             throws CoreResultActionException {
         final OperationStateList result = new OperationStateList();
@@ -471,6 +613,32 @@ public class ArchiveCommandInteractive extends AbstractArchiveCommand implements
         return craarl;
     }
 
+    public CoreResultActionArchiveSearchList actionSearchInteractive(final ITarget target,
+            final CoreResultActionArchiveSearchList craarl) throws CoreResultActionException {
+        try {
+            craarl.start();
+            final GlobalFcoProfileCatalog globalFcoCatalog = new GlobalFcoProfileCatalog(target);
+            final List<ManagedFcoEntityInfo> entities = getTargetFcoEntitiesFromRepository(globalFcoCatalog);
+            final float percIncrementPerEntity = 100.0F / entities.size();
+            for (final ManagedFcoEntityInfo vmInfo : entities) {
+                if (Vmbk.isAbortTriggered()) {
+                    craarl.aborted();
+                    break;
+                }
+                final CoreResultActionArchiveSearch resultAction = new CoreResultActionArchiveSearch(vmInfo, target);
+                craarl.getItems().add(resultAction);
+                actionSearch(target, resultAction);
+                craarl.progressIncrease(percIncrementPerEntity);
+            }
+        } catch (final Exception e) {
+            craarl.failure(e);
+            Utility.logWarning(this.logger, e);
+        } finally {
+            craarl.done();
+        }
+        return craarl;
+    }
+
     public CoreResultActionArchiveShowList actionShowInteractive(final ITarget target,
             final CoreResultActionArchiveShowList craarl) throws CoreResultActionException {
         try {
@@ -573,9 +741,17 @@ public class ArchiveCommandInteractive extends AbstractArchiveCommand implements
         final OptionSpecBuilder optionHelp = this.parser.accepts(OPTION_HELP, "Help");
         final OptionSpecBuilder optionCheck = this.parser.accepts(OPTION_CHECK, "Validate the archives.");
         final OptionSpecBuilder optionCommit = this.parser.accepts(OPTION_COMMIT, "Force database data to commit.");
+        final OptionSpecBuilder optionExtract = this.parser.accepts(OPTION_EXTRACT,
+                "File-level restore: copy a file of the guest filesystem (ext2/3/4) of an archived disk.");
+        final OptionSpecBuilder optionExport = this.parser.accepts(OPTION_EXPORT,
+                "Instant access: serve a generation disk as an NBD block device until Ctrl-C.");
+        final OptionSpecBuilder optionSearch = this.parser.accepts(OPTION_SEARCH,
+                "Look for a guest path in the file catalogs of the archived disks, list it if a directory.");
 
         this.parser.mainOptions(optionList, optionCheck, optionShow, optionRemove, optionStatus, optionCommit,
-                optionHelp);
+                optionExtract, optionSearch, optionExport, optionHelp);
+        optionExtract.withRequiredArg().describedAs("guest path");
+        optionSearch.withRequiredArg().describedAs("guest path");
         optionShow.withRequiredArg().withValuesConvertedBy(RegexMatcher.regex(
                 "GlobalProfile|FcoProfile|GenerationProfile|VmxFile|ReportFile|Md5File|VappConfig|global|fco|generation|vmx|report|md5|vapp",
                 Pattern.CASE_INSENSITIVE))
@@ -601,12 +777,44 @@ public class ArchiveCommandInteractive extends AbstractArchiveCommand implements
         this.parser.accepts(OPTION_NEWER_THAN, "Filter by creation time means newer than dd:hh:mm ")
                 .availableIf(OPTION_LIST).withRequiredArg().describedAs("dd:hh:mm")
                 .withValuesConvertedBy(datePattern("dd:hh:mm"));
+        this.parser.accepts(OPTION_OUTPUT, "Local file or directory to extract to [current directory].")
+                .availableIf(optionExtract).withRequiredArg().describedAs("path");
+        this.parser.accepts(OPTION_DISK, "Disk of the generation [0].").availableIf(optionExtract, optionSearch, optionExport)
+                .withRequiredArg().ofType(Integer.class).describedAs("id");
+        this.parser.accepts(OPTION_PORT, "TCP port of the export on localhost [nbdPort setting, 0 for any].")
+                .availableIf(optionExport).availableUnless(OPTION_SOCKET).withRequiredArg().ofType(Integer.class)
+                .describedAs("port");
+        this.parser.accepts(OPTION_SOCKET, "Unix socket to export on instead of TCP.").availableIf(optionExport)
+                .withRequiredArg().describedAs("path");
+        this.parser.accepts(OPTION_PARTITION, "Partition holding the filesystem [first supported one].")
+                .availableIf(optionExtract).withRequiredArg().ofType(Integer.class).describedAs("index");
         this.parser.accepts(OPTION_QUIET, "No confirmation asked.").availableUnless(optionHelp, optionList,
                 optionCommit);
         return new AbstractMap.SimpleEntry<>(getCommandName(), this);
 
     }
 
+    @Override
+    protected void exportRunning(final CoreResultActionArchiveExport resultAction) {
+        final long[] stats = resultAction.getStats();
+        if (stats[jDiskLibConst.NBD_STAT_CONNECTIONS] > 0) {
+            final float mb = Utility.ONE_MBYTES;
+            IoFunction.println(String.format(Utility.LOCALE,
+                    "\tconnections %d reads %d (%.2fMB) writes %d (%.2fMB) overlay %.2fMB prefetches %d",
+                    stats[jDiskLibConst.NBD_STAT_CONNECTIONS], stats[jDiskLibConst.NBD_STAT_READS],
+                    stats[jDiskLibConst.NBD_STAT_BYTES_READ] / mb, stats[jDiskLibConst.NBD_STAT_WRITES],
+                    stats[jDiskLibConst.NBD_STAT_BYTES_WRITTEN] / mb,
+                    stats[jDiskLibConst.NBD_STAT_OVERLAY_BYTES] / mb, stats[jDiskLibConst.NBD_STAT_PREFETCHES]));
+        }
+    }
+
+    @Override
+    protected void exportStarted(final CoreResultActionArchiveExport resultAction) {
+        IoFunction.showInfo(this.logger, "%s generation %d disk %d exported on %s - Ctrl-C to stop",
+                resultAction.getFcoEntityInfo().getName(), resultAction.getGenerationId(), resultAction.getDiskId(),
+                resultAction.getUri());
+    }
+
     @Override
     public String getCommandName() {
         return ARCHIVE;
@@ -633,8 +841,12 @@ public class ArchiveCommandInteractive extends AbstractArchiveCommand implements
                 OPTION_QUIET));
         comp.put("A15", stringsCompleter(OPTION_COMMIT));
         comp.put("A16", stringsCompleter(OPTION_SHOW, OPTION_GENERATION));
+        comp.put("A17", stringsCompleter(OPTION_EXTRACT, OPTION_OUTPUT, OPTION_DISK, OPTION_PARTITION,
+                OPTION_GENERATION));
+        comp.put("A18", stringsCompleter(OPTION_SEARCH, OPTION_DISK, OPTION_GENERATION, OPTION_ALL));
+        comp.put("A19", stringsCompleter(OPTION_EXPORT, OPTION_DISK, OPTION_GENERATION, OPTION_PORT, OPTION_SOCKET));
         comp.put("A99", stringsCompleter(OPTION_HELP));
-        return "|A1 A11*|A1 A12*|A1 A13*|A1 A14*|A1 A15?|A1 A16*|A1 A21*|A1 A99?";
+        return "|A1 A11*|A1 A12*|A1 A13*|A1 A14*|A1 A15?|A1 A16*|A1 A17*|A1 A18*|A1 A19*|A1 A21*|A1 A99?";
     }
 
     @Override
@@ -657,7 +869,10 @@ public class ArchiveCommandInteractive extends AbstractArchiveCommand implements
                 + "archive -status vm:testVM vm:vm-2313 vm:f9ad3050-d5a6-d107-d0d8-d305c4bc2330 -details\n\tShow the archive status with details of 3 different Vm.  1st by name. 2nd by Moref. 3rd by UUID\n\n"
                 + "archive -check -all\n\tValidate any archived object\n\n"
                 + "archive -remove vm:testVM -generation 2,4\n\tRemove TestVM generation 2 and 4 from the archive\n\n"
-                + "archive -remove vm:testVM -profile\n\tRemove TestVM Profile from the archive\n\n";
+                + "archive -remove vm:testVM -profile\n\tRemove TestVM Profile from the archive\n\n"
+                + "archive -extract /etc/fstab vm:testVM -generation 3 -output /tmp\n\tCopy /etc/fstab of the first disk of TestVM generation 3 to /tmp/fstab\n\n"
+                + "archive -search /var/log vm:testVM\n\tFind /var/log in every generation of TestVM and list its content\n\n"
+                + "archive -export vm:testVM -generation 3 -disk 1 -port 10810\n\tServe disk 1 of TestVM generation 3 on nbd://127.0.0.1:10810 until Ctrl-C\n\n";
     }
 
     @Override
@@ -687,6 +902,24 @@ public class ArchiveCommandInteractive extends AbstractArchiveCommand implements
             getOptions().setShow(ArchiveObjects.parse(optionSet.valueOf(OPTION_SHOW)));
         } else if (optionSet.has(OPTION_REMOVE)) {
             getOptions().setRemove(optionSet.has(OPTION_REMOVE));
+        } else if (optionSet.has(OPTION_EXTRACT)) {
+            getOptions().setExtract(optionSet.valueOf(OPTION_EXTRACT).toString());
+            if (optionSet.has(OPTION_OUTPUT)) {
+                getOptions().setOutput(optionSet.valueOf(OPTION_OUTPUT).toString());
+            }
+            if (optionSet.has(OPTION_PARTITION)) {
+                getOptions().setPartition(Integer.parseInt(optionSet.valueOf(OPTION_PARTITION).toString()));
+            }
+        } else if (optionSet.has(OPTION_EXPORT)) {
+            getOptions().setExport(true);
+            if (optionSet.has(OPTION_PORT)) {
+                getOptions().setPort(Integer.parseInt(optionSet.valueOf(OPTION_PORT).toString()));
+            }
+            if (optionSet.has(OPTION_SOCKET)) {
+                getOptions().setSocket(optionSet.valueOf(OPTION_SOCKET).toString());
+            }
+        } else if (optionSet.has(OPTION_SEARCH)) {
+            getOptions().setSearch(optionSet.valueOf(OPTION_SEARCH).toString());
         } else {
             throw new ParsingException("No Action specified");
         }
@@ -736,6 +969,9 @@ public class ArchiveCommandInteractive extends AbstractArchiveCommand implements
             getOptions().setDryRun(true);
         }
         getOptions().setProfile(optionSet.has(OPTION_PROFILE));
+        if (optionSet.has(OPTION_DISK)) {
+            getOptions().setDiskId(Integer.parseInt(optionSet.valueOf(OPTION_DISK).toString()));
+        }
         if (optionSet.has(OPTION_OLDER_THAN)) {
             final Date date = (Date) optionSet.valueOf(OPTION_OLDER_THAN);
             getOptions().setDateTimeFilter(date.getTime());
@@ -26,7 +26,10 @@
  ******************************************************************************/
 package com.vmware.safekeeping.core.command;
 
+import java.io.File;
+import java.io.FileOutputStream;
 import java.io.IOException;
+import java.io.OutputStream;
 import java.security.NoSuchAlgorithmException;
 import java.util.ArrayList;
 import java.util.Calendar;
@@ -45,6 +48,7 @@ import org.apache.commons.lang.StringUtils;
 
 import com.fasterxml.jackson.core.JsonProcessingException;
 import com.fasterxml.jackson.databind.ObjectMapper;
+import com.vmware.jvix.jDiskLibConst;
 import com.vmware.safekeeping.common.Utility;
 import com.vmware.safekeeping.core.command.interactive.AbstractCheckGenerationsInteractive;
 import com.vmware.safekeeping.core.command.interactive.AbstractRemoveGenerationsInteractive;
@@ -56,12 +60,15 @@ import com.vmware.safekeeping.core.command.results.ICoreResultAction;
 import com.vmware.safekeeping.core.command.results.archive.AbstractCoreResultActionArchiveStatus;
 import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveCheckGeneration;
 import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveCheckGenerationWithDependencies;
+import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveExport;
+import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveExtract;
 import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveItem;
 import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveItemsList;
 import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveIvdStatus;
 import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveRemoveGeneration;
 import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveRemoveGenerationWithDependencies;
 import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveRemoveProfile;
+import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveSearch;
 import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveShow;
 import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveVappStatus;
 import com.vmware.safekeeping.core.command.results.archive.CoreResultActionArchiveVmStatus;
@@ -76,14 +83,21 @@ import com.vmware.safekeeping.core.control.FcoArchiveManager.ArchiveManagerMode;
 import com.vmware.safekeeping.core.control.Vmbk;
 import com.vmware.safekeeping.core.control.info.ExBlockInfo;
 import com.vmware.safekeeping.core.control.info.InfoData;
+import com.vmware.safekeeping.core.control.target.FileTargetGuestFs;
+import com.vmware.safekeeping.core.control.target.FileTargetNbdServer;
+import com.vmware.safekeeping.core.control.target.FileTargetScrubber;
 import com.vmware.safekeeping.core.control.target.ITarget;
 import com.vmware.safekeeping.core.control.target.ITargetOperation;
+import com.vmware.safekeeping.core.core.ArchivedDiskBlocks;
 import com.vmware.safekeeping.core.core.BlockLocker;
 import com.vmware.safekeeping.core.core.ThreadsManager;
 import com.vmware.safekeeping.core.core.ThreadsManager.ThreadType;
 import com.vmware.safekeeping.core.exception.ArchiveException;
 import com.vmware.safekeeping.core.exception.CoreResultActionException;
+import com.vmware.safekeeping.core.profile.BasicBlockInfo;
+import com.vmware.safekeeping.core.profile.CoreGlobalSettings;
 import com.vmware.safekeeping.core.profile.FcoGenerationsCatalog;
+import com.vmware.safekeeping.core.profile.FileCatalog;
 import com.vmware.safekeeping.core.profile.GenerationProfile;
 import com.vmware.safekeeping.core.profile.GlobalFcoProfileCatalog;
 import com.vmware.safekeeping.core.profile.SimpleBlockInfo;
@@ -108,6 +122,13 @@ public abstract class AbstractArchiveCommand extends AbstractCommandWithOptions
 
     public static final int FAILED_GENERATIONS = -3;
 
+    private static final long EXPORT_POLL_MS = 500;
+
+    /**
+     * Polls between two refreshes of the NBD export statistics
+     */
+    private static final int EXPORT_STATS_TICKS = 20;
+
     protected CoreResultActionArchiveCheckGenerationWithDependencies actionCheckGenerations(final ITarget target,
             final CoreResultActionArchiveCheckGenerationWithDependencies resultAction,
             final AbstractCheckGenerationsInteractive interactive) throws CoreResultActionException {
@@ -174,6 +195,126 @@ public abstract class AbstractArchiveCommand extends AbstractCommandWithOptions
         return resultAction;
     }
 
+    /**
+     * File-level restore: copy a file of the guest filesystem of an archived disk
+     * to a local file, without restoring the disk
+     */
+    /**
+     * Serve a generation disk over NBD until the operation is aborted. The
+     * server listens on the unix socket of the options if any, otherwise on the
+     * TCP port of the options or the nbdPort setting, and is stopped on return.
+     */
+    public CoreResultActionArchiveExport actionExport(final ITarget target,
+            final CoreResultActionArchiveExport resultAction) throws CoreResultActionException {
+        try {
+            resultAction.start();
+            resultAction.setDiskId(getOptions().getDiskId());
+            final ManagedFcoEntityInfo entity = resultAction.getFcoEntityInfo();
+            final ITargetOperation targetOperation = target.newTargetOperation(entity, this.logger);
+            if (Vmbk.isAbortTriggered()) {
+                resultAction.aborted();
+            } else if (!FileTargetNbdServer.isEnabled(targetOperation)) {
+                resultAction.failure("NBD export is supported on file targets only");
+            } else {
+                try {
+                    final FcoArchiveManager fcoArcMgr = new FcoArchiveManager(entity, targetOperation,
+                            ArchiveManagerMode.READ);
+                    final GenerationProfile profile = retrieveSingleGeneration(fcoArcMgr, resultAction);
+                    if (profile != null) {
+                        resultAction.setGenerationId(profile.getGenerationId());
+                        final List<BasicBlockInfo> blocks = ArchivedDiskBlocks.consolidate(fcoArcMgr, profile,
+                                resultAction.getDiskId());
+                        final String name = String.format("%s-%d-%d", entity.getName(), profile.getGenerationId(),
+                                resultAction.getDiskId());
+                        final int port = (getOptions().getPort() != null) ? getOptions().getPort()
+                                : CoreGlobalSettings.getNbdPort();
+                        try (FileTargetNbdServer server = new FileTargetNbdServer(targetOperation, blocks,
+                                ArchivedDiskBlocks.getCapacityInSectors(profile, resultAction.getDiskId()), name,
+                                getOptions().getSocket(), port)) {
+                            resultAction.setUri(server.getUri());
+                            exportStarted(resultAction);
+                            int ticks = 0;
+                            while (!Vmbk.isAbortTriggered()) {
+                                Thread.sleep(EXPORT_POLL_MS);
+                                if ((++ticks % EXPORT_STATS_TICKS) == 0) {
+                                    System.arraycopy(server.getStats(), 0, resultAction.getStats(), 0,
+                                            resultAction.getStats().length);
+                                    exportRunning(resultAction);
+                                }
+                            }
+                            System.arraycopy(server.getStats(), 0, resultAction.getStats(), 0,
+                                    resultAction.getStats().length);
+                        }
+                    }
+                } catch (final IOException | ArchiveException e) {
+                    Utility.logWarning(this.logger, e);
+                    resultAction.failure(e);
+                } catch (final InterruptedException e) {
+                    this.logger.log(Level.WARNING, "Interrupted!", e);
+                    resultAction.failure(e);
+                    // Restore interrupted state...
+                    Thread.currentThread().interrupt();
+                }
+            }
+            return resultAction;
+        } finally {
+            resultAction.done();
+        }
+    }
+
+    /**
+     * Called at each refresh of the statistics of the NBD export
+     */
+    protected void exportRunning(final CoreResultActionArchiveExport resultAction) {
+    }
+
+    /**
+     * Called once the NBD export is listening
+     */
+    protected void exportStarted(final CoreResultActionArchiveExport resultAction) {
+    }
+
+    public CoreResultActionArchiveExtract actionExtract(final ITarget target,
+            final CoreResultActionArchiveExtract resultAction) throws CoreResultActionException {
+        try {
+            resultAction.start();
+            resultAction.setPath(getOptions().getExtract());
+            resultAction.setDiskId(getOptions().getDiskId());
+            final ManagedFcoEntityInfo entity = resultAction.getFcoEntityInfo();
+            final ITargetOperation targetOperation = target.newTargetOperation(entity, this.logger);
+            if (Vmbk.isAbortTriggered()) {
+                resultAction.aborted();
+            } else if (!FileTargetGuestFs.isEnabled(targetOperation)) {
+                resultAction.failure("File-level restore is supported on file targets only");
+            } else {
+                try {
+                    final FcoArchiveManager fcoArcMgr = new FcoArchiveManager(entity, targetOperation,
+                            ArchiveManagerMode.READ);
+                    final GenerationProfile profile = retrieveSingleGeneration(fcoArcMgr, resultAction);
+                    if (profile != null) {
+                        resultAction.setGenerationId(profile.getGenerationId());
+                        final String output = getExtractOutput(resultAction.getPath());
+                        resultAction.setOutput(output);
+                        final List<BasicBlockInfo> blocks = ArchivedDiskBlocks.consolidate(fcoArcMgr, profile,
+                                resultAction.getDiskId());
+                        try (FileTargetGuestFs guestFs = new FileTargetGuestFs(targetOperation, blocks,
+                                ArchivedDiskBlocks.getCapacityInSectors(profile, resultAction.getDiskId()),
+                                getOptions().getPartition());
+                                OutputStream out = new FileOutputStream(output)) {
+                            resultAction.setSize(guestFs.extract(resultAction.getPath(), out));
+                        }
+                    }
+                } catch (final IOException | ArchiveException e) {
+                    Utility.logWarning(this.logger, e);
+                    resultAction.failure(e);
+                }
+            }
+            return resultAction;
+        } finally {
+            resultAction.done();
+        }
+    }
+
     protected CoreResultActionArchiveItemsList actionList(final ITarget target,
             final CoreResultActionArchiveItemsList craal) throws CoreResultActionException {
         try {
@@ -385,6 +526,66 @@ public abstract class AbstractArchiveCommand extends AbstractCommandWithOptions
         return aarp;
     }
 
+    /**
+     * Look for a guest path in the file catalogs of a disk, in every selected
+     * generation (all by default), without opening any disk. The content of a
+     * directory is listed from the newest generation holding it.
+     */
+    public CoreResultActionArchiveSearch actionSearch(final ITarget target,
+            final CoreResultActionArchiveSearch resultAction) throws CoreResultActionException {
+        try {
+            resultAction.start();
+            resultAction.setPath(getOptions().getSearch());
+            resultAction.setDiskId(getOptions().getDiskId());
+            final ManagedFcoEntityInfo entity = resultAction.getFcoEntityInfo();
+            final ITargetOperation targetOperation = target.newTargetOperation(entity, this.logger);
+            if (Vmbk.isAbortTriggered()) {
+                resultAction.aborted();
+            } else {
+                try {
+                    final FcoArchiveManager fcoArcMgr = new FcoArchiveManager(entity, targetOperation,
+                            ArchiveManagerMode.READ);
+                    final List<Integer> generations = retrieveGenerations(
+                            getOptions().getGenerationId().isEmpty() ? Collections.singletonList(ALL_GENERATIONS)
+                                    : getOptions().getGenerationId(),
+                            fcoArcMgr, resultAction);
+                    if (resultAction.isRunning()) {
+                        final String path = resultAction.getPath();
+                        resultAction.getMatches().putAll(FileCatalog.search(targetOperation, entity, generations,
+                                resultAction.getDiskId(), path));
+                        Integer listed = null;
+                        if ("/".equals(path)) {
+                            for (final Integer genId : generations) {
+                                if (targetOperation.getFileCatalogToByteArray(entity, genId,
+                                        resultAction.getDiskId()) != null) {
+                                    listed = genId;
+                                }
+                            }
+                        } else {
+                            for (final Entry<Integer, FileCatalog.Entry> match : resultAction.getMatches()
+                                    .entrySet()) {
+                                listed = (match.getValue().getType() == jDiskLibConst.GUESTFS_TYPE_DIRECTORY)
+                                        ? match.getKey()
+                                        : null;
+                            }
+                        }
+                        if (listed != null) {
+                            resultAction.setListedGenerationId(listed);
+                            resultAction.getContent().addAll(new FileCatalog(targetOperation
+                                    .getFileCatalogToByteArray(entity, listed, resultAction.getDiskId())).list(path));
+                        }
+                    }
+                } catch (final IOException | ArchiveException e) {
+                    Utility.logWarning(this.logger, e);
+                    resultAction.failure(e);
+                }
+            }
+            return resultAction;
+        } finally {
+            resultAction.done();
+        }
+    }
+
     public CoreResultActionArchiveShow actionShow(final ITarget target, final CoreResultActionArchiveShow resultAction)
             throws CoreResultActionException {
         try {
@@ -716,6 +917,7 @@ public abstract class AbstractArchiveCommand extends AbstractCommandWithOptions
                 interactive.endLoadProfileGeneration();
                 for (final DiskProfile disk : profile.getDisks()) {
                     final StringBuilder errorReason = new StringBuilder();
+                    final FileTargetScrubber scrubber = scrubDisk(target, genId, disk);
                     for (final Entry<Integer, SimpleBlockInfo> entry : disk.getDumps().entrySet()) {
                         /**
                          * start Section CheckFile
@@ -723,10 +925,28 @@ public abstract class AbstractArchiveCommand extends AbstractCommandWithOptions
                         interactive.startCheckFile(entry.getKey());
                         final ExBlockInfo block = new ExBlockInfo(entry.getValue(), disk.getDumps().size(),
                                 target.getDisksPath());
-                        if (target.doesKeyExist(block)) {
-                            final byte[] digest = target.getObjectMd5(block.getDataKey());
-                            final String md5 = new String(digest);
-                            resultAction.getMd5fileCheck().add(entry.getKey(), md5.equalsIgnoreCase(block.getMd5()));
+                        final Integer scrubStatus = (scrubber != null) ? scrubber.getStatus(entry.getKey()) : null;
+                        if (scrubStatus != null) {
+                            final boolean scrubbed = scrubStatus == jDiskLibConst.SCRUB_STATUS_OK;
+                            resultAction.getMd5fileCheck().add(entry.getKey(), scrubbed);
+                            if (!scrubbed) {
+                                msg = String.format("Generation %d disk %d block %s check failed: %s", genId,
+                                        disk.getDiskId(), block.getKey(), FileTargetScrubber.describe(scrubStatus));
+                                this.logger.warning(msg);
+                                errorReason.append(msg);
+                                errorReason.append('\n');
+
+                                ret &= false;
+                            }
+                        } else if (target.doesKeyExist(block)) {
+                            if (block.isPacked()) {
+                                resultAction.getMd5fileCheck().add(entry.getKey(), target.checkPackedDump(block));
+                            } else {
+                                final byte[] digest = target.getObjectMd5(block.getDataKey());
+                                final String md5 = new String(digest);
+                                resultAction.getMd5fileCheck().add(entry.getKey(),
+                                        md5.equalsIgnoreCase(block.getMd5()));
+                            }
                         } else {
                             resultAction.getMd5fileCheck().add(entry.getKey(), false);
                             msg = String.format("Generation %d disk %d block %s check failed: Doesn't exist", genId,
@@ -838,6 +1058,21 @@ public abstract class AbstractArchiveCommand extends AbstractCommandWithOptions
      * @param genId      queried generation
      * @return List of generations
      */
+    /**
+     * @return the local file to extract guestPath to
+     */
+    private String getExtractOutput(final String guestPath) {
+        final String name = guestPath.substring(guestPath.lastIndexOf('/') + 1);
+        final String output = getOptions().getOutput();
+        if (StringUtils.isEmpty(output)) {
+            return name;
+        }
+        if (new File(output).isDirectory()) {
+            return new File(output, name).getPath();
+        }
+        return output;
+    }
+
     private List<GeneretionDependenciesInfo> getDependingGenerations(final FcoArchiveManager fcoArchMgr,
             final int genId) {
         final LinkedList<GeneretionDependenciesInfo> result = new LinkedList<>();
@@ -979,6 +1214,22 @@ public abstract class AbstractArchiveCommand extends AbstractCommandWithOptions
         final AtomicInteger updateKeys = new AtomicInteger(0);
         final ITargetOperation targetOperation = profile.getTargetOperation();
         try {
+            // wait for the running dumps to flush their references
+            if (!targetOperation.acquireRemovalLease()) {
+                this.logger.warning("Target in use by a running dump - generation not removed");
+                return false;
+            }
+        } catch (final InterruptedException e) {
+            this.logger.log(Level.WARNING, "Interrupted!", e);
+            // Restore interrupted state...
+            Thread.currentThread().interrupt();
+            return false;
+        }
+        try {
+            if (!targetOperation.compactDedupReferences()) {
+                this.logger.warning("Dedup reference logs compaction failed - generation not removed");
+                return false;
+            }
             final List<Future<Boolean>> futures = new ArrayList<>();
             for (final DiskProfile disk : profile.getDisks()) {
                 for (final Entry<Integer, SimpleBlockInfo> entry : disk.getDumps().entrySet()) {
@@ -1012,6 +1263,8 @@ public abstract class AbstractArchiveCommand extends AbstractCommandWithOptions
         } catch (final ExecutionException e) {
 
             Utility.logWarning(this.logger, e);
+        } finally {
+            targetOperation.releaseRemovalLease();
         }
 
         result &= targetOperation.deleteFolder(profile.getGenerationPath());
@@ -1221,11 +1474,86 @@ public abstract class AbstractArchiveCommand extends AbstractCommandWithOptions
         return generationId;
     }
 
+    /**
+     * Load the generation selected by the options, the last succeeded one by
+     * default, for the operations on a single disk of a single generation
+     *
+     * @return the profile, null if resultAction failed
+     */
+    private GenerationProfile retrieveSingleGeneration(final FcoArchiveManager fcoArcMgr,
+            final ICoreResultAction resultAction) throws CoreResultActionException, IOException {
+        Integer generationId = null;
+        switch (getOptions().getGenerationId().size()) {
+        case 0:
+            generationId = SUCCEDED_GENERATIONS;
+            break;
+        case 1:
+            generationId = getOptions().getGenerationId().get(0);
+            break;
+        default:
+            resultAction.failure("Multiple generation not allowed");
+            return null;
+        }
+        final Integer genId = retrieveGenerations(generationId, fcoArcMgr, resultAction);
+        if (genId == null) {
+            return null;
+        }
+        final GenerationProfile profile = fcoArcMgr.loadProfileGeneration(genId);
+        if ((profile == null) || !profile.isProfileValid()) {
+            resultAction.failure("Profile is empty");
+            return null;
+        }
+        if ((getOptions().getDiskId() < 0) || (getOptions().getDiskId() >= profile.getNumberOfDisks())) {
+            resultAction.failure(String.format("Generation %d has no disk %d", genId, getOptions().getDiskId()));
+            return null;
+        }
+        return profile;
+    }
+
+    /**
+     * Verify the unpacked blocks of a disk with the native scrub engine
+     *
+     * @return the scrubber holding the status of each block, null if the blocks
+     *         have to be checked in Java
+     */
+    private FileTargetScrubber scrubDisk(final ITargetOperation target, final int genId, final DiskProfile disk) {
+        if (!FileTargetScrubber.isEnabled(target)) {
+            return null;
+        }
+        final FileTargetScrubber scrubber = new FileTargetScrubber(target);
+        for (final Entry<Integer, SimpleBlockInfo> entry : disk.getDumps().entrySet()) {
+            final ExBlockInfo block = new ExBlockInfo(entry.getValue(), disk.getDumps().size(), target.getDisksPath());
+            if (!block.isPacked()) {
+                scrubber.add(entry.getKey(), block);
+            }
+        }
+        if (!scrubber.run()) {
+            this.logger.info("Native scrub not available, checking the stored MD5 in Java");
+            return null;
+        }
+        final String msg = String.format("Generation %d disk %d %s", genId, disk.getDiskId(), scrubber.getSummary());
+        if (scrubber.getBadBlocks() > 0) {
+            this.logger.warning(msg);
+        } else if (this.logger.isLoggable(Level.INFO)) {
+            this.logger.info(msg);
+        }
+        return scrubber;
+    }
+
     protected Future<Boolean> submit(final ExBlockInfo dumpFileInfo, final AtomicInteger removedKeys,
             final AtomicInteger updateKeys, final GenerationProfile profile) {
         return ThreadsManager.executor(ThreadType.ARCHIVE).submit(() -> {
             final ITargetOperation targetOperation = profile.getTargetOperation();
             final String json = dumpFileInfo.getJsonKey();
+            if (dumpFileInfo.isPacked()) {
+                // packfiles are shared by generations and are not rewritten here
+                if (this.logger.isLoggable(Level.FINE)) {
+                    final String msg = String.format("Keeping %s packed in %s", dumpFileInfo.getKey(),
+                            dumpFileInfo.getPackId());
+                    this.logger.fine(msg);
+                }
+                return dumpFileInfo.isFailed();
+            }
             if (targetOperation.doesKeyExist(dumpFileInfo) && !BlockLocker.isBlockLocked(dumpFileInfo)) {
                 try {
                     BlockLocker.lockBlock(dumpFileInfo);
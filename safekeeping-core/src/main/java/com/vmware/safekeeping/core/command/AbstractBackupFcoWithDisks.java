@@ -474,7 +474,11 @@ public abstract class AbstractBackupFcoWithDisks extends AbstractBackupFco imple
             }
             final String snapMorefValue = (rab.getCreateSnapshotAction() == null) ? null
                     : rab.getCreateSnapshotAction().getSnapMoref();
-            rab.setConnectionHandle(jvddk.connectReadOnly(snapMorefValue, getOptions().getRequestedTransportModes()));
+            String transportModes = getOptions().getRequestedTransportModes();
+            if (CoreGlobalSettings.isTransportProbe()) {
+                transportModes = probeTransportModes(rab, jvddk, snapMorefValue, transportModes);
+            }
+            rab.setConnectionHandle(jvddk.connectReadOnly(snapMorefValue, transportModes));
 
         } catch (final JVixException e) {
             Utility.logWarning(this.logger, e);
@@ -484,6 +488,36 @@ public abstract class AbstractBackupFcoWithDisks extends AbstractBackupFco imple
         return rab.isRunning();
     }
 
+    /**
+     * Order the requested transport modes by timed reads of the first disk. The
+     * requested modes are kept if the probe cannot run.
+     *
+     * @param rab
+     * @param jvddk
+     * @param snapMorefValue
+     * @param transportModes requested modes
+     * @return the modes to connect with
+     */
+    private String probeTransportModes(final AbstractCoreResultActionBackupForEntityWithDisks rab, final Jvddk jvddk,
+            final String snapMorefValue, final String transportModes) {
+        String remoteDiskPath = null;
+        if (rab.getEntityType() == EntityType.VirtualMachine) {
+            if (rab.getProfile().getNumberOfDisks() == 0) {
+                return transportModes;
+            }
+            remoteDiskPath = rab.getProfile().getRemoteDiskPath(0);
+        }
+        try {
+            final String[] probe = jvddk.probeTransportModes(snapMorefValue, transportModes, remoteDiskPath);
+            rab.setProbedTransportModes(probe[0]);
+            rab.setTransportProbeReport(probe[1]);
+            return probe[0];
+        } catch (final JVixException e) {
+            this.logger.warning("Transport probe failed: " + e.getMessage());
+            return transportModes;
+        }
+    }
+
     /**
      * Submit the backup thread to the Threads Executor
      * 
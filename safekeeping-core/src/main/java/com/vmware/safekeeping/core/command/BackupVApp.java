@@ -46,6 +46,7 @@ import com.vmware.safekeeping.core.command.results.CoreResultActionVmBackup;
 import com.vmware.safekeeping.core.control.FcoArchiveManager;
 import com.vmware.safekeeping.core.control.target.ITarget;
 import com.vmware.safekeeping.core.control.target.ITargetOperation;
+import com.vmware.safekeeping.core.core.DumpScheduler;
 import com.vmware.safekeeping.core.core.ThreadsManager;
 import com.vmware.safekeeping.core.core.ThreadsManager.ThreadType;
 import com.vmware.safekeeping.core.exception.CoreResultActionException;
@@ -111,6 +112,8 @@ public class BackupVApp extends AbstractBackupFco implements IBackupEntry, IVapp
     private boolean childrenBackup(final CoreResultActionVappBackup resultAction,
             final GlobalFcoProfileCatalog globalFcoCatalog) throws CoreResultActionException {
         boolean result = true;
+        final DumpScheduler dumpScheduler = DumpScheduler.newInstance(resultAction.getFcoEntityInfo().getName(),
+                getOptions().getNumberOfThreads());
         try {
             /**
              * Start Section ChildrenBackup
@@ -120,6 +123,7 @@ public class BackupVApp extends AbstractBackupFco implements IBackupEntry, IVapp
             final List<Future<CoreResultActionVmBackup>> futures = new ArrayList<>();
             int index = 0;
             for (final CoreResultActionVmBackup rabChild : resultAction.getResultActionOnsChildVm()) {
+                rabChild.setDumpScheduler(dumpScheduler);
                 final Future<CoreResultActionVmBackup> f = submit(rabChild, globalFcoCatalog,
                         target.newTargetOperation(rabChild.getFcoEntityInfo(), this.logger));
                 futures.add(f);
@@ -204,6 +208,9 @@ public class BackupVApp extends AbstractBackupFco implements IBackupEntry, IVapp
             resultAction.failure(e);
             Utility.logWarning(this.logger, e);
         } finally {
+            if (dumpScheduler != null) {
+                dumpScheduler.close();
+            }
             resultAction.getInteractive().endChildrenBackup();
             /**
              * End Section ChildrenBackup
@@ -52,6 +52,7 @@ import com.vmware.safekeeping.core.command.results.miscellanea.CoreResultActionD
 import com.vmware.safekeeping.core.command.results.support.SnapshotInfo;
 import com.vmware.safekeeping.core.control.FcoArchiveManager;
 import com.vmware.safekeeping.core.control.target.ITargetOperation;
+import com.vmware.safekeeping.core.core.DumpScheduler;
 import com.vmware.safekeeping.core.core.Jvddk;
 import com.vmware.safekeeping.core.exception.CoreResultActionException;
 import com.vmware.safekeeping.core.exception.VimApplicationQuiesceFault;
@@ -226,12 +227,24 @@ public class BackupVM extends AbstractBackupFcoWithDisks {
     private boolean disksBackup(final CoreResultActionVmBackup rab, final GlobalFcoProfileCatalog fcoProfileCatalog,
             final Jvddk jvddk) {
         boolean result = true;
+        DumpScheduler ownDumpScheduler = null;
         try {
             Thread.sleep(Utility.ONE_SECOND_IN_MILLIS);
             /**
              * Start Section DisksBackup
              */
             rab.getInteractive().startDisksBackup();
+            final int numberOfDisks = rab.getResultActionsOnDisk().size();
+            DumpScheduler dumpScheduler = rab.getDumpScheduler();
+            if ((dumpScheduler == null) && (numberOfDisks > 1)) {
+                ownDumpScheduler = DumpScheduler.newInstance(rab.getFcoEntityInfo().getName(),
+                        getOptions().getNumberOfThreads());
+                dumpScheduler = ownDumpScheduler;
+            }
+            if (dumpScheduler != null) {
+                dumpScheduler.addWorkers(DumpScheduler.workersFor(getOptions().getNumberOfThreads(), numberOfDisks));
+                jvddk.setDumpScheduler(dumpScheduler);
+            }
             final List<Future<CoreResultActionDiskBackup>> futures = new ArrayList<>();
             for (final CoreResultActionDiskBackup radb : rab.getResultActionsOnDisk()) {
 
@@ -260,6 +273,9 @@ public class BackupVM extends AbstractBackupFcoWithDisks {
             rab.failure(e);
             Utility.logWarning(this.logger, e);
         } finally {
+            if (ownDumpScheduler != null) {
+                ownDumpScheduler.close();
+            }
             rab.getInteractive().endDisksBackup();
             /**
              * End Section DisksBackup
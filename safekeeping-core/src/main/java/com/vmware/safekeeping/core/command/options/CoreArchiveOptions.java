@@ -56,11 +56,28 @@ public class CoreArchiveOptions extends CoreBackupRestoreCommonOptions {
 
     private ArchiveObjects show;
 
+    private String extract;
+
+    private String output;
+
+    private int diskId;
+
+    private int partition;
+
+    private String search;
+
+    private boolean export;
+
+    private Integer port;
+
+    private String socket;
+
     /**
      *
      */
     public CoreArchiveOptions() {
         setGenerationId(new LinkedList<>());
+        this.partition = -1;
     }
 
     /**
@@ -70,6 +87,20 @@ public class CoreArchiveOptions extends CoreBackupRestoreCommonOptions {
         return this.dateTimeFilter;
     }
 
+    /**
+     * @return the disk of the generation to read files from
+     */
+    public int getDiskId() {
+        return this.diskId;
+    }
+
+    /**
+     * @return the path of the guest file to extract, null for none
+     */
+    public String getExtract() {
+        return this.extract;
+    }
+
     /**
      * @return the generationId
      */
@@ -77,6 +108,43 @@ public class CoreArchiveOptions extends CoreBackupRestoreCommonOptions {
         return this.generationId;
     }
 
+    /**
+     * @return the local path of the extracted file, null for the name of the
+     *         guest file in the current directory
+     */
+    public String getOutput() {
+        return this.output;
+    }
+
+    /**
+     * @return the TCP port of the NBD export, null for the nbdPort setting
+     */
+    public Integer getPort() {
+        return this.port;
+    }
+
+    /**
+     * @return the partition holding the guest filesystem, -1 for the first
+     *         supported one
+     */
+    public int getPartition() {
+        return this.partition;
+    }
+
+    /**
+     * @return the guest path to look for in the file catalogs, null for none
+     */
+    public String getSearch() {
+        return this.search;
+    }
+
+    /**
+     * @return the unix socket of the NBD export, null to listen on TCP
+     */
+    public String getSocket() {
+        return this.socket;
+    }
+
     /**
      * @return the show
      */
@@ -91,6 +159,13 @@ public class CoreArchiveOptions extends CoreBackupRestoreCommonOptions {
         return this.check;
     }
 
+    /**
+     * @return true to serve a generation disk over NBD until aborted
+     */
+    public boolean isExport() {
+        return this.export;
+    }
+
     /**
      * @return the list
      */
@@ -140,6 +215,27 @@ public class CoreArchiveOptions extends CoreBackupRestoreCommonOptions {
         this.dateTimeFilter = mtime;
     }
 
+    /**
+     * @param diskId the diskId to set
+     */
+    public void setDiskId(final int diskId) {
+        this.diskId = diskId;
+    }
+
+    /**
+     * @param extract the extract to set
+     */
+    public void setExtract(final String extract) {
+        this.extract = extract;
+    }
+
+    /**
+     * @param export the export to set
+     */
+    public void setExport(final boolean export) {
+        this.export = export;
+    }
+
     /**
      * @param generationId the generationId to set
      */
@@ -154,6 +250,20 @@ public class CoreArchiveOptions extends CoreBackupRestoreCommonOptions {
         this.list = list;
     }
 
+    /**
+     * @param output the output to set
+     */
+    public void setOutput(final String output) {
+        this.output = output;
+    }
+
+    /**
+     * @param partition the partition to set
+     */
+    public void setPartition(final int partition) {
+        this.partition = partition;
+    }
+
     /**
      * @param prettyJason the prettyJason to set
      */
@@ -175,6 +285,20 @@ public class CoreArchiveOptions extends CoreBackupRestoreCommonOptions {
         this.remove = remove;
     }
 
+    /**
+     * @param port the port to set
+     */
+    public void setPort(final Integer port) {
+        this.port = port;
+    }
+
+    /**
+     * @param search the search to set
+     */
+    public void setSearch(final String search) {
+        this.search = search;
+    }
+
     /**
      * @param show the show to set
      */
@@ -182,6 +306,13 @@ public class CoreArchiveOptions extends CoreBackupRestoreCommonOptions {
         this.show = show;
     }
 
+    /**
+     * @param socket the socket to set
+     */
+    public void setSocket(final String socket) {
+        this.socket = socket;
+    }
+
     /**
      * @param status the status to set
      */
@@ -43,6 +43,8 @@ public abstract class AbstractCoreResultActionBackupForEntityWithDisks extends A
     private boolean compressed;
     private volatile int numberOfDisk;
     private boolean cipher;
+    private String probedTransportModes;
+    private String transportProbeReport;
 
     protected AbstractCoreResultActionBackupForEntityWithDisks(final IFirstClassObject fco,
             final CoreBackupOptions options) {
@@ -69,6 +71,20 @@ public abstract class AbstractCoreResultActionBackupForEntityWithDisks extends A
         return this.phase.get();
     }
 
+    /**
+     * @return the transport modes ordered by the probe, null if not probed
+     */
+    public String getProbedTransportModes() {
+        return this.probedTransportModes;
+    }
+
+    /**
+     * @return the rate or error of each mode probed
+     */
+    public String getTransportProbeReport() {
+        return this.transportProbeReport;
+    }
+
     /**
      * @return the cipher
      */
@@ -112,6 +128,20 @@ public abstract class AbstractCoreResultActionBackupForEntityWithDisks extends A
         this.phase.set(phase);
     }
 
+    /**
+     * @param probedTransportModes the probedTransportModes to set
+     */
+    public void setProbedTransportModes(final String probedTransportModes) {
+        this.probedTransportModes = probedTransportModes;
+    }
+
+    /**
+     * @param transportProbeReport the transportProbeReport to set
+     */
+    public void setTransportProbeReport(final String transportProbeReport) {
+        this.transportProbeReport = transportProbeReport;
+    }
+
     @Override
     public String toString() {
         return getState().toString() + " " + getFcoToString();
@@ -306,7 +306,12 @@ public abstract class AbstractCoreResultDiskBackupRestore extends AbstractCoreRe
             logger.config("<no args> - start"); //$NON-NLS-1$
         }
 
-        final String returnString = getParent().getOptions().getRequestedTransportModes();
+        String returnString = getParent().getOptions().getRequestedTransportModes();
+        if ((getParent() instanceof AbstractCoreResultActionBackupForEntityWithDisks)
+                && (((AbstractCoreResultActionBackupForEntityWithDisks) getParent())
+                        .getProbedTransportModes() != null)) {
+            returnString = ((AbstractCoreResultActionBackupForEntityWithDisks) getParent()).getProbedTransportModes();
+        }
         if (logger.isLoggable(Level.CONFIG)) {
             logger.config("<no args> - end"); //$NON-NLS-1$
         }
@@ -33,6 +33,7 @@ import org.apache.commons.lang.StringUtils;
 
 import com.vmware.safekeeping.core.command.options.CoreBackupOptions;
 import com.vmware.safekeeping.core.command.results.support.OperationState;
+import com.vmware.safekeeping.core.core.DumpScheduler;
 import com.vmware.safekeeping.core.exception.CoreResultActionException;
 import com.vmware.safekeeping.core.type.GuestInfoFlags;
 import com.vmware.safekeeping.core.type.fco.IFirstClassObject;
@@ -52,6 +53,11 @@ public class CoreResultActionVmBackup extends AbstractCoreResultActionBackupForE
 
 	private boolean template;
 
+	/**
+	 * Shared with the other VMs of a vApp, null if not set by the vApp backup
+	 */
+	private transient DumpScheduler dumpScheduler;
+
 	public CoreResultActionVmBackup(final IFirstClassObject fco, final CoreBackupOptions options) {
 		super(fco, options);
 		this.resultActionsOnDisks = new CopyOnWriteArrayList<>();
@@ -100,6 +106,10 @@ public class CoreResultActionVmBackup extends AbstractCoreResultActionBackupForE
 		return (VirtualMachineManager) super.getFirstClassObject();
 	}
 
+	public DumpScheduler getDumpScheduler() {
+		return this.dumpScheduler;
+	}
+
 	/**
 	 * @return the guestFlags
 	 */
@@ -199,6 +209,10 @@ public class CoreResultActionVmBackup extends AbstractCoreResultActionBackupForE
 		return this.template;
 	}
 
+	public void setDumpScheduler(final DumpScheduler dumpScheduler) {
+		this.dumpScheduler = dumpScheduler;
+	}
+
 	/**
 	 * @param guestFlags the guestFlags to set
 	 */
@@ -0,0 +1,128 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.command.results.archive;
+
+import com.vmware.safekeeping.core.control.target.ITarget;
+import com.vmware.safekeeping.core.type.ManagedFcoEntityInfo;
+
+public class CoreResultActionArchiveExtract extends AbstractCoreResultActionArchive {
+
+    /**
+     * 
+     */
+    private static final long serialVersionUID = 3411856206139502287L;
+
+    private Integer generationId;
+
+    private int diskId;
+
+    private String path;
+
+    private String output;
+
+    private long size;
+
+    /**
+     * @param fco
+     * @param target
+     */
+    public CoreResultActionArchiveExtract(final ManagedFcoEntityInfo fco, final ITarget target) {
+        super(target);
+        setFcoEntityInfo(fco);
+    }
+
+    /**
+     * @return the diskId
+     */
+    public int getDiskId() {
+        return this.diskId;
+    }
+
+    /**
+     * @return the generationId
+     */
+    public Integer getGenerationId() {
+        return this.generationId;
+    }
+
+    /**
+     * @return the local file written
+     */
+    public String getOutput() {
+        return this.output;
+    }
+
+    /**
+     * @return the path of the file in the guest filesystem
+     */
+    public String getPath() {
+        return this.path;
+    }
+
+    /**
+     * @return the bytes extracted
+     */
+    public long getSize() {
+        return this.size;
+    }
+
+    /**
+     * @param diskId the diskId to set
+     */
+    public void setDiskId(final int diskId) {
+        this.diskId = diskId;
+    }
+
+    /**
+     * @param generationId the generationId to set
+     */
+    public void setGenerationId(final Integer generationId) {
+        this.generationId = generationId;
+    }
+
+    /**
+     * @param output the output to set
+     */
+    public void setOutput(final String output) {
+        this.output = output;
+    }
+
+    /**
+     * @param path the path to set
+     */
+    public void setPath(final String path) {
+        this.path = path;
+    }
+
+    /**
+     * @param size the size to set
+     */
+    public void setSize(final long size) {
+        this.size = size;
+    }
+
+}
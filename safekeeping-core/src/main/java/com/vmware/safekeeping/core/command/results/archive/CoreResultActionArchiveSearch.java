@@ -0,0 +1,124 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.command.results.archive;
+
+import java.util.ArrayList;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+
+import com.vmware.safekeeping.core.control.target.ITarget;
+import com.vmware.safekeeping.core.profile.FileCatalog;
+import com.vmware.safekeeping.core.type.ManagedFcoEntityInfo;
+
+public class CoreResultActionArchiveSearch extends AbstractCoreResultActionArchive {
+
+    /**
+     * 
+     */
+    private static final long serialVersionUID = -2293874403470615542L;
+
+    private int diskId;
+
+    private String path;
+
+    private final Map<Integer, FileCatalog.Entry> matches;
+
+    private Integer listedGenerationId;
+
+    private final List<FileCatalog.Entry> content;
+
+    /**
+     * @param fco
+     * @param target
+     */
+    public CoreResultActionArchiveSearch(final ManagedFcoEntityInfo fco, final ITarget target) {
+        super(target);
+        setFcoEntityInfo(fco);
+        this.matches = new LinkedHashMap<>();
+        this.content = new ArrayList<>();
+    }
+
+    /**
+     * @return the entries under the path when it is a directory, in the
+     *         generation getListedGenerationId()
+     */
+    public List<FileCatalog.Entry> getContent() {
+        return this.content;
+    }
+
+    /**
+     * @return the diskId
+     */
+    public int getDiskId() {
+        return this.diskId;
+    }
+
+    /**
+     * @return the generation the content was listed from, null if the path is not
+     *         a directory
+     */
+    public Integer getListedGenerationId() {
+        return this.listedGenerationId;
+    }
+
+    /**
+     * @return the entry of the path in each generation holding it
+     */
+    public Map<Integer, FileCatalog.Entry> getMatches() {
+        return this.matches;
+    }
+
+    /**
+     * @return the path searched
+     */
+    public String getPath() {
+        return this.path;
+    }
+
+    /**
+     * @param diskId the diskId to set
+     */
+    public void setDiskId(final int diskId) {
+        this.diskId = diskId;
+    }
+
+    /**
+     * @param listedGenerationId the listedGenerationId to set
+     */
+    public void setListedGenerationId(final Integer listedGenerationId) {
+        this.listedGenerationId = listedGenerationId;
+    }
+
+    /**
+     * @param path the path to set
+     */
+    public void setPath(final String path) {
+        this.path = path;
+    }
+
+}
@@ -27,70 +27,68 @@
 package com.vmware.safekeeping.core.control;
 
 import java.io.ByteArrayInputStream;
-import java.io.IOException;
 import java.security.MessageDigest;
 import java.security.NoSuchAlgorithmException;
-import java.util.concurrent.Semaphore;
 import java.util.concurrent.atomic.AtomicBoolean;
 
+import com.vmware.jvix.jDiskLibConst;
+import com.vmware.safekeeping.core.core.SJvddk;
 import com.vmware.safekeeping.core.type.ManagedFcoEntityInfo;
 
+/**
+ * Block buffers of a dump or restore thread.
+ *
+ * Every stage of the pipeline (read, compression, encryption, upload) works on
+ * one of two arrays: stages that cannot work in place write to the work buffer
+ * and then {@link #swap()} it with the input buffer, so the result of a stage
+ * is always in the input buffer. The upload streams straight from it.
+ *
+ * MD5 and SHA-1 digests are computed by the native multi-buffer engine when it
+ * is enabled, batched with the blocks of the other threads; the digest methods
+ * fall back to the MessageDigest otherwise.
+ */
 public class TargetBuffer {
-    /**
-     * Logger for this class
-     */
     private static final float BUFFER_SIZE_MULTIPLICATOR = 1.1F;
 
-    private final byte[] bufferCompressData;
-    private final byte[] bufferCipher;
-    private final byte[] inputBuffer;
-    private final byte[] outputBuffer;
+    private byte[] inputBuffer;
+    private byte[] workBuffer;
     private final AtomicBoolean available;
     private final MessageDigest md5;
     private final MessageDigest sha;
     private final ManagedFcoEntityInfo entityInfo;
-    private final Semaphore semaphore;
     private final int bufferSize;
     private ByteArrayInputStream inputStream;
-
-    private final byte[] finalBuffer;
+    private final boolean nativeSha1;
+    private byte[] md5NativeDigest;
+    private byte[] shaNativeDigest;
 
     public TargetBuffer(final int bufferSize, final ManagedFcoEntityInfo entityInfo, MessageDigestAlgoritmhs algorithm)
             throws NoSuchAlgorithmException {
         this.bufferSize = bufferSize;
-        this.bufferCompressData = new byte[(int) (bufferSize * BUFFER_SIZE_MULTIPLICATOR)];
-        this.bufferCipher = new byte[(int) (bufferSize * BUFFER_SIZE_MULTIPLICATOR)];
         this.inputBuffer = new byte[(int) (bufferSize * BUFFER_SIZE_MULTIPLICATOR)];
-        this.outputBuffer = new byte[(int) (bufferSize * BUFFER_SIZE_MULTIPLICATOR)];
-        this.finalBuffer = new byte[(int) (bufferSize * BUFFER_SIZE_MULTIPLICATOR)];
+        this.workBuffer = new byte[(int) (bufferSize * BUFFER_SIZE_MULTIPLICATOR)];
         this.md5 = MessageDigest.getInstance(MessageDigestAlgoritmhs.MD5.toString());
         this.sha = MessageDigest.getInstance(algorithm.toString());
+        this.nativeSha1 = algorithm == MessageDigestAlgoritmhs.SHA1;
         this.available = new AtomicBoolean(true);
         this.entityInfo = entityInfo;
-        this.semaphore = new Semaphore(1);
     }
 
-    public void fillInputStream(final byte[] buffer, final int count) {
-        System.arraycopy(buffer, 0, this.finalBuffer, 0, count);
-        this.inputStream = new ByteArrayInputStream(this.finalBuffer, 0, count);
-    }
-
-    public void fillInputStreamWithLock(final byte[] buffer, final int count) throws InterruptedException {
-        this.semaphore.acquire();
-        System.arraycopy(buffer, 0, this.finalBuffer, 0, count);
-        this.inputStream = new ByteArrayInputStream(this.finalBuffer, 0, count);
+    /**
+     * Expose the first count bytes of the input buffer to the target upload
+     *
+     * @param count
+     */
+    public void fillInputStream(final int count) {
+        this.inputStream = new ByteArrayInputStream(this.inputBuffer, 0, count);
     }
 
     public AtomicBoolean getAvailable() {
         return this.available;
     }
 
-    public byte[] getBufferCipher() {
-        return this.bufferCipher;
-    }
-
-    public byte[] getBufferCompressData() {
-        return this.bufferCompressData;
+    public int getBufferSize() {
+        return this.bufferSize;
     }
 
     public ManagedFcoEntityInfo getEntityInfo() {
@@ -113,43 +111,62 @@ public class TargetBuffer {
         }
     }
 
-    public byte[] getOutputBuffer() {
-        return this.outputBuffer;
+    public byte[] getWorkBuffer() {
+        return this.workBuffer;
     }
 
     /**
      * @return
      */
     public byte[] md5Digest() {
+        if (this.md5NativeDigest != null) {
+            final byte[] digest = this.md5NativeDigest;
+            this.md5NativeDigest = null;
+            return digest;
+        }
         return this.md5.digest();
     }
 
     public void md5Update(final byte[] buffer, final int count) {
         this.md5.reset();
-        this.md5.update(buffer, 0, count);
-    }
-
-    public void releaseInputStream() throws IOException {
-        if (this.inputStream != null) {
-            this.inputStream.close();
-            this.inputStream = null;
+        this.md5NativeDigest = SJvddk.multiBufferHash(jDiskLibConst.HASH_MD5, buffer, 0, count);
+        if (this.md5NativeDigest == null) {
+            this.md5.update(buffer, 0, count);
         }
-        this.semaphore.release();
+    }
 
+    public void releaseInputStream() {
+        this.inputStream = null;
     }
 
     public byte[] shaDigest() {
+        if (this.shaNativeDigest != null) {
+            final byte[] digest = this.shaNativeDigest;
+            this.shaNativeDigest = null;
+            return digest;
+        }
         return this.sha.digest();
 
     }
 
     public void shaUpdate(final byte[] buffer, final int offset, final int count) {
         this.sha.reset();
-        this.sha.update(buffer, offset, count);
+        this.shaNativeDigest = this.nativeSha1
+                ? SJvddk.multiBufferHash(jDiskLibConst.HASH_SHA1, buffer, offset, count)
+                : null;
+        if (this.shaNativeDigest == null) {
+            this.sha.update(buffer, offset, count);
+        }
 
     }
 
-    public int getBufferSize() {
-        return bufferSize;
+    /**
+     * Make the output of the last stage, in the work buffer, the input of the
+     * next one
+     */
+    public void swap() {
+        final byte[] tmp = this.inputBuffer;
+        this.inputBuffer = this.workBuffer;
+        this.workBuffer = tmp;
     }
 }
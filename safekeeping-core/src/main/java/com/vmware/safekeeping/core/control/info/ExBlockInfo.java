@@ -35,6 +35,7 @@ import org.apache.commons.lang.StringUtils;
 
 import com.vmware.jvix.jDiskLibConst;
 import com.vmware.safekeeping.common.IBlockInfoProperties;
+import com.vmware.safekeeping.core.core.Crc32cMap;
 import com.vmware.safekeeping.core.logger.MessagesTemplate;
 import com.vmware.safekeeping.core.profile.BasicBlockInfo;
 import com.vmware.safekeeping.core.profile.SimpleBlockInfo;
@@ -60,6 +61,11 @@ public class ExBlockInfo extends BasicBlockInfo implements IBlockInfoProperties
 
     private boolean duplicated;
 
+    /**
+     * CRC32C of each 4 KB of the block data, null if not computed
+     */
+    private int[] crcMap;
+
     protected ExBlockInfo() {
         this.keyPath = null;
     }
@@ -82,6 +88,10 @@ public class ExBlockInfo extends BasicBlockInfo implements IBlockInfoProperties
         setLastBlock((value.getOffset() + value.getLength()) - 1);
         setIndex(value.getIndex());
         setSha1(value.getSha1());
+        setPackId(value.getPackId());
+        setPackOffset(value.getPackOffset());
+        setPackLength(value.getPackLength());
+        setCrc32c(value.getCrc32c());
         this.totalBlocks = totalBlocks;
         this.size = value.getLength() * jDiskLibConst.SECTOR_SIZE;
         this.keyPath = keyPath;
@@ -97,6 +107,10 @@ public class ExBlockInfo extends BasicBlockInfo implements IBlockInfoProperties
         setReason(entity, reason);
     }
 
+    public int[] getCrcMap() {
+        return this.crcMap;
+    }
+
     public String getDataKey() {
         if (StringUtils.isEmpty(getSha1())) {
             return StringUtils.EMPTY;
@@ -186,6 +200,10 @@ public class ExBlockInfo extends BasicBlockInfo implements IBlockInfoProperties
         return MessagesTemplate.separatorBar(isCompress());
     }
 
+    public void setCrcMap(final int[] crcMap) {
+        this.crcMap = crcMap;
+    }
+
     public void setDuplicated(final boolean exist) {
         this.duplicated = exist;
     }
@@ -256,6 +274,12 @@ public class ExBlockInfo extends BasicBlockInfo implements IBlockInfoProperties
         block.setLength(getLength());
         block.setMd5(getMd5());
         block.setSha1(getSha1());
+        block.setCrc32c(Crc32cMap.encode(getCrcMap()));
+        if (isPacked()) {
+            block.setPackId(getPackId());
+            block.setPackOffset(getPackOffset());
+            block.setPackLength(getPackLength());
+        }
         return block;
     }
 
@@ -26,11 +26,16 @@
  ******************************************************************************/
 package com.vmware.safekeeping.core.control.target;
 
+import java.util.Collections;
 import java.util.LinkedHashMap;
+import java.util.Map;
+import java.util.Objects;
+import java.util.concurrent.locks.ReentrantReadWriteLock;
 import java.util.logging.Level;
 import java.util.logging.Logger;
 
 import com.vmware.safekeeping.core.command.options.AbstractCoreTargetRepository;
+import com.vmware.safekeeping.core.core.Dedup;
 import com.vmware.safekeeping.core.profile.CoreGlobalSettings;
 import com.vmware.safekeeping.core.type.ByteArrayInOutStream;
 
@@ -43,10 +48,16 @@ abstract class AbstractTarget implements ITarget {
     protected String targetType;
     protected AbstractCoreTargetRepository options;
     private Boolean enable;
+    private final PackIndex packIndex;
+    private volatile Map<String, Dedup> dedupCache;
+    private final ReentrantReadWriteLock referencesLock;
+    private String removalEpoch;
 
     protected AbstractTarget(final AbstractCoreTargetRepository options) {
         this.options = options;
         this.enable = options.isEnable();
+        this.packIndex = new PackIndex();
+        this.referencesLock = new ReentrantReadWriteLock(true);
     }
 
     @Override
@@ -64,11 +75,54 @@ abstract class AbstractTarget implements ITarget {
         return result;
     }
 
+    /**
+     * @return the stream attributes of the blocks recently committed or
+     *         referenced on the target, keyed by digest, least recently used
+     *         first
+     */
+    Map<String, Dedup> getDedupCache() {
+        Map<String, Dedup> result = this.dedupCache;
+        if (result == null) {
+            synchronized (this) {
+                result = this.dedupCache;
+                if (result == null) {
+                    final int maxEntries = CoreGlobalSettings.getDedupMetadataCacheSize();
+                    result = Collections.synchronizedMap(new LinkedHashMap<String, Dedup>(1024, 0.75f, true) {
+                        private static final long serialVersionUID = 1L;
+
+                        @Override
+                        protected boolean removeEldestEntry(final Map.Entry<String, Dedup> eldest) {
+                            return size() > maxEntries;
+                        }
+                    });
+                    this.dedupCache = result;
+                }
+            }
+        }
+        return result;
+    }
+
     @Override
     public String getName() {
         return this.options.getName();
     }
 
+    /**
+     * @return the index of the packfiles of the target, shared by its operations
+     */
+    PackIndex getPackIndex() {
+        return this.packIndex;
+    }
+
+    /**
+     * @return the lock of the dedup references of the target: the dumps hold it
+     *         shared until their references are flushed, a generation removal
+     *         holds it exclusive
+     */
+    ReentrantReadWriteLock getReferencesLock() {
+        return this.referencesLock;
+    }
+
     @Override
     public String getTargetType() {
         return this.targetType;
@@ -97,6 +151,19 @@ abstract class AbstractTarget implements ITarget {
     protected abstract boolean post(final String path, final ByteArrayInOutStream digestOutput,
             final String contentType);
 
+    /**
+     * Drop the dedup cache if a generation was removed from the target since the
+     * cache was filled, by this process or by another one
+     *
+     * @param epoch removal epoch read from the target, null if none
+     */
+    synchronized void syncRemovalEpoch(final String epoch) {
+        if (!Objects.equals(epoch, this.removalEpoch)) {
+            getDedupCache().clear();
+            this.removalEpoch = epoch;
+        }
+    }
+
     @Override
     public boolean updateFcoProfileCatalog(final ByteArrayInOutStream byteArrayStream) {
         if (this.logger.isLoggable(Level.CONFIG)) {
@@ -27,24 +27,36 @@
 package com.vmware.safekeeping.core.control.target;
 
 import java.io.IOException;
+import java.security.MessageDigest;
 import java.security.NoSuchAlgorithmException;
+import java.util.ArrayList;
 import java.util.Collections;
 import java.util.HashMap;
 import java.util.LinkedHashMap;
+import java.util.List;
 import java.util.Map;
 import java.util.Map.Entry;
+import java.util.Set;
 import java.util.TreeMap;
+import java.util.UUID;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.locks.ReentrantReadWriteLock;
 import java.util.logging.Level;
 import java.util.logging.Logger;
 
+import javax.xml.bind.DatatypeConverter;
+
 import com.fasterxml.jackson.core.JsonProcessingException;
 import com.fasterxml.jackson.databind.ObjectMapper;
 import com.vmware.safekeeping.common.Utility;
+import com.vmware.safekeeping.core.control.TargetBuffer;
 import com.vmware.safekeeping.core.control.info.ExBlockInfo;
+import com.vmware.safekeeping.core.core.BlockLocker;
 import com.vmware.safekeeping.core.core.Dedup;
 import com.vmware.safekeeping.core.core.DedupItem;
 import com.vmware.safekeeping.core.profile.CoreGlobalSettings;
 import com.vmware.safekeeping.core.profile.GenerationProfile;
+import com.vmware.safekeeping.core.profile.SimpleBlockInfo;
 import com.vmware.safekeeping.core.type.ByteArrayInOutStream;
 import com.vmware.safekeeping.core.type.ManagedFcoEntityInfo;
 
@@ -53,12 +65,23 @@ abstract class AbstractTargetOperationImpl implements ITargetOperation {
     private static final String ACTIVE_KEY = "active";
     protected static final String MIME_BINARY_OCTECT_STREAM = "binary/octet-stream";
     protected static final String MIME_TEXT_PLAIN_STREAM = "text/plain";
+    protected static final String PACKS_FOLDER = "packs/";
+    protected static final String PACK_SUFFIX = ".pack";
+    protected static final String PACK_INDEX_SUFFIX = ".idx";
+    protected static final String REFERENCES_FOLDER = "refs/";
+    protected static final String REFERENCES_SUFFIX = ".ref";
+    protected static final String DUMP_LEASE_SUFFIX = ".dump";
+    protected static final String REMOVAL_EPOCH = "removal.epoch";
+    protected static final String REMOVAL_LEASE = "removal.lease";
+    private static final long REMOVAL_LEASE_POLL_MILLIS = 1000L;
     protected Logger logger;
     protected final ITarget parent;
     private Map<String, String> md5DiskList;
 
     private final HashMap<String, Object[]> store;
     private final ManagedFcoEntityInfo entityInfo;
+    private PackWriter packWriter;
+    private DedupReferenceLog dedupReferenceLog;
 
     AbstractTargetOperationImpl(final ITarget parent, final ManagedFcoEntityInfo entityInfo) {
         this.store = new HashMap<>();
@@ -67,6 +90,260 @@ abstract class AbstractTargetOperationImpl implements ITargetOperation {
         this.entityInfo = entityInfo;
     }
 
+    @Override
+    public String acquireDumpLease() throws IOException, InterruptedException {
+        final ReentrantReadWriteLock lock = getReferencesLock();
+        lock.readLock().lockInterruptibly();
+        final String folder = getDisksPath().concat(REFERENCES_FOLDER);
+        final String lease = String.format("%s%s-%s%s", folder, getEntityInfo().getUuid(), UUID.randomUUID(),
+                DUMP_LEASE_SUFFIX);
+        boolean result = false;
+        try {
+            putObject(lease, Long.toString(System.currentTimeMillis()));
+            // the lease is written before the removal lease is read, a removal
+            // writes its lease before it reads the dump leases: one of the two
+            // sees the other
+            while (isLeaseLive(folder.concat(REMOVAL_LEASE))) {
+                Thread.sleep(REMOVAL_LEASE_POLL_MILLIS);
+            }
+            final String epochKey = folder.concat(REMOVAL_EPOCH);
+            ((AbstractTarget) this.parent)
+                    .syncRemovalEpoch(doesObjectExist(epochKey) ? getObjectAsString(epochKey) : null);
+            result = true;
+        } finally {
+            if (!result) {
+                releaseDumpLease(lease);
+            }
+        }
+        return lease;
+    }
+
+    @Override
+    public boolean acquireRemovalLease() throws InterruptedException {
+        final ReentrantReadWriteLock lock = getReferencesLock();
+        lock.writeLock().lockInterruptibly();
+        final String folder = getDisksPath().concat(REFERENCES_FOLDER);
+        boolean result = false;
+        try {
+            putObject(folder.concat(REMOVAL_LEASE), Long.toString(System.currentTimeMillis()));
+            final String epoch = UUID.randomUUID().toString();
+            putObject(folder.concat(REMOVAL_EPOCH), epoch);
+            // the blocks cached by this process may be removed from now on
+            ((AbstractTarget) this.parent).syncRemovalEpoch(epoch);
+            for (final String key : listObjectKeys(folder)) {
+                if (key.endsWith(DUMP_LEASE_SUFFIX) && isLeaseLive(key)) {
+                    final String msg = String.format("Dump lease %s is held on %s", key, getTargetName());
+                    this.logger.warning(msg);
+                    return false;
+                }
+            }
+            result = true;
+        } catch (final IOException e) {
+            Utility.logWarning(this.logger, e);
+        } finally {
+            if (!result) {
+                releaseRemovalLease();
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Add generations of FCOs to the dedup list of a block json
+     *
+     * @param entities   block json
+     * @param references FCO uuid to generations
+     * @return the new block json
+     * @throws JsonProcessingException
+     */
+    private String addDedupGenerations(final String entities, final Map<String, Set<Integer>> references)
+            throws JsonProcessingException {
+        final Dedup dedup = new ObjectMapper().readValue(entities, Dedup.class);
+        for (final Entry<String, Set<Integer>> reference : references.entrySet()) {
+            DedupItem item = null;
+            for (final DedupItem d : dedup.getDedupList()) {
+                if (d.getUuid().contains(reference.getKey())) {
+                    item = d;
+                    break;
+                }
+            }
+            if (item == null) {
+                item = new DedupItem();
+                item.setUuid(reference.getKey());
+                dedup.getDedupList().add(item);
+            }
+            for (final Integer generationId : reference.getValue()) {
+                if (!item.getGenerations().contains(generationId)) {
+                    item.getGenerations().add(generationId);
+                }
+            }
+        }
+        return new ObjectMapper().writeValueAsString(dedup);
+    }
+
+    /**
+     * Set the stream attributes recorded in the block json on the block
+     *
+     * @param block
+     * @param dedup
+     */
+    private static void applyDedup(final ExBlockInfo block, final Dedup dedup) {
+        if ((block.getMd5() == null) || !block.getMd5().equalsIgnoreCase(dedup.getMd5())) {
+            block.setMd5(dedup.getMd5());
+        }
+        // XOR operation
+        if (((block.isCipher() && !dedup.isCipher()) || (!block.isCipher() && dedup.isCipher()))) {
+            block.setCipher(dedup.isCipher());
+        }
+        // XOR operation
+        if (((block.isCompress() && !dedup.isCompress()) || (!block.isCompress() && dedup.isCompress()))) {
+            block.setCompress(dedup.isCompress());
+        }
+        if (block.getSize() != dedup.getSize()) {
+            block.setSize(dedup.getSize());
+        }
+        if (block.getStreamSize() != dedup.getStreamSize()) {
+            block.setStreamSize(dedup.getStreamSize());
+        }
+    }
+
+    /**
+     * Keep the stream attributes of a committed block for the next dedup hits
+     *
+     * @param block
+     */
+    protected void cacheDedup(final ExBlockInfo block) {
+        if (CoreGlobalSettings.isDedupReferenceLog()) {
+            final Dedup dedup = new Dedup();
+            dedup.setMd5(block.getMd5());
+            dedup.setSha1(block.getSha1());
+            dedup.setCipher(block.isCipher());
+            dedup.setCompress(block.isCompress());
+            dedup.setSize(block.getSize());
+            dedup.setStreamSize(block.getStreamSize());
+            getDedupCache().put(block.getSha1(), dedup);
+        }
+    }
+
+    @Override
+    public boolean checkPackedDump(final ExBlockInfo block) {
+        final PackIndex.Entry entry = getPackIndex().get(block.getSha1());
+        if ((entry == null) || !entry.getPackId().equals(block.getPackId())
+                || !entry.getMd5().equalsIgnoreCase(block.getMd5())) {
+            return false;
+        }
+        try {
+            final byte[] stream = new byte[(int) entry.getLength()];
+            readPack(entry.getPackId(), entry.getOffset(), stream, stream.length);
+            final String md5 = DatatypeConverter.printHexBinary(MessageDigest.getInstance("MD5").digest(stream));
+            return md5.equalsIgnoreCase(entry.getMd5());
+        } catch (final IOException | NoSuchAlgorithmException e) {
+            Utility.logWarning(this.logger, e);
+            return false;
+        }
+    }
+
+    /**
+     * Append the stream of a small block to the current packfile
+     *
+     * @param block
+     * @param targetBuffer
+     * @return
+     */
+    protected boolean closePostPackedDump(final ExBlockInfo block, final TargetBuffer targetBuffer) {
+        boolean result = false;
+        try {
+            result = getPackWriter().append(block, targetBuffer.getInputBuffer(), (int) block.getStreamSize());
+            block.setDuplicated(false);
+            if (result) {
+                getMd5DiskList().put(block.getKey(), block.getMd5());
+            } else {
+                block.setReason(getEntityInfo(), "Packfile write failed");
+            }
+        } finally {
+            final long postEndTime = System.nanoTime();
+            block.setEndTime(postEndTime);
+        }
+        return result;
+    }
+
+    @Override
+    public boolean compactDedupReferences() {
+        final Map<String, Map<String, Set<Integer>>> references = new TreeMap<>();
+        final List<String> keys = new ArrayList<>();
+        try {
+            for (final String key : listObjectKeys(getDisksPath().concat(REFERENCES_FOLDER))) {
+                if (key.endsWith(REFERENCES_SUFFIX)) {
+                    DedupReferenceLog.decode(getObject(key), references);
+                    keys.add(key);
+                }
+            }
+        } catch (final IOException e) {
+            Utility.logWarning(this.logger, e);
+            return false;
+        }
+        if (this.logger.isLoggable(Level.INFO)) {
+            final String msg = String.format("Compacting %d dedup reference logs (%d blocks) on %s", keys.size(),
+                    references.size(), getTargetName());
+            this.logger.info(msg);
+        }
+        boolean result = true;
+        for (final Entry<String, Map<String, Set<Integer>>> reference : references.entrySet()) {
+            final SimpleBlockInfo simpleBlock = new SimpleBlockInfo();
+            simpleBlock.setSha1(reference.getKey());
+            final ExBlockInfo block = new ExBlockInfo(simpleBlock, 0, getDisksPath());
+            boolean locked = false;
+            try {
+                BlockLocker.lockBlock(block);
+                locked = true;
+                final String entities = getObjectAsString(block.getJsonKey());
+                putObject(block.getJsonKey(), addDedupGenerations(entities, reference.getValue()));
+            } catch (final IOException e) {
+                Utility.logWarning(this.logger, e);
+                result = false;
+            } catch (final InterruptedException e) {
+                this.logger.log(Level.WARNING, "Interrupted!", e);
+                // Restore interrupted state...
+                Thread.currentThread().interrupt();
+                return false;
+            } finally {
+                if (locked) {
+                    BlockLocker.releaseBlock(block);
+                }
+            }
+        }
+        // the logs are kept until every reference is folded, folding is idempotent
+        if (result) {
+            for (final String key : keys) {
+                try {
+                    deleteObject(key);
+                } catch (final IOException e) {
+                    Utility.logWarning(this.logger, e);
+                    result = false;
+                }
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Reference the packed copy of a block, if any. No I/O is done on the target
+     *
+     * @param block
+     * @return true if the block is packed
+     */
+    protected boolean dedupPackedDump(final ExBlockInfo block) {
+        final PackIndex.Entry entry = getPackIndex().get(block.getSha1());
+        if (entry == null) {
+            return false;
+        }
+        entry.fill(block);
+        block.setDuplicated(true);
+        getMd5DiskList().put(block.getKey(), block.getMd5());
+        block.setEndTime(System.nanoTime());
+        return true;
+    }
+
     @Override
     public LinkedHashMap<String, String> defaultConfigurations() {
         final LinkedHashMap<String, String> result = new LinkedHashMap<>();
@@ -79,6 +356,36 @@ abstract class AbstractTargetOperationImpl implements ITargetOperation {
         return this.parent.doesObjectExist(key);
     }
 
+    @Override
+    public boolean flushDedupReferences() throws InterruptedException {
+        final DedupReferenceLog log;
+        synchronized (this) {
+            log = this.dedupReferenceLog;
+        }
+        return (log == null) || log.flush();
+    }
+
+    @Override
+    public boolean flushPacks() throws InterruptedException {
+        final PackWriter writer;
+        synchronized (this) {
+            writer = this.packWriter;
+        }
+        return (writer == null) || writer.flush();
+    }
+
+    private Map<String, Dedup> getDedupCache() {
+        return ((AbstractTarget) this.parent).getDedupCache();
+    }
+
+    private synchronized DedupReferenceLog getDedupReferenceLog() {
+        if (this.dedupReferenceLog == null) {
+            this.dedupReferenceLog = new DedupReferenceLog(getEntityInfo().getUuid(), this::putDedupReferences,
+                    CoreGlobalSettings.getDedupReferenceBatch());
+        }
+        return this.dedupReferenceLog;
+    }
+
     @Override
     public String getDisksPath() {
         return this.parent.getFullPath(CoreGlobalSettings.REPOSITORY_DATA_PATH);
@@ -99,6 +406,17 @@ abstract class AbstractTargetOperationImpl implements ITargetOperation {
         return getObject(contentName);
     }
 
+    @Override
+    public byte[] getFileCatalogToByteArray(final ManagedFcoEntityInfo fcoEntity, final int genId, final int diskId)
+            throws IOException {
+        final String contentName = String.format("%s/%d/%d%s", fcoEntity.getUuid(), genId, diskId,
+                CoreGlobalSettings.FILE_CATALOG_SUFFIX);
+        if (!doesObjectExist(contentName)) {
+            return null;
+        }
+        return getObject(contentName);
+    }
+
     @Override
     public String getFullPath(final String path) {
         return this.parent.getFullPath(path);
@@ -141,6 +459,45 @@ abstract class AbstractTargetOperationImpl implements ITargetOperation {
         return result;
     }
 
+    /**
+     * @return the pack index of the target, loaded on first use
+     */
+    protected PackIndex getPackIndex() {
+        final PackIndex index = ((AbstractTarget) this.parent).getPackIndex();
+        if (!index.isLoaded()) {
+            synchronized (index) {
+                if (!index.isLoaded()) {
+                    try {
+                        loadPackIndex(index);
+                    } catch (final IOException e) {
+                        Utility.logWarning(this.logger, e);
+                    }
+                    index.setLoaded();
+                }
+            }
+        }
+        return index;
+    }
+
+    protected String getPackIndexKey(final String packId) {
+        return getDisksPath().concat(PACKS_FOLDER).concat(packId).concat(PACK_INDEX_SUFFIX);
+    }
+
+    protected String getPackKey(final String packId) {
+        return getDisksPath().concat(PACKS_FOLDER).concat(packId).concat(PACK_SUFFIX);
+    }
+
+    private synchronized PackWriter getPackWriter() {
+        if (this.packWriter == null) {
+            this.packWriter = new PackWriter(getPackIndex(), this::putPack, CoreGlobalSettings.getPackMaxSize());
+        }
+        return this.packWriter;
+    }
+
+    private ReentrantReadWriteLock getReferencesLock() {
+        return ((AbstractTarget) this.parent).getReferencesLock();
+    }
+
     @Override
     public String getTargetName() {
         return this.parent.getTargetType();
@@ -151,11 +508,74 @@ abstract class AbstractTargetOperationImpl implements ITargetOperation {
         return this.parent.getUri(path);
     }
 
+    /**
+     * @param block
+     * @return true if the block is known to be committed, from the stream
+     *         attributes cache
+     */
+    protected boolean isDedupCached(final ExBlockInfo block) {
+        return CoreGlobalSettings.isDedupReferenceLog() && getDedupCache().containsKey(block.getSha1());
+    }
+
+    /**
+     * @param key lease on the target
+     * @return true if the lease exists and is younger than the lease expiry
+     * @throws IOException
+     */
+    private boolean isLeaseLive(final String key) throws IOException {
+        if (!doesObjectExist(key)) {
+            return false;
+        }
+        final String since;
+        try {
+            since = getObjectAsString(key);
+        } catch (final IOException e) {
+            if (doesObjectExist(key)) {
+                throw e;
+            }
+            // released meanwhile
+            return false;
+        }
+        try {
+            final long age = System.currentTimeMillis() - Long.parseLong(since.trim());
+            return age < TimeUnit.HOURS.toMillis(CoreGlobalSettings.getDumpLeaseExpiryHours());
+        } catch (final NumberFormatException e) {
+            Utility.logWarning(this.logger, e);
+            return false;
+        }
+    }
+
     @Override
     public boolean isMd5FileExist(final GenerationProfile profile) {
         return doesObjectExist(profile.getMd5ContentPath());
     }
 
+    /**
+     * @param block
+     * @return true if the block stream is small enough to be packed
+     */
+    protected boolean isPackable(final ExBlockInfo block) {
+        return CoreGlobalSettings.isPackSmallBlocks()
+                && (block.getStreamSize() <= CoreGlobalSettings.getPackBlockThreshold())
+                && (block.getStreamSize() <= CoreGlobalSettings.getPackMaxSize());
+    }
+
+    /**
+     * Check the packed copy of a block. A block of a generation must be found in
+     * the pack it was recorded in
+     *
+     * @param block
+     * @return
+     */
+    protected boolean isPackedKeyExist(final ExBlockInfo block) {
+        final PackIndex.Entry entry = getPackIndex().get(block.getSha1());
+        if (entry == null) {
+            return false;
+        }
+        return !block.isPacked()
+                || (entry.getPackId().equals(block.getPackId()) && entry.getMd5().equalsIgnoreCase(block.getMd5()));
+    }
+
     @Override
     public boolean isProfileVmExist(final ManagedFcoEntityInfo fco) {
         return doesObjectExist(CoreGlobalSettings.getDefaultProfileVmPath(fco.getUuid()));
@@ -177,28 +597,35 @@ abstract class AbstractTargetOperationImpl implements ITargetOperation {
 
     }
 
+    /**
+     * @param folder
+     * @return the keys of the objects stored in the folder
+     * @throws IOException
+     */
+    protected abstract List<String> listObjectKeys(String folder) throws IOException;
+
+    /**
+     * Load the indexes of all the packfiles of the target
+     *
+     * @param index
+     * @throws IOException
+     */
+    private void loadPackIndex(final PackIndex index) throws IOException {
+        for (final String key : listObjectKeys(getDisksPath().concat(PACKS_FOLDER))) {
+            if (key.endsWith(PACK_INDEX_SUFFIX)) {
+                final String packId = key.substring(key.lastIndexOf('/') + 1,
+                        key.length() - PACK_INDEX_SUFFIX.length());
+                index.addAll(PackIndex.read(packId, getObject(key)));
+            }
+        }
+    }
+
     protected String manageDedupEntities(final ExBlockInfo block, final String entities)
             throws JsonProcessingException {
         final String uuid = getEntityInfo().getUuid();
         final Dedup dedup = new ObjectMapper().readValue(entities, Dedup.class);
         final Integer generationId = block.getGenerationId();
-        if ((block.getMd5() == null) || !block.getMd5().equalsIgnoreCase(dedup.getMd5())) {
-            block.setMd5(dedup.getMd5());
-        }
-        // XOR operation
-        if (((block.isCipher() && !dedup.isCipher()) || (!block.isCipher() && dedup.isCipher()))) {
-            block.setCipher(dedup.isCipher());
-        }
-        // XOR operation
-        if (((block.isCompress() && !dedup.isCompress()) || (!block.isCompress() && dedup.isCompress()))) {
-            block.setCompress(dedup.isCompress());
-        }
-        if (block.getSize() != dedup.getSize()) {
-            block.setSize(dedup.getSize());
-        }
-        if (block.getStreamSize() != dedup.getStreamSize()) {
-            block.setStreamSize(dedup.getStreamSize());
-        }
+        applyDedup(block, dedup);
         boolean found = false;
         for (final DedupItem d : dedup.getDedupList()) {
             if (d.getUuid().contains(uuid)) {
@@ -216,6 +643,36 @@ abstract class AbstractTargetOperationImpl implements ITargetOperation {
 
     }
 
+    /**
+     * Read the stream of a packed block with a range read of its pack, and check
+     * its md5
+     *
+     * @param blockInfo
+     * @param targetBuffer
+     * @return
+     */
+    protected boolean openGetPackedDump(final ExBlockInfo blockInfo, final TargetBuffer targetBuffer) {
+        boolean result = false;
+        final int length = (int) blockInfo.getPackLength();
+        try {
+            readPack(blockInfo.getPackId(), blockInfo.getPackOffset(), targetBuffer.getInputBuffer(), length);
+            blockInfo.setStreamSize(length);
+            targetBuffer.md5Update(targetBuffer.getInputBuffer(), length);
+            final String md5 = DatatypeConverter.printHexBinary(targetBuffer.md5Digest());
+            if (md5.equalsIgnoreCase(blockInfo.getMd5())) {
+                result = true;
+            } else {
+                final String msg = String.format("md5 mismatch expected:%s found:%s", blockInfo.getMd5(), md5);
+                blockInfo.setReason(getEntityInfo(), msg);
+                this.logger.warning(msg);
+            }
+        } catch (final IOException e) {
+            Utility.logWarning(this.logger, e);
+            blockInfo.setReason(getEntityInfo(), e);
+        }
+        return result;
+    }
+
     protected abstract boolean post(GenerationProfile profile, final String path,
             final ByteArrayInOutStream digestOutput, final String contentType) throws IOException;
 
@@ -224,6 +681,17 @@ abstract class AbstractTargetOperationImpl implements ITargetOperation {
         return post(null, path, digestOutput, contentType);
     }
 
+    @Override
+    public boolean postFileCatalog(final GenerationProfile profile, final int diskId,
+            final ByteArrayInOutStream byteArrayStream) throws IOException {
+        final String contentName = profile.getFileCatalogContentPath(diskId);
+        if (this.logger.isLoggable(Level.INFO)) {
+            final String msg = String.format("Post file catalog:%s to %s", contentName, getTargetName());
+            this.logger.info(msg);
+        }
+        return post(profile, contentName, byteArrayStream, MIME_BINARY_OCTECT_STREAM);
+    }
+
     @Override
     public boolean postGenerationProfile(final GenerationProfile profile) {
         if (this.logger.isLoggable(Level.INFO)) {
@@ -308,6 +776,131 @@ abstract class AbstractTargetOperationImpl implements ITargetOperation {
         return post(profile, contentName, byteArrayStream, MIME_TEXT_PLAIN_STREAM);
     }
 
+    /**
+     * Write a binary object with a single write
+     *
+     * @param key
+     * @param content
+     * @param length
+     * @throws IOException
+     */
+    protected abstract void putBinaryObject(String key, byte[] content, int length) throws IOException;
+
+    /**
+     * Write a batch of dedup references of a generation as a new log object
+     *
+     * @param generationId
+     * @param content
+     * @throws IOException
+     */
+    private void putDedupReferences(final int generationId, final byte[] content) throws IOException {
+        final String key = String.format("%s%s%s-%d-%s%s", getDisksPath(), REFERENCES_FOLDER,
+                getEntityInfo().getUuid(), generationId, UUID.randomUUID(), REFERENCES_SUFFIX);
+        putBinaryObject(key, content, content.length);
+    }
+
+    /**
+     * Write a packfile, then its index
+     *
+     * @param packId
+     * @param pack
+     * @param length
+     * @param index
+     * @throws IOException
+     */
+    private void putPack(final String packId, final byte[] pack, final int length, final byte[] index)
+            throws IOException {
+        putBinaryObject(getPackKey(packId), pack, length);
+        putBinaryObject(getPackIndexKey(packId), index, index.length);
+    }
+
+    /**
+     * Read a range of a packfile
+     *
+     * @param packId
+     * @param offset
+     * @param buffer
+     * @param length
+     * @throws IOException
+     */
+    protected abstract void readPack(String packId, long offset, byte[] buffer, int length) throws IOException;
+
+    /**
+     * Reference a committed block in the log of its generation, leaving its json
+     * untouched
+     *
+     * @param block
+     * @param dedup stream attributes of the committed block
+     */
+    private void referenceDedup(final ExBlockInfo block, final Dedup dedup) {
+        applyDedup(block, dedup);
+        getDedupReferenceLog().add(block.getGenerationId(), block.getSha1());
+        block.setDuplicated(true);
+        getMd5DiskList().put(block.getKey(), block.getMd5());
+    }
+
+    /**
+     * Reference a committed block from the json read from the target
+     *
+     * @param block
+     * @param entities block json
+     * @throws JsonProcessingException
+     */
+    protected void referenceDedupEntities(final ExBlockInfo block, final String entities)
+            throws JsonProcessingException {
+        final Dedup dedup = new ObjectMapper().readValue(entities, Dedup.class);
+        referenceDedup(block, dedup);
+        cacheDedup(block);
+    }
+
+    @Override
+    public boolean referenceDump(final ExBlockInfo block) {
+        if (dedupPackedDump(block)) {
+            return true;
+        }
+        if (!CoreGlobalSettings.isDedupReferenceLog()) {
+            return false;
+        }
+        final Dedup dedup = getDedupCache().get(block.getSha1());
+        if (dedup == null) {
+            return false;
+        }
+        referenceDedup(block, dedup);
+        block.setEndTime(System.nanoTime());
+        return true;
+    }
+
+    @Override
+    public void releaseDumpLease(final String lease) {
+        try {
+            deleteObject(lease);
+        } catch (final IOException e) {
+            Utility.logWarning(this.logger, e);
+        } finally {
+            getReferencesLock().readLock().unlock();
+        }
+    }
+
+    @Override
+    public void releaseRemovalLease() {
+        final ReentrantReadWriteLock lock = getReferencesLock();
+        if (lock.isWriteLockedByCurrentThread()) {
+            try {
+                deleteObject(getDisksPath().concat(REFERENCES_FOLDER).concat(REMOVAL_LEASE));
+            } catch (final IOException e) {
+                Utility.logWarning(this.logger, e);
+            } finally {
+                lock.writeLock().unlock();
+            }
+        }
+    }
+
+    @Override
+    public void removeDump(final ExBlockInfo dumpFileInfo) throws IOException {
+        getDedupCache().remove(dumpFileInfo.getSha1());
+        ITargetOperation.super.removeDump(dumpFileInfo);
+    }
+
     @Override
     public boolean removeFcoProfile(final ManagedFcoEntityInfo fcoInfo) {
         return deleteFolder(fcoInfo.getUuid());
@@ -0,0 +1,107 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.control.target;
+
+import java.util.List;
+
+import com.vmware.jvix.jDiskLibConst;
+import com.vmware.safekeeping.core.control.info.ExBlockInfo;
+import com.vmware.safekeeping.core.profile.BasicBlockInfo;
+import com.vmware.safekeeping.core.util.AESEncryptionManager;
+
+/**
+ * Description, for the native library, of where the consolidated blocks of a
+ * disk generation are stored on a file target: the arrays expected by
+ * jDiskLib.guestFsOpen and jDiskLib.nbdStart.
+ */
+final class ArchivedExtents {
+
+    private final String[] paths;
+    private final long[] extents;
+    private final int[] params;
+    private final byte[] key;
+
+    /**
+     * @param target file target holding the generation
+     * @param blocks consolidated blocks of the generation, sorted by offset
+     */
+    ArchivedExtents(final FileTargetOperations target, final List<BasicBlockInfo> blocks) {
+        final int count = blocks.size();
+        this.paths = new String[count];
+        this.extents = new long[jDiskLibConst.GUESTFS_EXTENT_SIZE * count];
+        this.params = new int[jDiskLibConst.GUESTFS_PARAMS_SIZE * count];
+        boolean cipher = false;
+
+        for (int i = 0; i < count; i++) {
+            final BasicBlockInfo block = blocks.get(i);
+            final ExBlockInfo exBlock = new ExBlockInfo(block, count, target.getDisksPath());
+            final int e = jDiskLibConst.GUESTFS_EXTENT_SIZE * i;
+            int flags = 0;
+            if (exBlock.isPacked()) {
+                this.paths[i] = target.getPackKey(exBlock.getPackId());
+                this.extents[e + jDiskLibConst.GUESTFS_EXTENT_FILE_OFFSET] = exBlock.getPackOffset();
+                this.extents[e + jDiskLibConst.GUESTFS_EXTENT_STORED_LENGTH] = exBlock.getPackLength();
+            } else {
+                this.paths[i] = target.getFullPath(exBlock.getDataKey());
+            }
+            this.extents[e + jDiskLibConst.GUESTFS_EXTENT_OFFSET] = block.getOffset() * jDiskLibConst.SECTOR_SIZE;
+            this.extents[e + jDiskLibConst.GUESTFS_EXTENT_LENGTH] = block.getSizeInBytes();
+            this.extents[e + jDiskLibConst.GUESTFS_EXTENT_PLAIN_SIZE] = block.getOriginalLenght()
+                    * jDiskLibConst.SECTOR_SIZE;
+            this.extents[e + jDiskLibConst.GUESTFS_EXTENT_STREAM_OFFSET] = block.getStreamOffset();
+            if (block.isCipher()) {
+                flags |= jDiskLibConst.GUESTFS_CIPHER;
+                cipher = true;
+            }
+            if (block.isCompress()) {
+                flags |= jDiskLibConst.GUESTFS_COMPRESS;
+            }
+            this.params[jDiskLibConst.GUESTFS_PARAMS_SIZE * i] = flags;
+            this.params[(jDiskLibConst.GUESTFS_PARAMS_SIZE * i) + 1] = block.getCipherOffset();
+        }
+        this.key = cipher ? AESEncryptionManager.getRawKey() : null;
+    }
+
+    long[] getExtents() {
+        return this.extents;
+    }
+
+    /**
+     * @return the raw AES key, null if no block is encrypted
+     */
+    byte[] getKey() {
+        return this.key;
+    }
+
+    int[] getParams() {
+        return this.params;
+    }
+
+    String[] getPaths() {
+        return this.paths;
+    }
+}
@@ -26,10 +26,13 @@
  ******************************************************************************/
 package com.vmware.safekeeping.core.control.target;
 
+import java.io.ByteArrayInputStream;
 import java.io.IOException;
 import java.io.InputStream;
 import java.nio.charset.StandardCharsets;
+import java.security.MessageDigest;
 import java.security.NoSuchAlgorithmException;
+import java.util.ArrayList;
 import java.util.List;
 import java.util.logging.Level;
 import java.util.logging.Logger;
@@ -43,6 +46,7 @@ import com.amazonaws.SdkClientException;
 import com.amazonaws.services.s3.AmazonS3;
 import com.amazonaws.services.s3.model.CopyObjectResult;
 import com.amazonaws.services.s3.model.GetObjectRequest;
+import com.amazonaws.services.s3.model.ObjectListing;
 import com.amazonaws.services.s3.model.ObjectMetadata;
 import com.amazonaws.services.s3.model.PutObjectRequest;
 import com.amazonaws.services.s3.model.PutObjectResult;
@@ -56,6 +60,7 @@ import com.vmware.safekeeping.common.Utility;
 import com.vmware.safekeeping.core.control.TargetBuffer;
 import com.vmware.safekeeping.core.control.info.ExBlockInfo;
 import com.vmware.safekeeping.core.core.Dedup;
+import com.vmware.safekeeping.core.profile.CoreGlobalSettings;
 import com.vmware.safekeeping.core.profile.FcoGenerationsCatalog;
 import com.vmware.safekeeping.core.profile.GenerationProfile;
 import com.vmware.safekeeping.core.type.ByteArrayInOutStream;
@@ -76,6 +81,9 @@ class AwsS3TargetOperations extends AbstractTargetOperationImpl {
 
     @Override
     public boolean closePostDump(final ExBlockInfo block, final TargetBuffer targetBuffer) {
+        if (isPackable(block)) {
+            return closePostPackedDump(block, targetBuffer);
+        }
         boolean result = true;
         try {
             final String uuid = getEntityInfo().getUuid();
@@ -94,6 +102,7 @@ class AwsS3TargetOperations extends AbstractTargetOperationImpl {
             block.setDuplicated(false);
             if (result) {
                 getMd5DiskList().put(block.getKey(), block.getMd5());
+                cacheDedup(block);
             }
         } catch (final JsonProcessingException | SdkClientException e) {
             result = false;
@@ -128,17 +137,24 @@ class AwsS3TargetOperations extends AbstractTargetOperationImpl {
 
     @Override
     public boolean dedupDump(final ExBlockInfo block) {
+        if (dedupPackedDump(block)) {
+            return true;
+        }
         boolean result = true;
         try {
             String entities;
 
             entities = this.s3.getObjectAsString(getBacketname(), block.getJsonKey());
-            final String newEntities = manageDedupEntities(block, entities);
-            this.s3.putObject(getBacketname(), block.getJsonKey(), newEntities);
+            if (CoreGlobalSettings.isDedupReferenceLog()) {
+                referenceDedupEntities(block, entities);
+            } else {
+                final String newEntities = manageDedupEntities(block, entities);
+                this.s3.putObject(getBacketname(), block.getJsonKey(), newEntities);
 
-            block.setDuplicated(true);
+                block.setDuplicated(true);
 
-            getMd5DiskList().put(block.getKey(), block.getMd5());
+                getMd5DiskList().put(block.getKey(), block.getMd5());
+            }
 
         } catch (final JsonProcessingException e) {
             result = false;
@@ -183,6 +199,13 @@ class AwsS3TargetOperations extends AbstractTargetOperationImpl {
 
     @Override
     public boolean doesKeyExist(final ExBlockInfo block) {
+        if (isPackedKeyExist(block)) {
+            return true;
+        } else if (block.isPacked()) {
+            return false;
+        } else if (isDedupCached(block)) {
+            return true;
+        }
         return this.s3.doesObjectExist(getBacketname(), block.getDataKey())
                 && this.s3.doesObjectExist(getBacketname(), block.getJsonKey());
     }
@@ -223,6 +246,26 @@ class AwsS3TargetOperations extends AbstractTargetOperationImpl {
         return this.parent.getOptions().getRoot();
     }
 
+    @Override
+    protected List<String> listObjectKeys(final String folder) throws IOException {
+        final List<String> result = new ArrayList<>();
+        try {
+            ObjectListing listing = this.s3.listObjects(getBacketname(), folder);
+            while (true) {
+                for (final S3ObjectSummary summary : listing.getObjectSummaries()) {
+                    result.add(summary.getKey());
+                }
+                if (!listing.isTruncated()) {
+                    break;
+                }
+                listing = this.s3.listNextBatchOfObjects(listing);
+            }
+        } catch (final SdkClientException e) {
+            throw new IOException(e);
+        }
+        return result;
+    }
+
     @Override
     public ITargetOperation newTargetOperation(final ManagedFcoEntityInfo entityInfo, final Logger logger)
             throws NoSuchAlgorithmException {
@@ -238,6 +281,9 @@ class AwsS3TargetOperations extends AbstractTargetOperationImpl {
                     blockInfo.getKey());
             this.logger.fine(msg);
         }
+        if (blockInfo.isPacked()) {
+            return openGetPackedDump(blockInfo, targetBuffer);
+        }
         final S3Object s3Object = this.s3.getObject(new GetObjectRequest(getBacketname(), blockInfo.getDataKey()));
         if (blockInfo.getMd5().equalsIgnoreCase(s3Object.getObjectMetadata().getETag())) {
             blockInfo.setStreamSize(s3Object.getObjectMetadata().getContentLength());
@@ -299,4 +345,42 @@ class AwsS3TargetOperations extends AbstractTargetOperationImpl {
 
     }
 
+    @Override
+    protected void putBinaryObject(final String key, final byte[] content, final int length) throws IOException {
+        try {
+            final MessageDigest md5 = MessageDigest.getInstance("MD5");
+            md5.update(content, 0, length);
+            final ObjectMetadata metadata = new ObjectMetadata();
+            metadata.setContentLength(length);
+            metadata.setContentMD5(new String(Base64.encodeBase64(md5.digest()), StandardCharsets.UTF_8));
+            metadata.setContentType(MIME_BINARY_OCTECT_STREAM);
+            this.s3.putObject(
+                    new PutObjectRequest(getBacketname(), key, new ByteArrayInputStream(content, 0, length), metadata));
+        } catch (final NoSuchAlgorithmException | SdkClientException e) {
+            throw new IOException(e);
+        }
+    }
+
+    @Override
+    protected void readPack(final String packId, final long offset, final byte[] buffer, final int length)
+            throws IOException {
+        try {
+            final S3Object s3Object = this.s3.getObject(new GetObjectRequest(getBacketname(), getPackKey(packId))
+                    .withRange(offset, (offset + length) - 1));
+            try (S3ObjectInputStream s3InputStream = s3Object.getObjectContent()) {
+                int count = 0;
+                int n = 0;
+                while ((count < length) && ((n = s3InputStream.read(buffer, count, length - count)) > -1)) {
+                    count += n;
+                }
+                if (count != length) {
+                    throw new IOException(String.format("Pack %s short read %d of %d bytes at offset %d", packId,
+                            count, length, offset));
+                }
+            }
+        } catch (final SdkClientException e) {
+            throw new IOException(e);
+        }
+    }
+
 }
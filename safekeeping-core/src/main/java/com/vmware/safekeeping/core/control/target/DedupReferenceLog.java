@@ -0,0 +1,174 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.control.target;
+
+import java.io.ByteArrayInputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.IOException;
+import java.nio.charset.StandardCharsets;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.Set;
+import java.util.TreeSet;
+import java.util.logging.Logger;
+
+import javax.xml.bind.DatatypeConverter;
+
+
+/**
+ * Append only log of the dedup references of an FCO.
+ *
+ * A dedup hit only adds the block digest to the pending batch of its
+ * generation. A full batch is written by the thread that filled it as one log
+ * object: the magic, the FCO uuid, the generation, the number of references
+ * and, for each reference, the digest. The logs of the target are folded into
+ * the json of the blocks, and deleted, before any generation is removed.
+ */
+final class DedupReferenceLog {
+
+    interface ReferenceStore {
+        /**
+         * Write a batch of references
+         *
+         * @param generationId
+         * @param content
+         * @throws IOException
+         */
+        void putReferences(int generationId, byte[] content) throws IOException;
+    }
+
+    private static final Logger logger = Logger.getLogger(DedupReferenceLog.class.getName());
+
+    private static final byte[] MAGIC = "SKDREFS1".getBytes(StandardCharsets.US_ASCII);
+
+    /**
+     * Decode a reference log
+     *
+     * @param content
+     * @param references digest to FCO uuid to generations, updated with the
+     *                   content of the log
+     * @throws IOException
+     */
+    static void decode(final byte[] content, final Map<String, Map<String, Set<Integer>>> references)
+            throws IOException {
+        try (DataInputStream in = new DataInputStream(new ByteArrayInputStream(content))) {
+            final byte[] magic = new byte[MAGIC.length];
+            in.readFully(magic);
+            if (!Arrays.equals(magic, MAGIC)) {
+                throw new IOException("Invalid dedup reference log");
+            }
+            final String uuid = in.readUTF();
+            final Integer generationId = in.readInt();
+            final int count = in.readInt();
+            for (int i = 0; i < count; i++) {
+                final byte[] digest = new byte[in.readUnsignedByte()];
+                in.readFully(digest);
+                references.computeIfAbsent(DatatypeConverter.printHexBinary(digest), k -> new HashMap<>())
+                        .computeIfAbsent(uuid, k -> new TreeSet<>()).add(generationId);
+            }
+        }
+    }
+
+    private static byte[] encode(final String uuid, final int generationId, final List<byte[]> digests)
+            throws IOException {
+        final ByteArrayOutputStream result = new ByteArrayOutputStream(64 + (digests.size() * 24));
+        try (DataOutputStream out = new DataOutputStream(result)) {
+            out.write(MAGIC);
+            out.writeUTF(uuid);
+            out.writeInt(generationId);
+            out.writeInt(digests.size());
+            for (final byte[] digest : digests) {
+                out.writeByte(digest.length);
+                out.write(digest);
+            }
+        }
+        return result.toByteArray();
+    }
+
+    private final String uuid;
+    private final ReferenceStore store;
+    private final int batchSize;
+    private final Map<Integer, List<byte[]>> pending;
+    private final InFlightWrites writes;
+
+    DedupReferenceLog(final String uuid, final ReferenceStore store, final int batchSize) {
+        this.uuid = uuid;
+        this.store = store;
+        this.batchSize = Math.max(1, batchSize);
+        this.pending = new HashMap<>();
+        this.writes = new InFlightWrites(logger);
+    }
+
+    /**
+     * Add a reference to the pending batch of the generation
+     *
+     * @param generationId
+     * @param digest
+     */
+    void add(final int generationId, final String digest) {
+        List<byte[]> batch;
+        synchronized (this) {
+            batch = this.pending.computeIfAbsent(generationId, k -> new ArrayList<>());
+            batch.add(DatatypeConverter.parseHexBinary(digest));
+            if (batch.size() < this.batchSize) {
+                return;
+            }
+            this.pending.remove(generationId);
+            this.writes.begin(1);
+        }
+        write(generationId, batch);
+    }
+
+    /**
+     * Write the pending batches and wait for the batches being written by other
+     * threads
+     *
+     * @return false if any batch of this log failed to be written
+     * @throws InterruptedException
+     */
+    boolean flush() throws InterruptedException {
+        final Map<Integer, List<byte[]>> batches;
+        synchronized (this) {
+            batches = new HashMap<>(this.pending);
+            this.pending.clear();
+            this.writes.begin(batches.size());
+        }
+        for (final Map.Entry<Integer, List<byte[]>> batch : batches.entrySet()) {
+            write(batch.getKey(), batch.getValue());
+        }
+        return this.writes.await();
+    }
+
+    private void write(final int generationId, final List<byte[]> digests) {
+        this.writes.run(() -> this.store.putReferences(generationId, encode(this.uuid, generationId, digests)));
+    }
+}
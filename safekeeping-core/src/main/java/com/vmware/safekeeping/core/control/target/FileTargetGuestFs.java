@@ -0,0 +1,179 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.control.target;
+
+import java.io.Closeable;
+import java.io.IOException;
+import java.io.OutputStream;
+import java.nio.charset.StandardCharsets;
+import java.util.ArrayList;
+import java.util.List;
+
+import com.vmware.jvix.jDiskLib.GuestFsEntry;
+import com.vmware.jvix.jDiskLibConst;
+import com.vmware.safekeeping.core.core.SJvddk;
+import com.vmware.safekeeping.core.profile.BasicBlockInfo;
+
+/**
+ * Read-only access to the guest filesystem of an archived disk generation,
+ * for file-level restore without restoring the disk first.
+ *
+ * The disk is rebuilt natively from the consolidated blocks of the generation:
+ * each read fetches, decrypts and decompresses only the archived blocks under
+ * it, from their data files or packfiles, and keeps the decoded blocks in a
+ * cache of guestFsCacheSizeMb. Only ext2, ext3 and ext4 are supported, and the
+ * journal is not replayed, so the filesystem is seen as it was on the disk at
+ * snapshot time.
+ */
+public final class FileTargetGuestFs implements Closeable {
+
+    private static final int READ_SIZE = 1024 * 1024;
+
+    /**
+     * @return true if the guest filesystems of the target can be read natively
+     */
+    public static boolean isEnabled(final ITargetOperation target) {
+        return target instanceof FileTargetOperations;
+    }
+
+    private final long handle;
+    private final byte[] buffer;
+    private boolean closed;
+
+    /**
+     * @param target            file target holding the generation
+     * @param blocks            consolidated blocks of the generation, sorted by
+     *                          offset
+     * @param capacityInSectors capacity of the disk
+     * @param partition         partition holding the filesystem, -1 for the
+     *                          first supported one
+     * @throws IOException if there is no supported filesystem
+     */
+    public FileTargetGuestFs(final ITargetOperation target, final List<BasicBlockInfo> blocks,
+            final long capacityInSectors, final int partition) throws IOException {
+        final ArchivedExtents archived = new ArchivedExtents((FileTargetOperations) target, blocks);
+        final long[] result = new long[1];
+        final long error = SJvddk.guestFsOpen(archived.getPaths(), archived.getExtents(), archived.getParams(),
+                archived.getKey(), capacityInSectors * jDiskLibConst.SECTOR_SIZE, partition, result);
+        if (error != jDiskLibConst.VIX_OK) {
+            throw new IOException(String.format("Guest filesystem cannot be opened: %s", describe(error)));
+        }
+        this.handle = result[0];
+        this.buffer = new byte[READ_SIZE];
+    }
+
+    private static String describe(final long error) {
+        if (error == jDiskLibConst.VIX_E_NOT_SUPPORTED) {
+            return "no supported filesystem";
+        }
+        return SJvddk.getDli().getErrorText(error, null);
+    }
+
+    @Override
+    public synchronized void close() {
+        if (!this.closed) {
+            this.closed = true;
+            SJvddk.guestFsClose(this.handle);
+        }
+    }
+
+    /**
+     * Copy a file to a stream
+     *
+     * @param path absolute path of a regular file
+     * @return the bytes copied
+     * @throws IOException if the path is not a regular file or cannot be read
+     */
+    public synchronized long extract(final String path, final OutputStream out) throws IOException {
+        final GuestFsEntry entry = lookup(path);
+        if (entry == null) {
+            throw new IOException(String.format("%s doesn't exist", path));
+        }
+        if (entry.type != jDiskLibConst.GUESTFS_TYPE_FILE) {
+            throw new IOException(String.format("%s is not a regular file", path));
+        }
+        long offset = 0;
+        while (offset < entry.size) {
+            final long read = SJvddk.guestFsRead(this.handle, entry.inode, offset, this.buffer, this.buffer.length);
+            if (read <= 0) {
+                throw new IOException(String.format("%s cannot be read at offset %d", path, offset));
+            }
+            out.write(this.buffer, 0, (int) read);
+            offset += read;
+        }
+        return offset;
+    }
+
+    /**
+     * List a directory, "." and ".." excluded
+     *
+     * @param path absolute path of a directory
+     * @throws IOException if the path is not a directory or cannot be read
+     */
+    public synchronized List<GuestFsEntry> list(final String path) throws IOException {
+        final GuestFsEntry entry = lookup(path);
+        if (entry == null) {
+            throw new IOException(String.format("%s doesn't exist", path));
+        }
+        final List<GuestFsEntry> entries = new ArrayList<>();
+        final long error = SJvddk.guestFsList(this.handle, entry.inode, entries);
+        if (error != jDiskLibConst.VIX_OK) {
+            throw new IOException(String.format("%s cannot be listed: %s", path, describe(error)));
+        }
+        return entries;
+    }
+
+    /**
+     * Get a file, directory or symbolic link, without following symbolic links
+     *
+     * @param path absolute path
+     * @return the entry, null if it doesn't exist
+     * @throws IOException if the filesystem cannot be read
+     */
+    public synchronized GuestFsEntry lookup(final String path) throws IOException {
+        final GuestFsEntry entry = new GuestFsEntry();
+        final long error = SJvddk.guestFsLookup(this.handle, path, entry);
+        if ((error == jDiskLibConst.VIX_E_FILE_NOT_FOUND) || (error == jDiskLibConst.VIX_E_NOT_A_DIRECTORY)) {
+            return null;
+        }
+        if (error != jDiskLibConst.VIX_OK) {
+            throw new IOException(String.format("%s cannot be read: %s", path, describe(error)));
+        }
+        return entry;
+    }
+
+    /**
+     * @return the target of a symbolic link
+     */
+    public synchronized String readLink(final GuestFsEntry entry) throws IOException {
+        final long read = SJvddk.guestFsRead(this.handle, entry.inode, 0, this.buffer, this.buffer.length);
+        if (read < 0) {
+            throw new IOException(String.format("%s cannot be read", entry.name));
+        }
+        return new String(this.buffer, 0, (int) read, StandardCharsets.UTF_8);
+    }
+}
@@ -0,0 +1,134 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.control.target;
+
+import java.io.Closeable;
+import java.io.IOException;
+import java.util.List;
+import java.util.logging.Level;
+import java.util.logging.Logger;
+
+import com.vmware.jvix.jDiskLibConst;
+import com.vmware.safekeeping.core.core.SJvddk;
+import com.vmware.safekeeping.core.profile.BasicBlockInfo;
+
+/**
+ * Instant access to an archived disk generation: a local NBD server (fixed
+ * newstyle) exposing the generation as a block device, so a VM or a host can
+ * boot or mount it at once instead of waiting for a full restore.
+ *
+ * The server is native and serves the consolidated blocks of the generation,
+ * as computed by ConsolidateBlocks, so any generation, virtual fulls included,
+ * is readable as soon as it is chosen. Reads fetch and decode only the archived
+ * blocks under them into a cache of nbdCacheSizeMb, and a sequential reader
+ * gets nbdReadaheadMb read ahead. Writes go to a sparse memory overlay of up to
+ * nbdOverlayLimitMb, discarded on close: the archive is never modified.
+ */
+public final class FileTargetNbdServer implements Closeable {
+    private static final Logger logger = Logger.getLogger(FileTargetNbdServer.class.getName());
+
+    /**
+     * @return true if the generations of the target can be served natively
+     */
+    public static boolean isEnabled(final ITargetOperation target) {
+        return target instanceof FileTargetOperations;
+    }
+
+    private final long handle;
+    private final int port;
+    private final String address;
+    private final String name;
+    private boolean closed;
+
+    /**
+     * @param target            file target holding the generation
+     * @param blocks            consolidated blocks of the generation, sorted by
+     *                          offset
+     * @param capacityInSectors capacity of the disk
+     * @param name              export name
+     * @param address           path of the unix socket to create, null to listen
+     *                          on localhost
+     * @param port              TCP port on localhost, 0 for any free port
+     * @throws IOException if the server cannot be started
+     */
+    public FileTargetNbdServer(final ITargetOperation target, final List<BasicBlockInfo> blocks,
+            final long capacityInSectors, final String name, final String address, final int port)
+            throws IOException {
+        final ArchivedExtents archived = new ArchivedExtents((FileTargetOperations) target, blocks);
+        final long[] result = new long[2];
+        final long error = SJvddk.nbdStart(archived.getPaths(), archived.getExtents(), archived.getParams(),
+                archived.getKey(), capacityInSectors * jDiskLibConst.SECTOR_SIZE, name, address, port, result);
+        if (error != jDiskLibConst.VIX_OK) {
+            final String reason = (error == jDiskLibConst.VIX_E_NOT_SUPPORTED) ? "not supported"
+                    : SJvddk.getDli().getErrorText(error, null);
+            throw new IOException(String.format("NBD server cannot be started: %s", reason));
+        }
+        this.handle = result[0];
+        this.port = (int) result[1];
+        this.address = address;
+        this.name = name;
+        if (logger.isLoggable(Level.INFO)) {
+            logger.info(String.format("NBD export %s on %s", name, getUri()));
+        }
+    }
+
+    @Override
+    public synchronized void close() {
+        if (!this.closed) {
+            this.closed = true;
+            SJvddk.nbdStop(this.handle);
+        }
+    }
+
+    /**
+     * @return the TCP port, 0 for a unix socket
+     */
+    public int getPort() {
+        return this.port;
+    }
+
+    /**
+     * @return statistics indexed by jDiskLibConst.NBD_STAT_*
+     */
+    public synchronized long[] getStats() {
+        final long[] stats = new long[jDiskLibConst.NBD_STATS_SIZE];
+        if (!this.closed) {
+            SJvddk.nbdGetStats(this.handle, stats);
+        }
+        return stats;
+    }
+
+    /**
+     * @return the URI of the export, as understood by qemu and nbdinfo
+     */
+    public String getUri() {
+        if (this.address != null) {
+            return String.format("nbd+unix:///%s?socket=%s", this.name, this.address);
+        }
+        return String.format("nbd://127.0.0.1:%d/%s", this.port, this.name);
+    }
+}
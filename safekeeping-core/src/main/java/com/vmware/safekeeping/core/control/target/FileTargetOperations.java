@@ -28,13 +28,17 @@ package com.vmware.safekeeping.core.control.target;
 
 import java.io.File;
 import java.io.FileInputStream;
+import java.io.FileOutputStream;
 import java.io.IOException;
 import java.io.InputStream;
+import java.io.RandomAccessFile;
 import java.nio.file.Files;
 import java.nio.file.Path;
 import java.nio.file.Paths;
 import java.security.MessageDigest;
 import java.security.NoSuchAlgorithmException;
+import java.util.ArrayList;
+import java.util.List;
 import java.util.logging.Level;
 import java.util.logging.Logger;
 
@@ -46,6 +50,7 @@ import com.vmware.safekeeping.common.Utility;
 import com.vmware.safekeeping.core.control.TargetBuffer;
 import com.vmware.safekeeping.core.control.info.ExBlockInfo;
 import com.vmware.safekeeping.core.core.Dedup;
+import com.vmware.safekeeping.core.profile.CoreGlobalSettings;
 import com.vmware.safekeeping.core.profile.FcoGenerationsCatalog;
 import com.vmware.safekeeping.core.profile.GenerationProfile;
 import com.vmware.safekeeping.core.type.ByteArrayInOutStream;
@@ -60,6 +65,9 @@ class FileTargetOperations extends AbstractTargetOperationImpl {
 
     @Override
     public boolean closePostDump(final ExBlockInfo block, final TargetBuffer targetBuffer) {
+        if (isPackable(block)) {
+            return closePostPackedDump(block, targetBuffer);
+        }
         boolean result = true;
         try {
             final String uuid = getEntityInfo().getUuid();
@@ -72,6 +80,7 @@ class FileTargetOperations extends AbstractTargetOperationImpl {
             block.setDuplicated(false);
 
             getMd5DiskList().put(block.getKey(), block.getMd5());
+            cacheDedup(block);
 
         } catch (final IOException e) {
             result = false;
@@ -127,16 +136,22 @@ class FileTargetOperations extends AbstractTargetOperationImpl {
 
     @Override
     public boolean dedupDump(final ExBlockInfo block) {
+        if (dedupPackedDump(block)) {
+            return true;
+        }
         boolean result = true;
         try {
             final String entities = IOUtils.readTextFile(block.getJsonKey());
+            if (CoreGlobalSettings.isDedupReferenceLog()) {
+                referenceDedupEntities(block, entities);
+            } else {
+                final String newEntities = manageDedupEntities(block, entities);
+                IOUtils.writeTextFile(block.getJsonKey(), newEntities);
 
-            final String newEntities = manageDedupEntities(block, entities);
-            IOUtils.writeTextFile(block.getJsonKey(), newEntities);
-
-            block.setDuplicated(true);
+                block.setDuplicated(true);
 
-            getMd5DiskList().put(block.getKey(), block.getMd5());
+                getMd5DiskList().put(block.getKey(), block.getMd5());
+            }
 
         } catch (final IOException e) {
             result = false;
@@ -170,6 +185,13 @@ class FileTargetOperations extends AbstractTargetOperationImpl {
 
     @Override
     public boolean doesKeyExist(final ExBlockInfo block) {
+        if (isPackedKeyExist(block)) {
+            return true;
+        } else if (block.isPacked()) {
+            return false;
+        } else if (isDedupCached(block)) {
+            return true;
+        }
         final File dataKeyFile = new File(block.getDataKey());
         final File jsonKey = new File(block.getJsonKey());
         return jsonKey.exists() && dataKeyFile.exists();
@@ -201,6 +223,18 @@ class FileTargetOperations extends AbstractTargetOperationImpl {
         return (FileTarget) this.parent;
     }
 
+    @Override
+    protected List<String> listObjectKeys(final String folder) throws IOException {
+        final List<String> result = new ArrayList<>();
+        final String[] names = new File(folder).list();
+        if (names != null) {
+            for (final String name : names) {
+                result.add(folder.concat(name));
+            }
+        }
+        return result;
+    }
+
     @Override
     public ITargetOperation newTargetOperation(final ManagedFcoEntityInfo entityInfo, final Logger logger)
             throws NoSuchAlgorithmException {
@@ -216,6 +250,9 @@ class FileTargetOperations extends AbstractTargetOperationImpl {
                     blockInfo.getKey());
             this.logger.fine(msg);
         }
+        if (blockInfo.isPacked()) {
+            return openGetPackedDump(blockInfo, targetBuffer);
+        }
         try {
             final FileInputStream is = new FileInputStream(blockInfo.getDataKey());
             final int count = IOUtils.copyToByteArray(is, targetBuffer.getInputBuffer());
@@ -252,4 +289,23 @@ class FileTargetOperations extends AbstractTargetOperationImpl {
 
     }
 
+    @Override
+    protected void putBinaryObject(final String key, final byte[] content, final int length) throws IOException {
+        final File file = new File(key);
+        file.getParentFile().mkdirs();
+        try (FileOutputStream out = new FileOutputStream(file)) {
+            out.write(content, 0, length);
+            out.getFD().sync();
+        }
+    }
+
+    @Override
+    protected void readPack(final String packId, final long offset, final byte[] buffer, final int length)
+            throws IOException {
+        try (RandomAccessFile pack = new RandomAccessFile(getPackKey(packId), "r")) {
+            pack.seek(offset);
+            pack.readFully(buffer, 0, length);
+        }
+    }
+
 }
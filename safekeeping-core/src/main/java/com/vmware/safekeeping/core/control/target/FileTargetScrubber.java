@@ -0,0 +1,187 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.control.target;
+
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+
+import javax.xml.bind.DatatypeConverter;
+
+import com.vmware.jvix.jDiskLibConst;
+import com.vmware.safekeeping.core.control.info.ExBlockInfo;
+import com.vmware.safekeeping.core.core.SJvddk;
+import com.vmware.safekeeping.core.profile.CoreGlobalSettings;
+import com.vmware.safekeeping.core.util.AESEncryptionManager;
+
+/**
+ * Verification of the blocks of a file target with the native scrub engine.
+ *
+ * The blocks added are verified together by {@link #run()}: the engine reads
+ * their data files with readahead on scrubThreads threads and checks the MD5
+ * of the stored data. Unless the scrub is shallow, each block is then
+ * decrypted, decompressed and checked against its SHA-1 when the archive uses
+ * SHA-1 digests. Packed blocks are left to the caller.
+ */
+public final class FileTargetScrubber {
+
+    private static final int SHA1_HEX_LENGTH = 40;
+    private static final int MD5_SIZE = 16;
+
+    /**
+     * @return true if the blocks of the target can be scrubbed natively
+     */
+    public static boolean isEnabled(final ITargetOperation target) {
+        return (target instanceof FileTargetOperations) && (CoreGlobalSettings.getScrubThreads() > 0);
+    }
+
+    public static String describe(final int status) {
+        switch (status) {
+        case jDiskLibConst.SCRUB_STATUS_OK:
+            return "ok";
+        case jDiskLibConst.SCRUB_STATUS_MISSING:
+            return "Doesn't exist";
+        case jDiskLibConst.SCRUB_STATUS_READ_ERROR:
+            return "Read error";
+        case jDiskLibConst.SCRUB_STATUS_MD5_MISMATCH:
+            return "Stored data MD5 mismatch";
+        case jDiskLibConst.SCRUB_STATUS_DECODE_ERROR:
+            return "Cannot be decrypted or decompressed";
+        case jDiskLibConst.SCRUB_STATUS_SHA1_MISMATCH:
+            return "Block SHA-1 mismatch";
+        default:
+            return "Unknown status " + status;
+        }
+    }
+
+    private final ITargetOperation target;
+    private final boolean shallow;
+    private final List<Integer> keys;
+    private final List<ExBlockInfo> blocks;
+    private final Map<Integer, Integer> status;
+    private final long[] stats;
+
+    public FileTargetScrubber(final ITargetOperation target) {
+        this.target = target;
+        this.shallow = CoreGlobalSettings.isScrubShallow();
+        this.keys = new ArrayList<>();
+        this.blocks = new ArrayList<>();
+        this.status = new HashMap<>();
+        this.stats = new long[jDiskLibConst.SCRUB_STATS_SIZE];
+    }
+
+    public void add(final Integer key, final ExBlockInfo block) {
+        this.keys.add(key);
+        this.blocks.add(block);
+    }
+
+    public long getBadBlocks() {
+        return this.stats[jDiskLibConst.SCRUB_STAT_BAD_BLOCKS];
+    }
+
+    /**
+     * @return the jDiskLibConst.SCRUB_STATUS_* of the block, null if it was not
+     *         scrubbed
+     */
+    public Integer getStatus(final Integer key) {
+        return this.status.get(key);
+    }
+
+    /**
+     * @return blocks, bad blocks and throughput of the last run
+     */
+    public String getSummary() {
+        final double seconds = Math.max(this.stats[jDiskLibConst.SCRUB_STAT_ELAPSED_US], 1) / 1000000D;
+        return String.format("%s scrub: %d blocks, %d bad, read %.1f MB/s, verified %.1f MB/s, %.1fs",
+                this.shallow ? "shallow" : "deep", this.stats[jDiskLibConst.SCRUB_STAT_BLOCKS],
+                this.stats[jDiskLibConst.SCRUB_STAT_BAD_BLOCKS],
+                this.stats[jDiskLibConst.SCRUB_STAT_BYTES_READ] / (1024D * 1024D) / seconds,
+                this.stats[jDiskLibConst.SCRUB_STAT_BYTES_VERIFIED] / (1024D * 1024D) / seconds, seconds);
+    }
+
+    public boolean isShallow() {
+        return this.shallow;
+    }
+
+    /**
+     * Verify the blocks added
+     *
+     * @return false if the native engine is not available, the caller should
+     *         check the blocks in Java
+     */
+    public boolean run() {
+        final int count = this.blocks.size();
+        final String[] paths = new String[count];
+        final int[] params = new int[3 * count];
+        final byte[] digests = new byte[jDiskLibConst.SCRUB_DIGESTS_SIZE * count];
+        final int[] result = new int[count];
+        boolean cipher = false;
+
+        for (int i = 0; i < count; i++) {
+            final ExBlockInfo block = this.blocks.get(i);
+            int flags = 0;
+            paths[i] = this.target.getFullPath(block.getDataKey());
+            if (block.isCipher()) {
+                flags |= jDiskLibConst.SCRUB_CIPHER;
+                cipher = true;
+            }
+            if (block.isCompress()) {
+                flags |= jDiskLibConst.SCRUB_COMPRESS;
+            }
+            try {
+                if (block.getMd5() != null) {
+                    final byte[] md5 = DatatypeConverter.parseHexBinary(block.getMd5());
+                    System.arraycopy(md5, 0, digests, jDiskLibConst.SCRUB_DIGESTS_SIZE * i,
+                            Math.min(md5.length, MD5_SIZE));
+                }
+                // the block digest is the configured message digest, only SHA-1
+                // can be checked natively
+                if ((block.getSha1() != null) && (block.getSha1().length() == SHA1_HEX_LENGTH)) {
+                    final byte[] sha1 = DatatypeConverter.parseHexBinary(block.getSha1());
+                    System.arraycopy(sha1, 0, digests, (jDiskLibConst.SCRUB_DIGESTS_SIZE * i) + MD5_SIZE,
+                            sha1.length);
+                    flags |= jDiskLibConst.SCRUB_SHA1;
+                }
+            } catch (final IllegalArgumentException e) {
+                // left zeroed, reported as a mismatch
+            }
+            params[3 * i] = flags;
+            params[(3 * i) + 1] = block.getCipherOffset();
+            params[(3 * i) + 2] = block.getSizeInBytes();
+        }
+        final byte[] key = (cipher && !this.shallow) ? AESEncryptionManager.getRawKey() : null;
+        if (SJvddk.scrub(paths, params, digests, key, CoreGlobalSettings.getScrubThreads(), this.shallow, result,
+                this.stats) != jDiskLibConst.VIX_OK) {
+            return false;
+        }
+        for (int i = 0; i < count; i++) {
+            this.status.put(this.keys.get(i), result[i]);
+        }
+        return true;
+    }
+}
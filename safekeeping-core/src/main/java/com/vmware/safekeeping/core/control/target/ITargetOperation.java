@@ -45,6 +45,32 @@ import com.vmware.vapi.internal.util.StringUtils;
 
 public interface ITargetOperation {
 
+	/**
+	 * Register a running dump on the target, until
+	 * {@link #releaseDumpLease(String)}. A generation removal waits for the dumps
+	 * of this process and refuses to run beside the dumps of another process, so
+	 * it never folds the references of a dump still held in memory
+	 *
+	 * @return the lease
+	 * @throws IOException
+	 * @throws InterruptedException
+	 */
+	default String acquireDumpLease() throws IOException, InterruptedException {
+		return null;
+	}
+
+	/**
+	 * Take the target for a generation removal, until
+	 * {@link #releaseRemovalLease()}
+	 *
+	 * @return false if a dump of another process holds a lease, nothing must be
+	 *         removed
+	 * @throws InterruptedException
+	 */
+	default boolean acquireRemovalLease() throws InterruptedException {
+		return true;
+	}
+
 	default boolean closeGetDump(final ExBlockInfo dumpFilesInfo, final int bufferIndex) {
 		dumpFilesInfo.setEndTime(System.nanoTime());
 		return true;
@@ -52,6 +78,27 @@ public interface ITargetOperation {
 
 	boolean closePostDump(ExBlockInfo dumpFileInfo, TargetBuffer targetBuffer);
 
+	/**
+	 * Read the stream of a packed block from its pack and check it against the
+	 * md5 the pack index records for it
+	 *
+	 * @return false if the block is not in its pack or its stream does not match
+	 */
+	default boolean checkPackedDump(final ExBlockInfo dumpFileInfo) {
+		return false;
+	}
+
+	/**
+	 * Fold the dedup reference logs of the target into the json of the blocks,
+	 * then delete them. Must run under {@link #acquireRemovalLease()} before any
+	 * generation is removed
+	 *
+	 * @return false if a log could not be folded, the logs are then kept
+	 */
+	default boolean compactDedupReferences() {
+		return true;
+	}
+
 	boolean copyObject(String sourceKey, String destinationKey);
 
 	boolean createGenerationFolder(final GenerationProfile profile);
@@ -70,12 +117,41 @@ public interface ITargetOperation {
 
 	boolean doesObjectExist(String json);
 
+	/**
+	 * Write the pending dedup references and wait for the batches being written
+	 *
+	 * @return false if a batch of this operation failed to be written
+	 * @throws InterruptedException
+	 */
+	default boolean flushDedupReferences() throws InterruptedException {
+		return true;
+	}
+
+	/**
+	 * Write the pending packfile, if any, and wait for the packfiles being
+	 * written. Called once the dump threads of a disk are done, before the
+	 * generation profile references the packed blocks
+	 *
+	 * @return false if a packfile of this operation failed to be written
+	 * @throws InterruptedException
+	 */
+	default boolean flushPacks() throws InterruptedException {
+		return true;
+	}
+
 	String getDisksPath();
 
 	ManagedFcoEntityInfo getEntityInfo();
 
 	byte[] getFcoProfileToByteArray(ManagedFcoEntityInfo fco) throws IOException;
 
+	/**
+	 * File catalog of a disk of a generation
+	 *
+	 * @return the catalog, null if the generation has none
+	 */
+	byte[] getFileCatalogToByteArray(ManagedFcoEntityInfo fcoEntity, int genId, int diskId) throws IOException;
+
 	String getFullPath(final String path);
 
 	byte[] getGenerationProfileToByteArray(ManagedFcoEntityInfo fcoEntity, int genId) throws IOException;
@@ -111,6 +187,9 @@ public interface ITargetOperation {
 
 	}
 
+	boolean postFileCatalog(final GenerationProfile profile, int diskId, final ByteArrayInOutStream byteArrayStream)
+			throws IOException;
+
 	boolean postGenerationProfile(final GenerationProfile profile);
 
 	boolean postGenerationsCatalog(ManagedFcoEntityInfo fco, ByteArrayInOutStream byteArray) throws IOException;
@@ -128,6 +207,30 @@ public interface ITargetOperation {
 
 	void putObject(String key, String content) throws IOException;
 
+	/**
+	 * Reference an already committed block without any I/O on the target and
+	 * without locking it
+	 *
+	 * @param dumpFileInfo
+	 * @return false if the block must be referenced with
+	 *         {@link #dedupDump(ExBlockInfo)}
+	 */
+	default boolean referenceDump(final ExBlockInfo dumpFileInfo) {
+		return false;
+	}
+
+	/**
+	 * Release a lease from {@link #acquireDumpLease()}, once the packfiles and
+	 * the dedup references of the dump are flushed
+	 *
+	 * @param lease
+	 */
+	default void releaseDumpLease(final String lease) {
+	}
+
+	default void releaseRemovalLease() {
+	}
+
 	default String removeDedupEntities(final Integer generationId, final String entities)
 			throws JsonProcessingException {
 		final String uuid = getEntityInfo().getUuid();
@@ -0,0 +1,99 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.control.target;
+
+import java.io.IOException;
+import java.util.logging.Logger;
+
+import com.vmware.safekeeping.common.Utility;
+
+/**
+ * Writes of batches handed off by the thread that filled them, and the wait
+ * for them on flush. A failed write is reported by every later
+ * {@link #await()}.
+ */
+final class InFlightWrites {
+
+    interface Write {
+        void run() throws IOException;
+    }
+
+    private final Logger logger;
+
+    private int inFlight;
+    private boolean failed;
+
+    InFlightWrites(final Logger logger) {
+        this.logger = logger;
+    }
+
+    /**
+     * Wait for the writes begun so far
+     *
+     * @return false if any write failed
+     * @throws InterruptedException
+     */
+    synchronized boolean await() throws InterruptedException {
+        while (this.inFlight > 0) {
+            wait();
+        }
+        return !this.failed;
+    }
+
+    /**
+     * Count writes about to run. Called with the batches taken from the owner,
+     * under its lock, so that an await() that follows sees them
+     *
+     * @param count
+     */
+    synchronized void begin(final int count) {
+        this.inFlight += count;
+    }
+
+    /**
+     * Run a write counted by {@link #begin(int)}
+     *
+     * @param write
+     * @return false if the write failed
+     */
+    boolean run(final Write write) {
+        boolean result = false;
+        try {
+            write.run();
+            result = true;
+        } catch (final IOException e) {
+            Utility.logWarning(this.logger, e);
+        } finally {
+            synchronized (this) {
+                this.failed |= !result;
+                --this.inFlight;
+                notifyAll();
+            }
+        }
+        return result;
+    }
+}
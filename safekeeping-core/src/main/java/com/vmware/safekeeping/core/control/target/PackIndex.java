@@ -0,0 +1,219 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.control.target;
+
+import java.io.ByteArrayInputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.IOException;
+import java.nio.charset.StandardCharsets;
+import java.util.Arrays;
+import java.util.Map;
+import java.util.concurrent.ConcurrentHashMap;
+
+import javax.xml.bind.DatatypeConverter;
+
+import com.vmware.safekeeping.common.Utility;
+import com.vmware.safekeeping.core.control.info.ExBlockInfo;
+
+/**
+ * In memory index of the blocks stored in the packfiles of a target, keyed by
+ * block digest.
+ *
+ * Every packfile <i>&lt;id&gt;.pack</i> comes with a binary index
+ * <i>&lt;id&gt;.idx</i>: the magic, the number of entries and, for each entry,
+ * the digest, the md5 of the stream, the offset and length of the stream in the
+ * pack, the block size, the compress/cipher flags and the cipher offset. The
+ * index is shared by all the operations of a target and loaded once, on the
+ * first lookup.
+ */
+final class PackIndex {
+
+    static final class Entry {
+        private final String packId;
+        private final long offset;
+        private final long length;
+        private final long size;
+        private final String md5;
+        private final boolean compress;
+        private final boolean cipher;
+        private final byte cipherOffset;
+
+        Entry(final String packId, final long offset, final ExBlockInfo block) {
+            this(packId, offset, block.getStreamSize(), block.getSize(), block.getMd5(), block.isCompress(),
+                    block.isCipher(), block.getCipherOffset());
+        }
+
+        private Entry(final String packId, final long offset, final long length, final long size, final String md5,
+                final boolean compress, final boolean cipher, final byte cipherOffset) {
+            this.packId = packId;
+            this.offset = offset;
+            this.length = length;
+            this.size = size;
+            this.md5 = md5;
+            this.compress = compress;
+            this.cipher = cipher;
+            this.cipherOffset = cipherOffset;
+        }
+
+        /**
+         * Set the location and the stream attributes of the packed copy on the
+         * block
+         *
+         * @param block
+         */
+        void fill(final ExBlockInfo block) {
+            block.setPackId(this.packId);
+            block.setPackOffset(this.offset);
+            block.setPackLength(this.length);
+            block.setStreamSize(this.length);
+            block.setSize(this.size);
+            block.setMd5(this.md5);
+            block.setCompress(this.compress);
+            block.setCipher(this.cipher);
+            block.setCipherOffset(this.cipherOffset);
+        }
+
+        long getLength() {
+            return this.length;
+        }
+
+        String getMd5() {
+            return this.md5;
+        }
+
+        long getOffset() {
+            return this.offset;
+        }
+
+        String getPackId() {
+            return this.packId;
+        }
+    }
+
+    private static final byte[] MAGIC = "SKPACKI1".getBytes(StandardCharsets.US_ASCII);
+    private static final byte FLAG_COMPRESS = 1;
+    private static final byte FLAG_CIPHER = 2;
+
+    private static String normalize(final String digest) {
+        return digest.toUpperCase(Utility.LOCALE);
+    }
+
+    /**
+     * Decode a packfile index
+     *
+     * @param packId
+     * @param content
+     * @return the entries of the pack keyed by digest
+     * @throws IOException
+     */
+    static Map<String, Entry> read(final String packId, final byte[] content) throws IOException {
+        final Map<String, Entry> result = new ConcurrentHashMap<>();
+        try (DataInputStream in = new DataInputStream(new ByteArrayInputStream(content))) {
+            final byte[] magic = new byte[MAGIC.length];
+            in.readFully(magic);
+            if (!Arrays.equals(magic, MAGIC)) {
+                throw new IOException("Pack " + packId + " has an invalid index");
+            }
+            final int count = in.readInt();
+            final byte[] md5 = new byte[16];
+            for (int i = 0; i < count; i++) {
+                final byte[] digest = new byte[in.readUnsignedByte()];
+                in.readFully(digest);
+                in.readFully(md5);
+                final long offset = in.readLong();
+                final long length = in.readInt() & 0xffffffffL;
+                final long size = in.readInt() & 0xffffffffL;
+                final byte flags = in.readByte();
+                final byte cipherOffset = in.readByte();
+                result.put(DatatypeConverter.printHexBinary(digest),
+                        new Entry(packId, offset, length, size, DatatypeConverter.printHexBinary(md5),
+                                (flags & FLAG_COMPRESS) != 0, (flags & FLAG_CIPHER) != 0, cipherOffset));
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Encode the index of a packfile
+     *
+     * @param entries entries of the pack keyed by digest
+     * @return
+     * @throws IOException
+     */
+    static byte[] write(final Map<String, Entry> entries) throws IOException {
+        final ByteArrayOutputStream result = new ByteArrayOutputStream(12 + (entries.size() * 64));
+        try (DataOutputStream out = new DataOutputStream(result)) {
+            out.write(MAGIC);
+            out.writeInt(entries.size());
+            for (final Map.Entry<String, Entry> e : entries.entrySet()) {
+                final Entry entry = e.getValue();
+                final byte[] digest = DatatypeConverter.parseHexBinary(e.getKey());
+                out.writeByte(digest.length);
+                out.write(digest);
+                out.write(DatatypeConverter.parseHexBinary(entry.md5));
+                out.writeLong(entry.offset);
+                out.writeInt((int) entry.length);
+                out.writeInt((int) entry.size);
+                out.writeByte((entry.compress ? FLAG_COMPRESS : 0) | (entry.cipher ? FLAG_CIPHER : 0));
+                out.writeByte(entry.cipherOffset);
+            }
+        }
+        return result.toByteArray();
+    }
+
+    private final Map<String, Entry> entries;
+
+    private volatile boolean loaded;
+
+    PackIndex() {
+        this.entries = new ConcurrentHashMap<>();
+    }
+
+    void addAll(final Map<String, Entry> packEntries) {
+        for (final Map.Entry<String, Entry> e : packEntries.entrySet()) {
+            this.entries.putIfAbsent(normalize(e.getKey()), e.getValue());
+        }
+    }
+
+    /**
+     * @param digest
+     * @return the packed copy of the block, or null
+     */
+    Entry get(final String digest) {
+        return this.entries.get(normalize(digest));
+    }
+
+    boolean isLoaded() {
+        return this.loaded;
+    }
+
+    void setLoaded() {
+        this.loaded = true;
+    }
+}
@@ -0,0 +1,163 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.control.target;
+
+import java.io.IOException;
+import java.util.LinkedHashMap;
+import java.util.Map;
+import java.util.UUID;
+import java.util.logging.Logger;
+
+import com.vmware.safekeeping.core.control.info.ExBlockInfo;
+
+/**
+ * Append the streams of small blocks to a packfile kept in memory, and write
+ * the pack and its index with a single write each when the pack is full or
+ * flushed.
+ *
+ * The blocks are registered in the pack index of the target only once their
+ * pack is written, so no dump can reference a block whose pack is later lost;
+ * a duplicate dumped meanwhile is simply packed again. If a pack write fails
+ * {@link #flush()} reports the failure.
+ */
+final class PackWriter {
+
+    interface PackStore {
+        /**
+         * Write the packfile, then its index
+         *
+         * @param packId
+         * @param pack
+         * @param length
+         * @param index
+         * @throws IOException
+         */
+        void putPack(String packId, byte[] pack, int length, byte[] index) throws IOException;
+    }
+
+    private static final Logger logger = Logger.getLogger(PackWriter.class.getName());
+
+    private final PackIndex index;
+    private final PackStore store;
+    private final int maxSize;
+    private final InFlightWrites writes;
+
+    private byte[] buffer;
+    private int position;
+    private String packId;
+    private Map<String, PackIndex.Entry> entries;
+
+    PackWriter(final PackIndex index, final PackStore store, final int maxSize) {
+        this.index = index;
+        this.store = store;
+        this.maxSize = maxSize;
+        this.writes = new InFlightWrites(logger);
+    }
+
+    /**
+     * Append the stream of a block to the current pack. The thread that fills
+     * the pack writes it.
+     *
+     * @param block
+     * @param data   stream of the block
+     * @param length stream size
+     * @return false if the block could not be appended or the pack it closed
+     *         failed to be written
+     */
+    boolean append(final ExBlockInfo block, final byte[] data, final int length) {
+        if (length > this.maxSize) {
+            return false;
+        }
+        String fullPackId = null;
+        byte[] fullPack = null;
+        int fullLength = 0;
+        Map<String, PackIndex.Entry> fullEntries = null;
+        synchronized (this) {
+            if ((this.buffer != null) && ((this.position + length) > this.buffer.length)) {
+                fullPackId = this.packId;
+                fullPack = this.buffer;
+                fullLength = this.position;
+                fullEntries = this.entries;
+                this.buffer = null;
+                this.writes.begin(1);
+            }
+            if (this.buffer == null) {
+                this.buffer = new byte[this.maxSize];
+                this.position = 0;
+                this.packId = UUID.randomUUID().toString();
+                this.entries = new LinkedHashMap<>();
+            }
+            System.arraycopy(data, 0, this.buffer, this.position, length);
+            final PackIndex.Entry entry = new PackIndex.Entry(this.packId, this.position, block);
+            this.entries.put(block.getSha1(), entry);
+            block.setPackId(this.packId);
+            block.setPackOffset(this.position);
+            block.setPackLength(length);
+            this.position += length;
+        }
+        if (fullPack != null) {
+            return write(fullPackId, fullPack, fullLength, fullEntries);
+        }
+        return true;
+    }
+
+    /**
+     * Write the current pack and wait for the packs being written by other
+     * threads
+     *
+     * @return false if any pack of this writer failed to be written
+     * @throws InterruptedException
+     */
+    boolean flush() throws InterruptedException {
+        String fullPackId = null;
+        byte[] fullPack = null;
+        int fullLength = 0;
+        Map<String, PackIndex.Entry> fullEntries = null;
+        synchronized (this) {
+            if (this.buffer != null) {
+                fullPackId = this.packId;
+                fullPack = this.buffer;
+                fullLength = this.position;
+                fullEntries = this.entries;
+                this.buffer = null;
+                this.writes.begin(1);
+            }
+        }
+        if (fullPack != null) {
+            write(fullPackId, fullPack, fullLength, fullEntries);
+        }
+        return this.writes.await();
+    }
+
+    private boolean write(final String id, final byte[] pack, final int length,
+            final Map<String, PackIndex.Entry> packEntries) {
+        return this.writes.run(() -> {
+            this.store.putPack(id, pack, length, PackIndex.write(packEntries));
+            this.index.addAll(packEntries);
+        });
+    }
+}
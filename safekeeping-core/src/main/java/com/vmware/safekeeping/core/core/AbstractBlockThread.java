@@ -97,6 +97,8 @@ abstract class AbstractBlockThread {
         targetBuffer.shaUpdate(targetBuffer.getInputBuffer(), blockInfo.getStreamOffset(), blockInfo.getSizeInBytes());
         final byte[] digest = targetBuffer.shaDigest();
         blockInfo.setSha1(DatatypeConverter.printHexBinary(digest));
+        // a block read back from a pack is located again by its new digest
+        blockInfo.setPackId(null);
         return true;
     }
 
@@ -142,14 +144,19 @@ abstract class AbstractBlockThread {
      */
     protected void processDump(final ExBlockInfo blockInfo, final TargetBuffer targetBuffer)
             throws IOException, BadPaddingException, IllegalBlockSizeException, InterruptedException {
-        byte[] buffer = targetBuffer.getInputBuffer();
+        final byte[] buffer = targetBuffer.getInputBuffer();
         int count = blockInfo.getSizeInBytes();
-        boolean released = false;
+        targetBuffer.releaseInputStream();
+        blockInfo.setCrcMap(CoreGlobalSettings.isCrc32cMap() ? Crc32cMap.compute(buffer, 0, count) : null);
+        final CompressionPredictor predictor = this.buffers.getCompressionPredictor();
+        if (blockInfo.isCompress() && !predictor.isCompressible(buffer, count)) {
+            // stored as is, the profile keeps the flag of the block
+            blockInfo.setCompress(false);
+        }
         if (blockInfo.isCompress()) {
 
             final int blockSize = MiGzOutputStream.DEFAULT_BLOCK_SIZE;
-            final ExtendedByteArrayOutputStream b = new ExtendedByteArrayOutputStream(
-                    targetBuffer.getBufferCompressData());
+            final ExtendedByteArrayOutputStream b = new ExtendedByteArrayOutputStream(targetBuffer.getWorkBuffer());
             try (final MiGzOutputStream mzos = new MiGzOutputStream(b, 5, blockSize)) {
                 mzos.setCompressionLevel(Deflater.BEST_SPEED);
                 int readCount = DUMP_BUFFER_SIZE;
@@ -165,32 +172,23 @@ abstract class AbstractBlockThread {
                     }
                 }
             }
+            predictor.update(count, b.size());
             count = b.size();
-            buffer = targetBuffer.getBufferCompressData();
-            // release input buffer
-            targetBuffer.releaseInputStream();
-            released = true;
+            targetBuffer.swap();
         }
         if (blockInfo.isCipher()) {
-            final EncryptResult er = AESEncryptionManager.encryptData(buffer, 0, count, targetBuffer.getBufferCipher());
+            // ECB encryption does not change the size and can be done in place
+            final EncryptResult er = AESEncryptionManager.encryptData(targetBuffer.getInputBuffer(), 0, count,
+                    targetBuffer.getInputBuffer());
             count = er.getLength();
             // Set the block offset for encryption
             blockInfo.setCipherOffset(er.getOffset());
-            buffer = targetBuffer.getBufferCipher();
-            if (!released) {
-                targetBuffer.releaseInputStream();
-                released = true;
-            }
         }
 
-        targetBuffer.md5Update(buffer, count);
+        targetBuffer.md5Update(targetBuffer.getInputBuffer(), count);
         blockInfo.setMd5Digest(targetBuffer.md5Digest());
         blockInfo.setStreamSize(count);
-        if (blockInfo.isCipher() || blockInfo.isCompress()) {
-            targetBuffer.fillInputStreamWithLock(buffer, count);
-        } else {
-            targetBuffer.fillInputStream(buffer, count);
-        }
+        targetBuffer.fillInputStream(count);
     }
 
     protected void reportResult(final ExBlockInfo blockInfo, final boolean result) {
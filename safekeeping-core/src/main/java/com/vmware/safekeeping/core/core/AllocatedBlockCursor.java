@@ -0,0 +1,181 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.core;
+
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.ArrayBlockingQueue;
+import java.util.concurrent.BlockingQueue;
+import java.util.concurrent.Semaphore;
+import java.util.logging.Level;
+import java.util.logging.Logger;
+
+import com.vmware.jvix.JVixException;
+import com.vmware.jvix.jDiskLib.Block;
+import com.vmware.jvix.jDiskLib.DiskHandle;
+import com.vmware.jvix.jDiskLibConst;
+import com.vmware.safekeeping.core.profile.CoreGlobalSettings;
+import com.vmware.safekeeping.core.type.VmbkThreadFactory;
+
+/**
+ * Stream the allocated blocks of a disk, one slice of at most MAX_CHUNK_NUMBER
+ * chunks at a time. A slice is a multiple of the alignment, so its bounds are
+ * bounds of the blocks the dump normalizes it to.
+ *
+ * A background thread queries the slices ahead of the consumer, up to
+ * allocatedBlocksPrefetch slices, so the next slice is usually ready when the
+ * consumer has dealt with the current one. VDDK calls on the disk handle are
+ * serialized with the reads of the dump threads through the semaphore of
+ * their Buffers.
+ */
+class AllocatedBlockCursor implements AutoCloseable {
+
+    private static final Logger logger = Logger.getLogger(AllocatedBlockCursor.class.getName());
+
+    /**
+     * Queued after the last slice
+     */
+    private static final Object END = new Object();
+
+    private final DiskHandle diskHandle;
+    private final long capacity;
+    private final long sliceChunks;
+    private final Semaphore semaphore;
+    private final BlockingQueue<Object> slices;
+    private final Thread thread;
+    private volatile boolean closed;
+    private boolean ended;
+
+    /**
+     * @param diskHandle
+     * @param capacity   in sectors
+     * @param alignment  in sectors, the max block size of the dump
+     * @param semaphore  serializing the VDDK calls on diskHandle, or null
+     */
+    AllocatedBlockCursor(final DiskHandle diskHandle, final long capacity, final long alignment,
+            final Semaphore semaphore) {
+        this.diskHandle = diskHandle;
+        this.capacity = capacity;
+        final long alignmentChunks = alignment / jDiskLibConst.MIN_CHUNK_SIZE;
+        if ((alignmentChunks > 1) && ((alignment % jDiskLibConst.MIN_CHUNK_SIZE) == 0)
+                && (alignmentChunks <= jDiskLibConst.MAX_CHUNK_NUMBER)) {
+            this.sliceChunks = jDiskLibConst.MAX_CHUNK_NUMBER - (jDiskLibConst.MAX_CHUNK_NUMBER % alignmentChunks);
+        } else {
+            this.sliceChunks = jDiskLibConst.MAX_CHUNK_NUMBER;
+        }
+        this.semaphore = semaphore;
+        this.slices = new ArrayBlockingQueue<>(Math.max(1, CoreGlobalSettings.getAllocatedBlocksPrefetch()));
+        this.thread = new VmbkThreadFactory("query-allocated", true, 0).newThread(this::query);
+        this.thread.start();
+    }
+
+    @Override
+    public void close() {
+        this.closed = true;
+        this.thread.interrupt();
+    }
+
+    /**
+     * @return the allocated blocks of the next slice, possibly empty, or null
+     *         after the last slice
+     * @throws JVixException
+     * @throws InterruptedException
+     */
+    @SuppressWarnings("unchecked")
+    List<Block> next() throws JVixException, InterruptedException {
+        if (this.ended) {
+            return null;
+        }
+        final Object slice = this.slices.take();
+        if (slice == END) {
+            this.ended = true;
+            return null;
+        }
+        if (slice instanceof JVixException) {
+            this.ended = true;
+            throw (JVixException) slice;
+        }
+        return (List<Block>) slice;
+    }
+
+    private void query() {
+        long offset = 0;
+        final long chunkSize = jDiskLibConst.MIN_CHUNK_SIZE;
+        long numChunk = this.capacity / chunkSize;
+        try {
+            while ((numChunk > 0) && !this.closed) {
+                final List<Block> blockList = new ArrayList<>();
+                final long numChunkToQuery = Math.min(numChunk, this.sliceChunks);
+                final long vddkCallResult;
+                if (this.semaphore != null) {
+                    this.semaphore.acquire();
+                }
+                try {
+                    vddkCallResult = SJvddk.dli.queryAllocatedBlocks(this.diskHandle, offset,
+                            numChunkToQuery * chunkSize, chunkSize, blockList);
+                } finally {
+                    if (this.semaphore != null) {
+                        this.semaphore.release();
+                    }
+                }
+                if (vddkCallResult != jDiskLibConst.VIX_OK) {
+                    final String msg = SJvddk.dli.getErrorText(vddkCallResult, null);
+                    logger.warning(msg);
+                    this.slices.put(new JVixException(vddkCallResult, msg));
+                    return;
+                }
+                numChunk -= numChunkToQuery;
+                offset += numChunkToQuery * chunkSize;
+                /*
+                 * Just add unaligned part even though it may not be allocated.
+                 */
+                if (numChunk == 0) {
+                    final long unalignedPart = this.capacity % chunkSize;
+                    if (unalignedPart > 0) {
+                        final Block block = new Block();
+                        block.offset = offset;
+                        block.length = unalignedPart;
+                        blockList.add(block);
+                    }
+                }
+                this.slices.put(blockList);
+            }
+            if ((this.capacity < chunkSize) && (this.capacity > 0)) {
+                final List<Block> blockList = new ArrayList<>();
+                blockList.add(new Block(0, this.capacity));
+                this.slices.put(blockList);
+            }
+            this.slices.put(END);
+        } catch (final InterruptedException e) {
+            if (!this.closed) {
+                logger.log(Level.WARNING, "Interrupted!", e);
+            }
+            // Restore interrupted state...
+            Thread.currentThread().interrupt();
+        }
+    }
+}
@@ -0,0 +1,134 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.core;
+
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.Map.Entry;
+import java.util.TreeMap;
+
+import com.vmware.jvix.jDiskLibConst;
+import com.vmware.safekeeping.core.control.FcoArchiveManager;
+import com.vmware.safekeeping.core.profile.BasicBlockInfo;
+import com.vmware.safekeeping.core.profile.GenerationProfile;
+import com.vmware.safekeeping.core.profile.SimpleBlockInfo;
+import com.vmware.safekeeping.core.profile.dataclass.DiskProfile;
+import com.vmware.safekeeping.core.type.enums.BackupMode;
+
+/**
+ * Blocks of a disk as it was at a generation, read straight from the archive
+ * for file-level access (FileTargetGuestFs, FileTargetNbdServer) without the
+ * result actions a restore needs for ConsolidateBlocks.
+ *
+ * The generation and the ones it depends on are walked from the newest to the
+ * full one, and each block only keeps the sectors no newer generation wrote.
+ */
+public final class ArchivedDiskBlocks {
+
+    /**
+     * @param fcoArcMgr archive of the entity
+     * @param profile   generation
+     * @param diskId    disk of the generation
+     * @return the consolidated blocks, sorted by offset
+     * @throws IOException if a generation of the chain is missing
+     */
+    public static List<BasicBlockInfo> consolidate(final FcoArchiveManager fcoArcMgr,
+            final GenerationProfile profile, final int diskId) throws IOException {
+        final TreeMap<Long, BasicBlockInfo> blocks = new TreeMap<>();
+        GenerationProfile generation = profile;
+        while (true) {
+            final DiskProfile disk = generation.getDisks().get(diskId);
+            final List<BasicBlockInfo> uncovered = new ArrayList<>();
+            for (final SimpleBlockInfo dump : disk.getDumps().values()) {
+                final BasicBlockInfo block = new BasicBlockInfo(dump, diskId, generation.getGenerationId(),
+                        disk.isCompression(), disk.isCipher());
+                addUncovered(blocks, block, uncovered);
+            }
+            for (final BasicBlockInfo block : uncovered) {
+                blocks.put(block.getOffset(), block);
+            }
+            if (generation.getDiskBackupMode(diskId) == BackupMode.FULL) {
+                break;
+            }
+            final Integer previousId = generation.getPreviousGenerationId();
+            final GenerationProfile previous = ((previousId == null) || (previousId < 0)) ? null
+                    : fcoArcMgr.loadProfileGeneration(previousId);
+            if (previous == null) {
+                throw new IOException(String.format("Archive Error- Missing parent generation (id:%d)", previousId));
+            }
+            generation = previous;
+        }
+        final List<BasicBlockInfo> result = new ArrayList<>(blocks.values());
+        for (int i = 0; i < result.size(); i++) {
+            result.get(i).setIndex(i);
+        }
+        return result;
+    }
+
+    /**
+     * @return the capacity of a disk of a generation in sectors
+     */
+    public static long getCapacityInSectors(final GenerationProfile profile, final int diskId) {
+        return profile.getCapacity(diskId) / jDiskLibConst.SECTOR_SIZE;
+    }
+
+    /**
+     * Add to uncovered the parts of block no block of newer holds
+     */
+    private static void addUncovered(final TreeMap<Long, BasicBlockInfo> newer, final BasicBlockInfo block,
+            final List<BasicBlockInfo> uncovered) {
+        long next = block.getOffset();
+        final Entry<Long, BasicBlockInfo> floor = newer.floorEntry(next);
+        if ((floor != null) && (floor.getValue().getLastBlock() >= next)) {
+            next = floor.getValue().getLastBlock() + 1;
+        }
+        for (final BasicBlockInfo over : newer.subMap(block.getOffset(), false, block.getLastBlock(), true)
+                .values()) {
+            if (over.getOffset() > next) {
+                uncovered.add(slice(block, next, over.getOffset() - 1));
+            }
+            next = Math.max(next, over.getLastBlock() + 1);
+        }
+        if (next <= block.getLastBlock()) {
+            uncovered.add(slice(block, next, block.getLastBlock()));
+        }
+    }
+
+    private static BasicBlockInfo slice(final BasicBlockInfo block, final long first, final long last) {
+        if ((first == block.getOffset()) && (last == block.getLastBlock())) {
+            return block;
+        }
+        final BasicBlockInfo result = new BasicBlockInfo(block);
+        result.setStartBlock(first);
+        result.setLastBlock(last);
+        return result;
+    }
+
+    private ArchivedDiskBlocks() {
+    }
+}
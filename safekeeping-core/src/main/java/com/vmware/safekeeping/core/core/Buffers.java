@@ -49,6 +49,13 @@ public class Buffers {
 
     private final ITargetOperation target;
 
+    /**
+     * Job id of the native I/O scheduler, 0 if not scheduled
+     */
+    private long ioJob;
+
+    private final CompressionPredictor compressionPredictor;
+
     /**
      * @param target
      * @param readOnly
@@ -71,12 +78,17 @@ public class Buffers {
         }
         this.executor = Executors.newCachedThreadPool();
         this.running = new AtomicBoolean(false);
+        this.compressionPredictor = new CompressionPredictor();
     }
 
     public void executeSubTask(final Runnable runnable) {
         this.executor.execute(runnable);
     }
 
+    CompressionPredictor getCompressionPredictor() {
+        return this.compressionPredictor;
+    }
+
     public TargetBuffer getBuffer(final Integer bufferIndex) {
         return this.buffer[bufferIndex];
     }
@@ -88,6 +100,10 @@ public class Buffers {
         return this.length;
     }
 
+    public long getIoJob() {
+        return this.ioJob;
+    }
+
     public Semaphore getSemaphore() {
         return this.semaphore;
     }
@@ -100,6 +116,10 @@ public class Buffers {
         return this.running.get();
     }
 
+    public void setIoJob(final long ioJob) {
+        this.ioJob = ioJob;
+    }
+
     public void start() {
         this.running.set(true);
 
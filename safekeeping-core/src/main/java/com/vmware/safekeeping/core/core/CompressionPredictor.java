@@ -0,0 +1,165 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.core;
+
+import java.util.concurrent.atomic.AtomicInteger;
+
+import com.vmware.jvix.jDiskLibConst;
+import com.vmware.safekeeping.core.profile.CoreGlobalSettings;
+
+/**
+ * Predict, for each block of a disk, whether compressing it is worth the CPU.
+ *
+ * A sample of the block is run through a byte histogram (native when the
+ * extended library is loaded) and the order-0 entropy gives the expected
+ * saving. Blocks below compressionMinSavingPercent are stored as is. Blocks
+ * that were compressed anyway report their actual saving, so a wrong
+ * prediction counts too.
+ *
+ * A disk full of compressed or encrypted data does not need to be sampled
+ * block by block: after compressionBackoffBlocks incompressible blocks in a
+ * row the predictor backs off and stores the blocks uncompressed, probing one
+ * block every compressionReprobeInterval to notice when the content changes.
+ */
+final class CompressionPredictor {
+
+    private static final int JAVA_RUN_SIZE = 64;
+
+    private final boolean enabled;
+    private final int minSavingPercent;
+    private final int sampleSize;
+    private final int backoffBlocks;
+    private final int reprobeInterval;
+
+    /**
+     * Incompressible blocks in a row
+     */
+    private final AtomicInteger incompressibleRun;
+
+    /**
+     * Blocks seen while backed off
+     */
+    private final AtomicInteger backedOffBlocks;
+
+    CompressionPredictor() {
+        this(CoreGlobalSettings.isCompressionPredictor(), CoreGlobalSettings.getCompressionMinSavingPercent(),
+                CoreGlobalSettings.getCompressionSampleSize(), CoreGlobalSettings.getCompressionBackoffBlocks(),
+                CoreGlobalSettings.getCompressionReprobeInterval());
+    }
+
+    CompressionPredictor(final boolean enabled, final int minSavingPercent, final int sampleSize,
+            final int backoffBlocks, final int reprobeInterval) {
+        this.enabled = enabled;
+        this.minSavingPercent = minSavingPercent;
+        this.sampleSize = sampleSize;
+        this.backoffBlocks = Math.max(1, backoffBlocks);
+        this.reprobeInterval = Math.max(1, reprobeInterval);
+        this.incompressibleRun = new AtomicInteger();
+        this.backedOffBlocks = new AtomicInteger();
+    }
+
+    /**
+     * Order-0 entropy of a sample of the buffer, same sampling as the native
+     * estimator
+     *
+     * @return thousandths of a bit per byte
+     */
+    private int estimateEntropy(final byte[] buffer, final int length) {
+        final int result = SJvddk.estimateEntropy(buffer, 0, length, this.sampleSize);
+        if (result != jDiskLibConst.ENTROPY_NOT_AVAILABLE) {
+            return result;
+        }
+        if (length == 0) {
+            return 0;
+        }
+        final int[] counts = new int[256];
+        int sampled;
+        if (length <= this.sampleSize) {
+            for (int i = 0; i < length; i++) {
+                ++counts[buffer[i] & 0xff];
+            }
+            sampled = length;
+        } else {
+            final int runs = Math.max(1, this.sampleSize / JAVA_RUN_SIZE);
+            final int stride = (length - JAVA_RUN_SIZE) / Math.max(1, runs - 1);
+            for (int r = 0; r < runs; r++) {
+                final int base = r * stride;
+                for (int i = base; i < (base + JAVA_RUN_SIZE); i++) {
+                    ++counts[buffer[i] & 0xff];
+                }
+            }
+            sampled = runs * JAVA_RUN_SIZE;
+        }
+        double sum = 0;
+        for (final int c : counts) {
+            if (c != 0) {
+                sum += c * Math.log(c);
+            }
+        }
+        final double entropy = (Math.log(sampled) - (sum / sampled)) / Math.log(2);
+        return (int) Math.round(Math.max(0, entropy) * 1000);
+    }
+
+    /**
+     * @param buffer block data, from offset 0
+     * @param length block size
+     * @return false if the block should be stored uncompressed
+     */
+    boolean isCompressible(final byte[] buffer, final int length) {
+        if (!this.enabled) {
+            return true;
+        }
+        if ((this.incompressibleRun.get() >= this.backoffBlocks)
+                && ((this.backedOffBlocks.incrementAndGet() % this.reprobeInterval) != 0)) {
+            return false;
+        }
+        final int saving = ((jDiskLibConst.ENTROPY_MAX - estimateEntropy(buffer, length)) * 100)
+                / jDiskLibConst.ENTROPY_MAX;
+        if (saving < this.minSavingPercent) {
+            this.incompressibleRun.incrementAndGet();
+            return false;
+        }
+        this.incompressibleRun.set(0);
+        this.backedOffBlocks.set(0);
+        return true;
+    }
+
+    /**
+     * Report the actual result of a compression
+     *
+     * @param length           block size
+     * @param compressedLength stream size
+     */
+    void update(final int length, final int compressedLength) {
+        if (!this.enabled || (length == 0)) {
+            return;
+        }
+        if ((((long) (length - compressedLength) * 100) / length) < this.minSavingPercent) {
+            this.incompressibleRun.incrementAndGet();
+        }
+    }
+}
@@ -0,0 +1,152 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.core;
+
+import java.nio.ByteBuffer;
+
+import org.apache.commons.codec.binary.Base64;
+
+import com.vmware.jvix.jDiskLibConst;
+
+/**
+ * CRC32C of each 4 KB chunk of a block.
+ *
+ * The map is computed on the raw data when the block is dumped and stored in
+ * the block json, 4 bytes per chunk. A restore recomputes it on the decoded
+ * data: a mismatch is localised to the sectors of the chunks that differ
+ * instead of failing a whole block on its digest.
+ *
+ * The native library uses the SSE4.2 crc32 instruction; the Java table is the
+ * fallback when the library is not extended.
+ */
+public final class Crc32cMap {
+
+    public static final int CHUNK_SIZE = jDiskLibConst.CRC32C_CHUNK_SIZE;
+
+    private static final int SECTORS_PER_CHUNK = CHUNK_SIZE / jDiskLibConst.SECTOR_SIZE;
+
+    private static final int POLY = 0x82f63b78;
+
+    private static final int[] TABLE = new int[256];
+
+    static {
+        for (int i = 0; i < 256; i++) {
+            int crc = i;
+            for (int k = 0; k < 8; k++) {
+                crc = (crc >>> 1) ^ (POLY & -(crc & 1));
+            }
+            TABLE[i] = crc;
+        }
+    }
+
+    /**
+     * Compare two maps
+     *
+     * @param expected    map stored with the block
+     * @param actual      map of the data read back
+     * @param startSector first sector of the block
+     * @return the sector ranges that differ, null if the maps match
+     */
+    public static String compare(final int[] expected, final int[] actual, final long startSector) {
+        if (expected.length != actual.length) {
+            return String.format("CRC32C map has %d entries, expected %d", actual.length, expected.length);
+        }
+        final StringBuilder ranges = new StringBuilder();
+        int i = 0;
+        while (i < expected.length) {
+            if (expected[i] == actual[i]) {
+                ++i;
+                continue;
+            }
+            final int first = i;
+            while ((i < expected.length) && (expected[i] != actual[i])) {
+                ++i;
+            }
+            if (ranges.length() > 0) {
+                ranges.append(", ");
+            }
+            ranges.append(startSector + ((long) first * SECTORS_PER_CHUNK)).append('-')
+                    .append((startSector + ((long) i * SECTORS_PER_CHUNK)) - 1);
+        }
+        return (ranges.length() == 0) ? null : "CRC32C mismatch on sectors " + ranges;
+    }
+
+    /**
+     * @param buffer
+     * @param offset
+     * @param length
+     * @return the CRC32C of each chunk of the data, the last one possibly shorter
+     */
+    public static int[] compute(final byte[] buffer, final int offset, final int length) {
+        final int[] map = new int[(length + CHUNK_SIZE - 1) / CHUNK_SIZE];
+        if (SJvddk.crc32cMap(buffer, offset, length, map) == jDiskLibConst.CRC32C_MAP_FAILED) {
+            for (int i = 0; i < map.length; i++) {
+                final int base = offset + (i * CHUNK_SIZE);
+                map[i] = crc32c(buffer, base, Math.min(CHUNK_SIZE, (offset + length) - base));
+            }
+        }
+        return map;
+    }
+
+    private static int crc32c(final byte[] buffer, final int offset, final int length) {
+        int crc = 0xffffffff;
+        for (int i = offset; i < (offset + length); i++) {
+            crc = (crc >>> 8) ^ TABLE[(crc ^ buffer[i]) & 0xff];
+        }
+        return ~crc;
+    }
+
+    /**
+     * @param encoded base64 of the entries, big endian
+     * @return the map, null if encoded is null
+     */
+    public static int[] decode(final String encoded) {
+        if (encoded == null) {
+            return null;
+        }
+        final ByteBuffer bytes = ByteBuffer.wrap(Base64.decodeBase64(encoded));
+        final int[] map = new int[bytes.remaining() / Integer.BYTES];
+        bytes.asIntBuffer().get(map);
+        return map;
+    }
+
+    /**
+     * @param map
+     * @return base64 of the entries, big endian, null if map is null
+     */
+    public static String encode(final int[] map) {
+        if (map == null) {
+            return null;
+        }
+        final ByteBuffer bytes = ByteBuffer.allocate(map.length * Integer.BYTES);
+        bytes.asIntBuffer().put(map);
+        return Base64.encodeBase64String(bytes.array());
+    }
+
+    private Crc32cMap() {
+    }
+}
@@ -29,6 +29,8 @@ package com.vmware.safekeeping.core.core;
 import java.util.ArrayList;
 import java.util.List;
 
+import com.fasterxml.jackson.annotation.JsonInclude;
+import com.fasterxml.jackson.annotation.JsonInclude.Include;
 import com.vmware.safekeeping.core.control.info.ExBlockInfo;
 
 public class Dedup {
@@ -44,6 +46,12 @@ public class Dedup {
 	private long size;
 	private long streamSize;
 
+	/**
+	 * Crc32cMap of the block data, base64 encoded
+	 */
+	@JsonInclude(Include.NON_NULL)
+	private String crcMap;
+
 	public Dedup() {
 		this.dedupList = new ArrayList<>();
 	}
@@ -58,7 +66,12 @@ public class Dedup {
 		this.sha1 = block.getSha1();
 		this.streamSize = block.getStreamSize();
 		this.size = block.getSize();
+		this.crcMap = Crc32cMap.encode(block.getCrcMap());
+
+	}
 
+	public String getCrcMap() {
+		return this.crcMap;
 	}
 
 	public List<DedupItem> getDedupList() {
@@ -97,6 +110,10 @@ public class Dedup {
 		this.compress = compress;
 	}
 
+	public void setCrcMap(final String crcMap) {
+		this.crcMap = crcMap;
+	}
+
 	public void setDedupList(final List<DedupItem> dedupList) {
 		this.dedupList = dedupList;
 	}
@@ -0,0 +1,313 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.core;
+
+import java.io.Closeable;
+import java.io.File;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.net.URISyntaxException;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.util.Arrays;
+import java.util.List;
+import java.util.UUID;
+import java.util.logging.Level;
+import java.util.logging.Logger;
+
+import javax.xml.bind.DatatypeConverter;
+
+import org.apache.commons.lang.StringUtils;
+
+import com.vmware.safekeeping.common.Utility;
+import com.vmware.safekeeping.core.command.results.CoreResultActionDiskBackup;
+import com.vmware.safekeeping.core.command.results.miscellanea.CoreResultActionCreateSnap;
+import com.vmware.safekeeping.core.control.info.ExBlockInfo;
+import com.vmware.safekeeping.core.profile.BasicBlockInfo;
+import com.vmware.safekeeping.core.profile.CoreGlobalSettings;
+
+/**
+ * Memory mapped journal of the blocks of a disk dump already committed to the
+ * target, with their fingerprint.
+ *
+ * The journal of a disk is identified by the disk, the snapshot, the block
+ * size and the target. A dump that fails leaves its journal behind, and a new
+ * dump of the same snapshot skips the VDDK read of every block found in it
+ * (the data is only referenced again, as a duplicated block). The journal is
+ * deleted when the dump succeeds.
+ *
+ * Layout: a one page header followed by one 128 bytes record per block. The
+ * commit marker of a record is written after its content, and records never
+ * cross a page, so a record interrupted by a crash is simply not committed.
+ */
+public final class DumpJournal implements Closeable {
+
+    private static final Logger logger = Logger.getLogger(DumpJournal.class.getName());
+
+    private static final byte[] MAGIC = "SKDJRNL1".getBytes(StandardCharsets.US_ASCII);
+    private static final int HEADER_SIZE = 4096;
+    private static final int HEADER_BLOCKS = 8;
+    private static final int HEADER_IDENTITY_LENGTH = 12;
+    private static final int HEADER_IDENTITY = 16;
+
+    private static final int RECORD_SIZE = 128;
+    private static final int RECORD_STATE = 0;
+    private static final int RECORD_CIPHER_OFFSET = 4;
+    private static final int RECORD_FLAGS = 5;
+    private static final int RECORD_DIGEST_LENGTH = 6;
+    private static final int RECORD_OFFSET = 8;
+    private static final int RECORD_LENGTH = 16;
+    private static final int RECORD_STREAM_SIZE = 20;
+    private static final int RECORD_MD5 = 24;
+    private static final int RECORD_DIGEST = 40;
+    private static final int MD5_LENGTH = 16;
+    /**
+     * Room for the largest block digest (SHA-512)
+     */
+    private static final int MAX_DIGEST_LENGTH = 64;
+
+    private static final int COMMITTED = 0x434f4d54;
+    private static final byte FLAG_MD5 = 1;
+
+    /**
+     * Flush the journal to disk every FORCE_INTERVAL commits
+     */
+    private static final int FORCE_INTERVAL = 64;
+
+    private static final String JOURNAL_FOLDER = "journal";
+
+    /**
+     * @param radb
+     * @return the identity of the journal, or null if the dump is not resumable
+     */
+    private static String identity(final CoreResultActionDiskBackup radb) {
+        final CoreResultActionCreateSnap snap = radb.getParent().getCreateSnapshotAction();
+        if (snap == null) {
+            return null;
+        }
+        final String snapshot = StringUtils.isNotEmpty(snap.getSnapMoref()) ? snap.getSnapMoref() : snap.getSnapId();
+        if (StringUtils.isEmpty(snapshot)) {
+            return null;
+        }
+        return String.format("%s|%s|%d|%s|%s|%d|%d|%b|%b|%s|%s", radb.getFcoEntityInfo().getUuid(), radb.getUuid(),
+                radb.getDiskId(), snapshot, radb.getChangeId(), radb.getCapacityInBytes(),
+                radb.getMaxBlockSizeInBytes(), radb.isCompressed(), radb.isCipher(),
+                CoreGlobalSettings.getMessageDigestAlgorithm(), radb.getTargetName());
+    }
+
+    /**
+     * Open the journal of a disk dump, creating it if needed.
+     *
+     * @param radb
+     * @param blocks the normalized blocks of the dump
+     * @return the journal, or null if disabled or not available
+     */
+    public static DumpJournal open(final CoreResultActionDiskBackup radb, final List<BasicBlockInfo> blocks) {
+        if (!CoreGlobalSettings.isDumpJournalEnabled() || blocks.isEmpty()) {
+            return null;
+        }
+        final String identity = identity(radb);
+        if (identity == null) {
+            return null;
+        }
+        try {
+            final File folder = new File(CoreGlobalSettings.getAppData(), JOURNAL_FOLDER);
+            if (!folder.isDirectory() && !folder.mkdirs()) {
+                throw new IOException("Cannot create " + folder);
+            }
+            final File file = new File(folder,
+                    UUID.nameUUIDFromBytes(identity.getBytes(StandardCharsets.UTF_8)).toString() + ".jnl");
+            final DumpJournal journal = new DumpJournal(file, identity, blocks);
+            if (logger.isLoggable(Level.INFO)) {
+                logger.info(String.format("Dump journal %s: %d of %d blocks already committed", file,
+                        journal.committedAtOpen, blocks.size()));
+            }
+            return journal;
+        } catch (final IOException | URISyntaxException | IllegalArgumentException e) {
+            Utility.logWarning(logger, e);
+            return null;
+        }
+    }
+
+    private final File file;
+    private final MappedByteBuffer buffer;
+    private final int numberOfBlocks;
+    private final int committedAtOpen;
+    private int commitsSinceForce;
+
+    DumpJournal(final File file, final String identity, final List<BasicBlockInfo> blocks) throws IOException {
+        final byte[] identityBytes = identity.getBytes(StandardCharsets.UTF_8);
+        if ((HEADER_IDENTITY + identityBytes.length) > HEADER_SIZE) {
+            throw new IllegalArgumentException("Journal identity too long: " + identity);
+        }
+        this.file = file;
+        this.numberOfBlocks = blocks.size();
+        final long size = HEADER_SIZE + ((long) this.numberOfBlocks * RECORD_SIZE);
+        boolean reuse;
+        try (RandomAccessFile raf = new RandomAccessFile(file, "rw")) {
+            reuse = raf.length() == size;
+            if (!reuse) {
+                raf.setLength(0);
+                raf.setLength(size);
+            }
+            // the mapping stays valid once the file is closed
+            this.buffer = raf.getChannel().map(FileChannel.MapMode.READ_WRITE, 0, size);
+        }
+        reuse = reuse && isHeaderValid(identityBytes);
+        if (!reuse) {
+            initialize(identityBytes);
+        }
+        int committed = 0;
+        for (int index = 0; index < this.numberOfBlocks; index++) {
+            if (isCommitted(index, blocks.get(index))) {
+                ++committed;
+            }
+        }
+        this.committedAtOpen = committed;
+    }
+
+    /**
+     * Flush the journal to disk
+     */
+    @Override
+    public synchronized void close() {
+        this.buffer.force();
+        this.commitsSinceForce = 0;
+    }
+
+    /**
+     * Record a block committed to the target.
+     *
+     * @param blockInfo
+     */
+    public synchronized void commit(final ExBlockInfo blockInfo) {
+        final int index = blockInfo.getIndex();
+        if ((index < 0) || (index >= this.numberOfBlocks) || StringUtils.isEmpty(blockInfo.getSha1())) {
+            return;
+        }
+        final byte[] digest = DatatypeConverter.parseHexBinary(blockInfo.getSha1());
+        if (digest.length > MAX_DIGEST_LENGTH) {
+            return;
+        }
+        final int record = HEADER_SIZE + (index * RECORD_SIZE);
+        this.buffer.putInt(record + RECORD_STATE, 0);
+        this.buffer.put(record + RECORD_CIPHER_OFFSET, blockInfo.getCipherOffset());
+        this.buffer.putLong(record + RECORD_OFFSET, blockInfo.getOffset());
+        this.buffer.putInt(record + RECORD_LENGTH, (int) blockInfo.getLength());
+        this.buffer.putInt(record + RECORD_STREAM_SIZE, blockInfo.getStreamSizeAsInteger());
+        this.buffer.put(record + RECORD_DIGEST_LENGTH, (byte) digest.length);
+        put(record + RECORD_DIGEST, digest, digest.length);
+        if (StringUtils.isNotEmpty(blockInfo.getMd5())) {
+            put(record + RECORD_MD5, blockInfo.getMd5Digest(), MD5_LENGTH);
+            this.buffer.put(record + RECORD_FLAGS, FLAG_MD5);
+        } else {
+            this.buffer.put(record + RECORD_FLAGS, (byte) 0);
+        }
+        this.buffer.putInt(record + RECORD_STATE, COMMITTED);
+        if (++this.commitsSinceForce >= FORCE_INTERVAL) {
+            this.buffer.force();
+            this.commitsSinceForce = 0;
+        }
+    }
+
+    /**
+     * Remove the journal. To be called once the dump succeeded.
+     */
+    public void delete() {
+        close();
+        try {
+            Files.deleteIfExists(this.file.toPath());
+        } catch (final IOException e) {
+            // The mapping may still hold the file on Windows, a stale journal
+            // is reset by the next dump of a different snapshot
+            Utility.logWarning(logger, e);
+        }
+    }
+
+    private byte[] get(final int position, final int length) {
+        final byte[] result = new byte[length];
+        for (int i = 0; i < length; i++) {
+            result[i] = this.buffer.get(position + i);
+        }
+        return result;
+    }
+
+    private void initialize(final byte[] identityBytes) {
+        for (int i = 0; i < this.buffer.capacity(); i += Long.BYTES) {
+            this.buffer.putLong(i, 0L);
+        }
+        this.buffer.putInt(HEADER_BLOCKS, this.numberOfBlocks);
+        this.buffer.putInt(HEADER_IDENTITY_LENGTH, identityBytes.length);
+        put(HEADER_IDENTITY, identityBytes, identityBytes.length);
+        put(0, MAGIC, MAGIC.length);
+        this.buffer.force();
+    }
+
+    private boolean isCommitted(final int index, final BasicBlockInfo block) {
+        final int record = HEADER_SIZE + (index * RECORD_SIZE);
+        return (this.buffer.getInt(record + RECORD_STATE) == COMMITTED)
+                && (this.buffer.getLong(record + RECORD_OFFSET) == block.getOffset())
+                && (this.buffer.getInt(record + RECORD_LENGTH) == block.getLength());
+    }
+
+    private boolean isHeaderValid(final byte[] identityBytes) {
+        return Arrays.equals(get(0, MAGIC.length), MAGIC)
+                && (this.buffer.getInt(HEADER_BLOCKS) == this.numberOfBlocks)
+                && (this.buffer.getInt(HEADER_IDENTITY_LENGTH) == identityBytes.length)
+                && Arrays.equals(get(HEADER_IDENTITY, identityBytes.length), identityBytes);
+    }
+
+    private void put(final int position, final byte[] data, final int length) {
+        for (int i = 0; i < length; i++) {
+            this.buffer.put(position + i, data[i]);
+        }
+    }
+
+    /**
+     * Fill a block with the fingerprint recorded by a previous dump.
+     *
+     * @param blockInfo
+     * @return true if the block was committed by a previous dump
+     */
+    public synchronized boolean restore(final ExBlockInfo blockInfo) {
+        final int index = blockInfo.getIndex();
+        if ((index < 0) || (index >= this.numberOfBlocks) || !isCommitted(index, blockInfo)) {
+            return false;
+        }
+        final int record = HEADER_SIZE + (index * RECORD_SIZE);
+        blockInfo.setSha1(DatatypeConverter
+                .printHexBinary(get(record + RECORD_DIGEST, this.buffer.get(record + RECORD_DIGEST_LENGTH))));
+        if ((this.buffer.get(record + RECORD_FLAGS) & FLAG_MD5) != 0) {
+            blockInfo.setMd5Digest(get(record + RECORD_MD5, MD5_LENGTH));
+        }
+        blockInfo.setCipherOffset(this.buffer.get(record + RECORD_CIPHER_OFFSET));
+        blockInfo.setStreamSize(this.buffer.getInt(record + RECORD_STREAM_SIZE));
+        return true;
+    }
+}
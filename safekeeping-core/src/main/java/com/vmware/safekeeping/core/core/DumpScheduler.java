@@ -0,0 +1,370 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.core;
+
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Deque;
+import java.util.List;
+import java.util.Queue;
+import java.util.concurrent.Callable;
+import java.util.concurrent.CancellationException;
+import java.util.concurrent.ConcurrentLinkedDeque;
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.Future;
+import java.util.concurrent.FutureTask;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.locks.Condition;
+import java.util.concurrent.locks.ReentrantLock;
+import java.util.logging.Level;
+import java.util.logging.Logger;
+
+import com.vmware.safekeeping.core.profile.CoreGlobalSettings;
+import com.vmware.safekeeping.core.type.VmbkThreadFactory;
+
+/**
+ * Work-stealing scheduler for the block dumps of all the disks of a VM (or of
+ * all the VMs of a vApp).
+ *
+ * Each worker owns a deque. The blocks of a disk are spread in contiguous
+ * runs over the deques; a worker takes the oldest block of its own deque and,
+ * when empty, steals the newest block of another one. A disk never has more
+ * than maxThreadsPerDisk blocks running: a block taken while its disk is at
+ * the cap is parked on the disk and run by the next worker that completes a
+ * block of the same disk. Once the small disks are done, their workers move
+ * to the large ones and the backup time follows the aggregate bandwidth
+ * instead of the largest disk.
+ */
+public class DumpScheduler implements AutoCloseable {
+
+    /**
+     * Blocks of one disk
+     */
+    public static final class DiskGroup {
+        private final int maxThreads;
+        private final AtomicInteger running;
+        private final Queue<Task> parked;
+
+        DiskGroup(final int maxThreads) {
+            this.maxThreads = maxThreads;
+            this.running = new AtomicInteger();
+            this.parked = new ConcurrentLinkedQueue<>();
+        }
+
+        /**
+         * @return a parked block, with its slot acquired, or null
+         */
+        Task pollParked() {
+            if (this.parked.isEmpty() || !tryAcquire()) {
+                return null;
+            }
+            final Task task = this.parked.poll();
+            if (task == null) {
+                release();
+            }
+            return task;
+        }
+
+        void release() {
+            this.running.decrementAndGet();
+        }
+
+        boolean tryAcquire() {
+            for (;;) {
+                final int current = this.running.get();
+                if (current >= this.maxThreads) {
+                    return false;
+                }
+                if (this.running.compareAndSet(current, current + 1)) {
+                    return true;
+                }
+            }
+        }
+    }
+
+    private static final class Task {
+        private final FutureTask<Boolean> future;
+        private final DiskGroup disk;
+
+        Task(final Callable<Boolean> callable, final DiskGroup disk) {
+            this.future = new FutureTask<>(callable);
+            this.disk = disk;
+        }
+    }
+
+    private static final Logger logger = Logger.getLogger(DumpScheduler.class.getName());
+
+    private static final long IDLE_WAIT_MILLIS = 100;
+
+    /**
+     * Same ratio as the per-disk pool of Jvddk.dumpThreads
+     */
+    private static final double WORKERS_PER_THREAD = 1.3;
+
+    /**
+     * Create a scheduler if enabled in the settings.
+     *
+     * @param name
+     * @param numberOfThreads number of threads per disk of the backup options
+     * @return the scheduler or null
+     */
+    public static DumpScheduler newInstance(final String name, final int numberOfThreads) {
+        if (!CoreGlobalSettings.isDumpWorkStealing()) {
+            return null;
+        }
+        final int maxThreadsPerDisk = CoreGlobalSettings.getDumpMaxThreadsPerDisk();
+        return new DumpScheduler(String.format("dump-%s", name),
+                (maxThreadsPerDisk > 0) ? maxThreadsPerDisk : numberOfThreads);
+    }
+
+    /**
+     * @param numberOfThreads number of threads per disk of the backup options
+     * @param numberOfDisks
+     * @return the number of workers a VM brings to the scheduler
+     */
+    public static int workersFor(final int numberOfThreads, final int numberOfDisks) {
+        return (int) Math.ceil(numberOfThreads * WORKERS_PER_THREAD) * Math.max(1, numberOfDisks);
+    }
+
+    private final int maxThreadsPerDisk;
+    private final VmbkThreadFactory threadFactory;
+    private final ReentrantLock lock;
+    private final Condition workAvailable;
+    private final AtomicInteger nextDeque;
+
+    /**
+     * Deques of the workers, copied on growth
+     */
+    private volatile Deque<Task>[] deques;
+    private volatile boolean closed;
+
+    /**
+     * @param name              prefix of the worker thread names
+     * @param maxThreadsPerDisk maximum number of blocks of a disk processed at
+     *                          the same time
+     */
+    @SuppressWarnings("unchecked")
+    public DumpScheduler(final String name, final int maxThreadsPerDisk) {
+        this.maxThreadsPerDisk = Math.max(1, maxThreadsPerDisk);
+        this.threadFactory = new VmbkThreadFactory(name, true, 0);
+        this.lock = new ReentrantLock();
+        this.workAvailable = this.lock.newCondition();
+        this.nextDeque = new AtomicInteger();
+        this.deques = new Deque[0];
+    }
+
+    /**
+     * Add workers to the pool. Each VM sharing the scheduler adds its own share.
+     *
+     * @param numberOfWorkers
+     */
+    public void addWorkers(final int numberOfWorkers) {
+        this.lock.lock();
+        try {
+            if (this.closed) {
+                return;
+            }
+            final int first = this.deques.length;
+            final Deque<Task>[] newDeques = Arrays.copyOf(this.deques, first + numberOfWorkers);
+            for (int i = first; i < newDeques.length; i++) {
+                newDeques[i] = new ConcurrentLinkedDeque<>();
+            }
+            this.deques = newDeques;
+            for (int i = first; i < newDeques.length; i++) {
+                final int index = i;
+                this.threadFactory.newThread(() -> work(index)).start();
+            }
+        } finally {
+            this.lock.unlock();
+        }
+        if (logger.isLoggable(Level.FINE)) {
+            logger.fine(String.format("%s: %d workers", this.threadFactory.getName(), this.deques.length));
+        }
+    }
+
+    @Override
+    public void close() {
+        this.lock.lock();
+        try {
+            this.closed = true;
+            this.workAvailable.signalAll();
+        } finally {
+            this.lock.unlock();
+        }
+        for (final Deque<Task> deque : this.deques) {
+            Task task;
+            while ((task = deque.pollFirst()) != null) {
+                task.future.cancel(false);
+            }
+        }
+    }
+
+    /**
+     * @return the maximum number of blocks of a disk processed at the same time
+     */
+    public int getMaxThreadsPerDisk() {
+        return this.maxThreadsPerDisk;
+    }
+
+    /**
+     * Schedule the blocks of one disk and wait for all of them, like
+     * {@link java.util.concurrent.ExecutorService#invokeAll(java.util.Collection)}.
+     *
+     * @param blocks
+     * @return the futures, in the order of blocks
+     * @throws InterruptedException
+     */
+    public List<Future<Boolean>> invokeAll(final List<? extends Callable<Boolean>> blocks)
+            throws InterruptedException {
+        final List<Future<Boolean>> futures = submitAll(newDiskGroup(), blocks);
+        boolean done = false;
+        try {
+            for (final Future<Boolean> future : futures) {
+                try {
+                    future.get();
+                } catch (final CancellationException | ExecutionException e) {
+                    // reported by the caller through the future
+                }
+            }
+            done = true;
+        } finally {
+            if (!done) {
+                for (final Future<Boolean> future : futures) {
+                    future.cancel(true);
+                }
+            }
+        }
+        return futures;
+    }
+
+    /**
+     * @return a new disk, limited to maxThreadsPerDisk running blocks
+     */
+    public DiskGroup newDiskGroup() {
+        return new DiskGroup(this.maxThreadsPerDisk);
+    }
+
+    /**
+     * Schedule more blocks of a disk without waiting for them. Successive calls
+     * for the same disk share its cap.
+     *
+     * @param disk
+     * @param blocks
+     * @return the futures, in the order of blocks
+     */
+    public List<Future<Boolean>> submitAll(final DiskGroup disk, final List<? extends Callable<Boolean>> blocks) {
+        final List<Future<Boolean>> futures = new ArrayList<>(blocks.size());
+        final Deque<Task>[] current = this.deques;
+        if (this.closed || (current.length == 0)) {
+            throw new IllegalStateException("DumpScheduler has no worker");
+        }
+        /*
+         * Contiguous runs keep the reads of a worker sequential on the disk.
+         * Every disk starts on a different deque
+         */
+        final int run = Math.max(1, (blocks.size() + current.length - 1) / current.length);
+        final int start = this.nextDeque.getAndIncrement();
+        int index = 0;
+        for (final Callable<Boolean> block : blocks) {
+            final Task task = new Task(block, disk);
+            futures.add(task.future);
+            current[Math.floorMod(start + (index / run), current.length)].addLast(task);
+            ++index;
+        }
+        this.lock.lock();
+        try {
+            this.workAvailable.signalAll();
+        } finally {
+            this.lock.unlock();
+        }
+        return futures;
+    }
+
+    /**
+     * Run a block and then, while holding the same slot, the blocks of the
+     * disk parked meanwhile.
+     *
+     * @param first
+     */
+    private void run(final Task first) {
+        final DiskGroup disk = first.disk;
+        Task task = first;
+        while (task != null) {
+            while (task != null) {
+                task.future.run();
+                task = disk.parked.poll();
+            }
+            disk.release();
+            // a block may have been parked between the poll and the release
+            task = disk.pollParked();
+        }
+    }
+
+    /**
+     * @param self index of the calling worker
+     * @return a block, or null if there is no work
+     */
+    private Task take(final int self) {
+        final Deque<Task>[] current = this.deques;
+        Task task = current[self].pollFirst();
+        for (int i = 1; (task == null) && (i < current.length); i++) {
+            task = current[(self + i) % current.length].pollLast();
+        }
+        return task;
+    }
+
+    private void work(final int self) {
+        while (!this.closed) {
+            Task task = take(self);
+            if (task == null) {
+                this.lock.lock();
+                try {
+                    if (!this.closed) {
+                        this.workAvailable.await(IDLE_WAIT_MILLIS, TimeUnit.MILLISECONDS);
+                    }
+                } catch (final InterruptedException e) {
+                    Thread.currentThread().interrupt();
+                    return;
+                } finally {
+                    this.lock.unlock();
+                }
+                continue;
+            }
+            final DiskGroup disk = task.disk;
+            if (!disk.tryAcquire()) {
+                disk.parked.add(task);
+                task = disk.pollParked();
+                if (task == null) {
+                    continue;
+                }
+            }
+            run(task);
+        }
+    }
+}
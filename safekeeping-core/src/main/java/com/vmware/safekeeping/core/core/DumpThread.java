@@ -48,17 +48,23 @@ class DumpThread extends AbstractBlockThread implements IDumpThread {
     private final DiskHandle diskHandle;
     private final CoreResultActionDiskBackup radb;
     private final Semaphore semaphore;
+    private final DumpJournal journal;
 
     DumpThread(final ExBlockInfo blockInfo, final Buffers buffers, final CoreResultActionDiskBackup radb,
-            final String[] report, final AbstractBackupDiskInteractive interactive, final Logger logger) {
-        super(blockInfo, buffers, report, interactive, logger);
+            final AbstractBackupDiskInteractive interactive, final DumpJournal journal, final Logger logger) {
+        super(blockInfo, buffers, interactive, logger);
         this.diskHandle = radb.getDiskHandle();
         this.radb = radb;
         this.semaphore = buffers.getSemaphore();
+        this.journal = journal;
     }
 
     @Override
     public Boolean call() {
+        if ((this.journal != null) && this.buffers.isRunning() && this.journal.restore(this.blockInfo)
+                && this.target.doesKeyExist(this.blockInfo)) {
+            return resumeDump(this.blockInfo);
+        }
         for (;;) {
             try {
                 final Integer bufferIndex = waitForBuffer(this.blockInfo);
@@ -88,16 +94,26 @@ class DumpThread extends AbstractBlockThread implements IDumpThread {
     private boolean cloneDump(final ExBlockInfo blockInfoOut, final TargetBuffer buffer) {
         final Runnable runnable = () -> {
             boolean result1 = false;
+            boolean locked = false;
             try {
-                BlockLocker.lockBlock(blockInfoOut);
-                result1 = this.target.dedupDump(blockInfoOut);
+                result1 = this.target.referenceDump(blockInfoOut);
+                if (!result1) {
+                    BlockLocker.lockBlock(blockInfoOut);
+                    locked = true;
+                    result1 = this.target.dedupDump(blockInfoOut);
+                }
+                if (result1 && (this.journal != null)) {
+                    this.journal.commit(blockInfoOut);
+                }
             } catch (final InterruptedException e) {
                 blockInfoOut.setReason(getEntity(), e);
                 this.logger.log(Level.WARNING, "Interrupted!", e);
                 // Restore interrupted state...
                 Thread.currentThread().interrupt();
             } finally {
-                BlockLocker.releaseBlock(blockInfoOut);
+                if (locked) {
+                    BlockLocker.releaseBlock(blockInfoOut);
+                }
                 blockInfoOut.setFailed(!result1);
                 this.radb.addDumpInfo(blockInfoOut.getIndex(), blockInfoOut);
                 reportResult(blockInfoOut, result1);
@@ -125,6 +141,9 @@ class DumpThread extends AbstractBlockThread implements IDumpThread {
             } finally {
                 BlockLocker.releaseBlock(blockInfo);
             }
+            if (result && (this.journal != null)) {
+                this.journal.commit(blockInfo);
+            }
         } catch (final IOException e) {
             Utility.logWarning(this.logger, e);
             blockInfo.setReason(getEntity(), e);
@@ -145,6 +164,40 @@ class DumpThread extends AbstractBlockThread implements IDumpThread {
         return result;
     }
 
+    /**
+     * Reference a block committed by a previous dump of the same snapshot,
+     * without reading it again
+     *
+     * @param blockInfo filled from the journal
+     * @return true if succeed
+     */
+    private boolean resumeDump(final ExBlockInfo blockInfo) {
+        boolean result = false;
+        boolean locked = false;
+        blockInfo.setStartTime(System.nanoTime());
+        try {
+            result = this.target.referenceDump(blockInfo);
+            if (!result) {
+                BlockLocker.lockBlock(blockInfo);
+                locked = true;
+                result = this.target.dedupDump(blockInfo);
+            }
+        } catch (final InterruptedException e) {
+            blockInfo.setReason(getEntity(), e);
+            this.logger.log(Level.WARNING, "Interrupted!", e);
+            // Restore interrupted state...
+            Thread.currentThread().interrupt();
+        } finally {
+            if (locked) {
+                BlockLocker.releaseBlock(blockInfo);
+            }
+            blockInfo.setFailed(!result);
+            this.radb.addDumpInfo(blockInfo.getIndex(), blockInfo);
+            reportResult(blockInfo, result);
+        }
+        return result;
+    }
+
     private boolean run(final Integer bufferIndex) {
         boolean result = false;
         if (bufferIndex != null) {
@@ -197,8 +250,8 @@ class DumpThread extends AbstractBlockThread implements IDumpThread {
                     this.logger.finest(String.format("Index %d Sector %d - Semaphore acquired",
                             this.blockInfo.getIndex(), this.blockInfo.getOffset())); // $NON-NLS-1$
                 }
-                dliResult = SJvddk.dli.read(this.diskHandle, this.blockInfo.getOffset(), this.blockInfo.getLength(),
-                        this.buffers.getBuffer(bufferIndex).getInputBuffer());
+                dliResult = SJvddk.read(this.buffers.getIoJob(), this.diskHandle, this.blockInfo.getOffset(),
+                        this.blockInfo.getLength(), this.buffers.getBuffer(bufferIndex).getInputBuffer());
             } catch (final InterruptedException e) {
                 this.blockInfo.setReason(getEntity(), e);
                 // Restore interrupted state...
@@ -71,16 +71,11 @@ public interface IJvddkBasic {
         result.setCapacityInSectors(diskInfo.capacityInSectors);
         result.setNumLinks(diskInfo.numLinks);
 
-        final String[] keys = SJvddk.dli.getMetadataKeys(diskHandle);
-        for (final String key : keys) {
-            final StringBuffer value = new StringBuffer();
-            vddkCallResult = SJvddk.dli.readMetadata(diskHandle, key, value);
-            if (vddkCallResult != jDiskLibConst.VIX_OK) {
-                final String msg = SJvddk.dli.getErrorText(vddkCallResult, null);
-                getLogger().warning(msg);
-                return null;
-            }
-            result.getMetadata().put(key, value.toString());
+        vddkCallResult = SJvddk.dli.readAllMetadata(diskHandle, result.getMetadata());
+        if (vddkCallResult != jDiskLibConst.VIX_OK) {
+            final String msg = SJvddk.dli.getErrorText(vddkCallResult, null);
+            getLogger().warning(msg);
+            return null;
         }
 
         return result;
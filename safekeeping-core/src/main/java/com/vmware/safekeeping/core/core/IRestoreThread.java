@@ -34,6 +34,7 @@ import javax.crypto.BadPaddingException;
 import javax.crypto.IllegalBlockSizeException;
 
 import com.linkedin.migz.MiGzInputStream;
+import com.vmware.jvix.jDiskLibConst;
 import com.vmware.safekeeping.core.control.TargetBuffer;
 import com.vmware.safekeeping.core.control.info.ExBlockInfo;
 import com.vmware.safekeeping.core.util.AESEncryptionManager;
@@ -41,34 +42,47 @@ import com.vmware.safekeeping.core.util.AESEncryptionManager;
 interface IRestoreThread extends Callable<Boolean> {
 	int GZIP_READ_BUFFER_SIZE = 4096;
 
-	default boolean computeOpenGetDump(final ExBlockInfo blockInfo, final TargetBuffer targetBuffer,
-			final boolean destinationOutputBuffer) throws IOException, IllegalBlockSizeException, BadPaddingException {
-		byte[] buffer = targetBuffer.getInputBuffer();
+	/**
+	 * Decipher and decompress the block read by openGetDump. The block is left
+	 * at the beginning of the input buffer.
+	 */
+	default boolean computeOpenGetDump(final ExBlockInfo blockInfo, final TargetBuffer targetBuffer)
+			throws IOException, IllegalBlockSizeException, BadPaddingException {
 		int bufferSize = blockInfo.getStreamSizeAsInteger();
 		if (blockInfo.isCipher()) {
-			bufferSize = AESEncryptionManager.decryptData(buffer, 0, bufferSize, targetBuffer.getBufferCipher(),
-					blockInfo.getCipherOffset());
-			buffer = targetBuffer.getBufferCipher();
+			// ECB decryption does not change the size and can be done in place
+			bufferSize = AESEncryptionManager.decryptData(targetBuffer.getInputBuffer(), 0, bufferSize,
+					targetBuffer.getInputBuffer(), blockInfo.getCipherOffset());
 		}
 
 		if (blockInfo.isCompress()) {
-			final ByteArrayInputStream b = new ByteArrayInputStream(buffer, 0, bufferSize);
-			final byte[] buffer2 = targetBuffer.getBufferCompressData();
-			try (MiGzInputStream mgzip = new MiGzInputStream(b)) {
-				int count = 0;
-				int n = 0;
-				while ((n = mgzip.read(buffer2, count, count + GZIP_READ_BUFFER_SIZE)) > -1) {
-					count += n;
+			final byte[] buffer2 = targetBuffer.getWorkBuffer();
+			// the members of a MiGz stream are inflated in parallel by the native
+			// library, the Java decoder is the fallback
+			int count = SJvddk.decodeMiGz(targetBuffer.getInputBuffer(), bufferSize, buffer2);
+			if (count == jDiskLibConst.MIGZ_DECODE_FAILED) {
+				final ByteArrayInputStream b = new ByteArrayInputStream(targetBuffer.getInputBuffer(), 0, bufferSize);
+				try (MiGzInputStream mgzip = new MiGzInputStream(b)) {
+					count = 0;
+					int n = 0;
+					while ((n = mgzip.read(buffer2, count, count + GZIP_READ_BUFFER_SIZE)) > -1) {
+						count += n;
+					}
 				}
 			}
-			buffer = targetBuffer.getBufferCompressData();
+			bufferSize = count;
+			targetBuffer.swap();
 		}
-		if (destinationOutputBuffer) {
-			System.arraycopy(buffer, blockInfo.getStreamOffset(), targetBuffer.getOutputBuffer(), 0,
-					blockInfo.getStreamLength());
-		} else {
-			System.arraycopy(buffer, blockInfo.getStreamOffset(), targetBuffer.getInputBuffer(), 0,
-					blockInfo.getStreamLength());
+		if (blockInfo.getCrcMap() != null) {
+			final String mismatch = Crc32cMap.compare(blockInfo.getCrcMap(),
+					Crc32cMap.compute(targetBuffer.getInputBuffer(), 0, bufferSize), blockInfo.getOriginalOffset());
+			if (mismatch != null) {
+				throw new IOException(String.format("Block %s: %s", blockInfo.getSha1(), mismatch));
+			}
+		}
+		if (blockInfo.getStreamOffset() != 0) {
+			final byte[] buffer = targetBuffer.getInputBuffer();
+			System.arraycopy(buffer, blockInfo.getStreamOffset(), buffer, 0, blockInfo.getStreamLength());
 		}
 
 		return true;
@@ -82,6 +82,7 @@ import com.vmware.safekeeping.core.type.fco.ImprovedVirtualDisk;
 import com.vmware.safekeeping.core.type.fco.VirtualMachineManager;
 import com.vmware.vapi.internal.util.StringUtils;
 import com.vmware.vim25.FileFaultFaultMsg;
+import com.vmware.vim25.InvalidPropertyFaultMsg;
 import com.vmware.vim25.NotFoundFaultMsg;
 import com.vmware.vim25.RuntimeFaultFaultMsg;
 import com.vmware.vslm.InvalidArgumentFaultMsg;
@@ -103,6 +104,11 @@ public class Jvddk extends SJvddk implements IJvddkBasic {
 
     private Boolean privilageEnableDisableMethod;
 
+    /**
+     * Shared by the disks of the VM (or vApp), null to use a pool per disk
+     */
+    private DumpScheduler dumpScheduler;
+
     public Jvddk(final Logger logger, final ImprovedVirtualDisk ivd) throws JVixException {
         this(ivd.getVimConnection(), logger);
         this.connectParams = this.basicVimConnection.configureVddkAccess(ivd);
@@ -312,9 +318,10 @@ public class Jvddk extends SJvddk implements IJvddkBasic {
                     profile.setDiskMetadata(radb.getDiskId(), radb.getJVmdkInfo().getMetadata());
                     msg = radb.getJVmdkInfo().toString();
                     this.logger.info(msg);
-                    final List<Block> blockList = queryBlock(radb, blockListQueryChangedDiskAreas);
-                    if (blockList.isEmpty()) {
-                        manageEmptyBlocksList(radb);
+                    final List<Block> blockList = isStreamingDiscovery(radb, blockListQueryChangedDiskAreas) ? null
+                            : queryBlock(radb, blockListQueryChangedDiskAreas);
+                    if ((blockList != null) && blockList.isEmpty()) {
+                        manageEmptyBlocksList(radb, target);
                         interactive.endDumpThreads(radb.getState());
                         /**
                          * End Section DumpThreads
@@ -325,8 +332,11 @@ public class Jvddk extends SJvddk implements IJvddkBasic {
                          */
                         interactive.endQueryBlocks();
                         final String finalReport = dump(radb, interactive, blockList, target);
-                        try (ByteArrayInOutStream reportStream = new ByteArrayInOutStream(finalReport)) {
-                            target.postReport(profile, radb.getDiskId(), reportStream);
+                        if (finalReport != null) {
+                            try (ByteArrayInOutStream reportStream = new ByteArrayInOutStream(finalReport)) {
+                                target.postReport(profile, radb.getDiskId(), reportStream);
+                            }
+                            postFileCatalog(profile, target, radb);
                         }
                     }
                 }
@@ -362,6 +372,72 @@ public class Jvddk extends SJvddk implements IJvddkBasic {
 
     }
 
+    /**
+     * Build the file catalog of the disk just dumped, from the metadata of its
+     * guest filesystem, and store it with the generation. The catalog is only an
+     * index: a disk without a supported filesystem has none, and a failure is
+     * logged without failing the backup.
+     *
+     * @param profile
+     * @param target
+     * @param radb
+     */
+    private void postFileCatalog(final GenerationProfile profile, final ITargetOperation target,
+            final CoreResultActionDiskBackup radb) {
+        if (!CoreGlobalSettings.isFileCatalog() || !radb.isRunning()) {
+            return;
+        }
+        final byte[][] catalog = new byte[1][];
+        final long[] stats = new long[jDiskLibConst.CATALOG_STATS_SIZE];
+        final long vddkCallResult = SJvddk.buildCatalog(radb.getDiskHandle(), catalog, stats);
+        if (vddkCallResult != jDiskLibConst.VIX_OK) {
+            if (this.logger.isLoggable(Level.INFO)) {
+                this.logger.info(String.format("Disk %d: no file catalog (%s)", radb.getDiskId(),
+                        (vddkCallResult == jDiskLibConst.VIX_E_NOT_SUPPORTED) ? "no supported filesystem"
+                                : SJvddk.dli.getErrorText(vddkCallResult, null)));
+            }
+            return;
+        }
+        try (ByteArrayInOutStream catalogStream = new ByteArrayInOutStream(catalog[0].length)) {
+            catalogStream.write(catalog[0]);
+            target.postFileCatalog(profile, radb.getDiskId(), catalogStream);
+            if (this.logger.isLoggable(Level.INFO)) {
+                this.logger.info(String.format("Disk %d: file catalog of %d entries, %s read in %.1fs",
+                        radb.getDiskId(), stats[jDiskLibConst.CATALOG_STAT_RECORDS],
+                        PrettyNumber.toString(stats[jDiskLibConst.CATALOG_STAT_BYTES_READ], MetricPrefix.MEGA),
+                        stats[jDiskLibConst.CATALOG_STAT_ELAPSED_US] / 1000000D));
+            }
+        } catch (final IOException | NoSuchAlgorithmException e) {
+            Utility.logWarning(this.logger, e);
+        }
+    }
+
+    /**
+     * Give a disk without changed blocks the file catalog of its previous
+     * generation: its filesystem did not change. A failure is logged without
+     * failing the backup.
+     *
+     * @param profile
+     * @param target
+     * @param radb
+     */
+    private void copyPreviousFileCatalog(final GenerationProfile profile, final ITargetOperation target,
+            final CoreResultActionDiskBackup radb) {
+        final String previous = profile.getPreviousFileCatalogContentPath(radb.getDiskId());
+        if (!CoreGlobalSettings.isFileCatalog() || (previous == null) || !target.doesObjectExist(previous)) {
+            return;
+        }
+        if (target.copyObject(previous, profile.getFileCatalogContentPath(radb.getDiskId()))) {
+            if (this.logger.isLoggable(Level.INFO)) {
+                this.logger.info(String.format("Disk %d: file catalog of generation %d kept", radb.getDiskId(),
+                        profile.getPreviousGenerationId()));
+            }
+        } else {
+            this.logger.warning(String.format("Disk %d: file catalog of generation %d not copied",
+                    radb.getDiskId(), profile.getPreviousGenerationId()));
+        }
+    }
+
     /**
      *
      * @param vixBlocks
@@ -410,11 +486,14 @@ public class Jvddk extends SJvddk implements IJvddkBasic {
                             this.logger);
                     futureThreads.add(callableThread);
                 }
+                buffers.setIoJob(SJvddk.registerIoJob(jDiskLibConst.IO_CLASS_INTERACTIVE,
+                        CoreGlobalSettings.getIoSchedulerRestoreDeadlineSeconds() * 1000L));
                 buffers.start();
                 try {
                     restoreAndConsolidateThreads(radr, interactive, futureThreads);
                 } finally {
                     buffers.stop();
+                    SJvddk.unregisterIoJob(buffers.getIoJob());
                 }
             } else {
                 final String msg = "No blocks to restore";
@@ -529,6 +608,17 @@ public class Jvddk extends SJvddk implements IJvddkBasic {
         return radr;
     }
 
+    /**
+     * Dump the blocks of a disk
+     *
+     * @param radb
+     * @param interactive
+     * @param blockList   the blocks to dump, or null to dump the allocated
+     *                    blocks while they are discovered
+     * @param target
+     * @return the report, or null if the disk is empty
+     * @throws CoreResultActionException
+     */
     private String dump(final CoreResultActionDiskBackup radb, final AbstractBackupDiskInteractive interactive,
             final List<Block> blockList, final ITargetOperation target) throws CoreResultActionException {
         if (this.logger.isLoggable(Level.CONFIG)) {
@@ -537,94 +627,157 @@ public class Jvddk extends SJvddk implements IJvddkBasic {
         }
         String msg;
         final List<BasicBlockInfo> vixBlocks = new ArrayList<>();
+        final List<DumpThread> futureThreads = new ArrayList<>();
         final GenerationProfile profile = radb.getProfile();
         final int maxBlockSizeInBytes = (int) profile.getMaxBlockSize();
         final int maxSectorsXBlock = maxBlockSizeInBytes / jDiskLibConst.SECTOR_SIZE;
-        final StringBuilder finalReport = new StringBuilder();
+        TotalBlocksInfo totalDumpInfo = null;
+        DumpJournal journal = null;
 
         try {
             /*
              * Initialize buffers
              */
-            final int threadPool = radb.getNumberOfThreads();
+            final int threadPool = (this.dumpScheduler != null) ? this.dumpScheduler.getMaxThreadsPerDisk()
+                    : radb.getNumberOfThreads();
             final Buffers buffers = new Buffers(target, threadPool, maxBlockSizeInBytes, radb.getFcoEntityInfo());
 
             /*
              * end buffer initializations
              */
+            if (blockList != null) {
+                /**
+                 * Start Section Normalize Blocks
+                 */
+                interactive.startNormalizeVmdkBlocks();
+                msg = String.format("Normalize the block list to the Max block size of %d Sectors (%s)",
+                        maxSectorsXBlock, PrettyNumber.toString(profile.getMaxBlockSize(), MetricPrefix.MEGA));
+                this.logger.info(msg);
+                final int newEntry = normalizeBlocks(radb, blockList, vixBlocks, maxSectorsXBlock);
+                msg = String.format("Original blocks:%d New added blocks:%d Total blocks:%d ", blockList.size(),
+                        newEntry, vixBlocks.size());
+                this.logger.info(msg);
 
-            /**
-             * Start Section Normalize Blocks
-             */
-            interactive.startNormalizeVmdkBlocks();
-            msg = String.format("Normalize the block list to the Max block size of %d Sectors (%s)", maxSectorsXBlock,
-                    PrettyNumber.toString(profile.getMaxBlockSize(), MetricPrefix.MEGA));
-            this.logger.info(msg);
-            final int newEntry = normalizeBlocks(radb, blockList, vixBlocks, maxSectorsXBlock);
-            msg = String.format("Original blocks:%d New added blocks:%d Total blocks:%d ", blockList.size(), newEntry,
-                    vixBlocks.size());
-            this.logger.info(msg);
-
-            radb.setNumberOfBlocks(vixBlocks.size());
-
-            interactive.endNormalizeVmdkBlocks();
-            /**
-             * End Section Normalize Blocks
-             */
-            final List<DumpThread> futureThreads = new ArrayList<>(vixBlocks.size());
-            /**
-             * set semaphore for 1 single VDDK read operation at the time
-             */
-            final String[] report = new String[vixBlocks.size()];
+                radb.setNumberOfBlocks(vixBlocks.size());
 
-            for (final BasicBlockInfo block : vixBlocks) {
-                final ExBlockInfo dumpFilesInfo = new ExBlockInfo(block, vixBlocks.size(), target.getDisksPath());
-                final DumpThread r = new DumpThread(dumpFilesInfo, buffers, radb, report, interactive, this.logger);
+                interactive.endNormalizeVmdkBlocks();
+                /**
+                 * End Section Normalize Blocks
+                 */
+                journal = DumpJournal.open(radb, vixBlocks);
 
-                futureThreads.add(r);
+                for (final BasicBlockInfo block : vixBlocks) {
+                    final ExBlockInfo dumpFilesInfo = new ExBlockInfo(block, vixBlocks.size(), target.getDisksPath());
+                    futureThreads.add(new DumpThread(dumpFilesInfo, buffers, radb, interactive, journal, this.logger));
+                }
+            } else {
+                msg = String.format("Streaming allocated blocks normalized to the Max block size of %d Sectors (%s)",
+                        maxSectorsXBlock, PrettyNumber.toString(profile.getMaxBlockSize(), MetricPrefix.MEGA));
+                this.logger.info(msg);
             }
-            msg = MessagesTemplate.diskHeaderInfo(radb);
-            finalReport.append(msg);
-            this.logger.info(msg);
-            finalReport.append('\n');
-            msg = MessagesTemplate.diskDumpHeaderInfo(radb);
-            this.logger.info(msg);
-            finalReport.append(msg);
-            finalReport.append('\n');
-            msg = MessagesTemplate.header(radb.isCompressed());
-            this.logger.info(msg);
-            finalReport.append(msg);
-            finalReport.append('\n');
             /**
              * Start Section DumpThreads
              */
             interactive.startDumpThreads();
+            buffers.setIoJob(SJvddk.registerIoJob(jDiskLibConst.IO_CLASS_BACKGROUND,
+                    CoreGlobalSettings.getIoSchedulerDumpDeadlineSeconds() * 1000L));
             buffers.start();
-            TotalBlocksInfo totalDumpInfo;
+            String lease = null;
             try {
-                totalDumpInfo = dumpThreads(radb, futureThreads);
+                // no generation is removed until the references of the disk are flushed
+                lease = target.acquireDumpLease();
+                if (blockList != null) {
+                    totalDumpInfo = dumpThreads(radb, futureThreads);
+                } else {
+                    totalDumpInfo = dumpStreaming(radb, interactive, buffers, target, vixBlocks, futureThreads);
+                }
                 // wait for subtask to finish
                 buffers.waitSubTasks();
+                flushTarget(radb, target);
             } finally {
+                if (lease != null) {
+                    target.releaseDumpLease(lease);
+                }
                 interactive.endDumpThreads(radb.getState());
                 /**
                  * End Section DumpThreads
                  */
                 buffers.stop();
+                SJvddk.unregisterIoJob(buffers.getIoJob());
             }
-            for (final DumpThread s : futureThreads) {
-                profile.addDumpInfo(radb.getDiskId(), s.getBlockInfo());
+        } catch (final IOException e) {
+            Utility.logWarning(this.logger, e);
+            radb.failure(e);
+        } catch (final NoSuchAlgorithmException e) {
+            this.logger.severe(
+                    "CoreResultActionDiskBackup, AbstractBackupInteractive, List<Block>, DiskHandle, TargetOperation - exception: " //$NON-NLS-1$
+                            + e);
+            radb.failure(e);
+        } catch (final InterruptedException e) {
+            radb.failure(e);
+            // Restore interrupted state...
+            Thread.currentThread().interrupt();
+        } finally {
+            if (journal != null) {
+                if (radb.isRunning()) {
+                    journal.delete();
+                } else {
+                    journal.close();
+                }
             }
+        }
+        if (vixBlocks.isEmpty() && radb.isRunning()) {
+            manageEmptyBlocksList(radb, target);
+            return null;
+        }
+        final String returnString = dumpReport(radb, interactive, futureThreads, totalDumpInfo);
+        if (this.logger.isLoggable(Level.CONFIG)) {
+            this.logger.config(
+                    "CoreResultActionDiskBackup, AbstractBackupInteractive, List<Block>, DiskHandle, TargetOperation - end"); //$NON-NLS-1$
+        }
+        return returnString;
+    }
+
+    /**
+     * Record the blocks dumped in the profile and build the report of the disk
+     *
+     * @param radb
+     * @param interactive
+     * @param futureThreads
+     * @param totalDumpInfo null if the dump did not complete
+     * @return the report
+     */
+    private String dumpReport(final CoreResultActionDiskBackup radb, final AbstractBackupDiskInteractive interactive,
+            final List<DumpThread> futureThreads, final TotalBlocksInfo totalDumpInfo) {
+        final GenerationProfile profile = radb.getProfile();
+        final StringBuilder finalReport = new StringBuilder();
+        String msg = MessagesTemplate.diskHeaderInfo(radb);
+        finalReport.append(msg);
+        this.logger.info(msg);
+        finalReport.append('\n');
+        msg = MessagesTemplate.diskDumpHeaderInfo(radb);
+        this.logger.info(msg);
+        finalReport.append(msg);
+        finalReport.append('\n');
+        finalReport.append(MessagesTemplate.header(radb.isCompressed()));
+        finalReport.append('\n');
+        for (final DumpThread s : futureThreads) {
+            final ExBlockInfo blockInfo = s.getBlockInfo();
+            blockInfo.setTotalBlocks(futureThreads.size());
+            profile.addDumpInfo(radb.getDiskId(), blockInfo);
+            finalReport.append(MessagesTemplate.dumpInfo(radb.getFcoEntityInfo(), blockInfo));
+            finalReport.append('\n');
+        }
+        if (totalDumpInfo != null) {
             /**
              * Start Section DumpsTotalCalculation
              */
             interactive.startDumpsTotalCalculation();
-            finalReport.append(String.join("\n", report));
-            finalReport.append('\n');
             finalReport.append(totalDumpInfo.separetorBar());
             finalReport.append('\n');
             msg = totalDumpInfo.toString();
             finalReport.append(msg);
+            finalReport.append('\n');
             this.logger.info(msg);
             /**
              * End Section DumpsTotalCalculation
@@ -632,37 +785,140 @@ public class Jvddk extends SJvddk implements IJvddkBasic {
             interactive.endDumpsTotalCalculation(totalDumpInfo);
             profile.setDiskTotalDumpSize(radb.getDiskId(), totalDumpInfo.getStreamSize());
             profile.setDiskTotalUncompressedDumpSize(radb.getDiskId(), totalDumpInfo.getSize());
-        } catch (final NoSuchAlgorithmException e) {
-            this.logger.severe(
-                    "CoreResultActionDiskBackup, AbstractBackupInteractive, List<Block>, DiskHandle, TargetOperation - exception: " //$NON-NLS-1$
-                            + e);
-
-            msg = String.format("Dump disk:%d fails - see log for more details", radb.getDiskId());
-            this.logger.warning(msg);
-            finalReport.append(msg);
-
-            finalReport.append('\n');
-            radb.failure(e);
-        } catch (final InterruptedException e) {
-            // Restore interrupted state...
-            Thread.currentThread().interrupt();
         }
         if (radb.isRunning()) {
             msg = String.format("Dump disk:%d success", radb.getDiskId());
             this.logger.info(msg);
-            finalReport.append(msg);
         } else {
             msg = String.format("Dump disk:%d failed: %s", radb.getDiskId(), radb.getReason());
             this.logger.warning(msg);
-            finalReport.append(msg);
         }
-        final String returnString = finalReport.toString();
+        finalReport.append(msg);
+        return finalReport.toString();
+    }
+
+    /**
+     * Report the outcome of the dump threads on radb, stopping at the first
+     * abort or failure
+     *
+     * @param radb
+     * @param answers
+     * @throws InterruptedException
+     * @throws ExecutionException
+     * @throws CoreResultActionException
+     */
+    private void checkAnswers(final CoreResultActionDiskBackup radb, final List<Future<Boolean>> answers)
+            throws InterruptedException, ExecutionException, CoreResultActionException {
+        int index = 0;
+        for (final Future<Boolean> answer : answers) {
+            if (answer.get() == null) {
+                final String msg = String.format("Dump disk:%d block:%d - Aborted by user", radb.getDiskId(), index);
+                radb.aborted(msg);
+                this.logger.warning(msg);
+            } else if (Boolean.FALSE.equals(answer.get())) {
+                final String msg = String.format("Dump disk:%d block:%d - fails - see log for more details",
+                        radb.getDiskId(), index);
+                radb.failure(msg);
+                this.logger.warning(msg);
+            } else {
+                if (this.logger.isLoggable(Level.FINE)) {
+                    final String msg = String.format("Dump disk:%d block:%d - success", radb.getDiskId(), index);
+                    this.logger.fine(msg);
+                }
+            }
+            if (radb.isAbortedOrFailed()) {
+                break;
+            }
+            ++index;
+        }
+    }
+
+    /**
+     * Dump the allocated blocks of a full backup while they are discovered.
+     * The first blocks are read as soon as the first slice of the disk has been
+     * queried, and the block list is never held in full before the dump.
+     *
+     * @param radb
+     * @param interactive
+     * @param buffers
+     * @param target
+     * @param vixBlocks     filled with the blocks discovered
+     * @param futureThreads filled with their dump threads
+     * @return the totals, or null if the dump did not complete
+     * @throws InterruptedException
+     * @throws CoreResultActionException
+     */
+    private TotalBlocksInfo dumpStreaming(final CoreResultActionDiskBackup radb,
+            final AbstractBackupDiskInteractive interactive, final Buffers buffers, final ITargetOperation target,
+            final List<BasicBlockInfo> vixBlocks, final List<DumpThread> futureThreads)
+            throws InterruptedException, CoreResultActionException {
         if (this.logger.isLoggable(Level.CONFIG)) {
-            this.logger.config(
-                    "CoreResultActionDiskBackup, AbstractBackupInteractive, List<Block>, DiskHandle, TargetOperation - end"); //$NON-NLS-1$
+            this.logger.config("CoreResultActionDiskBackup, AbstractBackupInteractive, TargetOperation - start"); //$NON-NLS-1$
         }
-        return returnString;
+        final int maxSectorsXBlock = (int) (radb.getProfile().getMaxBlockSize() / jDiskLibConst.SECTOR_SIZE);
+        final List<Future<Boolean>> answers = new ArrayList<>();
+        final DumpScheduler.DiskGroup disk = (this.dumpScheduler != null) ? this.dumpScheduler.newDiskGroup() : null;
+        final ExecutorService es = (this.dumpScheduler == null) ? newDumpExecutor(radb) : null;
+        TotalBlocksInfo returnTotalDumpFileInfo = null;
+        final long startTime = System.nanoTime();
+        try (AllocatedBlockCursor cursor = new AllocatedBlockCursor(radb.getDiskHandle(),
+                radb.getJVmdkInfo().getCapacityInSectors(), maxSectorsXBlock, buffers.getSemaphore())) {
+            List<Block> slice;
+            while (buffers.isRunning() && ((slice = cursor.next()) != null)) {
+                final int first = vixBlocks.size();
+                normalizeBlocks(radb, slice, vixBlocks, maxSectorsXBlock);
+                radb.setNumberOfBlocks(vixBlocks.size());
+                final List<DumpThread> batch = new ArrayList<>(vixBlocks.size() - first);
+                for (final BasicBlockInfo block : vixBlocks.subList(first, vixBlocks.size())) {
+                    final ExBlockInfo dumpFilesInfo = new ExBlockInfo(block, vixBlocks.size(), target.getDisksPath());
+                    batch.add(new DumpThread(dumpFilesInfo, buffers, radb, interactive, null, this.logger));
+                }
+                futureThreads.addAll(batch);
+                if (disk != null) {
+                    answers.addAll(this.dumpScheduler.submitAll(disk, batch));
+                } else {
+                    for (final DumpThread thread : batch) {
+                        answers.add(es.submit(thread));
+                    }
+                }
+            }
+            checkAnswers(radb, answers);
+            returnTotalDumpFileInfo = new TotalBlocksInfo(radb.getEntityType(), radb.getDiskId(),
+                    radb.getDumpMap().values(), startTime, System.nanoTime());
+        } catch (final JVixException | ExecutionException e) {
+            Utility.logWarning(this.logger, e);
+            radb.failure(e);
+        } finally {
+            for (final Future<Boolean> answer : answers) {
+                answer.cancel(true);
+            }
+            if (es != null) {
+                es.shutdownNow();
+            }
+        }
+        if (this.logger.isLoggable(Level.CONFIG)) {
+            this.logger.config("CoreResultActionDiskBackup, AbstractBackupInteractive, TargetOperation - end"); //$NON-NLS-1$
+        }
+        return returnTotalDumpFileInfo;
+    }
 
+    /**
+     * Commit the packfiles and the dedup references of the disk before the
+     * profile references them
+     *
+     * @param radb
+     * @param target
+     * @throws InterruptedException
+     * @throws CoreResultActionException
+     */
+    private void flushTarget(final CoreResultActionDiskBackup radb, final ITargetOperation target)
+            throws InterruptedException, CoreResultActionException {
+        if (!target.flushPacks() && radb.isRunning()) {
+            radb.failure(String.format("Dump disk:%d packfile write failed", radb.getDiskId()));
+        }
+        if (!target.flushDedupReferences() && radb.isRunning()) {
+            radb.failure(String.format("Dump disk:%d dedup reference log write failed", radb.getDiskId()));
+        }
     }
 
     /**
@@ -681,39 +937,18 @@ public class Jvddk extends SJvddk implements IJvddkBasic {
         }
         TotalBlocksInfo returnTotalDumpFileInfo = null;
         final long startTime = System.nanoTime();
-        final int threadPool = (int) Math.ceil(radb.getNumberOfThreads() * 1.3);
-        final VmbkThreadFactory threadFactory = new VmbkThreadFactory(
-                String.format("dump-%s-disk:%d", radb.getFcoEntityInfo().getName(), radb.getDiskId()), false, 0);
-
-        final ExecutorService es = Executors.newFixedThreadPool(threadPool, threadFactory);
+        ExecutorService es = null;
         try {
-
-            final List<Future<Boolean>> answers = es.invokeAll(futureThreads);
+            final List<Future<Boolean>> answers;
+            if (this.dumpScheduler != null) {
+                answers = this.dumpScheduler.invokeAll(futureThreads);
+            } else {
+                es = newDumpExecutor(radb);
+                answers = es.invokeAll(futureThreads);
+            }
 
             final long endTime = System.nanoTime();
-            int index = 0;
-            for (final Future<Boolean> answer : answers) {
-                if (answer.get() == null) {
-                    final String msg = String.format("Dump disk:%d block:%d - Aborted by user", radb.getDiskId(),
-                            index);
-                    radb.aborted(msg);
-                    this.logger.warning(msg);
-                } else if (Boolean.FALSE.equals(answer.get())) {
-                    final String msg = String.format("Dump disk:%d block:%d - fails - see log for more details",
-                            radb.getDiskId(), index);
-                    radb.failure(msg);
-                    this.logger.warning(msg);
-                } else {
-                    if (this.logger.isLoggable(Level.FINE)) {
-                        final String msg = String.format("Dump disk:%d block:%d - success", radb.getDiskId(), index);
-                        this.logger.fine(msg);
-                    }
-                }
-                if (radb.isAbortedOrFailed()) {
-                    break;
-                }
-                ++index;
-            }
+            checkAnswers(radb, answers);
 
             returnTotalDumpFileInfo = new TotalBlocksInfo(radb.getEntityType(), radb.getDiskId(),
                     radb.getDumpMap().values(), startTime, endTime);
@@ -738,6 +973,17 @@ public class Jvddk extends SJvddk implements IJvddkBasic {
         return returnTotalDumpFileInfo;
     }
 
+    /**
+     * @param radb
+     * @return the thread pool of a disk dumped without the scheduler
+     */
+    private ExecutorService newDumpExecutor(final CoreResultActionDiskBackup radb) {
+        return Executors.newFixedThreadPool((int) Math.ceil(radb.getNumberOfThreads() * 1.3),
+                new VmbkThreadFactory(
+                        String.format("dump-%s-disk:%d", radb.getFcoEntityInfo().getName(), radb.getDiskId()), false,
+                        0));
+    }
+
     public long endAccess() throws JVixException {
         long vddkCallResult = jDiskLibConst.VIX_OK;
         if (StringUtils.isNotBlank(identity)) {
@@ -764,6 +1010,16 @@ public class Jvddk extends SJvddk implements IJvddkBasic {
         return this.basicVimConnection;
     }
 
+    /**
+     * Dump the blocks of the disks through a scheduler shared with the other
+     * disks instead of a thread pool per disk.
+     *
+     * @param dumpScheduler null to restore the thread pool per disk
+     */
+    public void setDumpScheduler(final DumpScheduler dumpScheduler) {
+        this.dumpScheduler = dumpScheduler;
+    }
+
     private List<Block> getBlockList(final CoreResultActionDiskBackup radb)
             throws FileFaultFaultMsg, NotFoundFaultMsg, RuntimeFaultFaultMsg, com.vmware.vslm.FileFaultFaultMsg,
             InvalidArgumentFaultMsg, InvalidDatastoreFaultMsg, InvalidStateFaultMsg, com.vmware.vslm.NotFoundFaultMsg,
@@ -772,7 +1028,8 @@ public class Jvddk extends SJvddk implements IJvddkBasic {
         final List<Block> blockList = new ArrayList<>();
         switch (radb.getQueryBlocksOption()) {
         case ALLOCATED:
-            blockList.addAll(queryAllocatedBlock(radb.getDiskHandle(), radb.getJVmdkInfo()));
+            blockList.addAll(queryAllocatedBlock(radb.getDiskHandle(), radb.getJVmdkInfo(),
+                    radb.getProfile().getMaxNumberOfSectorsPerBlock()));
             break;
         case CHANGED_AREAS:
             blockList.addAll(radb.getFirstClassObject().queryChangedDiskAreas(radb.getProfile(), radb.getDiskId(),
@@ -860,7 +1117,8 @@ public class Jvddk extends SJvddk implements IJvddkBasic {
         return returnBlock;
     }
 
-    private void manageEmptyBlocksList(final CoreResultActionDiskBackup radb) throws CoreResultActionException {
+    private void manageEmptyBlocksList(final CoreResultActionDiskBackup radb, final ITargetOperation target)
+            throws CoreResultActionException {
         if (this.logger.isLoggable(Level.CONFIG)) {
             this.logger.config("CoreResultActionDiskBackup - start"); //$NON-NLS-1$
         }
@@ -889,6 +1147,9 @@ public class Jvddk extends SJvddk implements IJvddkBasic {
 
         profile.setDiskTotalDumpSize(radb.getDiskId(), 0);
         profile.setDiskTotalUncompressedDumpSize(radb.getDiskId(), 0);
+        if (radb.getBackupMode() == BackupMode.INCREMENTAL) {
+            copyPreviousFileCatalog(profile, target, radb);
+        }
 
         if (radb.isSkipped()) {
             msg = MessagesTemplate.diskHeaderInfo(radb);
@@ -907,16 +1168,21 @@ public class Jvddk extends SJvddk implements IJvddkBasic {
         }
         final TreeMap<Long, Block> d = new TreeMap<>();
         for (final Block originalBlock : src) {
-            if (originalBlock.length > maxBlockSize) {
+            /*
+             * Cut on the multiples of maxBlockSize wherever the block starts: the
+             * same data gets the same blocks, and so the same keys, however the
+             * disk areas were queried or sliced
+             */
+            if (((originalBlock.offset % maxBlockSize) + originalBlock.length) > maxBlockSize) {
                 long len = originalBlock.length;
                 long offset = originalBlock.offset;
 
                 while (len > 0) {
                     final Block b = new Block();
-                    b.length = Math.min(len, maxBlockSize);
+                    b.length = Math.min(len, maxBlockSize - (offset % maxBlockSize));
                     b.offset = offset;
                     d.put(offset, b);
-                    len -= maxBlockSize;
+                    len -= b.length;
                     offset = b.getLastBlock() + 1;
                 }
 
@@ -926,7 +1192,7 @@ public class Jvddk extends SJvddk implements IJvddkBasic {
 
         }
         final int extension = d.size() - src.size();
-        int index = 0;
+        int index = dst.size();
         for (final Entry<Long, Block> entry : d.entrySet()) {
             dst.add(new BasicBlockInfo(entry.getValue(), radb, index));
             ++index;
@@ -938,6 +1204,21 @@ public class Jvddk extends SJvddk implements IJvddkBasic {
 
     }
 
+    /**
+     * @param radb
+     * @param blockListQueryChangedDiskAreas
+     * @return true if the allocated blocks of the disk are dumped while they are
+     *         discovered
+     */
+    private boolean isStreamingDiscovery(final CoreResultActionDiskBackup radb,
+            final List<Block> blockListQueryChangedDiskAreas) {
+        if (!CoreGlobalSettings.isDumpStreamingDiscovery() || (radb.getBackupMode() == BackupMode.INCREMENTAL)) {
+            return false;
+        }
+        resolveQueryBlocksOption(radb);
+        return radb.getQueryBlocksOption() == QueryBlocksOption.ALLOCATED;
+    }
+
     private boolean openVmdk(final EntityType entityType, final AbstractCoreResultDiskBackupRestore radb)
             throws JddkException, InterruptedException, CoreResultActionException {
 
@@ -967,6 +1248,7 @@ public class Jvddk extends SJvddk implements IJvddkBasic {
                 radb.failure(msg);
             } else {
                 radb.setDiskHandle(diskOpen.getDiskHandle());
+                setThrottleTags(diskOpen.getDiskHandle());
                 final String transport = getTransportMode(diskOpen.getDiskHandle());
                 if (StringUtils.isNotBlank(transport)) {
                     radb.setUsedTransportModes(transport);
@@ -986,6 +1268,84 @@ public class Jvddk extends SJvddk implements IJvddkBasic {
         return result;
     }
 
+    /**
+     * Attach the disk to the bandwidth throttling buckets of its ESX host and
+     * datastore. The native library already tags the datastore from the disk
+     * path when it can.
+     *
+     * @param diskHandle
+     */
+    private void setThrottleTags(final DiskHandle diskHandle) {
+        if (!SJvddk.dli.isExtendedLibrary()) {
+            return;
+        }
+        String host = null;
+        String datastore = null;
+        try {
+            switch (this.fco.getEntityType()) {
+            case VirtualMachine:
+                host = ((VirtualMachineManager) this.fco).getHostInfo().getName();
+                break;
+            case ImprovedVirtualDisk:
+                datastore = ((ImprovedVirtualDisk) this.fco).getDatastoreInfo().getName();
+                break;
+            default:
+                break;
+            }
+        } catch (final InvalidPropertyFaultMsg | RuntimeFaultFaultMsg e) {
+            Utility.logWarning(this.logger, e);
+        } catch (final InterruptedException e) {
+            this.logger.log(Level.WARNING, "Interrupted!", e);
+            Thread.currentThread().interrupt();
+        }
+        SJvddk.dli.setThrottleTags(diskHandle, host, datastore);
+    }
+
+    /**
+     * Order the transport modes by timed reads of the disk through each one.
+     * The probe result is kept per ESX host (or datastore of an IVD).
+     *
+     * @param snapshotRef
+     * @param transportModes requested modes, null for all
+     * @param remoteDiskPath disk to read, null for an IVD
+     * @return the modes fastest first and the report of the probe
+     * @throws JVixException if no mode works
+     */
+    public String[] probeTransportModes(final String snapshotRef, final String transportModes,
+            final String remoteDiskPath) throws JVixException {
+        String cacheKey = null;
+        try {
+            switch (this.fco.getEntityType()) {
+            case VirtualMachine:
+                cacheKey = ((VirtualMachineManager) this.fco).getHostInfo().getName();
+                break;
+            case ImprovedVirtualDisk:
+                cacheKey = ((ImprovedVirtualDisk) this.fco).getDatastoreInfo().getName();
+                break;
+            default:
+                break;
+            }
+        } catch (final InvalidPropertyFaultMsg | RuntimeFaultFaultMsg e) {
+            Utility.logWarning(this.logger, e);
+        } catch (final InterruptedException e) {
+            this.logger.log(Level.WARNING, "Interrupted!", e);
+            Thread.currentThread().interrupt();
+        }
+        final String[] result = new String[2];
+        final String ssMoref = (this.connectParams.getSpecType() == ConnectParams.VIXDISKLIB_SPEC_VSTORAGE_OBJECT)
+                ? null
+                : snapshotRef;
+        final long vddkCallResult = SJvddk.dli.probeTransportModes(this.connectParams, ssMoref, transportModes,
+                Utility.removeQuote(remoteDiskPath), cacheKey,
+                CoreGlobalSettings.getTransportProbeMb() * (Utility.ONE_MBYTES / jDiskLibConst.SECTOR_SIZE),
+                CoreGlobalSettings.getTransportProbeCacheSeconds(), result);
+        if (vddkCallResult != jDiskLibConst.VIX_OK) {
+            throw new JVixException(vddkCallResult, SJvddk.dli.getErrorText(vddkCallResult, null));
+        }
+        this.logger.log(Level.INFO, () -> String.format("Transport probe: %s", result[1]));
+        return result;
+    }
+
     public long prepareForAccess(final String identity) throws JVixException {
 
         if (checkEnableDisablePrivileges()
@@ -1006,51 +1366,30 @@ public class Jvddk extends SJvddk implements IJvddkBasic {
         }
     }
 
-    private ArrayList<Block> queryAllocatedBlock(final DiskHandle diskHandle, final JVmdkInfo vmdkInfo)
-            throws JVixException {
+    /**
+     * @param diskHandle
+     * @param vmdkInfo
+     * @param alignment  max block size of the generation, in sectors
+     * @return the allocated blocks of the disk
+     * @throws JVixException
+     */
+    private ArrayList<Block> queryAllocatedBlock(final DiskHandle diskHandle, final JVmdkInfo vmdkInfo,
+            final long alignment) throws JVixException {
         if (this.logger.isLoggable(Level.CONFIG)) {
             this.logger.config("DiskHandle, JVmdkInfo - start"); //$NON-NLS-1$
         }
 
         final ArrayList<Block> vixBlocks = new ArrayList<>();
-        long offset = 0;
-        final long chunkSize = jDiskLibConst.MIN_CHUNK_SIZE;
-        final long capacity = vmdkInfo.getCapacityInSectors();
-        long numChunk = capacity / chunkSize;
-        while (numChunk > 0) {
-            final ArrayList<Block> blockList = new ArrayList<>();
-            long numChunkToQuery;
-
-            if (numChunk > jDiskLibConst.MAX_CHUNK_NUMBER) {
-                numChunkToQuery = jDiskLibConst.MAX_CHUNK_NUMBER;
-            } else {
-                numChunkToQuery = numChunk;
-            }
-
-            final long vddkCallResult = SJvddk.dli.queryAllocatedBlocks(diskHandle, offset, numChunkToQuery * chunkSize,
-                    chunkSize, blockList);
-
-            if (vddkCallResult != jDiskLibConst.VIX_OK) {
-                final String msg = SJvddk.dli.getErrorText(vddkCallResult, null);
-                this.logger.warning(msg);
-                throw new JVixException(vddkCallResult, msg);
+        try (AllocatedBlockCursor cursor = new AllocatedBlockCursor(diskHandle, vmdkInfo.getCapacityInSectors(),
+                alignment, null)) {
+            List<Block> slice;
+            while ((slice = cursor.next()) != null) {
+                vixBlocks.addAll(slice);
             }
-
-            vixBlocks.addAll(blockList);
-
-            numChunk -= numChunkToQuery;
-            offset += numChunkToQuery * chunkSize;
-
-        }
-        /*
-         * Just add unaligned part even though it may not be allocated.
-         */
-        final long unalignedPart = capacity % chunkSize;
-        if (unalignedPart > 0) {
-            final Block block = new Block();
-            block.offset = offset;
-            block.length = unalignedPart;
-            vixBlocks.add(block);
+        } catch (final InterruptedException e) {
+            // Restore interrupted state...
+            Thread.currentThread().interrupt();
+            throw new JVixException(e);
         }
 
         if (this.logger.isLoggable(Level.CONFIG)) {
@@ -1096,7 +1435,7 @@ public class Jvddk extends SJvddk implements IJvddkBasic {
                     blockList.addAll(blockListQueryChangedDiskAreas);
                 } else {
                     final List<Block> blockListQueryAllocatedBlock = queryAllocatedBlock(radb.getDiskHandle(),
-                            radb.getJVmdkInfo());
+                            radb.getJVmdkInfo(), radb.getProfile().getMaxNumberOfSectorsPerBlock());
                     blockList.addAll(
                             getIncrementalSectorsRange(blockListQueryChangedDiskAreas, blockListQueryAllocatedBlock));
                 }
@@ -1105,41 +1444,64 @@ public class Jvddk extends SJvddk implements IJvddkBasic {
                 radb.setQueryBlocksOption(QueryBlocksOption.CHANGED_AREAS);
             }
         } else {
-            QueryBlocksOption queryBlockType = radb.getQueryBlocksOption();
-            switch (queryBlockType) {
-            case FULL:
-                queryBlockType = QueryBlocksOption.FULL;
-                radb.setBackupMode(BackupMode.FULL);
-                break;
-            case ALLOCATED:
-                if ((JDiskLibFactory.getVddkVersion().checkVersion("6.7") >= 0) && (!isNoNfcSession())) {
-                    queryBlockType = QueryBlocksOption.ALLOCATED;
+            resolveQueryBlocksOption(radb);
+        }
 
-                } else if (radb.isChangedBlockTrackingEnabled()) {
-                    queryBlockType = QueryBlocksOption.CHANGED_AREAS;
-                } else {
-                    queryBlockType = QueryBlocksOption.FULL;
-                }
-                break;
-            case CHANGED_AREAS:
-                if (radb.isChangedBlockTrackingEnabled()) {
-                    queryBlockType = QueryBlocksOption.CHANGED_AREAS;
-                } else {
-                    queryBlockType = QueryBlocksOption.FULL;
-                }
-                break;
-            case UNKNOWS:
-                queryBlockType = QueryBlocksOption.FULL;
-                break;
-            default:
-                break;
-            }
-            radb.setQueryBlocksOption(queryBlockType);
+        return getBlockList(radb);
 
+    }
+
+    /**
+     * The extended library emulates VixDiskLib_QueryAllocatedBlocks on a
+     * VixDiskLib without it by reading the disk, which would read the disk twice:
+     * only use it when native
+     *
+     * @return
+     */
+    private boolean isQueryAllocatedBlocksNative() {
+        if (SJvddk.dli.isExtendedLibrary()) {
+            return (SJvddk.dli.getVddkCapabilities() & jDiskLibConst.VDDK_CAP_QUERY_ALLOCATED) != 0;
         }
+        return JDiskLibFactory.getVddkVersion().checkVersion("6.7") >= 0;
+    }
 
-        return getBlockList(radb);
+    /**
+     * Resolve the query option of a non incremental backup to one the disk and
+     * the VDDK version support
+     *
+     * @param radb
+     */
+    private void resolveQueryBlocksOption(final CoreResultActionDiskBackup radb) {
+        QueryBlocksOption queryBlockType = radb.getQueryBlocksOption();
+        switch (queryBlockType) {
+        case FULL:
+            queryBlockType = QueryBlocksOption.FULL;
+            radb.setBackupMode(BackupMode.FULL);
+            break;
+        case ALLOCATED:
+            if (isQueryAllocatedBlocksNative() && (!isNoNfcSession())) {
+                queryBlockType = QueryBlocksOption.ALLOCATED;
 
+            } else if (radb.isChangedBlockTrackingEnabled()) {
+                queryBlockType = QueryBlocksOption.CHANGED_AREAS;
+            } else {
+                queryBlockType = QueryBlocksOption.FULL;
+            }
+            break;
+        case CHANGED_AREAS:
+            if (radb.isChangedBlockTrackingEnabled()) {
+                queryBlockType = QueryBlocksOption.CHANGED_AREAS;
+            } else {
+                queryBlockType = QueryBlocksOption.FULL;
+            }
+            break;
+        case UNKNOWS:
+            queryBlockType = QueryBlocksOption.FULL;
+            break;
+        default:
+            break;
+        }
+        radb.setQueryBlocksOption(queryBlockType);
     }
 
     private void setDiskMetadata(final CoreResultActionDiskRestore radr) {
@@ -0,0 +1,124 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.core;
+
+import java.io.Closeable;
+import java.util.logging.Level;
+import java.util.logging.Logger;
+
+import com.vmware.jvix.Progress;
+import com.vmware.jvix.jDiskLibConst;
+import com.vmware.safekeeping.core.control.Vmbk;
+
+/**
+ * Native progress channel attached to the Progress of a long VixDiskLib
+ * operation for its duration.
+ *
+ * The channel coalesces the upcalls into Progress.Update and publishes the
+ * percentage where getPercent() reads it without an upcall. A watcher raises
+ * its cancel flag as soon as the abort is triggered, and the operation stops
+ * at its next progress tick instead of waiting for the next Update.
+ *
+ * Without the extended library, or without a Progress, nothing is attached
+ * and the operation reports and cancels through Progress.Update alone.
+ */
+public final class ProgressChannel implements Closeable {
+    private static final Logger logger = Logger.getLogger(ProgressChannel.class.getName());
+
+    private static final long ABORT_POLL_MS = 200;
+
+    private final Progress progress;
+    private final long handle;
+    private final Thread watcher;
+
+    /**
+     * @param progress progress of the operation, null for none
+     */
+    public ProgressChannel(final Progress progress) {
+        final long[] result = new long[1];
+        if ((progress != null) && (SJvddk.getDli() != null)
+                && (SJvddk.getDli().progressOpen(0, result) == jDiskLibConst.VIX_OK)) {
+            this.progress = progress;
+            this.handle = result[0];
+            progress.setChannel(this.handle);
+            this.watcher = new Thread(this::watch, "ProgressChannel");
+            this.watcher.setDaemon(true);
+            this.watcher.start();
+        } else {
+            this.progress = null;
+            this.handle = 0;
+            this.watcher = null;
+        }
+    }
+
+    /**
+     * Detach the channel and free it. The operation must have returned.
+     */
+    @Override
+    public void close() {
+        if (this.watcher != null) {
+            this.watcher.interrupt();
+            try {
+                this.watcher.join();
+            } catch (final InterruptedException e) {
+                logger.log(Level.WARNING, "Interrupted!", e);
+                // Restore interrupted state...
+                Thread.currentThread().interrupt();
+            }
+            this.progress.setChannel(0);
+            SJvddk.getDli().progressClose(this.handle);
+        }
+    }
+
+    /**
+     * @return the last percentage reported by the operation, -1 without a
+     *         channel
+     */
+    public int getPercent() {
+        if (this.watcher == null) {
+            return -1;
+        }
+        final long[] stats = new long[jDiskLibConst.PROGRESS_STATS_SIZE];
+        SJvddk.getDli().progressGetStats(this.handle, stats);
+        return (int) stats[jDiskLibConst.PROGRESS_STAT_PERCENT];
+    }
+
+    private void watch() {
+        try {
+            while (!Vmbk.isAbortTriggered()) {
+                Thread.sleep(ABORT_POLL_MS);
+            }
+            SJvddk.getDli().progressCancel(this.handle);
+            if (logger.isLoggable(Level.INFO)) {
+                logger.info("Abort triggered: operation cancelled");
+            }
+        } catch (final InterruptedException e) {
+            // closed: the operation returned
+            Thread.currentThread().interrupt();
+        }
+    }
+}
@@ -41,6 +41,7 @@ import com.vmware.safekeeping.core.command.interactive.AbstractRestoreDiskIntera
 import com.vmware.safekeeping.core.command.results.CoreResultActionDiskRestore;
 import com.vmware.safekeeping.core.control.TargetBuffer;
 import com.vmware.safekeeping.core.control.info.ExBlockInfo;
+import com.vmware.safekeeping.core.profile.CoreGlobalSettings;
 import com.vmware.safekeeping.core.type.ManagedFcoEntityInfo;
 
 class RestoreThread extends AbstractBlockThread implements IRestoreThread {
@@ -90,8 +91,12 @@ class RestoreThread extends AbstractBlockThread implements IRestoreThread {
         if (bufferIndex != null) {
             final TargetBuffer buffer = this.buffers.getBuffer(bufferIndex);
             try {
+                if (CoreGlobalSettings.isCrc32cVerifyOnRestore()) {
+                    // carried by the generation profile, no read of the block json
+                    this.blockInfo.setCrcMap(Crc32cMap.decode(this.blockInfo.getCrc32c()));
+                }
                 result = (this.target.openGetDump(this.blockInfo, buffer)
-                        && computeOpenGetDump(this.blockInfo, buffer, true) && vddkWrite(bufferIndex, this.tentative));
+                        && computeOpenGetDump(this.blockInfo, buffer) && vddkWrite(bufferIndex, this.tentative));
             } catch (final BadPaddingException | IllegalBlockSizeException | IOException e) {
                 Utility.logWarning(this.logger, e);
                 this.blockInfo.setReason(getEntity(), e);
@@ -124,8 +129,8 @@ class RestoreThread extends AbstractBlockThread implements IRestoreThread {
                         this.logger.finest(String.format("Index %d Sector %d - Semaphore acquired",
                                 this.blockInfo.getIndex(), this.blockInfo.getOffset())); // $NON-NLS-1$
                     }
-                    dliResult = SJvddk.dli.write(this.diskHandle, this.blockInfo.getOffset(),
-                            this.blockInfo.getLength(), this.buffers.getBuffer(bufferIndex).getOutputBuffer());
+                    dliResult = SJvddk.write(this.buffers.getIoJob(), this.diskHandle, this.blockInfo.getOffset(),
+                            this.blockInfo.getLength(), this.buffers.getBuffer(bufferIndex).getInputBuffer());
 
                 } finally {
                     if (this.logger.isLoggable(Level.FINEST)) {
@@ -28,8 +28,10 @@ package com.vmware.safekeeping.core.core;
 
 import java.io.File;
 import java.io.IOException;
+import java.util.List;
 import java.util.concurrent.BlockingQueue;
 import java.util.concurrent.LinkedBlockingQueue;
+import java.util.concurrent.atomic.AtomicLong;
 import java.util.logging.Level;
 import java.util.logging.Logger;
 
@@ -39,7 +41,10 @@ import com.vmware.jvix.CleanUpResults;
 import com.vmware.jvix.JDisk;
 import com.vmware.jvix.JDiskLibFactory;
 import com.vmware.jvix.JVixException;
+import com.vmware.jvix.Progress;
 import com.vmware.jvix.jDiskLib.ConnectParams;
+import com.vmware.jvix.jDiskLib.DiskHandle;
+import com.vmware.jvix.jDiskLib.GuestFsEntry;
 import com.vmware.jvix.jDiskLibConst;
 import com.vmware.safekeeping.common.GuestOsUtils;
 import com.vmware.safekeeping.common.Utility;
@@ -58,6 +63,9 @@ public class SJvddk {
 
     protected static final int CHUNK_SIZE = 128;
 
+    private static final AtomicLong ioJobCounter = new AtomicLong();
+    private static volatile boolean multiBufferHashSupported = true;
+
     public static CleanUpResults cleanup(final ConnectParams connectParams) {
         if (SJvddk.logger.isLoggable(Level.CONFIG)) {
             SJvddk.logger.config("ConnectParams - start"); //$NON-NLS-1$
@@ -183,6 +191,39 @@ public class SJvddk {
                 throw new JVixException(e);
             }
             SJvddk.logger.info("VddkManager Initialized successful.");
+            if (SJvddk.dli.isExtendedLibrary()) {
+                if (SJvddk.logger.isLoggable(Level.INFO)) {
+                    SJvddk.logger.info(String.format("VixDiskLib capabilities:0x%x", SJvddk.dli.getVddkCapabilities()));
+                }
+                SJvddk.dli.setAsyncQueueBounds(null, CoreGlobalSettings.getAsyncQueueDepthMin(),
+                        CoreGlobalSettings.getAsyncQueueDepthMax());
+                setBandwidthLimit(jDiskLibConst.THROTTLE_SCOPE_GLOBAL, null, CoreGlobalSettings.getThrottleGlobalMBps());
+                setBandwidthLimit(jDiskLibConst.THROTTLE_SCOPE_HOST, null, CoreGlobalSettings.getThrottleHostMBps());
+                setBandwidthLimit(jDiskLibConst.THROTTLE_SCOPE_DATASTORE, null,
+                        CoreGlobalSettings.getThrottleDatastoreMBps());
+                setBandwidthLimit(jDiskLibConst.THROTTLE_SCOPE_DISK, null, CoreGlobalSettings.getThrottleDiskMBps());
+                if (CoreGlobalSettings.isIoSchedulerEnabled()) {
+                    SJvddk.dli.setIoScheduler(
+                            CoreGlobalSettings.isIoSchedulerStrict() ? jDiskLibConst.IO_POLICY_STRICT
+                                    : jDiskLibConst.IO_POLICY_WEIGHTED,
+                            CoreGlobalSettings.getIoSchedulerMaxInFlight(), null);
+                }
+                SJvddk.dli.setConnectionCache(CoreGlobalSettings.getConnectionCacheIdleSeconds(),
+                        CoreGlobalSettings.getConnectionCacheMaxAgeSeconds(),
+                        CoreGlobalSettings.getConnectionCacheMaxIdleHandles());
+                final String daemonSocket = CoreGlobalSettings.getVddkDaemonSocket();
+                if (StringUtils.isNotEmpty(daemonSocket)) {
+                    final long daemonResult = SJvddk.dli.attachDaemon(daemonSocket,
+                            CoreGlobalSettings.getVddkDaemonSlots(),
+                            CoreGlobalSettings.getVddkDaemonSlotSizeMb() * 1024 * 1024);
+                    if (daemonResult == jDiskLibConst.VIX_OK) {
+                        SJvddk.logger.info("Read-only VDDK connections served by jdiskd at " + daemonSocket);
+                    } else {
+                        SJvddk.logger.warning("jdiskd at " + daemonSocket + " not available, VDDK stays in process: "
+                                + SJvddk.dli.getErrorText(daemonResult, null));
+                    }
+                }
+            }
             if (SJvddk.logger.isLoggable(Level.INFO)) {
                 SJvddk.logger.info("Transport modes available: " + SJvddk.dli.listTransportModes());
             }
@@ -227,6 +268,251 @@ public class SJvddk {
         }
     }
 
+    /**
+     * Change a bandwidth limit of the VDDK I/O. Takes effect on the running
+     * jobs.
+     *
+     * @param scope one of jDiskLibConst.THROTTLE_SCOPE_*
+     * @param name  host or datastore name, null for the default of the scope
+     * @param mbps  limit in MB/s, 0 is unlimited
+     * @return VIX error code
+     */
+    public static long setBandwidthLimit(final int scope, final String name, final int mbps) {
+        if (SJvddk.dli == null) {
+            return jDiskLibConst.VIX_E_FAIL;
+        }
+        return SJvddk.dli.setThrottleLimit(scope, name, null, (long) mbps * Utility.ONE_MBYTES, 0);
+    }
+
+    /**
+     * Estimate the entropy of a buffer with the native library.
+     *
+     * @return thousandths of a bit per byte, jDiskLibConst.ENTROPY_NOT_AVAILABLE
+     *         if the library does not support it
+     */
+    public static int estimateEntropy(final byte[] buffer, final int offset, final int length,
+            final int sampleSize) {
+        if ((SJvddk.dli == null) || !SJvddk.dli.isExtendedLibrary()) {
+            return jDiskLibConst.ENTROPY_NOT_AVAILABLE;
+        }
+        return SJvddk.dli.estimateEntropy(buffer, offset, length, sampleSize);
+    }
+
+    /**
+     * CRC32C of each chunk of a buffer with the native library.
+     *
+     * @return the number of entries, jDiskLibConst.CRC32C_MAP_FAILED if the
+     *         library does not support it
+     */
+    public static int crc32cMap(final byte[] buffer, final int offset, final int length, final int[] map) {
+        if ((SJvddk.dli == null) || !SJvddk.dli.isExtendedLibrary()) {
+            return jDiskLibConst.CRC32C_MAP_FAILED;
+        }
+        return SJvddk.dli.crc32cMap(buffer, offset, length, map);
+    }
+
+    /**
+     * Decode a MiGz stream with the native parallel decoder.
+     *
+     * @return the decoded size, jDiskLibConst.MIGZ_DECODE_FAILED if the native
+     *         decoder is not available or failed
+     */
+    public static int decodeMiGz(final byte[] src, final int srcLength, final byte[] dst) {
+        final int threads = CoreGlobalSettings.getMiGzDecodeThreads();
+        if ((threads < 1) || (SJvddk.dli == null) || !SJvddk.dli.isExtendedLibrary()) {
+            return jDiskLibConst.MIGZ_DECODE_FAILED;
+        }
+        return SJvddk.dli.miGzDecode(src, srcLength, dst, threads);
+    }
+
+    /**
+     * SHA-1 or MD5 of a buffer with the native multi-buffer engine.
+     *
+     * @param algorithm jDiskLibConst.HASH_SHA1 or jDiskLibConst.HASH_MD5
+     * @return the digest, null if the engine is disabled or not supported
+     */
+    public static byte[] multiBufferHash(final int algorithm, final byte[] buffer, final int offset,
+            final int length) {
+        if (!multiBufferHashSupported || (SJvddk.dli == null) || !SJvddk.dli.isExtendedLibrary()
+                || !CoreGlobalSettings.isMultiBufferHash()) {
+            return null;
+        }
+        final byte[] digest = new byte[(algorithm == jDiskLibConst.HASH_SHA1) ? 20 : 16];
+        final long result = SJvddk.dli.multiBufferHash(algorithm, buffer, offset, length, digest);
+        if (result == jDiskLibConst.VIX_E_NOT_SUPPORTED) {
+            multiBufferHashSupported = false;
+            SJvddk.logger.info("Native multi-buffer hash not supported on this CPU");
+        }
+        return (result == jDiskLibConst.VIX_OK) ? digest : null;
+    }
+
+    /**
+     * Verify the data files of a set of blocks with the native scrub engine.
+     *
+     * @see com.vmware.jvix.jDiskLib#scrub
+     * @return VIX_OK, jDiskLibConst.VIX_E_NOT_SUPPORTED if the engine is not
+     *         available
+     */
+    public static long scrub(final String[] paths, final int[] blocks, final byte[] digests, final byte[] key,
+            final int threads, final boolean shallow, final int[] status, final long[] stats) {
+        if ((SJvddk.dli == null) || !SJvddk.dli.isExtendedLibrary()) {
+            return jDiskLibConst.VIX_E_NOT_SUPPORTED;
+        }
+        return SJvddk.dli.scrub(paths, blocks, digests, key, threads, shallow, status, stats);
+    }
+
+    /**
+     * Copy a disk to another with the native copy engine, without going through
+     * the JVM. The copy can be restarted from stats[COPY_STAT_RESUME_SECTOR]
+     * after a failure, or a cancel: the copy runs under a ProgressChannel, so it
+     * stops as soon as the abort is triggered.
+     *
+     * Binding only: the backups and restores of safekeeping-core go through the
+     * archive and never hold two disks open, and the IVD clone is done by VSLM
+     * on the server, so nothing here calls it yet nor jDiskLib.clone.
+     *
+     * @see com.vmware.jvix.jDiskLib#copyDisk
+     * @param stats jDiskLibConst.COPY_STATS_SIZE entries
+     * @return VIX_OK, jDiskLibConst.VIX_E_NOT_SUPPORTED if the engine is not
+     *         available
+     */
+    public static long copyDisk(final DiskHandle src, final DiskHandle dst, final long startSector,
+            final long endSector, final boolean allocatedOnly, final Progress progress, final long[] stats) {
+        if ((SJvddk.dli == null) || !SJvddk.dli.isExtendedLibrary()) {
+            return jDiskLibConst.VIX_E_NOT_SUPPORTED;
+        }
+        try (ProgressChannel channel = new ProgressChannel(progress)) {
+            return SJvddk.dli.copyDisk(src, dst, startSector, endSector,
+                    CoreGlobalSettings.getCopyDiskChunkSectors(), CoreGlobalSettings.getCopyDiskDepth(),
+                    allocatedOnly, progress, stats);
+        }
+    }
+
+    /**
+     * Build the file catalog of the guest filesystem of an open disk, reading
+     * only the filesystem metadata.
+     *
+     * @see com.vmware.jvix.jDiskLib#buildCatalog
+     * @param catalog one entry, set to the catalog on VIX_OK
+     * @param stats   jDiskLibConst.CATALOG_STATS_SIZE entries
+     * @return VIX_OK, jDiskLibConst.VIX_E_NOT_SUPPORTED if the library is not
+     *         available or the filesystem is not supported
+     */
+    public static long buildCatalog(final DiskHandle diskHandle, final byte[][] catalog, final long[] stats) {
+        if ((SJvddk.dli == null) || !SJvddk.dli.isExtendedLibrary()) {
+            return jDiskLibConst.VIX_E_NOT_SUPPORTED;
+        }
+        return SJvddk.dli.buildCatalog(diskHandle, -1, 0, catalog, stats);
+    }
+
+    /**
+     * Open the guest filesystem of a disk generation straight from its archived
+     * blocks.
+     *
+     * @see com.vmware.jvix.jDiskLib#guestFsOpen
+     * @return VIX_OK, jDiskLibConst.VIX_E_NOT_SUPPORTED if the reader is not
+     *         available or the filesystem is not supported
+     */
+    public static long guestFsOpen(final String[] paths, final long[] extents, final int[] params, final byte[] key,
+            final long capacity, final int partition, final long[] handle) {
+        if ((SJvddk.dli == null) || !SJvddk.dli.isExtendedLibrary()) {
+            return jDiskLibConst.VIX_E_NOT_SUPPORTED;
+        }
+        return SJvddk.dli.guestFsOpen(paths, extents, params, key, capacity, partition,
+                CoreGlobalSettings.getGuestFsCacheSizeMb() * 1024L * 1024L, handle);
+    }
+
+    public static long guestFsLookup(final long handle, final String path, final GuestFsEntry entry) {
+        return SJvddk.dli.guestFsLookup(handle, path, entry);
+    }
+
+    public static long guestFsList(final long handle, final long inode, final List<GuestFsEntry> entries) {
+        return SJvddk.dli.guestFsList(handle, inode, entries);
+    }
+
+    public static long guestFsRead(final long handle, final long inode, final long offset, final byte[] buf,
+            final int length) {
+        return SJvddk.dli.guestFsRead(handle, inode, offset, buf, length);
+    }
+
+    public static void guestFsClose(final long handle) {
+        SJvddk.dli.guestFsClose(handle);
+    }
+
+    /**
+     * Serve a disk generation over NBD straight from its archived blocks, with
+     * the cache, readahead and overlay of the nbd* settings.
+     *
+     * @see com.vmware.jvix.jDiskLib#nbdStart
+     * @return VIX_OK, jDiskLibConst.VIX_E_NOT_SUPPORTED if the server is not
+     *         available
+     */
+    public static long nbdStart(final String[] paths, final long[] extents, final int[] params, final byte[] key,
+            final long capacity, final String name, final String address, final int port, final long[] handle) {
+        if ((SJvddk.dli == null) || !SJvddk.dli.isExtendedLibrary()) {
+            return jDiskLibConst.VIX_E_NOT_SUPPORTED;
+        }
+        final long readahead = CoreGlobalSettings.getNbdReadaheadMb() * 1024L * 1024L;
+        return SJvddk.dli.nbdStart(paths, extents, params, key, capacity,
+                CoreGlobalSettings.getNbdCacheSizeMb() * 1024L * 1024L, name, address, port,
+                (readahead > 0) ? readahead : -1, CoreGlobalSettings.getNbdOverlayLimitMb() * 1024L * 1024L,
+                handle);
+    }
+
+    public static long nbdGetStats(final long handle, final long[] stats) {
+        return SJvddk.dli.nbdGetStats(handle, stats);
+    }
+
+    public static void nbdStop(final long handle) {
+        SJvddk.dli.nbdStop(handle);
+    }
+
+    /**
+     * Register a job with the native I/O scheduler.
+     *
+     * @param ioClass        one of jDiskLibConst.IO_CLASS_*
+     * @param deadlineMillis deadline from now, 0 for none
+     * @return the job id, 0 if the scheduler is not in use
+     */
+    public static long registerIoJob(final int ioClass, final long deadlineMillis) {
+        if ((SJvddk.dli == null) || !SJvddk.dli.isExtendedLibrary() || !CoreGlobalSettings.isIoSchedulerEnabled()) {
+            return 0;
+        }
+        final long ioJob = ioJobCounter.incrementAndGet();
+        if (SJvddk.dli.registerIoJob(ioJob, ioClass, deadlineMillis) != jDiskLibConst.VIX_OK) {
+            return 0;
+        }
+        return ioJob;
+    }
+
+    public static void unregisterIoJob(final long ioJob) {
+        if (ioJob != 0) {
+            SJvddk.dli.unregisterIoJob(ioJob);
+        }
+    }
+
+    /**
+     * VDDK read, through the I/O scheduler when ioJob is not 0
+     */
+    public static long read(final long ioJob, final DiskHandle diskHandle, final long startSector,
+            final long numSectors, final byte[] buffer) {
+        if (ioJob != 0) {
+            return SJvddk.dli.scheduledRead(ioJob, diskHandle, startSector, numSectors, buffer);
+        }
+        return SJvddk.dli.read(diskHandle, startSector, numSectors, buffer);
+    }
+
+    /**
+     * VDDK write, through the I/O scheduler when ioJob is not 0
+     */
+    public static long write(final long ioJob, final DiskHandle diskHandle, final long startSector,
+            final long numSectors, final byte[] buffer) {
+        if (ioJob != 0) {
+            return SJvddk.dli.scheduledWrite(ioJob, diskHandle, startSector, numSectors, buffer);
+        }
+        return SJvddk.dli.write(diskHandle, startSector, numSectors, buffer);
+    }
+
     public static boolean isInitialized() {
         if (SJvddk.logger.isLoggable(Level.CONFIG)) {
             SJvddk.logger.config("<no args> - start"); //$NON-NLS-1$
@@ -76,16 +76,23 @@ class VirtualBackupThread extends AbstractBlockThread implements IRestoreThread
 
     private boolean cloneDump(final ExBlockInfo blockInfoOut, final TargetBuffer buffer) {
         boolean result = false;
+        boolean locked = false;
         try {
-            BlockLocker.lockBlock(blockInfoOut);
-            result = this.target.dedupDump(blockInfoOut);
+            result = this.target.referenceDump(blockInfoOut);
+            if (!result) {
+                BlockLocker.lockBlock(blockInfoOut);
+                locked = true;
+                result = this.target.dedupDump(blockInfoOut);
+            }
         } catch (final InterruptedException e) {
             blockInfoOut.setReason(getEntity(), e);
             this.logger.log(Level.WARNING, "Interrupted!", e);
             // Restore interrupted state...
             Thread.currentThread().interrupt();
         } finally {
-            BlockLocker.releaseBlock(blockInfoOut);
+            if (locked) {
+                BlockLocker.releaseBlock(blockInfoOut);
+            }
             blockInfoOut.setFailed(!result);
             this.radr.addDumpInfo(blockInfoOut.getIndex(), blockInfoOut);
             reportResult(blockInfoOut, result);
@@ -133,7 +140,7 @@ class VirtualBackupThread extends AbstractBlockThread implements IRestoreThread
             if (this.blockInfo.isModified()) {
                 try {
                     result = (this.target.openGetDump(this.blockInfo, buffer)
-                            && computeOpenGetDump(this.blockInfo, buffer, false)
+                            && computeOpenGetDump(this.blockInfo, buffer)
                             && this.target.closeGetDump(this.blockInfo, bufferIndex)
                             && calculateSha1(this.blockInfo, buffer));
                     if (result) {
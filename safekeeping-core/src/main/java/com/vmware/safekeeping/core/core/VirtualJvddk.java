@@ -26,6 +26,7 @@
  ******************************************************************************/
 package com.vmware.safekeeping.core.core;
 
+import java.io.IOException;
 import java.security.NoSuchAlgorithmException;
 import java.util.ArrayList;
 import java.util.List;
@@ -33,6 +34,7 @@ import java.util.logging.Level;
 import java.util.logging.Logger;
 
 import com.vmware.jvix.JVixException;
+import com.vmware.safekeeping.common.Utility;
 import com.vmware.safekeeping.core.command.interactive.AbstractVirtualBackupDiskInteractive;
 import com.vmware.safekeeping.core.command.options.CoreBackupRestoreCommonOptions;
 import com.vmware.safekeeping.core.command.results.CoreResultActionDiskVirtualBackup;
@@ -141,11 +143,24 @@ public class VirtualJvddk implements IJvddkBasic {
 				finalReport.append('\n');
 				buffers.start();
 				TotalBlocksInfo totalDumpInfo;
+				String lease = null;
 				try {
+					// no generation is removed until the references of the disk are flushed
+					lease = target.acquireDumpLease();
 					totalDumpInfo = restoreAndConsolidateThreads(radc, interactive, futureThreads);
 					// wait for subtask to finish
 					buffers.waitSubTasks();
+					if (!target.flushPacks() && radc.isRunning()) {
+						radc.failure(String.format("Dump disk:%d packfile write failed", radc.getDiskId()));
+					}
+					if (!target.flushDedupReferences() && radc.isRunning()) {
+						radc.failure(
+								String.format("Dump disk:%d dedup reference log write failed", radc.getDiskId()));
+					}
 				} finally {
+					if (lease != null) {
+						target.releaseDumpLease(lease);
+					}
 					buffers.stop();
 				}
 				for (final IRestoreThread s : futureThreads) {
@@ -169,6 +184,9 @@ public class VirtualJvddk implements IJvddkBasic {
 				this.logger.info(msg);
 				radc.skip(msg);
 			}
+		} catch (final IOException e) {
+			Utility.logWarning(this.logger, e);
+			radc.failure(e);
 		} catch (final NoSuchAlgorithmException e) {
 			this.logger.severe(
 					"List<RestoreBlock>, CoreResultActionDiskConsolidate, TargetOperation, AbstractRestoreInteractive - exception: " //$NON-NLS-1$
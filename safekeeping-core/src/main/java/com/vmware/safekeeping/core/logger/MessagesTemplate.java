@@ -105,7 +105,7 @@ public final class MessagesTemplate {
         if (logger.isLoggable(Level.CONFIG)) {
             logger.config("CoreAbstractResultDiskBackupRestore radr=" + radr + " - start"); //$NON-NLS-1$ //$NON-NLS-2$
         }
-        final String transport;
+        String transport;
         if (StringUtils.isNotBlank(radr.getUsedTransportModes())) {
             transport = "[trnsprt "
                     + radr.getUsedTransportModes().concat((StringUtils.isEmpty(radr.getRequestedTransportModes())) ? ""
@@ -116,7 +116,12 @@ public final class MessagesTemplate {
         }
         int numDisk = 1;
         if (radr.getParent() instanceof AbstractCoreResultActionBackupForEntityWithDisks) {
-            numDisk = ((AbstractCoreResultActionBackupForEntityWithDisks) radr.getParent()).getNumberOfDisk();
+            final AbstractCoreResultActionBackupForEntityWithDisks rab = (AbstractCoreResultActionBackupForEntityWithDisks) radr
+                    .getParent();
+            numDisk = rab.getNumberOfDisk();
+            if (StringUtils.isNotBlank(rab.getTransportProbeReport())) {
+                transport = transport.concat("[probe " + rab.getTransportProbeReport() + " ]");
+            }
         } else {
             if (radr.getParent() instanceof AbstractCoreResultActionRestoreForEntityWithDisks) {
                 numDisk = ((AbstractCoreResultActionRestoreForEntityWithDisks) radr.getParent()).getNumberOfDisk();
@@ -128,7 +128,7 @@ public class BasicBlockInfo extends SimpleBlockInfo {
         this.generationId = generationId;
         this.fileIndex = block.getIndex();
         this.cipher = cipher;
-        this.compress = compress;
+        this.compress = (block.getCompressed() != null) ? block.getCompressed() : compress;
         this.diskId = diskId;
 
     }
@@ -38,6 +38,7 @@ import java.util.logging.Logger;
 import org.apache.commons.codec.binary.Base64;
 import org.apache.commons.lang.StringUtils;
 
+import com.vmware.jvix.jDiskLibConst;
 import com.vmware.safekeeping.common.GuestOsUtils;
 import com.vmware.safekeeping.common.Utility;
 import com.vmware.safekeeping.core.control.MessageDigestAlgoritmhs;
@@ -56,6 +57,7 @@ public class CoreGlobalSettings {
     private static final String FCO_PROFILE_FILE_NAME = "profile.json";
     private static final String CONFIG_PROPERTIES_FILENAME = "config.properties";
     public static final String GENERATION_PROFILE_FILENAME = "generation.json";
+    public static final String FILE_CATALOG_SUFFIX = ".catalog";
 
     protected static final String ACCEPT_UNTRUSTED_CERTIFICATE = "acceptUntrustedCertificate";
 
@@ -155,6 +157,202 @@ public class CoreGlobalSettings {
     private static final String MAX_POST_DUMP_RETRIES = "maxPostDumpRetries";
     private static final String MAX_VDDK_READ_RETRIES = "maxVddkReadRetries";
     private static final Integer DEFAULT_MAX_VDDK_READ_RETRIES = 5;
+    /**
+     * Bounds of the adaptive in-flight window for async VDDK reads
+     */
+    private static final String ASYNC_QUEUE_DEPTH_MIN = "asyncQueueDepthMin";
+    private static final Integer DEFAULT_ASYNC_QUEUE_DEPTH_MIN = jDiskLibConst.ASYNC_QUEUE_DEFAULT_MIN_DEPTH;
+    private static final String ASYNC_QUEUE_DEPTH_MAX = "asyncQueueDepthMax";
+    private static final Integer DEFAULT_ASYNC_QUEUE_DEPTH_MAX = jDiskLibConst.ASYNC_QUEUE_DEFAULT_MAX_DEPTH;
+    /**
+     * Bandwidth limits in MB/s of the VDDK I/O, 0 is unlimited. Host,
+     * datastore and disk values are the default limit of every bucket of that
+     * scope
+     */
+    private static final String THROTTLE_GLOBAL_MBPS = "throttleGlobalMBps";
+    private static final String THROTTLE_HOST_MBPS = "throttleHostMBps";
+    private static final String THROTTLE_DATASTORE_MBPS = "throttleDatastoreMBps";
+    private static final String THROTTLE_DISK_MBPS = "throttleDiskMBps";
+    private static final Integer DEFAULT_THROTTLE_MBPS = 0;
+    /**
+     * Native I/O scheduler shared by the concurrent backup and restore jobs.
+     * Restores are served before backups
+     */
+    private static final String IO_SCHEDULER_ENABLED = "ioSchedulerEnabled";
+    private static final Boolean DEFAULT_IO_SCHEDULER_ENABLED = false;
+    private static final String IO_SCHEDULER_STRICT = "ioSchedulerStrict";
+    private static final Boolean DEFAULT_IO_SCHEDULER_STRICT = false;
+    private static final String IO_SCHEDULER_MAX_IN_FLIGHT = "ioSchedulerMaxInFlight";
+    private static final Integer DEFAULT_IO_SCHEDULER_MAX_IN_FLIGHT = jDiskLibConst.IO_SCHEDULER_DEFAULT_MAX_IN_FLIGHT;
+    /**
+     * Deadline of a dump or a restore job, in seconds from its start (0 for
+     * none): past it, its requests are served before those of any class
+     */
+    private static final String IO_SCHEDULER_DUMP_DEADLINE_SECONDS = "ioSchedulerDumpDeadlineSeconds";
+    private static final String IO_SCHEDULER_RESTORE_DEADLINE_SECONDS = "ioSchedulerRestoreDeadlineSeconds";
+    private static final Integer DEFAULT_IO_SCHEDULER_DEADLINE_SECONDS = 0;
+    /**
+     * Work-stealing scheduler shared by the disks of a VM or vApp backup. 0
+     * threads per disk selects the number of threads of the backup, as many
+     * blocks of a disk in flight as without the scheduler
+     */
+    private static final String DUMP_WORK_STEALING = "dumpWorkStealing";
+    private static final Boolean DEFAULT_DUMP_WORK_STEALING = true;
+    private static final String DUMP_MAX_THREADS_PER_DISK = "dumpMaxThreadsPerDisk";
+    private static final Integer DEFAULT_DUMP_MAX_THREADS_PER_DISK = 0;
+    /**
+     * Journal of the committed blocks, to resume a failed dump of the same
+     * snapshot
+     */
+    private static final String DUMP_JOURNAL = "dumpJournal";
+    private static final Boolean DEFAULT_DUMP_JOURNAL = true;
+    /**
+     * Dump the allocated blocks of a full backup while they are discovered.
+     * The dump journal needs the number of blocks up front and is not used
+     */
+    private static final String DUMP_STREAMING_DISCOVERY = "dumpStreamingDiscovery";
+    private static final Boolean DEFAULT_DUMP_STREAMING_DISCOVERY = false;
+    private static final String ALLOCATED_BLOCKS_PREFETCH = "allocatedBlocksPrefetch";
+    private static final Integer DEFAULT_ALLOCATED_BLOCKS_PREFETCH = 2;
+    /**
+     * Append block streams smaller than the threshold to shared packfiles instead
+     * of posting a data and a json object for each block
+     */
+    private static final String PACK_SMALL_BLOCKS = "packSmallBlocks";
+    private static final Boolean DEFAULT_PACK_SMALL_BLOCKS = false;
+    private static final String PACK_BLOCK_THRESHOLD = "packBlockThreshold";
+    private static final Integer DEFAULT_PACK_BLOCK_THRESHOLD = 262144;
+    private static final String PACK_MAX_SIZE = "packMaxSize";
+    private static final Integer DEFAULT_PACK_MAX_SIZE = 16777216;
+    /**
+     * Record the dedup references of a generation in batched reference logs,
+     * folded into the block json before a generation is removed, instead of
+     * updating the block json on every dedup hit
+     */
+    private static final String DEDUP_REFERENCE_LOG = "dedupReferenceLog";
+    private static final Boolean DEFAULT_DEDUP_REFERENCE_LOG = false;
+    private static final String DEDUP_REFERENCE_BATCH = "dedupReferenceBatch";
+    private static final Integer DEFAULT_DEDUP_REFERENCE_BATCH = 4096;
+    private static final String DEDUP_METADATA_CACHE_SIZE = "dedupMetadataCacheSize";
+    private static final Integer DEFAULT_DEDUP_METADATA_CACHE_SIZE = 65536;
+    /**
+     * Age after which the lease of a dump left on the target by a dead process
+     * no longer blocks the removal of generations
+     */
+    private static final String DUMP_LEASE_EXPIRY_HOURS = "dumpLeaseExpiryHours";
+    private static final Integer DEFAULT_DUMP_LEASE_EXPIRY_HOURS = 48;
+    /**
+     * Sample the entropy of each block and store it uncompressed when the
+     * predicted saving is below compressionMinSavingPercent. After
+     * compressionBackoffBlocks incompressible blocks in a row the disk stops
+     * sampling and only probes one block every compressionReprobeInterval
+     */
+    private static final String COMPRESSION_PREDICTOR = "compressionPredictor";
+    private static final Boolean DEFAULT_COMPRESSION_PREDICTOR = false;
+    private static final String COMPRESSION_MIN_SAVING_PERCENT = "compressionMinSavingPercent";
+    private static final Integer DEFAULT_COMPRESSION_MIN_SAVING_PERCENT = 5;
+    private static final String COMPRESSION_SAMPLE_SIZE = "compressionSampleSize";
+    private static final Integer DEFAULT_COMPRESSION_SAMPLE_SIZE = 16384;
+    private static final String COMPRESSION_BACKOFF_BLOCKS = "compressionBackoffBlocks";
+    private static final Integer DEFAULT_COMPRESSION_BACKOFF_BLOCKS = 8;
+    private static final String COMPRESSION_REPROBE_INTERVAL = "compressionReprobeInterval";
+    private static final Integer DEFAULT_COMPRESSION_REPROBE_INTERVAL = 64;
+    /**
+     * Threads of the native MiGz decoder used by restore, 0 to decode in Java
+     */
+    private static final String MIGZ_DECODE_THREADS = "migzDecodeThreads";
+    private static final Integer DEFAULT_MIGZ_DECODE_THREADS = 4;
+    /**
+     * Store a CRC32C per 4 KB of each dumped block in its json and in the
+     * generation profile, and check it on restore
+     */
+    private static final String CRC32C_MAP = "crc32cMap";
+    private static final Boolean DEFAULT_CRC32C_MAP = false;
+    private static final String CRC32C_VERIFY_ON_RESTORE = "crc32cVerifyOnRestore";
+    private static final Boolean DEFAULT_CRC32C_VERIFY_ON_RESTORE = false;
+    /**
+     * Compute the MD5 and SHA-1 of dumped blocks with the native multi-buffer
+     * engine, several blocks at once
+     */
+    private static final String MULTI_BUFFER_HASH = "multiBufferHash";
+    private static final Boolean DEFAULT_MULTI_BUFFER_HASH = false;
+    /**
+     * Threads of the native scrub engine used by archive check on file targets,
+     * 0 to check in Java. A shallow scrub checks the MD5 of the stored data
+     * only, a deep one also decodes each block and checks its SHA-1
+     */
+    private static final String SCRUB_THREADS = "scrubThreads";
+    private static final Integer DEFAULT_SCRUB_THREADS = 0;
+    private static final String SCRUB_SHALLOW = "scrubShallow";
+    private static final Boolean DEFAULT_SCRUB_SHALLOW = false;
+    /**
+     * Disk to disk copies by the native copy engine: reads and writes kept in
+     * flight, and sectors per request (0 for the native defaults)
+     */
+    private static final String COPY_DISK_DEPTH = "copyDiskDepth";
+    private static final Integer DEFAULT_COPY_DISK_DEPTH = 8;
+    private static final String COPY_DISK_CHUNK_SECTORS = "copyDiskChunkSectors";
+    private static final Integer DEFAULT_COPY_DISK_CHUNK_SECTORS = 2048;
+    /**
+     * Decoded archived blocks kept in memory by the guest filesystem reader of
+     * file-level restore
+     */
+    private static final String GUEST_FS_CACHE_SIZE_MB = "guestFsCacheSizeMb";
+    private static final Integer DEFAULT_GUEST_FS_CACHE_SIZE_MB = 64;
+    /**
+     * Catalog of the files of each ext2/3/4 disk built at the end of its dump
+     * from the filesystem metadata, so files can be searched across
+     * generations without opening any disk
+     */
+    private static final String FILE_CATALOG = "fileCatalog";
+    private static final Boolean DEFAULT_FILE_CATALOG = false;
+    /**
+     * NBD server exposing a generation as a block device: decoded block cache,
+     * readahead after sequential reads, memory held by the written pages (0
+     * exports read-only), and TCP port of archive -export
+     */
+    private static final String NBD_CACHE_SIZE_MB = "nbdCacheSizeMb";
+    private static final Integer DEFAULT_NBD_CACHE_SIZE_MB = 256;
+    private static final String NBD_READAHEAD_MB = "nbdReadaheadMb";
+    private static final Integer DEFAULT_NBD_READAHEAD_MB = 8;
+    private static final String NBD_OVERLAY_LIMIT_MB = "nbdOverlayLimitMb";
+    private static final Integer DEFAULT_NBD_OVERLAY_LIMIT_MB = 1024;
+    private static final String NBD_PORT = "nbdPort";
+    private static final Integer DEFAULT_NBD_PORT = 10809;
+    /**
+     * Native cache of VDDK connections: a connection released is kept idle for
+     * the next connect to the same snapshot (0 disables the cache) unless older
+     * than the session ticket lifetime, and read-only disk handles closed are
+     * kept open while their connection is in use
+     */
+    private static final String CONNECTION_CACHE_IDLE_SECONDS = "connectionCacheIdleSeconds";
+    private static final Integer DEFAULT_CONNECTION_CACHE_IDLE_SECONDS = 60;
+    private static final String CONNECTION_CACHE_MAX_AGE_SECONDS = "connectionCacheMaxAgeSeconds";
+    private static final Integer DEFAULT_CONNECTION_CACHE_MAX_AGE_SECONDS = 1800;
+    private static final String CONNECTION_CACHE_MAX_IDLE_HANDLES = "connectionCacheMaxIdleHandles";
+    private static final Integer DEFAULT_CONNECTION_CACHE_MAX_IDLE_HANDLES = 32;
+    /**
+     * jdiskd daemon serving the read-only VDDK connections out of process
+     * (empty socket path keeps them in the JVM), with the number and size of
+     * the shared memory slots the disk data moves through
+     */
+    private static final String VDDK_DAEMON_SOCKET = "vddkDaemonSocket";
+    private static final String DEFAULT_VDDK_DAEMON_SOCKET = "";
+    private static final String VDDK_DAEMON_SLOTS = "vddkDaemonSlots";
+    private static final Integer DEFAULT_VDDK_DAEMON_SLOTS = 16;
+    private static final String VDDK_DAEMON_SLOT_SIZE_MB = "vddkDaemonSlotSizeMb";
+    private static final Integer DEFAULT_VDDK_DAEMON_SLOT_SIZE_MB = 4;
+    /**
+     * Transport modes of a backup ordered by timed reads through each mode
+     * before connecting, the modes that fail or fall back dropped, and the
+     * result kept for the same host, datastore and modes
+     */
+    private static final String TRANSPORT_PROBE = "transportProbe";
+    private static final Boolean DEFAULT_TRANSPORT_PROBE = false;
+    private static final String TRANSPORT_PROBE_MB = "transportProbeMb";
+    private static final Integer DEFAULT_TRANSPORT_PROBE_MB = 64;
+    private static final String TRANSPORT_PROBE_CACHE_SECONDS = "transportProbeCacheSeconds";
+    private static final Integer DEFAULT_TRANSPORT_PROBE_CACHE_SECONDS = 3600;
     private static final String OVERWRITE_VDDK_ON_START = "overwriteVddkOnStart";
     private static final Boolean DEFAULT_OVERWRITE_VDDK_ON_START = true;
     private static final String DELETE_VDDK_ON_EXIT = "deleteVddkOnExit";
@@ -371,6 +569,11 @@ public class CoreGlobalSettings {
         return GLOBAL_PROFILE_FILE_NAME;
     }
 
+    public static int getGuestFsCacheSizeMb() {
+        return configurationMap.getIntegerProperty(globalGroup, GUEST_FS_CACHE_SIZE_MB,
+                DEFAULT_GUEST_FS_CACHE_SIZE_MB);
+    }
+
     public static String getInstallPath() {
         final File f = new File(new File(new File(new File(".").getAbsolutePath()).getParent()).getParent());
         final String installPath = f.getPath();
@@ -443,6 +646,103 @@ public class CoreGlobalSettings {
         }
     }
 
+    public static int getAllocatedBlocksPrefetch() {
+        return configurationMap.getIntegerProperty(globalGroup, ALLOCATED_BLOCKS_PREFETCH,
+                DEFAULT_ALLOCATED_BLOCKS_PREFETCH);
+    }
+
+    /**
+     * @return upper bound of the in-flight window of async reads on a disk
+     */
+    public static int getAsyncQueueDepthMax() {
+        return configurationMap.getIntegerProperty(globalGroup, ASYNC_QUEUE_DEPTH_MAX, DEFAULT_ASYNC_QUEUE_DEPTH_MAX);
+    }
+
+    /**
+     * @return lower bound of the in-flight window of async reads on a disk
+     */
+    public static int getAsyncQueueDepthMin() {
+        return configurationMap.getIntegerProperty(globalGroup, ASYNC_QUEUE_DEPTH_MIN, DEFAULT_ASYNC_QUEUE_DEPTH_MIN);
+    }
+
+    public static int getCompressionBackoffBlocks() {
+        return configurationMap.getIntegerProperty(globalGroup, COMPRESSION_BACKOFF_BLOCKS,
+                DEFAULT_COMPRESSION_BACKOFF_BLOCKS);
+    }
+
+    public static int getCompressionMinSavingPercent() {
+        return configurationMap.getIntegerProperty(globalGroup, COMPRESSION_MIN_SAVING_PERCENT,
+                DEFAULT_COMPRESSION_MIN_SAVING_PERCENT);
+    }
+
+    public static int getCompressionReprobeInterval() {
+        return configurationMap.getIntegerProperty(globalGroup, COMPRESSION_REPROBE_INTERVAL,
+                DEFAULT_COMPRESSION_REPROBE_INTERVAL);
+    }
+
+    public static int getCompressionSampleSize() {
+        return configurationMap.getIntegerProperty(globalGroup, COMPRESSION_SAMPLE_SIZE,
+                DEFAULT_COMPRESSION_SAMPLE_SIZE);
+    }
+
+    public static int getConnectionCacheIdleSeconds() {
+        return configurationMap.getIntegerProperty(globalGroup, CONNECTION_CACHE_IDLE_SECONDS,
+                DEFAULT_CONNECTION_CACHE_IDLE_SECONDS);
+    }
+
+    public static int getConnectionCacheMaxAgeSeconds() {
+        return configurationMap.getIntegerProperty(globalGroup, CONNECTION_CACHE_MAX_AGE_SECONDS,
+                DEFAULT_CONNECTION_CACHE_MAX_AGE_SECONDS);
+    }
+
+    public static int getConnectionCacheMaxIdleHandles() {
+        return configurationMap.getIntegerProperty(globalGroup, CONNECTION_CACHE_MAX_IDLE_HANDLES,
+                DEFAULT_CONNECTION_CACHE_MAX_IDLE_HANDLES);
+    }
+
+    public static int getCopyDiskChunkSectors() {
+        return configurationMap.getIntegerProperty(globalGroup, COPY_DISK_CHUNK_SECTORS,
+                DEFAULT_COPY_DISK_CHUNK_SECTORS);
+    }
+
+    public static int getCopyDiskDepth() {
+        return configurationMap.getIntegerProperty(globalGroup, COPY_DISK_DEPTH, DEFAULT_COPY_DISK_DEPTH);
+    }
+
+    public static int getDedupMetadataCacheSize() {
+        return configurationMap.getIntegerProperty(globalGroup, DEDUP_METADATA_CACHE_SIZE,
+                DEFAULT_DEDUP_METADATA_CACHE_SIZE);
+    }
+
+    public static int getDedupReferenceBatch() {
+        return configurationMap.getIntegerProperty(globalGroup, DEDUP_REFERENCE_BATCH, DEFAULT_DEDUP_REFERENCE_BATCH);
+    }
+
+    public static int getDumpLeaseExpiryHours() {
+        return configurationMap.getIntegerProperty(globalGroup, DUMP_LEASE_EXPIRY_HOURS,
+                DEFAULT_DUMP_LEASE_EXPIRY_HOURS);
+    }
+
+    public static int getDumpMaxThreadsPerDisk() {
+        return configurationMap.getIntegerProperty(globalGroup, DUMP_MAX_THREADS_PER_DISK,
+                DEFAULT_DUMP_MAX_THREADS_PER_DISK);
+    }
+
+    public static int getIoSchedulerDumpDeadlineSeconds() {
+        return configurationMap.getIntegerProperty(globalGroup, IO_SCHEDULER_DUMP_DEADLINE_SECONDS,
+                DEFAULT_IO_SCHEDULER_DEADLINE_SECONDS);
+    }
+
+    public static int getIoSchedulerMaxInFlight() {
+        return configurationMap.getIntegerProperty(globalGroup, IO_SCHEDULER_MAX_IN_FLIGHT,
+                DEFAULT_IO_SCHEDULER_MAX_IN_FLIGHT);
+    }
+
+    public static int getIoSchedulerRestoreDeadlineSeconds() {
+        return configurationMap.getIntegerProperty(globalGroup, IO_SCHEDULER_RESTORE_DEADLINE_SECONDS,
+                DEFAULT_IO_SCHEDULER_DEADLINE_SECONDS);
+    }
+
     /**
      * @return
      */
@@ -482,6 +782,34 @@ public class CoreGlobalSettings {
         return res;
     }
 
+    public static int getMiGzDecodeThreads() {
+        return configurationMap.getIntegerProperty(globalGroup, MIGZ_DECODE_THREADS, DEFAULT_MIGZ_DECODE_THREADS);
+    }
+
+    public static int getNbdCacheSizeMb() {
+        return configurationMap.getIntegerProperty(globalGroup, NBD_CACHE_SIZE_MB, DEFAULT_NBD_CACHE_SIZE_MB);
+    }
+
+    public static int getNbdOverlayLimitMb() {
+        return configurationMap.getIntegerProperty(globalGroup, NBD_OVERLAY_LIMIT_MB, DEFAULT_NBD_OVERLAY_LIMIT_MB);
+    }
+
+    public static int getNbdPort() {
+        return configurationMap.getIntegerProperty(globalGroup, NBD_PORT, DEFAULT_NBD_PORT);
+    }
+
+    public static int getNbdReadaheadMb() {
+        return configurationMap.getIntegerProperty(globalGroup, NBD_READAHEAD_MB, DEFAULT_NBD_READAHEAD_MB);
+    }
+
+    public static int getPackBlockThreshold() {
+        return configurationMap.getIntegerProperty(globalGroup, PACK_BLOCK_THRESHOLD, DEFAULT_PACK_BLOCK_THRESHOLD);
+    }
+
+    public static int getPackMaxSize() {
+        return configurationMap.getIntegerProperty(globalGroup, PACK_MAX_SIZE, DEFAULT_PACK_MAX_SIZE);
+    }
+
     public static Integer getQuisceTimeout() {
         return configurationMap.getIntegerProperty(globalGroup, QUISCE_TIMEOUT, DEFAULT_VALUE_QUISCE_TIMEOUT);
     }
@@ -495,6 +823,10 @@ public class CoreGlobalSettings {
                 DEFAULT_VALUE_VM_RESOURCE_POOL_FILTER);
     }
 
+    public static int getScrubThreads() {
+        return configurationMap.getIntegerProperty(globalGroup, SCRUB_THREADS, DEFAULT_SCRUB_THREADS);
+    }
+
     public static Boolean getTargetCustomValueAsBool(final String pstrSection, final String key) {
 
         Boolean result = configurationMap.getBooleanProperty(pstrSection, key);
@@ -539,6 +871,22 @@ public class CoreGlobalSettings {
                 DEFAULT_VALUE_TASK_MAX_WAIT_SECONDS);
     }
 
+    public static int getThrottleDatastoreMBps() {
+        return configurationMap.getIntegerProperty(globalGroup, THROTTLE_DATASTORE_MBPS, DEFAULT_THROTTLE_MBPS);
+    }
+
+    public static int getThrottleDiskMBps() {
+        return configurationMap.getIntegerProperty(globalGroup, THROTTLE_DISK_MBPS, DEFAULT_THROTTLE_MBPS);
+    }
+
+    public static int getThrottleGlobalMBps() {
+        return configurationMap.getIntegerProperty(globalGroup, THROTTLE_GLOBAL_MBPS, DEFAULT_THROTTLE_MBPS);
+    }
+
+    public static int getThrottleHostMBps() {
+        return configurationMap.getIntegerProperty(globalGroup, THROTTLE_HOST_MBPS, DEFAULT_THROTTLE_MBPS);
+    }
+
     public static long getTicketLifeExpectancyInMilliSeconds() {
         Long result = configurationMap.getLongProperty(globalGroup, SSO_TICKET_LIFE_EXPECTANCY_IN_SECONDS,
                 DEFAULT_VALUE_TICKET_LIFE_EXPECTANCY_IN_SECONDS);
@@ -546,12 +894,34 @@ public class CoreGlobalSettings {
         return result;
     }
 
+    public static int getTransportProbeCacheSeconds() {
+        return configurationMap.getIntegerProperty(globalGroup, TRANSPORT_PROBE_CACHE_SECONDS,
+                DEFAULT_TRANSPORT_PROBE_CACHE_SECONDS);
+    }
+
+    public static int getTransportProbeMb() {
+        return configurationMap.getIntegerProperty(globalGroup, TRANSPORT_PROBE_MB, DEFAULT_TRANSPORT_PROBE_MB);
+    }
+
     public static String getVddkConfig() {
         return getConfigPath() + File.separatorChar
                 + configurationMap.getStringProperty(globalGroup, VDDK_CONFIG, DEFAULT_VALUE_VDDK_CONFIG);
 
     }
 
+    public static int getVddkDaemonSlots() {
+        return configurationMap.getIntegerProperty(globalGroup, VDDK_DAEMON_SLOTS, DEFAULT_VDDK_DAEMON_SLOTS);
+    }
+
+    public static int getVddkDaemonSlotSizeMb() {
+        return configurationMap.getIntegerProperty(globalGroup, VDDK_DAEMON_SLOT_SIZE_MB,
+                DEFAULT_VDDK_DAEMON_SLOT_SIZE_MB);
+    }
+
+    public static String getVddkDaemonSocket() {
+        return configurationMap.getStringProperty(globalGroup, VDDK_DAEMON_SOCKET, DEFAULT_VDDK_DAEMON_SOCKET);
+    }
+
     public static String getVddkLibPath() {
         return configurationMap.getStringProperty(globalGroup, VDDK_LIB_PATH,
                 getInstallPath() + File.separatorChar + ((GuestOsUtils.isWindows()) ? "bin" : "lib"));
@@ -601,6 +971,36 @@ public class CoreGlobalSettings {
         return configurationMap.getBooleanProperty(globalGroup, ENABLE_COMPRESSION, DEFAULT_VALUE_ENABLE_COMPRESSION);
     }
 
+    public static boolean isCompressionPredictor() {
+        return configurationMap.getBooleanProperty(globalGroup, COMPRESSION_PREDICTOR, DEFAULT_COMPRESSION_PREDICTOR);
+    }
+
+    public static boolean isCrc32cMap() {
+        return configurationMap.getBooleanProperty(globalGroup, CRC32C_MAP, DEFAULT_CRC32C_MAP);
+    }
+
+    public static boolean isCrc32cVerifyOnRestore() {
+        return configurationMap.getBooleanProperty(globalGroup, CRC32C_VERIFY_ON_RESTORE,
+                DEFAULT_CRC32C_VERIFY_ON_RESTORE);
+    }
+
+    public static boolean isDedupReferenceLog() {
+        return configurationMap.getBooleanProperty(globalGroup, DEDUP_REFERENCE_LOG, DEFAULT_DEDUP_REFERENCE_LOG);
+    }
+
+    public static boolean isDumpJournalEnabled() {
+        return configurationMap.getBooleanProperty(globalGroup, DUMP_JOURNAL, DEFAULT_DUMP_JOURNAL);
+    }
+
+    public static boolean isDumpStreamingDiscovery() {
+        return configurationMap.getBooleanProperty(globalGroup, DUMP_STREAMING_DISCOVERY,
+                DEFAULT_DUMP_STREAMING_DISCOVERY);
+    }
+
+    public static boolean isDumpWorkStealing() {
+        return configurationMap.getBooleanProperty(globalGroup, DUMP_WORK_STEALING, DEFAULT_DUMP_WORK_STEALING);
+    }
+
     public static boolean isEmptyConfig() {
         return emptyConfig;
     }
@@ -610,11 +1010,39 @@ public class CoreGlobalSettings {
 
     }
 
+    public static boolean isIoSchedulerEnabled() {
+        return configurationMap.getBooleanProperty(globalGroup, IO_SCHEDULER_ENABLED, DEFAULT_IO_SCHEDULER_ENABLED);
+    }
+
+    public static boolean isIoSchedulerStrict() {
+        return configurationMap.getBooleanProperty(globalGroup, IO_SCHEDULER_STRICT, DEFAULT_IO_SCHEDULER_STRICT);
+    }
+
+    public static boolean isFileCatalog() {
+        return configurationMap.getBooleanProperty(globalGroup, FILE_CATALOG, DEFAULT_FILE_CATALOG);
+    }
+
     public static boolean isForceSnapBeforeRestore() {
         return configurationMap.getBooleanProperty(globalGroup, FORCE_SNAPSHOT_BEFORE_RESTORE,
                 DEFAULT_VALUE_FORCE_SNAPSHOT_BEFORE_RESTORE);
     }
 
+    public static boolean isMultiBufferHash() {
+        return configurationMap.getBooleanProperty(globalGroup, MULTI_BUFFER_HASH, DEFAULT_MULTI_BUFFER_HASH);
+    }
+
+    public static boolean isPackSmallBlocks() {
+        return configurationMap.getBooleanProperty(globalGroup, PACK_SMALL_BLOCKS, DEFAULT_PACK_SMALL_BLOCKS);
+    }
+
+    public static boolean isScrubShallow() {
+        return configurationMap.getBooleanProperty(globalGroup, SCRUB_SHALLOW, DEFAULT_SCRUB_SHALLOW);
+    }
+
+    public static boolean isTransportProbe() {
+        return configurationMap.getBooleanProperty(globalGroup, TRANSPORT_PROBE, DEFAULT_TRANSPORT_PROBE);
+    }
+
     /**
      * @return
      */
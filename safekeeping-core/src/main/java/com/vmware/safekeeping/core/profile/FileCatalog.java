@@ -0,0 +1,356 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.profile;
+
+import java.io.IOException;
+import java.io.Serializable;
+import java.nio.charset.StandardCharsets;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+
+import com.vmware.safekeeping.core.control.target.ITargetOperation;
+import com.vmware.safekeeping.core.type.ManagedFcoEntityInfo;
+
+/**
+ * File catalog of a disk of a generation, built at backup time by the native
+ * library from the metadata of the guest filesystem.
+ *
+ * The records are sorted by path and front coded, with a restart point every
+ * RESTART_INTERVAL records holding a full path (see jCatalog.h for the layout).
+ * A lookup binary searches the restart points and decodes at most
+ * RESTART_INTERVAL records, so a path is found in every generation of a disk
+ * without opening any disk.
+ */
+public final class FileCatalog {
+
+    public static final class Entry implements Serializable {
+        private static final long serialVersionUID = 5170390546614853069L;
+        private final String path;
+        private final int type;
+        private final int mode;
+        private final long size;
+        private final long mtime;
+        private final long[] extents;
+
+        private Entry(final String path, final int type, final int mode, final long size, final long mtime,
+                final long[] extents) {
+            this.path = path;
+            this.type = type;
+            this.mode = mode;
+            this.size = size;
+            this.mtime = mtime;
+            this.extents = extents;
+        }
+
+        /**
+         * @return for each extent of the data, its offset in the file, its offset
+         *         on the disk and its length, in bytes
+         */
+        public long[] getExtents() {
+            return this.extents;
+        }
+
+        public int getMode() {
+            return this.mode;
+        }
+
+        /**
+         * @return seconds since the epoch
+         */
+        public long getMtime() {
+            return this.mtime;
+        }
+
+        public String getPath() {
+            return this.path;
+        }
+
+        public long getSize() {
+            return this.size;
+        }
+
+        /**
+         * @return one of jDiskLibConst.GUESTFS_TYPE_*
+         */
+        public int getType() {
+            return this.type;
+        }
+
+        @Override
+        public String toString() {
+            return String.format("%s %o %d %d", this.path, this.mode, this.size, this.mtime);
+        }
+    }
+
+    /**
+     * Sequential reader of the records from a restart point
+     */
+    private final class Cursor {
+        private int pos;
+        private byte[] path;
+        private int pathLength;
+        private int record;
+
+        private Cursor(final int restart) {
+            this.pos = restartOffset(restart);
+            this.path = new byte[256];
+            this.pathLength = 0;
+            this.record = restart * RESTART_INTERVAL;
+        }
+
+        private boolean hasNext() {
+            return this.record < FileCatalog.this.records;
+        }
+
+        /**
+         * Decode the next record
+         *
+         * @param full false to skip the attributes and the extents
+         */
+        private Entry next(final boolean full) throws IOException {
+            final int shared = (int) readVarint();
+            final int suffix = (int) readVarint();
+            if ((shared > this.pathLength) || (suffix < 0) || (suffix > (FileCatalog.this.data.length - this.pos))) {
+                throw new IOException("Corrupt file catalog");
+            }
+            if ((shared + suffix) > this.path.length) {
+                this.path = Arrays.copyOf(this.path, Math.max(shared + suffix, this.path.length * 2));
+            }
+            System.arraycopy(FileCatalog.this.data, this.pos, this.path, shared, suffix);
+            this.pos += suffix;
+            this.pathLength = shared + suffix;
+            ++this.record;
+
+            final int type = (int) readVarint();
+            final int mode = (int) readVarint();
+            final long size = readVarint();
+            final long mtime = readSigned();
+            final int count = (int) readVarint();
+            if (count < 0) {
+                throw new IOException("Corrupt file catalog");
+            }
+            final long[] extents = full ? new long[3 * count] : null;
+            long fileEnd = 0;
+            long diskEnd = 0;
+            for (int i = 0; i < count; i++) {
+                final long fileOffset = fileEnd + readVarint();
+                final long diskOffset = diskEnd + readSigned();
+                final long length = readVarint();
+                if (full) {
+                    extents[3 * i] = fileOffset;
+                    extents[(3 * i) + 1] = diskOffset;
+                    extents[(3 * i) + 2] = length;
+                }
+                fileEnd = fileOffset + length;
+                diskEnd = diskOffset + length;
+            }
+            if (!full) {
+                return null;
+            }
+            return new Entry(new String(this.path, 0, this.pathLength, StandardCharsets.UTF_8), type, mode, size,
+                    mtime, extents);
+        }
+
+        private long readSigned() throws IOException {
+            final long value = readVarint();
+            return (value >>> 1) ^ -(value & 1);
+        }
+
+        private long readVarint() throws IOException {
+            long value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                if (this.pos >= FileCatalog.this.restarts) {
+                    throw new IOException("Corrupt file catalog");
+                }
+                final int b = FileCatalog.this.data[this.pos++] & 0xff;
+                value |= (long) (b & 0x7f) << shift;
+                if (b < 0x80) {
+                    return value;
+                }
+            }
+            throw new IOException("Corrupt file catalog");
+        }
+    }
+
+    private static final int MAGIC = 0x54414b53;
+    private static final int VERSION = 1;
+    private static final int HEADER_SIZE = 16;
+    private static final int RESTART_INTERVAL = 16;
+
+    /**
+     * Look for a path in the catalogs of a disk over several generations
+     *
+     * @param generations generation ids to search
+     * @return the entry of the path in each generation holding it, in the order of
+     *         generations; generations without a catalog are skipped
+     */
+    public static Map<Integer, Entry> search(final ITargetOperation target, final ManagedFcoEntityInfo fcoEntity,
+            final List<Integer> generations, final int diskId, final String path) throws IOException {
+        final Map<Integer, Entry> result = new LinkedHashMap<>();
+        for (final Integer genId : generations) {
+            final byte[] bytes = target.getFileCatalogToByteArray(fcoEntity, genId, diskId);
+            if (bytes != null) {
+                final Entry entry = new FileCatalog(bytes).lookup(path);
+                if (entry != null) {
+                    result.put(genId, entry);
+                }
+            }
+        }
+        return result;
+    }
+
+    private static int getInt(final byte[] data, final int offset) {
+        return (data[offset] & 0xff) | ((data[offset + 1] & 0xff) << 8) | ((data[offset + 2] & 0xff) << 16)
+                | ((data[offset + 3] & 0xff) << 24);
+    }
+
+    private final byte[] data;
+    private final int records;
+    private final int restartCount;
+
+    /**
+     * Offset of the restart table, the end of the records
+     */
+    private final int restarts;
+
+    public FileCatalog(final byte[] data) throws IOException {
+        if ((data.length < HEADER_SIZE) || (getInt(data, 0) != MAGIC) || (getInt(data, 4) != VERSION)) {
+            throw new IOException("Not a file catalog");
+        }
+        this.data = data;
+        this.records = getInt(data, 8);
+        this.restartCount = getInt(data, 12);
+        this.restarts = data.length - (4 * this.restartCount);
+        if ((this.records < 0) || (this.restartCount < 0) || (this.restarts < HEADER_SIZE)
+                || (this.restartCount != ((this.records + RESTART_INTERVAL) - 1) / RESTART_INTERVAL)) {
+            throw new IOException("Corrupt file catalog");
+        }
+    }
+
+    private int compare(final byte[] a, final int aLength, final byte[] b) {
+        final int length = Math.min(aLength, b.length);
+        for (int i = 0; i < length; i++) {
+            final int diff = (a[i] & 0xff) - (b[i] & 0xff);
+            if (diff != 0) {
+                return diff;
+            }
+        }
+        return aLength - b.length;
+    }
+
+    /**
+     * @return the number of files, directories and links
+     */
+    public int getRecords() {
+        return this.records;
+    }
+
+    /**
+     * List the entries under a directory, at any depth
+     *
+     * @param directory absolute path of the directory, "/" for all the entries
+     */
+    public List<Entry> list(final String directory) throws IOException {
+        final String prefix = directory.endsWith("/") ? directory : directory.concat("/");
+        final byte[] key = prefix.getBytes(StandardCharsets.UTF_8);
+        final List<Entry> result = new ArrayList<>();
+        final Cursor cursor = new Cursor(findRestart(key));
+        while (cursor.hasNext()) {
+            final int start = cursor.pos;
+            final int previousLength = cursor.pathLength;
+            cursor.next(false);
+            if (compare(cursor.path, cursor.pathLength, key) < 0) {
+                continue;
+            }
+            if ((cursor.pathLength <= key.length) || (compare(cursor.path, key.length, key) != 0)) {
+                break;
+            }
+            // decode the record again with its attributes
+            cursor.pos = start;
+            cursor.pathLength = previousLength;
+            --cursor.record;
+            result.add(cursor.next(true));
+        }
+        return result;
+    }
+
+    /**
+     * @param path absolute path in the guest filesystem
+     * @return the entry, null if the catalog has no such path
+     */
+    public Entry lookup(final String path) throws IOException {
+        final byte[] key = path.getBytes(StandardCharsets.UTF_8);
+        final Cursor cursor = new Cursor(findRestart(key));
+        for (int i = 0; (i < RESTART_INTERVAL) && cursor.hasNext(); i++) {
+            final int start = cursor.pos;
+            final int previousLength = cursor.pathLength;
+            cursor.next(false);
+            final int cmp = compare(cursor.path, cursor.pathLength, key);
+            if (cmp == 0) {
+                cursor.pos = start;
+                cursor.pathLength = previousLength;
+                --cursor.record;
+                return cursor.next(true);
+            }
+            if (cmp > 0) {
+                break;
+            }
+        }
+        return null;
+    }
+
+    /**
+     * @return the last restart point whose path is not after the key
+     */
+    private int findRestart(final byte[] key) throws IOException {
+        int lo = 0;
+        int hi = this.restartCount - 1;
+        int found = 0;
+        while (lo <= hi) {
+            final int mid = (lo + hi) >>> 1;
+            final Cursor cursor = new Cursor(mid);
+            cursor.next(false);
+            if (compare(cursor.path, cursor.pathLength, key) <= 0) {
+                found = mid;
+                lo = mid + 1;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        return found;
+    }
+
+    private int restartOffset(final int restart) {
+        if (restart >= this.restartCount) {
+            return this.restarts;
+        }
+        return getInt(this.data, this.restarts + (4 * restart));
+    }
+}
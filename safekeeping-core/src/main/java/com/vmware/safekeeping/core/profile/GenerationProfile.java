@@ -118,7 +118,12 @@ public class GenerationProfile {
     public void addDumpInfo(final Integer diskId, final ExBlockInfo exBlockInfo) {
         final DiskProfile diskProfile = this.profile.getDisks().get(diskId);
 
-        diskProfile.getDumps().put(exBlockInfo.getIndex(), exBlockInfo.toSimpleBlockInfo());
+        final SimpleBlockInfo block = exBlockInfo.toSimpleBlockInfo();
+        if (exBlockInfo.isCompress() != diskProfile.isCompression()) {
+            // stored uncompressed by the predictor or deduplicated with another setting
+            block.setCompressed(exBlockInfo.isCompress());
+        }
+        diskProfile.getDumps().put(exBlockInfo.getIndex(), block);
     }
 
     public FcoGenerationProfile clearGenerationDependency() {
@@ -289,6 +294,14 @@ public class GenerationProfile {
         return this.profile.getFcoParent();
     }
 
+    /**
+     * @param diskId
+     * @return the path of the file catalog of a disk of the generation
+     */
+    public String getFileCatalogContentPath(final int diskId) {
+        return String.format("%s/%d%s", getGenerationPath(), diskId, CoreGlobalSettings.FILE_CATALOG_SUFFIX);
+    }
+
     public ManagedEntityInfo getFolderInfo() {
         return this.profile.getFolderInfo();
     }
@@ -416,6 +429,19 @@ public class GenerationProfile {
         return this.previousGeneration;
     }
 
+    /**
+     * @param diskId
+     * @return the path of the file catalog of the disk in the previous
+     *         generation, null if there is no previous generation
+     */
+    public String getPreviousFileCatalogContentPath(final int diskId) {
+        final Integer previousId = getPreviousGenerationId();
+        if ((previousId == null) || (previousId < 0)) {
+            return null;
+        }
+        return String.format("%s/%d/%d%s", getUuid(), previousId, diskId, CoreGlobalSettings.FILE_CATALOG_SUFFIX);
+    }
+
     /**
      * @return
      */
@@ -26,6 +26,10 @@
  ******************************************************************************/
 package com.vmware.safekeeping.core.profile;
 
+import com.fasterxml.jackson.annotation.JsonIgnore;
+import com.fasterxml.jackson.annotation.JsonInclude;
+import com.fasterxml.jackson.annotation.JsonInclude.Include;
+
 public class SimpleBlockInfo {
     protected String md5;
     protected String sha1;
@@ -37,6 +41,33 @@ public class SimpleBlockInfo {
 
     protected int index;
 
+    /**
+     * Packfile holding the block stream, null when the block is stored as its own
+     * data object
+     */
+    @JsonInclude(Include.NON_NULL)
+    protected String packId;
+
+    @JsonInclude(Include.NON_DEFAULT)
+    protected long packOffset;
+
+    @JsonInclude(Include.NON_DEFAULT)
+    protected long packLength;
+
+    /**
+     * Compression of the block stream when it differs from the disk, null when
+     * the block follows the disk setting
+     */
+    @JsonInclude(Include.NON_NULL)
+    protected Boolean compressed;
+
+    /**
+     * CRC32C map of the block data (see Crc32cMap), base64 encoded, null when the
+     * dump did not compute it
+     */
+    @JsonInclude(Include.NON_NULL)
+    protected String crc32c;
+
     public SimpleBlockInfo() {
     }
 
@@ -50,12 +81,25 @@ public class SimpleBlockInfo {
         this.cipherOffset = sourceBlock.cipherOffset;
         this.md5 = sourceBlock.md5;
         this.sha1 = sourceBlock.sha1;
+        this.packId = sourceBlock.packId;
+        this.packOffset = sourceBlock.packOffset;
+        this.packLength = sourceBlock.packLength;
+        this.compressed = sourceBlock.compressed;
+        this.crc32c = sourceBlock.crc32c;
     }
 
     public byte getCipherOffset() {
         return this.cipherOffset;
     }
 
+    public Boolean getCompressed() {
+        return this.compressed;
+    }
+
+    public String getCrc32c() {
+        return this.crc32c;
+    }
+
     public int getIndex() {
         return this.index;
     }
@@ -72,14 +116,39 @@ public class SimpleBlockInfo {
         return this.offset;
     }
 
+    public String getPackId() {
+        return this.packId;
+    }
+
+    public long getPackLength() {
+        return this.packLength;
+    }
+
+    public long getPackOffset() {
+        return this.packOffset;
+    }
+
     public String getSha1() {
         return this.sha1;
     }
 
+    @JsonIgnore
+    public boolean isPacked() {
+        return this.packId != null;
+    }
+
     public void setCipherOffset(final byte cipherOffset) {
         this.cipherOffset = cipherOffset;
     }
 
+    public void setCompressed(final Boolean compressed) {
+        this.compressed = compressed;
+    }
+
+    public void setCrc32c(final String crc32c) {
+        this.crc32c = crc32c;
+    }
+
     public void setIndex(final int index) {
         this.index = index;
     }
@@ -96,6 +165,18 @@ public class SimpleBlockInfo {
         this.offset = offset;
     }
 
+    public void setPackId(final String packId) {
+        this.packId = packId;
+    }
+
+    public void setPackLength(final long packLength) {
+        this.packLength = packLength;
+    }
+
+    public void setPackOffset(final long packOffset) {
+        this.packOffset = packOffset;
+    }
+
     public void setSha1(final String sha1) {
         this.sha1 = sha1;
     }
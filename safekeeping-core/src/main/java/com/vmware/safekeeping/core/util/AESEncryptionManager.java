@@ -42,6 +42,7 @@ import javax.crypto.IllegalBlockSizeException;
 import javax.crypto.NoSuchPaddingException;
 import javax.crypto.SecretKey;
 import javax.crypto.SecretKeyFactory;
+import javax.crypto.ShortBufferException;
 import javax.crypto.spec.PBEKeySpec;
 import javax.crypto.spec.SecretKeySpec;
 
@@ -61,6 +62,8 @@ public final class AESEncryptionManager {
 
     private static Cipher aesEncrypt;
 
+    private static byte[] rawKey;
+
     /**
      *
      * @param encryptedData
@@ -74,10 +77,11 @@ public final class AESEncryptionManager {
             final byte[] bufferCipher, final byte cipherOffset) throws IllegalBlockSizeException, BadPaddingException {
 
 // Decrypt the data
-        final byte[] decryptedData = aesDecrypt.doFinal(encryptedData, inputOffset, inputLen);
-        final int len = decryptedData.length - cipherOffset;
-        System.arraycopy(decryptedData, 0, bufferCipher, 0, len);
-        return len;
+        try {
+            return aesDecrypt.doFinal(encryptedData, inputOffset, inputLen, bufferCipher, 0) - cipherOffset;
+        } catch (final ShortBufferException e) {
+            throw new IllegalBlockSizeException(e.getMessage());
+        }
     }
 
     /**
@@ -86,7 +90,7 @@ public final class AESEncryptionManager {
      * @param data         : the data that will be encrypted
      * @param inputOffset
      * @param inputLen
-     * @param bufferCipher
+     * @param bufferCipher : destination, may be data itself
      * @return Encrypted data in a byte array
      * @throws NoSuchPaddingException
      * @throws NoSuchAlgorithmException
@@ -109,9 +113,11 @@ public final class AESEncryptionManager {
         }
 
         // Encrypt the data
-        final byte[] encryptedData = aesEncrypt.doFinal(data, inputOffset, len);
-        System.arraycopy(encryptedData, 0, bufferCipher, 0, encryptedData.length);
-        return new EncryptResult(encryptedData.length, elem);
+        try {
+            return new EncryptResult(aesEncrypt.doFinal(data, inputOffset, len, bufferCipher, 0), elem);
+        } catch (final ShortBufferException e) {
+            throw new IllegalBlockSizeException(e.getMessage());
+        }
 
     }
 
@@ -132,6 +138,14 @@ public final class AESEncryptionManager {
         return new SecretKeySpec(key, "AES");
     }
 
+    /**
+     * @return a copy of the AES-128 key, for the native scrub engine, or null if
+     *         the manager is not initialized
+     */
+    public static byte[] getRawKey() {
+        return (rawKey == null) ? null : rawKey.clone();
+    }
+
     public static CipherInputStream getCipherInputStream(final InputStream stream) {
         // get the rest of encrypted data
         return new CipherInputStream(stream, aesDecrypt);
@@ -148,6 +162,7 @@ public final class AESEncryptionManager {
         // Prepare your key/password
 
         final SecretKey secretKey = generateSecretKey(key, iv);
+        rawKey = secretKey.getEncoded();
 //	final String algorithm = "RawBytes";
 //	final SecretKeySpec secretKey = new SecretKeySpec(iv, algorithm);
         // "AES/ECB/PKCS5Padding");// "AES/CBC/PKCS5Padding");
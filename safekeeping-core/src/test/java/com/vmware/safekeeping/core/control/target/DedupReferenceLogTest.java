@@ -0,0 +1,149 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.control.target;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertFalse;
+import static org.junit.Assert.assertTrue;
+
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.Set;
+import java.util.TreeSet;
+
+import org.junit.Test;
+
+public class DedupReferenceLogTest {
+
+    /**
+     * Batches written, with their generation
+     */
+    private static final class MemoryStore implements DedupReferenceLog.ReferenceStore {
+        private final List<Integer> generations = new ArrayList<>();
+        private final List<byte[]> contents = new ArrayList<>();
+        private boolean failing;
+
+        @Override
+        public synchronized void putReferences(final int generationId, final byte[] content) throws IOException {
+            if (this.failing) {
+                throw new IOException("store failure");
+            }
+            this.generations.add(generationId);
+            this.contents.add(content);
+        }
+
+        Map<String, Map<String, Set<Integer>>> decodeAll() throws IOException {
+            final Map<String, Map<String, Set<Integer>>> references = new HashMap<>();
+            for (final byte[] content : this.contents) {
+                DedupReferenceLog.decode(content, references);
+            }
+            return references;
+        }
+    }
+
+    private static final String UUID = "503f0b5e-7a68-4f6a-9a47-0c2f5d2b1e10";
+
+    private static String digest(final int number) {
+        return String.format("%040X", number);
+    }
+
+    @Test
+    public void testRoundTrip() throws InterruptedException, IOException {
+        final MemoryStore store = new MemoryStore();
+        final DedupReferenceLog log = new DedupReferenceLog(UUID, store, 100);
+        log.add(3, digest(1));
+        log.add(3, digest(2));
+        log.add(4, digest(1));
+        assertTrue(store.contents.isEmpty());
+        assertTrue(log.flush());
+        assertEquals(2, store.contents.size());
+
+        final Map<String, Map<String, Set<Integer>>> references = store.decodeAll();
+        assertEquals(2, references.size());
+        assertEquals(new TreeSet<>(Arrays.asList(3, 4)), references.get(digest(1)).get(UUID));
+        assertEquals(new TreeSet<>(Arrays.asList(3)), references.get(digest(2)).get(UUID));
+    }
+
+    @Test
+    public void testFullBatchIsWrittenAtOnce() throws InterruptedException, IOException {
+        final MemoryStore store = new MemoryStore();
+        final DedupReferenceLog log = new DedupReferenceLog(UUID, store, 2);
+        log.add(7, digest(1));
+        assertTrue(store.contents.isEmpty());
+        log.add(7, digest(2));
+        assertEquals(1, store.contents.size());
+        assertEquals(Integer.valueOf(7), store.generations.get(0));
+        log.add(7, digest(3));
+        assertTrue(log.flush());
+        assertEquals(2, store.contents.size());
+        assertEquals(3, store.decodeAll().size());
+    }
+
+    @Test
+    public void testLowercaseDigestsAreNormalized() throws InterruptedException, IOException {
+        final MemoryStore store = new MemoryStore();
+        final DedupReferenceLog log = new DedupReferenceLog(UUID, store, 10);
+        log.add(1, "89abcdef0123456789abcdef0123456789abcdef");
+        assertTrue(log.flush());
+        assertTrue(store.decodeAll().containsKey("89ABCDEF0123456789ABCDEF0123456789ABCDEF"));
+    }
+
+    @Test
+    public void testFailedBatchIsReported() throws InterruptedException {
+        final MemoryStore store = new MemoryStore();
+        store.failing = true;
+        final DedupReferenceLog log = new DedupReferenceLog(UUID, store, 10);
+        log.add(1, digest(1));
+        assertFalse(log.flush());
+    }
+
+    @Test(expected = IOException.class)
+    public void testBadMagic() throws InterruptedException, IOException {
+        final MemoryStore store = new MemoryStore();
+        final DedupReferenceLog log = new DedupReferenceLog(UUID, store, 10);
+        log.add(1, digest(1));
+        log.flush();
+        final byte[] content = store.contents.get(0);
+        content[7] = '0';
+        DedupReferenceLog.decode(content, new HashMap<>());
+    }
+
+    @Test(expected = IOException.class)
+    public void testTruncatedLog() throws InterruptedException, IOException {
+        final MemoryStore store = new MemoryStore();
+        final DedupReferenceLog log = new DedupReferenceLog(UUID, store, 10);
+        log.add(1, digest(1));
+        log.add(1, digest(2));
+        log.flush();
+        final byte[] content = store.contents.get(0);
+        DedupReferenceLog.decode(Arrays.copyOf(content, content.length - 1), new HashMap<>());
+    }
+}
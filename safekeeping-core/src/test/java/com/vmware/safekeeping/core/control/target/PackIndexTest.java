@@ -0,0 +1,143 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.control.target;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertFalse;
+import static org.junit.Assert.assertNotNull;
+import static org.junit.Assert.assertNull;
+import static org.junit.Assert.assertSame;
+import static org.junit.Assert.assertTrue;
+
+import java.io.IOException;
+import java.util.Arrays;
+import java.util.LinkedHashMap;
+import java.util.Map;
+
+import org.junit.Test;
+
+import com.vmware.safekeeping.core.control.info.ExBlockInfo;
+import com.vmware.safekeeping.core.profile.BasicBlockInfo;
+
+public class PackIndexTest {
+
+    static ExBlockInfo newBlock(final String sha1, final String md5, final int streamSize) {
+        final ExBlockInfo block = new ExBlockInfo(new BasicBlockInfo(0, 8, (byte) 0), 1, "key");
+        block.setSha1(sha1);
+        block.setMd5(md5);
+        block.setStreamSize(streamSize);
+        return block;
+    }
+
+    private static Map<String, PackIndex.Entry> newEntries() {
+        final Map<String, PackIndex.Entry> entries = new LinkedHashMap<>();
+        final ExBlockInfo first = newBlock("0123456789ABCDEF0123456789ABCDEF01234567",
+                "00112233445566778899AABBCCDDEEFF", 1000);
+        first.setCompress(true);
+        entries.put(first.getSha1(), new PackIndex.Entry("pack", 0, first));
+        final ExBlockInfo second = newBlock("89ABCDEF0123456789ABCDEF0123456789ABCDEF",
+                "FFEEDDCCBBAA99887766554433221100", 3000);
+        second.setCipher(true);
+        second.setCipherOffset((byte) 5);
+        entries.put(second.getSha1(), new PackIndex.Entry("pack", 1000, second));
+        return entries;
+    }
+
+    @Test
+    public void testRoundTrip() throws IOException {
+        final Map<String, PackIndex.Entry> read = PackIndex.read("pack", PackIndex.write(newEntries()));
+        assertEquals(2, read.size());
+
+        final ExBlockInfo first = newBlock(null, null, 0);
+        read.get("0123456789ABCDEF0123456789ABCDEF01234567").fill(first);
+        assertEquals("pack", first.getPackId());
+        assertEquals(0, first.getPackOffset());
+        assertEquals(1000, first.getPackLength());
+        assertEquals(1000, first.getStreamSize());
+        assertEquals(8 * 512, first.getSize());
+        assertEquals("00112233445566778899AABBCCDDEEFF", first.getMd5());
+        assertTrue(first.isCompress());
+        assertFalse(first.isCipher());
+
+        final ExBlockInfo second = newBlock(null, null, 0);
+        read.get("89ABCDEF0123456789ABCDEF0123456789ABCDEF").fill(second);
+        assertEquals(1000, second.getPackOffset());
+        assertEquals(3000, second.getPackLength());
+        assertFalse(second.isCompress());
+        assertTrue(second.isCipher());
+        assertEquals(5, second.getCipherOffset());
+    }
+
+    @Test
+    public void testEmptyIndex() throws IOException {
+        assertTrue(PackIndex.read("pack", PackIndex.write(new LinkedHashMap<>())).isEmpty());
+    }
+
+    @Test
+    public void testLookupIgnoresDigestCase() throws IOException {
+        final PackIndex index = new PackIndex();
+        final Map<String, PackIndex.Entry> entries = newEntries();
+        index.addAll(entries);
+        assertNotNull(index.get("0123456789abcdef0123456789abcdef01234567"));
+        assertNull(index.get("0000000000000000000000000000000000000000"));
+    }
+
+    @Test
+    public void testFirstPackedCopyWins() throws IOException {
+        final PackIndex index = new PackIndex();
+        final Map<String, PackIndex.Entry> entries = newEntries();
+        index.addAll(entries);
+        final ExBlockInfo again = newBlock("0123456789ABCDEF0123456789ABCDEF01234567",
+                "00112233445566778899AABBCCDDEEFF", 1000);
+        final Map<String, PackIndex.Entry> later = new LinkedHashMap<>();
+        later.put(again.getSha1(), new PackIndex.Entry("other", 0, again));
+        index.addAll(later);
+        assertSame(entries.get("0123456789ABCDEF0123456789ABCDEF01234567"),
+                index.get("0123456789ABCDEF0123456789ABCDEF01234567"));
+    }
+
+    @Test(expected = IOException.class)
+    public void testBadMagic() throws IOException {
+        final byte[] content = PackIndex.write(newEntries());
+        content[0] ^= 0x20;
+        PackIndex.read("pack", content);
+    }
+
+    @Test(expected = IOException.class)
+    public void testTruncatedIndex() throws IOException {
+        final byte[] content = PackIndex.write(newEntries());
+        PackIndex.read("pack", Arrays.copyOf(content, content.length - 3));
+    }
+
+    @Test(expected = IOException.class)
+    public void testEntryCountBeyondContent() throws IOException {
+        final byte[] content = PackIndex.write(newEntries());
+        // the count follows the 8 bytes magic
+        content[11] = 3;
+        PackIndex.read("pack", content);
+    }
+}
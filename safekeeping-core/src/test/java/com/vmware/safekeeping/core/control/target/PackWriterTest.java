@@ -0,0 +1,146 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.control.target;
+
+import static org.junit.Assert.assertArrayEquals;
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertFalse;
+import static org.junit.Assert.assertNotNull;
+import static org.junit.Assert.assertNull;
+import static org.junit.Assert.assertTrue;
+
+import java.io.IOException;
+import java.util.Arrays;
+import java.util.LinkedHashMap;
+import java.util.Map;
+
+import org.junit.Test;
+
+import com.vmware.safekeeping.core.control.info.ExBlockInfo;
+
+public class PackWriterTest {
+
+    /**
+     * Packs written, keyed by id
+     */
+    private static final class MemoryStore implements PackWriter.PackStore {
+        private final Map<String, byte[]> packs = new LinkedHashMap<>();
+        private final Map<String, byte[]> indexes = new LinkedHashMap<>();
+        private boolean failing;
+
+        @Override
+        public synchronized void putPack(final String packId, final byte[] pack, final int length,
+                final byte[] index) throws IOException {
+            if (this.failing) {
+                throw new IOException("store failure");
+            }
+            this.packs.put(packId, Arrays.copyOf(pack, length));
+            this.indexes.put(packId, index);
+        }
+    }
+
+    private static final int MAX_SIZE = 1024;
+
+    private static byte[] stream(final int length, final int seed) {
+        final byte[] data = new byte[length];
+        for (int i = 0; i < length; i++) {
+            data[i] = (byte) (seed + i);
+        }
+        return data;
+    }
+
+    private static ExBlockInfo newBlock(final int number, final int length) {
+        return PackIndexTest.newBlock(String.format("%040X", number), "00112233445566778899AABBCCDDEEFF", length);
+    }
+
+    @Test
+    public void testBlocksAreIndexedOnceTheirPackIsWritten() throws InterruptedException {
+        final PackIndex index = new PackIndex();
+        final MemoryStore store = new MemoryStore();
+        final PackWriter writer = new PackWriter(index, store, MAX_SIZE);
+        final ExBlockInfo block = newBlock(1, 100);
+        assertTrue(writer.append(block, stream(100, 1), 100));
+        assertNull(index.get(block.getSha1()));
+        assertTrue(store.packs.isEmpty());
+
+        assertTrue(writer.flush());
+        assertEquals(1, store.packs.size());
+        assertNotNull(index.get(block.getSha1()));
+        assertEquals(block.getPackId(), index.get(block.getSha1()).getPackId());
+    }
+
+    @Test
+    public void testPacksRoundTrip() throws InterruptedException, IOException {
+        final PackIndex index = new PackIndex();
+        final MemoryStore store = new MemoryStore();
+        final PackWriter writer = new PackWriter(index, store, MAX_SIZE);
+        final ExBlockInfo[] blocks = new ExBlockInfo[10];
+        for (int i = 0; i < blocks.length; i++) {
+            blocks[i] = newBlock(i, 300);
+            assertTrue(writer.append(blocks[i], stream(300, i), 300));
+        }
+        assertTrue(writer.flush());
+        // three 300 bytes streams fit in a 1024 bytes pack
+        assertEquals(4, store.packs.size());
+        for (int i = 0; i < blocks.length; i++) {
+            final ExBlockInfo block = blocks[i];
+            final byte[] pack = store.packs.get(block.getPackId());
+            assertArrayEquals(stream(300, i), Arrays.copyOfRange(pack, (int) block.getPackOffset(),
+                    (int) (block.getPackOffset() + block.getPackLength())));
+
+            final Map<String, PackIndex.Entry> entries = PackIndex.read(block.getPackId(),
+                    store.indexes.get(block.getPackId()));
+            final ExBlockInfo copy = newBlock(i, 0);
+            entries.get(block.getSha1()).fill(copy);
+            assertEquals(block.getPackOffset(), copy.getPackOffset());
+            assertEquals(300, copy.getPackLength());
+        }
+    }
+
+    @Test
+    public void testStreamLargerThanPackIsRefused() throws InterruptedException {
+        final MemoryStore store = new MemoryStore();
+        final PackWriter writer = new PackWriter(new PackIndex(), store, MAX_SIZE);
+        assertFalse(writer.append(newBlock(1, MAX_SIZE + 1), stream(MAX_SIZE + 1, 0), MAX_SIZE + 1));
+        assertTrue(writer.flush());
+        assertTrue(store.packs.isEmpty());
+    }
+
+    @Test
+    public void testFailedPackIsNotIndexed() throws InterruptedException {
+        final PackIndex index = new PackIndex();
+        final MemoryStore store = new MemoryStore();
+        store.failing = true;
+        final PackWriter writer = new PackWriter(index, store, MAX_SIZE);
+        final ExBlockInfo first = newBlock(1, 600);
+        assertTrue(writer.append(first, stream(600, 1), 600));
+        // closes the pack of the first block, whose write fails
+        assertFalse(writer.append(newBlock(2, 600), stream(600, 2), 600));
+        assertFalse(writer.flush());
+        assertNull(index.get(first.getSha1()));
+    }
+}
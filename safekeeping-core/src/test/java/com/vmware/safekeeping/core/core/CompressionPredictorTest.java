@@ -0,0 +1,124 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.core;
+
+import static org.junit.Assert.assertFalse;
+import static org.junit.Assert.assertTrue;
+
+import java.util.Random;
+
+import org.junit.Test;
+
+/**
+ * Runs on the Java estimator: the native library is not loaded by the tests.
+ */
+public class CompressionPredictorTest {
+    private static final int BLOCK_SIZE = 64 * 1024;
+    private static final int MIN_SAVING_PERCENT = 10;
+    private static final int SAMPLE_SIZE = 4096;
+    private static final int BACKOFF_BLOCKS = 3;
+    private static final int REPROBE_INTERVAL = 4;
+
+    private static byte[] random(final long seed) {
+        final byte[] data = new byte[BLOCK_SIZE];
+        new Random(seed).nextBytes(data);
+        return data;
+    }
+
+    private static CompressionPredictor newPredictor() {
+        return new CompressionPredictor(true, MIN_SAVING_PERCENT, SAMPLE_SIZE, BACKOFF_BLOCKS, REPROBE_INTERVAL);
+    }
+
+    @Test
+    public void testZeroBlockIsCompressible() {
+        assertTrue(newPredictor().isCompressible(new byte[BLOCK_SIZE], BLOCK_SIZE));
+    }
+
+    @Test
+    public void testEmptyBlockIsCompressible() {
+        assertTrue(newPredictor().isCompressible(new byte[0], 0));
+    }
+
+    @Test
+    public void testRandomBlockIsNotCompressible() {
+        assertFalse(newPredictor().isCompressible(random(1), BLOCK_SIZE));
+    }
+
+    @Test
+    public void testSmallAlphabetIsCompressible() {
+        // 4 bits per byte: about 50% saving
+        final byte[] data = random(2);
+        for (int i = 0; i < data.length; i++) {
+            data[i] = (byte) ('a' + (data[i] & 0x0f));
+        }
+        assertTrue(newPredictor().isCompressible(data, BLOCK_SIZE));
+    }
+
+    @Test
+    public void testShortBlockIsSampledWhole() {
+        final byte[] data = random(3);
+        assertFalse(newPredictor().isCompressible(data, SAMPLE_SIZE / 2));
+        assertTrue(newPredictor().isCompressible(new byte[SAMPLE_SIZE / 2], SAMPLE_SIZE / 2));
+    }
+
+    @Test
+    public void testDisabledPredictsEverythingCompressible() {
+        final CompressionPredictor predictor = new CompressionPredictor(false, MIN_SAVING_PERCENT, SAMPLE_SIZE,
+                BACKOFF_BLOCKS, REPROBE_INTERVAL);
+        for (int i = 0; i < (BACKOFF_BLOCKS * 2); i++) {
+            assertTrue(predictor.isCompressible(random(i), BLOCK_SIZE));
+        }
+    }
+
+    @Test
+    public void testBackOffAndReprobe() {
+        final CompressionPredictor predictor = newPredictor();
+        for (int i = 0; i < BACKOFF_BLOCKS; i++) {
+            assertFalse(predictor.isCompressible(random(i), BLOCK_SIZE));
+        }
+        final byte[] zeros = new byte[BLOCK_SIZE];
+        // backed off: not even sampled until the reprobe
+        for (int i = 1; i < REPROBE_INTERVAL; i++) {
+            assertFalse(predictor.isCompressible(zeros, BLOCK_SIZE));
+        }
+        assertTrue(predictor.isCompressible(zeros, BLOCK_SIZE));
+        // the reprobe found compressible data: back to sampling every block
+        assertTrue(predictor.isCompressible(zeros, BLOCK_SIZE));
+    }
+
+    @Test
+    public void testWrongPredictionsCount() {
+        final CompressionPredictor predictor = newPredictor();
+        final byte[] zeros = new byte[BLOCK_SIZE];
+        assertTrue(predictor.isCompressible(zeros, BLOCK_SIZE));
+        // compressed anyway, but each block saved less than the minimum
+        for (int i = 0; i < BACKOFF_BLOCKS; i++) {
+            predictor.update(BLOCK_SIZE, BLOCK_SIZE - 16);
+        }
+        assertFalse(predictor.isCompressible(zeros, BLOCK_SIZE));
+    }
+}
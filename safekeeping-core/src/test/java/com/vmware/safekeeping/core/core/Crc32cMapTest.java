@@ -0,0 +1,122 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.core;
+
+import static org.junit.Assert.assertArrayEquals;
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertNull;
+
+import java.nio.charset.StandardCharsets;
+import java.util.Arrays;
+import java.util.Random;
+
+import org.junit.Test;
+
+/**
+ * Runs on the Java table: the native library is not loaded by the tests.
+ */
+public class Crc32cMapTest {
+
+    private static byte[] random(final int length) {
+        final byte[] data = new byte[length];
+        new Random(length).nextBytes(data);
+        return data;
+    }
+
+    private static int crc32c(final byte[] data) {
+        return Crc32cMap.compute(data, 0, data.length)[0];
+    }
+
+    @Test
+    public void testKnownValues() {
+        // check value of CRC-32C, then RFC 3720 B.4
+        assertEquals(0xe3069283, crc32c("123456789".getBytes(StandardCharsets.US_ASCII)));
+        assertEquals(0x8a9136aa, crc32c(new byte[32]));
+        final byte[] ones = new byte[32];
+        Arrays.fill(ones, (byte) 0xff);
+        assertEquals(0x62a8ab43, crc32c(ones));
+        final byte[] increasing = new byte[32];
+        for (int i = 0; i < increasing.length; i++) {
+            increasing[i] = (byte) i;
+        }
+        assertEquals(0x46dd794e, crc32c(increasing));
+    }
+
+    @Test
+    public void testChunks() {
+        final byte[] data = random((2 * Crc32cMap.CHUNK_SIZE) + 1808);
+        final int[] map = Crc32cMap.compute(data, 0, data.length);
+        assertEquals(3, map.length);
+        for (int i = 0; i < map.length; i++) {
+            final int from = i * Crc32cMap.CHUNK_SIZE;
+            assertEquals(crc32c(Arrays.copyOfRange(data, from, Math.min(data.length, from + Crc32cMap.CHUNK_SIZE))),
+                    map[i]);
+        }
+        assertEquals(0, Crc32cMap.compute(data, 0, 0).length);
+    }
+
+    @Test
+    public void testOffset() {
+        final byte[] data = random(3 * Crc32cMap.CHUNK_SIZE);
+        assertArrayEquals(Crc32cMap.compute(Arrays.copyOfRange(data, 100, 100 + (2 * Crc32cMap.CHUNK_SIZE)), 0,
+                2 * Crc32cMap.CHUNK_SIZE), Crc32cMap.compute(data, 100, 2 * Crc32cMap.CHUNK_SIZE));
+    }
+
+    @Test
+    public void testEncodeRoundTrip() {
+        final int[] map = Crc32cMap.compute(random(5 * Crc32cMap.CHUNK_SIZE), 0, 5 * Crc32cMap.CHUNK_SIZE);
+        assertArrayEquals(map, Crc32cMap.decode(Crc32cMap.encode(map)));
+        assertArrayEquals(new int[0], Crc32cMap.decode(Crc32cMap.encode(new int[0])));
+        assertNull(Crc32cMap.encode(null));
+        assertNull(Crc32cMap.decode(null));
+    }
+
+    @Test
+    public void testMatchingMaps() {
+        final int[] map = Crc32cMap.compute(random(4 * Crc32cMap.CHUNK_SIZE), 0, 4 * Crc32cMap.CHUNK_SIZE);
+        assertNull(Crc32cMap.compare(map, map.clone(), 0));
+    }
+
+    @Test
+    public void testCorruptionIsLocalized() {
+        final byte[] data = random(6 * Crc32cMap.CHUNK_SIZE);
+        final int[] expected = Crc32cMap.compute(data, 0, data.length);
+        final byte[] corrupted = data.clone();
+        // one bit in chunk 1, one byte in chunk 2, the last byte of chunk 4
+        corrupted[Crc32cMap.CHUNK_SIZE + 17] ^= 0x01;
+        corrupted[(2 * Crc32cMap.CHUNK_SIZE) + 1000] ^= 0x5a;
+        corrupted[(5 * Crc32cMap.CHUNK_SIZE) - 1] ^= 0x01;
+        final int[] actual = Crc32cMap.compute(corrupted, 0, corrupted.length);
+        assertEquals("CRC32C mismatch on sectors 1008-1023, 1032-1039", Crc32cMap.compare(expected, actual, 1000));
+    }
+
+    @Test
+    public void testTruncatedMap() {
+        final int[] map = Crc32cMap.compute(random(4 * Crc32cMap.CHUNK_SIZE), 0, 4 * Crc32cMap.CHUNK_SIZE);
+        assertEquals("CRC32C map has 3 entries, expected 4", Crc32cMap.compare(map, Arrays.copyOf(map, 3), 0));
+    }
+}
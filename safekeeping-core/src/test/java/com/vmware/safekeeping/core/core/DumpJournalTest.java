@@ -0,0 +1,196 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.core;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertFalse;
+import static org.junit.Assert.assertNull;
+import static org.junit.Assert.assertTrue;
+
+import java.io.File;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.util.ArrayList;
+import java.util.List;
+
+import org.junit.Before;
+import org.junit.Rule;
+import org.junit.Test;
+import org.junit.rules.TemporaryFolder;
+
+import com.vmware.safekeeping.core.control.info.ExBlockInfo;
+import com.vmware.safekeeping.core.profile.BasicBlockInfo;
+
+public class DumpJournalTest {
+    private static final String IDENTITY = "vm|disk|0|snapshot-1|*|1073741824|1048576|true|false|SHA-1|target";
+
+    private static final String SHA1 = "0123456789ABCDEF0123456789ABCDEF01234567";
+    private static final String SHA1_OTHER = "89ABCDEF0123456789ABCDEF0123456789ABCDEF";
+    private static final String MD5 = "00112233445566778899AABBCCDDEEFF";
+
+    private static final int HEADER_SIZE = 4096;
+    private static final int RECORD_SIZE = 128;
+
+    @Rule
+    public TemporaryFolder folder = new TemporaryFolder();
+
+    private File file;
+    private List<BasicBlockInfo> blocks;
+
+    private static List<BasicBlockInfo> newBlocks(final int count, final long length) {
+        final List<BasicBlockInfo> result = new ArrayList<>();
+        for (int i = 0; i < count; i++) {
+            final BasicBlockInfo block = new BasicBlockInfo(i * length, length, (byte) 0);
+            block.setIndex(i);
+            result.add(block);
+        }
+        return result;
+    }
+
+    private ExBlockInfo block(final int index) {
+        return new ExBlockInfo(this.blocks.get(index), this.blocks.size(), "key");
+    }
+
+    private void commitTwoBlocks() throws IOException {
+        try (DumpJournal journal = new DumpJournal(this.file, IDENTITY, this.blocks)) {
+            final ExBlockInfo first = block(0);
+            first.setSha1(SHA1);
+            first.setMd5(MD5);
+            first.setCipherOffset((byte) 7);
+            first.setStreamSize(12345);
+            journal.commit(first);
+            final ExBlockInfo third = block(2);
+            third.setSha1(SHA1_OTHER);
+            third.setStreamSize(678);
+            journal.commit(third);
+        }
+    }
+
+    private void corrupt(final long position, final int value) throws IOException {
+        try (RandomAccessFile raf = new RandomAccessFile(this.file, "rw")) {
+            raf.seek(position);
+            raf.write(value);
+        }
+    }
+
+    @Before
+    public void setUp() throws IOException {
+        this.file = new File(this.folder.getRoot(), "test.jnl");
+        this.blocks = newBlocks(3, 2048);
+    }
+
+    @Test
+    public void testRoundTrip() throws IOException {
+        commitTwoBlocks();
+        try (DumpJournal journal = new DumpJournal(this.file, IDENTITY, this.blocks)) {
+            final ExBlockInfo first = block(0);
+            assertTrue(journal.restore(first));
+            assertEquals(SHA1, first.getSha1());
+            assertEquals(MD5, first.getMd5());
+            assertEquals(7, first.getCipherOffset());
+            assertEquals(12345, first.getStreamSizeAsInteger());
+
+            assertFalse(journal.restore(block(1)));
+
+            final ExBlockInfo third = block(2);
+            assertTrue(journal.restore(third));
+            assertEquals(SHA1_OTHER, third.getSha1());
+            assertNull(third.getMd5());
+            assertEquals(678, third.getStreamSizeAsInteger());
+        }
+    }
+
+    @Test
+    public void testCommitWithoutDigestIsIgnored() throws IOException {
+        try (DumpJournal journal = new DumpJournal(this.file, IDENTITY, this.blocks)) {
+            journal.commit(block(1));
+            assertFalse(journal.restore(block(1)));
+        }
+    }
+
+    @Test
+    public void testOtherIdentityResets() throws IOException {
+        commitTwoBlocks();
+        try (DumpJournal journal = new DumpJournal(this.file, IDENTITY + "|other", this.blocks)) {
+            assertFalse(journal.restore(block(0)));
+            assertFalse(journal.restore(block(2)));
+        }
+    }
+
+    @Test
+    public void testOtherBlockCountResets() throws IOException {
+        commitTwoBlocks();
+        this.blocks = newBlocks(4, 2048);
+        try (DumpJournal journal = new DumpJournal(this.file, IDENTITY, this.blocks)) {
+            assertFalse(journal.restore(block(0)));
+            assertFalse(journal.restore(block(2)));
+        }
+    }
+
+    @Test
+    public void testOtherBlockLengthIsNotRestored() throws IOException {
+        commitTwoBlocks();
+        this.blocks = newBlocks(3, 1024);
+        try (DumpJournal journal = new DumpJournal(this.file, IDENTITY, this.blocks)) {
+            assertFalse(journal.restore(block(0)));
+            assertFalse(journal.restore(block(2)));
+        }
+    }
+
+    @Test
+    public void testTornRecordIsNotCommitted() throws IOException {
+        commitTwoBlocks();
+        // commit marker of the first record
+        corrupt(HEADER_SIZE, 0);
+        try (DumpJournal journal = new DumpJournal(this.file, IDENTITY, this.blocks)) {
+            assertFalse(journal.restore(block(0)));
+            assertTrue(journal.restore(block(2)));
+        }
+    }
+
+    @Test
+    public void testCorruptedHeaderResets() throws IOException {
+        commitTwoBlocks();
+        corrupt(0, 'X');
+        try (DumpJournal journal = new DumpJournal(this.file, IDENTITY, this.blocks)) {
+            assertFalse(journal.restore(block(0)));
+            assertFalse(journal.restore(block(2)));
+        }
+    }
+
+    @Test
+    public void testTruncatedJournalResets() throws IOException {
+        commitTwoBlocks();
+        try (RandomAccessFile raf = new RandomAccessFile(this.file, "rw")) {
+            raf.setLength(HEADER_SIZE + RECORD_SIZE);
+        }
+        try (DumpJournal journal = new DumpJournal(this.file, IDENTITY, this.blocks)) {
+            assertFalse(journal.restore(block(0)));
+            assertFalse(journal.restore(block(2)));
+        }
+    }
+}
@@ -0,0 +1,194 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.core;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertFalse;
+import static org.junit.Assert.assertTrue;
+import static org.junit.Assert.fail;
+
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.Callable;
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.Future;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.atomic.AtomicIntegerArray;
+
+import org.junit.After;
+import org.junit.Test;
+
+public class DumpSchedulerTest {
+
+    /**
+     * Block recording how many blocks of its disk run at the same time
+     */
+    private static final class Block implements Callable<Boolean> {
+        private final AtomicInteger running;
+        private final AtomicInteger maxRunning;
+        private final AtomicIntegerArray runs;
+        private final int index;
+
+        Block(final AtomicInteger running, final AtomicInteger maxRunning, final AtomicIntegerArray runs,
+                final int index) {
+            this.running = running;
+            this.maxRunning = maxRunning;
+            this.runs = runs;
+            this.index = index;
+        }
+
+        @Override
+        public Boolean call() throws Exception {
+            final int now = this.running.incrementAndGet();
+            this.maxRunning.accumulateAndGet(now, Math::max);
+            Thread.sleep(1);
+            this.runs.incrementAndGet(this.index);
+            this.running.decrementAndGet();
+            return true;
+        }
+    }
+
+    private DumpScheduler scheduler;
+
+    private static List<Block> newBlocks(final int count, final AtomicInteger maxRunning,
+            final AtomicIntegerArray runs) {
+        final AtomicInteger running = new AtomicInteger();
+        final List<Block> blocks = new ArrayList<>();
+        for (int i = 0; i < count; i++) {
+            blocks.add(new Block(running, maxRunning, runs, i));
+        }
+        return blocks;
+    }
+
+    @After
+    public void tearDown() {
+        if (this.scheduler != null) {
+            this.scheduler.close();
+        }
+    }
+
+    @Test
+    public void testInvokeAllRunsEveryBlockOnce() throws InterruptedException, ExecutionException {
+        this.scheduler = new DumpScheduler("test", 4);
+        this.scheduler.addWorkers(4);
+        final AtomicIntegerArray runs = new AtomicIntegerArray(200);
+        final List<Future<Boolean>> futures = this.scheduler.invokeAll(newBlocks(200, new AtomicInteger(), runs));
+        assertEquals(200, futures.size());
+        for (int i = 0; i < futures.size(); i++) {
+            assertTrue(futures.get(i).isDone());
+            assertTrue(futures.get(i).get());
+            assertEquals(1, runs.get(i));
+        }
+    }
+
+    @Test
+    public void testDiskCapIsHonoured() throws InterruptedException {
+        this.scheduler = new DumpScheduler("test", 2);
+        this.scheduler.addWorkers(8);
+        final AtomicInteger maxFirst = new AtomicInteger();
+        final AtomicInteger maxSecond = new AtomicInteger();
+        final AtomicIntegerArray runsFirst = new AtomicIntegerArray(100);
+        final AtomicIntegerArray runsSecond = new AtomicIntegerArray(100);
+        final List<Future<Boolean>> first = this.scheduler.submitAll(this.scheduler.newDiskGroup(),
+                newBlocks(100, maxFirst, runsFirst));
+        this.scheduler.invokeAll(newBlocks(100, maxSecond, runsSecond));
+        for (final Future<Boolean> future : first) {
+            try {
+                future.get(10, TimeUnit.SECONDS);
+            } catch (final Exception e) {
+                fail(e.toString());
+            }
+        }
+        assertTrue(maxFirst.get() <= 2);
+        assertTrue(maxSecond.get() <= 2);
+        for (int i = 0; i < 100; i++) {
+            assertEquals(1, runsFirst.get(i));
+            assertEquals(1, runsSecond.get(i));
+        }
+    }
+
+    @Test
+    public void testFailedBlockDoesNotStopTheDisk() throws InterruptedException {
+        this.scheduler = new DumpScheduler("test", 2);
+        this.scheduler.addWorkers(2);
+        final AtomicInteger done = new AtomicInteger();
+        final List<Callable<Boolean>> blocks = new ArrayList<>();
+        for (int i = 0; i < 10; i++) {
+            final int index = i;
+            blocks.add(() -> {
+                if (index == 3) {
+                    throw new IOException("block 3");
+                }
+                done.incrementAndGet();
+                return true;
+            });
+        }
+        final List<Future<Boolean>> futures = this.scheduler.invokeAll(blocks);
+        assertEquals(9, done.get());
+        try {
+            futures.get(3).get();
+            fail("block 3 must fail");
+        } catch (final ExecutionException e) {
+            assertTrue(e.getCause() instanceof IOException);
+        }
+    }
+
+    @Test(expected = IllegalStateException.class)
+    public void testSubmitWithoutWorkers() {
+        this.scheduler = new DumpScheduler("test", 2);
+        final List<Callable<Boolean>> blocks = new ArrayList<>();
+        blocks.add(() -> true);
+        this.scheduler.submitAll(this.scheduler.newDiskGroup(), blocks);
+    }
+
+    @Test
+    public void testCloseCancelsQueuedBlocks() throws InterruptedException {
+        this.scheduler = new DumpScheduler("test", 1);
+        this.scheduler.addWorkers(1);
+        final CountDownLatch started = new CountDownLatch(1);
+        final CountDownLatch release = new CountDownLatch(1);
+        final List<Callable<Boolean>> blocks = new ArrayList<>();
+        blocks.add(() -> {
+            started.countDown();
+            return release.await(10, TimeUnit.SECONDS);
+        });
+        for (int i = 0; i < 5; i++) {
+            blocks.add(() -> true);
+        }
+        final List<Future<Boolean>> futures = this.scheduler.submitAll(this.scheduler.newDiskGroup(), blocks);
+        assertTrue(started.await(10, TimeUnit.SECONDS));
+        this.scheduler.close();
+        release.countDown();
+        assertFalse(futures.get(0).isCancelled());
+        for (int i = 1; i < futures.size(); i++) {
+            assertTrue(futures.get(i).isCancelled());
+        }
+    }
+}
@@ -0,0 +1,270 @@
+/*******************************************************************************
+ * Copyright (C) 2021, VMware Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+package com.vmware.safekeeping.core.profile;
+
+import static org.junit.Assert.assertArrayEquals;
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertNull;
+import static org.junit.Assert.assertTrue;
+
+import java.io.ByteArrayOutputStream;
+import java.io.IOException;
+import java.nio.charset.StandardCharsets;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+import java.util.Map;
+import java.util.TreeMap;
+
+import org.junit.Test;
+
+import com.vmware.jvix.jDiskLibConst;
+
+/**
+ * The catalogs are written by the native library: the tests encode them here
+ * following jCatalog.h.
+ */
+public class FileCatalogTest {
+
+    private static final class Record {
+        private final int type;
+        private final int mode;
+        private final long size;
+        private final long mtime;
+        private final long[] extents;
+
+        private Record(final int type, final int mode, final long size, final long mtime, final long... extents) {
+            this.type = type;
+            this.mode = mode;
+            this.size = size;
+            this.mtime = mtime;
+            this.extents = extents;
+        }
+    }
+
+    private static final int HEADER_SIZE = 16;
+    private static final int RESTART_INTERVAL = 16;
+    private static final int FILES = 40;
+
+    /**
+     * @param records sorted by path
+     */
+    private static byte[] encode(final Map<String, Record> records) {
+        final ByteArrayOutputStream body = new ByteArrayOutputStream();
+        final List<Integer> restarts = new ArrayList<>();
+        byte[] previous = new byte[0];
+        int index = 0;
+        for (final Map.Entry<String, Record> entry : records.entrySet()) {
+            final byte[] path = entry.getKey().getBytes(StandardCharsets.UTF_8);
+            int shared = 0;
+            if ((index % RESTART_INTERVAL) == 0) {
+                restarts.add(HEADER_SIZE + body.size());
+            } else {
+                while ((shared < Math.min(path.length, previous.length)) && (path[shared] == previous[shared])) {
+                    ++shared;
+                }
+            }
+            putVarint(body, shared);
+            putVarint(body, path.length - shared);
+            body.write(path, shared, path.length - shared);
+            final Record record = entry.getValue();
+            putVarint(body, record.type);
+            putVarint(body, record.mode);
+            putVarint(body, record.size);
+            putSigned(body, record.mtime);
+            putVarint(body, record.extents.length / 3);
+            long fileEnd = 0;
+            long diskEnd = 0;
+            for (int i = 0; i < record.extents.length; i += 3) {
+                putVarint(body, record.extents[i] - fileEnd);
+                putSigned(body, record.extents[i + 1] - diskEnd);
+                putVarint(body, record.extents[i + 2]);
+                fileEnd = record.extents[i] + record.extents[i + 2];
+                diskEnd = record.extents[i + 1] + record.extents[i + 2];
+            }
+            previous = path;
+            ++index;
+        }
+        final ByteArrayOutputStream out = new ByteArrayOutputStream();
+        putInt(out, 0x54414b53);
+        putInt(out, 1);
+        putInt(out, records.size());
+        putInt(out, restarts.size());
+        out.write(body.toByteArray(), 0, body.size());
+        for (final Integer restart : restarts) {
+            putInt(out, restart);
+        }
+        return out.toByteArray();
+    }
+
+    private static void putInt(final ByteArrayOutputStream out, final int value) {
+        out.write(value);
+        out.write(value >>> 8);
+        out.write(value >>> 16);
+        out.write(value >>> 24);
+    }
+
+    private static void putSigned(final ByteArrayOutputStream out, final long value) {
+        putVarint(out, (value << 1) ^ (value >> 63));
+    }
+
+    private static void putVarint(final ByteArrayOutputStream out, final long value) {
+        long v = value;
+        while ((v & ~0x7fL) != 0) {
+            out.write((int) ((v & 0x7f) | 0x80));
+            v >>>= 7;
+        }
+        out.write((int) v);
+    }
+
+    /**
+     * The FILES files of /etc make the records span several restart points
+     */
+    private static Map<String, Record> sample() {
+        final Map<String, Record> records = new TreeMap<>();
+        records.put("/bin", new Record(jDiskLibConst.GUESTFS_TYPE_SYMLINK, 0777, 7, 1600000001L));
+        records.put("/etc", new Record(jDiskLibConst.GUESTFS_TYPE_DIRECTORY, 0755, 4096, 1600000002L));
+        for (int i = 0; i < FILES; i++) {
+            // the second extent goes backward on the disk
+            records.put(String.format("/etc/file%02d", i), new Record(jDiskLibConst.GUESTFS_TYPE_FILE, 0644,
+                    8192L + i, 1600000100L + i, 0, 1048576L * (i + 2), 4096, 4096, 1048576L, 4096 + i));
+        }
+        records.put("/etc/ssh", new Record(jDiskLibConst.GUESTFS_TYPE_DIRECTORY, 0700, 4096, 1600000003L));
+        records.put("/etc/ssh/sshd_config",
+                new Record(jDiskLibConst.GUESTFS_TYPE_FILE, 0600, 3000, -1L, 0, 65536, 3000));
+        records.put("/etcetera", new Record(jDiskLibConst.GUESTFS_TYPE_FILE, 0644, 0, 0));
+        records.put("/var/\u00e9t\u00e9", new Record(jDiskLibConst.GUESTFS_TYPE_FILE, 0644, 1, 1600000004L, 0, 512, 1));
+        return records;
+    }
+
+    private static List<String> paths(final List<FileCatalog.Entry> entries) {
+        final List<String> result = new ArrayList<>();
+        for (final FileCatalog.Entry entry : entries) {
+            result.add(entry.getPath());
+        }
+        return result;
+    }
+
+    @Test(expected = IOException.class)
+    public void testBadMagic() throws IOException {
+        final byte[] data = encode(sample());
+        data[0] ^= 1;
+        new FileCatalog(data);
+    }
+
+    @Test(expected = IOException.class)
+    public void testBadRestartCount() throws IOException {
+        final byte[] data = encode(sample());
+        ++data[12];
+        new FileCatalog(data);
+    }
+
+    @Test(expected = IOException.class)
+    public void testBadVersion() throws IOException {
+        final byte[] data = encode(sample());
+        data[4] = 2;
+        new FileCatalog(data);
+    }
+
+    @Test
+    public void testEmpty() throws IOException {
+        final FileCatalog catalog = new FileCatalog(encode(new TreeMap<String, Record>()));
+        assertEquals(0, catalog.getRecords());
+        assertNull(catalog.lookup("/etc"));
+        assertTrue(catalog.list("/").isEmpty());
+    }
+
+    @Test
+    public void testList() throws IOException {
+        final Map<String, Record> records = sample();
+        final FileCatalog catalog = new FileCatalog(encode(records));
+
+        final List<String> etc = new ArrayList<>();
+        for (int i = 0; i < FILES; i++) {
+            etc.add(String.format("/etc/file%02d", i));
+        }
+        etc.add("/etc/ssh");
+        etc.add("/etc/ssh/sshd_config");
+        assertEquals(etc, paths(catalog.list("/etc")));
+        assertEquals(etc, paths(catalog.list("/etc/")));
+        assertEquals(Arrays.asList("/etc/ssh/sshd_config"), paths(catalog.list("/etc/ssh")));
+
+        assertEquals(new ArrayList<>(records.keySet()), paths(catalog.list("/")));
+
+        // a prefix of a name is not its directory
+        assertTrue(catalog.list("/et").isEmpty());
+        assertTrue(catalog.list("/etc/file01").isEmpty());
+        assertTrue(catalog.list("/usr").isEmpty());
+        assertTrue(catalog.list("/zzz").isEmpty());
+    }
+
+    @Test
+    public void testLookup() throws IOException {
+        final Map<String, Record> records = sample();
+        final FileCatalog catalog = new FileCatalog(encode(records));
+        assertEquals(records.size(), catalog.getRecords());
+        for (final Map.Entry<String, Record> expected : records.entrySet()) {
+            final FileCatalog.Entry entry = catalog.lookup(expected.getKey());
+            final Record record = expected.getValue();
+            assertEquals(expected.getKey(), entry.getPath());
+            assertEquals(record.type, entry.getType());
+            assertEquals(record.mode, entry.getMode());
+            assertEquals(record.size, entry.getSize());
+            assertEquals(record.mtime, entry.getMtime());
+            assertArrayEquals(record.extents, entry.getExtents());
+        }
+    }
+
+    @Test
+    public void testLookupMissing() throws IOException {
+        final FileCatalog catalog = new FileCatalog(encode(sample()));
+        assertNull(catalog.lookup(""));
+        assertNull(catalog.lookup("/et"));
+        assertNull(catalog.lookup("/etc/"));
+        assertNull(catalog.lookup("/etc/file0"));
+        assertNull(catalog.lookup("/etc/file100"));
+        assertNull(catalog.lookup("/etc/file15x"));
+        assertNull(catalog.lookup("/zzz"));
+    }
+
+    @Test(expected = IOException.class)
+    public void testShortHeader() throws IOException {
+        new FileCatalog(Arrays.copyOf(encode(sample()), HEADER_SIZE - 1));
+    }
+
+    @Test(expected = IOException.class)
+    public void testTruncatedRecord() throws IOException {
+        final Map<String, Record> records = sample();
+        final byte[] data = encode(records);
+        final int restarts = 4 * (((records.size() + RESTART_INTERVAL) - 1) / RESTART_INTERVAL);
+        // drop the last byte of the records, keeping the restart table
+        final byte[] truncated = new byte[data.length - 1];
+        System.arraycopy(data, 0, truncated, 0, data.length - restarts - 1);
+        System.arraycopy(data, data.length - restarts, truncated, data.length - restarts - 1, restarts);
+        new FileCatalog(truncated).lookup("/var/\u00e9t\u00e9");
+    }
+}